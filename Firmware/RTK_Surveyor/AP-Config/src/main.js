@@ -36,6 +36,11 @@ var obtainedMessageList = false;
 var obtainedMessageListBase = false;
 var showingMessageRTCMList = false;
 var fileTableText = "";
+var fileListOffset = 0;
+var fileListTotal = 0;
+var fileListRows = 0;
+var fileListRequest = 0;
+const fileListPageSize = 25;
 var messageText = "";
 var lastMessageType = "";
 var lastMessageTypeBase = "";
@@ -171,6 +176,7 @@ function parseIncoming(msg) {
             || id.includes("deviceBTID")
             || id.includes("logFileName")
             || id.includes("batteryPercent")
+            || id.includes("ringBufferDrops")
         ) {
             ge(id).innerHTML = val;
         }
@@ -245,6 +251,12 @@ function parseIncoming(msg) {
         else if (id.includes("fmNext")) {
             sendFile();
         }
+        else if (id.includes("fmFiles")) {
+            fileListTotal = Number(val);
+        }
+        else if (id.includes("fmOffset")) {
+            fileListOffset = Number(val);
+        }
         else if (id.includes("UBX_")) {
             var messageName = id;
             var messageRate = val;
@@ -555,12 +567,14 @@ function validateFields() {
             checkElementString("ntripServer_CasterUserPW_0", 0, 49, "Must be 0 to 49 characters", "collapseBaseConfig");
             checkElementString("ntripServer_MountPoint_0", 1, 49, "Must be 1 to 49 characters", "collapseBaseConfig");
             checkElementString("ntripServer_MountPointPW_0", 0, 49, "Must be 0 to 49 characters", "collapseBaseConfig");
+            checkElementString("ntripServer_RtcmFilter_0", 0, 49, "Must be 0 to 49 characters", "collapseBaseConfig");
             checkElementString("ntripServer_CasterHost_1", 0, 49, "Must be 0 to 49 characters", "collapseBaseConfig");
             checkElementValue("ntripServer_CasterPort_1", 0, 99999, "Must be 0 to 99999", "collapseBaseConfig");
             checkElementString("ntripServer_CasterUser_1", 0, 49, "Must be 0 to 49 characters", "collapseBaseConfig");
             checkElementString("ntripServer_CasterUserPW_1", 0, 49, "Must be 0 to 49 characters", "collapseBaseConfig");
             checkElementString("ntripServer_MountPoint_1", 0, 49, "Must be 0 to 49 characters", "collapseBaseConfig");
             checkElementString("ntripServer_MountPointPW_1", 0, 49, "Must be 0 to 49 characters", "collapseBaseConfig");
+            checkElementString("ntripServer_RtcmFilter_1", 0, 49, "Must be 0 to 49 characters", "collapseBaseConfig");
         }
         // Don't overwrite with the defaults here. User may want to disable NTRIP but not lose the existing settings.
         // else {
@@ -1477,21 +1491,53 @@ function getFileList() {
 
         //If the tab was just opened, create table from scratch
         ge("fileManagerTable").innerHTML = "<table><tr align='left'><th>Name</th><th>Size</th><td><input type='checkbox' id='fileSelectAll' class='form-check-input fileManagerCheck' onClick='fileManagerToggle()'></td></tr></tr></table>";
-        fileTableText = "";
-
-        xmlhttp = new XMLHttpRequest();
-        xmlhttp.open("GET", "/listfiles", false);
-        xmlhttp.send();
+        ge("fileListStatus").innerHTML = "";
+        fileListRows = 0;
+        fileListTotal = 0;
+        fileListRequest++;
 
-        parseIncoming(xmlhttp.responseText); //Process CSV data into HTML
-
-        ge("fileManagerTable").innerHTML += fileTableText;
+        getFileListPage(0, fileListRequest);
     }
     else {
         showingFileList = false;
     }
 }
 
+//Request a page of the file list, the rows are added to the table as each page arrives
+function getFileListPage(offset, request) {
+    var sortOrder = ge("fileListSort").value.split(',');
+    var urltocall = "/listfiles?offset=" + offset + "&count=" + fileListPageSize
+        + "&sort=" + sortOrder[0] + "&order=" + sortOrder[1]
+        + "&ext=" + encodeURIComponent(ge("fileListExtension").value.trim())
+        + "&date=" + encodeURIComponent(ge("fileListDate").value.trim());
+
+    var ajax = new XMLHttpRequest();
+    ajax.addEventListener("load", function () {
+        //Ignore pages arriving after the file manager is closed or refreshed
+        if ((showingFileList == false) || (request != fileListRequest))
+            return;
+
+        fileTableText = "";
+        parseIncoming(ajax.responseText); //Process CSV data into HTML
+        ge("fileManagerTable").innerHTML += fileTableText;
+
+        fileListRows = Math.min(fileListTotal, fileListOffset + fileListPageSize);
+        ge("fileListStatus").innerHTML = fileListRows + " of " + fileListTotal + " files";
+
+        //Request the next page
+        if (fileListRows < fileListTotal)
+            getFileListPage(fileListRows, request);
+    });
+    ajax.open("GET", urltocall);
+    ajax.send();
+}
+
+//Rebuild the file list using the sort order and filters
+function fileListRefresh() {
+    showingFileList = false;
+    getFileList();
+}
+
 function getMessageList() {
     if (obtainedMessageList == false) {
         obtainedMessageList = true;
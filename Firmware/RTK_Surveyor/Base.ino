@@ -334,9 +334,9 @@ bool startFixedBase()
 // Useful for passing the RTCM correction data to a radio, Ntrip broadcaster, etc.
 void DevUBLOXGNSS::processRTCM(uint8_t incoming)
 {
-    // We need to prevent ntripServerProcessRTCM from writing data via Ethernet (SPI W5500)
+    // We need to prevent ntripServerSendRTCM from writing data via Ethernet (SPI W5500)
     // during an SPI checkUbloxSpi...
-    // We can pass incoming to ntripServerProcessRTCM if the GNSS is I2C or the variant does not have Ethernet.
+    // We can pass incoming to ntripServerSendRTCM if the GNSS is I2C or the variant does not have Ethernet.
     // For the Ref Stn, processRTCMBuffer is called manually from inside ntripServerUpdate
     if ((USE_SPI_GNSS) && (HAS_ETHERNET))
         return;
@@ -353,26 +353,14 @@ void DevUBLOXGNSS::processRTCM(uint8_t incoming)
             rtcmPacketsSent = 1; // Trim to three digits to avoid log icon and increasing bar
     }
 
-    // Determine if we should check this byte with the RTCM checker or simply pass it along
-    bool passAlongIncomingByte = true;
-
-    if (settings.enableRtcmMessageChecking == true)
-        passAlongIncomingByte &= checkRtcmMessage(incoming);
-
-    // Give this byte to the various possible transmission methods
-    if (passAlongIncomingByte)
-    {
-        rtcmLastReceived = millis();
-        rtcmBytesSent++;
-
-        for (int serverIndex = 0; serverIndex < NTRIP_SERVER_MAX; serverIndex++)
-            ntripServerProcessRTCM(serverIndex, incoming);
-
-        espnowProcessRTCM(incoming);
-    }
+    // Add this byte to the RTCM frame, the complete messages are passed to the
+    // various possible transmission methods by rtcmFlushFrames
+    rtcmLastReceived = millis();
+    rtcmBytesSent++;
+    rtcmFrameAddByte(incoming);
 }
 
-// For Ref Stn (USE_SPI_GNSS and HAS_ETHERNET), call ntripServerProcessRTCM manually if there is RTCM data in the buffer
+// For Ref Stn (USE_SPI_GNSS and HAS_ETHERNET), call ntripServerSendRTCM manually if there is RTCM data in the buffer
 void processRTCMBuffer()
 {
     if ((USE_I2C_GNSS) || (!HAS_ETHERNET))
@@ -396,22 +384,99 @@ void processRTCMBuffer()
 
         while (rtcmBytesAvail > 0)
         {
-            uint8_t incoming;
-
-            if (theGNSS.extractRTCMBufferData(&incoming, 1) != 1)
-                return;
+            uint8_t incoming[64];
+            uint16_t bytesToRead;
 
-            rtcmBytesAvail--;
+            // Read a block of data from the RTCM buffer
+            bytesToRead = rtcmBytesAvail;
+            if (bytesToRead > sizeof(incoming))
+                bytesToRead = sizeof(incoming);
+            if (theGNSS.extractRTCMBufferData(incoming, bytesToRead) != bytesToRead)
+                break;
 
-            // Data in the u-blox library RTCM buffer is pre-checked. We don't need to check it again here.
+            rtcmBytesAvail -= bytesToRead;
 
             rtcmLastReceived = millis();
-            rtcmBytesSent++;
-
-            for (int serverIndex = 0; serverIndex < NTRIP_SERVER_MAX; serverIndex++)
-                ntripServerProcessRTCM(serverIndex, incoming);
+            rtcmBytesSent += bytesToRead;
 
-            espnowProcessRTCM(incoming);
+            for (int index = 0; index < bytesToRead; index++)
+                rtcmFrameAddByte(incoming[index]);
         }
+
+        // Send the complete messages
+        rtcmFlushFrames();
+    }
+}
+
+// Add a byte to the RTCM frame buffer, locating the end of each RTCM message
+void rtcmFrameAddByte(uint8_t incoming)
+{
+    uint16_t messageBytes;
+
+    rtcmFrameBuffer[rtcmFrameBytes++] = incoming;
+    messageBytes = rtcmFrameBytes - rtcmFrameComplete;
+
+    // Discard any data that is not framed by an RTCM preamble byte
+    if ((messageBytes == 1) && (incoming != 0xd3))
+    {
+        rtcmFramingErrors++;
+        rtcmFrameBytes = rtcmFrameComplete;
+    }
+
+    // Verify the length byte - check the 6 MS bits are all zero
+    else if ((messageBytes == 2) && (incoming & (~3)))
+    {
+        rtcmFramingErrors += messageBytes;
+        rtcmFrameBytes = rtcmFrameComplete;
     }
+
+    // Compute the total message length: preamble, length, message and CRC
+    else if (messageBytes == 3)
+        rtcmFrameLength = rtcmMessageLength(&rtcmFrameBuffer[rtcmFrameComplete], messageBytes);
+
+    // Determine if the message is complete
+    else if ((messageBytes > 3) && (messageBytes >= rtcmFrameLength))
+    {
+        // Verify the CRC, discarding the message if the check fails
+        if (checkRtcmMessage(&rtcmFrameBuffer[rtcmFrameComplete], messageBytes))
+            rtcmFrameComplete = rtcmFrameBytes;
+        else
+            rtcmFrameBytes = rtcmFrameComplete;
+    }
+
+    // Send the complete messages when the buffer is full
+    if (rtcmFrameBytes >= sizeof(rtcmFrameBuffer))
+    {
+        rtcmFlushFrames();
+
+        // Discard the partial message if it fills the buffer
+        if (rtcmFrameBytes >= sizeof(rtcmFrameBuffer))
+            rtcmFrameBytes = 0;
+    }
+}
+
+// Pass the complete RTCM messages to the NTRIP servers, the NTRIP caster and
+// ESP-NOW with a single call, the partial message remains in the buffer
+void rtcmFlushFrames()
+{
+    if (rtcmFrameComplete == 0)
+        return;
+
+    bool displayed = false;
+    for (int serverIndex = 0; serverIndex < NTRIP_SERVER_MAX; serverIndex++)
+        displayed |= ntripServerSendRTCM(serverIndex, rtcmFrameBuffer, rtcmFrameComplete);
+
+    // Clear the periodic display after all servers are displayed
+    if (displayed && PERIODIC_DISPLAY(PD_NTRIP_SERVER_DATA))
+        PERIODIC_CLEAR(PD_NTRIP_SERVER_DATA);
+
+    ntripCasterSendRTCM(rtcmFrameBuffer, rtcmFrameComplete);
+
+    espnowProcessRTCM(rtcmFrameBuffer, rtcmFrameComplete);
+
+    // Move the partial message to the beginning of the buffer
+    rtcmFrameBytes -= rtcmFrameComplete;
+    if (rtcmFrameBytes)
+        memmove(rtcmFrameBuffer, &rtcmFrameBuffer[rtcmFrameComplete], rtcmFrameBytes);
+    rtcmFrameComplete = 0;
 }
@@ -524,7 +524,11 @@ void beginSD()
         // Load firmware file from the microSD card if it is present
         scanForFirmware();
 
+        // Index the files in the root directory
+        sdDirectoryBuild();
+
         // Mark card not yet usable for logging
+        sdFreeSpaceReset();
         sdCardSize = 0;
         outOfSDSpace = true;
 
@@ -555,6 +559,9 @@ void endSD(bool alreadyHaveSemaphore, bool releaseSemaphore)
 
         online.microSD = false;
         systemPrintln("microSD: Offline");
+
+        // Done with the directory index
+        sdDirectoryFree();
     }
 
     // Free the caches for the microSD card
@@ -610,23 +617,34 @@ void resetSPI()
 void beginUART2()
 {
     size_t length;
+    RING_BUFFER_OFFSET *offsetArray;
+    uint16_t offsetEntries;
+    uint8_t *filterArray;
+    uint8_t *priorityArray;
 
     // Determine the length of data to be retained in the ring buffer
     // after discarding the oldest data
     length = settings.gnssHandlerBufferSize;
-    rbOffsetEntries = (length >> 1) / AVERAGE_SENTENCE_LENGTH_IN_BYTES;
-    length = settings.gnssHandlerBufferSize + (rbOffsetEntries * sizeof(RING_BUFFER_OFFSET));
-    ringBuffer = nullptr;
-    rbOffsetArray = (RING_BUFFER_OFFSET *)malloc(length);
-    if (!rbOffsetArray)
-    {
-        rbOffsetEntries = 0;
+    offsetEntries = (length >> 1) / AVERAGE_SENTENCE_LENGTH_IN_BYTES;
+    // Allocate PARSE_BUFFER_LENGTH additional bytes at the end of the ring
+    // buffer, the GNSS messages are parsed directly into the ring buffer and
+    // a message is not split while it is being parsed
+    length = settings.gnssHandlerBufferSize + PARSE_BUFFER_LENGTH +
+             (offsetEntries * (sizeof(RING_BUFFER_OFFSET) + (2 * sizeof(uint8_t))));
+    offsetArray = (RING_BUFFER_OFFSET *)malloc(length);
+    if (!offsetArray)
         systemPrintln("ERROR: Failed to allocate the ring buffer!");
-    }
     else
     {
-        ringBuffer = (uint8_t *)&rbOffsetArray[rbOffsetEntries];
-        rbOffsetArray[0] = 0;
+        priorityArray = (uint8_t *)&offsetArray[offsetEntries];
+        filterArray = &priorityArray[offsetEntries];
+        ringBufferInit(&gnssRingBuffer, &filterArray[offsetEntries], settings.gnssHandlerBufferSize, offsetArray,
+                       priorityArray, filterArray, offsetEntries, AMOUNT_OF_RING_BUFFER_DATA_TO_DISCARD);
+        ringBufferReserves(&gnssRingBuffer, settings.enableRingBufferReserves);
+
+        // Add the Bluetooth, SD card and network consumers to the ring buffer
+        tasksRegisterConsumers();
+
         if (pinUART2TaskHandle == nullptr)
             xTaskCreatePinnedToCore(
                 pinUART2Task,
@@ -0,0 +1,120 @@
+/*------------------------------------------------------------------------------
+CorrectionArbiter.h
+
+  Constant, type and routine declarations for the correction source arbiter
+  which selects the RTCM stream passed to the GNSS.  The routines in
+  CorrectionArbiter.ino do not depend upon the Arduino environment and are
+  also built by the programs in the Tools directory.
+------------------------------------------------------------------------------*/
+
+#ifndef __CORRECTION_ARBITER_H__
+#define __CORRECTION_ARBITER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "RtcmStats.h"
+
+//----------------------------------------
+// Constants
+//----------------------------------------
+
+// RTCM correction sources received by the ESP32, the external radio and the
+// L-Band corrections are connected directly to the ZED and are only used as
+// the fallback when none of these sources is delivering complete epochs
+enum CORRECTION_SOURCE
+{
+    CORRECTION_SOURCE_NTRIP_CLIENT = 0, // NTRIP client using WiFi or Ethernet
+    CORRECTION_SOURCE_BLUETOOTH,        // NTRIP client on a phone or tablet
+    CORRECTION_SOURCE_ESPNOW,           // ESP-NOW link from a base
+    // Add new correction sources above this line
+    CORRECTION_SOURCE_MAX
+};
+
+#define CORRECTION_SOURCE_NONE 0xff // No correction source is selected
+
+#define CORRECTION_ARBITER_LATENCY_SHIFT 3 // Latency average weight: 1/8
+
+// Saved station messages, a 1005 is 25 bytes and a 1006 is 27 bytes, a 1033
+// with the longest descriptor strings is 170 bytes
+#define CORRECTION_ARBITER_STATION_BYTES    32
+#define CORRECTION_ARBITER_DESCRIPTOR_BYTES 176
+
+// Saved station messages passed to the GNSS when a source is selected
+enum CORRECTION_ARBITER_REPLAY
+{
+    CORRECTION_ARBITER_REPLAY_STATION = 0, // 1005 or 1006
+    CORRECTION_ARBITER_REPLAY_DESCRIPTOR,  // 1033
+    CORRECTION_ARBITER_REPLAY_DONE
+};
+
+//----------------------------------------
+// Types
+//----------------------------------------
+
+// State and statistics for a single correction source
+typedef struct _CORRECTION_SOURCE_STATE
+{
+    bool available;              // Source is connected
+    bool eligible;               // Source is delivering complete and timely epochs
+    bool epochOpen;              // Part of the current epoch has arrived
+    bool epochSeen;              // A complete epoch has arrived
+    bool stationSeen;            // A station position (1005 or 1006) has arrived
+    bool latencyKnown;           // latencyMsec is valid
+    uint32_t epochMsec;          // GPS time of day of the current epoch
+    uint32_t lastMessageMsec;    // Arrival time of the last RTCM message
+    uint32_t lastEpochMsec;      // Arrival time of the last complete epoch
+    uint32_t eligibleMsec;       // Time when the source became eligible
+    int32_t latencyMsec;         // Average latency of the observation messages
+    uint32_t messages;           // RTCM messages received
+    uint32_t bytes;              // Bytes received in the RTCM messages
+    uint32_t pushed;             // Messages passed to the GNSS
+    uint32_t discarded;          // Messages discarded while not selected
+    uint32_t epochsComplete;     // Epochs ending with the last observation message
+    uint32_t epochsIncomplete;   // Epochs missing the last observation message
+    uint16_t stationLength;      // Length of the saved 1005 or 1006, zero when none
+    uint16_t descriptorLength;   // Length of the saved 1033, zero when none
+    uint8_t station[CORRECTION_ARBITER_STATION_BYTES];       // Last 1005 or 1006
+    uint8_t descriptor[CORRECTION_ARBITER_DESCRIPTOR_BYTES]; // Last 1033
+} CORRECTION_SOURCE_STATE;
+
+// Correction source arbiter.  The caller sets the configuration values
+// before calling correctionArbiterUpdate.
+typedef struct _CORRECTION_ARBITER
+{
+    CORRECTION_SOURCE_STATE source[CORRECTION_SOURCE_MAX];
+
+    // Configuration
+    uint8_t priority[CORRECTION_SOURCE_MAX]; // Lower values are preferred
+    uint32_t timeoutMsec;        // Complete epoch age when a source becomes stale
+    uint32_t holdoffMsec;        // Time a preferred source is eligible before switching
+    uint32_t maxLatencyMsec;     // Largest average latency, zero for no limit
+    uint32_t fallbackMsec;       // Time after losing a source before the radio and L-Band are used
+
+    // Selection
+    uint8_t selected;            // Source passed to the GNSS, CORRECTION_SOURCE_NONE when none
+    uint8_t pending;             // Source selected at the start of its next epoch
+    uint8_t replay;              // Next saved station message to pass to the GNSS
+    bool fallback;               // The radio and L-Band corrections are enabled
+    bool lost;                   // A selected source became stale
+    bool epochPushed;            // lastPushedEpochMsec is valid
+    uint32_t lastPushedEpochMsec; // GPS time of day of the last epoch passed to the GNSS
+    uint32_t lostMsec;           // Time when the selected source became stale
+    uint32_t selectedMsec;       // Time of the last selection change
+    uint32_t switches;           // Number of selection changes
+} CORRECTION_ARBITER;
+
+//----------------------------------------
+// Correction arbiter routines
+//----------------------------------------
+
+void correctionArbiterAvailable(CORRECTION_ARBITER *arbiter, uint8_t source, bool available);
+void correctionArbiterInit(CORRECTION_ARBITER *arbiter);
+bool correctionArbiterRtcm(CORRECTION_ARBITER *arbiter, uint8_t source, const uint8_t *message, uint16_t length,
+                           uint32_t arrivalMsec, int32_t gpsTowMsec, int leapSeconds);
+const char *correctionArbiterSourceName(uint8_t source);
+const uint8_t *correctionArbiterStation(CORRECTION_ARBITER *arbiter, uint16_t *length);
+uint8_t correctionArbiterUpdate(CORRECTION_ARBITER *arbiter, uint32_t currentMsec);
+
+#endif // __CORRECTION_ARBITER_H__
@@ -0,0 +1,333 @@
+/*------------------------------------------------------------------------------
+CorrectionArbiter.ino
+
+  Select the correction source passed to the GNSS.
+
+  The corrections may arrive from the NTRIP client, from a phone or tablet
+  over Bluetooth and from a base over ESP-NOW.  Each source frames its
+  stream with the GPS message parser and passes each complete RTCM message
+  with a valid CRC to correctionArbiterRtcm which returns true when the
+  message is to be pushed to the GNSS.  The GNSS only receives whole
+  messages from a single source, the messages from the other sources are
+  discarded.  The observation messages from two base stations are never
+  blended since the ZED would compute its solution against a mix of
+  reference positions.
+
+  For each source the arbiter tracks:
+
+    * Freshness: arrival time of the last complete epoch
+    * Completeness: an epoch is complete when the observation message with
+      the multiple message bit (synchronous GNSS flag in the legacy messages)
+      clear arrives, a new epoch starting before that counts as incomplete
+    * Latency: average difference between the arrival time and the epoch time
+    * Station position: a 1005 or 1006 message since the source connected
+
+  correctionArbiterUpdate is called periodically.  A source is eligible when
+  it is connected, has sent the station position, delivered a complete epoch
+  within timeoutMsec and its average latency is below maxLatencyMsec.  The
+  eligible source with the lowest priority value is preferred:
+
+    Selected source         Action
+    ---------------------   ------------------------------------------------
+    Stale                   Dropped immediately, the best eligible source
+                            becomes pending
+    Eligible                A preferred source becomes pending after it is
+                            eligible for holdoffMsec
+    None                    Best eligible source becomes pending, without
+                            one the radio and L-Band fallback is enabled
+                            fallbackMsec after the last source was lost
+
+  A pending source is selected when its next epoch starts, the selected
+  source is between epochs and the epoch is newer than the last epoch passed
+  to the GNSS.  The selected source stops at the start of its next epoch
+  once a switch is pending.  This switches the GNSS between complete epochs.
+
+  The last 1005 or 1006 and the last 1033 from each source are saved.  After
+  correctionArbiterRtcm selects a source, correctionArbiterStation returns
+  the saved messages which the caller passes to the GNSS ahead of the first
+  epoch.  The GNSS then has the position of the new base before its
+  observations arrive, instead of using the previous base's position until
+  the next 1005 or 1006.
+
+  The external radio and the L-Band corrections are connected directly to
+  the ZED.  The ESP32 does not see this data and only enables these inputs
+  as the fallback when none of the sources above are selected.
+------------------------------------------------------------------------------*/
+
+//----------------------------------------
+// Locals
+//----------------------------------------
+
+static const char *const correctionArbiterSourceNames[] = {
+    "NTRIP_Client",
+    "Bluetooth",
+    "ESPNOW",
+};
+
+//----------------------------------------
+// Support routines
+//----------------------------------------
+
+// Determine if the epoch time of day follows the previous epoch time of day
+static bool correctionArbiterNewer(uint32_t epochMsec, uint32_t previousMsec)
+{
+    uint32_t delta;
+
+    delta = (epochMsec + RTCM_STATS_MS_PER_DAY - previousMsec) % RTCM_STATS_MS_PER_DAY;
+    return delta && (delta < (RTCM_STATS_MS_PER_DAY / 2));
+}
+
+// Change the selected source
+static void correctionArbiterSelect(CORRECTION_ARBITER *arbiter, uint8_t source, uint32_t currentMsec)
+{
+    if (arbiter->selected != source)
+    {
+        arbiter->switches += 1;
+        arbiter->selectedMsec = currentMsec;
+    }
+    arbiter->selected = source;
+    arbiter->pending = CORRECTION_SOURCE_NONE;
+    if (source != CORRECTION_SOURCE_NONE)
+    {
+        arbiter->replay = CORRECTION_ARBITER_REPLAY_STATION;
+        arbiter->fallback = false;
+        arbiter->lost = false;
+    }
+}
+
+//----------------------------------------
+// Correction arbiter routines
+//----------------------------------------
+
+// Set the connection state of the source, the measurements are discarded
+// when the source connects or disconnects
+void correctionArbiterAvailable(CORRECTION_ARBITER *arbiter, uint8_t source, bool available)
+{
+    CORRECTION_SOURCE_STATE *state;
+
+    state = &arbiter->source[source];
+    if (state->available != available)
+    {
+        state->available = available;
+        state->eligible = false;
+        state->epochOpen = false;
+        state->epochSeen = false;
+        state->stationSeen = false;
+        state->latencyKnown = false;
+        state->stationLength = 0;
+        state->descriptorLength = 0;
+    }
+}
+
+// Initialize the arbiter, the sources are preferred in enum order
+void correctionArbiterInit(CORRECTION_ARBITER *arbiter)
+{
+    int source;
+
+    memset(arbiter, 0, sizeof(*arbiter));
+    for (source = 0; source < CORRECTION_SOURCE_MAX; source++)
+        arbiter->priority[source] = source;
+    arbiter->selected = CORRECTION_SOURCE_NONE;
+    arbiter->pending = CORRECTION_SOURCE_NONE;
+    arbiter->replay = CORRECTION_ARBITER_REPLAY_DONE;
+    arbiter->fallback = true;
+}
+
+// Account for a complete RTCM message from the source, gpsTowMsec is the GPS
+// time of week or RTCM_STATS_NO_TIME when the time is not known.  Returns
+// true when the message is to be passed to the GNSS.
+bool correctionArbiterRtcm(CORRECTION_ARBITER *arbiter, uint8_t source, const uint8_t *message, uint16_t length,
+                           uint32_t arrivalMsec, int32_t gpsTowMsec, int leapSeconds)
+{
+    bool epochStart;
+    uint32_t epochMsec;
+    int32_t latency;
+    uint16_t messageNumber;
+    uint32_t period;
+    bool push;
+    CORRECTION_SOURCE_STATE *state;
+
+    state = &arbiter->source[source];
+    state->messages += 1;
+    state->bytes += length;
+    state->lastMessageMsec = arrivalMsec;
+
+    // The station position is required for an RTK solution, save the
+    // station messages to pass to the GNSS when this source is selected
+    messageNumber = rtcmStatsMessageNumber(message, length);
+    if ((messageNumber == 1005) || (messageNumber == 1006))
+    {
+        state->stationSeen = true;
+        if (length <= sizeof(state->station))
+        {
+            memcpy(state->station, message, length);
+            state->stationLength = length;
+        }
+    }
+    else if ((messageNumber == 1033) && (length <= sizeof(state->descriptor)))
+    {
+        memcpy(state->descriptor, message, length);
+        state->descriptorLength = length;
+    }
+
+    // Compare the epochs using the time of day since the GLONASS legacy
+    // messages do not include the day of week
+    epochStart = false;
+    period = rtcmStatsEpoch(message, length, leapSeconds, &epochMsec);
+    if (period)
+    {
+        epochMsec %= RTCM_STATS_MS_PER_DAY;
+        if ((!state->epochOpen) || (epochMsec != state->epochMsec))
+        {
+            if (state->epochOpen)
+                state->epochsIncomplete += 1;
+            state->epochOpen = true;
+            state->epochMsec = epochMsec;
+            epochStart = true;
+        }
+
+        // Update the average latency
+        if (gpsTowMsec != RTCM_STATS_NO_TIME)
+        {
+            latency = rtcmStatsLatency(gpsTowMsec, epochMsec, RTCM_STATS_MS_PER_DAY);
+            if (state->latencyKnown)
+                state->latencyMsec += (latency - state->latencyMsec) / (1 << CORRECTION_ARBITER_LATENCY_SHIFT);
+            else
+                state->latencyMsec = latency;
+            state->latencyKnown = true;
+        }
+    }
+
+    // Stop the selected source at the start of its next epoch when a switch is
+    // pending, a pending source with a larger latency never delivers an epoch
+    // newer than the selected source
+    if ((source == arbiter->selected) && epochStart && (arbiter->pending != CORRECTION_SOURCE_NONE))
+        arbiter->selected = CORRECTION_SOURCE_NONE;
+
+    // Switch to the pending source between epochs
+    if ((source == arbiter->pending) && epochStart
+        && ((arbiter->selected == CORRECTION_SOURCE_NONE) || (!arbiter->source[arbiter->selected].epochOpen))
+        && ((!arbiter->epochPushed) || correctionArbiterNewer(epochMsec, arbiter->lastPushedEpochMsec)))
+        correctionArbiterSelect(arbiter, source, arrivalMsec);
+
+    // Only pass the messages from the selected source to the GNSS
+    push = (source == arbiter->selected);
+    if (push)
+    {
+        state->pushed += 1;
+        if (period)
+        {
+            arbiter->epochPushed = true;
+            arbiter->lastPushedEpochMsec = epochMsec;
+        }
+    }
+    else
+        state->discarded += 1;
+
+    // Determine if the epoch is complete
+    if (period && (!rtcmStatsMoreMessages(message, length)))
+    {
+        state->epochOpen = false;
+        state->epochSeen = true;
+        state->lastEpochMsec = arrivalMsec;
+        state->epochsComplete += 1;
+    }
+    return push;
+}
+
+// Get the name of the correction source
+const char *correctionArbiterSourceName(uint8_t source)
+{
+    if (source < CORRECTION_SOURCE_MAX)
+        return correctionArbiterSourceNames[source];
+    return "None";
+}
+
+// Get the next saved station message of the newly selected source, returns
+// NULL when all of the messages were returned.  Called after
+// correctionArbiterRtcm returns true and before the message is passed to the
+// GNSS.
+const uint8_t *correctionArbiterStation(CORRECTION_ARBITER *arbiter, uint16_t *length)
+{
+    CORRECTION_SOURCE_STATE *state;
+
+    if (arbiter->selected == CORRECTION_SOURCE_NONE)
+        return NULL;
+    state = &arbiter->source[arbiter->selected];
+    while (arbiter->replay < CORRECTION_ARBITER_REPLAY_DONE)
+    {
+        switch (arbiter->replay++)
+        {
+        case CORRECTION_ARBITER_REPLAY_STATION:
+            if (state->stationLength)
+            {
+                state->pushed += 1;
+                *length = state->stationLength;
+                return state->station;
+            }
+            break;
+
+        case CORRECTION_ARBITER_REPLAY_DESCRIPTOR:
+            if (state->descriptorLength)
+            {
+                state->pushed += 1;
+                *length = state->descriptorLength;
+                return state->descriptor;
+            }
+            break;
+        }
+    }
+    return NULL;
+}
+
+// Evaluate the sources and update the selection, returns the selected source
+uint8_t correctionArbiterUpdate(CORRECTION_ARBITER *arbiter, uint32_t currentMsec)
+{
+    uint8_t best;
+    bool eligible;
+    uint8_t source;
+    CORRECTION_SOURCE_STATE *state;
+
+    // Locate the preferred eligible source
+    best = CORRECTION_SOURCE_NONE;
+    for (source = 0; source < CORRECTION_SOURCE_MAX; source++)
+    {
+        state = &arbiter->source[source];
+        eligible = state->available && state->epochSeen && state->stationSeen
+                   && ((currentMsec - state->lastEpochMsec) <= arbiter->timeoutMsec)
+                   && ((!arbiter->maxLatencyMsec) || (!state->latencyKnown)
+                       || (state->latencyMsec <= (int32_t)arbiter->maxLatencyMsec));
+        if (eligible && (!state->eligible))
+            state->eligibleMsec = currentMsec;
+        state->eligible = eligible;
+        if (eligible && ((best == CORRECTION_SOURCE_NONE) || (arbiter->priority[source] < arbiter->priority[best])))
+            best = source;
+    }
+
+    // Drop a stale source immediately
+    if ((arbiter->selected != CORRECTION_SOURCE_NONE) && (!arbiter->source[arbiter->selected].eligible))
+    {
+        correctionArbiterSelect(arbiter, CORRECTION_SOURCE_NONE, currentMsec);
+        arbiter->lost = true;
+        arbiter->lostMsec = currentMsec;
+    }
+
+    if (arbiter->selected != CORRECTION_SOURCE_NONE)
+    {
+        // Switch to a preferred source once it has been eligible long enough
+        if ((best != arbiter->selected) && (arbiter->priority[best] < arbiter->priority[arbiter->selected])
+            && ((currentMsec - arbiter->source[best].eligibleMsec) >= arbiter->holdoffMsec))
+            arbiter->pending = best;
+        else
+            arbiter->pending = CORRECTION_SOURCE_NONE;
+    }
+    else
+    {
+        // Use the best source at its next epoch, without one enable the
+        // radio and L-Band corrections after the fallback delay
+        arbiter->pending = best;
+        if (best == CORRECTION_SOURCE_NONE)
+            arbiter->fallback = (!arbiter->lost) || ((currentMsec - arbiter->lostMsec) >= arbiter->fallbackMsec);
+    }
+    return arbiter->selected;
+}
@@ -0,0 +1,432 @@
+/*------------------------------------------------------------------------------
+Corrections.ino
+
+  Pass the correction data from a single source to the ZED.
+
+  The RTCM corrections arrive from several sources, each in its own context:
+
+    Source          Context                    Framing
+    -------------   ------------------------   ----------------------------
+    NTRIP client    ntripClientReadTask        NtripClient.ino parser
+    Bluetooth       btReadTask                 correctionsBluetoothParse
+    ESP-NOW         loop (correctionsUpdate)   correctionsEspnowParse
+    Radio           ZED UART2                  Not seen by the ESP32
+    L-Band          loop (updateLBand)         UBX-RXM-PMP from the NEO-D9S
+
+  Each RTCM message with a valid CRC is passed to correctionsPushRtcm which
+  holds the corrections semaphore while the correction arbiter (see
+  CorrectionArbiter.ino) decides if the message is pushed to the ZED and
+  while the message is pushed.  The ZED only receives complete messages
+  from the selected source, so the frames from two sources are never
+  interleaved.  The saved 1005 / 1006 and 1033 messages of a newly
+  selected source are pushed ahead of its first epoch.  correctionsUpdate
+  runs from loop to update the selection and to enable the external radio
+  input on the ZED UART2 and the L-Band corrections only when no other
+  source is selected.
+
+  The ESP-NOW receive callback runs in the WiFi task and must not block on
+  the semaphore or the I2C / SPI push, it only copies the data into
+  correctionsEspnowStream.  correctionsUpdate frames the queued data.
+------------------------------------------------------------------------------*/
+
+//----------------------------------------
+// Constants
+//----------------------------------------
+
+static const int CORRECTIONS_PUSH_ATTEMPTS = 5;
+static const uint32_t CORRECTIONS_SEMAPHORE_MSEC = 50;
+
+// ESP-NOW data queued between loop calls, 250 byte packets at the radio rate
+static const size_t CORRECTIONS_ESPNOW_STREAM_SIZE = 4096;
+
+// Seconds from the start of 1970 to the start of GPS time, 6 January 1980
+static const uint32_t CORRECTIONS_GPS_EPOCH = 315964800;
+
+//----------------------------------------
+// Locals
+//----------------------------------------
+
+static CORRECTION_ARBITER correctionsArbiter;
+static PARSE_STATE correctionsBluetoothParse = {gpsMessageParserFirstByte, correctionsBluetoothMessage, "Bluetooth"};
+static PARSE_STATE correctionsEspnowParse = {gpsMessageParserFirstByte, correctionsEspnowMessage, "ESP-NOW"};
+static StreamBufferHandle_t correctionsEspnowStream; // ESP-NOW data from the WiFi task
+static volatile uint32_t correctionsEspnowOverruns;  // ESP-NOW bytes dropped when the stream is full
+static uint32_t correctionsPushFailures;       // Messages not accepted by the GNSS
+static bool correctionsRadioEnabled = true;    // ZED UART2 RTCM input state
+static uint8_t correctionsSelected = CORRECTION_SOURCE_NONE; // Last displayed selection
+
+//----------------------------------------
+// Corrections support routines
+//----------------------------------------
+
+// Get the semaphore protecting the arbiter and the pushes to the GNSS
+SemaphoreHandle_t correctionsSemaphore()
+{
+    static SemaphoreHandle_t reentrant = xSemaphoreCreateMutex(); // Create the mutex
+
+    return reentrant;
+}
+
+// Push data to the GNSS over I2C / SPI, the GNSS library rejects the data
+// while a command is in progress.  Must be called with the semaphore held.
+bool correctionsPushGnss(const uint8_t *data, uint16_t length)
+{
+    int attempt;
+
+    for (attempt = 1; !theGNSS.pushRawData((uint8_t *)data, length); attempt++)
+    {
+        if (attempt >= CORRECTIONS_PUSH_ATTEMPTS)
+        {
+            correctionsPushFailures++;
+            return false;
+        }
+        delay(1);
+    }
+
+    if (PERIODIC_DISPLAY(PD_ZED_DATA_TX))
+    {
+        PERIODIC_CLEAR(PD_ZED_DATA_TX);
+        systemPrintf("ZED TX: Sending %d bytes\r\n", length);
+    }
+    return true;
+}
+
+//----------------------------------------
+// Corrections routines
+//----------------------------------------
+
+// Initialize the correction source selection, called before configureGNSS
+void correctionsBegin()
+{
+    correctionArbiterInit(&correctionsArbiter);
+
+    // Allocate the parse buffers
+    correctionsBluetoothParse.buffer = (uint8_t *)malloc(PARSE_BUFFER_LENGTH);
+    correctionsEspnowParse.buffer = (uint8_t *)malloc(PARSE_BUFFER_LENGTH);
+    correctionsEspnowStream = xStreamBufferCreate(CORRECTIONS_ESPNOW_STREAM_SIZE, 1);
+    if ((!correctionsBluetoothParse.buffer) || (!correctionsEspnowParse.buffer) || (!correctionsEspnowStream))
+        systemPrintln("ERROR: Failed to allocate the correction parse buffers!");
+}
+
+// Frame the data received from the phone or tablet over Bluetooth
+void correctionsBluetoothData(const uint8_t *data, int length)
+{
+    if (correctionsBluetoothParse.buffer)
+        gpsMessageParserProcessBuffer(&correctionsBluetoothParse, data, length);
+}
+
+// Pass the messages from the phone or tablet to the GNSS, only the RTCM
+// messages are arbitrated
+void correctionsBluetoothMessage(PARSE_STATE *parse, uint8_t type)
+{
+    if (type == SENTENCE_TYPE_RTCM)
+    {
+        correctionsPushRtcm(CORRECTION_SOURCE_BLUETOOTH, parse->buffer, parse->length);
+        bluetoothIncomingRTCM = true;
+    }
+
+    // Pass the UBX configuration messages to the GNSS
+    else if (xSemaphoreTake(correctionsSemaphore(), CORRECTIONS_SEMAPHORE_MSEC / portTICK_PERIOD_MS) == pdPASS)
+    {
+        correctionsPushGnss(parse->buffer, parse->length);
+        xSemaphoreGive(correctionsSemaphore());
+    }
+}
+
+// Queue the data received over ESP-NOW, called from the WiFi task which must
+// not block
+void correctionsEspnowData(const uint8_t *data, int length)
+{
+    size_t bytesQueued;
+
+    if (!correctionsEspnowStream)
+        return;
+    bytesQueued = xStreamBufferSend(correctionsEspnowStream, data, length, 0);
+    if (bytesQueued < (size_t)length)
+        correctionsEspnowOverruns += length - bytesQueued;
+}
+
+// Frame the data queued by correctionsEspnowData, called from loop
+void correctionsEspnowService()
+{
+    size_t bytesRead;
+    uint8_t data[256];
+
+    if ((!correctionsEspnowStream) || (!correctionsEspnowParse.buffer))
+        return;
+    while ((bytesRead = xStreamBufferReceive(correctionsEspnowStream, data, sizeof(data), 0)) > 0)
+        gpsMessageParserProcessBuffer(&correctionsEspnowParse, data, bytesRead);
+}
+
+// Pass the RTCM messages received over ESP-NOW to the arbiter
+void correctionsEspnowMessage(PARSE_STATE *parse, uint8_t type)
+{
+    if (type == SENTENCE_TYPE_RTCM)
+        correctionsPushRtcm(CORRECTION_SOURCE_ESPNOW, parse->buffer, parse->length);
+}
+
+// Determine if the radio and L-Band corrections are enabled
+bool correctionsFallback()
+{
+    return correctionsArbiter.fallback;
+}
+
+// Get the GPS time of week in milliseconds from the RTC, returns
+// RTCM_STATS_NO_TIME when the RTC is not set
+int32_t correctionsGpsTow()
+{
+    struct timeval tv;
+    int64_t seconds;
+
+    if (!online.rtc)
+        return RTCM_STATS_NO_TIME;
+
+    // The RTC is set to local time, convert it to GPS time
+    gettimeofday(&tv, nullptr);
+    seconds = (int64_t)tv.tv_sec - CORRECTIONS_GPS_EPOCH;
+    seconds -= settings.timeZoneSeconds + (settings.timeZoneMinutes * 60) + (settings.timeZoneHours * 60 * 60);
+    seconds += leapSeconds ? leapSeconds : LOG_INDEX_DEFAULT_LEAP_SECONDS;
+    return (int32_t)((seconds % (RTCM_STATS_MS_PER_WEEK / 1000)) * 1000 + (tv.tv_usec / 1000));
+}
+
+// Display the correction sources
+void correctionsPrintStatus()
+{
+    CORRECTION_ARBITER arbiter;
+    uint32_t currentMsec;
+    CORRECTION_SOURCE_STATE *state;
+    int source;
+
+    // Get a copy of the arbiter state
+    if (xSemaphoreTake(correctionsSemaphore(), CORRECTIONS_SEMAPHORE_MSEC / portTICK_PERIOD_MS) != pdPASS)
+        return;
+    arbiter = correctionsArbiter;
+    xSemaphoreGive(correctionsSemaphore());
+    currentMsec = millis();
+
+    systemPrintf("Corrections: %s", correctionArbiterSourceName(arbiter.selected));
+    if (arbiter.pending != CORRECTION_SOURCE_NONE)
+        systemPrintf(", switching to %s", correctionArbiterSourceName(arbiter.pending));
+    systemPrintf(", radio %s, L-Band %s, %d switches, %d not pushed, %d ESP-NOW bytes dropped\r\n",
+                 (settings.radioType == RADIO_EXTERNAL) ? (correctionsRadioEnabled ? "enabled" : "disabled") : "off",
+                 online.lbandCorrections ? (lBandCommunicationEnabled ? "enabled" : "disabled") : "off",
+                 arbiter.switches, correctionsPushFailures, correctionsEspnowOverruns);
+    systemPrintln("    Source        Priority  State      Epoch Age  Latency  Messages  Pushed  Complete  Incomplete");
+    for (source = 0; source < CORRECTION_SOURCE_MAX; source++)
+    {
+        state = &arbiter.source[source];
+        systemPrintf("    %-12s  %8d  %-9s", correctionArbiterSourceName(source), arbiter.priority[source],
+                     state->eligible ? "Eligible" : (state->available ? "Connected" : "Off"));
+        if (state->epochSeen)
+            systemPrintf("  %6d ms", currentMsec - state->lastEpochMsec);
+        else
+            systemPrint("          -");
+        if (state->latencyKnown)
+            systemPrintf("  %4d ms", state->latencyMsec);
+        else
+            systemPrint("        -");
+        systemPrintf("  %8d  %6d  %8d  %10d\r\n", state->messages, state->pushed, state->epochsComplete,
+                     state->epochsIncomplete);
+    }
+}
+
+// Pass the RTCM message to the arbiter and push it to the GNSS when the source
+// is selected.  Returns true when the message was pushed to the GNSS.
+bool correctionsPushRtcm(uint8_t source, const uint8_t *message, uint16_t length)
+{
+    uint32_t arrivalMsec;
+    int32_t gpsTowMsec;
+    int leap;
+    bool pushed;
+    const uint8_t *station;
+    uint16_t stationLength;
+
+    arrivalMsec = millis();
+    gpsTowMsec = correctionsGpsTow();
+    leap = leapSeconds ? leapSeconds : LOG_INDEX_DEFAULT_LEAP_SECONDS;
+
+    // Hold the semaphore until the complete message is pushed
+    if (xSemaphoreTake(correctionsSemaphore(), CORRECTIONS_SEMAPHORE_MSEC / portTICK_PERIOD_MS) != pdPASS)
+    {
+        correctionsPushFailures++;
+        return false;
+    }
+    pushed = correctionArbiterRtcm(&correctionsArbiter, source, message, length, arrivalMsec, gpsTowMsec, leap);
+    if (pushed)
+    {
+        // Give the GNSS the station position of a newly selected source
+        // before its first epoch
+        while ((station = correctionArbiterStation(&correctionsArbiter, &stationLength)))
+            correctionsPushGnss(station, stationLength);
+        pushed = correctionsPushGnss(message, length);
+    }
+    xSemaphoreGive(correctionsSemaphore());
+    return pushed;
+}
+
+// Update the correction source selection, called from loop
+void correctionsUpdate()
+{
+    bool fallback;
+    uint8_t pending;
+    uint8_t selected;
+    int source;
+
+    // Frame the ESP-NOW data received since the last call
+    correctionsEspnowService();
+
+    if (xSemaphoreTake(correctionsSemaphore(), CORRECTIONS_SEMAPHORE_MSEC / portTICK_PERIOD_MS) != pdPASS)
+        return;
+
+    // Update the source connection states
+    correctionArbiterAvailable(&correctionsArbiter, CORRECTION_SOURCE_NTRIP_CLIENT, ntripClientIsConnected());
+    correctionArbiterAvailable(&correctionsArbiter, CORRECTION_SOURCE_BLUETOOTH, bluetoothGetState() == BT_CONNECTED);
+    correctionArbiterAvailable(&correctionsArbiter, CORRECTION_SOURCE_ESPNOW, espnowState == ESPNOW_PAIRED);
+
+    // Apply any settings changes
+    for (source = 0; source < CORRECTION_SOURCE_MAX; source++)
+        correctionsArbiter.priority[source] = settings.correctionsSourcePriority[source];
+    correctionsArbiter.timeoutMsec = settings.correctionsSourceTimeout_ms;
+    correctionsArbiter.holdoffMsec = settings.correctionsSwitchHoldoff_ms;
+    correctionsArbiter.maxLatencyMsec = settings.correctionsMaxLatency_ms;
+    correctionsArbiter.fallbackMsec = settings.rtcmTimeoutBeforeUsingLBand_s * 1000;
+
+    // Update the selection
+    selected = correctionArbiterUpdate(&correctionsArbiter, millis());
+    pending = correctionsArbiter.pending;
+    fallback = correctionsArbiter.fallback;
+    xSemaphoreGive(correctionsSemaphore());
+
+    // Display the selection changes, the switch to a pending source occurs
+    // at the start of its next epoch in correctionsPushRtcm
+    if (selected != correctionsSelected)
+    {
+        correctionsSelected = selected;
+        if (settings.debugCorrections && (!inMainMenu))
+            systemPrintf("Corrections: %s selected\r\n", correctionArbiterSourceName(selected));
+    }
+
+    // Only accept RTCM from the external radio when no other source is
+    // selected, the ZED would otherwise receive two correction streams.
+    // configureGNSS and menuPorts set the input using correctionsFallback.
+    if (fallback != correctionsRadioEnabled)
+    {
+        if (settings.radioType != RADIO_EXTERNAL)
+            correctionsRadioEnabled = fallback;
+        else if (online.gnss && theGNSS.setVal8(UBLOX_CFG_UART2INPROT_RTCM3X, fallback))
+        {
+            correctionsRadioEnabled = fallback;
+            if (settings.debugCorrections && (!inMainMenu))
+                systemPrintf("Corrections: Radio input %s\r\n", fallback ? "enabled" : "disabled");
+        }
+    }
+
+    if (PERIODIC_DISPLAY(PD_CORRECTIONS_STATE))
+    {
+        PERIODIC_CLEAR(PD_CORRECTIONS_STATE);
+        systemPrintf("Corrections: %s selected, %s pending, fallback %s\r\n", correctionArbiterSourceName(selected),
+                     correctionArbiterSourceName(pending), fallback ? "enabled" : "disabled");
+    }
+}
+
+//----------------------------------------
+// Corrections menu
+//----------------------------------------
+
+void menuCorrections()
+{
+    int incoming;
+    int source;
+    int value;
+
+    while (true)
+    {
+        systemPrintln();
+        systemPrintln("Menu: Corrections");
+        systemPrintln();
+        systemPrintln("The RTCM corrections from the source with the lowest priority value are passed to the GNSS.");
+        systemPrintln("The radio and L-Band corrections are used when no other source is available.");
+        systemPrintln();
+
+        for (source = 0; source < CORRECTION_SOURCE_MAX; source++)
+            systemPrintf("%d) %s priority: %d\r\n", source + 1, correctionArbiterSourceName(source),
+                         settings.correctionsSourcePriority[source]);
+
+        systemPrintf("%d) Source timeout: %d ms\r\n", CORRECTION_SOURCE_MAX + 1, settings.correctionsSourceTimeout_ms);
+
+        systemPrintf("%d) Switch holdoff: %d ms\r\n", CORRECTION_SOURCE_MAX + 2, settings.correctionsSwitchHoldoff_ms);
+
+        systemPrintf("%d) Maximum latency: ", CORRECTION_SOURCE_MAX + 3);
+        if (settings.correctionsMaxLatency_ms)
+            systemPrintf("%d ms\r\n", settings.correctionsMaxLatency_ms);
+        else
+            systemPrintln("No limit");
+
+        systemPrintf("%d) Debug correction source selection: %s\r\n", CORRECTION_SOURCE_MAX + 4,
+                     settings.debugCorrections ? "Enabled" : "Disabled");
+
+        systemPrintln("x) Exit");
+
+        incoming = getNumber(); // Returns EXIT, TIMEOUT, or long
+
+        if ((incoming >= 1) && (incoming <= CORRECTION_SOURCE_MAX))
+        {
+            systemPrintf("Enter %s priority (0 to 9, 0 = highest): ", correctionArbiterSourceName(incoming - 1));
+            value = getNumber(); // Returns EXIT, TIMEOUT, or long
+            if ((value != INPUT_RESPONSE_GETNUMBER_EXIT) && (value != INPUT_RESPONSE_GETNUMBER_TIMEOUT))
+            {
+                if (value < 0 || value > 9)
+                    systemPrintln("Error: Priority out of range");
+                else
+                    settings.correctionsSourcePriority[incoming - 1] = value; // Recorded to NVM and file
+            }
+        }
+        else if (incoming == CORRECTION_SOURCE_MAX + 1)
+        {
+            systemPrint("Enter source timeout in milliseconds (1000 to 60000): ");
+            value = getNumber(); // Returns EXIT, TIMEOUT, or long
+            if ((value != INPUT_RESPONSE_GETNUMBER_EXIT) && (value != INPUT_RESPONSE_GETNUMBER_TIMEOUT))
+            {
+                if (value < 1000 || value > 60000)
+                    systemPrintln("Error: Timeout out of range");
+                else
+                    settings.correctionsSourceTimeout_ms = value; // Recorded to NVM and file
+            }
+        }
+        else if (incoming == CORRECTION_SOURCE_MAX + 2)
+        {
+            systemPrint("Enter switch holdoff in milliseconds (0 to 60000): ");
+            value = getNumber(); // Returns EXIT, TIMEOUT, or long
+            if ((value != INPUT_RESPONSE_GETNUMBER_EXIT) && (value != INPUT_RESPONSE_GETNUMBER_TIMEOUT))
+            {
+                if (value < 0 || value > 60000)
+                    systemPrintln("Error: Holdoff out of range");
+                else
+                    settings.correctionsSwitchHoldoff_ms = value; // Recorded to NVM and file
+            }
+        }
+        else if (incoming == CORRECTION_SOURCE_MAX + 3)
+        {
+            systemPrint("Enter maximum latency in milliseconds (0 to 60000, 0 = no limit): ");
+            value = getNumber(); // Returns EXIT, TIMEOUT, or long
+            if ((value != INPUT_RESPONSE_GETNUMBER_EXIT) && (value != INPUT_RESPONSE_GETNUMBER_TIMEOUT))
+            {
+                if (value < 0 || value > 60000)
+                    systemPrintln("Error: Latency out of range");
+                else
+                    settings.correctionsMaxLatency_ms = value; // Recorded to NVM and file
+            }
+        }
+        else if (incoming == CORRECTION_SOURCE_MAX + 4)
+            settings.debugCorrections ^= 1;
+
+        else if (incoming == INPUT_RESPONSE_GETNUMBER_EXIT)
+            break;
+        else if (incoming == INPUT_RESPONSE_GETNUMBER_TIMEOUT)
+            break;
+        else
+            printUnknown(incoming);
+    }
+
+    clearBuffer(); // Empty buffer of any newline chars
+}
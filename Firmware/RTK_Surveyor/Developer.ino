@@ -46,6 +46,14 @@ void networkUpdate() {}
 void networkVerifyTables() {}
 void networkStop(uint8_t networkType) {}
 
+//----------------------------------------
+// NTRIP caster
+//----------------------------------------
+
+void ntripCasterPrintStatus() {systemPrintln("NTRIP Caster not compiled");}
+void ntripCasterSendRTCM(const uint8_t *data, uint16_t length) {}
+void ntripCasterValidateTables() {}
+
 //----------------------------------------
 // NTRIP client
 //----------------------------------------
@@ -61,7 +69,7 @@ void ntripClientValidateTables() {}
 
 bool ntripServerIsCasting(int serverIndex) {return false;}
 void ntripServerPrintStatus(int serverIndex) {systemPrintf("**NTRIP Server %d not compiled**\r\n", serverIndex);}
-void ntripServerProcessRTCM(int serverIndex, uint8_t incoming) {}
+bool ntripServerSendRTCM(int serverIndex, const uint8_t *data, uint16_t length) {return false;}
 void ntripServerStop(int serverIndex, bool clientAllocated) {online.ntripServer[serverIndex] = false;}
 void ntripServerUpdate() {}
 void ntripServerValidateTables() {}
@@ -76,32 +84,27 @@ void otaVerifyTables() {}
 // PVT client
 //----------------------------------------
 
-int32_t pvtClientSendData(uint16_t dataHead) {return 0;}
+void pvtClientRegisterConsumer() {}
 void pvtClientUpdate() {}
 void pvtClientValidateTables() {}
-void pvtClientZeroTail() {}
-void discardPvtClientBytes(RING_BUFFER_OFFSET previousTail, RING_BUFFER_OFFSET newTail) {}
 
 //----------------------------------------
 // PVT UDP server
 //----------------------------------------
 
-int32_t pvtUdpServerSendData(uint16_t dataHead) {return 0;}
+void pvtUdpServerRegisterConsumer() {}
 void pvtUdpServerStop() {}
 void pvtUdpServerUpdate() {}
-void pvtUdpServerZeroTail() {}
-void discardPvtUdpServerBytes(RING_BUFFER_OFFSET previousTail, RING_BUFFER_OFFSET newTail) {}
 
 //----------------------------------------
 // PVT server
 //----------------------------------------
 
-int32_t pvtServerSendData(uint16_t dataHead) {return 0;}
+void pvtServerPrintStatus() {}
+void pvtServerRegisterConsumers() {}
 void pvtServerStop() {}
 void pvtServerUpdate() {}
-void pvtServerZeroTail() {}
 void pvtServerValidateTables() {}
-void discardPvtServerBytes(RING_BUFFER_OFFSET previousTail, RING_BUFFER_OFFSET newTail) {}
 
 #endif // COMPILE_NETWORK
 
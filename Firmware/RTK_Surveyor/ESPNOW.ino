@@ -62,13 +62,11 @@ void espnowOnDataReceived(const uint8_t *mac, const uint8_t *incomingData, int l
     {
         espnowRSSI = packetRSSI; // Record this packets RSSI as an ESP NOW packet
 
-        // Pass RTCM bytes (presumably) from ESP NOW out ESP32-UART2 to ZED-UART1 / SPI
-        if (USE_I2C_GNSS)
-            serialGNSS.write(incomingData, len);
-        else
-            theGNSS.pushRawData((uint8_t *)incomingData, len);
+        // Queue the RTCM bytes (presumably) for correctionsUpdate, the complete
+        // messages are pushed to the ZED when ESP-NOW is the selected correction source
+        correctionsEspnowData(incomingData, len);
         if (!inMainMenu)
-            log_d("ESPNOW received %d RTCM bytes, pushed to ZED, RSSI: %d", len, espnowRSSI);
+            log_d("ESPNOW received %d RTCM bytes, RSSI: %d", len, espnowRSSI);
 
         espnowIncomingRTCM = true;
         lastEspnowRssiUpdate = millis();
@@ -405,33 +403,43 @@ void espnowSetState(ESPNOWState newState)
     }
 }
 
-void espnowProcessRTCM(byte incoming)
+// Move the RTCM messages into the ESP NOW send buffer, sending each full packet
+void espnowProcessRTCM(const uint8_t *data, uint16_t length)
 {
 #ifdef COMPILE_ESPNOW
     if (espnowState == ESPNOW_PAIRED)
     {
-        // Move this byte into ESP NOW to send buffer
-        espnowOutgoing[espnowOutgoingSpot++] = incoming;
-        espnowLastAdd = millis();
-
-        if (espnowOutgoingSpot == sizeof(espnowOutgoing))
+        while (length > 0)
         {
-            espnowOutgoingSpot = 0; // Wrap
-
-            if (settings.espnowBroadcast == false)
-                esp_now_send(0, (uint8_t *)&espnowOutgoing, sizeof(espnowOutgoing)); // Send packet to all peers
-            else
+            // Move the data into ESP NOW to send buffer
+            uint16_t bytesToCopy = sizeof(espnowOutgoing) - espnowOutgoingSpot;
+            if (bytesToCopy > length)
+                bytesToCopy = length;
+            memcpy(&espnowOutgoing[espnowOutgoingSpot], data, bytesToCopy);
+            espnowOutgoingSpot += bytesToCopy;
+            data += bytesToCopy;
+            length -= bytesToCopy;
+            espnowLastAdd = millis();
+
+            if (espnowOutgoingSpot == sizeof(espnowOutgoing))
             {
-                uint8_t broadcastMac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-                esp_now_send(broadcastMac, (uint8_t *)&espnowOutgoing,
-                             sizeof(espnowOutgoing)); // Send packet via broadcast
-            }
+                espnowOutgoingSpot = 0; // Wrap
+
+                if (settings.espnowBroadcast == false)
+                    esp_now_send(0, (uint8_t *)&espnowOutgoing, sizeof(espnowOutgoing)); // Send packet to all peers
+                else
+                {
+                    uint8_t broadcastMac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+                    esp_now_send(broadcastMac, (uint8_t *)&espnowOutgoing,
+                                 sizeof(espnowOutgoing)); // Send packet via broadcast
+                }
 
-            delay(10); // We need a small delay between sending multiple packets
+                delay(10); // We need a small delay between sending multiple packets
 
-            espnowBytesSent += sizeof(espnowOutgoing);
+                espnowBytesSent += sizeof(espnowOutgoing);
 
-            espnowOutgoingRTCM = true;
+                espnowOutgoingRTCM = true;
+            }
         }
     }
 #endif // COMPILE_ESPNOW
@@ -0,0 +1,463 @@
+/*------------------------------------------------------------------------------
+FileDownload.ino
+
+  Download files from the microSD card to the web browser.
+
+  Each download is assigned a pair of buffers.  The download task fills the
+  read buffer from the microSD card using large reads while the web server
+  empties the send buffer as the TCP connection accepts data.  When the send
+  buffer is empty and the read buffer is full, the web server swaps the
+  buffers.  The microSD card read is done without holding the
+  fileDownloadMutex, the mutex is only held to select the next download to
+  read and to swap the buffers, so the web server never waits for the microSD
+  card.  Multiple downloads may run at the same time.
+
+  The HTTP Range header is supported so that the browser is able to resume an
+  interrupted download of a large log file.
+
+                            fileDownloadTask              Web server
+                                   |                          ^
+                                   | read                     | fileDownloadFill
+                                   v                          |
+      microSD card ---> readBuffer <--- swap ---> sendBuffer -+
+------------------------------------------------------------------------------*/
+
+#ifdef COMPILE_AP
+
+//----------------------------------------
+// Constants
+//----------------------------------------
+
+#define FILE_DOWNLOAD_MAX 3           // Maximum number of concurrent downloads
+#define FILE_DOWNLOAD_READ_BYTES 8192 // Buffer size and maximum microSD card read, multiple of SD_SECTOR_SIZE
+
+//----------------------------------------
+// Locals
+//----------------------------------------
+
+static FILE_DOWNLOAD fileDownload[FILE_DOWNLOAD_MAX];
+static SemaphoreHandle_t fileDownloadMutex;
+static int fileDownloadNext;                        // Last download selected by the download task
+static FILE_DOWNLOAD *volatile fileDownloadReading; // Download being read from the microSD card
+static TaskHandle_t fileDownloadTaskHandle;
+
+//----------------------------------------
+// Support routines
+//----------------------------------------
+
+// Parse the HTTP Range header, returns false when the range is not
+// satisfiable.  Headers that are not understood, including multiple ranges,
+// select the entire file.
+bool fileDownloadParseRange(const char *range, uint32_t fileSize, uint32_t *offset, uint32_t *length)
+{
+    char *end;
+    uint32_t first;
+    uint32_t last;
+
+    *offset = 0;
+    *length = fileSize;
+    if (strncmp(range, "bytes=", 6) || strchr(range, ','))
+        return true;
+    range += 6;
+
+    // Suffix range: bytes=-<length>
+    if (*range == '-')
+    {
+        last = strtoul(&range[1], &end, 10);
+        if ((end == &range[1]) || (last == 0))
+            return false;
+        if (last > fileSize)
+            last = fileSize;
+        *offset = fileSize - last;
+        *length = last;
+        return true;
+    }
+
+    // Range: bytes=<first>-[<last>]
+    first = strtoul(range, &end, 10);
+    if ((end == range) || (*end != '-'))
+        return true;
+    if (first >= fileSize)
+        return false;
+    last = fileSize - 1;
+    if (end[1])
+    {
+        last = strtoul(&end[1], &end, 10);
+        if (last < first)
+            return true;
+        if (last >= fileSize)
+            last = fileSize - 1;
+    }
+    *offset = first;
+    *length = last - first + 1;
+    return true;
+}
+
+// Release the download buffers, the file object is reused by the next download
+void fileDownloadFree(FILE_DOWNLOAD *download)
+{
+    FileSdFatMMC *file;
+
+    file = download->file;
+    if (download->buffers)
+        free(download->buffers);
+    memset(download, 0, sizeof(*download));
+    download->file = file;
+}
+
+// Close the file and release the download, the caller must hold the
+// fileDownloadMutex
+void fileDownloadClose(FILE_DOWNLOAD *download)
+{
+    if (xSemaphoreTake(sdCardSemaphore, fatSemaphore_longWait_ms) == pdPASS)
+    {
+        markSemaphore(FUNCTION_FILEMANAGER_DOWNLOAD);
+        download->file->close();
+        xSemaphoreGive(sdCardSemaphore);
+    }
+    else
+        download->file->close();
+    fileDownloadFree(download);
+}
+
+// Release the download resources, called by the web server when the browser
+// disconnects
+void fileDownloadRelease(FILE_DOWNLOAD *download)
+{
+    xSemaphoreTake(fileDownloadMutex, portMAX_DELAY);
+    if (download->inUse && (!download->releasePending))
+    {
+        if (download->tail < download->length)
+            systemPrintf("File download ended after %d of %d bytes\r\n", download->tail, download->length);
+
+        // The download task closes the file when its read completes
+        if (download == fileDownloadReading)
+            download->releasePending = true;
+        else
+            fileDownloadClose(download);
+    }
+    xSemaphoreGive(fileDownloadMutex);
+}
+
+// Determine if the download task may fill the read buffer, the caller must
+// hold the fileDownloadMutex
+bool fileDownloadNeedsData(FILE_DOWNLOAD *download)
+{
+    return download->inUse && (!download->releasePending) && (!download->readError) && (!download->readBytes)
+           && (download->head < download->length);
+}
+
+// Fill the read buffer of a download, returns the number of bytes read, zero
+// when the microSD card is busy or a negative value when the read fails.  The
+// caller does not hold the fileDownloadMutex, the read buffer belongs to the
+// download task until readBytes is set.
+int fileDownloadRead(FILE_DOWNLOAD *download)
+{
+    int bytesRead;
+    uint32_t bytes;
+
+    // Keep the reads aligned with the sectors in the file
+    bytes = download->length - download->head;
+    if (bytes > FILE_DOWNLOAD_READ_BYTES)
+        bytes = FILE_DOWNLOAD_READ_BYTES - ((download->offset + download->head) % SD_SECTOR_SIZE);
+
+    if (xSemaphoreTake(sdCardSemaphore, fatSemaphore_shortWait_ms) != pdPASS)
+        return 0;
+    markSemaphore(FUNCTION_FILEMANAGER_DOWNLOAD);
+    bytesRead = download->file->read(download->readBuffer, bytes);
+    xSemaphoreGive(sdCardSemaphore);
+
+    if (bytesRead <= 0)
+    {
+        systemPrintf("ERROR: File download read failed at offset %d\r\n", download->offset + download->head);
+        return -1;
+    }
+    return bytesRead;
+}
+
+// Fill the read buffers from the microSD card
+void fileDownloadTask(void *e)
+{
+    int bytesRead;
+    FILE_DOWNLOAD *download;
+    int index;
+
+    while (true)
+    {
+        // Select the next download needing data
+        download = nullptr;
+        xSemaphoreTake(fileDownloadMutex, portMAX_DELAY);
+        for (index = 0; index < FILE_DOWNLOAD_MAX; index++)
+        {
+            fileDownloadNext = (fileDownloadNext + 1) % FILE_DOWNLOAD_MAX;
+            if (fileDownloadNeedsData(&fileDownload[fileDownloadNext]))
+            {
+                download = &fileDownload[fileDownloadNext];
+                fileDownloadReading = download;
+                break;
+            }
+        }
+        xSemaphoreGive(fileDownloadMutex);
+
+        // Wait for the web server to empty a buffer
+        if (!download)
+        {
+            ulTaskNotifyTake(pdTRUE, fatSemaphore_longWait_ms);
+            continue;
+        }
+
+        // Read the file without holding the fileDownloadMutex
+        bytesRead = fileDownloadRead(download);
+
+        // Pass the read buffer to the web server
+        xSemaphoreTake(fileDownloadMutex, portMAX_DELAY);
+        fileDownloadReading = nullptr;
+        if (bytesRead > 0)
+        {
+            download->head += bytesRead;
+            download->readBytes = bytesRead;
+        }
+        else if (bytesRead < 0)
+            download->readError = true;
+        if (download->releasePending)
+            fileDownloadClose(download);
+        xSemaphoreGive(fileDownloadMutex);
+    }
+}
+
+// Move data from the send buffer into the web server response, called by the
+// web server as the TCP connection accepts more data
+size_t fileDownloadFill(FILE_DOWNLOAD *download, uint8_t *buffer, size_t maxLen)
+{
+    uint32_t bytes;
+    uint32_t milliseconds;
+    uint8_t *sendBuffer;
+
+    // Swap the buffers when the send buffer is empty and the read buffer is full
+    if ((download->sendOffset >= download->sendBytes) && download->readBytes)
+    {
+        xSemaphoreTake(fileDownloadMutex, portMAX_DELAY);
+        sendBuffer = download->sendBuffer;
+        download->sendBuffer = download->readBuffer;
+        download->readBuffer = sendBuffer;
+        download->sendBytes = download->readBytes;
+        download->sendOffset = 0;
+        download->readBytes = 0;
+        xSemaphoreGive(fileDownloadMutex);
+
+        // Start filling the empty buffer
+        xTaskNotifyGive(fileDownloadTaskHandle);
+    }
+
+    bytes = download->sendBytes - download->sendOffset;
+    if (!bytes)
+    {
+        // Stop sending data when the file can't be read, otherwise wait
+        // for the download task
+        if (download->readError)
+            return 0;
+        return RESPONSE_TRY_AGAIN;
+    }
+    if (bytes > maxLen)
+        bytes = maxLen;
+
+    // Copy the data
+    memcpy(buffer, &download->sendBuffer[download->sendOffset], bytes);
+    download->sendOffset += bytes;
+    download->tail += bytes;
+
+    // Display the download rate
+    if (download->tail == download->length)
+    {
+        milliseconds = millis() - download->startMillis;
+        if (!milliseconds)
+            milliseconds = 1;
+        systemPrintf("File download complete: %d bytes in %d.%03d seconds, %0.3f MB/s\r\n", download->length,
+                     milliseconds / 1000, milliseconds % 1000,
+                     ((double)download->length / (1024. * 1024.)) / ((double)milliseconds / 1000.));
+
+        websocket->textAll("fmNext,1,"); // Tell browser to send next file if needed
+    }
+    return bytes;
+}
+
+//----------------------------------------
+// Download routines
+//----------------------------------------
+
+// Start the download of a file, the file is sent in the background
+void fileDownloadBegin(AsyncWebServerRequest *request, const char *slashFileName, const char *fileName)
+{
+    uint32_t bytes;
+    int bytesRead;
+    FILE_DOWNLOAD *download;
+    uint32_t fileSize;
+    uint32_t length;
+    uint32_t offset;
+    bool opened;
+
+    // Start the download task
+    if (!fileDownloadMutex)
+        fileDownloadMutex = xSemaphoreCreateMutex();
+    if (fileDownloadMutex && (!fileDownloadTaskHandle))
+        xTaskCreate(fileDownloadTask,          // Function to call
+                    "FileDownload",            // Just for humans
+                    fileDownloadTaskStackSize, // Stack Size
+                    nullptr,                   // Task input parameter
+                    fileDownloadTaskPriority,  // Priority
+                    &fileDownloadTaskHandle);  // Task handle
+    if (!fileDownloadTaskHandle)
+    {
+        request->send(503, "text/plain", "ERROR: Failed to start the download task");
+        return;
+    }
+
+    // Locate an available download
+    download = nullptr;
+    xSemaphoreTake(fileDownloadMutex, portMAX_DELAY);
+    for (int slot = 0; slot < FILE_DOWNLOAD_MAX; slot++)
+        if (!fileDownload[slot].inUse)
+        {
+            download = &fileDownload[slot];
+            download->inUse = true;
+            break;
+        }
+    xSemaphoreGive(fileDownloadMutex);
+    if (!download)
+    {
+        request->send(503, "text/plain", "ERROR: Too many downloads in progress");
+        return;
+    }
+
+    // Allocate the file and the buffers
+    if (!download->file)
+        download->file = new FileSdFatMMC;
+    download->buffers = (uint8_t *)malloc(2 * FILE_DOWNLOAD_READ_BYTES);
+    download->readBuffer = download->buffers;
+    download->sendBuffer = &download->buffers[FILE_DOWNLOAD_READ_BYTES];
+    if ((!download->buffers) || (!download->file))
+    {
+        systemPrintln("ERROR: Failed to allocate the file download buffer!");
+        fileDownloadFree(download);
+        request->send(503, "text/plain", "ERROR: Insufficient memory");
+        return;
+    }
+
+    // Open the file
+    opened = false;
+    if (xSemaphoreTake(sdCardSemaphore, fatSemaphore_longWait_ms) == pdPASS)
+    {
+        markSemaphore(FUNCTION_FILEMANAGER_DOWNLOAD);
+        opened = download->file->open(slashFileName, O_READ);
+        xSemaphoreGive(sdCardSemaphore);
+    }
+    if (!opened)
+    {
+        systemPrintln("Error: File Manager failed to open file");
+        fileDownloadFree(download);
+        request->send(503, "text/plain", "ERROR: Failed to open file");
+        return;
+    }
+    fileSize = download->file->size();
+
+    // Determine the portion of the file to send
+    offset = 0;
+    length = fileSize;
+    if (request->hasHeader("Range")
+        && (!fileDownloadParseRange(request->header("Range").c_str(), fileSize, &offset, &length)))
+    {
+        fileDownloadRelease(download);
+        AsyncWebServerResponse *response = request->beginResponse(416, "text/plain", "ERROR: Invalid range");
+        response->addHeader("Content-Range", "bytes */" + String(fileSize));
+        request->send(response);
+        return;
+    }
+    if (offset && (!download->file->seek(offset)))
+    {
+        fileDownloadRelease(download);
+        request->send(500, "text/plain", "ERROR: Failed to seek");
+        return;
+    }
+
+    // Read the first buffer before starting the response so that the web
+    // server does not wait for the download task.  The download task does
+    // not read the file until the length is set.
+    bytes = length;
+    if (bytes > FILE_DOWNLOAD_READ_BYTES)
+        bytes = FILE_DOWNLOAD_READ_BYTES - (offset % SD_SECTOR_SIZE);
+    bytesRead = 0;
+    if (bytes && (xSemaphoreTake(sdCardSemaphore, fatSemaphore_longWait_ms) == pdPASS))
+    {
+        markSemaphore(FUNCTION_FILEMANAGER_DOWNLOAD);
+        bytesRead = download->file->read(download->sendBuffer, bytes);
+        xSemaphoreGive(sdCardSemaphore);
+    }
+    if (bytes && (bytesRead <= 0))
+    {
+        fileDownloadRelease(download);
+        request->send(500, "text/plain", "ERROR: Failed to read file");
+        return;
+    }
+
+    xSemaphoreTake(fileDownloadMutex, portMAX_DELAY);
+    download->offset = offset;
+    download->head = bytesRead;
+    download->sendBytes = bytesRead;
+    download->length = length;
+    download->startMillis = millis();
+    xSemaphoreGive(fileDownloadMutex);
+
+    // Start filling the read buffer
+    xTaskNotifyGive(fileDownloadTaskHandle);
+
+    AsyncWebServerResponse *response = request->beginResponse(
+        "application/octet-stream", length,
+        [download](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            return fileDownloadFill(download, buffer, maxLen);
+        });
+
+    if (length != fileSize)
+    {
+        char contentRange[48];
+        snprintf(contentRange, sizeof(contentRange), "bytes %d-%d/%d", offset, offset + length - 1, fileSize);
+        response->setCode(206);
+        response->addHeader("Content-Range", contentRange);
+    }
+    response->addHeader("Accept-Ranges", "bytes");
+    response->addHeader("Cache-Control", "no-cache");
+    response->addHeader("Content-Disposition", "attachment; filename=" + String(fileName));
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    request->onDisconnect([download]() { fileDownloadRelease(download); });
+    request->send(response);
+}
+
+// Stop the downloads when the web server stops
+void fileDownloadStop()
+{
+    int index;
+
+    if (!fileDownloadMutex)
+        return;
+
+    for (index = 0; index < FILE_DOWNLOAD_MAX; index++)
+        fileDownloadRelease(&fileDownload[index]);
+
+    // Wait for the download task to finish its microSD card read and close
+    // the file, the task is not holding the sdCardSemaphore when it is deleted
+    while (1)
+    {
+        xSemaphoreTake(fileDownloadMutex, portMAX_DELAY);
+        if (!fileDownloadReading)
+            break;
+        xSemaphoreGive(fileDownloadMutex);
+        delay(10);
+    }
+    if (fileDownloadTaskHandle)
+    {
+        vTaskDelete(fileDownloadTaskHandle);
+        fileDownloadTaskHandle = nullptr;
+    }
+    xSemaphoreGive(fileDownloadMutex);
+}
+
+#endif // COMPILE_AP
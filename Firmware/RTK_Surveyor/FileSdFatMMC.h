@@ -112,6 +112,17 @@ class FileSdFatMMC : public SdFile
         return 0; // Keep the compiler happy
     };
 
+    bool seek(uint32_t position)
+    {
+        if (USE_SPI_MICROSD)
+            return _sdFile->seekSet(position);
+#ifdef COMPILE_SD_MMC
+        else
+            return _file->seek(position);
+#endif  // COMPILE_SD_MMC
+        return false; // Keep the compiler happy
+    };
+
     int available()
     {
         if (USE_SPI_MICROSD)
@@ -198,6 +209,23 @@ class FileSdFatMMC : public SdFile
             _sdFile->sync();
     };
 
+    // Allocate contiguous clusters for an empty file, SD_MMC does not support pre-allocation
+    bool preAllocate(uint64_t length)
+    {
+        if (USE_SPI_MICROSD)
+            return _sdFile->preAllocate(length);
+        return false;
+    };
+
+    // Release the clusters beyond the current position, the pre-allocated clusters
+    // are not freed by close
+    bool truncate()
+    {
+        if (USE_SPI_MICROSD)
+            return _sdFile->truncate();
+        return true;
+    };
+
     int fileSize()
     {
         if (USE_SPI_MICROSD)
@@ -127,7 +127,7 @@ bool startWebServer(bool startWiFi = true, int httpPort = 80)
         // * /src/fonts/icomoon.ttf
         // * /src/fonts/icomoon.woof
 
-        // * /listfiles responds with a CSV of files and sizes in root
+        // * /listfiles responds with a CSV of a page of files and sizes in root
         // * /listMessages responds with a CSV of messages supported by this platform
         // * /listMessagesBase responds with a CSV of RTCM Base messages supported by this platform
         // * /file allows the download or deletion of a file
@@ -295,9 +295,7 @@ bool startWebServer(bool startWiFi = true, int httpPort = 80)
         webserver->on("/listfiles", HTTP_GET, [](AsyncWebServerRequest *request) {
             String logmessage = "Client:" + request->client()->remoteIP().toString() + " " + request->url();
             systemPrintln(logmessage);
-            String files;
-            getFileList(files);
-            request->send(200, "text/plain", files);
+            getFileList(request);
         });
 
         // Handler for supported messages list
@@ -343,6 +341,8 @@ void stopWebServer()
         webserver = nullptr;
     }
 
+    fileDownloadStop();
+
     if (websocket != nullptr)
     {
         delete websocket;
@@ -373,7 +373,7 @@ void notFound(AsyncWebServerRequest *request)
     request->send(404, "text/plain", "Not found");
 }
 
-// Handler for firmware file downloads
+// Handler for file downloads and deletes
 static void handleFileManager(AsyncWebServerRequest *request)
 {
     // This section does not tolerate semaphore transactions
@@ -414,61 +414,7 @@ static void handleFileManager(AsyncWebServerRequest *request)
             if (strcmp(fileAction, "download") == 0)
             {
                 logmessage += " downloaded";
-
-                if (managerFileOpen == false)
-                {
-                    // Allocate the managerTempFile
-                    if (!managerTempFile)
-                    {
-                        managerTempFile = new FileSdFatMMC;
-                        if (!managerTempFile)
-                        {
-                            systemPrintln("Failed to allocate managerTempFile!");
-                            return;
-                        }
-                    }
-
-                    if (managerTempFile->open(slashFileName, O_READ) == true)
-                        managerFileOpen = true;
-                    else
-                        systemPrintln("Error: File Manager failed to open file");
-                }
-                else
-                {
-                    // File is already in use. Wait your turn.
-                    request->send(202, "text/plain", "ERROR: File already downloading");
-                }
-
-                int dataAvailable;
-                dataAvailable = managerTempFile->size() - managerTempFile->position();
-
-                AsyncWebServerResponse *response = request->beginResponse(
-                    "text/plain", dataAvailable, [](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
-                        uint32_t bytes = 0;
-                        uint32_t availableBytes;
-                        availableBytes = managerTempFile->available();
-
-                        if (availableBytes > maxLen)
-                        {
-                            bytes = managerTempFile->read(buffer, maxLen);
-                        }
-                        else
-                        {
-                            bytes = managerTempFile->read(buffer, availableBytes);
-                            managerTempFile->close();
-
-                            managerFileOpen = false;
-
-                            websocket->textAll("fmNext,1,"); // Tell browser to send next file if needed
-                        }
-
-                        return bytes;
-                    });
-
-                response->addHeader("Cache-Control", "no-cache");
-                response->addHeader("Content-Disposition", "attachment; filename=" + String(fileName));
-                response->addHeader("Access-Control-Allow-Origin", "*");
-                request->send(response);
+                fileDownloadBegin(request, slashFileName, fileName);
             }
             else if (strcmp(fileAction, "delete") == 0)
             {
@@ -479,6 +425,7 @@ static void handleFileManager(AsyncWebServerRequest *request)
                 else
                     SD_MMC.remove(slashFileName);
 #endif // COMPILE_SD_MMC
+                sdDirectoryRemove(slashFileName);
                 request->send(200, "text/plain", "Deleted File: " + String(fileName));
             }
             else
@@ -712,6 +659,8 @@ void createSettingsString(char *newSettings)
         stringRecord(newSettings, name, &settings.ntripServer_MountPoint[serverIndex][0]);
         sprintf(name, "ntripServer_%s_%d", "MountPointPW", serverIndex);
         stringRecord(newSettings, name, &settings.ntripServer_MountPointPW[serverIndex][0]);
+        sprintf(name, "ntripServer_%s_%d", "RtcmFilter", serverIndex);
+        stringRecord(newSettings, name, &settings.ntripServer_RtcmFilter[serverIndex][0]);
     }
 
     stringRecord(newSettings, "enableNtripClient", settings.enableNtripClient);
@@ -747,6 +696,11 @@ void createSettingsString(char *newSettings)
     stringRecord(newSettings, "sdFreeSpace", sdFreeSpaceChar);
     stringRecord(newSettings, "sdSize", sdCardSizeChar);
 
+    // Messages dropped from the ring buffer
+    char ringBufferDrops[200];
+    messagePriorityDrops(ringBufferDrops, sizeof(ringBufferDrops));
+    stringRecord(newSettings, "ringBufferDrops", ringBufferDrops);
+
     stringRecord(newSettings, "enableResetDisplay", settings.enableResetDisplay);
 
     // Ethernet
@@ -1771,6 +1725,22 @@ void updateSettingWithValue(const char *settingName, const char *settingValueStr
             }
         }
 
+        // Scan for ntripServerRtcmFilter
+        if (knownSetting == false)
+        {
+            for (int serverIndex = 0; serverIndex < NTRIP_SERVER_MAX; serverIndex++)
+            {
+                char tempString[50];
+                snprintf(tempString, sizeof(tempString), "ntripServer_RtcmFilter_%d", serverIndex);
+                if (strcmp(settingName, tempString) == 0)
+                {
+                    strcpy(&settings.ntripServer_RtcmFilter[serverIndex][0], settingValueStr);
+                    knownSetting = true;
+                    break;
+                }
+            }
+        }
+
         // Last catch
         if (knownSetting == false)
         {
@@ -1895,24 +1865,84 @@ bool parseIncomingSettings()
     return (true);
 }
 
-// When called, responds with the root folder list of files on SD card
-// Name and size are formatted in CSV, formatted to html by JS
-void getFileList(String &returnText)
+#define FILE_LIST_PAGE_MAX 50 // Maximum number of files in a /listfiles page
+#define FILE_LIST_ENTRY_BYTES 64 // Typical length of a file list entry
+
+// Add a file to the file list page
+void getFileListEntry(void *context, const char *fileName, uint64_t fileSize)
 {
-    returnText = "";
+    AsyncResponseStream *response = (AsyncResponseStream *)context;
+    char size[16];
 
-    // Update the SD Size and Free Space
-    String cardSize;
-    stringHumanReadableSize(cardSize, sdCardSize);
-    returnText += "sdSize," + cardSize + ",";
-    String freeSpace;
-    stringHumanReadableSize(freeSpace, sdFreeSpace);
-    returnText += "sdFreeSpace," + freeSpace + ",";
+    formatHumanReadableSize(size, sizeof(size), fileSize);
+    response->printf("fmName,%s,fmSize,%s,", fileName, size);
+}
+
+// Get an integer parameter from the request
+int getFileListParameter(AsyncWebServerRequest *request, const char *name, int defaultValue)
+{
+    if (request->hasParam(name))
+        return request->getParam(name)->value().toInt();
+    return defaultValue;
+}
 
+// When called, responds with a page of the root folder list of files on SD card.
+// Name and size are formatted in CSV, formatted to html by JS.  The request
+// parameters select the page:
+//
+//   offset - Number of matching files to skip, default 0
+//   count  - Number of files in the page, default and maximum FILE_LIST_PAGE_MAX
+//   sort   - name or size, default name
+//   order  - asc or desc, default asc
+//   ext    - File extension, such as ubx, default all files
+//   date   - Log file date YYMMDD or a prefix such as YYMM, default all files
+//
+// The response ends with fmFiles, the number of matching files, and fmOffset,
+// the offset of this page, allowing the page to request the next page.  The
+// entries are printed directly into the response stream so the heap used by
+// the response depends upon the page size and not the number of files.
+void getFileList(AsyncWebServerRequest *request)
+{
     char fileName[50]; // Handle long file names
+    int fileCount;
+    SD_DIRECTORY_QUERY query;
+    char size[16];
+
+    // Get the page parameters
+    memset(&query, 0, sizeof(query));
+    query.offset = getFileListParameter(request, "offset", 0);
+    if (query.offset < 0)
+        query.offset = 0;
+    query.count = getFileListParameter(request, "count", FILE_LIST_PAGE_MAX);
+    if ((query.count <= 0) || (query.count > FILE_LIST_PAGE_MAX))
+        query.count = FILE_LIST_PAGE_MAX;
+    if (request->hasParam("sort") && request->getParam("sort")->value().equals("size"))
+        query.sort = SD_DIRECTORY_SORT_SIZE;
+    if (request->hasParam("order") && request->getParam("order")->value().equals("desc"))
+        query.descending = true;
+    if (request->hasParam("ext"))
+        query.extension = request->getParam("ext")->value().c_str();
+    if (request->hasParam("date"))
+        query.date = request->getParam("date")->value().c_str();
+
+    AsyncResponseStream *response =
+        request->beginResponseStream("text/plain", 128 + (query.count * FILE_LIST_ENTRY_BYTES));
+
+    // Update the SD Size and Free Space
+    formatHumanReadableSize(size, sizeof(size), sdCardSize);
+    response->printf("sdSize,%s,", size);
+    formatHumanReadableSize(size, sizeof(size), sdFreeSpace);
+    response->printf("sdFreeSpace,%s,", size);
+
+    fileCount = 0;
 
-    // Attempt to gain access to the SD card
-    if (xSemaphoreTake(sdCardSemaphore, fatSemaphore_longWait_ms) == pdPASS)
+    // Use the directory index when available, the SD card is not accessed
+    if (sdDirectoryValid())
+        fileCount = sdDirectoryQuery(&query, getFileListEntry, response);
+
+    // Attempt to gain access to the SD card, the files are listed in
+    // directory order
+    else if (xSemaphoreTake(sdCardSemaphore, fatSemaphore_longWait_ms) == pdPASS)
     {
         markSemaphore(FUNCTION_FILEMANAGER_UPLOAD1);
 
@@ -1921,24 +1951,23 @@ void getFileList(String &returnText)
             SdFile root;
             root.open("/"); // Open root
             SdFile file;
-            uint16_t fileCount = 0;
 
             while (file.openNext(&root, O_READ))
             {
                 if (file.isFile())
                 {
-                    fileCount++;
-
                     file.getName(fileName, sizeof(fileName));
-
-                    String fileSize;
-                    stringHumanReadableSize(fileSize, file.fileSize());
-                    returnText += "fmName," + String(fileName) + ",fmSize," + fileSize + ",";
+                    if (sdDirectoryMatch(fileName, &query))
+                    {
+                        if ((fileCount >= query.offset) && (fileCount < (query.offset + query.count)))
+                            getFileListEntry(response, fileName, file.fileSize());
+                        fileCount++;
+                    }
                 }
+                file.close();
             }
 
             root.close();
-            file.close();
         }
 #ifdef COMPILE_SD_MMC
         else
@@ -1947,18 +1976,14 @@ void getFileList(String &returnText)
 
             if (root && root.isDirectory())
             {
-                uint16_t fileCount = 0;
-
                 File file = root.openNextFile();
                 while (file)
                 {
-                    if (!file.isDirectory())
+                    if ((!file.isDirectory()) && sdDirectoryMatch(file.name(), &query))
                     {
+                        if ((fileCount >= query.offset) && (fileCount < (query.offset + query.count)))
+                            getFileListEntry(response, file.name(), file.size());
                         fileCount++;
-
-                        String fileSize;
-                        stringHumanReadableSize(fileSize, file.size());
-                        returnText += "fmName," + String(file.name()) + ",fmSize," + fileSize + ",";
                     }
 
                     file = root.openNextFile();
@@ -1981,8 +2006,12 @@ void getFileList(String &returnText)
         systemPrintf("sdCardSemaphore failed to yield, held by %s, Form.ino line %d\r\n", semaphoreHolder, __LINE__);
     }
 
+    response->printf("fmFiles,%d,fmOffset,%d,", fileCount, query.offset);
+    request->send(response);
+
     if (settings.debugWiFiConfig == true)
-        systemPrintf("returnText (%d bytes): %s\r\n", returnText.length(), returnText.c_str());
+        systemPrintf("File list page: offset %d, count %d, %d matching files\r\n", query.offset, query.count,
+                     fileCount);
 }
 
 // When called, responds with the messages supported on this platform
@@ -2086,6 +2115,7 @@ void handleUpload(AsyncWebServerRequest *request, String filename, size_t index,
 
             xSemaphoreGive(sdCardSemaphore);
         }
+        sdDirectoryUpdate(filename.c_str(), index + len);
 
         systemPrintln(logmessage);
         request->redirect("/");
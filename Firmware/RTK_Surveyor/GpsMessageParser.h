@@ -15,7 +15,7 @@ GpsMessageParser.h
 // Constants
 //----------------------------------------
 
-#define PARSE_BUFFER_LENGTH 3000 // Some USB RAWX messages can be > 2k
+#define PARSE_BUFFER_LENGTH 3000 // Maximum message length, some USB RAWX messages can be > 2k
 
 enum
 {
@@ -54,7 +54,7 @@ typedef struct _PARSE_STATE
     uint16_t maxLength;                  // Maximum message length including line termination
     uint16_t message;                    // RTCM message number
     uint16_t nmeaLength;                 // Length of the NMEA message without line termination
-    uint8_t buffer[PARSE_BUFFER_LENGTH]; // Buffer containing the message
+    uint8_t *buffer;                     // Buffer containing the message, PARSE_BUFFER_LENGTH bytes
     uint8_t nmeaMessageName[16];         // Message name
     uint8_t nmeaMessageNameLength;       // Length of the message name
     uint8_t ck_a;                        // U-blox checksum byte 1
@@ -105,8 +105,10 @@ extern const int gpsParseTableEntries;
 // External routines
 //----------------------------------------
 
-// Main parser routine
+// Main parser routines
 uint8_t gpsMessageParserFirstByte(PARSE_STATE *parse, uint8_t data);
+const uint8_t *gpsMessageParserFindPreamble(const uint8_t *data, const uint8_t *dataEnd);
+void gpsMessageParserProcessBuffer(PARSE_STATE *parse, const uint8_t *data, int length);
 
 // NMEA parse routines
 uint8_t nmeaPreamble(PARSE_STATE *parse, uint8_t data);
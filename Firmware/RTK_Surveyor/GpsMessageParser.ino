@@ -25,3 +25,121 @@ uint8_t gpsMessageParserFirstByte(PARSE_STATE *parse, uint8_t data)
     parse->state = gpsMessageParserFirstByte;
     return SENTENCE_TYPE_NONE;
 }
+
+// Locate the next byte that is able to start a message
+const uint8_t *gpsMessageParserFindPreamble(const uint8_t *data, const uint8_t *dataEnd)
+{
+    while (data < dataEnd)
+    {
+        switch (*data)
+        {
+#ifdef PARSE_NMEA_MESSAGES
+        case '$':
+#endif // PARSE_NMEA_MESSAGES
+#ifdef PARSE_RTCM_MESSAGES
+        case 0xd3:
+#endif // PARSE_RTCM_MESSAGES
+#ifdef PARSE_UBLOX_MESSAGES
+        case 0xb5:
+#endif // PARSE_UBLOX_MESSAGES
+            return data;
+        }
+        data++;
+    }
+    return dataEnd;
+}
+
+// Parse a span of bytes, calling parse->eomCallback for each complete message
+//
+// The message headers and trailers are passed to the parse routines one byte
+// at a time.  The bytes between messages are skipped without calling the
+// parse routines and the message bodies (NMEA data, RTCM data and u-blox
+// payload) are copied into the parse buffer in bulk with the CRC or checksum
+// computed over the contiguous run.  The results are identical to passing
+// each byte to parse->state.
+void gpsMessageParserProcessBuffer(PARSE_STATE *parse, const uint8_t *data, int length)
+{
+    int bytes;
+    const uint8_t *dataEnd;
+    const uint8_t *dataStart;
+    uint8_t *buffer;
+    uint32_t crc;
+
+    dataEnd = &data[length];
+    while (data < dataEnd)
+    {
+        // Limit the bulk copy to the end of the parse buffer
+        bytes = dataEnd - data;
+        if (bytes > (PARSE_BUFFER_LENGTH - parse->length))
+            bytes = PARSE_BUFFER_LENGTH - parse->length;
+
+        // Skip the bytes between messages
+        if (parse->state == gpsMessageParserFirstByte)
+        {
+            data = gpsMessageParserFindPreamble(data, dataEnd);
+            parse->length = 0;
+            if (data >= dataEnd)
+                break;
+        }
+
+        // Copy the NMEA data up to the asterisk
+        else if (parse->state == nmeaFindAsterisk)
+        {
+            dataStart = data;
+            buffer = &parse->buffer[parse->length];
+            crc = parse->crc;
+            while ((bytes-- > 0) && (*data != '*'))
+            {
+                crc ^= *data;
+                *buffer++ = *data++;
+            }
+            parse->crc = crc;
+            if (data > dataStart)
+            {
+                parse->length += data - dataStart;
+                parse->length %= PARSE_BUFFER_LENGTH;
+                continue;
+            }
+        }
+
+        // Copy the RTCM data, leaving the last byte for rtcmReadData
+        else if ((parse->state == rtcmReadData) && (parse->bytesRemaining > 1))
+        {
+            if (bytes > (parse->bytesRemaining - 1))
+                bytes = parse->bytesRemaining - 1;
+            memcpy(&parse->buffer[parse->length], data, bytes);
+            if (parse->computeCrc)
+                parse->crc = crc24qSpan(parse->crc, data, bytes);
+            parse->bytesRemaining -= bytes;
+            parse->length += bytes;
+            parse->length %= PARSE_BUFFER_LENGTH;
+            data += bytes;
+            continue;
+        }
+
+        // Copy the u-blox payload
+        else if ((parse->state == ubloxPayload) && parse->bytesRemaining)
+        {
+            if (bytes > parse->bytesRemaining)
+                bytes = parse->bytesRemaining;
+            memcpy(&parse->buffer[parse->length], data, bytes);
+            ubloxFletcherSpan(&parse->ck_a, &parse->ck_b, data, bytes);
+            parse->bytesRemaining -= bytes;
+            parse->length += bytes;
+            parse->length %= PARSE_BUFFER_LENGTH;
+            data += bytes;
+            continue;
+        }
+
+        // Save the data byte
+        parse->buffer[parse->length++] = *data;
+        parse->length %= PARSE_BUFFER_LENGTH;
+
+        // Compute the CRC value for the message
+        if (parse->computeCrc)
+            parse->crc = COMPUTE_CRC24Q(parse, *data);
+
+        // Update the parser state based on the incoming byte
+        parse->state(parse, *data++);
+    }
+}
@@ -0,0 +1,88 @@
+/*------------------------------------------------------------------------------
+LogCompress.h
+
+  Constant and routine declarations for the compressed log file format.  The
+  routines in LogCompress.ino do not depend upon the Arduino environment and
+  are also built by the programs in the Tools directory.
+------------------------------------------------------------------------------*/
+
+#ifndef __LOG_COMPRESS_H__
+#define __LOG_COMPRESS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+//----------------------------------------
+// Constants
+//----------------------------------------
+
+#define LOG_COMPRESS_EXTENSION "ubz" // Extension of the compressed log files
+#define LOG_COMPRESS_BLOCK_BYTES 4096 // Maximum uncompressed bytes in a block
+#define LOG_COMPRESS_HASH_BITS 11    // Match finder hash table size, 2^n entries
+#define LOG_COMPRESS_HASH_ENTRIES (1 << LOG_COMPRESS_HASH_BITS)
+#define LOG_COMPRESS_MIN_MATCH 4     // Shortest match encoded as a copy
+
+// Each block starts with a header, all values are little endian
+//
+//    Offset  Length  Description
+//       0       4    LOG_BLOCK_MAGIC
+//       4       2    Payload bytes following the header
+//       6       2    Data bytes in the block after decompression
+//       8       4    Block sequence number, starting at zero for each log file
+//      12       4    Adler-32 checksum of the uncompressed data
+//
+// The payload is stored uncompressed when the payload length equals the data
+// length.  Otherwise the payload is a series of LZ77 sequences using the LZ4
+// sequence layout:
+//
+//    Token: (literal length << 4) | (match length - LOG_COMPRESS_MIN_MATCH)
+//    Additional literal length bytes when the token value is 15
+//    Literal bytes
+//    Match offset: 2 bytes, omitted for the last sequence in the block
+//    Additional match length bytes when the token value is 15
+//
+// The blocks are independent, so a truncated or damaged file is decoded by
+// skipping to the next block header.
+#define LOG_BLOCK_MAGIC "RTKz"
+#define LOG_BLOCK_HEADER_BYTES 16
+
+// Output buffer size needed for a block of length bytes
+#define LOG_COMPRESS_OUTPUT_BYTES(length) (LOG_BLOCK_HEADER_BYTES + (length))
+
+//----------------------------------------
+// Types
+//----------------------------------------
+
+typedef struct _LOG_COMPRESS
+{
+    uint16_t hashTable[LOG_COMPRESS_HASH_ENTRIES]; // Position + 1 of the last data with this hash
+    uint32_t sequence;        // Sequence number of the next block
+    uint32_t blocks;          // Number of blocks written
+    uint32_t storedBlocks;    // Number of blocks that did not compress
+    uint64_t dataBytes;       // Uncompressed bytes
+    uint64_t compressedBytes; // Bytes written including the block headers
+} LOG_COMPRESS;
+
+typedef struct _LOG_DECOMPRESS_STATS
+{
+    uint32_t blocks;       // Number of valid blocks
+    uint32_t badBlocks;    // Number of blocks failing decompression or the checksum
+    uint32_t sequenceGaps; // Number of missing block sequence numbers
+    uint64_t skippedBytes; // Bytes skipped while looking for the next block header
+} LOG_DECOMPRESS_STATS;
+
+//----------------------------------------
+// Log compression routines
+//----------------------------------------
+
+uint32_t logCompressAdler32(const uint8_t *data, int32_t length);
+int32_t logCompressBlock(LOG_COMPRESS *state, const uint8_t *data, uint16_t length, uint8_t *output);
+void logCompressInit(LOG_COMPRESS *state);
+int64_t logDecompress(const uint8_t *data, int64_t length, uint8_t *output, int64_t outputSize,
+                      LOG_DECOMPRESS_STATS *stats);
+int32_t logDecompressBlock(const uint8_t *block, int64_t length, uint8_t *output, int32_t outputSize,
+                           int32_t *blockBytes);
+bool logIsCompressed(const uint8_t *data, int64_t length);
+
+#endif // __LOG_COMPRESS_H__
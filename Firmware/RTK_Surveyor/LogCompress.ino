@@ -0,0 +1,403 @@
+/*------------------------------------------------------------------------------
+LogCompress.ino
+
+  Block compression for the log files.
+
+  The SD card consumer collects the GNSS data into blocks of up to
+  LOG_COMPRESS_BLOCK_BYTES and compresses each block independently using a
+  simple LZ77 match finder with a single entry hash table.  NMEA sentences and
+  the repeated headers and fields of the UBX messages compress well, RTCM
+  observation messages do not.  Blocks that do not get smaller are stored
+  uncompressed.
+
+  The compressed file is a series of blocks:
+
+      +--------+-----------+--------+-----------+--------+-----------+
+      | header |  payload  | header |  payload  | header |  payload  | ...
+      +--------+-----------+--------+-----------+--------+-----------+
+
+  Each block header contains a magic value, the lengths, a sequence number
+  and a checksum of the uncompressed data.  A block does not reference data
+  in any other block, so the data in a truncated file or a file with a damaged
+  block is recovered by searching for the next block header.
+------------------------------------------------------------------------------*/
+
+//----------------------------------------
+// Support routines
+//----------------------------------------
+
+// Read a 16-bit little endian value
+uint16_t logCompressGet16(const uint8_t *data)
+{
+    return data[0] | (data[1] << 8);
+}
+
+// Read a 32-bit little endian value
+uint32_t logCompressGet32(const uint8_t *data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+// Write a 16-bit little endian value
+void logCompressPut16(uint8_t *data, uint16_t value)
+{
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+}
+
+// Write a 32-bit little endian value
+void logCompressPut32(uint8_t *data, uint32_t value)
+{
+    logCompressPut16(data, (uint16_t)value);
+    logCompressPut16(&data[2], (uint16_t)(value >> 16));
+}
+
+// Compute the hash table index for the next LOG_COMPRESS_MIN_MATCH bytes
+uint32_t logCompressHash(const uint8_t *data)
+{
+    uint32_t value;
+
+    memcpy(&value, data, sizeof(value));
+    return (value * 2654435761u) >> (32 - LOG_COMPRESS_HASH_BITS);
+}
+
+// Write a length value that did not fit in the token
+uint8_t *logCompressPutLength(uint8_t *output, int32_t length)
+{
+    while (length >= 255)
+    {
+        *output++ = 255;
+        length -= 255;
+    }
+    *output++ = (uint8_t)length;
+    return output;
+}
+
+// Write a sequence of literals followed by a match, a matchLength of zero
+// writes the final sequence of the block.  Returns NULL when the output
+// buffer is too small.
+uint8_t *logCompressSequence(uint8_t *output, const uint8_t *outputEnd, const uint8_t *literals,
+                             int32_t literalLength, uint16_t offset, int32_t matchLength)
+{
+    int32_t bytesNeeded;
+    uint8_t *token;
+
+    // Verify that the sequence fits in the output buffer
+    bytesNeeded = 1 + (literalLength / 255) + 1 + literalLength;
+    if (matchLength)
+        bytesNeeded += 2 + ((matchLength - LOG_COMPRESS_MIN_MATCH) / 255) + 1;
+    if ((outputEnd - output) < bytesNeeded)
+        return NULL;
+
+    // Write the token and the literals
+    token = output++;
+    *token = (uint8_t)(((literalLength < 15) ? literalLength : 15) << 4);
+    if (literalLength >= 15)
+        output = logCompressPutLength(output, literalLength - 15);
+    memcpy(output, literals, literalLength);
+    output += literalLength;
+
+    // Write the match
+    if (matchLength)
+    {
+        matchLength -= LOG_COMPRESS_MIN_MATCH;
+        *token |= (matchLength < 15) ? matchLength : 15;
+        logCompressPut16(output, offset);
+        output += 2;
+        if (matchLength >= 15)
+            output = logCompressPutLength(output, matchLength - 15);
+    }
+    return output;
+}
+
+//----------------------------------------
+// Log compression routines
+//----------------------------------------
+
+// Compute the Adler-32 checksum of the data
+uint32_t logCompressAdler32(const uint8_t *data, int32_t length)
+{
+    uint32_t a;
+    uint32_t b;
+    int32_t bytes;
+
+    a = 1;
+    b = 0;
+    while (length > 0)
+    {
+        // 5552 is the largest count that can't overflow b
+        bytes = (length < 5552) ? length : 5552;
+        length -= bytes;
+        while (bytes--)
+        {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+// Compress a block of data, returns the number of bytes placed in the output
+// buffer including the block header.  The output buffer must contain at least
+// LOG_COMPRESS_OUTPUT_BYTES(length) bytes.
+int32_t logCompressBlock(LOG_COMPRESS *state, const uint8_t *data, uint16_t length, uint8_t *output)
+{
+    const uint8_t *anchor;
+    uint32_t candidate;
+    const uint8_t *end;
+    uint32_t hash;
+    const uint8_t *input;
+    const uint8_t *match;
+    int32_t matchLength;
+    const uint8_t *matchLimit;
+    uint8_t *payload;
+    uint8_t *payloadEnd;
+
+    // The compressed payload must be smaller than the data
+    payload = &output[LOG_BLOCK_HEADER_BYTES];
+    payloadEnd = &payload[length];
+    anchor = data;
+    input = data;
+    end = &data[length];
+    matchLimit = end - LOG_COMPRESS_MIN_MATCH;
+    memset(state->hashTable, 0, sizeof(state->hashTable));
+
+    // Locate the matches
+    while ((length >= LOG_COMPRESS_MIN_MATCH) && (input <= matchLimit))
+    {
+        hash = logCompressHash(input);
+        candidate = state->hashTable[hash];
+        state->hashTable[hash] = (uint16_t)(input - data + 1);
+        match = &data[candidate - 1];
+        if ((!candidate) || ((input - match) > 0xffff) || memcmp(input, match, LOG_COMPRESS_MIN_MATCH))
+        {
+            // Skip faster through data that does not compress
+            input += 1 + ((input - anchor) >> 6);
+            continue;
+        }
+
+        // Extend the match
+        matchLength = LOG_COMPRESS_MIN_MATCH;
+        while ((&input[matchLength] < end) && (input[matchLength] == match[matchLength]))
+            matchLength++;
+
+        // Write the sequence
+        payload = logCompressSequence(payload, payloadEnd, anchor, input - anchor, (uint16_t)(input - match),
+                                      matchLength);
+        if (!payload)
+            break;
+        input += matchLength;
+        anchor = input;
+
+        // Add the end of the match to the hash table
+        if (input <= matchLimit)
+            state->hashTable[logCompressHash(input - 2)] = (uint16_t)(input - 2 - data + 1);
+    }
+
+    // Write the remaining literals
+    if (payload)
+        payload = logCompressSequence(payload, payloadEnd, anchor, end - anchor, 0, 0);
+
+    // Store the data when it does not compress
+    if ((!payload) || (payload >= payloadEnd))
+    {
+        payload = &output[LOG_BLOCK_HEADER_BYTES];
+        memcpy(payload, data, length);
+        payload += length;
+        state->storedBlocks++;
+    }
+
+    // Build the block header
+    memcpy(output, LOG_BLOCK_MAGIC, 4);
+    logCompressPut16(&output[4], (uint16_t)(payload - &output[LOG_BLOCK_HEADER_BYTES]));
+    logCompressPut16(&output[6], length);
+    logCompressPut32(&output[8], state->sequence++);
+    logCompressPut32(&output[12], logCompressAdler32(data, length));
+
+    // Account for the block
+    state->blocks++;
+    state->dataBytes += length;
+    state->compressedBytes += payload - output;
+    return payload - output;
+}
+
+// Initialize the compression state for a new log file
+void logCompressInit(LOG_COMPRESS *state)
+{
+    memset(state, 0, sizeof(*state));
+}
+
+// Decompress a single block, returns the number of data bytes or -1 if the
+// block is damaged or truncated.  The length of the block including the header
+// is returned in blockBytes.
+int32_t logDecompressBlock(const uint8_t *block, int64_t length, uint8_t *output, int32_t outputSize,
+                           int32_t *blockBytes)
+{
+    int32_t count;
+    uint16_t dataBytes;
+    const uint8_t *input;
+    const uint8_t *inputEnd;
+    uint16_t offset;
+    uint8_t *outputEnd;
+    uint8_t *outputStart;
+    uint16_t payloadBytes;
+    uint8_t token;
+
+    // Validate the block header
+    if ((length < LOG_BLOCK_HEADER_BYTES) || memcmp(block, LOG_BLOCK_MAGIC, 4))
+        return -1;
+    payloadBytes = logCompressGet16(&block[4]);
+    dataBytes = logCompressGet16(&block[6]);
+    if ((payloadBytes > dataBytes) || (dataBytes > outputSize) || ((LOG_BLOCK_HEADER_BYTES + payloadBytes) > length))
+        return -1;
+    *blockBytes = LOG_BLOCK_HEADER_BYTES + payloadBytes;
+
+    input = &block[LOG_BLOCK_HEADER_BYTES];
+    inputEnd = &input[payloadBytes];
+    outputStart = output;
+    outputEnd = &output[dataBytes];
+
+    // Copy the stored data
+    if (payloadBytes == dataBytes)
+    {
+        memcpy(output, input, dataBytes);
+        output += dataBytes;
+    }
+
+    // Decode the sequences
+    else
+    {
+        while (input < inputEnd)
+        {
+            token = *input++;
+
+            // Copy the literals
+            count = token >> 4;
+            if (count == 15)
+            {
+                do
+                {
+                    if (input >= inputEnd)
+                        return -1;
+                    count += *input;
+                } while (*input++ == 255);
+            }
+            if ((count > (inputEnd - input)) || (count > (outputEnd - output)))
+                return -1;
+            memcpy(output, input, count);
+            output += count;
+            input += count;
+
+            // The last sequence does not have a match
+            if (input == inputEnd)
+                break;
+
+            // Copy the match, the source and destination may overlap
+            if ((inputEnd - input) < 2)
+                return -1;
+            offset = logCompressGet16(input);
+            input += 2;
+            count = token & 15;
+            if (count == 15)
+            {
+                do
+                {
+                    if (input >= inputEnd)
+                        return -1;
+                    count += *input;
+                } while (*input++ == 255);
+            }
+            count += LOG_COMPRESS_MIN_MATCH;
+            if ((!offset) || (offset > (output - outputStart)) || (count > (outputEnd - output)))
+                return -1;
+            while (count--)
+            {
+                *output = output[-offset];
+                output++;
+            }
+        }
+    }
+
+    // Verify the data
+    if ((output != outputEnd) || (logCompressAdler32(outputStart, dataBytes) != logCompressGet32(&block[12])))
+        return -1;
+    return dataBytes;
+}
+
+// Decompress a log file, returns the number of data bytes placed in the output
+// buffer.  When output is NULL, returns the space needed for the output
+// buffer based upon the block headers.  Damaged blocks are skipped.
+int64_t logDecompress(const uint8_t *data, int64_t length, uint8_t *output, int64_t outputSize,
+                      LOG_DECOMPRESS_STATS *stats)
+{
+    int32_t blockBytes;
+    int32_t bytes;
+    uint32_t expectedSequence;
+    int64_t offset;
+    int64_t produced;
+    uint32_t sequence;
+
+    memset(stats, 0, sizeof(*stats));
+    expectedSequence = 0;
+    offset = 0;
+    produced = 0;
+    while ((length - offset) >= LOG_BLOCK_HEADER_BYTES)
+    {
+        // Locate the next block header
+        if (memcmp(&data[offset], LOG_BLOCK_MAGIC, 4))
+        {
+            offset++;
+            stats->skippedBytes++;
+            continue;
+        }
+
+        // Size the output buffer
+        if (!output)
+        {
+            blockBytes = LOG_BLOCK_HEADER_BYTES + logCompressGet16(&data[offset + 4]);
+            if (blockBytes <= (length - offset))
+            {
+                produced += logCompressGet16(&data[offset + 6]);
+                offset += blockBytes;
+                continue;
+            }
+            offset++;
+            stats->skippedBytes++;
+            continue;
+        }
+
+        // Decompress the block
+        bytes = (outputSize - produced) < LOG_COMPRESS_BLOCK_BYTES ? (int32_t)(outputSize - produced)
+                                                                   : LOG_COMPRESS_BLOCK_BYTES;
+        bytes = logDecompressBlock(&data[offset], length - offset, &output[produced], bytes, &blockBytes);
+        if (bytes < 0)
+        {
+            // Damaged block, look for the next block header
+            stats->badBlocks++;
+            offset++;
+            stats->skippedBytes++;
+            continue;
+        }
+
+        // Count the missing blocks, appending to a log file starts the
+        // sequence over at zero
+        sequence = logCompressGet32(&data[offset + 8]);
+        if (sequence > expectedSequence)
+            stats->sequenceGaps += sequence - expectedSequence;
+        expectedSequence = sequence + 1;
+
+        stats->blocks++;
+        produced += bytes;
+        offset += blockBytes;
+    }
+    stats->skippedBytes += length - offset;
+    return produced;
+}
+
+// Determine if the data starts with a compressed log block
+bool logIsCompressed(const uint8_t *data, int64_t length)
+{
+    return (length >= LOG_BLOCK_HEADER_BYTES) && (memcmp(data, LOG_BLOCK_MAGIC, 4) == 0);
+}
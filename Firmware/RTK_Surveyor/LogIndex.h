@@ -0,0 +1,124 @@
+/*------------------------------------------------------------------------------
+LogIndex.h
+
+  Constant and routine declarations for the log file seek index.  The routines
+  in LogIndex.ino do not depend upon the Arduino environment and are also
+  built by the programs in the Tools directory.
+------------------------------------------------------------------------------*/
+
+#ifndef __LOG_INDEX_H__
+#define __LOG_INDEX_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+//----------------------------------------
+// Constants
+//----------------------------------------
+
+#define LOG_INDEX_EXTENSION "idx"  // Extension of the index file, same name as the log file
+#define LOG_INDEX_MAGIC 0x694b5452 // "RTKi" in little endian
+#define LOG_INDEX_VERSION 1
+#define LOG_INDEX_BLOCK_EPOCHS 60  // Epochs summarized by each set of count records
+#define LOG_INDEX_MAX_TYPES 24     // Message types counted in a block, others use LOG_INDEX_PROTOCOL_OTHER
+#define LOG_INDEX_RECORDS 64       // Records buffered before writing the index file
+#define LOG_INDEX_FLUSH_RECORDS (LOG_INDEX_RECORDS - LOG_INDEX_MAX_TYPES - 2) // Write the records at this level
+#define LOG_INDEX_EPOCH_TOLERANCE_MS 10 // Time difference between messages in the same epoch
+#define LOG_INDEX_DEFAULT_LEAP_SECONDS 18 // GPS - UTC, used until the receiver reports the value
+
+#define LOG_INDEX_MS_PER_DAY (24 * 60 * 60 * 1000)
+#define LOG_INDEX_MS_PER_WEEK (7 * LOG_INDEX_MS_PER_DAY)
+
+// The index file is a series of LOG_INDEX_RECORD entries, all values are
+// little endian.  The type field selects the meaning of the other fields:
+//
+//  Type  protocol  id            towMs          offset            count
+//  'H'   version   leapSeconds   0              LOG_INDEX_MAGIC   flags
+//  'E'   0         blockOffset   epoch time     file offset       epoch number
+//  'C'   protocol  message id    block time     block file offset messages
+//
+// The header record starts the index and is repeated when logging resumes in
+// an existing log file.  An epoch record contains the offset of the first
+// message of each epoch.  Untimed messages between two epochs belong to the
+// earlier epoch, unless the UBX NAV-EOE message ends the earlier epoch.  The epoch
+// time is the GPS time of week in milliseconds plus LOG_INDEX_MS_PER_WEEK
+// for each week rollover since the start of the log, so the epoch records are
+// in increasing time order.
+//
+// For compressed log files the file offset is the offset of the block header
+// and blockOffset is the offset of the message in the decompressed block.
+// For other log files the blockOffset is zero.
+//
+// The count records follow the epoch records of each block of
+// LOG_INDEX_BLOCK_EPOCHS epochs and contain the number of each type of
+// message in the block, the time and offset are copied from the first epoch
+// of the block.
+#define LOG_INDEX_RECORD_HEADER 'H'
+#define LOG_INDEX_RECORD_EPOCH 'E'
+#define LOG_INDEX_RECORD_COUNT 'C'
+
+#define LOG_INDEX_FLAG_COMPRESSED 1 // Log file uses the LogCompress.h block format
+
+enum LOG_INDEX_PROTOCOL
+{
+    LOG_INDEX_PROTOCOL_OTHER = 0, // Unknown data or too many message types
+    LOG_INDEX_PROTOCOL_NMEA,      // id: three 5-bit letters of the sentence formatter
+    LOG_INDEX_PROTOCOL_RTCM,      // id: message number
+    LOG_INDEX_PROTOCOL_UBX,       // id: (class << 8) | id
+};
+
+//----------------------------------------
+// Types
+//----------------------------------------
+
+typedef struct _LOG_INDEX_RECORD
+{
+    uint8_t type;     // Record type
+    uint8_t protocol; // Message protocol
+    uint16_t id;      // Message ID or block offset
+    uint32_t towMs;   // Time of week in milliseconds
+    uint32_t offset;  // Offset in the log file
+    uint32_t count;   // Message count or epoch number
+} LOG_INDEX_RECORD;
+
+typedef struct _LOG_INDEX_COUNT
+{
+    uint8_t protocol; // Message protocol
+    uint16_t id;      // Message ID
+    uint32_t count;   // Number of messages in the block
+} LOG_INDEX_COUNT;
+
+typedef struct _LOG_INDEX
+{
+    LOG_INDEX_RECORD records[LOG_INDEX_RECORDS]; // Records waiting to be written
+    int recordCount;       // Number of records in the records array
+    LOG_INDEX_COUNT counts[LOG_INDEX_MAX_TYPES + 1]; // Message counts for this block
+    int countEntries;      // Number of entries in the counts array
+    uint32_t epochs;       // Number of epochs in the index
+    uint32_t epochTowMs;   // Time of the current epoch
+    uint32_t rollovers;    // Number of week rollovers since the start of the log
+    uint32_t nextOffset;   // File offset of the message following NAV-EOE
+    uint16_t nextBlockOffset; // Block offset of the message following NAV-EOE
+    bool nextValid;        // Set when the next offset is the start of the next epoch
+    bool wantNext;         // Set when the next message starts the next epoch
+    bool endOfEpoch;       // Set after the end of epoch message
+    uint32_t blockTowMs;   // Time of the first epoch in the block
+    uint32_t blockOffset;  // File offset of the first epoch in the block
+    uint32_t gpsDays;      // Days since the GPS epoch for the NMEA time, 0 = unknown
+    uint32_t lastUtcMs;    // Last NMEA time of day
+    int leapSeconds;       // GPS - UTC in seconds
+    uint8_t flags;         // Header flags
+} LOG_INDEX;
+
+//----------------------------------------
+// Log index routines
+//----------------------------------------
+
+uint32_t logIndexDays(int year, int month, int day);
+void logIndexFinish(LOG_INDEX *index);
+void logIndexInit(LOG_INDEX *index, int leapSeconds, uint32_t gpsDays, uint8_t flags);
+bool logIndexMessage(LOG_INDEX *index, const uint8_t *data, int32_t length, uint32_t offset, uint16_t blockOffset);
+bool logIndexMessageTime(LOG_INDEX *index, const uint8_t *data, int32_t length, uint32_t *towMs, bool *endOfEpoch);
+
+#endif // __LOG_INDEX_H__
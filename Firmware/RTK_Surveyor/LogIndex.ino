@@ -0,0 +1,456 @@
+/*------------------------------------------------------------------------------
+LogIndex.ino
+
+  Seek index for the log files.
+
+  While the log file is written, the SD card consumer passes the start of
+  each message and its offset in the log file to logIndexMessage.  The time
+  of week is extracted from the UBX navigation and raw measurement messages
+  and from the NMEA GGA, GNS, GST, RMC and ZDA sentences.  A change in the
+  time starts a new epoch and adds an epoch record to the index.  The
+  messages in each block of LOG_INDEX_BLOCK_EPOCHS epochs are counted by type
+  and the counts are added to the index at the end of the block.
+
+  The index file uses fixed length records with the epoch records in time
+  order, so the host tools locate the start of a time range with a binary
+  search of the index file and then read only the needed portion of the log
+  file.
+------------------------------------------------------------------------------*/
+
+//----------------------------------------
+// Support routines
+//----------------------------------------
+
+// Add a record to the index
+void logIndexAddRecord(LOG_INDEX *index, uint8_t type, uint8_t protocol, uint16_t id, uint32_t towMs,
+                       uint32_t offset, uint32_t count)
+{
+    LOG_INDEX_RECORD *record;
+
+    // The caller writes the records when logIndexMessage returns true, so
+    // the array only fills when the records are not written
+    if (index->recordCount >= LOG_INDEX_RECORDS)
+        return;
+    record = &index->records[index->recordCount++];
+    record->type = type;
+    record->protocol = protocol;
+    record->id = id;
+    record->towMs = towMs;
+    record->offset = offset;
+    record->count = count;
+}
+
+// Add the message counts for the block to the index
+void logIndexAddCounts(LOG_INDEX *index)
+{
+    LOG_INDEX_COUNT *count;
+    int entry;
+
+    for (entry = 0; entry < index->countEntries; entry++)
+    {
+        count = &index->counts[entry];
+        logIndexAddRecord(index, LOG_INDEX_RECORD_COUNT, count->protocol, count->id, index->blockTowMs,
+                          index->blockOffset, count->count);
+    }
+    index->countEntries = 0;
+}
+
+// Count the message
+void logIndexCount(LOG_INDEX *index, uint8_t protocol, uint16_t id)
+{
+    LOG_INDEX_COUNT *count;
+    int entry;
+
+    // Locate the message type
+    for (entry = 0; entry < index->countEntries; entry++)
+    {
+        count = &index->counts[entry];
+        if ((count->protocol == protocol) && (count->id == id))
+        {
+            count->count += 1;
+            return;
+        }
+    }
+
+    // Add the message type, the last entry counts the other messages
+    if (index->countEntries >= LOG_INDEX_MAX_TYPES)
+    {
+        protocol = LOG_INDEX_PROTOCOL_OTHER;
+        id = 0;
+        for (entry = LOG_INDEX_MAX_TYPES; entry < index->countEntries; entry++)
+        {
+            count = &index->counts[entry];
+            if (count->protocol == protocol)
+            {
+                count->count += 1;
+                return;
+            }
+        }
+    }
+    count = &index->counts[index->countEntries++];
+    count->protocol = protocol;
+    count->id = id;
+    count->count = 1;
+}
+
+// Determine the message protocol and ID
+uint8_t logIndexMessageType(const uint8_t *data, int32_t length, uint16_t *id)
+{
+    int letter;
+    uint8_t value;
+
+    *id = 0;
+
+    // UBX: B5 62 class id length
+    if ((length >= 6) && (data[0] == 0xb5) && (data[1] == 0x62))
+    {
+        *id = (data[2] << 8) | data[3];
+        return LOG_INDEX_PROTOCOL_UBX;
+    }
+
+    // RTCM: D3 length message number
+    if ((length >= 5) && (data[0] == 0xd3))
+    {
+        *id = (data[3] << 4) | (data[4] >> 4);
+        return LOG_INDEX_PROTOCOL_RTCM;
+    }
+
+    // NMEA: $ talker formatter
+    if ((length >= 6) && (data[0] == '$'))
+    {
+        for (letter = 3; letter < 6; letter++)
+        {
+            value = data[letter] - 'A';
+            if (value > 25)
+                value = 31;
+            *id = (*id << 5) | value;
+        }
+        return LOG_INDEX_PROTOCOL_NMEA;
+    }
+    return LOG_INDEX_PROTOCOL_OTHER;
+}
+
+// Locate a field in the NMEA sentence, returns the length of the field or -1
+// when the sentence has fewer fields
+int logIndexNmeaField(const uint8_t *data, int32_t length, int field, const uint8_t **fieldData)
+{
+    int32_t end;
+    int32_t offset;
+
+    // Skip the preceding fields
+    offset = 0;
+    while (field > 0)
+    {
+        while ((offset < length) && (data[offset] != ',') && (data[offset] != '*'))
+            offset++;
+        if ((offset >= length) || (data[offset] == '*'))
+            return -1;
+        offset++;
+        field--;
+    }
+
+    // Determine the field length
+    end = offset;
+    while ((end < length) && (data[end] != ',') && (data[end] != '*') && (data[end] != '\r'))
+        end++;
+    *fieldData = &data[offset];
+    return end - offset;
+}
+
+// Convert the digits to a value, returns -1 if a digit is missing
+int32_t logIndexNmeaNumber(const uint8_t *data, int digits)
+{
+    int32_t value;
+
+    value = 0;
+    while (digits-- > 0)
+    {
+        if ((*data < '0') || (*data > '9'))
+            return -1;
+        value = (value * 10) + *data++ - '0';
+    }
+    return value;
+}
+
+// Get the UTC time of day in milliseconds from the NMEA time field
+bool logIndexNmeaTime(const uint8_t *field, int fieldLength, uint32_t *utcMs)
+{
+    int32_t hours;
+    int32_t minutes;
+    int32_t ms;
+    int32_t scale;
+    int32_t seconds;
+
+    // hhmmss.sss
+    if (fieldLength < 6)
+        return false;
+    hours = logIndexNmeaNumber(field, 2);
+    minutes = logIndexNmeaNumber(&field[2], 2);
+    seconds = logIndexNmeaNumber(&field[4], 2);
+    if ((hours < 0) || (hours > 23) || (minutes < 0) || (minutes > 59) || (seconds < 0) || (seconds > 60))
+        return false;
+
+    // Add the fraction of a second
+    ms = 0;
+    if ((fieldLength > 7) && (field[6] == '.'))
+    {
+        scale = 100;
+        for (field += 7, fieldLength -= 7; fieldLength && scale; fieldLength--, scale /= 10)
+        {
+            if ((*field < '0') || (*field > '9'))
+                break;
+            ms += (*field++ - '0') * scale;
+        }
+    }
+    *utcMs = (((hours * 60) + minutes) * 60 + seconds) * 1000 + ms;
+    return true;
+}
+
+// Get the time of week from the NMEA sentence
+bool logIndexNmeaTow(LOG_INDEX *index, const uint8_t *data, int32_t length, uint32_t *towMs)
+{
+    int32_t day;
+    const uint8_t *field;
+    int fieldLength;
+    int32_t month;
+    uint32_t utcMs;
+    int32_t year;
+
+    // Only the sentences starting with the time are used
+    if ((memcmp(&data[3], "GGA,", 4) != 0) && (memcmp(&data[3], "GNS,", 4) != 0) &&
+        (memcmp(&data[3], "GST,", 4) != 0) && (memcmp(&data[3], "RMC,", 4) != 0) &&
+        (memcmp(&data[3], "ZDA,", 4) != 0))
+        return false;
+    fieldLength = logIndexNmeaField(data, length, 1, &field);
+    if (!logIndexNmeaTime(field, fieldLength, &utcMs))
+        return false;
+
+    // Get the date from the RMC and ZDA sentences
+    day = -1;
+    month = -1;
+    year = -1;
+    if (memcmp(&data[3], "RMC,", 4) == 0)
+    {
+        // ddmmyy
+        if (logIndexNmeaField(data, length, 9, &field) == 6)
+        {
+            day = logIndexNmeaNumber(field, 2);
+            month = logIndexNmeaNumber(&field[2], 2);
+            year = logIndexNmeaNumber(&field[4], 2);
+            if (year >= 0)
+                year += 2000;
+        }
+    }
+    else if (memcmp(&data[3], "ZDA,", 4) == 0)
+    {
+        // dd,mm,yyyy
+        if (logIndexNmeaField(data, length, 2, &field) == 2)
+            day = logIndexNmeaNumber(field, 2);
+        if (logIndexNmeaField(data, length, 3, &field) == 2)
+            month = logIndexNmeaNumber(field, 2);
+        if (logIndexNmeaField(data, length, 4, &field) == 4)
+            year = logIndexNmeaNumber(field, 4);
+    }
+    if ((day >= 1) && (day <= 31) && (month >= 1) && (month <= 12) && (year >= 1980))
+        index->gpsDays = logIndexDays(year, month, day);
+
+    // Otherwise advance the day when the time of day wraps at midnight
+    else if (index->gpsDays && ((utcMs + (LOG_INDEX_MS_PER_DAY / 2)) < index->lastUtcMs))
+        index->gpsDays += 1;
+    index->lastUtcMs = utcMs;
+
+    // The time of week is unknown until the date is known
+    if (!index->gpsDays)
+        return false;
+
+    // Convert UTC to GPS time, the GPS week starts on Sunday
+    *towMs = ((index->gpsDays % 7) * LOG_INDEX_MS_PER_DAY) + utcMs + (index->leapSeconds * 1000);
+    if (*towMs >= LOG_INDEX_MS_PER_WEEK)
+        *towMs -= LOG_INDEX_MS_PER_WEEK;
+    return true;
+}
+
+// Get the time of week from the UBX message
+bool logIndexUbxTow(const uint8_t *data, int32_t length, uint32_t *towMs, bool *endOfEpoch)
+{
+    uint16_t payloadLength;
+    int towOffset;
+    double rcvTow;
+
+    payloadLength = data[4] | (data[5] << 8);
+
+    // RXM-RAWX: receiver time of week in seconds
+    if ((data[2] == 0x02) && (data[3] == 0x15))
+    {
+        if ((payloadLength < 8) || (length < (6 + 8)))
+            return false;
+        memcpy(&rcvTow, &data[6], sizeof(rcvTow));
+        if ((rcvTow < 0) || (rcvTow >= (LOG_INDEX_MS_PER_WEEK / 1000)))
+            return false;
+        *towMs = (uint32_t)((rcvTow * 1000.) + 0.5);
+        if (*towMs >= LOG_INDEX_MS_PER_WEEK)
+            *towMs -= LOG_INDEX_MS_PER_WEEK;
+        return true;
+    }
+
+    // NAV class: most messages start with iTOW
+    if (data[2] != 0x01)
+        return false;
+    switch (data[3])
+    {
+    default:
+        towOffset = 0;
+        break;
+
+    // Messages starting with a version number
+    case 0x09: // ODO
+    case 0x13: // HPPOSECEF
+    case 0x14: // HPPOSLLH
+    case 0x3b: // SVIN
+    case 0x3c: // RELPOSNED
+        towOffset = 4;
+        break;
+    }
+    if ((payloadLength < (towOffset + 4)) || (length < (6 + towOffset + 4)))
+        return false;
+    *towMs = data[6 + towOffset] | (data[7 + towOffset] << 8) | (data[8 + towOffset] << 16)
+           | ((uint32_t)data[9 + towOffset] << 24);
+    if (*towMs >= LOG_INDEX_MS_PER_WEEK)
+        return false;
+    *endOfEpoch = (data[3] == 0x61); // EOE
+    return true;
+}
+
+//----------------------------------------
+// Log index routines
+//----------------------------------------
+
+// Compute the number of days since the GPS epoch, January 6, 1980
+uint32_t logIndexDays(int year, int month, int day)
+{
+    int32_t days;
+    int era;
+    unsigned yearOfEra;
+    unsigned dayOfYear;
+
+    // Days since March 1 of year 0 in the proleptic Gregorian calendar
+    if (month <= 2)
+        year -= 1;
+    era = year / 400;
+    yearOfEra = year - (era * 400);
+    dayOfYear = (153 * (month + ((month > 2) ? -3 : 9)) + 2) / 5 + day - 1;
+    days = (era * 146097) + (yearOfEra * 365) + (yearOfEra / 4) - (yearOfEra / 100) + dayOfYear;
+
+    // January 6, 1980 is day 723125
+    return days - 723125;
+}
+
+// Add the counts for the last block to the index
+void logIndexFinish(LOG_INDEX *index)
+{
+    logIndexAddCounts(index);
+}
+
+// Initialize the index state and add the header record
+void logIndexInit(LOG_INDEX *index, int leapSeconds, uint32_t gpsDays, uint8_t flags)
+{
+    memset(index, 0, sizeof(*index));
+    index->leapSeconds = leapSeconds;
+    index->gpsDays = gpsDays;
+    index->flags = flags;
+    logIndexAddRecord(index, LOG_INDEX_RECORD_HEADER, LOG_INDEX_VERSION, (uint16_t)leapSeconds, 0,
+                      LOG_INDEX_MAGIC, flags);
+}
+
+// Add a message to the index.  The data contains at least the beginning of
+// the message and offset is the location of the message in the log file.
+// Returns true when the caller should write and then discard the records.
+bool logIndexMessage(LOG_INDEX *index, const uint8_t *data, int32_t length, uint32_t offset, uint16_t blockOffset)
+{
+    bool endOfEpoch;
+    uint16_t id;
+    uint32_t lastTowMs;
+    uint8_t protocol;
+    uint32_t startOffset;
+    uint16_t startBlockOffset;
+    uint32_t towMs;
+
+    protocol = logIndexMessageType(data, length, &id);
+    if (logIndexMessageTime(index, data, length, &towMs, &endOfEpoch))
+    {
+        // Account for the week rollover
+        lastTowMs = index->epochTowMs - (index->rollovers * LOG_INDEX_MS_PER_WEEK);
+        if (index->epochs && (towMs < lastTowMs) && ((lastTowMs - towMs) > (LOG_INDEX_MS_PER_WEEK / 2)))
+            index->rollovers += 1;
+        towMs += index->rollovers * LOG_INDEX_MS_PER_WEEK;
+
+        // Determine if this message starts a new epoch
+        if ((!index->epochs) || (towMs > (index->epochTowMs + LOG_INDEX_EPOCH_TOLERANCE_MS)))
+        {
+            // The epoch starts with the first message following NAV-EOE or
+            // with this message
+            startOffset = offset;
+            startBlockOffset = blockOffset;
+            if (index->nextValid)
+            {
+                startOffset = index->nextOffset;
+                startBlockOffset = index->nextBlockOffset;
+            }
+
+            // Summarize the previous block
+            if (index->epochs && ((index->epochs % LOG_INDEX_BLOCK_EPOCHS) == 0))
+                logIndexAddCounts(index);
+            if ((index->epochs % LOG_INDEX_BLOCK_EPOCHS) == 0)
+            {
+                index->blockTowMs = towMs;
+                index->blockOffset = startOffset;
+            }
+
+            logIndexAddRecord(index, LOG_INDEX_RECORD_EPOCH, 0, startBlockOffset, towMs, startOffset,
+                              index->epochs);
+            index->epochs += 1;
+            index->epochTowMs = towMs;
+            index->endOfEpoch = false;
+            index->nextValid = false;
+            index->wantNext = false;
+        }
+
+        // The message following NAV-EOE starts the next epoch
+        if (endOfEpoch && (!index->endOfEpoch))
+        {
+            index->wantNext = true;
+            index->endOfEpoch = true;
+        }
+    }
+    else if (index->wantNext)
+    {
+        index->nextOffset = offset;
+        index->nextBlockOffset = blockOffset;
+        index->nextValid = true;
+        index->wantNext = false;
+    }
+
+    logIndexCount(index, protocol, id);
+    return (index->recordCount >= LOG_INDEX_FLUSH_RECORDS);
+}
+
+// Get the GPS time of week in milliseconds from the message, returns true if
+// the message contains the time.  endOfEpoch is set for the message that ends
+// the epoch.
+bool logIndexMessageTime(LOG_INDEX *index, const uint8_t *data, int32_t length, uint32_t *towMs, bool *endOfEpoch)
+{
+    uint16_t id;
+
+    *endOfEpoch = false;
+    switch (logIndexMessageType(data, length, &id))
+    {
+    default:
+        return false;
+
+    case LOG_INDEX_PROTOCOL_NMEA:
+        return (length >= 7) && logIndexNmeaTow(index, data, length, towMs);
+
+    case LOG_INDEX_PROTOCOL_UBX:
+        return logIndexUbxTow(data, length, towMs, endOfEpoch);
+    }
+}
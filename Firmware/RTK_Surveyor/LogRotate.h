@@ -0,0 +1,52 @@
+/*------------------------------------------------------------------------------
+LogRotate.h
+
+  Constant and routine declarations for selecting the epoch boundary where
+  the log file is switched to the next log file.  The routines in
+  LogRotate.ino do not depend upon the Arduino environment and are also built
+  by the programs in the Tools directory.
+------------------------------------------------------------------------------*/
+
+#ifndef __LOG_ROTATE_H__
+#define __LOG_ROTATE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+//----------------------------------------
+// Constants
+//----------------------------------------
+
+#define LOG_ROTATE_WAIT_MESSAGES 1024 // Switch without an epoch boundary after this many messages
+
+//----------------------------------------
+// Types
+//----------------------------------------
+
+// Last time received in one protocol, UBX time of week or NMEA time of day
+typedef struct _LOG_ROTATE_CLOCK
+{
+    uint32_t ms;  // Time in milliseconds
+    bool valid;   // Set when ms contains the time of the current epoch
+} LOG_ROTATE_CLOCK;
+
+typedef struct _LOG_ROTATE
+{
+    LOG_ROTATE_CLOCK ubx;      // Time from the UBX messages
+    LOG_ROTATE_CLOCK nmea;     // Time from the NMEA sentences
+    bool endOfEpoch;           // Set after NAV-EOE, the next message starts an epoch
+    volatile bool pending;     // Set when the log file should be switched
+    uint32_t waitMessages;     // Messages received since the switch was requested
+    uint32_t epochs;           // Number of epoch boundaries detected
+} LOG_ROTATE;
+
+//----------------------------------------
+// Log rotation routines
+//----------------------------------------
+
+void logRotateInit(LOG_ROTATE *rotate);
+bool logRotateMessage(LOG_ROTATE *rotate, const uint8_t *data, int32_t length);
+void logRotateRequest(LOG_ROTATE *rotate);
+
+#endif // __LOG_ROTATE_H__
@@ -0,0 +1,124 @@
+/*------------------------------------------------------------------------------
+LogRotate.ino
+
+  Select the epoch boundary for switching to the next log file.
+
+  When the log file reaches its maximum length, updateLogs asks the SD card
+  consumer to create the next log file.  The SD card consumer creates and
+  pre-allocates the file between its log writes, the ring buffer holds the
+  incoming data meanwhile, and then requests the switch.  The SD card
+  consumer passes the start of each message to logRotateMessage before
+  writing the message.  The switch happens before the first message of the
+  next navigation epoch, so each epoch is written to a single log file and no
+  data is lost while the files are switched.
+
+  The epoch boundary is the message following the UBX NAV-EOE message or the
+  first UBX message or NMEA sentence containing a new time.  The UBX time of
+  week and the NMEA time of day are tracked separately, so no date or leap
+  second information is needed.  At an epoch boundary the time of each
+  protocol is marked as stale and the first time received in the new epoch
+  is saved without starting another epoch.
+
+  When the data contains no time, such as RTCM only, the switch happens after
+  LOG_ROTATE_WAIT_MESSAGES messages.
+------------------------------------------------------------------------------*/
+
+//----------------------------------------
+// Support routines
+//----------------------------------------
+
+// Get the UTC time of day in milliseconds from the NMEA sentence
+bool logRotateNmeaTime(const uint8_t *data, int32_t length, uint32_t *utcMs)
+{
+    const uint8_t *field;
+    int fieldLength;
+
+    // Only the sentences starting with the time are used
+    if ((length < 7) || ((memcmp(&data[3], "GGA,", 4) != 0) && (memcmp(&data[3], "GNS,", 4) != 0) &&
+                         (memcmp(&data[3], "GST,", 4) != 0) && (memcmp(&data[3], "RMC,", 4) != 0) &&
+                         (memcmp(&data[3], "ZDA,", 4) != 0)))
+        return false;
+    fieldLength = logIndexNmeaField(data, length, 1, &field);
+    return logIndexNmeaTime(field, fieldLength, utcMs);
+}
+
+// Update the protocol time, returns true if the time differs from the time
+// of the current epoch
+bool logRotateClock(LOG_ROTATE_CLOCK *clock, uint32_t ms)
+{
+    bool newTime;
+
+    newTime = clock->valid && ((ms > (clock->ms + LOG_INDEX_EPOCH_TOLERANCE_MS))
+                               || ((ms + LOG_INDEX_EPOCH_TOLERANCE_MS) < clock->ms));
+    clock->ms = ms;
+    clock->valid = true;
+    return newTime;
+}
+
+//----------------------------------------
+// Log rotation routines
+//----------------------------------------
+
+// Initialize the log rotation state
+void logRotateInit(LOG_ROTATE *rotate)
+{
+    memset(rotate, 0, sizeof(*rotate));
+}
+
+// Pass the start of a message to the log rotation, returns true when the log
+// file should be switched before writing this message
+bool logRotateMessage(LOG_ROTATE *rotate, const uint8_t *data, int32_t length)
+{
+    bool endOfEpoch;
+    bool epochStart;
+    uint16_t id;
+    uint32_t ms;
+
+    // The message following NAV-EOE starts the next epoch
+    epochStart = rotate->endOfEpoch;
+    if (epochStart)
+    {
+        rotate->ubx.valid = false;
+        rotate->nmea.valid = false;
+    }
+
+    // A new time starts the next epoch
+    endOfEpoch = false;
+    switch (logIndexMessageType(data, length, &id))
+    {
+    case LOG_INDEX_PROTOCOL_UBX:
+        if (logIndexUbxTow(data, length, &ms, &endOfEpoch) && logRotateClock(&rotate->ubx, ms))
+        {
+            epochStart = true;
+            rotate->nmea.valid = false;
+        }
+        break;
+
+    case LOG_INDEX_PROTOCOL_NMEA:
+        if (logRotateNmeaTime(data, length, &ms) && logRotateClock(&rotate->nmea, ms))
+        {
+            epochStart = true;
+            rotate->ubx.valid = false;
+        }
+        break;
+    }
+    rotate->endOfEpoch = endOfEpoch;
+    if (epochStart)
+        rotate->epochs += 1;
+
+    // Switch the log file at the epoch boundary
+    if (!rotate->pending)
+        return false;
+    rotate->waitMessages += 1;
+    if ((!epochStart) && (rotate->waitMessages <= LOG_ROTATE_WAIT_MESSAGES))
+        return false;
+    rotate->pending = false;
+    return true;
+}
+
+// Request a switch to the next log file at the next epoch boundary
+void logRotateRequest(LOG_ROTATE *rotate)
+{
+    rotate->waitMessages = 0;
+    rotate->pending = true;
+}
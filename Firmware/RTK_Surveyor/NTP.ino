@@ -985,6 +985,7 @@ void ntpServerUpdate()
 
                                 // Close the mark file
                                 ntpFile.close();
+                                sdDirectoryUpdateFile(fileName);
                             }
 
                             // Dismount the SD card
@@ -115,6 +115,7 @@ void recordSystemSettingsToFileSD(char *fileName)
                 updateDataFileAccess(&settingsFile); // Update the file access time & date
 
                 settingsFile.close();
+                sdDirectoryUpdateFile(fileName);
             }
 #ifdef COMPILE_SD_MMC
             else
@@ -136,6 +137,7 @@ void recordSystemSettingsToFileSD(char *fileName)
                 recordSystemSettingsToFile(&settingsFile); // Record all the settings via strings to file
 
                 settingsFile.close();
+                sdDirectoryUpdateFile(fileName);
             }
 #endif // COMPILE_SD_MMC
 
@@ -252,6 +254,8 @@ void recordSystemSettingsToFile(File *settingsFile)
         settingsFile->printf("%s_%d=%s\r\n", "ntripServer_CasterUserPW", serverIndex, &settings.ntripServer_CasterUserPW[serverIndex][0]);
         settingsFile->printf("%s_%d=%s\r\n", "ntripServer_MountPoint", serverIndex, &settings.ntripServer_MountPoint[serverIndex][0]);
         settingsFile->printf("%s_%d=%s\r\n", "ntripServer_MountPointPW", serverIndex, &settings.ntripServer_MountPointPW[serverIndex][0]);
+        settingsFile->printf("%s_%d=%s\r\n", "ntripServer_RtcmFilter", serverIndex, &settings.ntripServer_RtcmFilter[serverIndex][0]);
+        settingsFile->printf("%s_%d=%d\r\n", "ntripServer_NtripVersion", serverIndex, settings.ntripServer_NtripVersion[serverIndex]);
     }
     settingsFile->printf("%s=%d\r\n", "enableNtripClient", settings.enableNtripClient);
     settingsFile->printf("%s=%s\r\n", "ntripClient_CasterHost", settings.ntripClient_CasterHost);
@@ -261,6 +265,13 @@ void recordSystemSettingsToFile(File *settingsFile)
     settingsFile->printf("%s=%s\r\n", "ntripClient_MountPoint", settings.ntripClient_MountPoint);
     settingsFile->printf("%s=%s\r\n", "ntripClient_MountPointPW", settings.ntripClient_MountPointPW);
     settingsFile->printf("%s=%d\r\n", "ntripClient_TransmitGGA", settings.ntripClient_TransmitGGA);
+    settingsFile->printf("%s=%d\r\n", "ntripClient_NtripVersion", settings.ntripClient_NtripVersion);
+    settingsFile->printf("%s=%d\r\n", "enableNtripCaster", settings.enableNtripCaster);
+    settingsFile->printf("%s=%d\r\n", "debugNtripCaster", settings.debugNtripCaster);
+    settingsFile->printf("%s=%d\r\n", "ntripCaster_Port", settings.ntripCaster_Port);
+    settingsFile->printf("%s=%s\r\n", "ntripCaster_MountPoint", settings.ntripCaster_MountPoint);
+    settingsFile->printf("%s=%s\r\n", "ntripCaster_User", settings.ntripCaster_User);
+    settingsFile->printf("%s=%s\r\n", "ntripCaster_UserPW", settings.ntripCaster_UserPW);
     settingsFile->printf("%s=%d\r\n", "serialTimeoutGNSS", settings.serialTimeoutGNSS);
 
     // Point Perfect
@@ -282,6 +293,8 @@ void recordSystemSettingsToFile(File *settingsFile)
     settingsFile->printf("%s=%d\r\n", "updateZEDSettings", settings.updateZEDSettings);
     settingsFile->printf("%s=%d\r\n", "enableLogging", settings.enableLogging);
     settingsFile->printf("%s=%d\r\n", "enableARPLogging", settings.enableARPLogging);
+    settingsFile->printf("%s=%d\r\n", "enableLogCompression", settings.enableLogCompression);
+    settingsFile->printf("%s=%d\r\n", "enableLogIndex", settings.enableLogIndex);
     settingsFile->printf("%s=%d\r\n", "ARPLoggingInterval_s", settings.ARPLoggingInterval_s);
     settingsFile->printf("%s=%d\r\n", "timeZoneHours", settings.timeZoneHours);
     settingsFile->printf("%s=%d\r\n", "timeZoneMinutes", settings.timeZoneMinutes);
@@ -300,6 +313,7 @@ void recordSystemSettingsToFile(File *settingsFile)
     settingsFile->printf("%s=%d\r\n", "enablePrintLogFileMessages", settings.enablePrintLogFileMessages);
     settingsFile->printf("%s=%d\r\n", "enablePrintLogFileStatus", settings.enablePrintLogFileStatus);
     settingsFile->printf("%s=%d\r\n", "enablePrintRingBufferOffsets", settings.enablePrintRingBufferOffsets);
+    settingsFile->printf("%s=%d\r\n", "enableRingBufferReserves", settings.enableRingBufferReserves);
     settingsFile->printf("%s=%d\r\n", "debugNtripServerRtcm", settings.debugNtripServerRtcm);
     settingsFile->printf("%s=%d\r\n", "debugNtripClientRtcm", settings.debugNtripClientRtcm);
     settingsFile->printf("%s=%d\r\n", "enablePrintStates", settings.enablePrintStates);
@@ -341,7 +355,7 @@ void recordSystemSettingsToFile(File *settingsFile)
     settingsFile->printf("%s=%d\r\n", "gnssHandlerBufferSize", settings.gnssHandlerBufferSize);
     settingsFile->printf("%s=%d\r\n", "enablePrintBufferOverrun", settings.enablePrintBufferOverrun);
     settingsFile->printf("%s=%d\r\n", "enablePrintSDBuffers", settings.enablePrintSDBuffers);
-    settingsFile->printf("%s=%d\r\n", "periodicDisplay", settings.periodicDisplay);
+    settingsFile->printf("%s=%llu\r\n", "periodicDisplay", settings.periodicDisplay);
     settingsFile->printf("%s=%d\r\n", "periodicDisplayInterval", settings.periodicDisplayInterval);
     settingsFile->printf("%s=%d\r\n", "rebootSeconds", settings.rebootSeconds);
     settingsFile->printf("%s=%d\r\n", "forceResetOnSDFail", settings.forceResetOnSDFail);
@@ -359,6 +373,9 @@ void recordSystemSettingsToFile(File *settingsFile)
 
     settingsFile->printf("%s=%d\r\n", "wifiConfigOverAP", settings.wifiConfigOverAP);
     settingsFile->printf("%s=%d\r\n", "pvtServerPort", settings.pvtServerPort);
+    settingsFile->printf("%s=%d\r\n", "pvtServerMaxClients", settings.pvtServerMaxClients);
+    settingsFile->printf("%s=%d\r\n", "pvtServerHighWater", settings.pvtServerHighWater);
+    settingsFile->printf("%s=%d\r\n", "pvtServerSlowClientPolicy", settings.pvtServerSlowClientPolicy);
     settingsFile->printf("%s=%d\r\n", "pvtUdpServerPort", settings.pvtUdpServerPort);
     settingsFile->printf("%s=%d\r\n", "minElev", settings.minElev);
 
@@ -397,6 +414,24 @@ void recordSystemSettingsToFile(File *settingsFile)
         settingsFile->println(tempString);
     }
 
+    // Record message priority settings
+    for (int x = 0; x < MAX_UBX_MSG; x++)
+    {
+        char tempString[50]; // messagePriority.UBX_NMEA_GSV=0
+        snprintf(tempString, sizeof(tempString), "messagePriority.%s=%d", ubxMessages[x].msgTextName,
+                 settings.ubxMessagePriorities[x]);
+        settingsFile->println(tempString);
+    }
+
+    // Record message filter settings
+    for (int x = 0; x < MAX_UBX_MSG; x++)
+    {
+        char tempString[50]; // messageFilter.UBX_RXM_RAWX=1
+        snprintf(tempString, sizeof(tempString), "messageFilter.%s=%d", ubxMessages[x].msgTextName,
+                 settings.ubxMessageFilters[x]);
+        settingsFile->println(tempString);
+    }
+
     // Record Base RTCM message settings
     int firstRTCMRecord = getMessageNumberByName("UBX_RTCM_1005");
     for (int x = 0; x < MAX_UBX_MSG_RTCM; x++)
@@ -438,11 +473,32 @@ void recordSystemSettingsToFile(File *settingsFile)
     settingsFile->printf("%s=%d\r\n", "btReadTaskCore", settings.btReadTaskCore);
     settingsFile->printf("%s=%d\r\n", "gnssReadTaskCore", settings.gnssReadTaskCore);
     settingsFile->printf("%s=%d\r\n", "handleGnssDataTaskCore", settings.handleGnssDataTaskCore);
+    settingsFile->printf("%s=%d\r\n", "btWriteTaskPriority", settings.btWriteTaskPriority);
+    settingsFile->printf("%s=%d\r\n", "btWriteTaskCore", settings.btWriteTaskCore);
+    settingsFile->printf("%s=%d\r\n", "sdWriteTaskPriority", settings.sdWriteTaskPriority);
+    settingsFile->printf("%s=%d\r\n", "sdWriteTaskCore", settings.sdWriteTaskCore);
+    settingsFile->printf("%s=%d\r\n", "sdWriteBufferSize", settings.sdWriteBufferSize);
+    settingsFile->printf("%s=%d\r\n", "sdPreallocateMB", settings.sdPreallocateMB);
+    settingsFile->printf("%s=%d\r\n", "ntripClientReadTaskPriority", settings.ntripClientReadTaskPriority);
+    settingsFile->printf("%s=%d\r\n", "ntripClientReadTaskCore", settings.ntripClientReadTaskCore);
     settingsFile->printf("%s=%d\r\n", "gnssUartInterruptsCore", settings.gnssUartInterruptsCore);
     settingsFile->printf("%s=%d\r\n", "bluetoothInterruptsCore", settings.bluetoothInterruptsCore);
     settingsFile->printf("%s=%d\r\n", "i2cInterruptsCore", settings.i2cInterruptsCore);
     settingsFile->printf("%s=%d\r\n", "rtcmTimeoutBeforeUsingLBand_s", settings.rtcmTimeoutBeforeUsingLBand_s);
 
+    // Correction source selection
+    for (int x = 0; x < CORRECTION_SOURCE_MAX; x++)
+    {
+        char tempString[50]; // correctionsPriority.NTRIP_Client=0
+        snprintf(tempString, sizeof(tempString), "correctionsPriority.%s=%d", correctionArbiterSourceName(x),
+                 settings.correctionsSourcePriority[x]);
+        settingsFile->println(tempString);
+    }
+    settingsFile->printf("%s=%d\r\n", "correctionsSourceTimeout_ms", settings.correctionsSourceTimeout_ms);
+    settingsFile->printf("%s=%d\r\n", "correctionsSwitchHoldoff_ms", settings.correctionsSwitchHoldoff_ms);
+    settingsFile->printf("%s=%d\r\n", "correctionsMaxLatency_ms", settings.correctionsMaxLatency_ms);
+    settingsFile->printf("%s=%d\r\n", "debugCorrections", settings.debugCorrections);
+
     // Automatic Firmware Update
     settingsFile->printf("%s=%d\r\n", "autoFirmwareCheckMinutes", settings.autoFirmwareCheckMinutes);
     settingsFile->printf("%s=%d\r\n", "debugFirmwareUpdate", settings.debugFirmwareUpdate);
@@ -932,6 +988,10 @@ bool parseLine(char *str, Settings *settings)
         settings->enableLogging = d;
     else if (strcmp(settingName, "enableARPLogging") == 0)
         settings->enableARPLogging = d;
+    else if (strcmp(settingName, "enableLogCompression") == 0)
+        settings->enableLogCompression = d;
+    else if (strcmp(settingName, "enableLogIndex") == 0)
+        settings->enableLogIndex = d;
     else if (strcmp(settingName, "ARPLoggingInterval_s") == 0)
         settings->ARPLoggingInterval_s = d;
     else if (strcmp(settingName, "enableMarksFile") == 0)
@@ -1040,6 +1100,20 @@ bool parseLine(char *str, Settings *settings)
         strcpy(settings->ntripClient_MountPointPW, settingString);
     else if (strcmp(settingName, "ntripClient_TransmitGGA") == 0)
         settings->ntripClient_TransmitGGA = d;
+    else if (strcmp(settingName, "ntripClient_NtripVersion") == 0)
+        settings->ntripClient_NtripVersion = d;
+    else if (strcmp(settingName, "enableNtripCaster") == 0)
+        settings->enableNtripCaster = d;
+    else if (strcmp(settingName, "debugNtripCaster") == 0)
+        settings->debugNtripCaster = d;
+    else if (strcmp(settingName, "ntripCaster_Port") == 0)
+        settings->ntripCaster_Port = d;
+    else if (strcmp(settingName, "ntripCaster_MountPoint") == 0)
+        strcpy(settings->ntripCaster_MountPoint, settingString);
+    else if (strcmp(settingName, "ntripCaster_User") == 0)
+        strcpy(settings->ntripCaster_User, settingString);
+    else if (strcmp(settingName, "ntripCaster_UserPW") == 0)
+        strcpy(settings->ntripCaster_UserPW, settingString);
     else if (strcmp(settingName, "serialTimeoutGNSS") == 0)
         settings->serialTimeoutGNSS = d;
 
@@ -1111,6 +1185,8 @@ bool parseLine(char *str, Settings *settings)
         settings->enablePrintLogFileStatus = d;
     else if (strcmp(settingName, "enablePrintRingBufferOffsets") == 0)
         settings->enablePrintRingBufferOffsets = d;
+    else if (strcmp(settingName, "enableRingBufferReserves") == 0)
+        settings->enableRingBufferReserves = d;
     else if (strcmp(settingName, "debugNtripServerRtcm") == 0)
         settings->debugNtripServerRtcm = d;
     else if (strcmp(settingName, "debugNtripClientRtcm") == 0)
@@ -1175,6 +1251,12 @@ bool parseLine(char *str, Settings *settings)
         settings->wifiConfigOverAP = d;
     else if (strcmp(settingName, "pvtServerPort") == 0)
         settings->pvtServerPort = d;
+    else if (strcmp(settingName, "pvtServerMaxClients") == 0)
+        settings->pvtServerMaxClients = d;
+    else if (strcmp(settingName, "pvtServerHighWater") == 0)
+        settings->pvtServerHighWater = d;
+    else if (strcmp(settingName, "pvtServerSlowClientPolicy") == 0)
+        settings->pvtServerSlowClientPolicy = d;
     else if (strcmp(settingName, "pvtUdpServerPort") == 0)
         settings->pvtUdpServerPort = d;
     else if (strcmp(settingName, "minElev") == 0)
@@ -1323,6 +1405,22 @@ bool parseLine(char *str, Settings *settings)
         settings->gnssReadTaskCore = d;
     else if (strcmp(settingName, "handleGnssDataTaskCore") == 0)
         settings->handleGnssDataTaskCore = d;
+    else if (strcmp(settingName, "btWriteTaskPriority") == 0)
+        settings->btWriteTaskPriority = d;
+    else if (strcmp(settingName, "btWriteTaskCore") == 0)
+        settings->btWriteTaskCore = d;
+    else if (strcmp(settingName, "sdWriteTaskPriority") == 0)
+        settings->sdWriteTaskPriority = d;
+    else if (strcmp(settingName, "sdWriteTaskCore") == 0)
+        settings->sdWriteTaskCore = d;
+    else if (strcmp(settingName, "sdWriteBufferSize") == 0)
+        settings->sdWriteBufferSize = d;
+    else if (strcmp(settingName, "sdPreallocateMB") == 0)
+        settings->sdPreallocateMB = d;
+    else if (strcmp(settingName, "ntripClientReadTaskPriority") == 0)
+        settings->ntripClientReadTaskPriority = d;
+    else if (strcmp(settingName, "ntripClientReadTaskCore") == 0)
+        settings->ntripClientReadTaskCore = d;
     else if (strcmp(settingName, "gnssUartInterruptsCore") == 0)
         settings->gnssUartInterruptsCore = d;
     else if (strcmp(settingName, "bluetoothInterruptsCore") == 0)
@@ -1350,6 +1448,16 @@ bool parseLine(char *str, Settings *settings)
     else if (strcmp(settingName, "rtcmTimeoutBeforeUsingLBand_s") == 0)
         settings->rtcmTimeoutBeforeUsingLBand_s = d;
 
+    // Correction source selection
+    else if (strcmp(settingName, "correctionsSourceTimeout_ms") == 0)
+        settings->correctionsSourceTimeout_ms = d;
+    else if (strcmp(settingName, "correctionsSwitchHoldoff_ms") == 0)
+        settings->correctionsSwitchHoldoff_ms = d;
+    else if (strcmp(settingName, "correctionsMaxLatency_ms") == 0)
+        settings->correctionsMaxLatency_ms = d;
+    else if (strcmp(settingName, "debugCorrections") == 0)
+        settings->debugCorrections = d;
+
     // Automatic Firmware Update
     else if (strcmp(settingName, "autoFirmwareCheckMinutes") == 0)
         settings->autoFirmwareCheckMinutes = d;
@@ -1449,6 +1557,41 @@ bool parseLine(char *str, Settings *settings)
             }
         }
 
+        // Scan for message priority settings
+        if (knownSetting == false)
+        {
+            for (int x = 0; x < MAX_UBX_MSG; x++)
+            {
+                char tempString[50]; // messagePriority.UBX_NMEA_GSV=0
+                snprintf(tempString, sizeof(tempString), "messagePriority.%s", ubxMessages[x].msgTextName);
+
+                if (strcmp(settingName, tempString) == 0)
+                {
+                    if ((d >= 0) && (d < RING_BUFFER_PRIORITY_CLASSES))
+                        settings->ubxMessagePriorities[x] = d;
+                    knownSetting = true;
+                    break;
+                }
+            }
+        }
+
+        // Scan for message filter settings
+        if (knownSetting == false)
+        {
+            for (int x = 0; x < MAX_UBX_MSG; x++)
+            {
+                char tempString[50]; // messageFilter.UBX_RXM_RAWX=1
+                snprintf(tempString, sizeof(tempString), "messageFilter.%s", ubxMessages[x].msgTextName);
+
+                if (strcmp(settingName, tempString) == 0)
+                {
+                    settings->ubxMessageFilters[x] = d;
+                    knownSetting = true;
+                    break;
+                }
+            }
+        }
+
         // Scan for Base RTCM message settings
         if (knownSetting == false)
         {
@@ -1475,6 +1618,24 @@ bool parseLine(char *str, Settings *settings)
             }
         }
 
+        // Scan for correction source priorities
+        if (knownSetting == false)
+        {
+            for (int x = 0; x < CORRECTION_SOURCE_MAX; x++)
+            {
+                char tempString[50]; // correctionsPriority.NTRIP_Client=0
+                snprintf(tempString, sizeof(tempString), "correctionsPriority.%s", correctionArbiterSourceName(x));
+
+                if (strcmp(settingName, tempString) == 0)
+                {
+                    if ((d >= 0) && (d <= 9))
+                        settings->correctionsSourcePriority[x] = d;
+                    knownSetting = true;
+                    break;
+                }
+            }
+        }
+
         // Scan for ESPNOW peers
         if (knownSetting == false)
         {
@@ -1597,6 +1758,38 @@ bool parseLine(char *str, Settings *settings)
             }
         }
 
+        // Scan for ntripServer_RtcmFilter
+        if (knownSetting == false)
+        {
+            for (int serverIndex = 0; serverIndex < NTRIP_SERVER_MAX; serverIndex++)
+            {
+                char tempString[50];
+                snprintf(tempString, sizeof(tempString), "ntripServer_RtcmFilter_%d", serverIndex);
+                if (strcmp(settingName, tempString) == 0)
+                {
+                    strcpy(&settings->ntripServer_RtcmFilter[serverIndex][0], settingString);
+                    knownSetting = true;
+                    break;
+                }
+            }
+        }
+
+        // Scan for ntripServer_NtripVersion
+        if (knownSetting == false)
+        {
+            for (int serverIndex = 0; serverIndex < NTRIP_SERVER_MAX; serverIndex++)
+            {
+                char tempString[50];
+                snprintf(tempString, sizeof(tempString), "ntripServer_NtripVersion_%d", serverIndex);
+                if (strcmp(settingName, tempString) == 0)
+                {
+                    settings->ntripServer_NtripVersion[serverIndex] = d;
+                    knownSetting = true;
+                    break;
+                }
+            }
+        }
+
         // Last catch
         if (knownSetting == false)
         {
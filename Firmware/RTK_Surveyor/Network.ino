@@ -182,6 +182,7 @@ const int networkStateEntries = sizeof(networkState) / sizeof(networkState[0]);
 const char * const networkUser[] =
 {
     "NTP Server",
+    "NTRIP Caster",
     "NTRIP Client",
     "OTA Firmware Update",
     "PVT Client",
@@ -229,7 +230,15 @@ void menuNetwork()
         systemPrintf("4) PVT Server: %s\r\n", settings.enablePvtServer ? "Enabled" : "Disabled");
 
         if (settings.enablePvtServer)
+        {
             systemPrintf("5) PVT Server Port: %ld\r\n", settings.pvtServerPort);
+            systemPrintf("9) PVT Server Client Limit: %d\r\n", settings.pvtServerMaxClients);
+            systemPrintf("h) PVT Server Client High Water: %d bytes\r\n", settings.pvtServerHighWater);
+            systemPrintf("s) PVT Server Slow Clients: %s\r\n",
+                         (settings.pvtServerSlowClientPolicy == PVT_SERVER_SLOW_CLIENT_DISCONNECT)
+                             ? "Disconnect"
+                             : "Skip to newest epoch");
+        }
 
         systemPrintf("6) PVT UDP Server: %s\r\n", settings.enablePvtUdpServer ? "Enabled" : "Disabled");
 
@@ -239,6 +248,19 @@ void menuNetwork()
         if ((settings.enablePvtServer) || (settings.enablePvtUdpServer))
             systemPrintf("8) Display server IP address: %s\r\n", settings.displayServerIP ? "Enabled" : "Disabled");
 
+        //------------------------------
+        // Display the NTRIP caster menu items
+        //------------------------------
+
+        systemPrintf("c) NTRIP Caster (fixed base): %s\r\n", settings.enableNtripCaster ? "Enabled" : "Disabled");
+        if (settings.enableNtripCaster)
+        {
+            systemPrintf("m) NTRIP Caster Mount Point: %s\r\n", settings.ntripCaster_MountPoint);
+            systemPrintf("o) NTRIP Caster Port: %d\r\n", settings.ntripCaster_Port);
+            systemPrintf("u) NTRIP Caster User: %s\r\n", settings.ntripCaster_User);
+            systemPrintf("w) NTRIP Caster User PW: %s\r\n", settings.ntripCaster_UserPW);
+        }
+
         if (HAS_ETHERNET)
         {
             //------------------------------
@@ -330,6 +352,43 @@ void menuNetwork()
             }
         }
 
+        else if ((incoming == 9) && settings.enablePvtServer)
+        {
+            systemPrintf("Enter the maximum number of PVT server clients (1 to %d): ", PVT_SERVER_MAX_CLIENTS);
+            int clients = getNumber(); // Returns EXIT, TIMEOUT, or long
+            if ((clients != INPUT_RESPONSE_GETNUMBER_EXIT) && (clients != INPUT_RESPONSE_GETNUMBER_TIMEOUT))
+            {
+                if ((clients < 1) || (clients > PVT_SERVER_MAX_CLIENTS))
+                    systemPrintln("Error: Client limit out of range");
+                else
+                {
+                    settings.pvtServerMaxClients = clients; // Recorded to NVM and file at main menu exit
+                    systemPrintf("Each client uses a %d byte task stack\r\n", handleGnssDataTaskStackSize);
+                    systemPrintln("The new client limit is used after the RTK restarts");
+                }
+            }
+        }
+
+        else if ((incoming == 'h') && settings.enablePvtServer)
+        {
+            systemPrint("Enter the bytes waiting before a PVT server client is behind (512 to 65535): ");
+            int highWater = getNumber(); // Returns EXIT, TIMEOUT, or long
+            if ((highWater != INPUT_RESPONSE_GETNUMBER_EXIT) && (highWater != INPUT_RESPONSE_GETNUMBER_TIMEOUT))
+            {
+                if ((highWater < 512) || (highWater > 65535))
+                    systemPrintln("Error: High water mark out of range");
+                else
+                    settings.pvtServerHighWater = highWater; // Recorded to NVM and file at main menu exit
+            }
+        }
+
+        else if ((incoming == 's') && settings.enablePvtServer)
+        {
+            settings.pvtServerSlowClientPolicy += 1;
+            if (settings.pvtServerSlowClientPolicy >= PVT_SERVER_SLOW_CLIENT_MAX)
+                settings.pvtServerSlowClientPolicy = PVT_SERVER_SLOW_CLIENT_SKIP;
+        }
+
         //------------------------------
         // Get the PVT UDP server parameters
         //------------------------------
@@ -354,6 +413,47 @@ void menuNetwork()
         else if (incoming == 8 && ((settings.enablePvtServer) || (settings.enablePvtUdpServer)))
             settings.displayServerIP ^= 1;
 
+        //------------------------------
+        // Get the NTRIP caster parameters
+        //------------------------------
+
+        else if (incoming == 'c')
+            settings.enableNtripCaster ^= 1;
+
+        else if ((incoming == 'm') && settings.enableNtripCaster)
+        {
+            char mountPoint[sizeof(settings.ntripCaster_MountPoint)];
+
+            systemPrint("Enter NTRIP caster mount point: ");
+            if (getString(mountPoint, sizeof(mountPoint)) == INPUT_RESPONSE_VALID)
+                strcpy(settings.ntripCaster_MountPoint, mountPoint);
+        }
+
+        else if ((incoming == 'o') && settings.enableNtripCaster)
+        {
+            systemPrint("Enter the NTRIP caster port to use (1 to 65535): ");
+            int portNumber = getNumber(); // Returns EXIT, TIMEOUT, or long
+            if ((portNumber != INPUT_RESPONSE_GETNUMBER_EXIT) && (portNumber != INPUT_RESPONSE_GETNUMBER_TIMEOUT))
+            {
+                if (portNumber < 1 || portNumber > 65535)
+                    systemPrintln("Error: NTRIP caster port out of range");
+                else
+                    settings.ntripCaster_Port = portNumber; // Recorded to NVM and file at main menu exit
+            }
+        }
+
+        else if ((incoming == 'u') && settings.enableNtripCaster)
+        {
+            systemPrint("Enter NTRIP caster user, empty for no credentials: ");
+            getString(settings.ntripCaster_User, sizeof(settings.ntripCaster_User));
+        }
+
+        else if ((incoming == 'w') && settings.enableNtripCaster)
+        {
+            systemPrintf("Enter password for NTRIP caster user %s: ", settings.ntripCaster_User);
+            getString(settings.ntripCaster_UserPW, sizeof(settings.ntripCaster_UserPW));
+        }
+
             //------------------------------
         // Get the network layer parameters
         //------------------------------
@@ -421,7 +521,7 @@ NetworkClient * networkClient(uint8_t user, bool useSSL)
 //----------------------------------------
 // Allocate a network server
 //----------------------------------------
-NetworkServer * networkServer(uint8_t user, uint16_t port)
+NetworkServer * networkServer(uint8_t user, uint16_t port, uint8_t maxClients)
 {
     NetworkServer * _server;
     uint8_t type;
@@ -430,13 +530,13 @@ NetworkServer * networkServer(uint8_t user, uint16_t port)
 #if defined(COMPILE_ETHERNET)
     if (type == NETWORK_TYPE_ETHERNET)
     {
-        _server = new NetworkEthernetServer(port);
+        _server = new NetworkEthernetServer(port, maxClients);
     }
     else
 #endif // COMPILE_ETHERNET
     {
 #if defined(COMPILE_WIFI)
-        _server = new NetworkWiFiServer(port);
+        _server = new NetworkWiFiServer(port, maxClients);
 #else   // COMPILE_WIFI
         _server = nullptr;
 #endif  // COMPILE_WIFI
@@ -447,11 +547,13 @@ NetworkServer * networkServer(uint8_t user, uint16_t port)
 //----------------------------------------
 // Constructor for NetworkServer - header is in NetworkServer.h
 //----------------------------------------
-NetworkServer::NetworkServer(uint8_t user, uint16_t port) : 
+NetworkServer::NetworkServer(uint8_t user, uint16_t port, uint8_t maxClients) : 
     _friendClass(false),
     _networkType{networkGetType(user)},
-    _port{port}
+    _port{port},
+    _maxClients{maxClients}
 {
+    allocateClients();
 #if defined(COMPILE_ETHERNET)
     if (_networkType == NETWORK_TYPE_ETHERNET)
     {
@@ -954,6 +1056,12 @@ void networkStop(uint8_t networkType)
                     ntpServerStop();
                     break;
 
+                case NETWORK_USER_NTRIP_CASTER:
+                    if (settings.debugNetworkLayer)
+                        systemPrintln("Network layer stopping NTRIP caster");
+                    ntripCasterStop();
+                    break;
+
                 case NETWORK_USER_NTRIP_CLIENT:
                     if (settings.debugNetworkLayer)
                         systemPrintln("Network layer stopping NTRIP client");
@@ -1234,6 +1342,7 @@ void networkUpdate()
 
     // Update the network services
     ntpServerUpdate();   // Process any received NTP requests
+    ntripCasterUpdate(); // Send the RTCM data to the rovers connected to the NTRIP caster
     ntripClientUpdate(); // Check the NTRIP client connection and move data NTRIP --> ZED
     ntripServerUpdate(); // Check the NTRIP server connection and move data ZED --> NTRIP
     otaClientUpdate();   // Perform automatic over-the-air firmware updates
@@ -3,7 +3,7 @@
 
 extern uint8_t networkGetType(uint8_t user);
 
-#define PVT_SERVER_MAX_CLIENTS 4
+#define PVT_SERVER_MAX_CLIENTS 16
 
 class NetworkServer : public Server
 {
@@ -13,30 +13,47 @@ class NetworkServer : public Server
     Server * _server; // Ethernet or WiFi server
     uint8_t _networkType;
     uint16_t _port;
+    uint8_t _maxClients;
 #if defined(COMPILE_ETHERNET)
-    EthernetClient _ethernetClient[PVT_SERVER_MAX_CLIENTS];
+    EthernetClient * _ethernetClient;
 #endif  // COMPILE_ETHERNET
 #if defined(COMPILE_WIFI)
-    WiFiClient _wifiClient[PVT_SERVER_MAX_CLIENTS];
+    WiFiClient * _wifiClient;
 #endif  // COMPILE_WIFI
 
+    //------------------------------
+    // Allocate the client connections
+    //------------------------------
+    void allocateClients()
+    {
+#if defined(COMPILE_ETHERNET)
+        _ethernetClient = new EthernetClient[_maxClients];
+#endif  // COMPILE_ETHERNET
+#if defined(COMPILE_WIFI)
+        _wifiClient = new WiFiClient[_maxClients];
+#endif  // COMPILE_WIFI
+    }
+
   public:
 
     //------------------------------
     // Create the network server
     //------------------------------
-    NetworkServer(Server * server, uint8_t networkType, uint16_t port) :
+    NetworkServer(Server * server, uint8_t networkType, uint16_t port,
+                  uint8_t maxClients = PVT_SERVER_MAX_CLIENTS) :
         _friendClass(true),
         _server{server},
         _networkType{networkType},
-        _port{port}
+        _port{port},
+        _maxClients{maxClients}
     {
+        allocateClients();
     }
 
     //------------------------------
     // Create the network server - implemented in Network.ino
     //------------------------------
-    NetworkServer(uint8_t user, uint16_t port);
+    NetworkServer(uint8_t user, uint16_t port, uint8_t maxClients = PVT_SERVER_MAX_CLIENTS);
 
     //------------------------------
     // Delete the network server
@@ -55,6 +72,16 @@ class NetworkServer : public Server
                 delete _server;
             _server = nullptr;
         }
+#if defined(COMPILE_ETHERNET)
+        if (_ethernetClient)
+            delete[] _ethernetClient;
+        _ethernetClient = nullptr;
+#endif  // COMPILE_ETHERNET
+#if defined(COMPILE_WIFI)
+        if (_wifiClient)
+            delete[] _wifiClient;
+        _wifiClient = nullptr;
+#endif  // COMPILE_WIFI
     }
 
     //------------------------------
@@ -82,7 +109,7 @@ class NetworkServer : public Server
 
     Client *available(uint8_t index)
     {
-        if (index < PVT_SERVER_MAX_CLIENTS)
+        if (index < _maxClients)
         {
 #if defined(COMPILE_ETHERNET)
         if (_networkType == NETWORK_TYPE_ETHERNET)
@@ -110,7 +137,7 @@ class NetworkServer : public Server
 
     Client *accept(uint8_t index)
     {
-        if (index < PVT_SERVER_MAX_CLIENTS)
+        if (index < _maxClients)
         {
 #if defined(COMPILE_ETHERNET)
         if (_networkType == NETWORK_TYPE_ETHERNET)
@@ -223,9 +250,9 @@ class NetworkEthernetServer : public NetworkServer
 
   public:
 
-    NetworkEthernetServer(uint16_t port) : 
+    NetworkEthernetServer(uint16_t port, uint8_t maxClients = PVT_SERVER_MAX_CLIENTS) : 
         _ethernetServer{EthernetServer(port)},
-        NetworkServer(&_ethernetServer, NETWORK_TYPE_ETHERNET, port)
+        NetworkServer(&_ethernetServer, NETWORK_TYPE_ETHERNET, port, maxClients)
     {
     }
 
@@ -251,9 +278,9 @@ class NetworkWiFiServer : public NetworkServer
 
   public:
 
-    NetworkWiFiServer(uint16_t port) :
+    NetworkWiFiServer(uint16_t port, uint8_t maxClients = PVT_SERVER_MAX_CLIENTS) :
         _wifiServer{WiFiServer(port)},
-        NetworkServer(&_wifiServer, NETWORK_TYPE_WIFI, port)
+        NetworkServer(&_wifiServer, NETWORK_TYPE_WIFI, port, maxClients)
     {
     }
 
@@ -0,0 +1,138 @@
+/*------------------------------------------------------------------------------
+NtripCaster.h
+
+  Constant, type and routine declarations for the embedded NTRIP caster.  The
+  routines in NtripCaster.ino do not depend upon the Arduino environment and
+  are also built by the programs in the Tools directory.  The network
+  connections are reached through the read, write and close routines passed
+  to ntripCasterInit.
+------------------------------------------------------------------------------*/
+
+#ifndef __NTRIP_CASTER_H__
+#define __NTRIP_CASTER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "NtripHttp.h"
+
+//----------------------------------------
+// Constants
+//----------------------------------------
+
+#define NTRIP_CASTER_MAX_CLIENTS 32          // Rovers connected at the same time
+#define NTRIP_CASTER_QUEUE_DEPTH 16          // Messages waiting for each rover, must be a power of 2
+#define NTRIP_CASTER_REQUEST_SIZE 512        // Longest request header accepted from a rover
+#define NTRIP_CASTER_SOURCE_TABLE_SIZE 640   // Sourcetable response including the HTTP header
+#define NTRIP_CASTER_REQUEST_TIMEOUT (10 * 1000) // Milliseconds to receive the request header
+#define NTRIP_CASTER_WRITE_TIMEOUT (30 * 1000)   // Milliseconds without write progress before disconnect
+
+// Response sent when all of the client entries are in use
+#define NTRIP_CASTER_FULL_RESPONSE "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\n\r\n"
+
+// Client states
+enum NTRIP_CASTER_CLIENT_STATE
+{
+    NTRIP_CASTER_CLIENT_FREE = 0,   // Entry not in use
+    NTRIP_CASTER_CLIENT_REQUEST,    // Receiving the request header
+    NTRIP_CASTER_CLIENT_RESPONSE,   // Sending the response, then close the connection
+    NTRIP_CASTER_CLIENT_STREAMING,  // Sending the response, then the RTCM messages
+};
+
+//----------------------------------------
+// Types
+//----------------------------------------
+
+// RTCM data shared by all of the rovers, the data follows this header and
+// the buffer is freed when the last rover finishes sending it
+typedef struct _NTRIP_CASTER_MESSAGE
+{
+    int32_t references; // Rover queues holding this message
+    uint16_t length;    // Number of data bytes
+} NTRIP_CASTER_MESSAGE;
+
+typedef struct _NTRIP_CASTER_CLIENT *P_NTRIP_CASTER_CLIENT;
+
+// Read data from the rover, returns the number of bytes read, zero when no
+// data is available or -1 when the connection is broken
+typedef int32_t (*NTRIP_CASTER_READ)(P_NTRIP_CASTER_CLIENT client, uint8_t *buffer, int32_t length);
+
+// Write data to the rover, returns the number of bytes written, zero when the
+// connection can't accept more data or -1 when the connection is broken
+typedef int32_t (*NTRIP_CASTER_WRITE)(P_NTRIP_CASTER_CLIENT client, const uint8_t *data, int32_t length);
+
+// Close the rover connection
+typedef void (*NTRIP_CASTER_CLOSE)(P_NTRIP_CASTER_CLIENT client);
+
+typedef struct _NTRIP_CASTER_CLIENT
+{
+    void *context;                 // Network connection
+    int index;                     // Entry number in the client array
+    uint8_t state;                 // NTRIP_CASTER_CLIENT_STATE value
+    uint8_t version;               // NTRIP version requested by the rover, 1 or 2
+    uint32_t timer;                // Time of the connection or of the last write progress
+    const char *response;          // Response header, not sent when NULL
+    uint16_t responseLength;       // Number of bytes in the response
+    uint16_t responseOffset;       // Number of response bytes written
+    uint16_t requestLength;        // Number of bytes in request
+    char request[NTRIP_CASTER_REQUEST_SIZE]; // Request header from the rover
+
+    // RTCM message queue, the messages from queueTail to queueHead are
+    // waiting to be sent
+    NTRIP_CASTER_MESSAGE *queue[NTRIP_CASTER_QUEUE_DEPTH];
+    uint8_t queueHead;             // Next entry to fill
+    uint8_t queueTail;             // Message being sent
+    uint16_t messageOffset;        // Bytes of the message and chunk framing written
+    uint8_t chunkHeaderLength;     // Length of the NTRIP 2 chunk header
+    char chunkHeader[8];           // NTRIP 2 chunk header, hex length and CR LF
+
+    // Statistics
+    uint32_t bytesSent;            // RTCM bytes sent to the rover
+    uint32_t messagesSent;         // RTCM buffers sent to the rover
+    uint32_t messagesDropped;      // RTCM buffers not sent because the rover fell behind
+} NTRIP_CASTER_CLIENT;
+
+typedef struct _NTRIP_CASTER
+{
+    NTRIP_CASTER_CLIENT *clients;  // Client array
+    int maxClients;                // Number of entries in the client array
+    NTRIP_CASTER_READ read;        // Read data from the rover
+    NTRIP_CASTER_WRITE write;      // Write data to the rover
+    NTRIP_CASTER_CLOSE close;      // Close the rover connection
+    char mountPoint[51];           // Mount point served by the caster
+    char authorization[96];        // Base64 user:password, empty when no authorization is needed
+
+    // Sourcetable responses for NTRIP version 1 and 2
+    char sourceTable[2][NTRIP_CASTER_SOURCE_TABLE_SIZE];
+    uint16_t sourceTableLength[2];
+
+    // Statistics
+    uint32_t connections;          // Rover connections accepted
+    uint32_t rejected;             // Requests denied, bad mount point or credentials
+    uint32_t messagesAllocated;    // RTCM buffers currently allocated
+    uint32_t messagesBroadcast;    // RTCM buffers passed to the caster
+    uint32_t allocationFailures;   // RTCM buffers not allocated
+} NTRIP_CASTER;
+
+//----------------------------------------
+// NTRIP caster routines
+//----------------------------------------
+
+void ntripCasterBroadcast(NTRIP_CASTER *caster, const uint8_t *data, uint16_t length);
+void ntripCasterCloseAll(NTRIP_CASTER *caster);
+void ntripCasterConnect(NTRIP_CASTER *caster, P_NTRIP_CASTER_CLIENT client, void *context, uint32_t currentMsec);
+void ntripCasterDisconnect(NTRIP_CASTER *caster, P_NTRIP_CASTER_CLIENT client);
+P_NTRIP_CASTER_CLIENT ntripCasterFreeClient(NTRIP_CASTER *caster);
+bool ntripCasterInit(NTRIP_CASTER *caster, NTRIP_CASTER_CLIENT *clients, int maxClients,
+                     const char *mountPoint, const char *user, const char *password,
+                     const char *identifier, double latitude, double longitude,
+                     NTRIP_CASTER_READ readRoutine, NTRIP_CASTER_WRITE writeRoutine,
+                     NTRIP_CASTER_CLOSE closeRoutine);
+void ntripCasterService(NTRIP_CASTER *caster, uint32_t currentMsec);
+int ntripCasterStreamingClients(NTRIP_CASTER *caster);
+
+#endif // __NTRIP_CASTER_H__
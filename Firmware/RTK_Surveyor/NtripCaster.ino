@@ -0,0 +1,564 @@
+/*------------------------------------------------------------------------------
+NtripCaster.ino
+
+  Embedded NTRIP caster serving the base's RTCM corrections directly to the
+  rovers on the local network.  A rover connects and sends an NTRIP version
+  1 or version 2 request.  The caster returns the sourcetable when the rover
+  requests it or, for NTRIP 1, requests an unknown mount point.  When the
+  caster has a user name, the rover must also supply matching Basic
+  credentials.  Once the request is accepted the RTCM messages are streamed
+  to the rover, NTRIP 2 rovers receive the data with HTTP chunked encoding.
+
+  Each group of RTCM messages passed to ntripCasterBroadcast is copied once
+  into a reference counted buffer.  A pointer to the buffer is placed in the
+  queue of every streaming rover and the buffer is freed when the last rover
+  finishes sending it, so the memory used does not grow with the number of
+  rovers.  When a rover falls behind, the oldest unsent buffers in its queue
+  are dropped so that the rover always receives the newest corrections.  The
+  buffer being sent is never dropped since that would corrupt the stream.
+  Since every queue holds the newest buffers, at most NTRIP_CASTER_QUEUE_DEPTH
+  buffers plus the ones being sent are allocated at any time.
+
+  All of the caster routines must be called from the same task.
+------------------------------------------------------------------------------*/
+
+//----------------------------------------
+// Constants
+//----------------------------------------
+
+#define NTRIP_CASTER_QUEUE_MASK (NTRIP_CASTER_QUEUE_DEPTH - 1)
+#define NTRIP_CASTER_SERVER "Server: NTRIP SparkFun_RTK_Caster/1.0\r\n"
+
+static const char ntripCasterBadRequest[] = "HTTP/1.0 400 Bad Request\r\n"
+                                            "Connection: close\r\n"
+                                            "\r\n";
+
+static const char ntripCasterNotFound[] = "HTTP/1.1 404 Not Found\r\n"
+                                          "Ntrip-Version: Ntrip/2.0\r\n"
+                                          NTRIP_CASTER_SERVER
+                                          "Connection: close\r\n"
+                                          "\r\n";
+
+static const char *const ntripCasterStreamResponse[2] =
+{
+    // NTRIP 1
+    "ICY 200 OK\r\n"
+    "\r\n",
+
+    // NTRIP 2
+    "HTTP/1.1 200 OK\r\n"
+    "Ntrip-Version: Ntrip/2.0\r\n"
+    NTRIP_CASTER_SERVER
+    "Cache-Control: no-store, no-cache, max-age=0\r\n"
+    "Pragma: no-cache\r\n"
+    "Connection: close\r\n"
+    "Content-Type: gnss/data\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "\r\n",
+};
+
+static const char *const ntripCasterUnauthorized[2] =
+{
+    // NTRIP 1
+    "HTTP/1.0 401 Unauthorized\r\n"
+    NTRIP_CASTER_SERVER
+    "WWW-Authenticate: Basic realm=\"NTRIP\"\r\n"
+    "Connection: close\r\n"
+    "\r\n",
+
+    // NTRIP 2
+    "HTTP/1.1 401 Unauthorized\r\n"
+    "Ntrip-Version: Ntrip/2.0\r\n"
+    NTRIP_CASTER_SERVER
+    "WWW-Authenticate: Basic realm=\"NTRIP\"\r\n"
+    "Connection: close\r\n"
+    "\r\n",
+};
+
+//----------------------------------------
+// Support routines
+//----------------------------------------
+
+// Locate the value of a header line, returns NULL when the header is not found
+const char *ntripCasterHeader(const char *request, const char *name)
+{
+    const char *line;
+    size_t nameLength;
+
+    nameLength = strlen(name);
+    line = strstr(request, "\r\n");
+    while (line && (line[2] != '\r'))
+    {
+        line += 2;
+        if (strncasecmp(line, name, nameLength) == 0)
+        {
+            line += nameLength;
+            while (*line == ' ')
+                line++;
+            return line;
+        }
+        line = strstr(line, "\r\n");
+    }
+    return NULL;
+}
+
+// Determine if the header value matches, the value ends with CR LF
+bool ntripCasterHeaderMatch(const char *value, const char *expected)
+{
+    size_t length;
+
+    length = strlen(expected);
+    return value && (strncmp(value, expected, length) == 0) && (value[length] == '\r');
+}
+
+// Release a rover's reference to an RTCM buffer
+void ntripCasterRelease(NTRIP_CASTER *caster, NTRIP_CASTER_MESSAGE *message)
+{
+    message->references -= 1;
+    if (message->references <= 0)
+    {
+        free(message);
+        caster->messagesAllocated -= 1;
+    }
+}
+
+// Parse the request header and select the response
+void ntripCasterRequest(NTRIP_CASTER *caster, P_NTRIP_CASTER_CLIENT client)
+{
+    const char *authorization;
+    const char *mountPoint;
+    size_t mountPointLength;
+    int version;
+
+    // Determine the NTRIP version
+    client->version = 1;
+    if (ntripCasterHeaderMatch(ntripCasterHeader(client->request, "Ntrip-Version:"), "Ntrip/2.0"))
+        client->version = 2;
+    version = client->version - 1;
+    client->state = NTRIP_CASTER_CLIENT_RESPONSE;
+
+    // Only GET requests are supported
+    if (strncmp(client->request, "GET /", 5) != 0)
+    {
+        client->response = ntripCasterBadRequest;
+        client->responseLength = strlen(client->response);
+        caster->rejected += 1;
+        return;
+    }
+    mountPoint = &client->request[5];
+    mountPointLength = strcspn(mountPoint, " \r");
+
+    // Send the sourcetable when requested or for an unknown NTRIP 1 mount point
+    if ((mountPointLength != strlen(caster->mountPoint))
+        || (strncmp(mountPoint, caster->mountPoint, mountPointLength) != 0))
+    {
+        if (mountPointLength && (client->version == 2))
+        {
+            client->response = ntripCasterNotFound;
+            client->responseLength = strlen(client->response);
+            caster->rejected += 1;
+        }
+        else
+        {
+            client->response = caster->sourceTable[version];
+            client->responseLength = caster->sourceTableLength[version];
+        }
+        return;
+    }
+
+    // Verify the credentials
+    if (caster->authorization[0])
+    {
+        authorization = ntripCasterHeader(client->request, "Authorization:");
+        if ((!authorization) || (strncasecmp(authorization, "Basic ", 6) != 0)
+            || (!ntripCasterHeaderMatch(&authorization[6], caster->authorization)))
+        {
+            client->response = ntripCasterUnauthorized[version];
+            client->responseLength = strlen(client->response);
+            caster->rejected += 1;
+            return;
+        }
+    }
+
+    // Start streaming the RTCM data
+    client->response = ntripCasterStreamResponse[version];
+    client->responseLength = strlen(client->response);
+    client->state = NTRIP_CASTER_CLIENT_STREAMING;
+}
+
+// Receive the request header from the rover
+void ntripCasterReceive(NTRIP_CASTER *caster, P_NTRIP_CASTER_CLIENT client, uint32_t currentMsec)
+{
+    int32_t bytesRead;
+    int32_t length;
+
+    // Read more of the request
+    length = sizeof(client->request) - 1 - client->requestLength;
+    bytesRead = caster->read(client, (uint8_t *)&client->request[client->requestLength], length);
+    if (bytesRead < 0)
+    {
+        ntripCasterDisconnect(caster, client);
+        return;
+    }
+    client->requestLength += bytesRead;
+    client->request[client->requestLength] = 0;
+
+    // Wait for the end of the header
+    if (strstr(client->request, "\r\n\r\n"))
+        ntripCasterRequest(caster, client);
+
+    // Reject requests that are too long
+    else if (client->requestLength >= (sizeof(client->request) - 1))
+    {
+        client->state = NTRIP_CASTER_CLIENT_RESPONSE;
+        client->response = ntripCasterBadRequest;
+        client->responseLength = strlen(client->response);
+        caster->rejected += 1;
+    }
+
+    // Give up on rovers that don't send a request
+    else if ((currentMsec - client->timer) >= NTRIP_CASTER_REQUEST_TIMEOUT)
+        ntripCasterDisconnect(caster, client);
+}
+
+// Write the data to the rover, returns the number of bytes written or -1
+// when the connection is broken
+int32_t ntripCasterWriteClient(NTRIP_CASTER *caster, P_NTRIP_CASTER_CLIENT client, const uint8_t *data, int32_t length)
+{
+    int32_t bytesWritten;
+
+    bytesWritten = caster->write(client, data, length);
+    if (bytesWritten < 0)
+        ntripCasterDisconnect(caster, client);
+    return bytesWritten;
+}
+
+// Send the queued RTCM buffers to the rover, returns true if any data was
+// written
+bool ntripCasterSend(NTRIP_CASTER *caster, P_NTRIP_CASTER_CLIENT client)
+{
+    int32_t bytesWritten;
+    const uint8_t *data;
+    uint16_t length;
+    NTRIP_CASTER_MESSAGE *message;
+    uint16_t offset;
+    bool progress;
+    bool rtcmData;
+
+    progress = false;
+    while (client->queueTail != client->queueHead)
+    {
+        message = client->queue[client->queueTail];
+
+        // Build the NTRIP 2 chunk header
+        if (client->messageOffset == 0)
+        {
+            client->chunkHeaderLength = 0;
+            if (client->version == 2)
+                client->chunkHeaderLength = snprintf(client->chunkHeader, sizeof(client->chunkHeader),
+                                                     "%X\r\n", message->length);
+        }
+
+        // Locate the next part to send: chunk header, data or chunk trailer
+        rtcmData = false;
+        offset = client->messageOffset;
+        if (offset < client->chunkHeaderLength)
+        {
+            data = (const uint8_t *)&client->chunkHeader[offset];
+            length = client->chunkHeaderLength - offset;
+        }
+        else if ((offset -= client->chunkHeaderLength) < message->length)
+        {
+            rtcmData = true;
+            data = &((const uint8_t *)(message + 1))[offset];
+            length = message->length - offset;
+        }
+        else
+        {
+            offset -= message->length;
+            data = (const uint8_t *)&"\r\n"[offset];
+            length = 2 - offset;
+        }
+
+        // Write the data
+        bytesWritten = ntripCasterWriteClient(caster, client, data, length);
+        if (bytesWritten <= 0)
+            break;
+        progress = true;
+        client->messageOffset += bytesWritten;
+        if (rtcmData)
+            client->bytesSent += bytesWritten;
+
+        // Determine if the buffer was sent
+        if (client->messageOffset >= (client->chunkHeaderLength + message->length
+                                      + ((client->version == 2) ? 2 : 0)))
+        {
+            client->messageOffset = 0;
+            client->messagesSent += 1;
+            client->queueTail = (client->queueTail + 1) & NTRIP_CASTER_QUEUE_MASK;
+            ntripCasterRelease(caster, message);
+        }
+        if (bytesWritten < length)
+            break;
+    }
+    return progress;
+}
+
+//----------------------------------------
+// NTRIP caster routines
+//----------------------------------------
+
+// Pass a group of complete RTCM messages to the streaming rovers
+void ntripCasterBroadcast(NTRIP_CASTER *caster, const uint8_t *data, uint16_t length)
+{
+    P_NTRIP_CASTER_CLIENT client;
+    int index;
+    NTRIP_CASTER_MESSAGE *message;
+    uint8_t next;
+    int streaming;
+
+    // Skip the copy when no rovers are streaming
+    streaming = ntripCasterStreamingClients(caster);
+    if ((!streaming) || (!length))
+        return;
+
+    // Copy the data into a single shared buffer
+    message = (NTRIP_CASTER_MESSAGE *)malloc(sizeof(*message) + length);
+    if (!message)
+    {
+        caster->allocationFailures += 1;
+        return;
+    }
+    message->references = streaming;
+    message->length = length;
+    memcpy(message + 1, data, length);
+    caster->messagesAllocated += 1;
+    caster->messagesBroadcast += 1;
+
+    // Add the buffer to each rover's queue
+    for (index = 0; index < caster->maxClients; index++)
+    {
+        client = &caster->clients[index];
+        if (client->state != NTRIP_CASTER_CLIENT_STREAMING)
+            continue;
+
+        // Drop the oldest unsent buffer when the queue is full
+        if (((client->queueHead + 1) & NTRIP_CASTER_QUEUE_MASK) == client->queueTail)
+        {
+            client->messagesDropped += 1;
+            if (client->messageOffset == 0)
+            {
+                ntripCasterRelease(caster, client->queue[client->queueTail]);
+                client->queueTail = (client->queueTail + 1) & NTRIP_CASTER_QUEUE_MASK;
+            }
+            else
+            {
+                // Keep the partially sent buffer, drop the one following it
+                next = (client->queueTail + 1) & NTRIP_CASTER_QUEUE_MASK;
+                ntripCasterRelease(caster, client->queue[next]);
+                client->queue[next] = client->queue[client->queueTail];
+                client->queueTail = next;
+            }
+        }
+        client->queue[client->queueHead] = message;
+        client->queueHead = (client->queueHead + 1) & NTRIP_CASTER_QUEUE_MASK;
+    }
+}
+
+// Start processing a new rover connection
+void ntripCasterConnect(NTRIP_CASTER *caster, P_NTRIP_CASTER_CLIENT client, void *context, uint32_t currentMsec)
+{
+    int index;
+
+    index = client->index;
+    memset(client, 0, sizeof(*client));
+    client->index = index;
+    client->context = context;
+    client->state = NTRIP_CASTER_CLIENT_REQUEST;
+    client->timer = currentMsec;
+    caster->connections += 1;
+}
+
+// Release the queued RTCM buffers and close the rover connection
+void ntripCasterDisconnect(NTRIP_CASTER *caster, P_NTRIP_CASTER_CLIENT client)
+{
+    if (client->state == NTRIP_CASTER_CLIENT_FREE)
+        return;
+    while (client->queueTail != client->queueHead)
+    {
+        ntripCasterRelease(caster, client->queue[client->queueTail]);
+        client->queueTail = (client->queueTail + 1) & NTRIP_CASTER_QUEUE_MASK;
+    }
+    client->state = NTRIP_CASTER_CLIENT_FREE;
+    caster->close(client);
+    client->context = NULL;
+}
+
+// Locate an unused client entry, returns NULL when all entries are in use
+P_NTRIP_CASTER_CLIENT ntripCasterFreeClient(NTRIP_CASTER *caster)
+{
+    int index;
+
+    for (index = 0; index < caster->maxClients; index++)
+        if (caster->clients[index].state == NTRIP_CASTER_CLIENT_FREE)
+            return &caster->clients[index];
+    return NULL;
+}
+
+// Initialize the NTRIP caster, returns false if the settings don't fit
+bool ntripCasterInit(NTRIP_CASTER *caster, NTRIP_CASTER_CLIENT *clients, int maxClients,
+                     const char *mountPoint, const char *user, const char *password,
+                     const char *identifier, double latitude, double longitude,
+                     NTRIP_CASTER_READ readRoutine, NTRIP_CASTER_WRITE writeRoutine,
+                     NTRIP_CASTER_CLOSE closeRoutine)
+{
+    char body[NTRIP_CASTER_SOURCE_TABLE_SIZE / 2];
+    char credentials[72];
+    int index;
+    int length;
+
+    memset(caster, 0, sizeof(*caster));
+    memset(clients, 0, maxClients * sizeof(*clients));
+    for (index = 0; index < maxClients; index++)
+        clients[index].index = index;
+    caster->clients = clients;
+    caster->maxClients = maxClients;
+    caster->read = readRoutine;
+    caster->write = writeRoutine;
+    caster->close = closeRoutine;
+
+    // Save the mount point and credentials
+    if ((!mountPoint[0]) || (strlen(mountPoint) >= sizeof(caster->mountPoint)))
+        return false;
+    strcpy(caster->mountPoint, mountPoint);
+    if (user[0])
+    {
+        if (snprintf(credentials, sizeof(credentials), "%s:%s", user, password) >= (int)sizeof(credentials))
+            return false;
+        if (!ntripHttpBase64(credentials, caster->authorization, sizeof(caster->authorization)))
+            return false;
+    }
+
+    // Build the sourcetable
+    length = snprintf(body, sizeof(body),
+                      "STR;%s;%s;RTCM 3.x;;2;GNSS;SparkFun;;%.2f;%.2f;0;0;SparkFun RTK;none;%c;N;0;\r\n"
+                      "ENDSOURCETABLE\r\n",
+                      mountPoint, identifier, latitude, longitude, user[0] ? 'B' : 'N');
+    if (length >= (int)sizeof(body))
+        return false;
+    length = snprintf(caster->sourceTable[0], sizeof(caster->sourceTable[0]),
+                      "SOURCETABLE 200 OK\r\n"
+                      NTRIP_CASTER_SERVER
+                      "Content-Type: text/plain\r\n"
+                      "Content-Length: %d\r\n"
+                      "\r\n"
+                      "%s",
+                      (int)strlen(body), body);
+    if (length >= (int)sizeof(caster->sourceTable[0]))
+        return false;
+    caster->sourceTableLength[0] = length;
+    length = snprintf(caster->sourceTable[1], sizeof(caster->sourceTable[1]),
+                      "HTTP/1.1 200 OK\r\n"
+                      "Ntrip-Version: Ntrip/2.0\r\n"
+                      NTRIP_CASTER_SERVER
+                      "Content-Type: gnss/sourcetable\r\n"
+                      "Content-Length: %d\r\n"
+                      "Connection: close\r\n"
+                      "\r\n"
+                      "%s",
+                      (int)strlen(body), body);
+    if (length >= (int)sizeof(caster->sourceTable[1]))
+        return false;
+    caster->sourceTableLength[1] = length;
+    return true;
+}
+
+// Receive the requests, send the responses and stream the RTCM data
+void ntripCasterService(NTRIP_CASTER *caster, uint32_t currentMsec)
+{
+    int32_t bytesWritten;
+    P_NTRIP_CASTER_CLIENT client;
+    uint8_t discard[64];
+    int index;
+
+    for (index = 0; index < caster->maxClients; index++)
+    {
+        client = &caster->clients[index];
+        switch (client->state)
+        {
+        default:
+            break;
+
+        case NTRIP_CASTER_CLIENT_REQUEST:
+            ntripCasterReceive(caster, client, currentMsec);
+            break;
+
+        case NTRIP_CASTER_CLIENT_RESPONSE:
+        case NTRIP_CASTER_CLIENT_STREAMING:
+            // Send the response header
+            if (client->responseOffset < client->responseLength)
+            {
+                bytesWritten = ntripCasterWriteClient(caster, client,
+                                                (const uint8_t *)&client->response[client->responseOffset],
+                                                client->responseLength - client->responseOffset);
+                if (bytesWritten < 0)
+                    break;
+                if (bytesWritten)
+                    client->timer = currentMsec;
+                client->responseOffset += bytesWritten;
+                if (client->responseOffset < client->responseLength)
+                {
+                    if ((currentMsec - client->timer) >= NTRIP_CASTER_WRITE_TIMEOUT)
+                        ntripCasterDisconnect(caster, client);
+                    break;
+                }
+            }
+
+            // Close the connection after the error or sourcetable response
+            if (client->state == NTRIP_CASTER_CLIENT_RESPONSE)
+            {
+                ntripCasterDisconnect(caster, client);
+                break;
+            }
+
+            // Discard the data from the rover, such as the GGA sentences
+            if (caster->read(client, discard, sizeof(discard)) < 0)
+            {
+                ntripCasterDisconnect(caster, client);
+                break;
+            }
+
+            // Send the RTCM data
+            if ((client->queueTail == client->queueHead) || ntripCasterSend(caster, client))
+                client->timer = currentMsec;
+
+            // Disconnect the rovers that stop accepting data
+            else if ((client->state == NTRIP_CASTER_CLIENT_STREAMING)
+                     && ((currentMsec - client->timer) >= NTRIP_CASTER_WRITE_TIMEOUT))
+                ntripCasterDisconnect(caster, client);
+            break;
+        }
+    }
+}
+
+// Close all of the rover connections
+void ntripCasterCloseAll(NTRIP_CASTER *caster)
+{
+    int index;
+
+    for (index = 0; index < caster->maxClients; index++)
+        ntripCasterDisconnect(caster, &caster->clients[index]);
+}
+
+// Count the rovers receiving the RTCM data
+int ntripCasterStreamingClients(NTRIP_CASTER *caster)
+{
+    int count;
+    int index;
+
+    count = 0;
+    for (index = 0; index < caster->maxClients; index++)
+        if (caster->clients[index].state == NTRIP_CASTER_CLIENT_STREAMING)
+            count += 1;
+    return count;
+}
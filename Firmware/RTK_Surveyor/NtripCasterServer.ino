@@ -0,0 +1,389 @@
+/*
+NtripCasterServer.ino
+
+  The NTRIP caster server sits on top of the network layer and lets the base
+  act as the NTRIP caster for the rovers on the job site, no internet
+  connection is needed.  The NTRIP protocol and the RTCM distribution are
+  handled by the routines in NtripCaster.ino.
+
+                Satellite     ...    Satellite
+                     |         |          |
+                     |         |          |
+                     |         V          |
+                     |        RTK         |
+                     '------> Base <------'
+                            Station
+                               |
+                               | NTRIP Caster Server: RTCM correction data
+                               |
+             .-----------------+-----------------.
+             |                 |                 |
+             V                 V                 V
+            RTK               RTK      ...      RTK
+           Rover             Rover             Rover
+       (NTRIP Client)    (NTRIP Client)    (NTRIP Client)
+
+  The rovers connect to the base's IP address at ntripCaster_Port and
+  request ntripCaster_MountPoint.  Up to NTRIP_CASTER_MAX_CLIENTS rovers are
+  served at the same time, additional rovers receive a 503 response.
+*/
+
+#if COMPILE_NETWORK
+
+//----------------------------------------
+// Constants
+//----------------------------------------
+
+// Define the NTRIP caster states
+enum NtripCasterStates
+{
+    NTRIP_CASTER_STATE_OFF = 0,
+    NTRIP_CASTER_STATE_NETWORK_STARTED,
+    NTRIP_CASTER_STATE_RUNNING,
+    // Insert new states here
+    NTRIP_CASTER_STATE_MAX          // Last entry in the state list
+};
+
+const char * const ntripCasterStateName[] =
+{
+    "NTRIP_CASTER_STATE_OFF",
+    "NTRIP_CASTER_STATE_NETWORK_STARTED",
+    "NTRIP_CASTER_STATE_RUNNING",
+};
+
+const int ntripCasterStateNameEntries = sizeof(ntripCasterStateName) / sizeof(ntripCasterStateName[0]);
+
+const RtkMode_t ntripCasterMode = RTK_MODE_BASE_FIXED;
+
+//----------------------------------------
+// Locals
+//----------------------------------------
+
+static NetworkServer * ntripCasterServer = nullptr;
+static uint8_t ntripCasterState;
+static uint32_t ntripCasterTimer;
+static NTRIP_CASTER ntripCaster;
+static NTRIP_CASTER_CLIENT * ntripCasterClients;
+
+//----------------------------------------
+// NTRIP Caster Network Routines
+//----------------------------------------
+
+// Close the connection to the rover
+void ntripCasterNetworkClose(P_NTRIP_CASTER_CLIENT client)
+{
+    NetworkClient * networkClient = (NetworkClient *)client->context;
+
+    if (settings.debugNtripCaster && (!inMainMenu))
+        systemPrintf("NTRIP caster client %d disconnected, %d bytes sent, %d messages dropped\r\n",
+                     client->index, client->bytesSent, client->messagesDropped);
+    networkClient->stop();
+    delete networkClient;
+}
+
+// Read data from the rover
+int32_t ntripCasterNetworkRead(P_NTRIP_CASTER_CLIENT client, uint8_t *buffer, int32_t length)
+{
+    NetworkClient * networkClient = (NetworkClient *)client->context;
+    int bytesAvailable;
+
+    bytesAvailable = networkClient->available();
+    if (!bytesAvailable)
+        return networkClient->connected() ? 0 : -1;
+    if (length > bytesAvailable)
+        length = bytesAvailable;
+    length = networkClient->read(buffer, length);
+    return (length < 0) ? 0 : length;
+}
+
+// Write data to the rover
+int32_t ntripCasterNetworkWrite(P_NTRIP_CASTER_CLIENT client, const uint8_t *data, int32_t length)
+{
+    NetworkClient * networkClient = (NetworkClient *)client->context;
+
+    if (!networkClient->connected())
+        return -1;
+    length = networkClient->write(data, length);
+    if (length > 0)
+        netOutgoingRTCM = true;
+    return length;
+}
+
+//----------------------------------------
+// NTRIP Caster Routines
+//----------------------------------------
+
+// Update the state of the NTRIP caster state machine
+void ntripCasterSetState(uint8_t newState)
+{
+    if (settings.debugNtripCaster && (!inMainMenu))
+    {
+        if (ntripCasterState == newState)
+            systemPrint("*");
+        else
+            systemPrintf("%s --> ", ntripCasterStateName[ntripCasterState]);
+    }
+    ntripCasterState = newState;
+    if (settings.debugNtripCaster && (!inMainMenu))
+    {
+        if (newState >= NTRIP_CASTER_STATE_MAX)
+        {
+            systemPrintf("Unknown NTRIP caster state: %d\r\n", ntripCasterState);
+            reportFatalError("Unknown NTRIP caster state");
+        }
+        else
+            systemPrintln(ntripCasterStateName[ntripCasterState]);
+    }
+}
+
+// Pass the complete RTCM messages to the rovers
+void ntripCasterSendRTCM(const uint8_t *data, uint16_t length)
+{
+    if (ntripCasterState == NTRIP_CASTER_STATE_RUNNING)
+        ntripCasterBroadcast(&ntripCaster, data, length);
+}
+
+// Start the NTRIP caster
+bool ntripCasterStart()
+{
+    double latitude;
+    double longitude;
+    IPAddress localIp;
+
+    NETWORK_DATA * network;
+    network = &networkData;
+    if (network)
+        localIp = networkGetIpAddress(network->type);
+
+    if (settings.debugNtripCaster && (!inMainMenu))
+        systemPrintln("NTRIP caster starting the server");
+
+    // Allocate the client array
+    if (!ntripCasterClients)
+    {
+        ntripCasterClients = (NTRIP_CASTER_CLIENT *)malloc(NTRIP_CASTER_MAX_CLIENTS * sizeof(*ntripCasterClients));
+        if (!ntripCasterClients)
+        {
+            systemPrintln("ERROR: Failed to allocate the NTRIP caster clients!");
+            return false;
+        }
+    }
+
+    // Build the sourcetable from the base location
+    latitude = 0;
+    longitude = 0;
+    if (settings.fixedBaseCoordinateType == COORD_TYPE_GEODETIC)
+    {
+        latitude = settings.fixedLat;
+        longitude = settings.fixedLong;
+    }
+    if (!ntripCasterInit(&ntripCaster, ntripCasterClients, NTRIP_CASTER_MAX_CLIENTS,
+                         settings.ntripCaster_MountPoint, settings.ntripCaster_User,
+                         settings.ntripCaster_UserPW, platformPrefix, latitude, longitude,
+                         ntripCasterNetworkRead, ntripCasterNetworkWrite, ntripCasterNetworkClose))
+    {
+        systemPrintln("ERROR: Invalid NTRIP caster mount point or credentials!");
+        return false;
+    }
+
+    // Start the NTRIP caster, the extra client connection is used to reject
+    // the rovers when all of the client entries are in use
+    if (ntripCasterServer == nullptr)
+        ntripCasterServer = networkServer(NETWORK_USER_NTRIP_CASTER, settings.ntripCaster_Port,
+                                          NTRIP_CASTER_MAX_CLIENTS + 1);
+    if (!ntripCasterServer)
+        return false;
+
+    ntripCasterServer->begin();
+    online.ntripCaster = true;
+
+    systemPrintf("NTRIP caster online, %d.%d.%d.%d:%d/%s\r\n",
+                 localIp[0], localIp[1], localIp[2], localIp[3],
+                 settings.ntripCaster_Port, settings.ntripCaster_MountPoint);
+    return true;
+}
+
+// Stop the NTRIP caster
+void ntripCasterStop()
+{
+    online.ntripCaster = false;
+
+    // Close the rover connections and free the RTCM buffers
+    if (ntripCasterState == NTRIP_CASTER_STATE_RUNNING)
+        ntripCasterCloseAll(&ntripCaster);
+
+    // Shutdown the NTRIP caster
+    if (ntripCasterServer != nullptr)
+    {
+        if (settings.debugNtripCaster && (!inMainMenu))
+            systemPrintln("NTRIP caster stopping");
+        ntripCasterServer->stop();
+        delete ntripCasterServer;
+        ntripCasterServer = nullptr;
+    }
+
+    // Stop using the network
+    if (ntripCasterState != NTRIP_CASTER_STATE_OFF)
+    {
+        networkUserClose(NETWORK_USER_NTRIP_CASTER);
+
+        // The NTRIP caster is now off
+        ntripCasterSetState(NTRIP_CASTER_STATE_OFF);
+        ntripCasterTimer = millis();
+    }
+}
+
+// Accept the new rover connections
+void ntripCasterAccept()
+{
+    P_NTRIP_CASTER_CLIENT client;
+    NetworkClient * networkClient;
+    NETWORK_DATA * network;
+
+    network = &networkData;
+    while (1)
+    {
+        // Use accept, not available, see pvtServerUpdate.  The accepted
+        // connection is stored in the server's entry for this client.
+        client = ntripCasterFreeClient(&ntripCaster);
+        Client * connection = ntripCasterServer->accept(client ? client->index : NTRIP_CASTER_MAX_CLIENTS);
+        if ((!connection) || (!*connection))
+            break;
+
+        // Reject the rover when all of the client entries are in use
+        if (!client)
+        {
+            connection->write((const uint8_t *)NTRIP_CASTER_FULL_RESPONSE, strlen(NTRIP_CASTER_FULL_RESPONSE));
+            connection->stop();
+            if (settings.debugNtripCaster && (!inMainMenu))
+                systemPrintln("NTRIP caster full, rover rejected");
+            break;
+        }
+
+        // Start processing the request
+        networkClient = new NetworkClient(connection, network->type);
+        if (!networkClient)
+        {
+            connection->stop();
+            break;
+        }
+        ntripCasterConnect(&ntripCaster, client, networkClient, millis());
+        if (settings.debugNtripCaster && (!inMainMenu))
+        {
+            IPAddress ipAddress = networkClient->remoteIP();
+            systemPrintf("NTRIP caster client %d connected to %d.%d.%d.%d\r\n", client->index,
+                         ipAddress[0], ipAddress[1], ipAddress[2], ipAddress[3]);
+        }
+    }
+}
+
+// Update the NTRIP caster state
+void ntripCasterUpdate()
+{
+    // Shutdown the NTRIP caster when the mode or setting changes
+    DMW_st(ntripCasterSetState, ntripCasterState);
+    if (NEQ_RTK_MODE(ntripCasterMode) || (!settings.enableNtripCaster))
+    {
+        if (ntripCasterState > NTRIP_CASTER_STATE_OFF)
+            ntripCasterStop();
+    }
+
+    /*
+        NTRIP Caster state machine
+
+                .---------------->NTRIP_CASTER_STATE_OFF
+                |                           |
+                | ntripCasterStop           | settings.enableNtripCaster
+                |                           |
+                |                           V
+                +<----------NTRIP_CASTER_STATE_NETWORK_STARTED
+                ^                           |
+                |                           | networkUserConnected
+                |                           |
+                |                           V
+                '---------------NTRIP_CASTER_STATE_RUNNING
+    */
+
+    switch (ntripCasterState)
+    {
+    default:
+        break;
+
+    // Wait until the NTRIP caster is enabled
+    case NTRIP_CASTER_STATE_OFF:
+        NETWORK_DATA * network;
+        network = &networkData;
+        if (EQ_RTK_MODE(ntripCasterMode) && settings.enableNtripCaster && network
+            && (!networkIsTypeConnected(network->type)))
+        {
+            if (networkUserOpen(NETWORK_USER_NTRIP_CASTER, NETWORK_TYPE_ACTIVE))
+            {
+                if (settings.debugNtripCaster && (!inMainMenu))
+                    systemPrintln("NTRIP caster starting the network");
+                ntripCasterSetState(NTRIP_CASTER_STATE_NETWORK_STARTED);
+            }
+        }
+        break;
+
+    // Wait until the network is connected
+    case NTRIP_CASTER_STATE_NETWORK_STARTED:
+        // Determine if the network has failed
+        if (networkIsShuttingDown(NETWORK_USER_NTRIP_CASTER))
+            ntripCasterStop();
+
+        // Wait for the network to connect to the media
+        else if (networkUserConnected(NETWORK_USER_NTRIP_CASTER))
+        {
+            // Delay before starting the NTRIP caster
+            if ((millis() - ntripCasterTimer) >= (1 * 1000))
+            {
+                ntripCasterTimer = millis();
+                if (ntripCasterStart())
+                    ntripCasterSetState(NTRIP_CASTER_STATE_RUNNING);
+            }
+        }
+        break;
+
+    // Handle the rover connections and send the RTCM data
+    case NTRIP_CASTER_STATE_RUNNING:
+        // Determine if the network has failed
+        if (networkIsShuttingDown(NETWORK_USER_NTRIP_CASTER))
+        {
+            if (settings.debugNtripCaster && (!inMainMenu))
+                systemPrintln("NTRIP caster initiating shutdown");
+            ntripCasterStop();
+            break;
+        }
+
+        ntripCasterAccept();
+        ntripCasterService(&ntripCaster, millis());
+        break;
+    }
+}
+
+// Display the NTRIP caster status
+void ntripCasterPrintStatus()
+{
+    if (settings.enableNtripCaster && EQ_RTK_MODE(ntripCasterMode))
+    {
+        systemPrintf("NTRIP Caster %s - %s:%d",
+                     (ntripCasterState == NTRIP_CASTER_STATE_RUNNING) ? "Running" : "Starting",
+                     settings.ntripCaster_MountPoint, settings.ntripCaster_Port);
+        if (ntripCasterState == NTRIP_CASTER_STATE_RUNNING)
+            systemPrintf(" Rovers: %d, Connections: %d, Rejected: %d, RTCM buffers: %d",
+                         ntripCasterStreamingClients(&ntripCaster), ntripCaster.connections,
+                         ntripCaster.rejected, ntripCaster.messagesAllocated);
+        systemPrintln();
+    }
+}
+
+// Verify the NTRIP caster tables
+void ntripCasterValidateTables()
+{
+    if (ntripCasterStateNameEntries != NTRIP_CASTER_STATE_MAX)
+        reportFatalError("Fix ntripCasterStateNameEntries to match NtripCasterStates");
+    if ((NTRIP_CASTER_MAX_CLIENTS + 1) > 255)
+        reportFatalError("Reduce NTRIP_CASTER_MAX_CLIENTS to fit in the NetworkServer");
+}
+
+#endif // COMPILE_NETWORK
@@ -77,6 +77,44 @@ NtripClient.ino
     * https://emlid.com/ntrip-caster/
     * http://rtk2go.com/
     * private SNIP NTRIP caster
+
+  NTRIP 2:
+
+    The NTRIP 2 request passes the rover's position in the Ntrip-GGA header
+    and asks the caster to keep the connection open.  Chunked responses are
+    decoded by ntripHttpDechunk before the RTCM data is passed to the GNSS.
+
+    After a good connection breaks or times out, the first reconnect is
+    made immediately using the caster address saved from that connection.
+    The network, the network client and the GGA messages are kept, so the
+    reconnect is limited by the TCP handshake instead of the DNS lookup and
+    the connection delay.  Later failures use the increasing connection
+    delays.  Tools/NTRIP_Caster.py provides a local caster that drops the
+    connections on request to test this path.
+
+  Receive path:
+
+    The state machine runs from loop() while ntripClientReadTask receives the
+    correction data.  The task removes the HTTP framing, passes the data to
+    the RTCM parser and passes each complete message with a valid CRC to the
+    correction arbiter (see Corrections.ino) as soon as it arrives, so the
+    corrections are not delayed by the display, battery and other loop()
+    processing.  The message is pushed to the GNSS when the NTRIP client is
+    the selected correction source.
+
+        NTRIP Caster
+             |
+             | ntripClientReadTask
+             |    ntripClientReceiveData: ntripHttpDechunk
+             |    gpsMessageParserProcessBuffer
+             |    ntripClientRtcmMessage: correctionsPushRtcm, rtcmStatsUpdate
+             v
+            ZED
+
+    The statistics for each RTCM message type (count, arrival interval, age
+    and latency from the message epoch to its arrival) are displayed by
+    ntripClientPrintStatus.  The latency uses the RTC, so it includes the
+    RTC error, typically about a millisecond after the time pulse sync.
 ------------------------------------------------------------------------------*/
 
 /*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
@@ -123,9 +161,6 @@ NtripClient.ino
 // Constants
 //----------------------------------------
 
-// Size of the credentials buffer in bytes
-static const int CREDENTIALS_BUFFER_SIZE = 512;
-
 // Give up connecting after this number of attempts
 // Connection attempts are throttled to increase the time between attempts
 // 30 attempts with 15 second increases will take almost two hours
@@ -140,8 +175,8 @@ static const uint32_t NTRIP_CLIENT_RECEIVE_DATA_TIMEOUT = 30 * 1000; // Millisec
 // Most incoming data is around 500 bytes but may be larger
 static const int RTCM_DATA_SIZE = 512 * 4;
 
-// NTRIP client server request buffer size
-static const int SERVER_BUFFER_SIZE = CREDENTIALS_BUFFER_SIZE + 3;
+// Wait this long for a GGA sentence to include in the NTRIP 2 request
+static const uint32_t NTRIP_CLIENT_GGA_TIMEOUT = 3 * 1000; // Milliseconds
 
 static const int NTRIPCLIENT_MS_BETWEEN_GGA = 5000; // 5s between transmission of GGA messages, if enabled
 
@@ -202,6 +237,31 @@ static uint32_t ntripClientStartTime;          // For calculating uptime
 // Throttle GGA transmission to Caster to 1 report every 5 seconds
 unsigned long lastGGAPush;
 
+// Newest GGA sentence from the GNSS, protected by ntripClientSemaphore
+static char ntripClientGga[100];
+static bool ntripClientGgaEnabled;      // GNSS is sending GPGGA to newGPGGA
+static uint32_t ntripClientGgaTimer;    // Time GPGGA was enabled
+
+// Caster response header and chunked data decoding
+static NTRIP_HTTP_RESPONSE ntripClientHttpResponse;
+static NTRIP_HTTP_CHUNK ntripClientChunk;
+
+// Caster address from the last connection, used to skip the DNS lookup
+static IPAddress ntripClientCasterIp;
+static char ntripClientCasterIpHost[sizeof(settings.ntripClient_CasterHost)];
+
+static uint32_t ntripClientConnectTime;        // Milliseconds to connect and receive the response
+static int ntripClientFastReconnects;          // Reconnects made without delay
+
+// The receive task frames the RTCM messages and pushes them to the GNSS
+static TaskHandle_t ntripClientReadTaskHandle;
+static volatile uint32_t ntripClientConnections; // Tells the task to discard the previous connection's data
+static PARSE_STATE ntripClientParse = {gpsMessageParserFirstByte, ntripClientRtcmMessage, "NTRIP Client"};
+static RTCM_STATS ntripClientRtcmStats;
+static uint32_t ntripClientNotPushed;          // RTCM messages discarded by the arbiter or not accepted by the GNSS
+static uint32_t ntripClientOtherMessages;      // NMEA and UBX messages received from the caster
+static volatile bool ntripClientReadTaskStopRequest;
+
 //----------------------------------------
 // NTRIP Client Routines
 //----------------------------------------
@@ -228,7 +288,32 @@ bool ntripClientConnect()
                      settings.ntripClient_CasterHost,
                      settings.ntripClient_CasterPort);
 
-    int connectResponse = ntripClient->connect(settings.ntripClient_CasterHost, settings.ntripClient_CasterPort);
+    // Reuse the caster address from the previous connection
+    int connectResponse = 0;
+    ntripClientConnectTime = millis();
+    if (((uint32_t)ntripClientCasterIp)
+        && (strcmp(ntripClientCasterIpHost, settings.ntripClient_CasterHost) == 0))
+    {
+        connectResponse = ntripClient->connect(ntripClientCasterIp, settings.ntripClient_CasterPort);
+        if (connectResponse < 1)
+        {
+            // The caster may have moved, look up the address again
+            if (settings.debugNtripClientState)
+                systemPrintf("NTRIP Client connection to %s failed, looking up %s\r\n",
+                             ntripClientCasterIp.toString().c_str(), settings.ntripClient_CasterHost);
+            ntripClientCasterIp = IPAddress((uint32_t)0);
+        }
+    }
+    if (connectResponse < 1)
+    {
+        connectResponse = ntripClient->connect(settings.ntripClient_CasterHost, settings.ntripClient_CasterPort);
+        if (connectResponse >= 1)
+        {
+            // Save the caster address for the next connection
+            ntripClientCasterIp = ntripClient->remoteIP();
+            strcpy(ntripClientCasterIpHost, settings.ntripClient_CasterHost);
+        }
+    }
 
     if (connectResponse < 1)
     {
@@ -239,69 +324,105 @@ bool ntripClientConnect()
         return false;
     }
 
-    // Set up the server request (GET)
-    char serverRequest[SERVER_BUFFER_SIZE];
+    // Identify the product and firmware version
+    char agent[64];
     int length;
-    snprintf(serverRequest, SERVER_BUFFER_SIZE, "GET /%s HTTP/1.0\r\nUser-Agent: NTRIP SparkFun_RTK_%s_",
-             settings.ntripClient_MountPoint, platformPrefix);
-    length = strlen(serverRequest);
-    getFirmwareVersion(&serverRequest[length], SERVER_BUFFER_SIZE - 2 - length, false);
-    length = strlen(serverRequest);
-    serverRequest[length++] = '\r';
-    serverRequest[length++] = '\n';
-    serverRequest[length++] = 0;
-
-    // Set up the credentials
-    char credentials[CREDENTIALS_BUFFER_SIZE];
-    if (strlen(settings.ntripClient_CasterUser) == 0)
-    {
-        strncpy(credentials, "Accept: */*\r\nConnection: close\r\n", sizeof(credentials) - 1);
-    }
-    else
-    {
-        // Pass base64 encoded user:pw
-        char userCredentials[sizeof(settings.ntripClient_CasterUser) + sizeof(settings.ntripClient_CasterUserPW) +
-                             1]; // The ':' takes up a spot
-        snprintf(userCredentials, sizeof(userCredentials), "%s:%s", settings.ntripClient_CasterUser,
-                 settings.ntripClient_CasterUserPW);
+    snprintf(agent, sizeof(agent), "SparkFun_RTK_%s_", platformPrefix);
+    length = strlen(agent);
+    getFirmwareVersion(&agent[length], sizeof(agent) - length, false);
 
-        if (settings.debugNtripClientState)
-        {
-            systemPrint("NTRIP Client sending credentials: ");
-            systemPrintln(userCredentials);
-        }
+    // Pass the position to an NTRIP 2 caster in the request
+    char gga[sizeof(ntripClientGga)];
+    gga[0] = 0;
+    if (settings.ntripClient_TransmitGGA)
+        ntripClientCopyGga(gga, sizeof(gga));
 
-        // Encode with ESP32 built-in library
-        base64 b;
-        String strEncodedCredentials = b.encode(userCredentials);
-        char encodedCredentials[strEncodedCredentials.length() + 1];
-        strEncodedCredentials.toCharArray(encodedCredentials,
-                                          sizeof(encodedCredentials)); // Convert String to char array
-
-        snprintf(credentials, sizeof(credentials), "Authorization: Basic %s\r\n", encodedCredentials);
+    // Set up the server request (GET)
+    NTRIP_HTTP_REQUEST request;
+    memset(&request, 0, sizeof(request));
+    request.version = settings.ntripClient_NtripVersion;
+    request.host = settings.ntripClient_CasterHost;
+    request.port = settings.ntripClient_CasterPort;
+    request.mountPoint = settings.ntripClient_MountPoint;
+    request.agent = agent;
+    request.user = settings.ntripClient_CasterUser;
+    request.password = settings.ntripClient_CasterUserPW;
+    request.gga = gga;
+
+    char serverRequest[NTRIP_HTTP_REQUEST_SIZE];
+    length = ntripHttpClientRequest(&request, serverRequest, sizeof(serverRequest));
+    if (!length)
+    {
+        systemPrintln("ERROR: NTRIP Client request too long!");
+        ntripClient->stop();
+        return false;
     }
 
-    // Add the encoded credentials to the server request
-    strncat(serverRequest, credentials, SERVER_BUFFER_SIZE - 1);
-    strncat(serverRequest, "\r\n", SERVER_BUFFER_SIZE - 1);
-
     if (settings.debugNtripClientState)
     {
-        systemPrint("NTRIP Client serverRequest size: ");
-        systemPrint(strlen(serverRequest));
-        systemPrint(" of ");
-        systemPrint(sizeof(serverRequest));
-        systemPrintln(" bytes available");
+        systemPrintf("NTRIP Client serverRequest size: %d of %d bytes available\r\n",
+                     length, (int)sizeof(serverRequest));
         systemPrintln("NTRIP Client sending server request: ");
         systemPrintln(serverRequest);
     }
 
+    // Prepare for the response
+    ntripHttpResponseInit(&ntripClientHttpResponse);
+    ntripHttpDechunkInit(&ntripClientChunk);
+    ntripClientConnections++;
+
     // Send the server request
-    ntripClient->write((const uint8_t *)serverRequest, strlen(serverRequest));
+    ntripClient->write((const uint8_t *)serverRequest, length);
     ntripClientTimer = millis();
     return true;
 }
 
+// Copy the newest GGA sentence, the copy is empty when no sentence is available
+void ntripClientCopyGga(char *gga, size_t ggaSize)
+{
+    gga[0] = 0;
+    if (xSemaphoreTake(ntripClientSemaphore(), 10 / portTICK_PERIOD_MS) == pdPASS)
+    {
+        snprintf(gga, ggaSize, "%s", ntripClientGga);
+        xSemaphoreGive(ntripClientSemaphore());
+    }
+}
+
+// Enable the GPGGA messages used for the Ntrip-GGA header and the GGA
+// sentences sent to the caster
+void ntripClientEnableGga()
+{
+    // Set the Main Talker ID to "GP". The NMEA GGA messages will be GPGGA instead of GNGGA
+    theGNSS.setVal8(UBLOX_CFG_NMEA_MAINTALKERID, 1);
+    theGNSS.setNMEAGPGGAcallbackPtr(&newGPGGA); // Set up the callback for GPGGA
+
+    float measurementFrequency = (1000.0 / settings.measurementRate) / settings.navigationRate;
+    if (measurementFrequency < 0.2)
+        measurementFrequency = 0.2; // 0.2Hz * 5 = 1 measurement every 5 seconds
+    log_d("Adjusting GGA setting to %f", measurementFrequency);
+    theGNSS.setVal8(
+        UBLOX_CFG_MSGOUT_NMEA_ID_GGA_I2C,
+        measurementFrequency); // Enable GGA over I2C. Tell the module to output GGA every second
+
+    // Discard the position from any previous connection
+    if (xSemaphoreTake(ntripClientSemaphore(), 10 / portTICK_PERIOD_MS) == pdPASS)
+    {
+        ntripClientGga[0] = 0;
+        xSemaphoreGive(ntripClientSemaphore());
+    }
+    ntripClientGgaEnabled = true;
+    ntripClientGgaTimer = millis();
+}
+
+// Serialize the access to ntripClient and ntripClientGga, the GGA writes and
+// the socket shutdown must not overlap the reads by ntripClientReadTask
+SemaphoreHandle_t ntripClientSemaphore()
+{
+    static SemaphoreHandle_t reentrant = xSemaphoreCreateMutex();  // Create the mutex
+
+    return reentrant;
+}
+
 // Determine if another connection is possible or if the limit has been reached
 bool ntripClientConnectLimitReached()
 {
@@ -352,6 +473,12 @@ bool ntripClientConnectLimitReached()
     return limitReached;
 }
 
+// Determine if the NTRIP client is receiving corrections from the caster
+bool ntripClientIsConnected()
+{
+    return (ntripClientState == NTRIP_CLIENT_CONNECTED);
+}
+
 // Print the NTRIP client state summary
 void ntripClientPrintStateSummary()
 {
@@ -418,8 +545,48 @@ void ntripClientPrintStatus()
         milliseconds %= MILLISECONDS_IN_A_SECOND;
 
         systemPrint(" Uptime: ");
-        systemPrintf("%d %02d:%02d:%02d.%03lld (Reconnects: %d)\r\n",
-                     days, hours, minutes, seconds, milliseconds, ntripClientConnectionAttemptsTotal);
+        systemPrintf("%d %02d:%02d:%02d.%03lld (Reconnects: %d, fast: %d)\r\n",
+                     days, hours, minutes, seconds, milliseconds, ntripClientConnectionAttemptsTotal,
+                     ntripClientFastReconnects);
+
+        // Display the connection details
+        if (ntripClientState == NTRIP_CLIENT_CONNECTED)
+            systemPrintf("    NTRIP %d%s%s, %s, connected in %d ms\r\n",
+                         ntripClientHttpResponse.version,
+                         ntripClientHttpResponse.chunked ? ", chunked" : "",
+                         ntripClientHttpResponse.keepAlive ? ", keep-alive" : "",
+                         ntripClientCasterIp.toString().c_str(), ntripClientConnectTime);
+
+        // Display the RTCM statistics
+        if (ntripClientState == NTRIP_CLIENT_CONNECTED)
+            ntripClientPrintRtcmStats();
+    }
+}
+
+// Print the statistics for each RTCM message type received from the caster
+void ntripClientPrintRtcmStats()
+{
+    RTCM_STATS_MESSAGE *entry;
+    int index;
+    uint32_t seconds;
+
+    seconds = (millis() - ntripClientRtcmStats.startMsec) / 1000;
+    systemPrintf("    RTCM: %d messages, %d bytes in %d seconds, %d bad CRC, %d not pushed, %d other, %d untracked\r\n",
+                 ntripClientRtcmStats.messages, ntripClientRtcmStats.bytes, seconds, ntripClientParse.invalidRtcmCrcs,
+                 ntripClientNotPushed, ntripClientOtherMessages, ntripClientRtcmStats.untracked);
+    if (!ntripClientRtcmStats.types)
+        return;
+    systemPrintln("    Message  Count   Bytes  Interval      Age   Latency: Last    Min    Max    Avg");
+    for (index = 0; index < ntripClientRtcmStats.types; index++)
+    {
+        entry = &ntripClientRtcmStats.type[index];
+        systemPrintf("    %7d %6d %7d %7d ms %5d ms", entry->message, entry->count, entry->bytes, entry->intervalMsec,
+                     millis() - entry->arrivalMsec);
+        if (entry->latencyCount)
+            systemPrintf("   %9d %6d %6d %6d ms\r\n", entry->latencyMsec, entry->latencyMinMsec,
+                         entry->latencyMaxMsec, (int32_t)(entry->latencyTotalMsec / entry->latencyCount));
+        else
+            systemPrintln();
     }
 }
 
@@ -429,22 +596,179 @@ int ntripClientReceiveDataAvailable()
     return ntripClient->available();
 }
 
-// Read the response from the NTRIP client
-void ntripClientResponse(char *response, size_t maxLength)
+// Read the RTCM data from the caster and remove the HTTP framing.  Returns the
+// number of data bytes placed in the buffer.
+int ntripClientReceiveData(uint8_t *buffer, int length)
+{
+    SemaphoreHandle_t semaphore = ntripClientSemaphore();
+    int rtcmCount = 0;
+
+    if (xSemaphoreTake(semaphore, 10 / portTICK_PERIOD_MS) != pdPASS)
+        return 0;
+    if ((ntripClientState == NTRIP_CLIENT_CONNECTED) && ntripClient && (ntripClientReceiveDataAvailable() > 0)
+        && (ntripClientChunk.state < NTRIP_HTTP_CHUNK_END))
+    {
+        rtcmCount = ntripClient->read(buffer, length);
+        if (rtcmCount > 0)
+        {
+            // Restart the NTRIP receive data timer
+            ntripClientTimer = millis();
+
+            // Remove the chunk framing
+            if (ntripClientHttpResponse.chunked)
+                rtcmCount = ntripHttpDechunk(&ntripClientChunk, buffer, rtcmCount);
+            else
+                rtcmCount = ntripHttpSkipLineEnds(&ntripClientHttpResponse, buffer, rtcmCount);
+        }
+    }
+    xSemaphoreGive(semaphore);
+    return rtcmCount;
+}
+
+// Receive the correction data from the caster, frame the RTCM messages and
+// push each complete message to the GNSS
+void ntripClientReadTask(void *e)
+{
+    uint32_t connection;
+    static uint8_t rtcmData[RTCM_DATA_SIZE];
+    int rtcmCount;
+
+    connection = ntripClientConnections - 1;
+    while (!ntripClientReadTaskStopRequest)
+    {
+        // Display an alive message
+        if (PERIODIC_DISPLAY(PD_TASK_NTRIP_CLIENT_READ))
+        {
+            PERIODIC_CLEAR(PD_TASK_NTRIP_CLIENT_READ);
+            systemPrintln("ntripClientReadTask running");
+        }
+
+        // Receive data from the NTRIP Caster
+        rtcmCount = ntripClientReceiveData(rtcmData, sizeof(rtcmData));
+        if (rtcmCount <= 0)
+        {
+            // Wait for more data
+            feedWdt();
+            continue;
+        }
+
+        // Discard the partial message and statistics from the previous connection
+        if (connection != ntripClientConnections)
+        {
+            connection = ntripClientConnections;
+            ntripClientParse.length = 0;
+            ntripClientParse.computeCrc = false;
+            ntripClientParse.invalidRtcmCrcs = 0;
+            ntripClientParse.state = gpsMessageParserFirstByte;
+            rtcmStatsInit(&ntripClientRtcmStats, millis());
+            ntripClientNotPushed = 0;
+            ntripClientOtherMessages = 0;
+        }
+
+        // Push the complete RTCM messages to the GNSS
+        gpsMessageParserProcessBuffer(&ntripClientParse, rtcmData, rtcmCount);
+
+        if (PERIODIC_DISPLAY(PD_NTRIP_CLIENT_DATA) && (!inMainMenu))
+        {
+            PERIODIC_CLEAR(PD_NTRIP_CLIENT_DATA);
+            systemPrintf("NTRIP Client received %d RTCM bytes\r\n", rtcmCount);
+        }
+
+        if (settings.enableTaskReports == true)
+            systemPrintf("ntripClientReadTask High watermark: %d\r\n", uxTaskGetStackHighWaterMark(nullptr));
+    }
+
+    // Stop the task
+    ntripClientReadTaskHandle = nullptr;
+    vTaskDelete(nullptr);
+}
+
+// Start the NTRIP client read task, returns true when the task is running
+bool ntripClientReadTaskStart()
+{
+    if (ntripClientReadTaskHandle)
+        return true;
+
+    // Allocate the RTCM parse buffer
+    if ((!ntripClientParse.buffer) && (!(ntripClientParse.buffer = (uint8_t *)malloc(PARSE_BUFFER_LENGTH))))
+        return false;
+
+    ntripClientReadTaskStopRequest = false;
+    xTaskCreatePinnedToCore(ntripClientReadTask,                  // Function to call
+                            "ntripClientRead",                    // Just for humans
+                            ntripClientReadTaskStackSize,         // Stack Size
+                            nullptr,                              // Task input parameter
+                            settings.ntripClientReadTaskPriority, // Priority
+                            &ntripClientReadTaskHandle,           // Task handle
+                            settings.ntripClientReadTaskCore);    // Core where task should run, 0=core, 1=Arduino
+    return (ntripClientReadTaskHandle != nullptr);
+}
+
+// Stop the NTRIP client read task.  The task exits by itself so that a
+// message push to the GNSS is never interrupted.
+void ntripClientReadTaskStop()
 {
-    char *responseEnd;
+    if (!ntripClientReadTaskHandle)
+        return;
+    ntripClientReadTaskStopRequest = true;
+    while (ntripClientReadTaskHandle)
+        delay(1);
+    free(ntripClientParse.buffer);
+    ntripClientParse.buffer = nullptr;
+}
+
+// Pass each complete RTCM message to the correction arbiter and update the
+// statistics
+void ntripClientRtcmMessage(PARSE_STATE *parse, uint8_t type)
+{
+    uint32_t arrivalMsec;
+    RTCM_STATS_MESSAGE *entry;
+    uint32_t epochMsec;
+    int32_t gpsTowMsec;
+    int leap;
+    bool pushed;
+
+    // Only the RTCM messages are passed to the GNSS
+    arrivalMsec = millis();
+    if (type != SENTENCE_TYPE_RTCM)
+    {
+        ntripClientOtherMessages++;
+        return;
+    }
+
+    // Push the message to the GNSS when the NTRIP client is the selected
+    // correction source
+    pushed = correctionsPushRtcm(CORRECTION_SOURCE_NTRIP_CLIENT, parse->buffer, parse->length);
+    if (!pushed)
+        ntripClientNotPushed++;
+    netIncomingRTCM = true;
 
-    // Make sure that we can zero terminate the response
-    responseEnd = &response[maxLength - 1];
+    // Update the statistics for this message type
+    gpsTowMsec = correctionsGpsTow();
+    leap = leapSeconds ? leapSeconds : LOG_INDEX_DEFAULT_LEAP_SECONDS;
+    entry = rtcmStatsUpdate(&ntripClientRtcmStats, parse->buffer, parse->length, arrivalMsec, gpsTowMsec, leap);
 
-    // Read bytes from the caster and store them
-    while ((response < responseEnd) && (ntripClientReceiveDataAvailable() > 0))
+    if (settings.debugNtripClientRtcm && (!inMainMenu))
     {
-        *response++ = ntripClient->read();
+        if (entry && (gpsTowMsec != RTCM_STATS_NO_TIME)
+            && rtcmStatsEpoch(parse->buffer, parse->length, leap, &epochMsec))
+            systemPrintf("NTRIP Client RTCM %d, %d bytes, latency %d ms, %s\r\n", parse->message,
+                         parse->length, entry->latencyMsec, pushed ? "pushed to ZED" : "not pushed");
+        else
+            systemPrintf("NTRIP Client RTCM %d, %d bytes, %s\r\n", parse->message, parse->length,
+                         pushed ? "pushed to ZED" : "not pushed");
     }
+}
 
-    // Zero terminate the response
-    *response = '\0';
+// Read the response header from the caster one byte at a time, leaving the
+// RTCM data in the receive buffer.  Returns true when the header is complete
+// or when the caster closed the connection after sending part of a header.
+bool ntripClientReceiveResponse()
+{
+    while ((!ntripClientHttpResponse.complete) && (ntripClientReceiveDataAvailable() > 0))
+        ntripHttpResponseParse(&ntripClientHttpResponse, ntripClient->read());
+    return ntripClientHttpResponse.complete
+           || (ntripClientHttpResponse.lines && (!ntripClient->connected()));
 }
 
 // Restart the NTRIP client
@@ -453,7 +777,31 @@ void ntripClientRestart()
     // Save the previous uptime value
     if (ntripClientState == NTRIP_CLIENT_CONNECTED)
         ntripClientStartTime = ntripClientTimer - ntripClientStartTime;
-    ntripClientConnectLimitReached();
+
+    // Use the increasing connection delays after a reconnect fails or when
+    // the network is not available
+    if (ntripClientConnectionAttempts || (!ntripClient) || (!networkUserConnected(NETWORK_USER_NTRIP_CLIENT)))
+    {
+        ntripClientConnectLimitReached();
+        return;
+    }
+
+    // Reconnect immediately after a good connection, keep the network, the
+    // network client and the GGA messages
+    xSemaphoreTake(ntripClientSemaphore(), portMAX_DELAY);
+    ntripClient->stop();
+    xSemaphoreGive(ntripClientSemaphore());
+    online.ntripClient = false;
+    netIncomingRTCM = false;
+    ntripClientConnectionAttempts++;
+    ntripClientConnectionAttemptsTotal++;
+    ntripClientFastReconnects++;
+    ntripClientConnectionAttemptTimeout = 0;
+    ntripClientTimer = millis();
+    if (settings.debugNtripClientState)
+        systemPrintf("NTRIP Client reconnecting to %s:%d\r\n",
+                     settings.ntripClient_CasterHost, settings.ntripClient_CasterPort);
+    ntripClientSetState(NTRIP_CLIENT_NETWORK_CONNECTED);
 }
 
 // Update the state of the NTRIP client state machine
@@ -502,6 +850,9 @@ void ntripClientStop(bool shutdown)
 {
     if (ntripClient)
     {
+        // Wait for ntripClientReadTask to finish the read
+        xSemaphoreTake(ntripClientSemaphore(), portMAX_DELAY);
+
         // Break the NTRIP client connection if necessary
         if (ntripClient->connected())
             ntripClient->stop();
@@ -509,9 +860,14 @@ void ntripClientStop(bool shutdown)
         // Free the NTRIP client resources
         delete ntripClient;
         ntripClient = nullptr;
+        xSemaphoreGive(ntripClientSemaphore());
         reportHeapNow(settings.debugNtripClientState);
     }
 
+    // The read task is not needed while the NTRIP client is off
+    if (shutdown)
+        ntripClientReadTaskStop();
+
     // Increase timeouts if we started the network
     if (ntripClientState > NTRIP_CLIENT_ON)
     {
@@ -529,6 +885,7 @@ void ntripClientStop(bool shutdown)
         theGNSS.setVal8(UBLOX_CFG_NMEA_MAINTALKERID, 3); // Return talker ID to GNGGA after NTRIP Client set to GPGGA
         theGNSS.setNMEAGPGGAcallbackPtr(nullptr);        // Remove callback
     }
+    ntripClientGgaEnabled = false;
 
     // Determine the next NTRIP client state
     online.ntripClient = false;
@@ -613,8 +970,15 @@ void ntripClientUpdate()
         // If GGA transmission is not enabled, start connecting to NTRIP Caster
         else if ((!settings.ntripClient_TransmitGGA) || (fixType >= 3) && (fixType <= 5))
         {
+            // Start the GGA messages before the connection so that the
+            // NTRIP 2 request is able to include the position
+            if (settings.ntripClient_TransmitGGA && (!ntripClientGgaEnabled))
+                ntripClientEnableGga();
+
             // Delay before opening the NTRIP client connection
-            if ((millis() - ntripClientTimer) >= ntripClientConnectionAttemptTimeout)
+            if (((millis() - ntripClientTimer) >= ntripClientConnectionAttemptTimeout)
+                && ((settings.ntripClient_NtripVersion != 2) || (!settings.ntripClient_TransmitGGA)
+                    || ntripClientGga[0] || ((millis() - ntripClientGgaTimer) >= NTRIP_CLIENT_GGA_TIMEOUT)))
             {
                 // Open connection to NTRIP caster service
                 if (!ntripClientConnect())
@@ -643,8 +1007,7 @@ void ntripClientUpdate()
             ntripClientStop(true); // Note: was ntripClientRestart();
 
         // Check for no response from the caster service
-        else if (ntripClientReceiveDataAvailable() <
-                 strlen("ICY 200 OK")) // Wait until at least a few bytes have arrived
+        else if (!ntripClientReceiveResponse())
         {
             // Check for response timeout
             if (millis() - ntripClientTimer > NTRIP_CLIENT_RESPONSE_TIMEOUT)
@@ -657,8 +1020,7 @@ void ntripClientUpdate()
         else
         {
             // Caster web service responded
-            char response[512];
-            ntripClientResponse(&response[0], sizeof(response));
+            const char *response = ntripClientHttpResponse.text;
 
             if (settings.debugNtripClientState)
                 systemPrintf("Caster Response: %s\r\n", response);
@@ -666,7 +1028,7 @@ void ntripClientUpdate()
                 log_d("Caster Response: %s", response);
 
             // Look for various responses
-            if (strstr(response, "200") != nullptr) //'200' found
+            if (ntripClientHttpResponse.status == 200)
             {
                 // We got a response, now check it for possible errors
                 if (strcasestr(response, "banned") != nullptr)
@@ -683,7 +1045,7 @@ void ntripClientUpdate()
 
                     ntripClientConnectLimitReached(); //Re-attempted after a period of time. Shuts down NTRIP Client if limit reached.
                 }
-                else if (strcasestr(response, "SOURCETABLE") != nullptr)
+                else if (ntripClientHttpResponse.sourceTable)
                 {
                     systemPrintf("Caster may not have mountpoint %s. Caster responded with problem: %s\r\n",
                                  settings.ntripClient_MountPoint, response);
@@ -694,7 +1056,7 @@ void ntripClientUpdate()
                 else
                 {
                     // We successfully connected
-                    // Timeout receiving NTRIP data, retry the NTRIP client connection
+                    ntripClientConnectTime = millis() - ntripClientConnectTime;
                     if (online.rtc && online.gnss)
                     {
                         int hours;
@@ -706,42 +1068,34 @@ void ntripClientUpdate()
                         seconds -= hours * SECONDS_IN_AN_HOUR;
                         minutes = seconds / SECONDS_IN_A_MINUTE;
                         seconds -= minutes * SECONDS_IN_A_MINUTE;
-                        systemPrintf("NTRIP Client connected to %s:%d at %d:%02d:%02d\r\n",
+                        systemPrintf("NTRIP Client connected to %s:%d at %d:%02d:%02d in %d ms\r\n",
                                      settings.ntripClient_CasterHost, settings.ntripClient_CasterPort, hours, minutes,
-                                     seconds);
+                                     seconds, ntripClientConnectTime);
                     }
                     else
-                        systemPrintf("NTRIP Client connected to %s:%d\r\n", settings.ntripClient_CasterHost,
-                                     settings.ntripClient_CasterPort);
+                        systemPrintf("NTRIP Client connected to %s:%d in %d ms\r\n", settings.ntripClient_CasterHost,
+                                     settings.ntripClient_CasterPort, ntripClientConnectTime);
 
                     // Connection is now open, start the NTRIP receive data timer
                     ntripClientTimer = millis();
 
+                    // Force immediate transmission of GGA message
                     if (settings.ntripClient_TransmitGGA == true)
+                        lastGGAPush = millis() - NTRIPCLIENT_MS_BETWEEN_GGA;
+
+                    // Receive the RTCM data in ntripClientReadTask
+                    if (!ntripClientReadTaskStart())
                     {
-                        // Set the Main Talker ID to "GP". The NMEA GGA messages will be GPGGA instead of GNGGA
-                        theGNSS.setVal8(UBLOX_CFG_NMEA_MAINTALKERID, 1);
-                        theGNSS.setNMEAGPGGAcallbackPtr(&newGPGGA); // Set up the callback for GPGGA
-
-                        float measurementFrequency = (1000.0 / settings.measurementRate) / settings.navigationRate;
-                        if (measurementFrequency < 0.2)
-                            measurementFrequency = 0.2; // 0.2Hz * 5 = 1 measurement every 5 seconds
-                        log_d("Adjusting GGA setting to %f", measurementFrequency);
-                        theGNSS.setVal8(
-                            UBLOX_CFG_MSGOUT_NMEA_ID_GGA_I2C,
-                            measurementFrequency); // Enable GGA over I2C. Tell the module to output GGA every second
-
-                        lastGGAPush =
-                            millis() - NTRIPCLIENT_MS_BETWEEN_GGA; // Force immediate transmission of GGA message
+                        systemPrintln("ERROR: Failed to start the NTRIP Client read task!");
+                        ntripClientShutdown();
+                        break;
                     }
-
-                    // We don't use a task because we use I2C hardware (and don't have a semphore).
                     online.ntripClient = true;
                     ntripClientStartTime = millis();
                     ntripClientSetState(NTRIP_CLIENT_CONNECTED);
                 }
             }
-            else if (strstr(response, "401") != nullptr)
+            else if (ntripClientHttpResponse.status == 401)
             {
                 // Look for '401 Unauthorized'
                 systemPrintf(
@@ -793,65 +1147,43 @@ void ntripClientUpdate()
                     systemPrintln("NTRIP Client resetting connection attempt counter and timeout");
             }
 
-            // Check for timeout receiving NTRIP data
-            if (ntripClientReceiveDataAvailable() == 0)
+            // Check for timeout receiving NTRIP data, ntripClientReadTask
+            // restarts the timer when data arrives
+            uint32_t receiveTimer = ntripClientTimer;
+            if ((millis() - receiveTimer) > NTRIP_CLIENT_RECEIVE_DATA_TIMEOUT)
             {
-                // Don't fail during retransmission attempts
-                if ((millis() - ntripClientTimer) > NTRIP_CLIENT_RECEIVE_DATA_TIMEOUT)
+                // Timeout receiving NTRIP data, retry the NTRIP client connection
+                if (online.rtc && online.gnss)
                 {
-                    // Timeout receiving NTRIP data, retry the NTRIP client connection
-                    if (online.rtc && online.gnss)
-                    {
-                        int hours;
-                        int minutes;
-                        int seconds;
-
-                        seconds = rtc.getLocalEpoch() % SECONDS_IN_A_DAY;
-                        hours = seconds / SECONDS_IN_AN_HOUR;
-                        seconds -= hours * SECONDS_IN_AN_HOUR;
-                        minutes = seconds / SECONDS_IN_A_MINUTE;
-                        seconds -= minutes * SECONDS_IN_A_MINUTE;
-                        systemPrintf("NTRIP Client timeout receiving data at %d:%02d:%02d\r\n",
-                                     hours, minutes, seconds);
-                    }
-                    else
-                        systemPrintln("NTRIP Client timeout receiving data");
-                    ntripClientRestart();
+                    int hours;
+                    int minutes;
+                    int seconds;
+
+                    seconds = rtc.getLocalEpoch() % SECONDS_IN_A_DAY;
+                    hours = seconds / SECONDS_IN_AN_HOUR;
+                    seconds -= hours * SECONDS_IN_AN_HOUR;
+                    minutes = seconds / SECONDS_IN_A_MINUTE;
+                    seconds -= minutes * SECONDS_IN_A_MINUTE;
+                    systemPrintf("NTRIP Client timeout receiving data at %d:%02d:%02d\r\n",
+                                 hours, minutes, seconds);
                 }
+                else
+                    systemPrintln("NTRIP Client timeout receiving data");
+                ntripClientRestart();
+                break;
             }
-            else
-            {
-                // Receive data from the NTRIP Caster
-                uint8_t rtcmData[RTCM_DATA_SIZE];
-                size_t rtcmCount = 0;
 
-                // Collect any available RTCM data
-                if (ntripClientReceiveDataAvailable() > 0)
-                {
-                    rtcmCount = ntripClient->read(rtcmData, sizeof(rtcmData));
-                    if (rtcmCount)
-                    {
-                        // Restart the NTRIP receive data timer
-                        ntripClientTimer = millis();
-
-                        // Record the arrival of RTCM from the WiFi connection. This resets the RTCM timeout used on the L-Band.
-                        rtcmLastPacketReceived = millis();
-
-                        // Push RTCM to GNSS module over I2C / SPI
-                        theGNSS.pushRawData(rtcmData, rtcmCount);
-                        netIncomingRTCM = true;
-
-                        if ((settings.debugNtripClientRtcm || PERIODIC_DISPLAY(PD_NTRIP_CLIENT_DATA))
-                            && (!inMainMenu))
-                        {
-                            PERIODIC_CLEAR(PD_NTRIP_CLIENT_DATA);
-                            systemPrintf("NTRIP Client received %d RTCM bytes, pushed to ZED\r\n", rtcmCount);
-                        }
-                    }
-                }
+            // The caster ended the chunked data stream
+            if (ntripClientChunk.state >= NTRIP_HTTP_CHUNK_END)
+            {
+                systemPrintf("NTRIP Client %s\r\n", (ntripClientChunk.state == NTRIP_HTTP_CHUNK_END)
+                             ? "data stream ended by caster" : "received invalid chunked data");
+                ntripClientRestart();
+                break;
             }
 
-            // Now that the ntripClient->read is complete, write GPGGA if needed and available. See RTK Everywhere issue #695
+            // Write GPGGA if needed and available, pushGPGGA and ntripClientReadTask
+            // serialize the access to ntripClient. See RTK Everywhere issue #695
             pushGPGGA(nullptr);
         }
         break;
@@ -882,20 +1214,18 @@ void newGPGGA(NMEA_GGA_data_t *nmeaData)
 // We must not push to the Caster while we are reading data from the Caster
 // See RTK Everywhere Issue #695
 // pushGPGGA is called by processUart1Message from gnssReadTask
-// ntripClient->read is called by ntripClientUpdate and ntripClientResponse from networkUpdate from loop
+// ntripClient->read is called by ntripClientReadTask and by ntripClientReceiveResponse from loop
 // We need to make sure processUart1Message doesn't gatecrash
 // If ggaData is provided, store it. If ggaData is nullptr, try to push it
 static void pushGPGGA(char *ggaData)
 {
-    static char storedGPGGA[100];
-
-    static SemaphoreHandle_t reentrant = xSemaphoreCreateMutex();  // Create the mutex
+    SemaphoreHandle_t reentrant = ntripClientSemaphore();
 
     if (xSemaphoreTake(reentrant, 10 / portTICK_PERIOD_MS) == pdPASS)
     {
         if (ggaData)
         {
-            snprintf(storedGPGGA, sizeof(storedGPGGA), "%s", ggaData);
+            snprintf(ntripClientGga, sizeof(ntripClientGga), "%s", ggaData);
             xSemaphoreGive(reentrant);
             return;
         }
@@ -914,12 +1244,12 @@ static void pushGPGGA(char *ggaData)
                     if ((settings.debugNtripClientRtcm || PERIODIC_DISPLAY(PD_NTRIP_CLIENT_GGA)) && !inMainMenu)
                     {
                         PERIODIC_CLEAR(PD_NTRIP_CLIENT_GGA);
-                        systemPrintf("NTRIP Client pushing GGA to server: %s", (const char *)storedGPGGA);
+                        systemPrintf("NTRIP Client pushing GGA to server: %s", (const char *)ntripClientGga);
                     }
 
                     // Push our current GGA sentence to caster
-                    if (strlen(storedGPGGA) > 0)
-                        ntripClient->write((const uint8_t *)storedGPGGA, strlen(storedGPGGA));
+                    if (strlen(ntripClientGga) > 0)
+                        ntripClient->write((const uint8_t *)ntripClientGga, strlen(ntripClientGga));
                 }
             }
         }
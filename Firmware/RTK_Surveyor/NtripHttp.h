@@ -0,0 +1,104 @@
+/*------------------------------------------------------------------------------
+NtripHttp.h
+
+  Constant, type and routine declarations for the HTTP layer shared by the
+  NTRIP client, NTRIP server and embedded NTRIP caster.  The routines in
+  NtripHttp.ino do not depend upon the Arduino environment and are also built
+  by the programs in the Tools directory.
+------------------------------------------------------------------------------*/
+
+#ifndef __NTRIP_HTTP_H__
+#define __NTRIP_HTTP_H__
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+//----------------------------------------
+// Constants
+//----------------------------------------
+
+#define NTRIP_HTTP_REQUEST_SIZE 640     // Longest request header sent to a caster
+#define NTRIP_HTTP_RESPONSE_SIZE 512    // Response header bytes saved for display
+#define NTRIP_HTTP_CHUNK_OVERHEAD 10    // Chunk framing: hex length, CR LF, data, CR LF
+
+// Final chunk sent by an NTRIP 2 server before closing the connection
+#define NTRIP_HTTP_LAST_CHUNK "0\r\n\r\n"
+
+// Chunk decoder states
+enum NTRIP_HTTP_CHUNK_STATE
+{
+    NTRIP_HTTP_CHUNK_SIZE = 0,      // Receiving the hex chunk length
+    NTRIP_HTTP_CHUNK_EXTENSION,     // Skipping the chunk extension
+    NTRIP_HTTP_CHUNK_DATA,          // Receiving the chunk data
+    NTRIP_HTTP_CHUNK_DATA_CR,       // Waiting for the CR following the data
+    NTRIP_HTTP_CHUNK_DATA_LF,       // Waiting for the LF following the data
+    NTRIP_HTTP_CHUNK_TRAILER,       // Skipping the trailer after the last chunk
+    NTRIP_HTTP_CHUNK_END,           // Last chunk received, the stream is done
+    NTRIP_HTTP_CHUNK_ERROR,         // Invalid chunk framing
+};
+
+//----------------------------------------
+// Types
+//----------------------------------------
+
+// Values used to build the request header sent to the caster
+typedef struct _NTRIP_HTTP_REQUEST
+{
+    uint8_t version;               // NTRIP version, 1 or 2
+    const char *host;              // Caster host name, used for the Host header
+    uint16_t port;                 // Caster port
+    const char *mountPoint;        // Mount point without the leading slash
+    const char *agent;             // Product name and firmware version
+    const char *user;              // Caster user, empty when not needed
+    const char *password;          // Caster user's password
+    const char *mountPointPassword; // NTRIP 1 server SOURCE password
+    const char *gga;               // NMEA GGA sentence for the client, NULL when not sent
+} NTRIP_HTTP_REQUEST;
+
+// Response header received from the caster
+typedef struct _NTRIP_HTTP_RESPONSE
+{
+    char text[NTRIP_HTTP_RESPONSE_SIZE]; // Zero terminated status line and headers
+    uint16_t length;               // Number of bytes in text
+    uint16_t lineLength;           // Bytes received in the current line
+    uint16_t lineStart;            // Offset of the current line in text
+    uint16_t lines;                // Lines received
+    uint16_t status;               // HTTP status code, zero when not valid
+    uint8_t version;               // NTRIP version, 2 when Ntrip-Version: Ntrip/2.0
+    bool chunked;                  // Transfer-Encoding: chunked
+    bool keepAlive;                // Connection stays open after the response
+    bool sourceTable;              // Caster returned the sourcetable
+    bool complete;                 // End of the header was received
+    bool skipLineEnds;             // Discard CR and LF before the NTRIP 1 data
+    int32_t contentLength;         // Content-Length value, -1 when not specified
+} NTRIP_HTTP_RESPONSE;
+
+// HTTP chunked transfer encoding decoder
+typedef struct _NTRIP_HTTP_CHUNK
+{
+    uint8_t state;                 // NTRIP_HTTP_CHUNK_STATE value
+    uint8_t digits;                // Hex digits in the chunk length
+    uint32_t remaining;            // Data bytes remaining in the chunk
+    uint32_t chunks;               // Chunks received
+} NTRIP_HTTP_CHUNK;
+
+//----------------------------------------
+// NTRIP HTTP routines
+//----------------------------------------
+
+bool ntripHttpBase64(const char *data, char *output, size_t outputSize);
+int ntripHttpChunk(uint8_t *buffer, size_t bufferSize, const uint8_t *data, uint16_t length);
+int32_t ntripHttpDechunk(NTRIP_HTTP_CHUNK *chunk, uint8_t *buffer, int32_t length);
+void ntripHttpDechunkInit(NTRIP_HTTP_CHUNK *chunk);
+int ntripHttpClientRequest(const NTRIP_HTTP_REQUEST *request, char *buffer, size_t bufferSize);
+int ntripHttpServerRequest(const NTRIP_HTTP_REQUEST *request, char *buffer, size_t bufferSize);
+void ntripHttpResponseInit(NTRIP_HTTP_RESPONSE *response);
+bool ntripHttpResponseParse(NTRIP_HTTP_RESPONSE *response, uint8_t data);
+int32_t ntripHttpSkipLineEnds(NTRIP_HTTP_RESPONSE *response, uint8_t *buffer, int32_t length);
+
+#endif // __NTRIP_HTTP_H__
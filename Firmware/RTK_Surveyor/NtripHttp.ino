@@ -0,0 +1,468 @@
+/*------------------------------------------------------------------------------
+NtripHttp.ino
+
+  HTTP layer shared by the NTRIP client, NTRIP server and embedded NTRIP
+  caster.  NTRIP 1 uses the ICY and SOURCE variations of HTTP/1.0 while
+  NTRIP 2 is plain HTTP/1.1:
+
+    * The client sends GET with Ntrip-Version: Ntrip/2.0 and may pass its
+      position to the caster in the Ntrip-GGA header so that a network or
+      virtual reference station caster can select the corrections before
+      the first GGA sentence is written to the connection.
+
+    * The server sends POST and writes the RTCM data using HTTP chunked
+      transfer encoding.  A zero length chunk ends the stream.
+
+    * The caster may send the RTCM data to the client using chunked transfer
+      encoding.  The chunk framing is removed in place by ntripHttpDechunk
+      before the data is passed to the GNSS.
+
+  Both request types ask the caster to keep the connection open.  The
+  response header is parsed one byte at a time so that the data following
+  the header remains in the network client's receive buffer.
+------------------------------------------------------------------------------*/
+
+//----------------------------------------
+// Support routines
+//----------------------------------------
+
+// Append formatted text to the buffer, returns false if the buffer is too small
+bool ntripHttpAppend(char *buffer, size_t bufferSize, size_t *offset, const char *format, ...)
+{
+    va_list args;
+    int length;
+
+    va_start(args, format);
+    length = vsnprintf(&buffer[*offset], bufferSize - *offset, format, args);
+    va_end(args);
+    if ((length < 0) || ((size_t)length >= (bufferSize - *offset)))
+        return false;
+    *offset += length;
+    return true;
+}
+
+// Append the Basic authorization header, returns false if the buffer is too small
+bool ntripHttpAppendAuthorization(const NTRIP_HTTP_REQUEST *request, char *buffer, size_t bufferSize, size_t *offset)
+{
+    char credentials[104];
+    char encodedCredentials[((sizeof(credentials) + 2) / 3) * 4 + 1];
+
+    if ((!request->user) || (!request->user[0]))
+        return true;
+    if (snprintf(credentials, sizeof(credentials), "%s:%s", request->user,
+                 request->password ? request->password : "") >= (int)sizeof(credentials))
+        return false;
+    if (!ntripHttpBase64(credentials, encodedCredentials, sizeof(encodedCredentials)))
+        return false;
+    return ntripHttpAppend(buffer, bufferSize, offset, "Authorization: Basic %s\r\n", encodedCredentials);
+}
+
+// Encode the data using base64, returns false if the output buffer is too small
+bool ntripHttpBase64(const char *data, char *output, size_t outputSize)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    uint32_t bits;
+    size_t index;
+    size_t length;
+
+    length = strlen(data);
+    if (outputSize < (((length + 2) / 3) * 4 + 1))
+        return false;
+    for (index = 0; index < length; index += 3)
+    {
+        bits = ((uint8_t)data[index]) << 16;
+        if ((index + 1) < length)
+            bits |= ((uint8_t)data[index + 1]) << 8;
+        if ((index + 2) < length)
+            bits |= (uint8_t)data[index + 2];
+        *output++ = alphabet[(bits >> 18) & 0x3f];
+        *output++ = alphabet[(bits >> 12) & 0x3f];
+        *output++ = ((index + 1) < length) ? alphabet[(bits >> 6) & 0x3f] : '=';
+        *output++ = ((index + 2) < length) ? alphabet[bits & 0x3f] : '=';
+    }
+    *output = 0;
+    return true;
+}
+
+// Determine if the header line starts with the name, returns the value or NULL
+const char *ntripHttpHeader(const char *line, const char *name)
+{
+    size_t nameLength;
+
+    nameLength = strlen(name);
+    if (strncasecmp(line, name, nameLength))
+        return NULL;
+    line += nameLength;
+    while ((*line == ' ') || (*line == '\t'))
+        line++;
+    return line;
+}
+
+// Process a complete status or header line
+void ntripHttpResponseLine(NTRIP_HTTP_RESPONSE *response, const char *line)
+{
+    const char *value;
+
+    // Process the status line
+    if (response->lines == 0)
+    {
+        // NTRIP 1 response, the RTCM data immediately follows the status line.
+        // Some casters send an empty line first which must not reach the GNSS
+        if ((value = ntripHttpHeader(line, "ICY")))
+        {
+            response->status = atoi(value);
+            response->version = 1;
+            response->keepAlive = true;
+            response->complete = true;
+            response->skipLineEnds = true;
+        }
+
+        // NTRIP 1 sourcetable response
+        else if ((value = ntripHttpHeader(line, "SOURCETABLE")))
+        {
+            response->status = atoi(value);
+            response->version = 1;
+            response->sourceTable = true;
+        }
+
+        // HTTP response, HTTP/1.1 connections remain open by default
+        else if ((value = ntripHttpHeader(line, "HTTP/1.")) && (value[0] >= '0') && (value[0] <= '9'))
+        {
+            response->keepAlive = (value[0] != '0');
+            value = strchr(value, ' ');
+            if (value)
+                response->status = atoi(value);
+            response->version = 1;
+        }
+        return;
+    }
+
+    // Process the header lines
+    if ((value = ntripHttpHeader(line, "Ntrip-Version:")))
+    {
+        if (strncasecmp(value, "Ntrip/2.", 8) == 0)
+            response->version = 2;
+    }
+    else if ((value = ntripHttpHeader(line, "Transfer-Encoding:")))
+        response->chunked = (strncasecmp(value, "chunked", 7) == 0);
+    else if ((value = ntripHttpHeader(line, "Connection:")))
+    {
+        if (strncasecmp(value, "close", 5) == 0)
+            response->keepAlive = false;
+        else if (strncasecmp(value, "keep-alive", 10) == 0)
+            response->keepAlive = true;
+    }
+    else if ((value = ntripHttpHeader(line, "Content-Type:")))
+    {
+        if (strncasecmp(value, "gnss/sourcetable", 16) == 0)
+            response->sourceTable = true;
+    }
+    else if ((value = ntripHttpHeader(line, "Content-Length:")))
+        response->contentLength = atol(value);
+}
+
+//----------------------------------------
+// NTRIP HTTP routines
+//----------------------------------------
+
+// Build a chunk containing the data, returns the number of bytes placed in
+// the buffer or zero if the buffer is too small
+int ntripHttpChunk(uint8_t *buffer, size_t bufferSize, const uint8_t *data, uint16_t length)
+{
+    int headerLength;
+
+    headerLength = snprintf((char *)buffer, bufferSize, "%X\r\n", length);
+    if ((headerLength < 0) || ((size_t)(headerLength + length + 2) > bufferSize))
+        return 0;
+    memcpy(&buffer[headerLength], data, length);
+    buffer[headerLength + length] = '\r';
+    buffer[headerLength + length + 1] = '\n';
+    return headerLength + length + 2;
+}
+
+// Remove the chunk framing in place, returns the number of data bytes left
+// in the buffer.  The stream is done when chunk->state reaches
+// NTRIP_HTTP_CHUNK_END and is broken when it reaches NTRIP_HTTP_CHUNK_ERROR.
+int32_t ntripHttpDechunk(NTRIP_HTTP_CHUNK *chunk, uint8_t *buffer, int32_t length)
+{
+    uint8_t byte;
+    uint32_t bytes;
+    const uint8_t *data;
+    const uint8_t *end;
+    uint8_t *output;
+
+    data = buffer;
+    end = &buffer[length];
+    output = buffer;
+    while ((data < end) && (chunk->state < NTRIP_HTTP_CHUNK_END))
+    {
+        // Move the chunk data
+        if (chunk->state == NTRIP_HTTP_CHUNK_DATA)
+        {
+            bytes = end - data;
+            if (bytes > chunk->remaining)
+                bytes = chunk->remaining;
+            memmove(output, data, bytes);
+            output += bytes;
+            data += bytes;
+            chunk->remaining -= bytes;
+            if (!chunk->remaining)
+                chunk->state = NTRIP_HTTP_CHUNK_DATA_CR;
+            continue;
+        }
+
+        // Process the framing
+        byte = *data++;
+        switch (chunk->state)
+        {
+        case NTRIP_HTTP_CHUNK_SIZE:
+            if (((byte >= '0') && (byte <= '9'))
+                || (((byte | 0x20) >= 'a') && ((byte | 0x20) <= 'f')))
+            {
+                // Limit the chunk size
+                if (chunk->remaining >> 24)
+                {
+                    chunk->state = NTRIP_HTTP_CHUNK_ERROR;
+                    break;
+                }
+                chunk->remaining = (chunk->remaining << 4)
+                                 | ((byte <= '9') ? (byte - '0') : ((byte | 0x20) - 'a' + 10));
+                chunk->digits += 1;
+                break;
+            }
+            if ((byte == ';') || (byte == ' ') || (byte == '\t'))
+            {
+                chunk->state = NTRIP_HTTP_CHUNK_EXTENSION;
+                break;
+            }
+            if (byte == '\r')
+                break;
+            if (byte != '\n')
+            {
+                chunk->state = NTRIP_HTTP_CHUNK_ERROR;
+                break;
+            }
+            // Fall through
+
+        case NTRIP_HTTP_CHUNK_EXTENSION:
+            if (byte != '\n')
+                break;
+
+            // End of the chunk size line
+            if (!chunk->digits)
+                chunk->state = NTRIP_HTTP_CHUNK_ERROR;
+            else if (chunk->remaining)
+            {
+                chunk->chunks += 1;
+                chunk->state = NTRIP_HTTP_CHUNK_DATA;
+            }
+            else
+                chunk->state = NTRIP_HTTP_CHUNK_TRAILER;
+            break;
+
+        case NTRIP_HTTP_CHUNK_DATA_CR:
+            if (byte == '\r')
+                chunk->state = NTRIP_HTTP_CHUNK_DATA_LF;
+            else if (byte == '\n')
+            {
+                chunk->digits = 0;
+                chunk->state = NTRIP_HTTP_CHUNK_SIZE;
+            }
+            else
+                chunk->state = NTRIP_HTTP_CHUNK_ERROR;
+            break;
+
+        case NTRIP_HTTP_CHUNK_DATA_LF:
+            if (byte == '\n')
+            {
+                chunk->digits = 0;
+                chunk->state = NTRIP_HTTP_CHUNK_SIZE;
+            }
+            else
+                chunk->state = NTRIP_HTTP_CHUNK_ERROR;
+            break;
+
+        // Skip the trailer lines, remaining counts the bytes in the line
+        case NTRIP_HTTP_CHUNK_TRAILER:
+            if (byte == '\n')
+            {
+                if (!chunk->remaining)
+                    chunk->state = NTRIP_HTTP_CHUNK_END;
+                chunk->remaining = 0;
+            }
+            else if (byte != '\r')
+                chunk->remaining += 1;
+            break;
+        }
+    }
+    return output - buffer;
+}
+
+// Initialize the chunk decoder
+void ntripHttpDechunkInit(NTRIP_HTTP_CHUNK *chunk)
+{
+    memset(chunk, 0, sizeof(*chunk));
+}
+
+// Build the client request, returns the request length or zero if the
+// buffer is too small
+int ntripHttpClientRequest(const NTRIP_HTTP_REQUEST *request, char *buffer, size_t bufferSize)
+{
+    size_t ggaLength;
+    size_t offset;
+
+    offset = 0;
+    if (request->version == 2)
+    {
+        if (!ntripHttpAppend(buffer, bufferSize, &offset,
+                             "GET /%s HTTP/1.1\r\n"
+                             "Host: %s:%d\r\n"
+                             "Ntrip-Version: Ntrip/2.0\r\n"
+                             "User-Agent: NTRIP %s\r\n",
+                             request->mountPoint, request->host, request->port, request->agent))
+            return 0;
+        if (!ntripHttpAppendAuthorization(request, buffer, bufferSize, &offset))
+            return 0;
+
+        // Pass the position to the caster without the CR LF
+        if (request->gga && request->gga[0])
+        {
+            ggaLength = strcspn(request->gga, "\r\n");
+            if (!ntripHttpAppend(buffer, bufferSize, &offset, "Ntrip-GGA: %.*s\r\n",
+                                 (int)ggaLength, request->gga))
+                return 0;
+        }
+        if (!ntripHttpAppend(buffer, bufferSize, &offset, "Connection: keep-alive\r\n\r\n"))
+            return 0;
+        return offset;
+    }
+
+    // NTRIP 1 request
+    if (!ntripHttpAppend(buffer, bufferSize, &offset,
+                         "GET /%s HTTP/1.0\r\n"
+                         "User-Agent: NTRIP %s\r\n",
+                         request->mountPoint, request->agent))
+        return 0;
+    if ((!request->user) || (!request->user[0]))
+    {
+        if (!ntripHttpAppend(buffer, bufferSize, &offset, "Accept: */*\r\nConnection: close\r\n"))
+            return 0;
+    }
+    else if (!ntripHttpAppendAuthorization(request, buffer, bufferSize, &offset))
+        return 0;
+    if (!ntripHttpAppend(buffer, bufferSize, &offset, "\r\n"))
+        return 0;
+    return offset;
+}
+
+// Build the server request, returns the request length or zero if the
+// buffer is too small
+int ntripHttpServerRequest(const NTRIP_HTTP_REQUEST *request, char *buffer, size_t bufferSize)
+{
+    size_t offset;
+
+    offset = 0;
+    if (request->version == 2)
+    {
+        if (!ntripHttpAppend(buffer, bufferSize, &offset,
+                             "POST /%s HTTP/1.1\r\n"
+                             "Host: %s:%d\r\n"
+                             "Ntrip-Version: Ntrip/2.0\r\n"
+                             "User-Agent: NTRIP %s\r\n",
+                             request->mountPoint, request->host, request->port, request->agent))
+            return 0;
+        if (!ntripHttpAppendAuthorization(request, buffer, bufferSize, &offset))
+            return 0;
+        if (!ntripHttpAppend(buffer, bufferSize, &offset,
+                             "Content-Type: gnss/data\r\n"
+                             "Transfer-Encoding: chunked\r\n"
+                             "Connection: keep-alive\r\n"
+                             "\r\n"))
+            return 0;
+        return offset;
+    }
+
+    // NTRIP 1 request
+    if (!ntripHttpAppend(buffer, bufferSize, &offset,
+                         "SOURCE %s /%s\r\n"
+                         "Source-Agent: NTRIP %s\r\n"
+                         "\r\n",
+                         request->mountPointPassword, request->mountPoint, request->agent))
+        return 0;
+    return offset;
+}
+
+// Initialize the response parser
+void ntripHttpResponseInit(NTRIP_HTTP_RESPONSE *response)
+{
+    memset(response, 0, sizeof(*response));
+    response->contentLength = -1;
+}
+
+// Parse the next byte of the response header, returns true when the end of
+// the header is reached
+bool ntripHttpResponseParse(NTRIP_HTTP_RESPONSE *response, uint8_t data)
+{
+    if (response->complete)
+        return true;
+
+    // The lines end with LF, ignore the CR
+    if (data == '\r')
+        return false;
+
+    // Save the data for the line parser and the display
+    if (data != '\n')
+    {
+        if (response->length < (sizeof(response->text) - 1))
+        {
+            response->text[response->length++] = data;
+            response->text[response->length] = 0;
+        }
+        response->lineLength += 1;
+        return false;
+    }
+
+    // An empty line ends the header, skip any empty lines before the status
+    if (!response->lineLength)
+    {
+        if (response->lines)
+            response->complete = true;
+        return response->complete;
+    }
+
+    // Process the line, the end of the line is lost when the buffer is full
+    ntripHttpResponseLine(response, &response->text[response->lineStart]);
+    response->lines += 1;
+    response->lineLength = 0;
+    if (response->length < (sizeof(response->text) - 2))
+    {
+        response->text[response->length++] = '\r';
+        response->text[response->length++] = '\n';
+        response->text[response->length] = 0;
+    }
+    response->lineStart = response->length;
+    return response->complete;
+}
+
+// Remove the CR and LF bytes that follow an NTRIP 1 ICY status line from the
+// start of the data, returns the number of data bytes remaining in the buffer
+int32_t ntripHttpSkipLineEnds(NTRIP_HTTP_RESPONSE *response, uint8_t *buffer, int32_t length)
+{
+    int32_t offset;
+
+    if (!response->skipLineEnds)
+        return length;
+
+    // Locate the first data byte
+    for (offset = 0; offset < length; offset++)
+        if ((buffer[offset] != '\r') && (buffer[offset] != '\n'))
+        {
+            response->skipLineEnds = false;
+            break;
+        }
+
+    // Move the data to the start of the buffer
+    length -= offset;
+    memmove(buffer, &buffer[offset], length);
+    return length;
+}
@@ -77,6 +77,16 @@ NtripServer.ino
     * https://emlid.com/ntrip-caster/
     * http://rtk2go.com/
     * private SNIP NTRIP caster
+
+  NTRIP 2:
+
+    The NTRIP 2 server authenticates with the caster user name and password
+    and sends the RTCM data to the caster using HTTP chunked transfer
+    encoding, each ntripServerSendRTCM call becomes a single chunk.  A zero
+    length chunk ends the stream before the connection is closed.
+
+    As with the NTRIP client, the first reconnect after a good connection is
+    made immediately using the saved caster address.
 ------------------------------------------------------------------------------*/
 
 /*=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
@@ -179,6 +189,9 @@ const RtkMode_t ntripServerMode = RTK_MODE_BASE_FIXED;
 // NTRIP Servers
 static NTRIP_SERVER_DATA ntripServerArray[NTRIP_SERVER_MAX];
 
+// Authorization response from the NTRIP casters
+static NTRIP_HTTP_RESPONSE ntripServerHttpResponse[NTRIP_SERVER_MAX];
+
 //----------------------------------------
 // NTRIP Server Routines
 //----------------------------------------
@@ -187,8 +200,7 @@ static NTRIP_SERVER_DATA ntripServerArray[NTRIP_SERVER_MAX];
 bool ntripServerConnectCaster(int serverIndex)
 {
     NTRIP_SERVER_DATA * ntripServer = &ntripServerArray[serverIndex];
-    const int SERVER_BUFFER_SIZE = 512;
-    char serverBuffer[SERVER_BUFFER_SIZE];
+    char serverBuffer[NTRIP_HTTP_REQUEST_SIZE];
 
     // Remove any http:// or https:// prefix from host name
     char hostname[51];
@@ -207,33 +219,76 @@ bool ntripServerConnectCaster(int serverIndex)
                      settings.ntripServer_CasterHost[serverIndex],
                      settings.ntripServer_CasterPort[serverIndex]);
 
+    // Reuse the caster address from the previous connection
+    bool connected = false;
+    ntripServer->connectTime = millis();
+    if (((uint32_t)ntripServer->casterIp)
+        && (strcmp(ntripServer->casterIpHost, settings.ntripServer_CasterHost[serverIndex]) == 0))
+    {
+        connected = ntripServer->networkClient->connect(ntripServer->casterIp,
+                                                        settings.ntripServer_CasterPort[serverIndex]);
+        if (!connected)
+            // The caster may have moved, look up the address again
+            ntripServer->casterIp = IPAddress((uint32_t)0);
+    }
+
     // Attempt a connection to the NTRIP caster
-    if (!ntripServer->networkClient->connect(settings.ntripServer_CasterHost[serverIndex],
-                                             settings.ntripServer_CasterPort[serverIndex]))
+    if (!connected)
     {
-        if (settings.debugNtripServerState)
-            systemPrintf("NTRIP Server %d connection to NTRIP caster %s:%d failed\r\n",
-                         serverIndex,
-                         settings.ntripServer_CasterHost[serverIndex],
-                         settings.ntripServer_CasterPort[serverIndex]);
-        return false;
+        if (!ntripServer->networkClient->connect(settings.ntripServer_CasterHost[serverIndex],
+                                                 settings.ntripServer_CasterPort[serverIndex]))
+        {
+            if (settings.debugNtripServerState)
+                systemPrintf("NTRIP Server %d connection to NTRIP caster %s:%d failed\r\n",
+                             serverIndex,
+                             settings.ntripServer_CasterHost[serverIndex],
+                             settings.ntripServer_CasterPort[serverIndex]);
+            return false;
+        }
+
+        // Save the caster address for the next connection
+        ntripServer->casterIp = ntripServer->networkClient->remoteIP();
+        strcpy(ntripServer->casterIpHost, settings.ntripServer_CasterHost[serverIndex]);
     }
 
     if (settings.debugNtripServerState)
         systemPrintf("NTRIP Server %d sending authorization credentials\r\n", serverIndex);
 
+    // Identify the product and firmware version
+    char agent[64];
+    int length;
+    snprintf(agent, sizeof(agent), "SparkFun_RTK_%s_", platformPrefix);
+    length = strlen(agent);
+    getFirmwareVersion(&agent[length], sizeof(agent) - length, false);
+
     // Build the authorization credentials message
     //  * Mount point
     //  * Password
     //  * Agent
-    snprintf(serverBuffer, SERVER_BUFFER_SIZE, "SOURCE %s /%s\r\nSource-Agent: NTRIP SparkFun_RTK_%s/\r\n\r\n",
-             settings.ntripServer_MountPointPW[serverIndex],
-             settings.ntripServer_MountPoint[serverIndex], platformPrefix);
-    int length = strlen(serverBuffer);
-    getFirmwareVersion(&serverBuffer[length], sizeof(serverBuffer) - length, false);
+    NTRIP_HTTP_REQUEST request;
+    memset(&request, 0, sizeof(request));
+    request.version = (settings.ntripServer_NtripVersion[serverIndex] == 2) ? 2 : 1;
+    request.host = settings.ntripServer_CasterHost[serverIndex];
+    request.port = settings.ntripServer_CasterPort[serverIndex];
+    request.mountPoint = settings.ntripServer_MountPoint[serverIndex];
+    request.agent = agent;
+    request.user = settings.ntripServer_CasterUser[serverIndex];
+    request.password = settings.ntripServer_CasterUserPW[serverIndex];
+    request.mountPointPassword = settings.ntripServer_MountPointPW[serverIndex];
+    length = ntripHttpServerRequest(&request, serverBuffer, sizeof(serverBuffer));
+    if (!length)
+    {
+        systemPrintf("ERROR: NTRIP Server %d request too long!\r\n", serverIndex);
+        ntripServer->networkClient->stop();
+        return false;
+    }
+    ntripServer->version = request.version;
+
+    // Prepare for the authorization response
+    ntripHttpResponseInit(&ntripServerHttpResponse[serverIndex]);
 
     // Send the authorization credentials to the NTRIP caster
-    ntripServer->networkClient->write((const uint8_t *)serverBuffer, strlen(serverBuffer));
+    ntripServer->networkClient->write((const uint8_t *)serverBuffer, length);
     return true;
 }
 
@@ -357,15 +412,26 @@ void ntripServerPrintStatus (int serverIndex)
         milliseconds %= MILLISECONDS_IN_A_SECOND;
 
         systemPrint(" Uptime: ");
-        systemPrintf("%d %02d:%02d:%02d.%03lld (Reconnects: %d)\r\n",
-                     days, hours, minutes, seconds, milliseconds, ntripServer->connectionAttemptsTotal);
+        systemPrintf("%d %02d:%02d:%02d.%03lld (Reconnects: %d, fast: %d)\r\n",
+                     days, hours, minutes, seconds, milliseconds, ntripServer->connectionAttemptsTotal,
+                     ntripServer->fastReconnects);
+        if (ntripServer->state == NTRIP_SERVER_CASTING)
+            systemPrintf("    NTRIP %d%s, %s, connected in %d ms\r\n", ntripServer->version,
+                         (ntripServer->version == 2) ? ", chunked" : "",
+                         ntripServer->casterIp.toString().c_str(), ntripServer->connectTime);
+        if (settings.ntripServer_RtcmFilter[serverIndex][0])
+            systemPrintf("    RTCM filter: %s, %d messages filtered\r\n",
+                         settings.ntripServer_RtcmFilter[serverIndex], ntripServer->filteredMessages);
     }
 }
 
-// This function gets called as each RTCM byte comes in
-void ntripServerProcessRTCM(int serverIndex, uint8_t incoming)
+// This function gets called with the complete RTCM messages, each call results
+// in a single write to the NTRIP caster.  Returns true when the write rate was
+// displayed.
+bool ntripServerSendRTCM(int serverIndex, const uint8_t *data, uint16_t length)
 {
     NTRIP_SERVER_DATA * ntripServer = &ntripServerArray[serverIndex];
+    bool displayed = false;
 
     if (ntripServer->state == NTRIP_SERVER_CASTING)
     {
@@ -379,7 +445,6 @@ void ntripServerProcessRTCM(int serverIndex, uint8_t incoming)
                 || PERIODIC_DISPLAY(PD_NTRIP_SERVER_DATA)) && (!settings.enableRtcmMessageChecking)
                 && (!inMainMenu) && ntripServer->bytesSent)
             {
-                PERIODIC_CLEAR(PD_NTRIP_SERVER_DATA);
                 printTimeStamp();
                 //         1         2         3
                 // 123456789012345678901234567890
@@ -387,8 +452,19 @@ void ntripServerProcessRTCM(int serverIndex, uint8_t incoming)
                 struct tm timeinfo = rtc.getTimeStruct();
                 char timestamp[30];
                 strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &timeinfo);
-                systemPrintf("    Tx%d RTCM: %s.%03ld, %d bytes sent\r\n", serverIndex, timestamp, rtc.getMillis(), ntripServer->zedBytesSent);
+
+                // Compute the write rate since the last display
+                uint32_t milliseconds = currentMilliseconds - ntripServer->writeStartMillis;
+                if (milliseconds == 0)
+                    milliseconds = 1;
+                systemPrintf("    Tx%d RTCM: %s.%03ld, %d bytes sent, %d writes/sec, %d bytes/write\r\n",
+                             serverIndex, timestamp, rtc.getMillis(), ntripServer->zedBytesSent,
+                             (ntripServer->writes * 1000) / milliseconds,
+                             ntripServer->writes ? ntripServer->zedBytesSent / ntripServer->writes : 0);
                 ntripServer->zedBytesSent = 0;
+                ntripServer->writes = 0;
+                ntripServer->writeStartMillis = currentMilliseconds;
+                displayed = true;
             }
             ntripServer->previousMilliseconds = currentMilliseconds;
         }
@@ -402,11 +478,48 @@ void ntripServerProcessRTCM(int serverIndex, uint8_t incoming)
             ntripServer->bytesSent = 0;
         }
 
-        if (ntripServer->networkClient->connected())
+        // Remove the filtered messages
+        if (settings.ntripServer_RtcmFilter[serverIndex][0])
+        {
+            static uint8_t filteredData[sizeof(rtcmFrameBuffer)];
+            uint16_t filteredLength = 0;
+            uint16_t offset = 0;
+
+            while ((offset < length) && (filteredLength < sizeof(filteredData)))
+            {
+                uint16_t messageLength = rtcmMessageLength(&data[offset], length - offset);
+                if (messageLength > (length - offset))
+                    messageLength = length - offset;
+                if ((messageLength > 4)
+                    && rtcmMessageFiltered(settings.ntripServer_RtcmFilter[serverIndex],
+                                           (data[offset + 3] << 4) | (data[offset + 4] >> 4)))
+                    ntripServer->filteredMessages++;
+                else
+                {
+                    if (messageLength > (sizeof(filteredData) - filteredLength))
+                        messageLength = sizeof(filteredData) - filteredLength;
+                    memcpy(&filteredData[filteredLength], &data[offset], messageLength);
+                    filteredLength += messageLength;
+                }
+                offset += messageLength;
+            }
+            data = filteredData;
+            length = filteredLength;
+        }
+
+        if (length && ntripServer->networkClient->connected())
         {
-            ntripServer->networkClient->write(incoming); // Send this byte to socket
-            ntripServer->bytesSent++;
-            ntripServer->zedBytesSent++;
+            // Send the messages to socket, NTRIP 2 sends the messages as a single chunk
+            if (ntripServer->version == 2)
+            {
+                static uint8_t chunk[sizeof(rtcmFrameBuffer) + NTRIP_HTTP_CHUNK_OVERHEAD];
+                ntripServer->networkClient->write(chunk, ntripHttpChunk(chunk, sizeof(chunk), data, length));
+            }
+            else
+                ntripServer->networkClient->write(data, length);
+            ntripServer->bytesSent += length;
+            ntripServer->zedBytesSent += length;
+            ntripServer->writes++;
             ntripServer->timer = millis();
             netOutgoingRTCM = true;
         }
@@ -416,25 +529,20 @@ void ntripServerProcessRTCM(int serverIndex, uint8_t incoming)
     else if (ntripServer->state == NTRIP_SERVER_WAIT_GNSS_DATA)
     {
         ntripServerSetState(ntripServer, NTRIP_SERVER_CONNECTING);
-        rtcmParsingState = RTCM_TRANSPORT_STATE_WAIT_FOR_PREAMBLE_D3;
     }
+    return displayed;
 }
 
-// Read the authorization response from the NTRIP caster
-void ntripServerResponse(int serverIndex, char *response, size_t maxLength)
+// Read the authorization response from the NTRIP caster, returns true when
+// the response header is complete or the caster closed the connection
+bool ntripServerResponse(int serverIndex)
 {
     NTRIP_SERVER_DATA * ntripServer = &ntripServerArray[serverIndex];
-    char *responseEnd;
-
-    // Make sure that we can zero terminate the response
-    responseEnd = &response[maxLength - 1];
+    NTRIP_HTTP_RESPONSE * response = &ntripServerHttpResponse[serverIndex];
 
-    // Read bytes from the caster and store them
-    while ((response < responseEnd) && ntripServer->networkClient->available())
-        *response++ = ntripServer->networkClient->read();
-
-    // Zero terminate the response
-    *response = '\0';
+    while ((!response->complete) && ntripServer->networkClient->available())
+        ntripHttpResponseParse(response, ntripServer->networkClient->read());
+    return response->complete || (response->lines && (!ntripServer->networkClient->connected()));
 }
 
 // Restart the NTRIP server
@@ -445,7 +553,30 @@ void ntripServerRestart(int serverIndex)
     // Save the previous uptime value
     if (ntripServer->state == NTRIP_SERVER_CASTING)
         ntripServer->startTime = ntripServer->timer - ntripServer->startTime;
-    ntripServerConnectLimitReached(serverIndex);
+
+    // Use the increasing connection delays after a reconnect fails or when
+    // the network is not available
+    if (ntripServer->connectionAttempts || (!ntripServer->networkClient)
+        || (!networkUserConnected(NETWORK_USER_NTRIP_SERVER + serverIndex)))
+    {
+        ntripServerConnectLimitReached(serverIndex);
+        return;
+    }
+
+    // Reconnect immediately after a good connection, keep the network and
+    // the network client
+    ntripServer->networkClient->stop();
+    online.ntripServer[serverIndex] = false;
+    ntripServer->connectionAttempts++;
+    ntripServer->connectionAttemptsTotal++;
+    ntripServer->fastReconnects++;
+    ntripServer->connectionAttemptTimeout = 0;
+    ntripServer->timer = millis();
+    if (settings.debugNtripServerState)
+        systemPrintf("NTRIP Server %d reconnecting to %s:%d\r\n", serverIndex,
+                     settings.ntripServer_CasterHost[serverIndex],
+                     settings.ntripServer_CasterPort[serverIndex]);
+    ntripServerSetState(ntripServer, NTRIP_SERVER_CONNECTING);
 }
 
 // Update the state of the NTRIP server state machine
@@ -509,7 +640,13 @@ void ntripServerStop(int serverIndex, bool shutdown)
     {
         // Break the NTRIP server connection if necessary
         if (ntripServer->networkClient->connected())
+        {
+            // End the NTRIP 2 data stream
+            if ((ntripServer->state == NTRIP_SERVER_CASTING) && (ntripServer->version == 2))
+                ntripServer->networkClient->write((const uint8_t *)NTRIP_HTTP_LAST_CHUNK,
+                                                  strlen(NTRIP_HTTP_LAST_CHUNK));
             ntripServer->networkClient->stop();
+        }
 
         // Free the NTRIP server resources
         delete ntripServer->networkClient;
@@ -669,7 +806,7 @@ void ntripServerUpdate(int serverIndex)
             // Failed to connect to to the network, attempt to restart the network
             ntripServerStop(serverIndex, true); // Note: was ntripServerRestart(serverIndex);
 
-        // State change handled in ntripServerProcessRTCM
+        // State change handled in ntripServerSendRTCM
         break;
 
     // Initiate the connection to the NTRIP caster
@@ -706,7 +843,7 @@ void ntripServerUpdate(int serverIndex)
             ntripServerStop(serverIndex, true); // Note: was ntripServerRestart(serverIndex);
 
         // Check if caster service responded
-        else if (ntripServer->networkClient->available() < strlen("ICY 200 OK")) // Wait until at least a few bytes have arrived
+        else if (!ntripServerResponse(serverIndex))
         {
             // Check for response timeout
             if (millis() - ntripServer->timer > 10000)
@@ -718,8 +855,7 @@ void ntripServerUpdate(int serverIndex)
         else
         {
             // NTRIP caster's authorization response received
-            char response[512];
-            ntripServerResponse(serverIndex, response, sizeof(response));
+            const char *response = ntripServerHttpResponse[serverIndex].text;
 
             if (settings.debugNtripServerState)
                 systemPrintf("Server %d Response: %s\r\n", serverIndex, response);
@@ -727,7 +863,7 @@ void ntripServerUpdate(int serverIndex)
                 log_d("Server %d Response: %s", serverIndex, response);
 
             // Look for various responses
-            if (strstr(response, "200") != nullptr) //'200' found
+            if (ntripServerHttpResponse[serverIndex].status == 200)
             {
                 // We got a response, now check it for possible errors
                 if (strcasestr(response, "banned") != nullptr)
@@ -747,14 +883,21 @@ void ntripServerUpdate(int serverIndex)
                     ntripServerShutdown(serverIndex);
                 }
 
-                systemPrintf("NTRIP Server %d connected to %s:%d %s\r\n", serverIndex,
+                ntripServer->connectTime = millis() - ntripServer->connectTime;
+                systemPrintf("NTRIP Server %d connected to %s:%d %s in %d ms\r\n", serverIndex,
                              settings.ntripServer_CasterHost[serverIndex],
                              settings.ntripServer_CasterPort[serverIndex],
-                             settings.ntripServer_MountPoint[serverIndex]);
+                             settings.ntripServer_MountPoint[serverIndex],
+                             ntripServer->connectTime);
 
                 // Connection is now open, start the RTCM correction data timer
                 ntripServer->timer = millis();
 
+                // Start the write rate measurement
+                ntripServer->writes = 0;
+                ntripServer->zedBytesSent = 0;
+                ntripServer->writeStartMillis = millis();
+
                 // We don't use a task because we use I2C hardware (and don't have a semphore).
                 online.ntripServer[serverIndex] = true;
                 ntripServer->startTime = millis();
@@ -762,7 +905,7 @@ void ntripServerUpdate(int serverIndex)
             }
 
             // Look for '401 Unauthorized'
-            else if (strstr(response, "401") != nullptr)
+            else if (ntripServerHttpResponse[serverIndex].status == 401)
             {
                 systemPrintf(
                     "NTRIP Caster %d responded with unauthorized error: %s. Are you sure your caster credentials are correct?\r\n",
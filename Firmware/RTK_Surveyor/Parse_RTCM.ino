@@ -124,7 +124,10 @@ uint8_t rtcmReadCrc(PARSE_STATE *parse, uint8_t data)
     if (parse->crc == 0)
         parse->eomCallback(parse, SENTENCE_TYPE_RTCM);
     else
+    {
+        parse->invalidRtcmCrcs++;
         failedParserMessages_RTCM++;
+    }
 
     // Search for another preamble byte
     parse->length = 0;
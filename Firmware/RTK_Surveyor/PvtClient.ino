@@ -157,79 +157,53 @@ const RtkMode_t pvtClientMode = RTK_MODE_BASE_FIXED
 static NetworkClient * pvtClient;
 static IPAddress pvtClientIpAddress;
 static uint8_t pvtClientState;
-static volatile RING_BUFFER_OFFSET pvtClientTail;
 static volatile bool pvtClientWriteError;
 
 //----------------------------------------
 // PVT Client handleGnssDataTask Support Routines
 //----------------------------------------
 
+// Determine if the PVT client is connected to the NMEA server
+bool pvtClientConnected(RING_BUFFER_CONSUMER *consumer)
+{
+    return settings.enablePvtClient && online.pvtClient;
+}
+
 // Send PVT data to the NMEA server
-int32_t pvtClientSendData(uint16_t dataHead)
+int32_t pvtClientSendData(RING_BUFFER_CONSUMER *consumer, const uint8_t *data, int32_t length)
 {
-    bool connected;
-    int32_t bytesToSend;
     int32_t bytesSent;
 
-    // Determine if a client is connected
-    bytesToSend = 0;
-    connected = settings.enablePvtClient && online.pvtClient;
-
-    // Determine if the client is connected
-    if ((!connected) || (!online.pvtClient))
-        pvtClientTail = dataHead;
-    else
+    // Send the data to the NMEA server
+    bytesSent = pvtClient->write(data, length);
+    if (bytesSent >= 0)
     {
-        // Determine the amount of data in the buffer
-        bytesToSend = dataHead - pvtClientTail;
-        if (bytesToSend < 0)
-            bytesToSend += settings.gnssHandlerBufferSize;
-        if (bytesToSend > 0)
+        if ((settings.debugPvtClient || PERIODIC_DISPLAY(PD_PVT_CLIENT_DATA)) && (!inMainMenu))
         {
-            // Reduce bytes to send if we have more to send then the end of the buffer
-            // We'll wrap next loop
-            if ((pvtClientTail + bytesToSend) > settings.gnssHandlerBufferSize)
-                bytesToSend = settings.gnssHandlerBufferSize - pvtClientTail;
-
-            // Send the data to the NMEA server
-            bytesSent = pvtClient->write(&ringBuffer[pvtClientTail], bytesToSend);
-            if (bytesSent >= 0)
-            {
-                if ((settings.debugPvtClient || PERIODIC_DISPLAY(PD_PVT_CLIENT_DATA)) && (!inMainMenu))
-                {
-                    PERIODIC_CLEAR(PD_PVT_CLIENT_DATA);
-                    systemPrintf("PVT client sent %d bytes, %d remaining\r\n", bytesSent, bytesToSend - bytesSent);
-                }
-
-                // Assume all data was sent, wrap the buffer pointer
-                pvtClientTail += bytesSent;
-                if (pvtClientTail >= settings.gnssHandlerBufferSize)
-                    pvtClientTail -= settings.gnssHandlerBufferSize;
-
-                // Update space available for use in UART task
-                bytesToSend = dataHead - pvtClientTail;
-                if (bytesToSend < 0)
-                    bytesToSend += settings.gnssHandlerBufferSize;
-            }
+            PERIODIC_CLEAR(PD_PVT_CLIENT_DATA);
+            systemPrintf("PVT client sent %d bytes, %d remaining\r\n", bytesSent, length - bytesSent);
+        }
+    }
 
-            // Failed to write the data
-            else
-            {
-                // Done with this client connection
-                if (!inMainMenu)
-                    systemPrintf("PVT client breaking connection with %s:%d\r\n",
-                         pvtClientIpAddress.toString().c_str(), settings.pvtClientPort);
+    // Failed to write the data
+    else
+    {
+        // Done with this client connection
+        if (!inMainMenu)
+            systemPrintf("PVT client breaking connection with %s:%d\r\n", pvtClientIpAddress.toString().c_str(),
+                         settings.pvtClientPort);
 
-                pvtClientWriteError = true;
-                bytesToSend = 0;
-            }
-        }
+        pvtClientWriteError = true;
+        bytesSent = 0;
     }
 
-    // Return the amount of space that WiFi is using in the buffer
-    return bytesToSend;
+    // Return the amount of data consumed from the ring buffer
+    return bytesSent;
 }
 
+static RING_BUFFER_CONSUMER pvtClientConsumer = {
+    "PVT Client", pvtClientConnected, pvtClientSendData, nullptr, nullptr, MESSAGE_FILTER_NETWORK};
+
 // Update the state of the PVT client state machine
 void pvtClientSetState(uint8_t newState)
 {
@@ -254,23 +228,6 @@ void pvtClientSetState(uint8_t newState)
     }
 }
 
-// Remove previous messages from the ring buffer
-void discardPvtClientBytes(RING_BUFFER_OFFSET previousTail, RING_BUFFER_OFFSET newTail)
-{
-    if (previousTail < newTail)
-    {
-        // No buffer wrap occurred
-        if ((pvtClientTail >= previousTail) && (pvtClientTail < newTail))
-            pvtClientTail = newTail;
-    }
-    else
-    {
-        // Buffer wrap occurred
-        if ((pvtClientTail >= previousTail) || (pvtClientTail < newTail))
-            pvtClientTail = newTail;
-    }
-}
-
 //----------------------------------------
 // PVT Client Routines
 //----------------------------------------
@@ -525,10 +482,10 @@ void pvtClientValidateTables()
         reportFatalError("Fix pvtClientStateNameEntries to match PvtClientStates");
 }
 
-// Zero the PVT client tail
-void pvtClientZeroTail()
+// Add the PVT client to the GNSS ring buffer
+void pvtClientRegisterConsumer()
 {
-    pvtClientTail = 0;
+    tasksRegisterConsumer(&pvtClientConsumer);
 }
 
 #endif  // COMPILE_NETWORK
@@ -29,6 +29,27 @@ pvtServer.ino
            '------------> Cell Phone <-------------------------------'
                           for display
 
+  Each client is a separate consumer of the GNSS ring buffer.  A client that
+  stops reading is limited to settings.pvtServerHighWater bytes of the ring
+  buffer.  Beyond that point the client either skips ahead to the newest
+  navigation epoch or is disconnected, selected by
+  settings.pvtServerSlowClientPolicy, so the slowest client does not cause
+  message drops for the other outputs.
+
+  Each client has its own handleGnssDataTask (handleGnssDataTaskStackSize
+  bytes of stack) since a write to a client whose TCP window is full blocks
+  until the socket times out, a shared task would stall every other client
+  behind the slow one.  The default of four clients uses 12 KB of stack, the
+  limit of PVT_SERVER_MAX_CLIENTS is only allocated when configured.
+
+  The consumer tasks never stop a client, they only request the disconnect
+  by setting pvtServerClientDisconnect[index].  pvtServerUpdate owns the
+  client objects and the pvtServerClientConnected bitmask, and stops the
+  client from loop.  The consumer task holds pvtServerClientMutex[index]
+  while writing to the client, pvtServerStopClient clears the connected bit
+  and then takes the mutex, waiting for any write in progress to finish,
+  before deleting the client.
+
 */
 
 #if COMPILE_NETWORK
@@ -39,6 +60,11 @@ pvtServer.ino
 
 #define PVT_SERVER_CLIENT_DATA_TIMEOUT  (15 * 1000)
 
+// Disconnect requests from the consumer tasks
+#define PVT_SERVER_DISCONNECT_NONE          0
+#define PVT_SERVER_DISCONNECT_WRITE_ERROR   1
+#define PVT_SERVER_DISCONNECT_BEHIND        2
+
 // Define the PVT server states
 enum PvtServerStates
 {
@@ -72,27 +98,93 @@ static uint8_t pvtServerState;
 static uint32_t pvtServerTimer;
 
 // PVT server clients
-static volatile uint8_t pvtServerClientConnected;
-static volatile uint8_t pvtServerClientDataSent;
-static volatile uint8_t pvtServerClientWriteError;
+static uint8_t pvtServerClients; // Number of client entries registered with the ring buffer
+static volatile uint32_t pvtServerClientConnected;
+static volatile bool pvtServerClientDataSent[PVT_SERVER_MAX_CLIENTS]; // Set by the consumer tasks
+static volatile uint8_t pvtServerClientDisconnect[PVT_SERVER_MAX_CLIENTS]; // Set by the consumer tasks
+static uint32_t pvtServerClientWriteError;
 static NetworkClient * pvtServerClient[PVT_SERVER_MAX_CLIENTS];
+static SemaphoreHandle_t pvtServerClientMutex[PVT_SERVER_MAX_CLIENTS]; // Held by the consumer task while writing
 static IPAddress pvtServerClientIpAddress[PVT_SERVER_MAX_CLIENTS];
-static volatile RING_BUFFER_OFFSET pvtServerClientTails[PVT_SERVER_MAX_CLIENTS];
+static RING_BUFFER_CONSUMER pvtServerConsumer[PVT_SERVER_MAX_CLIENTS];
+static char pvtServerConsumerName[PVT_SERVER_MAX_CLIENTS][20];
+
+// PVT server client statistics
+static uint32_t pvtServerClientBytesSent[PVT_SERVER_MAX_CLIENTS];
+static uint32_t pvtServerClientConnectMillis[PVT_SERVER_MAX_CLIENTS];
+static uint32_t pvtServerEvictions; // Clients disconnected for falling behind
 
 //----------------------------------------
 // PVT Server handleGnssDataTask Support Routines
 //----------------------------------------
 
+// Handle a PVT server client that fell behind, returns true to skip ahead
+// to the newest epoch or false when the client is to be disconnected
+bool pvtServerClientBehind(RING_BUFFER_CONSUMER *consumer, int32_t used)
+{
+    int index;
+
+    index = consumer->index;
+    if (settings.pvtServerSlowClientPolicy != PVT_SERVER_SLOW_CLIENT_DISCONNECT)
+    {
+        if (settings.debugPvtServer && (!inMainMenu))
+            systemPrintf("PVT server client %d is %d bytes behind, skipping to the newest epoch\r\n", index, used);
+        return true;
+    }
+
+    // Done with this client connection
+    if ((settings.debugPvtServer || PERIODIC_DISPLAY(PD_PVT_SERVER_CLIENT_DATA)) && (!inMainMenu))
+    {
+        PERIODIC_CLEAR(PD_PVT_SERVER_CLIENT_DATA);
+        systemPrintf("PVT server disconnecting client %d, %d.%d.%d.%d is %d bytes behind\r\n",
+                     index,
+                     pvtServerClientIpAddress[index][0],
+                     pvtServerClientIpAddress[index][1],
+                     pvtServerClientIpAddress[index][2],
+                     pvtServerClientIpAddress[index][3],
+                     used);
+    }
+
+    // pvtServerUpdate stops the client
+    pvtServerClientDisconnect[index] = PVT_SERVER_DISCONNECT_BEHIND;
+    return false;
+}
+
+// Determine if the PVT server client is connected
+bool pvtServerClientIsConnected(RING_BUFFER_CONSUMER *consumer)
+{
+    int index;
+
+    index = consumer->index;
+    return ((pvtServerClientConnected & (1 << index)) != 0)
+           && (pvtServerClientDisconnect[index] == PVT_SERVER_DISCONNECT_NONE);
+}
+
 // Send data to the PVT clients
-int32_t pvtServerClientSendData(int index, uint8_t *data, uint16_t length)
+int32_t pvtServerClientSendData(RING_BUFFER_CONSUMER *consumer, const uint8_t *data, int32_t length)
 {
+    int index;
+
+    index = consumer->index;
 
+    // Prevent pvtServerStopClient from deleting the client during the write
+    xSemaphoreTake(pvtServerClientMutex[index], portMAX_DELAY);
+    if ((!(pvtServerClientConnected & (1 << index))) || (!pvtServerClient[index]))
+    {
+        // The client was stopped after the connected check
+        xSemaphoreGive(pvtServerClientMutex[index]);
+        return 0;
+    }
     length = pvtServerClient[index]->write(data, length);
+    xSemaphoreGive(pvtServerClientMutex[index]);
     if (length >= 0)
     {
         // Update the data sent flag when data successfully sent
         if (length > 0)
-            pvtServerClientDataSent |= 1 << index;
+        {
+            pvtServerClientDataSent[index] = true;
+            pvtServerClientBytesSent[index] += length;
+        }
         if ((settings.debugPvtServer || PERIODIC_DISPLAY(PD_PVT_SERVER_CLIENT_DATA)) && (!inMainMenu))
         {
             PERIODIC_CLEAR(PD_PVT_SERVER_CLIENT_DATA);
@@ -120,92 +212,13 @@ int32_t pvtServerClientSendData(int index, uint8_t *data, uint16_t length)
                          pvtServerClientIpAddress[index][3]);
         }
 
-        pvtServerClient[index]->stop();
-        pvtServerClientConnected &= ~(1 << index);
-        pvtServerClientWriteError |= 1 << index;
+        // pvtServerUpdate stops the client
+        pvtServerClientDisconnect[index] = PVT_SERVER_DISCONNECT_WRITE_ERROR;
         length = 0;
     }
     return length;
 }
 
-// Send PVT data to the clients
-int32_t pvtServerSendData(uint16_t dataHead)
-{
-    int32_t usedSpace = 0;
-
-    int32_t bytesToSend;
-    int index;
-    uint16_t tail;
-
-    // Update each of the clients
-    for (index = 0; index < PVT_SERVER_MAX_CLIENTS; index++)
-    {
-        tail = pvtServerClientTails[index];
-
-        // Determine if the client is connected
-        if (!(pvtServerClientConnected & (1 << index)))
-            tail = dataHead;
-        else
-        {
-            // Determine the amount of PVT data in the buffer
-            bytesToSend = dataHead - tail;
-            if (bytesToSend < 0)
-                bytesToSend += settings.gnssHandlerBufferSize;
-            if (bytesToSend > 0)
-            {
-                // Reduce bytes to send if we have more to send then the end of the buffer
-                // We'll wrap next loop
-                if ((tail + bytesToSend) > settings.gnssHandlerBufferSize)
-                    bytesToSend = settings.gnssHandlerBufferSize - tail;
-
-                // Send the data to the PVT server clients
-                bytesToSend = pvtServerClientSendData(index, &ringBuffer[tail], bytesToSend);
-
-                // Assume all data was sent, wrap the buffer pointer
-                tail += bytesToSend;
-                if (tail >= settings.gnssHandlerBufferSize)
-                    tail -= settings.gnssHandlerBufferSize;
-
-                // Update space available for use in UART task
-                bytesToSend = dataHead - tail;
-                if (bytesToSend < 0)
-                    bytesToSend += settings.gnssHandlerBufferSize;
-                if (usedSpace < bytesToSend)
-                    usedSpace = bytesToSend;
-            }
-        }
-        pvtServerClientTails[index] = tail;
-    }
-
-    // Return the amount of space that PVT server client is using in the buffer
-    return usedSpace;
-}
-
-// Remove previous messages from the ring buffer
-void discardPvtServerBytes(RING_BUFFER_OFFSET previousTail, RING_BUFFER_OFFSET newTail)
-{
-    int index;
-    uint16_t tail;
-
-    // Update each of the clients
-    for (index = 0; index < PVT_SERVER_MAX_CLIENTS; index++)
-    {
-        tail = pvtServerClientTails[index];
-        if (previousTail < newTail)
-        {
-            // No buffer wrap occurred
-            if ((tail >= previousTail) && (tail < newTail))
-                pvtServerClientTails[index] = newTail;
-        }
-        else
-        {
-            // Buffer wrap occurred
-            if ((tail >= previousTail) || (tail < newTail))
-                pvtServerClientTails[index] = newTail;
-        }
-    }
-}
-
 //----------------------------------------
 // PVT Server Routines
 //----------------------------------------
@@ -251,7 +264,7 @@ bool pvtServerStart()
 
     // Start the PVT server
     if (pvtServer == nullptr)
-        pvtServer = networkServer(NETWORK_USER_PVT_SERVER, settings.pvtServerPort);
+        pvtServer = networkServer(NETWORK_USER_PVT_SERVER, settings.pvtServerPort, pvtServerClients);
     if (!pvtServer)
         return false;
 
@@ -281,7 +294,7 @@ void pvtServerStop()
     if (pvtServerClientConnected)
     {
         // Shutdown the PVT server client links
-        for (index = 0; index < PVT_SERVER_MAX_CLIENTS; index++)
+        for (index = 0; index < pvtServerClients; index++)
             pvtServerStopClient(index);
     }
 
@@ -313,6 +326,12 @@ void pvtServerStopClient(int index)
     bool connected;
     bool dataSent;
 
+    // Stop the consumer task from starting another write, then wait for any
+    // write in progress to finish
+    pvtServerClientConnected &= ~(1 << index);
+    if (pvtServerClientMutex[index])
+        xSemaphoreTake(pvtServerClientMutex[index], portMAX_DELAY);
+
     // Determine if a client was allocated
     if (pvtServerClient[index])
     {
@@ -325,7 +344,7 @@ void pvtServerStopClient(int index)
             connected = pvtServerClient[index]->connected()
                         && (!(pvtServerClientWriteError & (1 << index)));
             dataSent = ((millis() - pvtServerTimer) < PVT_SERVER_CLIENT_DATA_TIMEOUT)
-                    || (pvtServerClientDataSent & (1 << index));
+                    || pvtServerClientDataSent[index];
             if (!dataSent)
                 systemPrintf("PVT Server: No data sent over %d seconds\r\n",
                             PVT_SERVER_CLIENT_DATA_TIMEOUT / 1000);
@@ -344,8 +363,10 @@ void pvtServerStopClient(int index)
         delete pvtServerClient[index];
         pvtServerClient[index] = nullptr;
     }
-    pvtServerClientConnected &= ~(1 << index);
+    if (pvtServerClientMutex[index])
+        xSemaphoreGive(pvtServerClientMutex[index]);
     pvtServerClientWriteError &= ~(1 << index);
+    pvtServerClientDisconnect[index] = PVT_SERVER_DISCONNECT_NONE;
 }
 
 // Update the PVT server state
@@ -446,16 +467,30 @@ void pvtServerUpdate()
         }
 
         // Walk the list of PVT server clients
-        for (index = 0; index < PVT_SERVER_MAX_CLIENTS; index++)
+        for (index = 0; index < pvtServerClients; index++)
         {
             // Determine if the client data structure is still in use
             if (pvtServerClientConnected & (1 << index))
             {
+                // Handle the disconnect requests from the consumer task
+                switch (pvtServerClientDisconnect[index])
+                {
+                case PVT_SERVER_DISCONNECT_BEHIND:
+                    pvtServerEvictions += 1;
+                    pvtServerClientWriteError |= 1 << index;
+                    break;
+
+                case PVT_SERVER_DISCONNECT_WRITE_ERROR:
+                    pvtServerClientWriteError |= 1 << index;
+                    break;
+                }
+
                 // Data structure in use
                 // Check for a working PVT server client connection
-                connected = pvtServerClient[index]->connected();
+                connected = pvtServerClient[index]->connected()
+                          && (!(pvtServerClientWriteError & (1 << index)));
                 dataSent = ((millis() - pvtServerTimer) < PVT_SERVER_CLIENT_DATA_TIMEOUT)
-                         || (pvtServerClientDataSent & (1 << index));
+                         || pvtServerClientDataSent[index];
                 if (connected && dataSent)
                 {
                     // Display this client connection
@@ -478,7 +513,7 @@ void pvtServerUpdate()
         }
 
         // Walk the list of PVT server clients
-        for (index = 0; index < PVT_SERVER_MAX_CLIENTS; index++)
+        for (index = 0; index < pvtServerClients; index++)
         {
             // Determine if the client data structure is not in use
             if (!(pvtServerClientConnected & (1 << index)))
@@ -522,8 +557,14 @@ void pvtServerUpdate()
 
                 // Start processing the new PVT server client connection
                 pvtServerClientIpAddress[index] = pvtServerClient[index]->remoteIP();
+                pvtServerClientBytesSent[index] = 0;
+                pvtServerClientConnectMillis[index] = millis();
+                pvtServerConsumer[index].maxUsed = 0;
+                pvtServerConsumer[index].skips = 0;
+                pvtServerConsumer[index].skippedBytes = 0;
+                pvtServerClientDisconnect[index] = PVT_SERVER_DISCONNECT_NONE;
+                pvtServerClientDataSent[index] = true;
                 pvtServerClientConnected |= 1 << index;
-                pvtServerClientDataSent |= 1 << index;
                 if ((settings.debugPvtServer || PERIODIC_DISPLAY(PD_PVT_SERVER_DATA)) && (!inMainMenu))
                 {
                     PERIODIC_CLEAR(PD_PVT_SERVER_DATA); // This will only print the first client...
@@ -542,7 +583,8 @@ void pvtServerUpdate()
         {
             // Restart the data verification
             pvtServerTimer = millis();
-            pvtServerClientDataSent = 0;
+            for (index = 0; index < pvtServerClients; index++)
+                pvtServerClientDataSent[index] = false;
 
             // Keep WiFi alive for PvtServer when no clients are connected
             // Prevents:
@@ -592,13 +634,72 @@ void pvtServerValidateTables()
         reportFatalError("Fix pvtServerStateNameEntries to match PvtServerStates");
 }
 
-// Zero the PVT server client tails
-void pvtServerZeroTail()
+// Add the PVT server clients to the GNSS ring buffer, a change to the number
+// of clients is used after a restart
+void pvtServerRegisterConsumers()
+{
+    int32_t highWater;
+    int index;
+
+    // Limit each client to 1/8 of the ring buffer, a client skipping ahead
+    // may use up to twice this amount while the lower priority messages are
+    // only dropped once 7/8 of the ring buffer is in use
+    highWater = settings.pvtServerHighWater;
+    if (highWater > (gnssRingBuffer.size >> 3))
+        highWater = gnssRingBuffer.size >> 3;
+
+    pvtServerClients = settings.pvtServerMaxClients;
+    if (pvtServerClients < 1)
+        pvtServerClients = 1;
+    if (pvtServerClients > PVT_SERVER_MAX_CLIENTS)
+        pvtServerClients = PVT_SERVER_MAX_CLIENTS;
+    for (index = 0; index < pvtServerClients; index++)
+    {
+        if (pvtServerClientMutex[index] == nullptr)
+            pvtServerClientMutex[index] = xSemaphoreCreateMutex();
+        snprintf(pvtServerConsumerName[index], sizeof(pvtServerConsumerName[index]), "PVT Server %d", index);
+        pvtServerConsumer[index].name = pvtServerConsumerName[index];
+        pvtServerConsumer[index].connected = pvtServerClientIsConnected;
+        pvtServerConsumer[index].send = pvtServerClientSendData;
+        pvtServerConsumer[index].filter = MESSAGE_FILTER_NETWORK;
+        pvtServerConsumer[index].index = index;
+        pvtServerConsumer[index].highWater = highWater;
+        pvtServerConsumer[index].behind = pvtServerClientBehind;
+        tasksRegisterConsumer(&pvtServerConsumer[index]);
+    }
+}
+
+// Display the PVT server client statistics
+void pvtServerPrintStatus()
 {
+    RING_BUFFER_CONSUMER *consumer;
     int index;
+    uint32_t seconds;
 
-    for (index = 0; index < PVT_SERVER_MAX_CLIENTS; index++)
-        pvtServerClientTails[index] = 0;
+    if (!online.pvtServer)
+        return;
+    systemPrintf("PVT Server: %d of %d clients connected, %d disconnected for falling behind\r\n",
+                 __builtin_popcount(pvtServerClientConnected), pvtServerClients, pvtServerEvictions);
+    for (index = 0; index < pvtServerClients; index++)
+    {
+        if (!(pvtServerClientConnected & (1 << index)))
+            continue;
+        consumer = &pvtServerConsumer[index];
+        seconds = (millis() - pvtServerClientConnectMillis[index]) / 1000;
+        if (!seconds)
+            seconds = 1;
+        systemPrintf("    %d: %d.%d.%d.%d, %d bytes/sec, lag %d bytes (max %d), %d skips (%d bytes)\r\n",
+                     index,
+                     pvtServerClientIpAddress[index][0],
+                     pvtServerClientIpAddress[index][1],
+                     pvtServerClientIpAddress[index][2],
+                     pvtServerClientIpAddress[index][3],
+                     pvtServerClientBytesSent[index] / seconds,
+                     ringBufferUsed(&gnssRingBuffer, consumer),
+                     consumer->maxUsed,
+                     consumer->skips,
+                     consumer->skippedBytes);
+    }
 }
 
 void paintPvtServerIP()
@@ -96,13 +96,18 @@ const RtkMode_t pvtUdpServerMode = RTK_MODE_BASE_FIXED
 static NetworkUDP *pvtUdpServer = nullptr;
 static uint8_t pvtUdpServerState;
 static uint32_t pvtUdpServerTimer;
-static volatile RING_BUFFER_OFFSET pvtUdpServerTail;
 //----------------------------------------
 // PVT UDP Server handleGnssDataTask Support Routines
 //----------------------------------------
 
+// Determine if the PVT UDP server is able to broadcast data
+bool pvtUdpServerConnected(RING_BUFFER_CONSUMER *consumer)
+{
+    return settings.enablePvtUdpServer && online.pvtUdpServer && wifiIsConnected();
+}
+
 // Send data as broadcast
-int32_t pvtUdpServerSendDataBroadcast(uint8_t *data, uint16_t length)
+int32_t pvtUdpServerSendDataBroadcast(RING_BUFFER_CONSUMER *consumer, const uint8_t *data, int32_t length)
 {
      if (!length)
         return 0;
@@ -130,70 +135,8 @@ int32_t pvtUdpServerSendDataBroadcast(uint8_t *data, uint16_t length)
     return length;
 }
 
-// Send PVT data as broadcast
-int32_t pvtUdpServerSendData(uint16_t dataHead)
-{
-    int32_t usedSpace = 0;
-
-    int32_t bytesToSend;
-
-    uint16_t tail;
-
-    tail = pvtUdpServerTail;
-
-    // Determine the amount of PVT data in the buffer
-    bytesToSend = dataHead - tail;
-    if (bytesToSend < 0)
-        bytesToSend += settings.gnssHandlerBufferSize;
-    if (bytesToSend > 0)
-    {
-        // Reduce bytes to send if we have more to send then the end of the buffer
-        // We'll wrap next loop
-        if ((tail + bytesToSend) > settings.gnssHandlerBufferSize)
-            bytesToSend = settings.gnssHandlerBufferSize - tail;
-
-        // Send the data
-        bytesToSend = pvtUdpServerSendDataBroadcast(&ringBuffer[tail], bytesToSend);
-
-        // Assume all data was sent, wrap the buffer pointer
-        tail += bytesToSend;
-        if (tail >= settings.gnssHandlerBufferSize)
-            tail -= settings.gnssHandlerBufferSize;
-
-        // Update space available for use in UART task
-        bytesToSend = dataHead - tail;
-        if (bytesToSend < 0)
-            bytesToSend += settings.gnssHandlerBufferSize;
-        if (usedSpace < bytesToSend)
-            usedSpace = bytesToSend;
-    }
-
-    pvtUdpServerTail = tail;
-
-    // Return the amount of space that PVT server client is using in the buffer
-    return usedSpace;
-}
-
-// Remove previous messages from the ring buffer
-void discardPvtUdpServerBytes(RING_BUFFER_OFFSET previousTail, RING_BUFFER_OFFSET newTail)
-{
-    int index;
-    uint16_t tail;
-
-    tail = pvtUdpServerTail;
-    if (previousTail < newTail)
-    {
-        // No buffer wrap occurred
-        if ((tail >= previousTail) && (tail < newTail))
-            pvtUdpServerTail = newTail;
-    }
-    else
-    {
-        // Buffer wrap occurred
-        if ((tail >= previousTail) || (tail < newTail))
-            pvtUdpServerTail = newTail;
-    }
-}
+static RING_BUFFER_CONSUMER pvtUdpServerConsumer = {
+    "PVT UDP Server", pvtUdpServerConnected, pvtUdpServerSendDataBroadcast, nullptr, nullptr, MESSAGE_FILTER_NETWORK};
 
 //----------------------------------------
 // PVT Server Routines
@@ -374,10 +317,10 @@ void pvtUdpServerUpdate()
         pvtUdpServerSetState(pvtUdpServerState);
 }
 
-// Zero the PVT server client tails
-void pvtUdpServerZeroTail()
+// Add the PVT UDP server to the GNSS ring buffer
+void pvtUdpServerRegisterConsumer()
 {
-    pvtUdpServerTail = 0;
+    tasksRegisterConsumer(&pvtUdpServerConsumer);
 }
 
 void paintUdpServerIP()
@@ -182,6 +182,28 @@ SdFat *sd;
 #define platformFilePrefix      platformFilePrefixTable[productVariant] // Sets the prefix for logs and settings files
 
 FileSdFatMMC *ubxFile;                // File that all GNSS ubx messages sentences are written to
+uint8_t *sdLogBuffer;                 // Staging buffer for the log file, full sectors are written to the file
+uint32_t sdLogBufferSize;             // Size of sdLogBuffer, a multiple of SD_SECTOR_SIZE
+uint32_t sdLogBufferLimit;            // Number of bytes to accumulate before writing to the file
+uint32_t sdLogBufferBytes;            // Number of bytes in sdLogBuffer
+uint32_t sdWriteSizes[SD_WRITE_HISTOGRAM_BUCKETS]; // Histogram of the log file write sizes
+uint32_t sdWriteTimes[SD_WRITE_HISTOGRAM_BUCKETS]; // Histogram of the log file write times in milliseconds
+uint32_t sdWriteMaxMillis;            // Longest log file write
+uint64_t sdLogPreallocated;           // Bytes pre-allocated for ubxFile
+LOG_COMPRESS *sdLogCompress;          // Compression state, allocated while writing a compressed log file
+uint8_t *sdLogCompressBuffer;         // Block being compressed followed by the compressed block
+uint16_t sdLogCompressBytes;          // Number of bytes in the block being compressed
+uint64_t sdLogCompressMicros;         // Total time spent compressing blocks
+uint32_t sdLogCompressMaxMicros;      // Longest block compression time
+FileSdFatMMC *sdLogIndexFile;         // Seek index file written beside the log file
+LOG_INDEX *sdLogIndex;                // Index state, allocated while writing the index file
+bool sdLogMessageStart;               // Set when the next SD data starts a message
+FileSdFatMMC *sdNextLogFile;          // Next log file, created before the switch
+uint64_t sdNextLogPreallocated;       // Bytes pre-allocated for sdNextLogFile
+char sdNextLogFileName[sizeof("SFE_Reference_Station_230101_120101.ubx_plusExtraSpace")]; // Name of sdNextLogFile
+LOG_ROTATE sdLogRotate;               // Selects the epoch boundary for the switch to sdNextLogFile
+volatile bool sdLogCreateNextRequest; // Set by updateLogs, the SD card consumer creates sdNextLogFile
+volatile bool sdLogCreateNextFailed;  // Set by the SD card consumer when sdNextLogFile can't be created
 unsigned long lastUBXLogSyncTime = 0; // Used to record to SD every half second
 int startLogTime_minutes = 0;         // Mark when we start any logging so we can stop logging after maxLogTime_minutes
 int startCurrentLogTime_minutes =
@@ -210,14 +232,16 @@ typedef enum LoggingType
 } LoggingType;
 LoggingType loggingType = LOGGING_UNKNOWN;
 
-FileSdFatMMC *managerTempFile; // File used for uploading or downloading in file manager section of AP config
-bool managerFileOpen = false;
+FileSdFatMMC *managerTempFile; // File used for uploading in file manager section of AP config
 
 TaskHandle_t sdSizeCheckTaskHandle = nullptr; // Store handles so that we can kill the task once size is found
 const uint8_t sdSizeCheckTaskPriority = 0;    // 3 being the highest, and 0 being the lowest
 const int sdSizeCheckStackSize = 3000;
 bool sdSizeCheckTaskComplete = false;
 
+const uint8_t fileDownloadTaskPriority = 1; // 3 being the highest, and 0 being the lowest
+const int fileDownloadTaskStackSize = 3000;
+
 char logFileName[sizeof("SFE_Reference_Station_230101_120101.ubx_plusExtraSpace")] = {0};
 //-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 
@@ -388,7 +412,6 @@ uint16_t ARPECEFH = 0;
 const byte haeNumberOfDecimals = 8; // Used for printing and transmitting lat/lon
 bool lBandCommunicationEnabled = false;
 bool lBandForceGetKeys = false; //Used to allow key update from display
-unsigned long rtcmLastPacketReceived = 0; //Monitors the last time we received RTCM. Proctors PMP vs RTCM prioritization.
 //=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
 
 // GPS parse table
@@ -447,17 +470,20 @@ const int btReadTaskStackSize = 2000;
 // Array of start of sentence offsets into the ring buffer
 #define AMOUNT_OF_RING_BUFFER_DATA_TO_DISCARD (settings.gnssHandlerBufferSize >> 2)
 #define AVERAGE_SENTENCE_LENGTH_IN_BYTES    32
-RING_BUFFER_OFFSET * rbOffsetArray;
-uint16_t rbOffsetEntries;
 
-uint8_t *ringBuffer; // Buffer for reading from F9P. At 230400bps, 23040 bytes/s. If SD blocks for 250ms, we need 23040
-                     // * 0.25 = 5760 bytes worst case.
+RING_BUFFER gnssRingBuffer; // Buffer for reading from F9P. At 230400bps, 23040 bytes/s. If SD blocks for 250ms, we need
+                            // 23040 * 0.25 = 5760 bytes worst case.
+LOG_ROTATE gnssEpoch;        // Detects the first message of each epoch for ringBufferEpoch
 TaskHandle_t gnssReadTaskHandle =
     nullptr; // Store handles so that we can kill them if user goes into WiFi NTRIP Server mode
 const int gnssReadTaskStackSize = 2500;
 
-TaskHandle_t handleGnssDataTaskHandle = nullptr;
-const int handleGnssDataTaskStackSize = 3000;
+const int handleGnssDataTaskStackSize = 3000; // One task per ring buffer consumer
+const int sdConsumerTaskStackSize = 5000; // SD card consumer, also opens, closes and switches the log files
+
+const int ntripClientReadTaskStackSize = 3000; // Receives the NTRIP client corrections, see NtripClient.ino
+
+#include <freertos/stream_buffer.h> // Passes the ESP-NOW corrections from the WiFi task to loop, see Corrections.ino
 
 TaskHandle_t pinUART2TaskHandle = nullptr; // Dummy task to start hardware on an assigned core
 volatile bool uart2pinned = false; // This variable is touched by core 0 but checked by core 1. Must be volatile.
@@ -655,6 +681,14 @@ uint16_t rtcmPacketsSent = 0; // Used to count RTCM packets sent via processRTCM
 uint32_t rtcmBytesSent = 0;
 uint32_t rtcmLastReceived = 0;
 
+// RTCM messages are accumulated and passed to the NTRIP servers and ESP-NOW as
+// complete messages. An RTCM message is at most 3 + 1023 + 3 = 1029 bytes,
+// the buffer holds several messages to allow an MSM epoch to be sent as a burst
+uint8_t rtcmFrameBuffer[2048];
+uint16_t rtcmFrameBytes = 0;    // Number of bytes in rtcmFrameBuffer
+uint16_t rtcmFrameComplete = 0; // Number of bytes in rtcmFrameBuffer containing complete messages
+uint16_t rtcmFrameLength = 0;   // Total length of the RTCM message being received
+
 uint32_t maxSurveyInWait_s = 60L * 15L; // Re-start survey-in after X seconds
 
 uint16_t svinObservationTime = 0; // Use globals so we don't have to request these values multiple times (slow response)
@@ -700,7 +734,8 @@ bool netOutgoingRTCM = false;
 bool espnowIncomingRTCM = false;
 bool espnowOutgoingRTCM = false;
 
-static RtcmTransportState rtcmParsingState = RTCM_TRANSPORT_STATE_WAIT_FOR_PREAMBLE_D3;
+uint32_t rtcmCrcErrors = 0;     // RTCM messages discarded due to a bad CRC
+uint32_t rtcmFramingErrors = 0; // Bytes discarded because they are not part of an RTCM message
 uint16_t failedParserMessages_UBX = 0;
 uint16_t failedParserMessages_RTCM = 0;
 uint16_t failedParserMessages_NMEA = 0;
@@ -941,6 +976,9 @@ void setup()
     DMW_c("loadSettings");
     loadSettings(); // Attempt to load settings after SD is started so we can read the settings file if available
 
+    DMW_c("correctionsBegin");
+    correctionsBegin(); // Initialize the correction source selection
+
     DMW_c("beginIdleTasks");
     beginIdleTasks(); // Enable processor load calculations
 
@@ -1003,6 +1041,8 @@ void loop()
     {
         DMW_c("theGNSS.checkUblox");
         theGNSS.checkUblox();     // Regularly poll to get latest data and any RTCM
+        DMW_c("rtcmFlushFrames");
+        rtcmFlushFrames();        // Pass the RTCM messages to the NTRIP servers and ESP-NOW
         DMW_c("theGNSS.checkCallbacks");
         theGNSS.checkCallbacks(); // Process any callbacks: ie, eventTriggerReceived
     }
@@ -1034,6 +1074,9 @@ void loop()
     DMW_c("networkUpdate");
     networkUpdate(); // Maintain the network connections
 
+    DMW_c("correctionsUpdate");
+    correctionsUpdate(); // Select the correction source passed to the ZED
+
     DMW_c("updateLBand");
     updateLBand(); // Check if we've recently received PointPerfect corrections or not
 
@@ -1046,6 +1089,9 @@ void loop()
     DMW_c("printRTKState");
     printRTKState(); // Periodically print RTK state (solution) if enabled
 
+    DMW_c("tasksDisplaySendTimes");
+    tasksDisplaySendTimes(); // Periodically print the ring buffer consumer send times if enabled
+
     // A small delay prevents panic if no other I2C or functions are called
     delay(10);
 }
@@ -1071,7 +1117,7 @@ void updateSD()
         }
     }
 
-    if (online.logging == true && sdCardSize > 0 &&
+    if (online.logging == true && sdFreeSpaceValid() &&
         sdFreeSpace < sdMinAvailableSpace) // Stop logging if we are below the min
     {
         log_d("Logging stopped. SD full.");
@@ -1080,8 +1126,8 @@ void updateSD()
         return;
     }
 
-    if (online.microSD && sdCardSize == 0)
-        beginSDSizeCheckTask(); // Start task to determine SD card size
+    if (online.microSD && sdFreeSpaceScanNeeded())
+        beginSDSizeCheckTask(); // Start task to determine SD card size and free space
 
     if (sdSizeCheckTaskComplete == true)
         deleteSDSizeCheckTask();
@@ -1127,7 +1173,16 @@ void updateLogs()
              (systemTime_minutes - startCurrentLogTime_minutes) >= settings.maxLogLength_minutes)
     {
         if (settings.runLogTest == false)
-            endSD(false, true); // Close down file. A new one will be created at the next calling of updateLogs().
+        {
+            // Switch to the next log file at an epoch boundary without stopping
+            // the log writes.  Otherwise close down the file, a new one will be
+            // created at the next calling of updateLogs().
+            if (sdLogCreateNextFailed || ((sdNextLogFile == nullptr) && (sdLogPrepareNext() == false)))
+            {
+                sdLogCreateNextFailed = false;
+                endSD(false, true);
+            }
+        }
         else if (settings.runLogTest == true)
             updateLogTest();
     }
@@ -1391,5 +1446,8 @@ void getSemaphoreFunction(char *functionName)
     case FUNCTION_NTPEVENT:
         strcpy(functionName, "NTP Event");
         break;
+    case FUNCTION_FILEMANAGER_DOWNLOAD:
+        strcpy(functionName, "FileManager Download");
+        break;
     }
 }
@@ -0,0 +1,146 @@
+/*------------------------------------------------------------------------------
+RingBuffer.h
+
+  Constant and routine declarations for the single producer, multiple
+  consumer ring buffer.  The routines in RingBuffer.ino do not depend upon
+  the Arduino environment and are also built by the programs in the Tools
+  directory.
+------------------------------------------------------------------------------*/
+
+#ifndef __RING_BUFFER_H__
+#define __RING_BUFFER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+//----------------------------------------
+// Constants
+//----------------------------------------
+
+#define RING_BUFFER_MAX_CONSUMERS 24 // Maximum number of registered consumers
+#define RING_BUFFER_SEND_TIME_BUCKETS 16 // Send time histogram: 0, 1, 2 - 3, 4 - 7, ... milliseconds
+#define RING_BUFFER_NO_EPOCH 0xffffffff // Epoch offset value when no epoch start is known
+
+// Message priority classes, with the reserves enabled the lower priority
+// messages are dropped first when the ring buffer fills
+enum RING_BUFFER_PRIORITY
+{
+    RING_BUFFER_PRIORITY_LOW = 0, // With reserves, dropped when the ring buffer is 7/8 full
+    RING_BUFFER_PRIORITY_NORMAL,  // With reserves, dropped when the ring buffer is 15/16 full
+    RING_BUFFER_PRIORITY_HIGH,    // With reserves, dropped when the ring buffer is 31/32 full
+    RING_BUFFER_PRIORITY_CRITICAL, // Only dropped when the oldest data is discarded
+    // Add new priority classes above this line
+    RING_BUFFER_PRIORITY_CLASSES
+};
+
+//----------------------------------------
+// Types
+//----------------------------------------
+
+typedef uint16_t RING_BUFFER_OFFSET;
+
+typedef struct _RING_BUFFER_CONSUMER *P_RING_BUFFER_CONSUMER;
+
+// Determine if the consumer is ready to accept data, the data is discarded
+// when the consumer is not connected
+typedef bool (*RING_BUFFER_CONNECTED)(P_RING_BUFFER_CONSUMER consumer); // Ring buffer consumer
+
+// Pass data to the consumer, returns the number of bytes consumed
+typedef int32_t (*RING_BUFFER_SEND)(P_RING_BUFFER_CONSUMER consumer, // Ring buffer consumer
+                                    const uint8_t *data,             // Buffer containing the data
+                                    int32_t length);                 // Number of bytes in the buffer
+
+// Notify the consumer that more than highWater bytes are waiting, returns true
+// to skip ahead to the newest epoch or false when the consumer disconnected
+typedef bool (*RING_BUFFER_BEHIND)(P_RING_BUFFER_CONSUMER consumer, // Ring buffer consumer
+                                   int32_t used);                   // Bytes waiting for the consumer
+
+typedef struct _RING_BUFFER_CONSUMER
+{
+    const char *name;                  // Name of the consumer
+    RING_BUFFER_CONNECTED connected;   // Routine to determine if the consumer accepts data
+    RING_BUFFER_SEND send;             // Routine to pass data to the consumer
+    const uint8_t *taskPriority;       // Priority of the consumer task, NULL for the default priority
+    const uint8_t *taskCore;           // Core running the consumer task, NULL for the default core
+    uint8_t filter;                    // Messages with this bit set in filterArray are not sent, 0 = no filter
+    int taskStackSize;                 // Stack size of the consumer task in bytes, 0 for the default size
+    void *task;                        // Task passing the data to the consumer
+    int index;                         // Consumer specific value, such as the client number
+    uint32_t tail;                     // Offset of the next byte for this consumer
+    uint16_t offsetIndex;              // Entry in offsetArray for the message being sent, filtered consumers only
+    bool messageEnd;                   // Set when the data passed to send ends on a message boundary
+    uint32_t maxMillis;                // Maximum time spent in the send routine
+    uint32_t sendTimes[RING_BUFFER_SEND_TIME_BUCKETS]; // Histogram of the time spent in the send routine
+    int32_t highWater;                 // Bytes waiting before the consumer is behind, 0 = no limit
+    RING_BUFFER_BEHIND behind;         // Routine called when the consumer is behind, NULL to always skip
+    int32_t maxUsed;                   // Maximum bytes waiting for the consumer
+    uint32_t skips;                    // Number of times the consumer skipped ahead
+    uint32_t skippedBytes;             // Bytes skipped when the consumer fell behind
+} RING_BUFFER_CONSUMER;
+
+typedef struct _RING_BUFFER
+{
+    uint8_t *data;                     // Ring buffer data, size + spill bytes
+    int32_t size;                      // Size of the ring buffer in bytes
+    int32_t discardBytes;              // Minimum number of bytes to discard when full
+    uint32_t head;                     // Offset of the next message, written by the producer
+    uint32_t epoch;                    // Offset of the newest message starting an epoch, or RING_BUFFER_NO_EPOCH
+    RING_BUFFER_OFFSET *offsetArray;   // Offsets of the messages in the ring buffer
+    uint16_t offsetEntries;            // Number of entries in the offset array
+    uint16_t offsetHead;               // Entry containing the head offset
+    uint8_t *priorityArray;            // Priority class of each message, parallel to offsetArray
+    uint8_t *filterArray;              // Consumer filter bits of each message, parallel to offsetArray
+    int32_t reserveBytes[RING_BUFFER_PRIORITY_CLASSES];    // Free space that must remain after adding a message
+    uint32_t droppedMessages[RING_BUFFER_PRIORITY_CLASSES]; // Messages dropped or discarded in each class
+    uint32_t droppedBytes[RING_BUFFER_PRIORITY_CLASSES];    // Bytes dropped or discarded in each class
+    P_RING_BUFFER_CONSUMER consumer[RING_BUFFER_MAX_CONSUMERS]; // Registered consumers
+    int consumers;                     // Number of registered consumers
+} RING_BUFFER;
+
+//----------------------------------------
+// Macros
+//----------------------------------------
+
+#define WRAP_OFFSET(offset, increment, arraySize)                                                                      \
+    {                                                                                                                  \
+        offset += increment;                                                                                           \
+        if (offset >= arraySize)                                                                                       \
+            offset -= arraySize;                                                                                       \
+    }
+
+// The head and tails are 32-bit values to use the native atomic operations
+#define RING_BUFFER_LOAD(value) __atomic_load_n(&(value), __ATOMIC_ACQUIRE)
+#define RING_BUFFER_STORE(value, newValue) __atomic_store_n(&(value), newValue, __ATOMIC_RELEASE)
+#define RING_BUFFER_EXCHANGE(value, expected, newValue)                                                                \
+    __atomic_compare_exchange_n(&(value), &(expected), newValue, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+//----------------------------------------
+// Ring buffer routines
+//----------------------------------------
+
+// Producer routines
+bool ringBufferAccept(RING_BUFFER *ring, int32_t length, uint8_t priority);
+int32_t ringBufferAvailable(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER *slowConsumer);
+void ringBufferCommit(RING_BUFFER *ring, int32_t length, uint8_t priority, uint8_t filter);
+int32_t ringBufferDiscard(RING_BUFFER *ring, int32_t bytesNeeded, P_RING_BUFFER_CONSUMER *slowConsumer);
+void ringBufferEpoch(RING_BUFFER *ring);
+void ringBufferInit(RING_BUFFER *ring, uint8_t *data, int32_t size, RING_BUFFER_OFFSET *offsetArray,
+                    uint8_t *priorityArray, uint8_t *filterArray, uint16_t offsetEntries, int32_t discardBytes);
+void ringBufferReserves(RING_BUFFER *ring, bool enable);
+bool ringBufferRegister(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER consumer);
+
+// Consumer routines
+int32_t ringBufferCatchUp(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER consumer);
+void ringBufferConsumed(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER consumer, uint32_t tail, int32_t length);
+int32_t ringBufferPeek(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER consumer, uint32_t *tail, const uint8_t **data);
+int32_t ringBufferService(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER consumer);
+void ringBufferSkip(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER consumer);
+void ringBufferSkipToEpoch(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER consumer);
+int32_t ringBufferUsed(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER consumer);
+
+// Send time routines
+uint32_t ringBufferSendTimePercentile(P_RING_BUFFER_CONSUMER consumer, int percent);
+void ringBufferSendTime(P_RING_BUFFER_CONSUMER consumer, uint32_t milliseconds);
+
+#endif // __RING_BUFFER_H__
@@ -0,0 +1,785 @@
+/*------------------------------------------------------------------------------
+RingBuffer.ino
+
+  Single producer, multiple consumer ring buffer.
+
+  The producer (gnssReadTask) writes complete messages into the ring buffer
+  at the head.  Each consumer registers with the ring buffer and gets its own
+  tail.  A consumer only advances its tail while the producer only advances
+  the head.  The free space in the ring buffer is determined by the consumer
+  with the most data in the ring buffer.
+
+  Ring buffer empty when all the tails == head
+
+         +---------+
+         |         |
+         |         |
+         |         |
+         |         |
+         +---------+ <-- head, all tails
+
+  Ring buffer contains data when any tail != head
+
+         +---------+
+         |         |
+         |         |
+         | yyyyyyy | <-- head
+         | xxxxxxx | <-- tail 1 (1 byte in buffer)
+         +---------+ <-- tail 2 (2 bytes in buffer)
+
+         +---------+
+         | yyyyyyy | <-- tail 1 (1 byte in buffer)
+         | xxxxxxx | <-- tail 2 (2 bytes in buffer)
+         |         |
+         |         |
+         +---------+ <-- head
+
+  Maximum ring buffer fill is size - 1
+
+  When the ring buffer is full, the producer discards the oldest messages by
+  moving the tails of the slow consumers forward to the beginning of a newer
+  message.  The head and tails are accessed with atomic operations, a tail
+  update from the consumer races with the discard from the producer and the
+  compare and exchange determines the final tail value.
+
+  Each message is assigned a priority class by the producer.  Space can
+  only be freed at the tail, so the lower priority messages are dropped
+  before they enter the ring buffer: a message is only accepted while the
+  free space remaining after the message exceeds the reserve for its class.
+  ringBufferReserves sets the reserves, settings.enableRingBufferReserves
+  enables them by default.  The low priority messages (GSV, GST) are then
+  dropped first once the ring buffer is 7/8 full, keeping the remaining
+  space for the higher priority messages, and the oldest messages are only
+  discarded when the critical messages (RAWX, SFRBX) fill the ring buffer.
+  The reserves are small so that the normal priority messages may still use
+  15/16 of the ring buffer.  With the reserves disabled every message may
+  use the whole ring buffer and the oldest messages are discarded first.
+  The dropped and discarded messages are counted by class.
+
+  The producer also records a set of filter bits for each message.  A
+  consumer with a filter bit walks the offsetArray from its tail and only
+  receives the messages that do not have its filter bit set, the other
+  messages are skipped.  The consumers without a filter receive all of the
+  data without looking at the message boundaries.
+
+  The producer marks the first message of each navigation epoch with
+  ringBufferEpoch.  A consumer with a highWater value does not hold more than
+  that amount of data in the ring buffer: when it falls further behind, the
+  behind routine decides between disconnecting the consumer and moving its
+  tail ahead to the start of the newest epoch.  The tail is only moved at a
+  message boundary, so the consumer receives complete epochs and a single
+  slow consumer does not fill the ring buffer for the others.
+
+  The routines in this file do not depend upon the Arduino environment and
+  are also built by Tools/Ring_Buffer_Simulator.c.
+------------------------------------------------------------------------------*/
+
+//----------------------------------------
+// Ring buffer support routines
+//----------------------------------------
+
+// Determine the number of bytes between two offsets in the ring buffer
+int32_t ringBufferDistance(RING_BUFFER *ring, uint32_t fromOffset, uint32_t toOffset)
+{
+    int32_t length;
+
+    length = (int32_t)toOffset - (int32_t)fromOffset;
+    if (length < 0)
+        length += ring->size;
+    return length;
+}
+
+// Determine if the offsetArray entry describes the message containing the
+// tail, the complete message must be in the ring buffer
+bool ringBufferMessageValid(RING_BUFFER *ring, int32_t index, uint32_t tail, uint32_t head)
+{
+    uint32_t end;
+    int32_t next;
+    uint32_t start;
+
+    next = index;
+    WRAP_OFFSET(next, 1, ring->offsetEntries);
+    start = ring->offsetArray[index];
+    end = ring->offsetArray[next];
+    return (index != RING_BUFFER_LOAD(ring->offsetHead)) && (start != end) &&
+           (ringBufferDistance(ring, start, tail) < ringBufferDistance(ring, start, end)) &&
+           (ringBufferDistance(ring, tail, end) <= ringBufferDistance(ring, tail, head));
+}
+
+// Locate the offsetArray entry for the message containing the tail, returns
+// the entry index or -1 when the message is not described by the offsetArray
+int32_t ringBufferFindMessage(RING_BUFFER *ring, uint32_t tail, uint32_t head)
+{
+    int32_t entries;
+    int32_t index;
+    int32_t used;
+
+    // Walk the offsetArray from the newest message to the oldest message
+    used = ringBufferDistance(ring, tail, head);
+    index = RING_BUFFER_LOAD(ring->offsetHead);
+    for (entries = 1; entries < ring->offsetEntries; entries++)
+    {
+        WRAP_OFFSET(index, ring->offsetEntries - 1, ring->offsetEntries);
+        if (ringBufferMessageValid(ring, index, tail, head))
+            return index;
+
+        // Stop after passing the tail
+        if (ringBufferDistance(ring, ring->offsetArray[index], head) >= used)
+            break;
+    }
+    return -1;
+}
+
+//----------------------------------------
+// Producer routines
+//----------------------------------------
+
+// Determine if a message of the specified priority class fits into the ring
+// buffer, returns true if the message should be committed and false if the
+// message was dropped
+bool ringBufferAccept(RING_BUFFER *ring, int32_t length, uint8_t priority)
+{
+    if (priority >= RING_BUFFER_PRIORITY_CLASSES)
+        priority = RING_BUFFER_PRIORITY_CLASSES - 1;
+
+    // Keep the reserved space for the higher priority messages
+    if ((ringBufferAvailable(ring, NULL) - length) >= ring->reserveBytes[priority])
+        return true;
+
+    // Drop the message
+    ring->droppedMessages[priority] += 1;
+    ring->droppedBytes[priority] += length;
+    return false;
+}
+
+// Determine the free space in the ring buffer, returns the number of bytes
+// available to the producer and optionally the consumer using the most space
+int32_t ringBufferAvailable(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER *slowConsumer)
+{
+    int consumers;
+    uint32_t head;
+    int index;
+    P_RING_BUFFER_CONSUMER slowest;
+    int32_t used;
+    int32_t usedSpace;
+
+    // Find the consumer with the most data in the ring buffer
+    head = RING_BUFFER_LOAD(ring->head);
+    slowest = NULL;
+    usedSpace = 0;
+    consumers = RING_BUFFER_LOAD(ring->consumers);
+    for (index = 0; index < consumers; index++)
+    {
+        used = ringBufferDistance(ring, RING_BUFFER_LOAD(ring->consumer[index]->tail), head);
+        if (usedSpace < used)
+        {
+            usedSpace = used;
+            slowest = ring->consumer[index];
+        }
+    }
+    if (slowConsumer)
+        *slowConsumer = slowest;
+
+    // Don't fill the last byte, head == tail is the empty condition
+    return ring->size - usedSpace - 1;
+}
+
+// Commit a message to the ring buffer
+//
+// The producer writes the message at the head, the message may extend up to
+// the spill area allocated past the end of the ring buffer.  The producer must
+// verify there is enough space with ringBufferAvailable before writing the
+// message.
+void ringBufferCommit(RING_BUFFER *ring, int32_t length, uint8_t priority, uint8_t filter)
+{
+    uint32_t epoch;
+    uint32_t head;
+    uint16_t offsetHead;
+
+    // Remember the priority class and the filter bits of the message
+    if (ring->priorityArray)
+        ring->priorityArray[ring->offsetHead] = priority;
+    if (ring->filterArray)
+        ring->filterArray[ring->offsetHead] = filter;
+
+    // Move the end of a message written past the end of the ring buffer to
+    // the beginning of the ring buffer
+    head = ring->head;
+    if ((head + length) > (uint32_t)ring->size)
+        memcpy(ring->data, &ring->data[ring->size], head + length - ring->size);
+
+    // Forget the epoch start when the message overwrites it
+    epoch = ring->epoch;
+    if ((epoch != RING_BUFFER_NO_EPOCH) && (epoch != head) && (ringBufferDistance(ring, head, epoch) < length))
+        RING_BUFFER_STORE(ring->epoch, RING_BUFFER_NO_EPOCH);
+
+    // Account for the message
+    WRAP_OFFSET(head, length, (uint32_t)ring->size);
+
+    // Add the head offset to the offset array, the filtered consumers read
+    // the entry after reading offsetHead
+    offsetHead = ring->offsetHead;
+    WRAP_OFFSET(offsetHead, 1, ring->offsetEntries);
+    ring->offsetArray[offsetHead] = head;
+    RING_BUFFER_STORE(ring->offsetHead, offsetHead);
+
+    // Make the message available to the consumers
+    RING_BUFFER_STORE(ring->head, head);
+}
+
+// Discard the oldest messages from the ring buffer to make room for new data,
+// returns the number of bytes discarded and optionally the slow consumer
+int32_t ringBufferDiscard(RING_BUFFER *ring, int32_t bytesNeeded, P_RING_BUFFER_CONSUMER *slowConsumer)
+{
+    int32_t bufferedData;
+    int32_t bytesToDiscard;
+    int consumers;
+    int32_t discardedBytes;
+    int index;
+    int32_t listEnd;
+    int32_t messageLength;
+    uint32_t newTail;
+    uint32_t previousTail;
+    uint8_t priority;
+    int32_t rbOffsetTail;
+    uint32_t tail;
+    int32_t use;
+
+    // Determine the tail of the ring buffer
+    use = ring->size - 1 - ringBufferAvailable(ring, slowConsumer);
+    previousTail = ring->head + ring->size - use;
+    if (previousTail >= (uint32_t)ring->size)
+        previousTail -= ring->size;
+
+    /*  The offsetArray holds the offsets into the ring buffer of the
+     *  start of each of the parsed messages.  The head (offsetHead) is
+     *  updated by the producer as new messages are placed into the ring
+     *  buffer.  The tail (rbOffsetTail) is determined here by walking the
+     *  array from the newest message to the oldest message until the data
+     *  in use by the slowest consumer is described.  The array may be too
+     *  small to hold all of the message offsets for the data in the ring
+     *  buffer, the array is full when (Head + 1) == Tail
+     *
+     *  Notes:
+     *      The first entry offsetArray[0] is initialized to zero (0)
+     *      by ringBufferInit
+     *
+     *      The array always has one entry in it containing the head offset
+     *      which contains a valid offset into the ring buffer
+     *
+     *      The amount of data described by the offsetArray is
+     *      offsetArray[Head] - offsetArray[Tail]
+     *
+     *              offsetArray                      data
+     *           .-----------------.           .-----------------.
+     *           |                 |           |                 |
+     *           +-----------------+           |                 |
+     *  Tail --> |   Msg 1 Offset  |---------->+-----------------+ <-- Tail n
+     *           +-----------------+           |      Msg 1      |
+     *           |   Msg 2 Offset  |--------.  |                 |
+     *           +-----------------+        |  |                 |
+     *           |   Msg 3 Offset  |------. '->+-----------------+
+     *           +-----------------+      |    |      Msg 2      |
+     *  Head --> |   Head Offset   |--.   |    |                 |
+     *           +-----------------+  |   |    |                 |
+     *           |                 |  |   |    |                 |
+     *           +-----------------+  |   |    |                 |
+     *           |                 |  |   '--->+-----------------+
+     *           +-----------------+  |        |      Msg 3      |
+     *           |                 |  |        |                 |
+     *           +-----------------+  '------->+-----------------+ <-- head
+     *           |                 |           |                 |
+     */
+
+    // Determine the index for the end of the circular offset list
+    listEnd = ring->offsetHead;
+    WRAP_OFFSET(listEnd, 1, ring->offsetEntries);
+
+    // Update the tail, walk newest message to oldest message
+    rbOffsetTail = ring->offsetHead;
+    bufferedData = 0;
+    messageLength = 0;
+    while ((rbOffsetTail != listEnd) && (bufferedData < use))
+    {
+        // Determine the amount of data in the ring buffer up until
+        // either the tail or the end of the offsetArray
+        messageLength = ring->offsetArray[rbOffsetTail];
+        WRAP_OFFSET(rbOffsetTail, ring->offsetEntries - 1, ring->offsetEntries);
+        messageLength -= ring->offsetArray[rbOffsetTail];
+        if (messageLength < 0)
+            messageLength += ring->size;
+        bufferedData += messageLength;
+    }
+
+    // Account for any data in the ring buffer not described by the array
+    discardedBytes = 0;
+    if (bufferedData < use)
+        discardedBytes = use - bufferedData;
+
+    // A consumer may have written a partial message leaving the tail
+    // mid-message, remove the remaining portion of the oldest entry
+    else if (bufferedData > use)
+    {
+        discardedBytes = messageLength + use - bufferedData;
+        WRAP_OFFSET(rbOffsetTail, 1, ring->offsetEntries);
+    }
+
+    // rbOffsetTail now points to the beginning of a message in the
+    // ring buffer
+    // Determine the amount of data to discard
+    bytesToDiscard = discardedBytes;
+    if (bytesToDiscard < bytesNeeded)
+        bytesToDiscard = bytesNeeded;
+    if (bytesToDiscard < ring->discardBytes)
+        bytesToDiscard = ring->discardBytes;
+
+    // Walk the ring buffer messages from oldest to newest
+    while ((discardedBytes < bytesToDiscard) && (rbOffsetTail != ring->offsetHead))
+    {
+        // Determine the length of the oldest message
+        messageLength = ring->offsetArray[rbOffsetTail];
+        priority = ring->priorityArray ? ring->priorityArray[rbOffsetTail] : RING_BUFFER_PRIORITY_NORMAL;
+        WRAP_OFFSET(rbOffsetTail, 1, ring->offsetEntries);
+        messageLength = ringBufferDistance(ring, messageLength, ring->offsetArray[rbOffsetTail]);
+        discardedBytes = ringBufferDistance(ring, previousTail, ring->offsetArray[rbOffsetTail]);
+
+        // Account for the discarded message
+        if (priority >= RING_BUFFER_PRIORITY_CLASSES)
+            priority = RING_BUFFER_PRIORITY_CLASSES - 1;
+        ring->droppedMessages[priority] += 1;
+        ring->droppedBytes[priority] += messageLength;
+    }
+    newTail = ring->offsetArray[rbOffsetTail];
+    discardedBytes = ringBufferDistance(ring, previousTail, newTail);
+    if (!discardedBytes)
+        return 0;
+
+    // The longest tail is being trimmed.  Medium length tails may contain
+    // some data within the region begin trimmed.  The shortest tails are
+    // not modified.
+    //
+    // Consumers that get their tails trimmed, may output a partial message
+    // prior to the buffer trimming.  After the trimming, the tail of the
+    // ring buffer points to the beginning of a new message.
+    //
+    //                 previousTail                newTail
+    //                      |                         |
+    //  Before trimming     v         Discarded       v   After trimming
+    //  ----+-----------------  ...  -----+--  ..  ---+-----------+------
+    //      | Partial message             |           |           |
+    //  ----+-----------------  ...  -----+--  ..  ---+-----------+------
+    //                      ^          ^                     ^
+    //                      |          |                     |
+    //        long tail ----'          '--- medium tail      '-- short tail
+    //
+    consumers = RING_BUFFER_LOAD(ring->consumers);
+    for (index = 0; index < consumers; index++)
+    {
+        // Only move the tails within the discarded region, a failed exchange
+        // returns the tail just written by the consumer
+        tail = RING_BUFFER_LOAD(ring->consumer[index]->tail);
+        while (ringBufferDistance(ring, previousTail, tail) < discardedBytes)
+            if (RING_BUFFER_EXCHANGE(ring->consumer[index]->tail, tail, newTail))
+                break;
+    }
+    return discardedBytes;
+}
+
+// Mark the next message committed to the ring buffer as the first message of
+// a navigation epoch
+void ringBufferEpoch(RING_BUFFER *ring)
+{
+    RING_BUFFER_STORE(ring->epoch, ring->head);
+}
+
+// Initialize the ring buffer
+//
+// The data buffer must contain size bytes for the ring buffer plus spill
+// bytes at the end for the longest message written by the producer.
+//
+// The optional priorityArray has offsetEntries entries and records the
+// priority class of each message for the discard statistics.  The optional
+// filterArray has offsetEntries entries and is required by the consumers
+// that filter messages.
+void ringBufferInit(RING_BUFFER *ring, uint8_t *data, int32_t size, RING_BUFFER_OFFSET *offsetArray,
+                    uint8_t *priorityArray, uint8_t *filterArray, uint16_t offsetEntries, int32_t discardBytes)
+{
+    memset(ring, 0, sizeof(*ring));
+    ring->data = data;
+    ring->size = size;
+    ring->discardBytes = discardBytes;
+    ring->epoch = RING_BUFFER_NO_EPOCH;
+    ring->offsetArray = offsetArray;
+    ring->priorityArray = priorityArray;
+    ring->filterArray = filterArray;
+    ring->offsetEntries = offsetEntries;
+    ring->offsetArray[0] = 0;
+}
+
+// Enable or disable the reserves for the higher priority messages
+//
+// When enabled, 1/8, 1/16 and 1/32 of the ring buffer is reserved for the
+// messages with a higher priority than the low, normal and high priority
+// messages, critical messages may use all of the ring buffer.  When
+// disabled, all messages may use the entire ring buffer.
+void ringBufferReserves(RING_BUFFER *ring, bool enable)
+{
+    int priority;
+
+    for (priority = 0; priority < (RING_BUFFER_PRIORITY_CLASSES - 1); priority++)
+        ring->reserveBytes[priority] = enable ? (ring->size >> (priority + 3)) : 0;
+}
+
+// Register a consumer, the consumer receives the messages committed to the
+// ring buffer after the registration
+bool ringBufferRegister(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER consumer)
+{
+    // Verify that there is space for the consumer
+    if (ring->consumers >= RING_BUFFER_MAX_CONSUMERS)
+        return false;
+
+    // Start the consumer at the head
+    consumer->tail = RING_BUFFER_LOAD(ring->head);
+    consumer->offsetIndex = RING_BUFFER_LOAD(ring->offsetHead);
+    consumer->maxMillis = 0;
+    memset(consumer->sendTimes, 0, sizeof(consumer->sendTimes));
+    consumer->maxUsed = 0;
+    consumer->skips = 0;
+    consumer->skippedBytes = 0;
+
+    // Add the consumer to the list
+    ring->consumer[ring->consumers] = consumer;
+    RING_BUFFER_STORE(ring->consumers, ring->consumers + 1);
+    return true;
+}
+
+//----------------------------------------
+// Consumer routines
+//----------------------------------------
+
+// Skip ahead when more than highWater bytes are waiting for the consumer,
+// returns the number of bytes the consumer may send before the next call or
+// zero when the consumer disconnected.  The limit always ends on a message
+// boundary.
+int32_t ringBufferCatchUp(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER consumer)
+{
+    uint32_t epoch;
+    uint32_t head;
+    int32_t index;
+    int32_t next;
+    uint32_t tail;
+    int32_t used;
+
+    head = RING_BUFFER_LOAD(ring->head);
+    tail = RING_BUFFER_LOAD(consumer->tail);
+    used = ringBufferDistance(ring, tail, head);
+    if (consumer->maxUsed < used)
+        consumer->maxUsed = used;
+    if ((!consumer->highWater) || (used <= consumer->highWater))
+        return used;
+
+    // Finish sending the current message before skipping ahead
+    index = ringBufferFindMessage(ring, tail, head);
+    if ((index >= 0) && (ring->offsetArray[index] != tail))
+    {
+        next = index;
+        WRAP_OFFSET(next, 1, ring->offsetEntries);
+        return ringBufferDistance(ring, tail, ring->offsetArray[next]);
+    }
+
+    // Keep sending when the newest epoch started before the tail, unless the
+    // consumer is far behind
+    epoch = RING_BUFFER_LOAD(ring->epoch);
+    if ((epoch != RING_BUFFER_NO_EPOCH) && (ringBufferDistance(ring, tail, epoch) >= used)
+        && (used < (consumer->highWater << 1)))
+        return used;
+
+    // Let the consumer decide between disconnecting and skipping ahead
+    if (consumer->behind && (!consumer->behind(consumer, used)))
+    {
+        ringBufferSkip(ring, consumer);
+        return 0;
+    }
+    ringBufferSkipToEpoch(ring, consumer);
+    return ringBufferUsed(ring, consumer);
+}
+
+// Account for the data passed to the consumer
+//
+// The tail value is the value returned by ringBufferPeek.  When the producer
+// discards data while the consumer is sending, the exchange fails and the
+// tail is set to the offset furthest from the original tail.
+void ringBufferConsumed(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER consumer, uint32_t tail, int32_t length)
+{
+    uint32_t expected;
+    uint32_t newTail;
+
+    if (length <= 0)
+        return;
+
+    // Determine the new tail
+    newTail = tail + length;
+    if (newTail >= (uint32_t)ring->size)
+        newTail -= ring->size;
+
+    // Update the tail
+    expected = tail;
+    while (!RING_BUFFER_EXCHANGE(consumer->tail, expected, newTail))
+    {
+        // The producer discarded data and moved the tail, keep the producer's
+        // tail when the consumer has not sent that data yet
+        if (ringBufferDistance(ring, tail, expected) >= length)
+            break;
+    }
+}
+
+// Locate the data for the consumer, returns the number of bytes that may be
+// read contiguously starting at data
+int32_t ringBufferPeek(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER consumer, uint32_t *tail, const uint8_t **data)
+{
+    uint32_t head;
+    int32_t length;
+
+    // Determine the amount of data in the buffer for this consumer
+    head = RING_BUFFER_LOAD(ring->head);
+    *tail = RING_BUFFER_LOAD(consumer->tail);
+    length = ringBufferDistance(ring, *tail, head);
+
+    // Reduce the length if the data wraps to the beginning of the buffer
+    if ((*tail + length) > (uint32_t)ring->size)
+        length = ring->size - *tail;
+    *data = &ring->data[*tail];
+    return length;
+}
+
+// Pass the messages not filtered by the consumer, returns the number of bytes
+// consumed.  Each send call receives the rest of a single message, or the
+// portion up to the end of the ring buffer when the message wraps.  The data
+// past maxBytes is left for the next call.
+int32_t ringBufferServiceFiltered(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER consumer, int32_t maxBytes)
+{
+    int32_t bytesConsumed;
+    int32_t bytesSent;
+    uint32_t head;
+    int32_t index;
+    int32_t length;
+    int32_t messageLength;
+    int32_t next;
+    uint32_t start;
+    uint32_t tail;
+    int32_t used;
+
+    bytesConsumed = 0;
+    start = RING_BUFFER_LOAD(consumer->tail);
+    while (1)
+    {
+        head = RING_BUFFER_LOAD(ring->head);
+        tail = RING_BUFFER_LOAD(consumer->tail);
+        used = ringBufferDistance(ring, tail, head);
+        if ((!used) || (ringBufferDistance(ring, start, tail) >= maxBytes))
+            break;
+
+        // Locate the message containing the tail, the tail moves to the
+        // beginning of a message when the producer discards data
+        index = consumer->offsetIndex;
+        if (!ringBufferMessageValid(ring, index, tail, head))
+        {
+            index = ringBufferFindMessage(ring, tail, head);
+            if (index < 0)
+            {
+                // The message boundaries are unknown, skip the data
+                ringBufferConsumed(ring, consumer, tail, used);
+                break;
+            }
+            consumer->offsetIndex = index;
+        }
+        next = index;
+        WRAP_OFFSET(next, 1, ring->offsetEntries);
+        messageLength = ringBufferDistance(ring, tail, ring->offsetArray[next]);
+
+        // Skip the messages filtered by this consumer
+        if (ring->filterArray[index] & consumer->filter)
+        {
+            ringBufferConsumed(ring, consumer, tail, messageLength);
+            consumer->offsetIndex = next;
+            continue;
+        }
+
+        // Reduce the length if the message wraps to the beginning of the buffer
+        length = messageLength;
+        if ((tail + length) > (uint32_t)ring->size)
+            length = ring->size - tail;
+
+        // Pass the message to the consumer
+        consumer->messageEnd = (length == messageLength);
+        bytesSent = consumer->send(consumer, &ring->data[tail], length);
+        if (bytesSent <= 0)
+            break;
+        if (bytesSent > length)
+            bytesSent = length;
+        ringBufferConsumed(ring, consumer, tail, bytesSent);
+        bytesConsumed += bytesSent;
+        if (bytesSent == messageLength)
+            consumer->offsetIndex = next;
+
+        // Stop when the consumer is busy
+        if (bytesSent < length)
+            break;
+    }
+    return bytesConsumed;
+}
+
+// Pass the data in the ring buffer to the consumer, returns the number of
+// bytes consumed
+int32_t ringBufferService(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER consumer)
+{
+    int32_t bytesConsumed;
+    int32_t bytesSent;
+    const uint8_t *data;
+    int32_t length;
+    int32_t maxBytes;
+    int pass;
+    uint32_t tail;
+
+    // Discard the data when the consumer is not connected
+    if (consumer->connected && (!consumer->connected(consumer)))
+    {
+        ringBufferSkip(ring, consumer);
+        return 0;
+    }
+
+    // Skip ahead when the consumer falls behind
+    maxBytes = ringBufferCatchUp(ring, consumer);
+    if (!maxBytes)
+        return 0;
+
+    // Only send the messages accepted by the consumer
+    if (consumer->filter && ring->filterArray)
+        return ringBufferServiceFiltered(ring, consumer, maxBytes);
+
+    // The second pass sends the data that wrapped to the beginning of the
+    // ring buffer
+    bytesConsumed = 0;
+    for (pass = 0; pass < 2; pass++)
+    {
+        length = ringBufferPeek(ring, consumer, &tail, &data);
+        if (length > (maxBytes - bytesConsumed))
+            length = maxBytes - bytesConsumed;
+        if (!length)
+            break;
+
+        // Pass the data to the consumer, the data ends on a message boundary
+        // unless it wraps since the head and maxBytes are always at a message
+        // boundary
+        consumer->messageEnd = ((tail + length) < (uint32_t)ring->size) || (!RING_BUFFER_LOAD(ring->head));
+        bytesSent = consumer->send(consumer, data, length);
+        if (bytesSent <= 0)
+            break;
+        if (bytesSent > length)
+            bytesSent = length;
+        ringBufferConsumed(ring, consumer, tail, bytesSent);
+        bytesConsumed += bytesSent;
+
+        // Stop when the consumer is busy
+        if (bytesSent < length)
+            break;
+    }
+    return bytesConsumed;
+}
+
+// Discard all of the data for this consumer
+void ringBufferSkip(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER consumer)
+{
+    uint32_t tail;
+
+    // When the producer moves the tail, the data is skipped on the next call
+    tail = RING_BUFFER_LOAD(consumer->tail);
+    RING_BUFFER_EXCHANGE(consumer->tail, tail, RING_BUFFER_LOAD(ring->head));
+}
+
+// Move the consumer's tail ahead to the start of the newest epoch, or to the
+// head when the start of the epoch is not in the consumer's data
+void ringBufferSkipToEpoch(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER consumer)
+{
+    uint32_t epoch;
+    uint32_t head;
+    uint32_t newTail;
+    uint32_t tail;
+
+    head = RING_BUFFER_LOAD(ring->head);
+    epoch = RING_BUFFER_LOAD(ring->epoch);
+    tail = RING_BUFFER_LOAD(consumer->tail);
+    newTail = head;
+    if ((epoch != RING_BUFFER_NO_EPOCH) && (ringBufferDistance(ring, tail, epoch) < ringBufferDistance(ring, tail, head)))
+        newTail = epoch;
+    if (newTail == tail)
+        return;
+
+    // A failed exchange means the producer discarded the data and already
+    // moved the tail to a message boundary
+    if (RING_BUFFER_EXCHANGE(consumer->tail, tail, newTail))
+    {
+        consumer->skips += 1;
+        consumer->skippedBytes += ringBufferDistance(ring, tail, newTail);
+    }
+}
+
+// Determine the number of bytes in the ring buffer for this consumer
+int32_t ringBufferUsed(RING_BUFFER *ring, P_RING_BUFFER_CONSUMER consumer)
+{
+    return ringBufferDistance(ring, RING_BUFFER_LOAD(consumer->tail), RING_BUFFER_LOAD(ring->head));
+}
+
+//----------------------------------------
+// Send time routines
+//----------------------------------------
+
+// Determine the send time for a percentage of the send calls, returns the
+// time in milliseconds that the send calls completed within
+uint32_t ringBufferSendTimePercentile(P_RING_BUFFER_CONSUMER consumer, int percent)
+{
+    int bucket;
+    uint64_t count;
+    uint64_t total;
+    uint32_t upperBound;
+
+    // Determine the number of send calls within the percentage
+    total = 0;
+    for (bucket = 0; bucket < RING_BUFFER_SEND_TIME_BUCKETS; bucket++)
+        total += consumer->sendTimes[bucket];
+    total = ((total * percent) + 99) / 100;
+    if (!total)
+        return 0;
+
+    // Locate the bucket containing the percentile
+    count = 0;
+    for (bucket = 0; bucket < (RING_BUFFER_SEND_TIME_BUCKETS - 1); bucket++)
+    {
+        count += consumer->sendTimes[bucket];
+        if (count >= total)
+            break;
+    }
+
+    // Return the upper bound of the bucket, limited by the maximum time
+    upperBound = 1 << bucket;
+    if ((bucket == (RING_BUFFER_SEND_TIME_BUCKETS - 1)) || (upperBound > (consumer->maxMillis + 1)))
+        upperBound = consumer->maxMillis + 1;
+    return upperBound;
+}
+
+// Account for the time spent in the send routine
+void ringBufferSendTime(P_RING_BUFFER_CONSUMER consumer, uint32_t milliseconds)
+{
+    int bucket;
+
+    // Remember the maximum transfer time
+    if (consumer->maxMillis < milliseconds)
+        consumer->maxMillis = milliseconds;
+
+    // Bucket 0 holds 0 milliseconds, bucket n holds 2^(n-1) to (2^n) - 1
+    // milliseconds
+    bucket = 0;
+    while ((bucket < (RING_BUFFER_SEND_TIME_BUCKETS - 1)) && (milliseconds >> bucket))
+        bucket += 1;
+    consumer->sendTimes[bucket] += 1;
+}
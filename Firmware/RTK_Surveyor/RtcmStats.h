@@ -0,0 +1,72 @@
+/*------------------------------------------------------------------------------
+RtcmStats.h
+
+  Constant, type and routine declarations for the RTCM message statistics
+  kept by the NTRIP client.  The routines in RtcmStats.ino do not depend upon
+  the Arduino environment and are also built by the programs in the Tools
+  directory.
+------------------------------------------------------------------------------*/
+
+#ifndef __RTCM_STATS_H__
+#define __RTCM_STATS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+//----------------------------------------
+// Constants
+//----------------------------------------
+
+#define RTCM_STATS_MAX_TYPES 24    // Message types tracked, others are only counted
+#define RTCM_STATS_HEADER_BYTES 3  // Preamble and length
+#define RTCM_STATS_CRC_BYTES 3     // CRC-24Q
+
+#define RTCM_STATS_MS_PER_DAY (24 * 60 * 60 * 1000)
+#define RTCM_STATS_MS_PER_WEEK (7 * RTCM_STATS_MS_PER_DAY)
+
+#define RTCM_STATS_NO_TIME -1      // Current GPS time is not known
+
+//----------------------------------------
+// Types
+//----------------------------------------
+
+// Statistics for a single RTCM message type
+typedef struct _RTCM_STATS_MESSAGE
+{
+    uint16_t message;              // RTCM message number
+    uint32_t count;                // Messages received
+    uint32_t bytes;                // Bytes received including the framing
+    uint32_t arrivalMsec;          // millis() value when the last message arrived
+    uint32_t intervalMsec;         // Time between the last two arrivals
+    int32_t latencyMsec;           // Arrival time minus the message epoch time
+    int32_t latencyMinMsec;        // Smallest latency
+    int32_t latencyMaxMsec;        // Largest latency
+    int64_t latencyTotalMsec;      // Sum of the latencies for the average
+    uint32_t latencyCount;         // Number of latency values
+} RTCM_STATS_MESSAGE;
+
+// Statistics for an RTCM stream
+typedef struct _RTCM_STATS
+{
+    RTCM_STATS_MESSAGE type[RTCM_STATS_MAX_TYPES]; // Sorted by message number
+    uint8_t types;                 // Number of valid type entries
+    uint32_t messages;             // Messages received
+    uint32_t bytes;                // Bytes received in the messages
+    uint32_t untracked;            // Messages received when the type table is full
+    uint32_t startMsec;            // millis() value when the statistics were cleared
+} RTCM_STATS;
+
+//----------------------------------------
+// RTCM statistics routines
+//----------------------------------------
+
+uint32_t rtcmStatsEpoch(const uint8_t *message, uint16_t length, int leapSeconds, uint32_t *epochMsec);
+void rtcmStatsInit(RTCM_STATS *stats, uint32_t currentMsec);
+int32_t rtcmStatsLatency(uint32_t nowMsec, uint32_t epochMsec, uint32_t period);
+bool rtcmStatsMoreMessages(const uint8_t *message, uint16_t length);
+uint16_t rtcmStatsMessageNumber(const uint8_t *message, uint16_t length);
+RTCM_STATS_MESSAGE *rtcmStatsUpdate(RTCM_STATS *stats, const uint8_t *message, uint16_t length,
+                                    uint32_t arrivalMsec, int32_t gpsTowMsec, int leapSeconds);
+
+#endif // __RTCM_STATS_H__
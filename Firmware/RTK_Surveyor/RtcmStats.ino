@@ -0,0 +1,263 @@
+/*------------------------------------------------------------------------------
+RtcmStats.ino
+
+  Per message type statistics for an RTCM correction stream.
+
+  The NTRIP client passes each complete RTCM message with a valid CRC to
+  rtcmStatsUpdate along with the arrival time and the current GPS time of
+  week.  The message count, byte count and arrival interval are kept for each
+  message type.  For the observation messages (legacy GPS and GLONASS, and
+  the MSM messages of all constellations) the epoch time is extracted from
+  the message header and converted to the GPS time of week.  The difference
+  between the arrival time and the epoch time is the latency of the
+  correction data, which includes the base station, caster and network delays
+  and directly limits the age of the corrections used by the RTK solution.
+
+    Message     Epoch time field                   Conversion to GPS time
+    ---------   --------------------------------   ----------------------
+    1001-1004   GPS TOW, 30 bits                   None
+    1009-1012   GLONASS time of day, 27 bits       - 3 hours + leap seconds
+    1071-1077   GPS TOW, 30 bits                   None
+    1081-1087   Day of week 3 bits, time of day    - 3 hours + leap seconds
+    1091-1097   Galileo TOW, 30 bits               None
+    1101-1107   SBAS TOW, 30 bits                  None
+    1111-1117   QZSS TOW, 30 bits                  None
+    1121-1127   BeiDou TOW, 30 bits                + 14 seconds
+    1131-1137   NavIC TOW, 30 bits                 None
+
+  The epoch time field follows the 12-bit message number and the 12-bit
+  reference station ID in all of these messages.  The bit after the epoch
+  time (the synchronous GNSS flag in the legacy messages and the multiple
+  message bit in the MSM messages) is set when more observation messages
+  follow for the same epoch.
+------------------------------------------------------------------------------*/
+
+//----------------------------------------
+// Constants
+//----------------------------------------
+
+#define RTCM_STATS_GLONASS_OFFSET_MSEC (3 * 60 * 60 * 1000) // Moscow time is UTC + 3 hours
+#define RTCM_STATS_BEIDOU_OFFSET_MSEC (14 * 1000)           // BDT is GPS time - 14 seconds
+#define RTCM_STATS_EPOCH_BIT 24                            // After message number and station ID
+
+//----------------------------------------
+// Support routines
+//----------------------------------------
+
+// Extract an unsigned bit field from the RTCM message payload
+static uint32_t rtcmStatsBits(const uint8_t *payload, int start, int width)
+{
+    uint32_t value;
+
+    value = 0;
+    while (width-- > 0)
+    {
+        value = (value << 1) | ((payload[start >> 3] >> (7 - (start & 7))) & 1);
+        start += 1;
+    }
+    return value;
+}
+
+// Reduce the time value to the range 0 to period - 1
+static uint32_t rtcmStatsWrap(int64_t msec, uint32_t period)
+{
+    msec %= period;
+    if (msec < 0)
+        msec += period;
+    return (uint32_t)msec;
+}
+
+//----------------------------------------
+// RTCM statistics routines
+//----------------------------------------
+
+// Get the epoch time of the message as GPS time in milliseconds.  Returns the
+// period of the epoch time: RTCM_STATS_MS_PER_WEEK when the time of week is
+// known, RTCM_STATS_MS_PER_DAY when only the time of day is known and zero
+// when the message does not contain an epoch time.
+uint32_t rtcmStatsEpoch(const uint8_t *message, uint16_t length, int leapSeconds, uint32_t *epochMsec)
+{
+    uint32_t dayOfWeek;
+    uint16_t messageNumber;
+    uint32_t msec;
+    const uint8_t *payload;
+
+    // Verify that the epoch time is present in the message
+    if (length < (RTCM_STATS_HEADER_BYTES + 7 + RTCM_STATS_CRC_BYTES))
+        return 0;
+    payload = &message[RTCM_STATS_HEADER_BYTES];
+    messageNumber = rtcmStatsMessageNumber(message, length);
+
+    // GPS legacy and MSM, Galileo, SBAS, QZSS and NavIC MSM: time of week
+    if (((messageNumber >= 1001) && (messageNumber <= 1004))
+        || ((messageNumber >= 1071) && (messageNumber <= 1077))
+        || ((messageNumber >= 1091) && (messageNumber <= 1117))
+        || ((messageNumber >= 1131) && (messageNumber <= 1137)))
+    {
+        msec = rtcmStatsBits(payload, RTCM_STATS_EPOCH_BIT, 30);
+        if (msec >= RTCM_STATS_MS_PER_WEEK)
+            return 0;
+        *epochMsec = msec;
+        return RTCM_STATS_MS_PER_WEEK;
+    }
+
+    // BeiDou MSM: BDT time of week
+    if ((messageNumber >= 1121) && (messageNumber <= 1127))
+    {
+        msec = rtcmStatsBits(payload, RTCM_STATS_EPOCH_BIT, 30);
+        if (msec >= RTCM_STATS_MS_PER_WEEK)
+            return 0;
+        *epochMsec = rtcmStatsWrap((int64_t)msec + RTCM_STATS_BEIDOU_OFFSET_MSEC, RTCM_STATS_MS_PER_WEEK);
+        return RTCM_STATS_MS_PER_WEEK;
+    }
+
+    // GLONASS MSM: day of week and time of day in Moscow time, day of week 7
+    // indicates that the day is not known
+    if ((messageNumber >= 1081) && (messageNumber <= 1087))
+    {
+        dayOfWeek = rtcmStatsBits(payload, RTCM_STATS_EPOCH_BIT, 3);
+        msec = rtcmStatsBits(payload, RTCM_STATS_EPOCH_BIT + 3, 27);
+        if (msec >= RTCM_STATS_MS_PER_DAY)
+            return 0;
+        if (dayOfWeek < 7)
+        {
+            *epochMsec = rtcmStatsWrap((int64_t)dayOfWeek * RTCM_STATS_MS_PER_DAY + msec
+                                       - RTCM_STATS_GLONASS_OFFSET_MSEC + leapSeconds * 1000,
+                                       RTCM_STATS_MS_PER_WEEK);
+            return RTCM_STATS_MS_PER_WEEK;
+        }
+        *epochMsec = rtcmStatsWrap((int64_t)msec - RTCM_STATS_GLONASS_OFFSET_MSEC + leapSeconds * 1000,
+                                   RTCM_STATS_MS_PER_DAY);
+        return RTCM_STATS_MS_PER_DAY;
+    }
+
+    // GLONASS legacy: time of day in Moscow time
+    if ((messageNumber >= 1009) && (messageNumber <= 1012))
+    {
+        msec = rtcmStatsBits(payload, RTCM_STATS_EPOCH_BIT, 27);
+        if (msec >= RTCM_STATS_MS_PER_DAY)
+            return 0;
+        *epochMsec = rtcmStatsWrap((int64_t)msec - RTCM_STATS_GLONASS_OFFSET_MSEC + leapSeconds * 1000,
+                                   RTCM_STATS_MS_PER_DAY);
+        return RTCM_STATS_MS_PER_DAY;
+    }
+
+    // No epoch time in this message
+    return 0;
+}
+
+// Clear the statistics
+void rtcmStatsInit(RTCM_STATS *stats, uint32_t currentMsec)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->startMsec = currentMsec;
+}
+
+// Compute the latency from the epoch time to the current time, both values
+// are GPS times in milliseconds modulo the period.  The latency is in the
+// range -period/2 to period/2 so that a receiver clock slightly behind the
+// base station produces a small negative value.
+int32_t rtcmStatsLatency(uint32_t nowMsec, uint32_t epochMsec, uint32_t period)
+{
+    uint32_t latency;
+
+    latency = rtcmStatsWrap((int64_t)(nowMsec % period) - epochMsec, period);
+    if (latency >= (period / 2))
+        return (int32_t)latency - (int32_t)period;
+    return (int32_t)latency;
+}
+
+// Determine if more observation messages follow for the same epoch, returns
+// false for the last message of the epoch and for messages without an epoch
+bool rtcmStatsMoreMessages(const uint8_t *message, uint16_t length)
+{
+    uint16_t messageNumber;
+    const uint8_t *payload;
+
+    if (length < (RTCM_STATS_HEADER_BYTES + 7 + RTCM_STATS_CRC_BYTES))
+        return false;
+    payload = &message[RTCM_STATS_HEADER_BYTES];
+    messageNumber = rtcmStatsMessageNumber(message, length);
+
+    // GLONASS legacy: 27-bit time of day
+    if ((messageNumber >= 1009) && (messageNumber <= 1012))
+        return rtcmStatsBits(payload, RTCM_STATS_EPOCH_BIT + 27, 1) != 0;
+
+    // GPS legacy and all of the MSM messages: 30-bit epoch time
+    if (((messageNumber >= 1001) && (messageNumber <= 1004))
+        || ((messageNumber >= 1071) && (messageNumber <= 1137) && ((messageNumber % 10) >= 1)
+            && ((messageNumber % 10) <= 7)))
+        return rtcmStatsBits(payload, RTCM_STATS_EPOCH_BIT + 30, 1) != 0;
+    return false;
+}
+
+// Get the message number from the RTCM message, returns zero when the message
+// is too short
+uint16_t rtcmStatsMessageNumber(const uint8_t *message, uint16_t length)
+{
+    if (length < (RTCM_STATS_HEADER_BYTES + 2 + RTCM_STATS_CRC_BYTES))
+        return 0;
+    return (message[RTCM_STATS_HEADER_BYTES] << 4) | (message[RTCM_STATS_HEADER_BYTES + 1] >> 4);
+}
+
+// Account for a complete RTCM message, gpsTowMsec is the GPS time of week
+// when the message arrived or RTCM_STATS_NO_TIME when the time is not known.
+// Returns the statistics for the message type or NULL when the type table
+// is full.
+RTCM_STATS_MESSAGE *rtcmStatsUpdate(RTCM_STATS *stats, const uint8_t *message, uint16_t length,
+                                    uint32_t arrivalMsec, int32_t gpsTowMsec, int leapSeconds)
+{
+    uint32_t epochMsec;
+    RTCM_STATS_MESSAGE *entry;
+    int index;
+    int32_t latency;
+    uint16_t messageNumber;
+    uint32_t period;
+
+    stats->messages += 1;
+    stats->bytes += length;
+
+    // Locate the message type, the table is sorted by message number
+    messageNumber = rtcmStatsMessageNumber(message, length);
+    for (index = 0; index < stats->types; index++)
+        if (stats->type[index].message >= messageNumber)
+            break;
+    if ((index >= stats->types) || (stats->type[index].message != messageNumber))
+    {
+        // Add the message type to the table
+        if (stats->types >= RTCM_STATS_MAX_TYPES)
+        {
+            stats->untracked += 1;
+            return NULL;
+        }
+        memmove(&stats->type[index + 1], &stats->type[index], (stats->types - index) * sizeof(stats->type[0]));
+        stats->types += 1;
+        entry = &stats->type[index];
+        memset(entry, 0, sizeof(*entry));
+        entry->message = messageNumber;
+    }
+    entry = &stats->type[index];
+
+    // Update the counts and the arrival interval
+    if (entry->count)
+        entry->intervalMsec = arrivalMsec - entry->arrivalMsec;
+    entry->count += 1;
+    entry->bytes += length;
+    entry->arrivalMsec = arrivalMsec;
+
+    // Compute the latency of the correction data
+    if (gpsTowMsec == RTCM_STATS_NO_TIME)
+        return entry;
+    period = rtcmStatsEpoch(message, length, leapSeconds, &epochMsec);
+    if (!period)
+        return entry;
+    latency = rtcmStatsLatency(gpsTowMsec, epochMsec, period);
+    if ((!entry->latencyCount) || (latency < entry->latencyMinMsec))
+        entry->latencyMinMsec = latency;
+    if ((!entry->latencyCount) || (latency > entry->latencyMaxMsec))
+        entry->latencyMaxMsec = latency;
+    entry->latencyMsec = latency;
+    entry->latencyTotalMsec += latency;
+    entry->latencyCount += 1;
+    return entry;
+}
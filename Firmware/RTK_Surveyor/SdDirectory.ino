@@ -0,0 +1,654 @@
+/*
+SdDirectory.ino
+
+  In memory index of the files in the root directory of the microSD card.
+  The index is built once when the microSD card comes online and is then
+  updated as files are created, closed and removed.  The index provides the
+  sorted file list, the last log file and the total size of the files without
+  holding the sdCardSemaphore while the directory is scanned.  The changes in
+  the file sizes are passed to SdFreeSpace.ino to keep sdFreeSpace current.
+
+  The entries are kept sorted by file name.  The names are stored in a single
+  block of memory to reduce the heap overhead for cards with thousands of
+  log files.  When the heap runs out the index is marked invalid and the
+  callers fall back to scanning the directory.  The sizeOrder array holds the
+  entry indexes sorted by file size, ties sorted by name, and is updated with
+  the entries so that the size sorted queries walk the index once.
+
+                     sdDirectory.entries        sdDirectory.names
+                      .-------------.          .-------------------.
+                      | nameOffset -+--------->| SFE_..._0101.ubx\0|
+                      | size        |          |                   |
+                      +-------------+          |                   |
+                      | nameOffset -+--------->| SFE_..._0102.ubx\0|
+                      | size        |          |                   |
+                      +-------------+          |                   |
+                      :             :          :                   :
+*/
+
+//----------------------------------------
+// Constants
+//----------------------------------------
+
+#define SD_DIRECTORY_ENTRY_INCREMENT 64    // Entries added when the entry array is full
+#define SD_DIRECTORY_NAMES_INCREMENT 2048  // Bytes added when the name block is full
+
+//----------------------------------------
+// Locals
+//----------------------------------------
+
+static SD_DIRECTORY sdDirectory;
+static SemaphoreHandle_t sdDirectoryMutex;
+
+//----------------------------------------
+// Support routines
+//----------------------------------------
+
+// Skip the leading slash in the file name
+const char *sdDirectoryName(const char *fileName)
+{
+    if (*fileName == '/')
+        fileName++;
+    return fileName;
+}
+
+// Get the file name for an entry
+const char *sdDirectoryEntryName(int index)
+{
+    return &sdDirectory.names[sdDirectory.entries[index].nameOffset];
+}
+
+// Get the size of the file for an entry
+uint64_t sdDirectoryEntrySize(int index)
+{
+    // The size of the open log file changes with each write
+    if (online.logging && (strcmp(sdDirectoryEntryName(index), sdDirectoryName(logFileName)) == 0))
+        return fileSize;
+    return sdDirectory.entries[index].size;
+}
+
+// Determine if the file is the open log file, sdLogWriteBuffer accounts for
+// the space used by the log file as it is written
+bool sdDirectoryOpenLog(const char *fileName)
+{
+    return ubxFile && (strcmp(fileName, sdDirectoryName(logFileName)) == 0);
+}
+
+// Compare two entries by file size, the entry index breaks ties between
+// files of the same size
+int sdDirectorySizeCompare(int index1, int index2)
+{
+    if (sdDirectory.entries[index1].size != sdDirectory.entries[index2].size)
+        return (sdDirectory.entries[index1].size < sdDirectory.entries[index2].size) ? -1 : 1;
+    return index1 - index2;
+}
+
+// Compare two size order entries for qsort
+int sdDirectorySizeOrderCompare(const void *index1, const void *index2)
+{
+    return sdDirectorySizeCompare(*(const int *)index1, *(const int *)index2);
+}
+
+// Locate the entry in the first count entries of the size order, returns the
+// position when found, otherwise returns -(insertion position) - 1
+int sdDirectorySizeFind(int index, int count)
+{
+    int compare;
+    int high;
+    int low;
+    int middle;
+
+    low = 0;
+    high = count - 1;
+    while (low <= high)
+    {
+        middle = (low + high) / 2;
+        compare = sdDirectorySizeCompare(sdDirectory.sizeOrder[middle], index);
+        if (compare == 0)
+            return middle;
+        if (compare < 0)
+            low = middle + 1;
+        else
+            high = middle - 1;
+    }
+    return -low - 1;
+}
+
+// Add the entry to the size order, the entry is already in the first count
+// entries of the size order when the size of an existing file changed, the
+// caller must hold the sdDirectoryMutex
+void sdDirectorySizeInsert(int index, int count)
+{
+    int position;
+
+    position = sdDirectorySizeFind(index, count);
+    if (position < 0)
+        position = -position - 1;
+    memmove(&sdDirectory.sizeOrder[position + 1], &sdDirectory.sizeOrder[position],
+            (count - position) * sizeof(int));
+    sdDirectory.sizeOrder[position] = index;
+}
+
+// Remove the entry from the size order, the caller must hold the sdDirectoryMutex
+void sdDirectorySizeRemove(int index)
+{
+    int position;
+
+    position = sdDirectorySizeFind(index, sdDirectory.entryCount);
+    if (position >= 0)
+        memmove(&sdDirectory.sizeOrder[position], &sdDirectory.sizeOrder[position + 1],
+                (sdDirectory.entryCount - 1 - position) * sizeof(int));
+}
+
+// Renumber the entries in the size order after an entry is added or removed
+// at index, the caller must hold the sdDirectoryMutex
+void sdDirectorySizeRenumber(int index, int count, int delta)
+{
+    int position;
+
+    for (position = 0; position < count; position++)
+        if (sdDirectory.sizeOrder[position] >= index)
+            sdDirectory.sizeOrder[position] += delta;
+}
+
+// Locate the entry for the file name, returns the index of the entry when
+// found, otherwise returns -(insertion index) - 1
+int sdDirectoryFind(const char *fileName)
+{
+    int compare;
+    int high;
+    int low;
+    int middle;
+
+    low = 0;
+    high = sdDirectory.entryCount - 1;
+    while (low <= high)
+    {
+        middle = (low + high) / 2;
+        compare = strcmp(sdDirectoryEntryName(middle), fileName);
+        if (compare == 0)
+            return middle;
+        if (compare < 0)
+            low = middle + 1;
+        else
+            high = middle - 1;
+    }
+    return -low - 1;
+}
+
+// Remove the unused space from the name block
+void sdDirectoryCompact()
+{
+    char *names;
+    uint32_t namesLength;
+    int index;
+    int length;
+
+    names = (char *)malloc(sdDirectory.namesMax);
+    if (!names)
+        return;
+
+    namesLength = 0;
+    for (index = 0; index < sdDirectory.entryCount; index++)
+    {
+        length = strlen(sdDirectoryEntryName(index)) + 1;
+        memcpy(&names[namesLength], sdDirectoryEntryName(index), length);
+        sdDirectory.entries[index].nameOffset = namesLength;
+        namesLength += length;
+    }
+    free(sdDirectory.names);
+    sdDirectory.names = names;
+    sdDirectory.namesLength = namesLength;
+    sdDirectory.namesUnused = 0;
+}
+
+// Make room for another entry and its name, the caller must hold the sdDirectoryMutex
+bool sdDirectoryGrow(int nameLength)
+{
+    SD_DIRECTORY_ENTRY *entries;
+    char *names;
+    uint32_t namesMax;
+    int *sizeOrder;
+
+    // Make room for the entry
+    if (sdDirectory.entryCount >= sdDirectory.entryMax)
+    {
+        entries = (SD_DIRECTORY_ENTRY *)realloc(sdDirectory.entries, (sdDirectory.entryMax
+                                                + SD_DIRECTORY_ENTRY_INCREMENT) * sizeof(SD_DIRECTORY_ENTRY));
+        if (!entries)
+            return false;
+        sdDirectory.entries = entries;
+        sizeOrder = (int *)realloc(sdDirectory.sizeOrder, (sdDirectory.entryMax
+                                   + SD_DIRECTORY_ENTRY_INCREMENT) * sizeof(int));
+        if (!sizeOrder)
+            return false;
+        sdDirectory.sizeOrder = sizeOrder;
+        sdDirectory.entryMax += SD_DIRECTORY_ENTRY_INCREMENT;
+    }
+
+    // Make room for the name
+    if ((sdDirectory.namesLength + nameLength) > sdDirectory.namesMax)
+    {
+        namesMax = sdDirectory.namesMax + SD_DIRECTORY_NAMES_INCREMENT;
+        if (namesMax < (sdDirectory.namesLength + nameLength))
+            namesMax = sdDirectory.namesLength + nameLength;
+        names = (char *)realloc(sdDirectory.names, namesMax);
+        if (!names)
+            return false;
+        sdDirectory.names = names;
+        sdDirectory.namesMax = namesMax;
+    }
+    return true;
+}
+
+// Add an entry at the specified index, the caller must hold the sdDirectoryMutex
+bool sdDirectoryAdd(int index, const char *fileName, uint64_t fileSize)
+{
+    int length;
+    uint32_t size;
+
+    length = strlen(fileName) + 1;
+    if (!sdDirectoryGrow(length))
+        return false;
+
+    // Files larger than 4 GB are only possible with exFAT
+    size = (fileSize > 0xffffffff) ? 0xffffffff : fileSize;
+
+    memmove(&sdDirectory.entries[index + 1], &sdDirectory.entries[index],
+            (sdDirectory.entryCount - index) * sizeof(SD_DIRECTORY_ENTRY));
+    memcpy(&sdDirectory.names[sdDirectory.namesLength], fileName, length);
+    sdDirectory.entries[index].nameOffset = sdDirectory.namesLength;
+    sdDirectory.entries[index].size = size;
+    sdDirectory.namesLength += length;
+    sdDirectory.entryCount += 1;
+    sdDirectory.totalBytes += size;
+    return true;
+}
+
+// Add or update a file in sorted order, the caller must hold the sdDirectoryMutex
+bool sdDirectoryInsert(const char *fileName, uint64_t fileSize)
+{
+    int index;
+    uint32_t size;
+
+    // Update an existing entry
+    index = sdDirectoryFind(fileName);
+    if (index >= 0)
+    {
+        size = (fileSize > 0xffffffff) ? 0xffffffff : fileSize;
+        if (size == sdDirectory.entries[index].size)
+            return true;
+        if (!sdDirectoryOpenLog(fileName))
+            sdFreeSpaceAdjust(sdDirectory.entries[index].size, size);
+        sdDirectory.totalBytes += size;
+        sdDirectory.totalBytes -= sdDirectory.entries[index].size;
+
+        // Move the entry to its new position in the size order
+        sdDirectorySizeRemove(index);
+        sdDirectory.entries[index].size = size;
+        sdDirectorySizeInsert(index, sdDirectory.entryCount - 1);
+        return true;
+    }
+
+    // Add the entry in sorted order
+    if (!sdDirectoryOpenLog(fileName))
+        sdFreeSpaceAdjust(0, fileSize);
+    index = -index - 1;
+    if (!sdDirectoryAdd(index, fileName, fileSize))
+        return false;
+
+    // Add the entry to the size order
+    sdDirectorySizeRenumber(index, sdDirectory.entryCount - 1, 1);
+    sdDirectorySizeInsert(index, sdDirectory.entryCount - 1);
+    return true;
+}
+
+// Compare two entries by file name for qsort
+int sdDirectoryCompare(const void *entry1, const void *entry2)
+{
+    return strcmp(&sdDirectory.names[((const SD_DIRECTORY_ENTRY *)entry1)->nameOffset],
+                  &sdDirectory.names[((const SD_DIRECTORY_ENTRY *)entry2)->nameOffset]);
+}
+
+//----------------------------------------
+// Index routines
+//----------------------------------------
+
+// Build the index of the root directory, the caller must hold the sdCardSemaphore
+void sdDirectoryBuild()
+{
+    char fileName[100]; // Handle long file names
+    bool valid;
+
+    if (!sdDirectoryMutex)
+    {
+        sdDirectoryMutex = xSemaphoreCreateMutex();
+        if (!sdDirectoryMutex)
+            return;
+    }
+    sdDirectoryFree();
+
+    xSemaphoreTake(sdDirectoryMutex, portMAX_DELAY);
+    valid = true;
+    if (USE_SPI_MICROSD)
+    {
+        SdFile dir;
+        SdFile file;
+
+        dir.open("/"); // Open root
+        while (valid && file.openNext(&dir, O_READ))
+        {
+            if (file.isFile())
+            {
+                file.getName(fileName, sizeof(fileName));
+                valid = sdDirectoryAdd(sdDirectory.entryCount, fileName, file.fileSize());
+            }
+            file.close();
+        }
+        dir.close();
+    }
+#ifdef COMPILE_SD_MMC
+    else
+    {
+        File dir = SD_MMC.open("/"); // Open root
+
+        if (dir && dir.isDirectory())
+        {
+            File file = dir.openNextFile();
+            while (valid && file)
+            {
+                if (!file.isDirectory())
+                    valid = sdDirectoryAdd(sdDirectory.entryCount, sdDirectoryName(file.name()), file.size());
+                file.close();
+                file = dir.openNextFile();
+            }
+        }
+        dir.close();
+    }
+#endif // COMPILE_SD_MMC
+
+    // Sort the entries by file name, then build the size order
+    if (valid)
+    {
+        qsort(sdDirectory.entries, sdDirectory.entryCount, sizeof(SD_DIRECTORY_ENTRY), sdDirectoryCompare);
+        for (int index = 0; index < sdDirectory.entryCount; index++)
+            sdDirectory.sizeOrder[index] = index;
+        qsort(sdDirectory.sizeOrder, sdDirectory.entryCount, sizeof(int), sdDirectorySizeOrderCompare);
+    }
+    sdDirectory.valid = valid;
+    xSemaphoreGive(sdDirectoryMutex);
+
+    if (settings.enablePrintLogFileStatus)
+        systemPrintf("microSD directory index: %d files, %d name bytes%s\r\n", sdDirectory.entryCount,
+                     sdDirectory.namesLength, valid ? "" : ", out of memory");
+    if (!valid)
+        sdDirectoryFree();
+}
+
+// Discard the index
+void sdDirectoryFree()
+{
+    if (!sdDirectoryMutex)
+        return;
+    xSemaphoreTake(sdDirectoryMutex, portMAX_DELAY);
+    if (sdDirectory.entries)
+        free(sdDirectory.entries);
+    if (sdDirectory.names)
+        free(sdDirectory.names);
+    if (sdDirectory.sizeOrder)
+        free(sdDirectory.sizeOrder);
+    memset(&sdDirectory, 0, sizeof(sdDirectory));
+    xSemaphoreGive(sdDirectoryMutex);
+}
+
+// Determine if the file name matches the extension and date of the query
+bool sdDirectoryMatch(const char *fileName, const SD_DIRECTORY_QUERY *query)
+{
+    int dateLength;
+    const char *extension;
+    const char *match;
+
+    // Compare the extension, ignoring case
+    extension = query->extension;
+    if (extension && (*extension == '.'))
+        extension++;
+    if (extension && *extension)
+    {
+        match = strrchr(fileName, '.');
+        if ((!match) || strcasecmp(&match[1], extension))
+            return false;
+    }
+
+    // Log file names end with _YYMMDD_HHMMSS, look for the date following
+    // one of the underscores
+    if (query->date && *query->date)
+    {
+        dateLength = strlen(query->date);
+        match = fileName;
+        while ((match = strchr(match, '_')))
+        {
+            match++;
+            if (strncmp(match, query->date, dateLength) == 0)
+                break;
+        }
+        if (!match)
+            return false;
+    }
+    return true;
+}
+
+// Get a page of matching entries from the index, returns the total number of
+// matching entries.  The callback must not access the microSD card.
+//
+// The entries are selected without allocating memory.  Sorting by name walks
+// the entries and sorting by size walks the size order.  Without an extension
+// or date filter the page starts at the offset and the total is the number of
+// entries, a filtered query walks the whole index to count the matches.
+int sdDirectoryQuery(const SD_DIRECTORY_QUERY *query,
+                     void (*callback)(void *context, const char *fileName, uint64_t fileSize), void *context)
+{
+    int count;
+    int entry;
+    bool filtered;
+    int index;
+    int total;
+
+    if (!sdDirectory.valid)
+        return 0;
+
+    count = 0;
+    total = 0;
+    filtered = (query->extension && *query->extension && strcmp(query->extension, "."))
+               || (query->date && *query->date);
+    xSemaphoreTake(sdDirectoryMutex, portMAX_DELAY);
+
+    // Without a filter, only walk the entries on the page
+    entry = 0;
+    if ((!filtered) && (query->offset > 0))
+    {
+        entry = (query->offset < sdDirectory.entryCount) ? query->offset : sdDirectory.entryCount;
+        total = entry;
+    }
+
+    // Walk the index in the requested order
+    for (; entry < sdDirectory.entryCount; entry++)
+    {
+        if ((!filtered) && (count >= query->count))
+        {
+            total = sdDirectory.entryCount;
+            break;
+        }
+        index = query->descending ? (sdDirectory.entryCount - 1 - entry) : entry;
+        if (query->sort == SD_DIRECTORY_SORT_SIZE)
+            index = sdDirectory.sizeOrder[index];
+        if (!sdDirectoryMatch(sdDirectoryEntryName(index), query))
+            continue;
+        if ((total >= query->offset) && (count < query->count))
+        {
+            callback(context, sdDirectoryEntryName(index), sdDirectoryEntrySize(index));
+            count++;
+        }
+        total++;
+    }
+    xSemaphoreGive(sdDirectoryMutex);
+    return total;
+}
+
+// Get the number of files in the index
+int sdDirectoryFileCount()
+{
+    return sdDirectory.entryCount;
+}
+
+// Get the total size of the files in the index
+uint64_t sdDirectoryTotalBytes()
+{
+    return sdDirectory.totalBytes;
+}
+
+// Determine if the index is available
+bool sdDirectoryValid()
+{
+    return sdDirectory.valid;
+}
+
+// Find the last log file name, returns true if a log file was found.  Log
+// file names contain the date and time so the last log file name in sorted
+// order is the most recent log file.
+bool sdDirectoryLastLog(char *lastLogName, size_t lastLogNameSize)
+{
+    const char *extension;
+    bool foundAFile;
+    int index;
+    const char *name;
+    int prefixLength;
+
+    if (!sdDirectory.valid)
+        return false;
+
+    foundAFile = false;
+    prefixLength = strlen(platformFilePrefix);
+    xSemaphoreTake(sdDirectoryMutex, portMAX_DELAY);
+
+    // Locate the entry following the log files
+    index = sdDirectoryFind(platformFilePrefix);
+    if (index < 0)
+        index = -index - 1;
+    while ((index < sdDirectory.entryCount)
+           && (strncmp(sdDirectoryEntryName(index), platformFilePrefix, prefixLength) == 0))
+        index++;
+
+    // Walk backwards to the last log file
+    while (--index >= 0)
+    {
+        name = sdDirectoryEntryName(index);
+        if (strncmp(name, platformFilePrefix, prefixLength))
+            break;
+        extension = strrchr(name, '.');
+        if (extension && (strcmp(&extension[1], sdLogExtension()) == 0))
+        {
+            strncpy(lastLogName, name, lastLogNameSize - 1);
+            lastLogName[lastLogNameSize - 1] = 0;
+            foundAFile = true;
+            break;
+        }
+    }
+    xSemaphoreGive(sdDirectoryMutex);
+    return foundAFile;
+}
+
+// Remove a file from the index
+void sdDirectoryRemove(const char *fileName)
+{
+    int index;
+
+    // The size of the removed file is unknown
+    if (!sdDirectory.valid)
+    {
+        sdFreeSpaceRequestRescan();
+        return;
+    }
+
+    fileName = sdDirectoryName(fileName);
+    xSemaphoreTake(sdDirectoryMutex, portMAX_DELAY);
+    index = sdDirectoryFind(fileName);
+    if (index >= 0)
+    {
+        sdFreeSpaceAdjust(sdDirectory.entries[index].size, 0);
+        sdDirectory.totalBytes -= sdDirectory.entries[index].size;
+        sdDirectory.namesUnused += strlen(sdDirectoryEntryName(index)) + 1;
+        sdDirectorySizeRemove(index);
+        sdDirectory.entryCount -= 1;
+        memmove(&sdDirectory.entries[index], &sdDirectory.entries[index + 1],
+                (sdDirectory.entryCount - index) * sizeof(SD_DIRECTORY_ENTRY));
+        sdDirectorySizeRenumber(index + 1, sdDirectory.entryCount, -1);
+
+        // Release the space used by the removed names
+        if (sdDirectory.namesUnused > (sdDirectory.namesLength / 2))
+            sdDirectoryCompact();
+    }
+    xSemaphoreGive(sdDirectoryMutex);
+}
+
+// Add or update a file in the index
+void sdDirectoryUpdate(const char *fileName, uint64_t fileSize)
+{
+    bool valid;
+
+    // The previous size of the file is unknown
+    if (!sdDirectory.valid)
+    {
+        if (!sdDirectoryOpenLog(sdDirectoryName(fileName)))
+            sdFreeSpaceRequestRescan();
+        return;
+    }
+
+    // Files in sub-directories are not indexed
+    fileName = sdDirectoryName(fileName);
+    if (strchr(fileName, '/'))
+        return;
+
+    xSemaphoreTake(sdDirectoryMutex, portMAX_DELAY);
+    valid = sdDirectoryInsert(fileName, fileSize);
+    xSemaphoreGive(sdDirectoryMutex);
+
+    // Fall back to the directory scans when the heap is exhausted
+    if (!valid)
+    {
+        sdDirectoryFree();
+        sdFreeSpaceRequestRescan();
+    }
+}
+
+// Add or update a file in the index using the size of the file on the
+// microSD card, the caller must hold the sdCardSemaphore
+void sdDirectoryUpdateFile(const char *fileName)
+{
+    // The previous size of the file is unknown
+    if (!sdDirectory.valid)
+    {
+        sdFreeSpaceRequestRescan();
+        return;
+    }
+
+    if (USE_SPI_MICROSD)
+    {
+        SdFile file;
+        if (file.open(fileName, O_READ))
+        {
+            sdDirectoryUpdate(fileName, file.fileSize());
+            file.close();
+        }
+    }
+#ifdef COMPILE_SD_MMC
+    else
+    {
+        File file = SD_MMC.open(fileName, FILE_READ);
+        if (file)
+        {
+            sdDirectoryUpdate(fileName, file.size());
+            file.close();
+        }
+    }
+#endif // COMPILE_SD_MMC
+}
@@ -0,0 +1,255 @@
+/*
+SdFreeSpace.ino
+
+  Track the free space on the microSD card without blocking the other users
+  of the card.  SdFat's freeClusterCount walks the entire FAT while holding
+  the sdCardSemaphore which takes several seconds on large FAT32 cards.  For
+  FAT16 and FAT32 volumes the sdSizeCheckTask instead reads the FAT a few
+  sectors at a time, releasing the sdCardSemaphore between the slices.  The
+  free space found so far is a lower bound, so logging starts as soon as the
+  lower bound exceeds sdMinAvailableSpace rather than after the whole scan.
+
+  Once the scan completes, sdFreeSpace is adjusted as files grow, shrink and
+  are removed.  The adjustments are made in whole clusters since that is the
+  unit of allocation on the card.  The SdDirectory routines report the size
+  changes for the indexed files and sdLogWriteBuffer reports the growth of
+  the open log file.  When the directory index is unavailable the size
+  changes are unknown and a rescan of the FAT is requested instead.
+
+  exFAT volumes keep their free space in an allocation bitmap which is 1/32
+  the size of a FAT32 FAT, so freeClusterCount is still used for exFAT, as is
+  SD_MMC's usedBytes.
+
+  Space allocated while the scan is running is subtracted from the scan
+  result even when the scan found that space already in use, so the free
+  space after the scan errs on the low side.
+*/
+
+//----------------------------------------
+// Constants
+//----------------------------------------
+
+#define SD_FREE_SPACE_SLICE_SECTORS 8           // FAT sectors read while holding the sdCardSemaphore
+#define SD_FREE_SPACE_RESCAN_MSEC (60 * 1000)   // Minimum interval between requested rescans
+
+//----------------------------------------
+// Locals
+//----------------------------------------
+
+static uint8_t *sdFreeSpaceBuffer;         // FAT sectors being scanned
+static uint32_t sdFreeSpaceClusterBytes;   // Allocation unit, zero when unknown
+static uint32_t sdFreeSpaceClusters;       // Free clusters found by the scan
+static uint32_t sdFreeSpaceCluster;        // Next cluster to scan
+static uint32_t sdFreeSpaceClusterEnd;     // Cluster following the last cluster on the card
+static uint32_t sdFreeSpaceFatSector;      // Next FAT sector to read
+static uint8_t sdFreeSpaceFatType;         // 16 or 32
+static uint64_t sdFreeSpaceAllocated;      // Bytes allocated since the scan started
+static SemaphoreHandle_t sdFreeSpaceMutex; // Protects sdFreeSpace and sdFreeSpaceAllocated
+static bool sdFreeSpaceScanning;           // Set while the FAT scan is running
+static bool sdFreeSpaceKnown;              // Set once a scan has completed
+static bool sdFreeSpaceRescan;             // Set when the accounting is out of date
+static uint32_t sdFreeSpaceScanMillis;     // Time the last scan completed
+
+//----------------------------------------
+// Support routines
+//----------------------------------------
+
+// Round the file size up to a whole number of clusters
+uint64_t sdFreeSpaceRound(uint64_t fileSize)
+{
+    if (!sdFreeSpaceClusterBytes)
+        return fileSize;
+    return ((fileSize + sdFreeSpaceClusterBytes - 1) / sdFreeSpaceClusterBytes) * sdFreeSpaceClusterBytes;
+}
+
+// Count the free entries in a slice of the FAT, the caller must hold the
+// sdCardSemaphore.  Returns true when the scan is complete.
+bool sdFreeSpaceScanSlice()
+{
+    uint32_t entries;
+    uint32_t entry;
+    uint32_t sectors;
+
+    // Read the next slice of the FAT
+    sectors = SD_FREE_SPACE_SLICE_SECTORS;
+    entries = sectors * SD_SECTOR_SIZE / (sdFreeSpaceFatType / 8);
+    if (entries > (sdFreeSpaceClusterEnd - sdFreeSpaceCluster))
+    {
+        entries = sdFreeSpaceClusterEnd - sdFreeSpaceCluster;
+        sectors = (entries * (sdFreeSpaceFatType / 8) + SD_SECTOR_SIZE - 1) / SD_SECTOR_SIZE;
+    }
+    if (!sd->card()->readSectors(sdFreeSpaceFatSector, sdFreeSpaceBuffer, sectors))
+    {
+        // Report the free space found so far and try again later
+        systemPrintln("microSD: Failed to read the FAT");
+        sdFreeSpaceRescan = true;
+        return true;
+    }
+
+    // Count the free clusters, the FAT32 entries use the low 28 bits
+    for (entry = 0; entry < entries; entry++)
+    {
+        if (sdFreeSpaceCluster + entry < 2)
+            continue; // Entries 0 and 1 are reserved
+        if (sdFreeSpaceFatType == 16)
+        {
+            if (((uint16_t *)sdFreeSpaceBuffer)[entry] == 0)
+                sdFreeSpaceClusters++;
+        }
+        else if ((((uint32_t *)sdFreeSpaceBuffer)[entry] & 0x0fffffff) == 0)
+            sdFreeSpaceClusters++;
+    }
+    sdFreeSpaceFatSector += sectors;
+    sdFreeSpaceCluster += entries;
+    return (sdFreeSpaceCluster >= sdFreeSpaceClusterEnd);
+}
+
+//----------------------------------------
+// Free space routines
+//----------------------------------------
+
+// Account for a change in the size of a file
+void sdFreeSpaceAdjust(uint64_t oldSize, uint64_t newSize)
+{
+    int64_t allocated;
+
+    if (!sdFreeSpaceMutex)
+        return;
+
+    allocated = (int64_t)sdFreeSpaceRound(newSize) - (int64_t)sdFreeSpaceRound(oldSize);
+    if (!allocated)
+        return;
+
+    xSemaphoreTake(sdFreeSpaceMutex, portMAX_DELAY);
+    if (sdFreeSpaceScanning && (allocated > 0))
+        sdFreeSpaceAllocated += allocated;
+    if ((allocated > 0) && (sdFreeSpace < (uint64_t)allocated))
+        sdFreeSpace = 0;
+    else
+        sdFreeSpace -= allocated;
+    xSemaphoreGive(sdFreeSpaceMutex);
+}
+
+// Determine if the free space is based on a completed scan
+bool sdFreeSpaceValid()
+{
+    return sdFreeSpaceKnown;
+}
+
+// Request a rescan of the FAT when the size changes are unknown
+void sdFreeSpaceRequestRescan()
+{
+    sdFreeSpaceRescan = true;
+}
+
+// Determine if the sdSizeCheckTask needs to run
+bool sdFreeSpaceScanNeeded()
+{
+    return (sdCardSize == 0)
+           || (sdFreeSpaceRescan && ((millis() - sdFreeSpaceScanMillis) >= SD_FREE_SPACE_RESCAN_MSEC));
+}
+
+// Discard the free space when a microSD card is mounted, the caller must hold
+// the sdCardSemaphore
+void sdFreeSpaceReset()
+{
+    if (!sdFreeSpaceMutex)
+    {
+        sdFreeSpaceMutex = xSemaphoreCreateMutex();
+        if (!sdFreeSpaceMutex)
+            return;
+    }
+
+    xSemaphoreTake(sdFreeSpaceMutex, portMAX_DELAY);
+    if (sdFreeSpaceBuffer)
+        free(sdFreeSpaceBuffer);
+    sdFreeSpaceBuffer = nullptr;
+    sdFreeSpaceClusterBytes = 0;
+    sdFreeSpaceScanning = false;
+    sdFreeSpaceKnown = false;
+    sdFreeSpaceRescan = false;
+    sdFreeSpace = 0;
+    xSemaphoreGive(sdFreeSpaceMutex);
+}
+
+// Start the free space scan, the caller must hold the sdCardSemaphore.
+// Returns true when the scan is complete.
+bool sdFreeSpaceScanStart()
+{
+    xSemaphoreTake(sdFreeSpaceMutex, portMAX_DELAY);
+    sdFreeSpaceScanning = true;
+    sdFreeSpaceAllocated = 0;
+    sdFreeSpaceRescan = false;
+    xSemaphoreGive(sdFreeSpaceMutex);
+
+    sdFreeSpaceClusters = 0;
+    sdFreeSpaceClusterBytes = 0;
+    if (USE_SPI_MICROSD)
+    {
+        sdFreeSpaceClusterBytes = sd->vol()->bytesPerCluster();
+        sdFreeSpaceFatType = sd->vol()->fatType();
+
+        // Scan the FAT in slices
+        if ((sdFreeSpaceFatType == 16) || (sdFreeSpaceFatType == 32))
+        {
+            if (!sdFreeSpaceBuffer)
+                sdFreeSpaceBuffer = (uint8_t *)malloc(SD_FREE_SPACE_SLICE_SECTORS * SD_SECTOR_SIZE);
+            if (sdFreeSpaceBuffer)
+            {
+                sdFreeSpaceFatSector = sd->vol()->fatStartSector();
+                sdFreeSpaceCluster = 0;
+                sdFreeSpaceClusterEnd = sd->vol()->clusterCount() + 2;
+                return false;
+            }
+        }
+
+        // exFAT bitmap or out of memory
+        sdFreeSpaceClusters = sd->vol()->freeClusterCount();
+        return true;
+    }
+    return true;
+}
+
+// Scan the next slice of the FAT, the caller must hold the sdCardSemaphore.
+// Returns true when the scan is complete.
+bool sdFreeSpaceScan()
+{
+    if (sdFreeSpaceScanSlice())
+        return true;
+
+    // Logging may start once the free space found so far is sufficient
+    if (!sdFreeSpaceKnown)
+    {
+        xSemaphoreTake(sdFreeSpaceMutex, portMAX_DELAY);
+        sdFreeSpace = (uint64_t)sdFreeSpaceClusters * sdFreeSpaceClusterBytes;
+        sdFreeSpace = (sdFreeSpace > sdFreeSpaceAllocated) ? sdFreeSpace - sdFreeSpaceAllocated : 0;
+        xSemaphoreGive(sdFreeSpaceMutex);
+    }
+    return false;
+}
+
+// Complete the free space scan, the caller must hold the sdCardSemaphore
+void sdFreeSpaceScanEnd()
+{
+    uint64_t freeSpace;
+
+    freeSpace = 0;
+    if (sdFreeSpaceBuffer)
+        free(sdFreeSpaceBuffer);
+    sdFreeSpaceBuffer = nullptr;
+
+    if (sdFreeSpaceClusterBytes)
+        freeSpace = (uint64_t)sdFreeSpaceClusters * sdFreeSpaceClusterBytes;
+#ifdef COMPILE_SD_MMC
+    else
+        freeSpace = SD_MMC.totalBytes() - SD_MMC.usedBytes();
+#endif // COMPILE_SD_MMC
+
+    // Account for the space allocated during the scan
+    xSemaphoreTake(sdFreeSpaceMutex, portMAX_DELAY);
+    sdFreeSpace = (freeSpace > sdFreeSpaceAllocated) ? freeSpace - sdFreeSpaceAllocated : 0;
+    sdFreeSpaceScanning = false;
+    sdFreeSpaceKnown = true;
+    sdFreeSpaceScanMillis = millis();
+    xSemaphoreGive(sdFreeSpaceMutex);
+}
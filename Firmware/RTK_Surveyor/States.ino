@@ -453,7 +453,7 @@ void updateSystemState()
                     char nmeaMessage[82]; // Max NMEA sentence length is 82
                     createNMEASentence(CUSTOM_NMEA_TYPE_WAYPOINT, nmeaMessage, sizeof(nmeaMessage),
                                        (char *)"CustomEvent"); // textID, buffer, sizeOfBuffer, text
-                    ubxFile->println(nmeaMessage);
+                    sdLogPrintln(nmeaMessage);
                     logged = true;
                 }
 
@@ -564,6 +564,7 @@ void updateSystemState()
 
                             // Close the mark file
                             marksFile.close();
+                            sdDirectoryUpdateFile(fileName);
 
                             marked = true;
                         }
@@ -120,7 +120,8 @@ bool configureUbloxModule()
         response &= theGNSS.addCfgValset(UBLOX_CFG_UART2OUTPROT_RTCM3X, 1);
     response &= theGNSS.addCfgValset(UBLOX_CFG_UART2INPROT_UBX, settings.enableUART2UBXIn);
     response &= theGNSS.addCfgValset(UBLOX_CFG_UART2INPROT_NMEA, 0);
-    response &= theGNSS.addCfgValset(UBLOX_CFG_UART2INPROT_RTCM3X, 1);
+    response &= theGNSS.addCfgValset(UBLOX_CFG_UART2INPROT_RTCM3X,
+                                     correctionsFallback() || (settings.radioType != RADIO_EXTERNAL));
     if (commandSupported(UBLOX_CFG_UART2INPROT_SPARTN) == true)
         response &= theGNSS.addCfgValset(UBLOX_CFG_UART2INPROT_SPARTN, 0);
 
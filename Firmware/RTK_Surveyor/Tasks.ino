@@ -16,76 +16,25 @@ Tasks.ino
                            '------->+<-------'
                                     |
                                     | gnssReadTask
-                                    |    gpsMessageParserFirstByte
+                                    |    gpsMessageParserProcessBuffer
                                     |        ...
                                     |    processUart1Message
                                     |
                                     v
                                Ring Buffer
                                     |
-                                    | handleGnssDataTask
+                                    | tasksNotifyConsumers
                                     |
-                                    v
             .---------------+-------+-------+---------------+
             |               |               |               |
+            | handleGnssDataTask, one per consumer          |
+            |    ringBufferService                          |
             |               |               |               |
             v               v               v               v
         Bluetooth      PVT Client      PVT Server        SD Card
 
 ------------------------------------------------------------------------------*/
 
-//----------------------------------------
-// Macros
-//----------------------------------------
-
-#define WRAP_OFFSET(offset, increment, arraySize)                                                                      \
-    {                                                                                                                  \
-        offset += increment;                                                                                           \
-        if (offset >= arraySize)                                                                                       \
-            offset -= arraySize;                                                                                       \
-    }
-
-//----------------------------------------
-// Constants
-//----------------------------------------
-
-enum RingBufferConsumers
-{
-    RBC_BLUETOOTH = 0,
-    RBC_PVT_CLIENT,
-    RBC_PVT_SERVER,
-    RBC_SD_CARD,
-    RBC_PVT_UDP_SERVER,
-    // Insert new consumers here
-    RBC_MAX
-};
-
-const char *const ringBufferConsumer[] = {
-    "Bluetooth", "PVT Client", "PVT Server", "SD Card", "PVT UDP Server",
-};
-
-const int ringBufferConsumerEntries = sizeof(ringBufferConsumer) / sizeof(ringBufferConsumer[0]);
-
-//----------------------------------------
-// Locals
-//----------------------------------------
-
-volatile static RING_BUFFER_OFFSET dataHead; // Head advances as data comes in from GNSS's UART
-volatile int32_t availableHandlerSpace;      // settings.gnssHandlerBufferSize - usedSpace
-volatile const char *slowConsumer;
-
-// Buffer the incoming Bluetooth stream so that it can be passed in bulk over I2C
-uint8_t bluetoothOutgoingToZed[100];
-uint16_t bluetoothOutgoingToZedHead;
-unsigned long lastZedI2CSend; // Timestamp of the last time we sent RTCM ZED over I2C
-
-// Ring buffer tails
-static RING_BUFFER_OFFSET btRingBufferTail; // BT Tail advances as it is sent over BT
-static RING_BUFFER_OFFSET sdRingBufferTail; // SD Tail advances as it is recorded to SD
-
-// Ring buffer offsets
-static uint16_t rbOffsetHead;
-
 //----------------------------------------
 // Task routines
 //----------------------------------------
@@ -135,13 +84,7 @@ void btReadTask(void *e)
                     else
                     {
                         // Ignore this escape character, passing along to output
-                        if (USE_I2C_GNSS)
-                        {
-                            // serialGNSS.write(incoming);
-                            addToZedI2CBuffer(btEscapeCharacter);
-                        }
-                        else
-                            theGNSS.pushRawData(&incoming, 1);
+                        correctionsBluetoothData(&incoming, 1);
                     }
                 }
                 else // This is just a character in the stream, ignore
@@ -149,39 +92,21 @@ void btReadTask(void *e)
                     // Pass any escape characters that turned out to not be a complete escape sequence
                     while (btEscapeCharsReceived-- > 0)
                     {
-                        if (USE_I2C_GNSS)
-                        {
-                            // serialGNSS.write(btEscapeCharacter);
-                            addToZedI2CBuffer(btEscapeCharacter);
-                        }
-                        else
-                        {
-                            uint8_t escChar = btEscapeCharacter;
-                            theGNSS.pushRawData(&escChar, 1);
-                        }
+                        uint8_t escChar = btEscapeCharacter;
+                        correctionsBluetoothData(&escChar, 1);
                     }
 
-                    // Pass byte to GNSS receiver or to system
-                    // TODO - control if this RTCM source should be listened to or not
-                    if (USE_I2C_GNSS)
-                    {
-                        // UART RX can be corrupted by UART TX
-                        // See issue: https://github.com/sparkfun/SparkFun_RTK_Firmware/issues/469
-                        // serialGNSS.write(incoming);
-                        addToZedI2CBuffer(incoming);
-                    }
-                    else
-                        theGNSS.pushRawData(&incoming, 1);
+                    // Frame the byte, the complete messages are passed to the GNSS. The
+                    // RTCM messages are only passed when Bluetooth is the selected
+                    // correction source.  Pushing whole messages over I2C also avoids
+                    // writing single characters which changes the address pointer.
+                    // UART RX can be corrupted by UART TX
+                    // See issue: https://github.com/sparkfun/SparkFun_RTK_Firmware/issues/469
+                    correctionsBluetoothData(&incoming, 1);
 
                     btLastByteReceived = millis();
                     btEscapeCharsReceived = 0; // Update timeout check for escape char and partial frame
 
-                    bluetoothIncomingRTCM = true;
-
-                    // Record the arrival of RTCM from the Bluetooth connection (a phone or tablet is providing the RTCM
-                    // via NTRIP). This resets the RTCM timeout used on the L-Band.
-                    rtcmLastPacketReceived = millis();
-
                 } // End just a character in the stream
 
             } // End btPrintEcho == false && bluetoothRxDataAvailable()
@@ -193,11 +118,6 @@ void btReadTask(void *e)
             }
         } // End bluetoothGetState() == BT_CONNECTED
 
-        if (bluetoothOutgoingToZedHead > 0 && ((millis() - lastZedI2CSend) > 100))
-        {
-            sendZedI2CBuffer(); // Send any outstanding RTCM
-        }
-
         if (settings.enableTaskReports == true)
             systemPrintf("SerialWriteTask High watermark: %d\r\n", uxTaskGetStackHighWaterMark(nullptr));
 
@@ -206,40 +126,6 @@ void btReadTask(void *e)
     } // End while(true)
 }
 
-// Add byte to buffer that will be sent to ZED
-// We cannot write single characters to the ZED over I2C (as this will change the address pointer)
-void addToZedI2CBuffer(uint8_t incoming)
-{
-    bluetoothOutgoingToZed[bluetoothOutgoingToZedHead] = incoming;
-
-    bluetoothOutgoingToZedHead++;
-    if (bluetoothOutgoingToZedHead == sizeof(bluetoothOutgoingToZed))
-    {
-        sendZedI2CBuffer();
-    }
-}
-
-// Push the buffered data in bulk to the GNSS over I2C
-bool sendZedI2CBuffer()
-{
-    bool response = theGNSS.pushRawData(bluetoothOutgoingToZed, bluetoothOutgoingToZedHead);
-
-    if (response == true)
-    {
-        if (PERIODIC_DISPLAY(PD_ZED_DATA_TX))
-        {
-            PERIODIC_CLEAR(PD_ZED_DATA_TX);
-            systemPrintf("ZED TX: Sending %d bytes from I2C\r\n", bluetoothOutgoingToZedHead);
-        }
-        // log_d("Pushed %d bytes RTCM to ZED", bluetoothOutgoingToZedHead);
-    }
-
-    // No matter the response, wrap the head and reset the timer
-    bluetoothOutgoingToZedHead = 0;
-    lastZedI2CSend = millis();
-    return (response);
-}
-
 // Normally a delay(1) will feed the WDT but if we don't want to wait that long, this feeds the WDT without delay
 void feedWdt()
 {
@@ -255,32 +141,8 @@ void feedWdt()
 // 250ms worst case, we should record incoming all data. Bluetooth congestion
 // or conflicts with the SD card semaphore should clear within this time.
 //
-// Ring buffer empty when all the tails == dataHead
-//
-//        +---------+
-//        |         |
-//        |         |
-//        |         |
-//        |         |
-//        +---------+ <-- dataHead, btRingBufferTail, sdRingBufferTail, etc.
-//
-// Ring buffer contains data when any tail != dataHead
-//
-//        +---------+
-//        |         |
-//        |         |
-//        | yyyyyyy | <-- dataHead
-//        | xxxxxxx | <-- btRingBufferTail (1 byte in buffer)
-//        +---------+ <-- sdRingBufferTail (2 bytes in buffer)
-//
-//        +---------+
-//        | yyyyyyy | <-- btRingBufferTail (1 byte in buffer)
-//        | xxxxxxx | <-- sdRingBufferTail (2 bytes in buffer)
-//        |         |
-//        |         |
-//        +---------+ <-- dataHead
-//
-// Maximum ring buffer fill is settings.gnssHandlerBufferSize - 1
+// The ring buffer is described in RingBuffer.ino, each device (Bluetooth, SD
+// card and network clients) registers as a consumer and gets its own tail.
 //----------------------------------------------------------------------
 
 // Read bytes from ZED-F9P UART1 into ESP32 circular buffer
@@ -293,7 +155,19 @@ void gnssReadTask(void *e)
 {
     static PARSE_STATE parse = {gpsMessageParserFirstByte, processUart1Message, "Log"};
 
-    uint8_t incomingData = 0;
+    int bytesIncoming;
+    uint32_t head;
+    uint8_t incomingData[500];
+    uint32_t rateBytes = 0;
+    uint32_t rateChunks = 0;
+    uint32_t rateStartMillis = millis();
+
+    // Parse the messages directly into the ring buffer at the head
+    parse.buffer = &gnssRingBuffer.data[gnssRingBuffer.head];
+    parse.length = 0;
+    parse.computeCrc = false;
+    parse.state = gpsMessageParserFirstByte;
+    head = gnssRingBuffer.head;
 
     while (true)
     {
@@ -307,49 +181,52 @@ void gnssReadTask(void *e)
         if (settings.enableTaskReports == true)
             systemPrintf("SerialReadTask High watermark: %d\r\n", uxTaskGetStackHighWaterMark(nullptr));
 
+        // Display the ingest rate
+        if (PERIODIC_DISPLAY(PD_ZED_DATA_RX_RATE))
+        {
+            uint32_t milliseconds = millis() - rateStartMillis;
+
+            PERIODIC_CLEAR(PD_ZED_DATA_RX_RATE);
+            if (milliseconds && (!inMainMenu))
+                systemPrintf("ZED RX %s: %d bytes/sec, %d bytes/chunk\r\n", USE_I2C_GNSS ? "UART" : "SPI",
+                             (int)(((uint64_t)rateBytes * 1000) / milliseconds), rateChunks ? rateBytes / rateChunks : 0);
+            rateBytes = 0;
+            rateChunks = 0;
+            rateStartMillis = millis();
+        }
+
         // Determine if serial data is available
         if (USE_I2C_GNSS)
         {
             while (serialGNSS.available())
             {
                 // Read the data from UART1
-                uint8_t incomingData[500];
-                int bytesIncoming = serialGNSS.read(incomingData, sizeof(incomingData));
-
-                for (int x = 0; x < bytesIncoming; x++)
-                {
-                    // Save the data byte
-                    parse.buffer[parse.length++] = incomingData[x];
-                    parse.length %= PARSE_BUFFER_LENGTH;
-
-                    // Compute the CRC value for the message
-                    if (parse.computeCrc)
-                        parse.crc = COMPUTE_CRC24Q(&parse, incomingData[x]);
-
-                    // Update the parser state based on the incoming byte
-                    parse.state(&parse, incomingData[x]);
-                }
+                bytesIncoming = serialGNSS.read(incomingData, sizeof(incomingData));
+
+                // Parse the messages in the data
+                ringBufferReserve(&parse, bytesIncoming);
+                gpsMessageParserProcessBuffer(&parse, incomingData, bytesIncoming);
+                tasksNotifyConsumers(&head);
+                rateBytes += bytesIncoming;
+                rateChunks += 1;
             }
         }
         else // SPI GNSS
         {
             theGNSS.checkUblox(); // Check for new data
-            while (theGNSS.fileBufferAvailable() > 0)
+            while ((bytesIncoming = theGNSS.fileBufferAvailable()) > 0)
             {
-                // Read the data from the logging buffer
-                theGNSS.extractFileBufferData(&incomingData,
-                                              1); // TODO: make this more efficient by reading multiple bytes?
-
-                // Save the data byte
-                parse.buffer[parse.length++] = incomingData;
-                parse.length %= PARSE_BUFFER_LENGTH;
-
-                // Compute the CRC value for the message
-                if (parse.computeCrc)
-                    parse.crc = COMPUTE_CRC24Q(&parse, incomingData);
-
-                // Update the parser state based on the incoming byte
-                parse.state(&parse, incomingData);
+                // Read a block of data from the logging buffer
+                if (bytesIncoming > (int)sizeof(incomingData))
+                    bytesIncoming = sizeof(incomingData);
+                theGNSS.extractFileBufferData(incomingData, bytesIncoming);
+
+                // Parse the messages in the data
+                ringBufferReserve(&parse, bytesIncoming);
+                gpsMessageParserProcessBuffer(&parse, incomingData, bytesIncoming);
+                tasksNotifyConsumers(&head);
+                rateBytes += bytesIncoming;
+                rateChunks += 1;
             }
         }
 
@@ -358,15 +235,71 @@ void gnssReadTask(void *e)
     }
 }
 
+// Wake the consumer tasks when new messages were added to the ring buffer
+void tasksNotifyConsumers(uint32_t *previousHead)
+{
+    RING_BUFFER_CONSUMER *consumer;
+    uint32_t head;
+    int index;
+
+    head = RING_BUFFER_LOAD(gnssRingBuffer.head);
+    if (head != *previousHead)
+    {
+        *previousHead = head;
+        for (index = 0; index < gnssRingBuffer.consumers; index++)
+        {
+            consumer = gnssRingBuffer.consumer[index];
+            if (consumer->task)
+                xTaskNotifyGive((TaskHandle_t)consumer->task);
+        }
+    }
+}
+
+// Reserve space in the ring buffer for the parser
+//
+// The parser writes each message directly into the ring buffer starting at
+// the head, processUart1Message commits a valid message by advancing the head
+// and the parser aborts an invalid message by resetting parse->length to
+// zero.  Before more data is parsed, make sure that the partial message and
+// the incoming data fit into the free space, discarding the oldest messages
+// when necessary.  The ring buffer is allocated with PARSE_BUFFER_LENGTH
+// extra bytes at the end so that a message never wraps while it is being
+// parsed.
+void ringBufferReserve(PARSE_STATE *parse, int32_t bytesIncoming)
+{
+    int32_t bytesNeeded;
+    int32_t discardedBytes;
+    RING_BUFFER_CONSUMER *slowConsumer;
+
+    // The parser wraps messages longer than the parse buffer length
+    bytesNeeded = parse->length + bytesIncoming;
+    if (bytesNeeded > PARSE_BUFFER_LENGTH)
+        bytesNeeded = PARSE_BUFFER_LENGTH;
+
+    // Determine if the data will fit into the ring buffer
+    if (bytesNeeded > ringBufferAvailable(&gnssRingBuffer, nullptr))
+    {
+        // Discard the oldest data from the ring buffer
+        discardedBytes = ringBufferDiscard(&gnssRingBuffer, bytesNeeded, &slowConsumer);
+        if (!inMainMenu)
+        {
+            if (slowConsumer)
+                systemPrintf("Ring buffer full: discarding %d bytes, %s is slow\r\n", discardedBytes,
+                             slowConsumer->name);
+            else
+                systemPrintf("Ring buffer full: discarding %d bytes\r\n", discardedBytes);
+        }
+    }
+}
+
 // Process a complete message incoming from parser
 // If we get a complete NMEA/UBX/RTCM message, pass on to SD/BT/PVT interfaces
 void processUart1Message(PARSE_STATE *parse, uint8_t type)
 {
-    int32_t bytesToCopy;
-    const char *consumer;
-    RING_BUFFER_OFFSET remainingBytes;
-    int32_t space;
-    int32_t use;
+    uint32_t epochs;
+    uint8_t filter;
+    int messageNumber;
+    uint8_t priority;
 
     // Display the message
     if ((settings.enablePrintLogFileMessages || PERIODIC_DISPLAY(PD_ZED_DATA_RX)) && (!parse->crc) && (!inMainMenu))
@@ -396,693 +329,655 @@ void processUart1Message(PARSE_STATE *parse, uint8_t type)
         }
     }
 
-    // Determine if this message will fit into the ring buffer
-    bytesToCopy = parse->length;
-    space = availableHandlerSpace;
-    use = settings.gnssHandlerBufferSize - space;
-    consumer = (char *)slowConsumer;
-    if ((bytesToCopy > space) && (!inMainMenu))
+    // Determine the priority class and the outputs filtering the message
+    priority = RING_BUFFER_PRIORITY_NORMAL;
+    filter = 0;
+    messageNumber = getMessageNumber(parse, type);
+    if (messageNumber >= 0)
     {
-        int32_t bufferedData;
-        int32_t bytesToDiscard;
-        int32_t discardedBytes;
-        int32_t listEnd;
-        int32_t messageLength;
-        int32_t offsetBytes;
-        int32_t previousTail;
-        int32_t rbOffsetTail;
-
-        // Determine the tail of the ring buffer
-        previousTail = dataHead + space + 1;
-        if (previousTail >= settings.gnssHandlerBufferSize)
-            previousTail -= settings.gnssHandlerBufferSize;
-
-        /*  The rbOffsetArray holds the offsets into the ring buffer of the
-         *  start of each of the parsed messages.  A head (rbOffsetHead) and
-         *  tail (rbOffsetTail) offsets are used for this array to insert and
-         *  remove entries.  Typically this task only manipulates the head as
-         *  new messages are placed into the ring buffer.  The handleGnssDataTask
-         *  normally manipulates the tail as data is removed from the buffer.
-         *  However this task will manipulate the tail under two conditions:
-         *
-         *  1.  The ring buffer gets full and data must be discarded
-         *
-         *  2.  The rbOffsetArray is too small to hold all of the message
-         *      offsets for the data in the ring buffer.  The array is full
-         *      when (Head + 1) == Tail
-         *
-         *  Notes:
-         *      The rbOffsetArray is allocated along with the ring buffer in
-         *      Begin.ino
-         *
-         *      The first entry rbOffsetArray[0] is initialized to zero (0)
-         *      in Begin.ino
-         *
-         *      The array always has one entry in it containing the head offset
-         *      which contains a valid offset into the ringBuffer, handled below
-         *
-         *      The empty condition is Tail == Head
-         *
-         *      The amount of data described by the rbOffsetArray is
-         *      rbOffsetArray[Head] - rbOffsetArray[Tail]
-         *
-         *              rbOffsetArray                  ringBuffer
-         *           .-----------------.           .-----------------.
-         *           |                 |           |                 |
-         *           +-----------------+           |                 |
-         *  Tail --> |   Msg 1 Offset  |---------->+-----------------+ <-- Tail n
-         *           +-----------------+           |      Msg 1      |
-         *           |   Msg 2 Offset  |--------.  |                 |
-         *           +-----------------+        |  |                 |
-         *           |   Msg 3 Offset  |------. '->+-----------------+
-         *           +-----------------+      |    |      Msg 2      |
-         *  Head --> |   Head Offset   |--.   |    |                 |
-         *           +-----------------+  |   |    |                 |
-         *           |                 |  |   |    |                 |
-         *           +-----------------+  |   |    |                 |
-         *           |                 |  |   '--->+-----------------+
-         *           +-----------------+  |        |      Msg 3      |
-         *           |                 |  |        |                 |
-         *           +-----------------+  '------->+-----------------+ <-- dataHead
-         *           |                 |           |                 |
-         */
-
-        // Determine the index for the end of the circular ring buffer
-        // offset list
-        listEnd = rbOffsetHead;
-        WRAP_OFFSET(listEnd, 1, rbOffsetEntries);
-
-        // Update the tail, walk newest message to oldest message
-        rbOffsetTail = rbOffsetHead;
-        bufferedData = 0;
-        messageLength = 0;
-        while ((rbOffsetTail != listEnd) && (bufferedData < use))
-        {
-            // Determine the amount of data in the ring buffer up until
-            // either the tail or the end of the rbOffsetArray
-            //
-            //                      |           |
-            //                      |           | Valid, still in ring buffer
-            //                      |  Newest   |
-            //                      +-----------+ <-- rbOffsetHead
-            //                      |           |
-            //                      |           | free space
-            //                      |           |
-            //     rbOffsetTail --> +-----------+ <-- bufferedData
-            //                      |   ring    |
-            //                      |  buffer   | <-- used
-            //                      |   data    |
-            //                      +-----------+ Valid, still in ring buffer
-            //                      |           |
-            //
-            messageLength = rbOffsetArray[rbOffsetTail];
-            WRAP_OFFSET(rbOffsetTail, rbOffsetEntries - 1, rbOffsetEntries);
-            messageLength -= rbOffsetArray[rbOffsetTail];
-            if (messageLength < 0)
-                messageLength += settings.gnssHandlerBufferSize;
-            bufferedData += messageLength;
-        }
-
-        // Account for any data in the ring buffer not described by the array
-        //
-        //                      |           |
-        //                      +-----------+
-        //                      |  Oldest   |
-        //                      |           |
-        //                      |   ring    |
-        //                      |  buffer   | <-- used
-        //                      |   data    |
-        //                      +-----------+ Valid, still in ring buffer
-        //                      |           |
-        //     rbOffsetTail --> +-----------+ <-- bufferedData
-        //                      |           |
-        //                      |  Newest   |
-        //                      +-----------+ <-- rbOffsetHead
-        //                      |           |
-        //
-        discardedBytes = 0;
-        if (bufferedData < use)
-            discardedBytes = use - bufferedData;
-
-        // Writing to the SD card, the network or Bluetooth, a partial
-        // message may be written leaving the tail pointer mid-message
-        //
-        //                      |           |
-        //     rbOffsetTail --> +-----------+
-        //                      |  Oldest   |
-        //                      |           |
-        //                      |   ring    |
-        //                      |  buffer   | <-- used
-        //                      |   data    | Valid, still in ring buffer
-        //                      +-----------+ <--
-        //                      |           |
-        //                      +-----------+
-        //                      |           |
-        //                      |  Newest   |
-        //                      +-----------+ <-- rbOffsetHead
-        //                      |           |
-        //
-        else if (bufferedData > use)
-        {
-            // Remove the remaining portion of the oldest entry in the array
-            discardedBytes = messageLength + use - bufferedData;
-            WRAP_OFFSET(rbOffsetTail, 1, rbOffsetEntries);
-        }
-
-        // rbOffsetTail now points to the beginning of a message in the
-        // ring buffer
-        // Determine the amount of data to discard
-        bytesToDiscard = discardedBytes;
-        if (bytesToDiscard < bytesToCopy)
-            bytesToDiscard = bytesToCopy;
-        if (bytesToDiscard < AMOUNT_OF_RING_BUFFER_DATA_TO_DISCARD)
-            bytesToDiscard = AMOUNT_OF_RING_BUFFER_DATA_TO_DISCARD;
-
-        // Walk the ring buffer messages from oldest to newest
-        while ((discardedBytes < bytesToDiscard) && (rbOffsetTail != rbOffsetHead))
-        {
-            // Determine the length of the oldest message
-            WRAP_OFFSET(rbOffsetTail, 1, rbOffsetEntries);
-            discardedBytes = rbOffsetArray[rbOffsetTail] - previousTail;
-            if (discardedBytes < 0)
-                discardedBytes += settings.gnssHandlerBufferSize;
-        }
-
-        // Discard the oldest data from the ring buffer
-        if (consumer)
-            systemPrintf("Ring buffer full: discarding %d bytes, %s is slow\r\n", discardedBytes, consumer);
-        else
-            systemPrintf("Ring buffer full: discarding %d bytes\r\n", discardedBytes);
-        updateRingBufferTails(previousTail, rbOffsetArray[rbOffsetTail]);
-        availableHandlerSpace += discardedBytes;
+        priority = settings.ubxMessagePriorities[messageNumber];
+        filter = settings.ubxMessageFilters[messageNumber];
     }
 
-    // Add another message to the ring buffer
-    // Account for this message
-    availableHandlerSpace -= bytesToCopy;
-
-    // Fill the buffer to the end and then start at the beginning
-    if ((dataHead + bytesToCopy) > settings.gnssHandlerBufferSize)
-        bytesToCopy = settings.gnssHandlerBufferSize - dataHead;
+    // Drop the lower priority messages as the ring buffer fills, the parser
+    // writes the next message over the dropped message
+    if (!ringBufferAccept(&gnssRingBuffer, parse->length, priority))
+    {
+        if (settings.enablePrintRingBufferOffsets && (!inMainMenu))
+            systemPrintf("DH: %4d, dropped %d bytes, priority %d\r\n", gnssRingBuffer.head, parse->length, priority);
+        return;
+    }
 
-    // Display the dataHead offset
+    // Display the head offset
     if (settings.enablePrintRingBufferOffsets && (!inMainMenu))
-        systemPrintf("DH: %4d --> ", dataHead);
+        systemPrintf("DH: %4d --> ", gnssRingBuffer.head);
 
-    // Copy the data into the ring buffer
-    memcpy(&ringBuffer[dataHead], parse->buffer, bytesToCopy);
-    dataHead += bytesToCopy;
-    if (dataHead >= settings.gnssHandlerBufferSize)
-        dataHead -= settings.gnssHandlerBufferSize;
+    // Mark the first message of each epoch, the consumers that fall behind
+    // skip ahead to this message
+    epochs = gnssEpoch.epochs;
+    logRotateMessage(&gnssEpoch, parse->buffer, parse->length);
+    if (gnssEpoch.epochs != epochs)
+        ringBufferEpoch(&gnssRingBuffer);
 
-    // Determine the remaining bytes
-    remainingBytes = parse->length - bytesToCopy;
-    if (remainingBytes)
-    {
-        // Copy the remaining bytes into the beginning of the ring buffer
-        memcpy(ringBuffer, &parse->buffer[bytesToCopy], remainingBytes);
-        dataHead += remainingBytes;
-        if (dataHead >= settings.gnssHandlerBufferSize)
-            dataHead -= settings.gnssHandlerBufferSize;
-    }
+    // Commit the message to the ring buffer
+    // The message was written by the parser into the space reserved by
+    // ringBufferReserve, starting at the head
+    ringBufferCommit(&gnssRingBuffer, parse->length, priority, filter);
 
-    // Add the head offset to the offset array
-    WRAP_OFFSET(rbOffsetHead, 1, rbOffsetEntries);
-    rbOffsetArray[rbOffsetHead] = dataHead;
+    // Parse the next message at the head of the ring buffer
+    parse->buffer = &gnssRingBuffer.data[gnssRingBuffer.head];
 
-    // Display the dataHead offset
+    // Display the head offset
     if (settings.enablePrintRingBufferOffsets && (!inMainMenu))
-        systemPrintf("%4d\r\n", dataHead);
+        systemPrintf("%4d\r\n", gnssRingBuffer.head);
 }
 
-// Remove previous messages from the ring buffer
-void updateRingBufferTails(RING_BUFFER_OFFSET previousTail, RING_BUFFER_OFFSET newTail)
+//----------------------------------------------------------------------
+// Bluetooth ring buffer consumer
+//----------------------------------------------------------------------
+
+// Determine if Bluetooth is able to accept data
+bool btConsumerConnected(RING_BUFFER_CONSUMER *consumer)
 {
-    // Trim any long or medium tails
-    discardRingBufferBytes(&btRingBufferTail, previousTail, newTail);
-    discardRingBufferBytes(&sdRingBufferTail, previousTail, newTail);
-    discardPvtClientBytes(previousTail, newTail);
-    discardPvtServerBytes(previousTail, newTail);
-    discardPvtUdpServerBytes(previousTail, newTail);
+    return (bluetoothGetState() == BT_CONNECTED) && (systemState != STATE_BASE_TEMP_SETTLE) &&
+           (systemState != STATE_BASE_TEMP_SURVEY_STARTED);
 }
 
-// Remove previous messages from the ring buffer
-void discardRingBufferBytes(RING_BUFFER_OFFSET *tail, RING_BUFFER_OFFSET previousTail, RING_BUFFER_OFFSET newTail)
+// Send data out Bluetooth
+int32_t btConsumerSend(RING_BUFFER_CONSUMER *consumer, const uint8_t *data, int32_t length)
 {
-    // The longest tail is being trimmed.  Medium length tails may contain
-    // some data within the region begin trimmed.  The shortest tails will
-    // be trimmed.
-    //
-    // Devices that get their tails trimmed, may output a partial message
-    // prior to the buffer trimming.  After the trimming, the tail of the
-    // ring buffer points to the beginning of a new message.
-    //
-    //                 previousTail                newTail
-    //                      |                         |
-    //  Before trimming     v         Discarded       v   After trimming
-    //  ----+-----------------  ...  -----+--  ..  ---+-----------+------
-    //      | Partial message             |           |           |
-    //  ----+-----------------  ...  -----+--  ..  ---+-----------+------
-    //                      ^          ^                     ^
-    //                      |          |                     |
-    //        long tail ----'          '--- medium tail      '-- short tail
-    //
-    // Determine if the trimmed data wraps the end of the buffer
-    if (previousTail < newTail)
+    // If we are in the config menu, suppress data flowing from ZED to cell phone
+    if (btPrintEcho == false)
+        // Push new data to BT SPP
+        length = bluetoothWrite(data, length);
+
+    // Account for the data that was sent
+    if (length > 0)
     {
-        // No buffer wrap occurred
-        // Only discard the data from long and medium tails
-        if ((*tail >= previousTail) && (*tail < newTail))
-            *tail = newTail;
+        // If we are in base mode, assume part of the outgoing data is RTCM
+        if (systemState >= STATE_BASE_NOT_STARTED && systemState <= STATE_BASE_FIXED_TRANSMITTING)
+            bluetoothOutgoingRTCM = true;
+
+        // Display the data movement
+        if (PERIODIC_DISPLAY(PD_BLUETOOTH_DATA_TX))
+        {
+            PERIODIC_CLEAR(PD_BLUETOOTH_DATA_TX);
+            systemPrintf("Bluetooth: %d bytes written\r\n", length);
+        }
     }
     else
-    {
-        // Buffer wrap occurred
-        if ((*tail >= previousTail) || (*tail < newTail))
-            *tail = newTail;
-    }
+        log_w("BT failed to send");
+    return length;
 }
 
-// If new data is in the ringBuffer, dole it out to appropriate interface
-// Send data out Bluetooth, record to SD, or send to network clients
-// Each device (Bluetooth, SD and network client) gets its own tail.  If the
-// device is running too slowly then data for that device is dropped.
-// The usedSpace variable tracks the total space in use in the buffer.
-void handleGnssDataTask(void *e)
+static RING_BUFFER_CONSUMER btConsumer = {"Bluetooth", btConsumerConnected, btConsumerSend,
+                                          &settings.btWriteTaskPriority, &settings.btWriteTaskCore,
+                                          MESSAGE_FILTER_BLUETOOTH};
+
+//----------------------------------------------------------------------
+// SD card ring buffer consumer
+//----------------------------------------------------------------------
+
+// Determine if the SD card is enabled for logging
+bool sdConsumerConnected(RING_BUFFER_CONSUMER *consumer)
 {
-    int32_t bytesToSend;
-    bool connected;
-    uint32_t deltaMillis;
-    int32_t freeSpace;
-    uint16_t listEnd;
-    static uint32_t maxMillis[RBC_MAX];
-    uint32_t startMillis;
-    int32_t usedSpace;
+    return online.logging && ((systemTime_minutes - startLogTime_minutes) < settings.maxLogTime_minutes);
+}
 
-    // Initialize the tails
-    btRingBufferTail = 0;
-    pvtClientZeroTail();
-    pvtServerZeroTail();
-    pvtUdpServerZeroTail();
-    sdRingBufferTail = 0;
+// Display the log file write statistics
+void sdLogDisplayWrites()
+{
+    int bucket;
+    uint32_t writes;
+
+    writes = 0;
+    for (bucket = 0; bucket < SD_WRITE_HISTOGRAM_BUCKETS; bucket++)
+        writes += sdWriteSizes[bucket];
+    if (writes == 0)
+        return;
+
+    systemPrintf("SD %d writes, max %d ms\r\n", writes, sdWriteMaxMillis);
+    for (bucket = 0; bucket < SD_WRITE_HISTOGRAM_BUCKETS; bucket++)
+        if (sdWriteSizes[bucket])
+            systemPrintf("    %5d - %5d bytes: %d writes\r\n", bucket ? 1 << (bucket - 1) : 0,
+                         bucket ? (1 << bucket) - 1 : 0, sdWriteSizes[bucket]);
+    for (bucket = 0; bucket < SD_WRITE_HISTOGRAM_BUCKETS; bucket++)
+        if (sdWriteTimes[bucket])
+            systemPrintf("    %5d - %5d ms: %d writes\r\n", bucket ? 1 << (bucket - 1) : 0,
+                         bucket ? (1 << bucket) - 1 : 0, sdWriteTimes[bucket]);
+}
 
-    while (true)
-    {
-        // Display an alive message
-        if (PERIODIC_DISPLAY(PD_TASK_HANDLE_GNSS_DATA))
-        {
-            PERIODIC_CLEAR(PD_TASK_HANDLE_GNSS_DATA);
-            systemPrintln("handleGnssDataTask running");
-        }
+// Display the log file compression statistics
+void sdLogDisplayCompression()
+{
+    if ((!sdLogCompress) || (!sdLogCompress->blocks))
+        return;
+
+    systemPrintf("Log compression: %llu bytes --> %llu bytes, %0.2f : 1, %d of %d blocks stored\r\n",
+                 sdLogCompress->dataBytes, sdLogCompress->compressedBytes,
+                 (double)sdLogCompress->dataBytes / (double)sdLogCompress->compressedBytes,
+                 sdLogCompress->storedBlocks, sdLogCompress->blocks);
+    systemPrintf("Log compression time: %llu uSec/block average, %d uSec/block maximum\r\n",
+                 sdLogCompressMicros / sdLogCompress->blocks, sdLogCompressMaxMicros);
+}
 
-        usedSpace = 0;
+// Release the log file compression buffers
+void sdLogCompressFree()
+{
+    if (sdLogCompress)
+        free(sdLogCompress);
+    sdLogCompress = nullptr;
+    if (sdLogCompressBuffer)
+        free(sdLogCompressBuffer);
+    sdLogCompressBuffer = nullptr;
+}
 
-        //----------------------------------------------------------------------
-        // Send data over Bluetooth
-        //----------------------------------------------------------------------
+// Get the extension for new log files
+const char *sdLogExtension()
+{
+    return settings.enableLogCompression ? LOG_COMPRESS_EXTENSION : "ubx";
+}
 
-        startMillis = millis();
+// Build the index file name from the log file name
+void sdLogIndexFileName(char *fileName, size_t fileNameSize)
+{
+    char *extension;
 
-        // Determine BT connection state
-        bool connected = (bluetoothGetState() == BT_CONNECTED) && (systemState != STATE_BASE_TEMP_SETTLE) &&
-                         (systemState != STATE_BASE_TEMP_SURVEY_STARTED);
-        if (!connected)
-            // Discard the data
-            btRingBufferTail = dataHead;
-        else
-        {
-            // Determine the amount of Bluetooth data in the buffer
-            bytesToSend = dataHead - btRingBufferTail;
-            if (bytesToSend < 0)
-                bytesToSend += settings.gnssHandlerBufferSize;
-            if (bytesToSend > 0)
-            {
-                // Reduce bytes to send if we have more to send then the end of
-                // the buffer, we'll wrap next loop
-                if ((btRingBufferTail + bytesToSend) > settings.gnssHandlerBufferSize)
-                    bytesToSend = settings.gnssHandlerBufferSize - btRingBufferTail;
-
-                // If we are in the config menu, suppress data flowing from ZED to cell phone
-                if (btPrintEcho == false)
-                    // Push new data to BT SPP
-                    bytesToSend = bluetoothWrite(&ringBuffer[btRingBufferTail], bytesToSend);
-
-                // Account for the data that was sent
-                if (bytesToSend > 0)
-                {
-                    // If we are in base mode, assume part of the outgoing data is RTCM
-                    if (systemState >= STATE_BASE_NOT_STARTED && systemState <= STATE_BASE_FIXED_TRANSMITTING)
-                        bluetoothOutgoingRTCM = true;
-
-                    // Account for the sent or dropped data
-                    btRingBufferTail += bytesToSend;
-                    if (btRingBufferTail >= settings.gnssHandlerBufferSize)
-                        btRingBufferTail -= settings.gnssHandlerBufferSize;
-
-                    // Remember the maximum transfer time
-                    deltaMillis = millis() - startMillis;
-                    if (maxMillis[RBC_BLUETOOTH] < deltaMillis)
-                        maxMillis[RBC_BLUETOOTH] = deltaMillis;
-
-                    // Display the data movement
-                    if (PERIODIC_DISPLAY(PD_BLUETOOTH_DATA_TX))
-                    {
-                        PERIODIC_CLEAR(PD_BLUETOOTH_DATA_TX);
-                        systemPrintf("Bluetooth: %d bytes written\r\n", bytesToSend);
-                    }
-                }
-                else
-                    log_w("BT failed to send");
+    strncpy(fileName, logFileName, fileNameSize - 1);
+    fileName[fileNameSize - 1] = 0;
+    extension = strrchr(fileName, '.');
+    if (extension && ((extension + 1 + strlen(LOG_INDEX_EXTENSION)) < (fileName + fileNameSize)))
+        strcpy(extension + 1, LOG_INDEX_EXTENSION);
+}
 
-                // Determine the amount of data that remains in the buffer
-                bytesToSend = dataHead - btRingBufferTail;
-                if (bytesToSend < 0)
-                    bytesToSend += settings.gnssHandlerBufferSize;
-                if (usedSpace < bytesToSend)
-                {
-                    usedSpace = bytesToSend;
-                    slowConsumer = "Bluetooth";
-                }
-            }
-        }
+// Write the pending index records to the index file.  The caller must hold
+// the sdCardSemaphore.
+void sdLogIndexWrite()
+{
+    size_t length;
 
-        //----------------------------------------------------------------------
-        // Send data to the network clients
-        //----------------------------------------------------------------------
+    if ((!sdLogIndex) || (!sdLogIndex->recordCount))
+        return;
 
-        startMillis = millis();
+    length = sdLogIndex->recordCount * sizeof(LOG_INDEX_RECORD);
+    if (sdLogIndexFile->write((const uint8_t *)sdLogIndex->records, length) != length)
+        log_d("Failed to write the log index records");
+    sdLogIndex->recordCount = 0;
+}
 
-        // Update space available for use in UART task
-        bytesToSend = pvtClientSendData(dataHead);
-        if (usedSpace < bytesToSend)
-        {
-            usedSpace = bytesToSend;
-            slowConsumer = "PVT client";
-        }
+// Open the index file for the log file and start a new series of index
+// records.  The caller must hold the sdCardSemaphore.
+void sdLogIndexOpen()
+{
+    char fileName[sizeof(logFileName)];
 
-        // Remember the maximum transfer time
-        deltaMillis = millis() - startMillis;
-        if (maxMillis[RBC_PVT_CLIENT] < deltaMillis)
-            maxMillis[RBC_PVT_CLIENT] = deltaMillis;
+    if (!settings.enableLogIndex)
+        return;
 
-        startMillis = millis();
+    sdLogIndexFileName(fileName, sizeof(fileName));
+    sdLogIndexFile = new FileSdFatMMC;
+    sdLogIndex = (LOG_INDEX *)malloc(sizeof(LOG_INDEX));
+    if ((!sdLogIndexFile) || (!sdLogIndex) || (sdLogIndexFile->open(fileName, O_CREAT | O_APPEND | O_WRITE) == false))
+    {
+        systemPrintf("Failed to create log index file: %s\r\n", fileName);
+        if (sdLogIndexFile)
+            delete sdLogIndexFile;
+        sdLogIndexFile = nullptr;
+        sdLogIndexClose();
+        return;
+    }
+
+    // The receiver sets the RTC, use its date until the NMEA RMC or ZDA
+    // sentence provides the date
+    logIndexInit(sdLogIndex, leapSeconds ? leapSeconds : LOG_INDEX_DEFAULT_LEAP_SECONDS,
+                 logIndexDays(rtc.getYear(), rtc.getMonth() + 1, rtc.getDay()), // ESP32Time returns month:0-11
+                 sdLogCompress ? LOG_INDEX_FLAG_COMPRESSED : 0);
+    sdLogIndexWrite();
+    sdDirectoryUpdate(fileName, sdLogIndexFile->fileSize());
+}
+
+// Write the remaining index records and close the index file.  The caller
+// must hold the sdCardSemaphore.
+void sdLogIndexClose()
+{
+    char fileName[sizeof(logFileName)];
 
-        // Update space available for use in UART task
-        bytesToSend = pvtServerSendData(dataHead);
-        if (usedSpace < bytesToSend)
+    if (sdLogIndexFile)
+    {
+        if (sdLogIndex)
         {
-            usedSpace = bytesToSend;
-            slowConsumer = "PVT server";
+            logIndexFinish(sdLogIndex);
+            sdLogIndexWrite();
         }
+        sdLogIndexFile->sync();
+        sdLogIndexFileName(fileName, sizeof(fileName));
+        sdDirectoryUpdate(fileName, sdLogIndexFile->fileSize());
+        sdLogIndexFile->close();
+        delete sdLogIndexFile;
+        sdLogIndexFile = nullptr;
+    }
+    if (sdLogIndex)
+        free(sdLogIndex);
+    sdLogIndex = nullptr;
+}
 
-        // Remember the maximum transfer time
-        deltaMillis = millis() - startMillis;
-        if (maxMillis[RBC_PVT_SERVER] < deltaMillis)
-            maxMillis[RBC_PVT_SERVER] = deltaMillis;
+// Add the start of a message to the index.  The caller must hold the
+// sdCardSemaphore.
+void sdLogIndexMessage(const uint8_t *data, int32_t length)
+{
+    uint16_t blockOffset;
+    uint32_t offset;
+
+    // The staged data and the pending compressed block are written next
+    offset = fileSize + sdLogBufferBytes;
+    blockOffset = sdLogCompress ? sdLogCompressBytes : 0;
+    if (logIndexMessage(sdLogIndex, data, length, offset, blockOffset))
+        sdLogIndexWrite();
+}
 
-        startMillis = millis();
+// Write the staging buffer to the log file.  The caller must hold the
+// sdCardSemaphore.  Returns true if all of the data was written.
+bool sdLogWriteBuffer()
+{
+    int bucket;
+    int32_t bytesWritten;
+    uint32_t deltaMillis;
+    uint64_t previousSize;
+    uint32_t startMillis;
 
-        // Update space available for use in UART task
-        bytesToSend = pvtUdpServerSendData(dataHead);
-        if (usedSpace < bytesToSend)
-        {
-            usedSpace = bytesToSend;
-            slowConsumer = "PVT UDP server";
-        }
+    if (sdLogBufferBytes == 0)
+        return true;
+
+    // Write the data to the file
+    startMillis = millis();
+    bytesWritten = ubxFile->write(sdLogBuffer, sdLogBufferBytes);
+    deltaMillis = millis() - startMillis;
+
+    // Bucket 0 holds 0, bucket n holds 2^(n-1) to (2^n) - 1
+    bucket = 0;
+    while ((bucket < (SD_WRITE_HISTOGRAM_BUCKETS - 1)) && (sdLogBufferBytes >> bucket))
+        bucket += 1;
+    sdWriteSizes[bucket] += 1;
+    bucket = 0;
+    while ((bucket < (SD_WRITE_HISTOGRAM_BUCKETS - 1)) && (deltaMillis >> bucket))
+        bucket += 1;
+    sdWriteTimes[bucket] += 1;
+    if (sdWriteMaxMillis < deltaMillis)
+        sdWriteMaxMillis = deltaMillis;
+
+    if (PERIODIC_DISPLAY(PD_SD_LOG_WRITE) && (!inMainMenu))
+    {
+        PERIODIC_CLEAR(PD_SD_LOG_WRITE);
+        sdLogDisplayWrites();
+        sdLogDisplayCompression();
+    }
 
-        // Remember the maximum transfer time
-        deltaMillis = millis() - startMillis;
-        if (maxMillis[RBC_PVT_UDP_SERVER] < deltaMillis)
-            maxMillis[RBC_PVT_UDP_SERVER] = deltaMillis;
+    if (settings.enablePrintBufferOverrun && (deltaMillis > 150))
+        systemPrintf("Long Write! Time: %ld ms / Location: %ld / Recorded %d bytes / "
+                     "spaceRemaining %d bytes\r\n",
+                     deltaMillis, fileSize, sdLogBufferBytes, combinedSpaceRemaining);
+
+    if (bytesWritten < 0)
+        bytesWritten = 0;
+    if (bytesWritten != (int32_t)sdLogBufferBytes)
+        systemPrintf("SD write mismatch: wrote %d bytes of %d\r\n", bytesWritten, sdLogBufferBytes);
+
+    // Update remaining space on SD, the pre-allocated clusters were removed
+    // from the free space by sdLogOpen
+    previousSize = fileSize;
+    fileSize += bytesWritten;
+    if (previousSize < sdLogPreallocated)
+        previousSize = sdLogPreallocated;
+    if (fileSize > previousSize)
+        sdFreeSpaceAdjust(previousSize, fileSize);
+
+    // Fill the buffer to the next sector boundary in the file, after a partial
+    // write the next write realigns the file position with the sectors
+    sdLogBufferBytes = 0;
+    sdLogBufferLimit = sdLogBufferSize - (fileSize % SD_SECTOR_SIZE);
+    return (bytesWritten != 0);
+}
 
-        //----------------------------------------------------------------------
-        // Log data to the SD card
-        //----------------------------------------------------------------------
+// Move data into the staging buffer, full buffers are written to the log file.
+// The caller must hold the sdCardSemaphore.
+void sdLogStage(const uint8_t *data, int32_t length)
+{
+    int32_t bytesToCopy;
 
-        // Determine if the SD card is enabled for logging
-        connected = online.logging && ((systemTime_minutes - startLogTime_minutes) < settings.maxLogTime_minutes);
+    while (length > 0)
+    {
+        // Move the data into the staging buffer
+        bytesToCopy = sdLogBufferLimit - sdLogBufferBytes;
+        if (bytesToCopy > length)
+            bytesToCopy = length;
+        memcpy(&sdLogBuffer[sdLogBufferBytes], data, bytesToCopy);
+        sdLogBufferBytes += bytesToCopy;
+        data += bytesToCopy;
+        length -= bytesToCopy;
+
+        // Write the full buffer to the log file
+        if (sdLogBufferBytes >= sdLogBufferLimit)
+            sdLogWriteBuffer();
+    }
+}
 
-        // If user wants to log, record to SD
-        if (!connected)
-            // Discard the data
-            sdRingBufferTail = dataHead;
-        else
-        {
-            // Determine the amount of microSD card logging data in the buffer
-            bytesToSend = dataHead - sdRingBufferTail;
-            if (bytesToSend < 0)
-                bytesToSend += settings.gnssHandlerBufferSize;
-            if (bytesToSend > 0)
-            {
-                // Attempt to gain access to the SD card, avoids collisions with file
-                // writing from other functions like recordSystemSettingsToFile()
-                if (xSemaphoreTake(sdCardSemaphore, loggingSemaphoreWait_ms) == pdPASS)
-                {
-                    markSemaphore(FUNCTION_WRITESD);
+// Compress the pending block and move it into the staging buffer.  The
+// caller must hold the sdCardSemaphore.
+void sdLogCompressBlock()
+{
+    int32_t bytes;
+    uint32_t deltaMicros;
+    uint32_t startMicros;
+
+    if ((!sdLogCompress) || (!sdLogCompressBytes))
+        return;
+
+    // The compressed block follows the uncompressed data in the buffer
+    startMicros = micros();
+    bytes = logCompressBlock(sdLogCompress, sdLogCompressBuffer, sdLogCompressBytes,
+                             &sdLogCompressBuffer[LOG_COMPRESS_BLOCK_BYTES]);
+    deltaMicros = micros() - startMicros;
+    sdLogCompressMicros += deltaMicros;
+    if (sdLogCompressMaxMicros < deltaMicros)
+        sdLogCompressMaxMicros = deltaMicros;
+    sdLogCompressBytes = 0;
+
+    sdLogStage(&sdLogCompressBuffer[LOG_COMPRESS_BLOCK_BYTES], bytes);
+}
 
-                    do // Do the SD write in a do loop so we can break out if needed
-                    {
-                        if (settings.enablePrintSDBuffers && (!inMainMenu))
-                        {
-                            int bufferAvailable;
-                            if (USE_I2C_GNSS)
-                                bufferAvailable = serialGNSS.available();
-                            else
-                            {
-                                theGNSS.checkUblox();
-                                bufferAvailable = theGNSS.fileBufferAvailable();
-                            }
-                            int availableUARTSpace;
-                            if (USE_I2C_GNSS)
-                                availableUARTSpace = settings.uartReceiveBufferSize - bufferAvailable;
-                            else
-                                // Use gnssHandlerBufferSize for now. TODO: work out if the SPI GNSS needs its own buffer
-                                // size setting
-                                availableUARTSpace = settings.gnssHandlerBufferSize - bufferAvailable;
-                            systemPrintf("SD Incoming Serial: %04d\tToRead: %04d\tMovedToBuffer: %04d\tavailableUARTSpace: "
-                                        "%04d\tavailableHandlerSpace: %04d\tToRecord: %04d\tRecorded: %04d\tBO: %d\r\n",
-                                        bufferAvailable, 0, 0, availableUARTSpace, availableHandlerSpace, bytesToSend, 0,
-                                        bufferOverruns);
-                        }
+// Write the pending data to the log file.  The caller must hold the
+// sdCardSemaphore.  Returns true if all of the data was written.
+bool sdLogFlush()
+{
+    sdLogCompressBlock();
+    return sdLogWriteBuffer();
+}
 
-                        // For the SD card, we need to write everything we've got
-                        // to prevent the ARP Write and Events from gatecrashing...
-                            
-                        int32_t sendTheseBytes = bytesToSend;
+// Add data to the log file, the data is compressed when writing a compressed
+// log file.  The caller must hold the sdCardSemaphore.
+void sdLogWrite(const uint8_t *data, int32_t length)
+{
+    int32_t bytesToCopy;
 
-                        // Reduce bytes to record if we have more then the end of the buffer
-                        if ((sdRingBufferTail + sendTheseBytes) > settings.gnssHandlerBufferSize)
-                            sendTheseBytes = settings.gnssHandlerBufferSize - sdRingBufferTail;
+    if (!sdLogCompress)
+    {
+        sdLogStage(data, length);
+        return;
+    }
 
-                        // Write the data to the file
-                        startMillis = millis();
+    while (length > 0)
+    {
+        // Move the data into the block
+        bytesToCopy = LOG_COMPRESS_BLOCK_BYTES - sdLogCompressBytes;
+        if (bytesToCopy > length)
+            bytesToCopy = length;
+        memcpy(&sdLogCompressBuffer[sdLogCompressBytes], data, bytesToCopy);
+        sdLogCompressBytes += bytesToCopy;
+        data += bytesToCopy;
+        length -= bytesToCopy;
+
+        // Compress the full block
+        if (sdLogCompressBytes >= LOG_COMPRESS_BLOCK_BYTES)
+            sdLogCompressBlock();
+    }
+}
 
-                        int32_t bytesSent = ubxFile->write(&ringBuffer[sdRingBufferTail], sendTheseBytes);
+// Add a line of text to the log file staging buffer.  The caller must hold
+// the sdCardSemaphore.
+void sdLogPrintln(const char *text)
+{
+    sdLogWrite((const uint8_t *)text, strlen(text));
+    sdLogWrite((const uint8_t *)"\r\n", 2);
+}
 
-                        // Account for the sent data or dropped
-                        sdRingBufferTail += bytesSent;
-                        if (sdRingBufferTail >= settings.gnssHandlerBufferSize)
-                            sdRingBufferTail -= settings.gnssHandlerBufferSize;
+// Record the data to the SD card
+int32_t sdConsumerSend(RING_BUFFER_CONSUMER *consumer, const uint8_t *data, int32_t length)
+{
+    bool messageBoundary;
 
-                        if (bytesSent != sendTheseBytes)
-                        {
-                            systemPrintf("SD write mismatch (1): wrote %d bytes of %d\r\n",
-                                         bytesSent, sendTheseBytes);
-                            break; // Exit the do loop
-                        }
+    // Attempt to gain access to the SD card, avoids collisions with file
+    // writing from other functions like recordSystemSettingsToFile()
+    if (xSemaphoreTake(sdCardSemaphore, loggingSemaphoreWait_ms) != pdPASS)
+    {
+        char semaphoreHolder[50];
+        getSemaphoreFunction(semaphoreHolder);
+        log_w("sdCardSemaphore failed to yield for SD write, held by %s, Tasks.ino line %d", semaphoreHolder,
+              __LINE__);
 
-                        // If we have more data to write - and the first write was successful
-                        if (bytesToSend > sendTheseBytes)
-                        {
-                            sendTheseBytes = bytesToSend - sendTheseBytes;
+        delay(1); // Needed to prevent WDT resets during long Record Settings locks
+        taskYIELD();
+        return 0;
+    }
+    markSemaphore(FUNCTION_WRITESD);
 
-                            bytesSent = ubxFile->write(&ringBuffer[sdRingBufferTail], sendTheseBytes);
+    // Discard the data if the log file was closed
+    if (!online.logging)
+    {
+        xSemaphoreGive(sdCardSemaphore);
+        return length;
+    }
 
-                            // Account for the sent data or dropped
-                            sdRingBufferTail += bytesSent;
-                            if (sdRingBufferTail >= settings.gnssHandlerBufferSize) // Should be redundant
-                                sdRingBufferTail -= settings.gnssHandlerBufferSize;
+    // The events and ARP must not gatecrash the GNSS messages
+    messageBoundary = consumer->messageEnd;
 
-                            if (bytesSent != sendTheseBytes)
-                            {
-                                systemPrintf("SD write mismatch (2): wrote %d bytes of %d\r\n",
-                                             bytesSent, sendTheseBytes);
-                                break; // Exit the do loop
-                            }
-                        }
+    if (settings.enablePrintSDBuffers && (!inMainMenu))
+    {
+        int bufferAvailable;
+        if (USE_I2C_GNSS)
+            bufferAvailable = serialGNSS.available();
+        else
+        {
+            theGNSS.checkUblox();
+            bufferAvailable = theGNSS.fileBufferAvailable();
+        }
+        int availableUARTSpace;
+        if (USE_I2C_GNSS)
+            availableUARTSpace = settings.uartReceiveBufferSize - bufferAvailable;
+        else
+            // Use gnssHandlerBufferSize for now. TODO: work out if the SPI GNSS needs its own buffer
+            // size setting
+            availableUARTSpace = settings.gnssHandlerBufferSize - bufferAvailable;
+        systemPrintf("SD Incoming Serial: %04d\tToRead: %04d\tMovedToBuffer: %04d\tavailableUARTSpace: "
+                     "%04d\tavailableHandlerSpace: %04d\tToRecord: %04d\tRecorded: %04d\tBO: %d\r\n",
+                     bufferAvailable, 0, 0, availableUARTSpace, ringBufferAvailable(&gnssRingBuffer, nullptr),
+                     length, 0, bufferOverruns);
+    }
 
-                        if (PERIODIC_DISPLAY(PD_SD_LOG_WRITE) && (bytesToSend > 0) && (!inMainMenu))
-                        {
-                            PERIODIC_CLEAR(PD_SD_LOG_WRITE);
-                            systemPrintf("SD %d bytes written to log file\r\n", bytesToSend);
-                        }
+    // Create the next log file requested by updateLogs
+    if (sdLogCreateNextRequest)
+        sdLogCreateNext();
 
-                        sdFreeSpace -= bytesToSend; // Update remaining space on SD
+    // Switch to the next log file before the first message of an epoch
+    if (sdLogMessageStart && logRotateMessage(&sdLogRotate, data, length))
+        sdLogSwitch();
 
-                        // Record any pending trigger events
-                        if (newEventToRecord == true)
-                        {
-                            newEventToRecord = false;
+    // Move the data into the staging buffer, full buffers are written to the file
+    if (sdLogIndex && sdLogMessageStart)
+        sdLogIndexMessage(data, length);
+    sdLogMessageStart = messageBoundary;
+    sdLogWrite(data, length);
 
-                            if ((settings.enablePrintLogFileStatus) && (!inMainMenu))
-                                systemPrintln("Recording event");
+    // Record any pending trigger events
+    if (messageBoundary && (newEventToRecord == true))
+    {
+        newEventToRecord = false;
 
-                            // Record trigger count with Time Of Week of rising edge (ms), Millisecond fraction of Time Of Week of
-                            // rising edge (ns), and accuracy estimate (ns)
-                            char eventData[82]; // Max NMEA sentence length is 82
-                            snprintf(eventData, sizeof(eventData), "%d,%d,%d,%d", triggerCount, triggerTowMsR, triggerTowSubMsR,
-                                    triggerAccEst);
+        if ((settings.enablePrintLogFileStatus) && (!inMainMenu))
+            systemPrintln("Recording event");
 
-                            char nmeaMessage[82]; // Max NMEA sentence length is 82
-                            createNMEASentence(CUSTOM_NMEA_TYPE_EVENT, nmeaMessage, sizeof(nmeaMessage),
-                                            eventData); // textID, buffer, sizeOfBuffer, text
+        // Record trigger count with Time Of Week of rising edge (ms), Millisecond fraction of Time Of Week of
+        // rising edge (ns), and accuracy estimate (ns)
+        char eventData[82]; // Max NMEA sentence length is 82
+        snprintf(eventData, sizeof(eventData), "%d,%d,%d,%d", triggerCount, triggerTowMsR, triggerTowSubMsR,
+                 triggerAccEst);
 
-                            ubxFile->write((const uint8_t *)nmeaMessage, strlen(nmeaMessage));
-                            const char *crlf = "\r\n";
-                            ubxFile->write((const uint8_t *)crlf, 2);
+        char nmeaMessage[82]; // Max NMEA sentence length is 82
+        createNMEASentence(CUSTOM_NMEA_TYPE_EVENT, nmeaMessage, sizeof(nmeaMessage),
+                           eventData); // textID, buffer, sizeOfBuffer, text
 
-                            sdFreeSpace -= strlen(nmeaMessage) + 2; // Update remaining space on SD
-                        }
+        sdLogPrintln(nmeaMessage);
+    }
 
-                        // Record the Antenna Reference Position - if available
-                        if (newARPAvailable == true && settings.enableARPLogging &&
-                            ((millis() - lastARPLog) > (settings.ARPLoggingInterval_s * 1000)))
-                        {
-                            lastARPLog = millis();
-                            newARPAvailable = false;
-
-                            double x = ARPECEFX;
-                            x /= 10000.0; // Convert to m
-                            double y = ARPECEFY;
-                            y /= 10000.0; // Convert to m
-                            double z = ARPECEFZ;
-                            z /= 10000.0; // Convert to m
-                            double h = ARPECEFH;
-                            h /= 10000.0;     // Convert to m
-                            char ARPData[82]; // Max NMEA sentence length is 82
-                            snprintf(ARPData, sizeof(ARPData), "%.4f,%.4f,%.4f,%.4f", x, y, z, h);
-
-                            if ((settings.enablePrintLogFileStatus) && (!inMainMenu))
-                                systemPrintf("Recording Antenna Reference Position %s\r\n", ARPData);
-
-                            char nmeaMessage[82]; // Max NMEA sentence length is 82
-                            createNMEASentence(CUSTOM_NMEA_TYPE_ARP_ECEF_XYZH, nmeaMessage, sizeof(nmeaMessage),
-                                            ARPData); // textID, buffer, sizeOfBuffer, text
-
-                            ubxFile->write((const uint8_t *)nmeaMessage, strlen(nmeaMessage));
-                            const char *crlf = "\r\n";
-                            ubxFile->write((const uint8_t *)crlf, 2);
-
-                            sdFreeSpace -= strlen(nmeaMessage) + 2; // Update remaining space on SD
-                        }
+    // Record the Antenna Reference Position - if available
+    if (messageBoundary && newARPAvailable == true && settings.enableARPLogging &&
+        ((millis() - lastARPLog) > (settings.ARPLoggingInterval_s * 1000)))
+    {
+        lastARPLog = millis();
+        newARPAvailable = false;
+
+        double x = ARPECEFX;
+        x /= 10000.0; // Convert to m
+        double y = ARPECEFY;
+        y /= 10000.0; // Convert to m
+        double z = ARPECEFZ;
+        z /= 10000.0; // Convert to m
+        double h = ARPECEFH;
+        h /= 10000.0;     // Convert to m
+        char ARPData[82]; // Max NMEA sentence length is 82
+        snprintf(ARPData, sizeof(ARPData), "%.4f,%.4f,%.4f,%.4f", x, y, z, h);
+
+        if ((settings.enablePrintLogFileStatus) && (!inMainMenu))
+            systemPrintf("Recording Antenna Reference Position %s\r\n", ARPData);
+
+        char nmeaMessage[82]; // Max NMEA sentence length is 82
+        createNMEASentence(CUSTOM_NMEA_TYPE_ARP_ECEF_XYZH, nmeaMessage, sizeof(nmeaMessage),
+                           ARPData); // textID, buffer, sizeOfBuffer, text
+
+        sdLogPrintln(nmeaMessage);
+    }
 
-                        static unsigned long lastFlush = 0;
-                        if (USE_MMC_MICROSD)
-                        {
-                            if (millis() > (lastFlush + 250)) // Flush every 250ms, not every write
-                            {
-                                ubxFile->flush();
-                                lastFlush += 250;
-                            }
-                        }
-                        fileSize = ubxFile->fileSize(); // Update file size                        
+    static unsigned long lastFlush = 0;
+    if (USE_MMC_MICROSD)
+    {
+        if (millis() > (lastFlush + 250)) // Flush every 250ms, not every write
+        {
+            ubxFile->flush();
+            lastFlush += 250;
+        }
+    }
 
-                        // Force file sync every 60s
-                        if (millis() - lastUBXLogSyncTime > 60000)
-                        {
-                            if (productVariant == RTK_SURVEYOR)
-                                digitalWrite(pin_baseStatusLED,
-                                            !digitalRead(pin_baseStatusLED)); // Blink LED to indicate logging activity
+    // Force file sync every 60s
+    if (millis() - lastUBXLogSyncTime > 60000)
+    {
+        if (productVariant == RTK_SURVEYOR)
+            digitalWrite(pin_baseStatusLED,
+                         !digitalRead(pin_baseStatusLED)); // Blink LED to indicate logging activity
 
-                            ubxFile->sync();
-                            ubxFile->updateFileAccessTimestamp(); // Update the file access time & date
+        sdLogFlush(); // Write the partial block and buffer
+        ubxFile->sync();
+        if (sdLogIndexFile)
+        {
+            sdLogIndexWrite();
+            sdLogIndexFile->sync();
+        }
+        ubxFile->updateFileAccessTimestamp(); // Update the file access time & date
 
-                            if (productVariant == RTK_SURVEYOR)
-                                digitalWrite(pin_baseStatusLED,
-                                            !digitalRead(pin_baseStatusLED)); // Return LED to previous state
+        if (productVariant == RTK_SURVEYOR)
+            digitalWrite(pin_baseStatusLED,
+                         !digitalRead(pin_baseStatusLED)); // Return LED to previous state
 
-                            lastUBXLogSyncTime = millis();
-                        }
+        lastUBXLogSyncTime = millis();
+    }
 
-                        // Remember the maximum transfer time
-                        deltaMillis = millis() - startMillis;
-                        if (maxMillis[RBC_SD_CARD] < deltaMillis)
-                            maxMillis[RBC_SD_CARD] = deltaMillis;
+    xSemaphoreGive(sdCardSemaphore);
+    return length;
+}
 
-                        if (settings.enablePrintBufferOverrun)
-                        {
-                            if (deltaMillis > 150)
-                                systemPrintf("Long Write! Time: %ld ms / Location: %ld / Recorded %d bytes / "
-                                            "spaceRemaining %d bytes\r\n",
-                                            deltaMillis, fileSize, bytesToSend, combinedSpaceRemaining);
-                        }
-                    } while(0);
+static RING_BUFFER_CONSUMER sdConsumer = {"SD Card", sdConsumerConnected, sdConsumerSend,
+                                          &settings.sdWriteTaskPriority, &settings.sdWriteTaskCore,
+                                          MESSAGE_FILTER_SD_CARD, sdConsumerTaskStackSize};
 
-                    xSemaphoreGive(sdCardSemaphore);
-                } // End sdCardSemaphore
-                else
-                {
-                    char semaphoreHolder[50];
-                    getSemaphoreFunction(semaphoreHolder);
-                    log_w("sdCardSemaphore failed to yield for SD write, held by %s, Tasks.ino line %d",
-                          semaphoreHolder, __LINE__);
+//----------------------------------------------------------------------
+// Ring buffer consumers
+//----------------------------------------------------------------------
 
-                    delay(1); // Needed to prevent WDT resets during long Record Settings locks
-                    taskYIELD();
-                }
+// Pass the data in the ring buffer to a single consumer: Bluetooth, SD card
+// or network client.  Each registered consumer has its own tail and its own
+// task, so a consumer that blocks in its send routine only delays itself.  If
+// the consumer is running too slowly then data for that consumer is dropped
+// by gnssReadTask.  gnssReadTask wakes the consumer tasks when new messages
+// are added to the ring buffer.
+void handleGnssDataTask(void *e)
+{
+    int32_t bytesSent;
+    RING_BUFFER_CONSUMER *consumer;
+    uint32_t startMillis;
 
-                // Update space available for use in UART task
-                bytesToSend = dataHead - sdRingBufferTail;
-                if (bytesToSend < 0)
-                    bytesToSend += settings.gnssHandlerBufferSize;
-                if (usedSpace < bytesToSend)
-                {
-                    usedSpace = bytesToSend;
-                    slowConsumer = "SD card";
-                }
-            } // bytesToSend
-        } // End connected
+    consumer = (RING_BUFFER_CONSUMER *)e;
+    while (true)
+    {
+        // Display an alive message
+        if (PERIODIC_DISPLAY(PD_TASK_HANDLE_GNSS_DATA))
+        {
+            PERIODIC_CLEAR(PD_TASK_HANDLE_GNSS_DATA);
+            systemPrintf("handleGnssDataTask running: %s\r\n", consumer->name);
+        }
 
-        //----------------------------------------------------------------------
-        // Update the available space in the ring buffer
-        //----------------------------------------------------------------------
+        // Pass the data to the consumer
+        startMillis = millis();
+        bytesSent = ringBufferService(&gnssRingBuffer, consumer);
 
-        freeSpace = settings.gnssHandlerBufferSize - usedSpace;
+        // Account for the transfer time
+        if (bytesSent > 0)
+            ringBufferSendTime(consumer, millis() - startMillis);
 
-        // Don't fill the last byte to prevent buffer overflow
-        if (freeSpace)
-            freeSpace -= 1;
-        availableHandlerSpace = freeSpace;
+        if (settings.enableTaskReports == true)
+            systemPrintf("%s handleGnssDataTask High watermark: %d\r\n", consumer->name,
+                         uxTaskGetStackHighWaterMark(nullptr));
+
+        // Retry soon when the consumer is busy, otherwise wait for more data.
+        // The timeout handles consumers that connect while the ring buffer
+        // is idle.
+        if (ringBufferUsed(&gnssRingBuffer, consumer))
+            delay(1);
+        else
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    }
+}
 
-        //----------------------------------------------------------------------
-        // Display the millisecond values for the different ring buffer consumers
-        //----------------------------------------------------------------------
+// Display the send times for the different ring buffer consumers
+void tasksDisplaySendTimes()
+{
+    RING_BUFFER_CONSUMER *consumer;
+    int index;
+    int milliseconds;
+    int seconds;
 
-        if (PERIODIC_DISPLAY(PD_RING_BUFFER_MILLIS))
+    if (PERIODIC_DISPLAY(PD_RING_BUFFER_MILLIS))
+    {
+        PERIODIC_CLEAR(PD_RING_BUFFER_MILLIS);
+        for (index = 0; index < gnssRingBuffer.consumers; index++)
         {
-            int milliseconds;
-            int seconds;
-
-            PERIODIC_CLEAR(PD_RING_BUFFER_MILLIS);
-            for (int index = 0; index < RBC_MAX; index++)
+            consumer = gnssRingBuffer.consumer[index];
+            milliseconds = consumer->maxMillis;
+            if (milliseconds > 1)
             {
-                milliseconds = maxMillis[index];
-                if (milliseconds > 1)
-                {
-                    seconds = milliseconds / MILLISECONDS_IN_A_SECOND;
-                    milliseconds %= MILLISECONDS_IN_A_SECOND;
-                    systemPrintf("%s: %d:%03d Sec\r\n", ringBufferConsumer[index], seconds, milliseconds);
-                }
+                seconds = milliseconds / MILLISECONDS_IN_A_SECOND;
+                milliseconds %= MILLISECONDS_IN_A_SECOND;
+                systemPrintf("%s: %d:%03d Sec max, p99 < %d mSec\r\n", consumer->name, seconds, milliseconds,
+                             ringBufferSendTimePercentile(consumer, 99));
             }
         }
+    }
+}
 
-        //----------------------------------------------------------------------
-        // Let other tasks run, prevent watch dog timer (WDT) resets
-        //----------------------------------------------------------------------
+// Add a consumer to the GNSS ring buffer
+void tasksRegisterConsumer(RING_BUFFER_CONSUMER *consumer)
+{
+    if (!ringBufferRegister(&gnssRingBuffer, consumer))
+        reportFatalError("Please increase RING_BUFFER_MAX_CONSUMERS");
+}
 
-        delay(1);
-        taskYIELD();
-    }
+// Register the consumers of the GNSS ring buffer, called once the ring buffer
+// is allocated.  A new output only needs a connected and send routine and a
+// registration call here.
+void tasksRegisterConsumers()
+{
+    tasksRegisterConsumer(&btConsumer);
+    pvtClientRegisterConsumer();
+    pvtServerRegisterConsumers();
+    tasksRegisterConsumer(&sdConsumer);
+    pvtUdpServerRegisterConsumer();
 }
 
 // Control BT status LED according to bluetoothGetState()
@@ -1711,7 +1606,7 @@ void idleTask(void *e)
 bool tasksStartUART2()
 {
     // Verify that the ring buffer was successfully allocated
-    if (!ringBuffer)
+    if (!gnssRingBuffer.data)
     {
         systemPrintln("ERROR: Ring buffer allocation failure!");
         systemPrintln("Decrease GNSS handler (ring) buffer size");
@@ -1719,8 +1614,6 @@ bool tasksStartUART2()
         return false;
     }
 
-    availableHandlerSpace = settings.gnssHandlerBufferSize;
-
     // Reads data from ZED and stores data into circular buffer
     if (gnssReadTaskHandle == nullptr)
         xTaskCreatePinnedToCore(gnssReadTask,                  // Function to call
@@ -1732,14 +1625,22 @@ bool tasksStartUART2()
                                 settings.gnssReadTaskCore);    // Core where task should run, 0=core, 1=Arduino
 
     // Reads data from circular buffer and sends data to SD, SPP, or network clients
-    if (handleGnssDataTaskHandle == nullptr)
-        xTaskCreatePinnedToCore(handleGnssDataTask,                  // Function to call
-                                "handleGNSSData",                    // Just for humans
-                                handleGnssDataTaskStackSize,         // Stack Size
-                                nullptr,                             // Task input parameter
-                                settings.handleGnssDataTaskPriority, // Priority
-                                &handleGnssDataTaskHandle,           // Task handle
-                                settings.handleGnssDataTaskCore);    // Core where task should run, 0=core, 1=Arduino
+    for (int index = 0; index < gnssRingBuffer.consumers; index++)
+    {
+        RING_BUFFER_CONSUMER *consumer = gnssRingBuffer.consumer[index];
+        uint8_t priority = consumer->taskPriority ? *consumer->taskPriority : settings.handleGnssDataTaskPriority;
+        uint8_t core = consumer->taskCore ? *consumer->taskCore : settings.handleGnssDataTaskCore;
+        int stackSize = consumer->taskStackSize ? consumer->taskStackSize : handleGnssDataTaskStackSize;
+
+        if (consumer->task == nullptr)
+            xTaskCreatePinnedToCore(handleGnssDataTask,              // Function to call
+                                    consumer->name,                  // Just for humans
+                                    stackSize,                       // Stack Size
+                                    consumer,                        // Task input parameter
+                                    priority,                        // Priority
+                                    (TaskHandle_t *)&consumer->task, // Task handle
+                                    core);                           // Core where task should run, 0=core, 1=Arduino
+    }
 
     // Reads data from BT and sends to ZED
     if (btReadTaskHandle == nullptr)
@@ -1762,10 +1663,14 @@ void tasksStopUART2()
         vTaskDelete(gnssReadTaskHandle);
         gnssReadTaskHandle = nullptr;
     }
-    if (handleGnssDataTaskHandle != nullptr)
+    for (int index = 0; index < gnssRingBuffer.consumers; index++)
     {
-        vTaskDelete(handleGnssDataTaskHandle);
-        handleGnssDataTaskHandle = nullptr;
+        RING_BUFFER_CONSUMER *consumer = gnssRingBuffer.consumer[index];
+        if (consumer->task != nullptr)
+        {
+            vTaskDelete((TaskHandle_t)consumer->task);
+            consumer->task = nullptr;
+        }
     }
     if (btReadTaskHandle != nullptr)
     {
@@ -1779,10 +1684,17 @@ void tasksStopUART2()
 }
 
 // Checking the number of available clusters on the SD card can take multiple seconds
-// Rather than blocking the system, we run a background task
+// Rather than blocking the system, we run a background task which scans the FAT in
+// slices, see SdFreeSpace.ino
 // Once the size check is complete, the task is removed
 void sdSizeCheckTask(void *e)
 {
+    bool mounted;
+    bool scanComplete;
+    bool scanning;
+
+    mounted = false;
+    scanning = false;
     while (true)
     {
         // Display an alive message
@@ -1792,47 +1704,69 @@ void sdSizeCheckTask(void *e)
             systemPrintln("sdSizeCheckTask running");
         }
 
-        if (online.microSD && sdCardSize == 0)
+        if (online.microSD && (sdSizeCheckTaskComplete == false))
         {
             // Attempt to gain access to the SD card
             if (xSemaphoreTake(sdCardSemaphore, fatSemaphore_longWait_ms) == pdPASS)
             {
                 markSemaphore(FUNCTION_SDSIZECHECK);
 
-                if (USE_SPI_MICROSD)
+                // Start the scan when the card is mounted or a rescan is requested
+                if ((sdCardSize == 0) || (scanning == false))
                 {
-                    csd_t csd;
-                    sd->card()->readCSD(&csd); // Card Specific Data
-                    sdCardSize = (uint64_t)512 * sd->card()->sectorCount();
+                    // Only initialize the volume on the first mount, the log
+                    // file may be open and written during a rescan
+                    mounted = (sdCardSize == 0);
+                    if (mounted)
+                    {
+                        if (USE_SPI_MICROSD)
+                        {
+                            csd_t csd;
+                            sd->card()->readCSD(&csd); // Card Specific Data
+                            sdCardSize = (uint64_t)512 * sd->card()->sectorCount();
 
-                    sd->volumeBegin();
+                            sd->volumeBegin();
+                        }
+#ifdef COMPILE_SD_MMC
+                        else
+                            sdCardSize = SD_MMC.cardSize();
+#endif // COMPILE_SD_MMC
+                    }
 
-                    // Find available cluster/space
-                    sdFreeSpace = sd->vol()->freeClusterCount(); // This takes a few seconds to complete
-                    sdFreeSpace *= sd->vol()->sectorsPerCluster();
-                    sdFreeSpace *= 512L; // Bytes per sector
+                    scanComplete = sdFreeSpaceScanStart();
+                    scanning = true;
                 }
-#ifdef COMPILE_SD_MMC
                 else
-                {
-                    sdCardSize = SD_MMC.cardSize();
-                    sdFreeSpace = SD_MMC.totalBytes() - SD_MMC.usedBytes();
-                }
-#endif // COMPILE_SD_MMC
+                    scanComplete = sdFreeSpaceScan(); // Read the next slice of the FAT
+
+                if (scanComplete)
+                    sdFreeSpaceScanEnd();
 
                 xSemaphoreGive(sdCardSemaphore);
 
-                // uint64_t sdUsedSpace = sdCardSize - sdFreeSpace; //Don't think of it as used, think of it as unusable
+                // Start logging once the free space found so far is sufficient
+                if (mounted && (sdFreeSpace >= sdMinAvailableSpace))
+                {
+                    outOfSDSpace = false;
+                    mounted = false;
+                }
+
+                if (scanComplete)
+                {
+                    // uint64_t sdUsedSpace = sdCardSize - sdFreeSpace; //Don't think of it as used, think of it as unusable
 
-                String cardSize;
-                stringHumanReadableSize(cardSize, sdCardSize);
-                String freeSpace;
-                stringHumanReadableSize(freeSpace, sdFreeSpace);
-                systemPrintf("SD card size: %s / Free space: %s\r\n", cardSize, freeSpace);
+                    String cardSize;
+                    stringHumanReadableSize(cardSize, sdCardSize);
+                    String freeSpace;
+                    stringHumanReadableSize(freeSpace, sdFreeSpace);
+                    systemPrintf("SD card size: %s / Free space: %s\r\n", cardSize, freeSpace);
 
-                outOfSDSpace = false;
+                    if (mounted)
+                        outOfSDSpace = false;
 
-                sdSizeCheckTaskComplete = true;
+                    scanning = false;
+                    sdSizeCheckTaskComplete = true;
+                }
             }
             else
             {
@@ -1846,10 +1780,3 @@ void sdSizeCheckTask(void *e)
         taskYIELD(); // Let other tasks run
     }
 }
-
-// Validate the task table lengths
-void tasksValidateTables()
-{
-    if (ringBufferConsumerEntries != RBC_MAX)
-        reportFatalError("Fix ringBufferConsumer table to match RingBufferConsumers");
-}
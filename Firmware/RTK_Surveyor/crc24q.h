@@ -29,6 +29,11 @@
 
 //This file is originally from: https://gitlab.com/gpsd/gpsd/-/blob/master/gpsd/crc24q.c
 
+#ifndef __CRC24Q_H__
+#define __CRC24Q_H__
+
+#include <stdint.h>
+
 static const int unsigned crc24q[256] = {
   0x00000000u, 0x01864CFBu, 0x028AD50Du, 0x030C99F6u,
   0x0493E6E1u, 0x0515AA1Au, 0x061933ECu, 0x079F7F17u,
@@ -96,4 +101,545 @@ static const int unsigned crc24q[256] = {
   0xFCD11CCEu, 0xFD575035u, 0xFE5BC9C3u, 0xFFDD8538u,
 };
 
+/*
+   Slice-by-8 tables, crc24qSlice[n - 1][x] is the CRC-24Q of the byte x
+   followed by n zero bytes, masked to 24 bits:
+
+      crc24qSlice[0][x] = ((crc24q[x] << 8) ^ crc24q[(crc24q[x] >> 16) & 0xff]) & 0xffffff
+      crc24qSlice[n][x] = ((crc24qSlice[n - 1][x] << 8)
+                        ^ crc24q[crc24qSlice[n - 1][x] >> 16]) & 0xffffff
+
+   Eight data bytes are then folded into the CRC with eight table lookups
+   instead of eight dependent shift and lookup steps.
+*/
+
+static const uint32_t crc24qSlice[7][256] = {
+  {
+    0x00000000u, 0x00668F48u, 0x00CD1E90u, 0x00AB91D8u,
+    0x001C71DBu, 0x007AFE93u, 0x00D16F4Bu, 0x00B7E003u,
+    0x0038E3B6u, 0x005E6CFEu, 0x00F5FD26u, 0x0093726Eu,
+    0x0024926Du, 0x00421D25u, 0x00E98CFDu, 0x008F03B5u,
+    0x0071C76Cu, 0x00174824u, 0x00BCD9FCu, 0x00DA56B4u,
+    0x006DB6B7u, 0x000B39FFu, 0x00A0A827u, 0x00C6276Fu,
+    0x004924DAu, 0x002FAB92u, 0x00843A4Au, 0x00E2B502u,
+    0x00555501u, 0x0033DA49u, 0x00984B91u, 0x00FEC4D9u,
+    0x00E38ED8u, 0x00850190u, 0x002E9048u, 0x00481F00u,
+    0x00FFFF03u, 0x0099704Bu, 0x0032E193u, 0x00546EDBu,
+    0x00DB6D6Eu, 0x00BDE226u, 0x001673FEu, 0x0070FCB6u,
+    0x00C71CB5u, 0x00A193FDu, 0x000A0225u, 0x006C8D6Du,
+    0x009249B4u, 0x00F4C6FCu, 0x005F5724u, 0x0039D86Cu,
+    0x008E386Fu, 0x00E8B727u, 0x004326FFu, 0x0025A9B7u,
+    0x00AAAA02u, 0x00CC254Au, 0x0067B492u, 0x00013BDAu,
+    0x00B6DBD9u, 0x00D05491u, 0x007BC549u, 0x001D4A01u,
+    0x0041514Bu, 0x0027DE03u, 0x008C4FDBu, 0x00EAC093u,
+    0x005D2090u, 0x003BAFD8u, 0x00903E00u, 0x00F6B148u,
+    0x0079B2FDu, 0x001F3DB5u, 0x00B4AC6Du, 0x00D22325u,
+    0x0065C326u, 0x00034C6Eu, 0x00A8DDB6u, 0x00CE52FEu,
+    0x00309627u, 0x0056196Fu, 0x00FD88B7u, 0x009B07FFu,
+    0x002CE7FCu, 0x004A68B4u, 0x00E1F96Cu, 0x00877624u,
+    0x00087591u, 0x006EFAD9u, 0x00C56B01u, 0x00A3E449u,
+    0x0014044Au, 0x00728B02u, 0x00D91ADAu, 0x00BF9592u,
+    0x00A2DF93u, 0x00C450DBu, 0x006FC103u, 0x00094E4Bu,
+    0x00BEAE48u, 0x00D82100u, 0x0073B0D8u, 0x00153F90u,
+    0x009A3C25u, 0x00FCB36Du, 0x005722B5u, 0x0031ADFDu,
+    0x00864DFEu, 0x00E0C2B6u, 0x004B536Eu, 0x002DDC26u,
+    0x00D318FFu, 0x00B597B7u, 0x001E066Fu, 0x00788927u,
+    0x00CF6924u, 0x00A9E66Cu, 0x000277B4u, 0x0064F8FCu,
+    0x00EBFB49u, 0x008D7401u, 0x0026E5D9u, 0x00406A91u,
+    0x00F78A92u, 0x009105DAu, 0x003A9402u, 0x005C1B4Au,
+    0x0082A296u, 0x00E42DDEu, 0x004FBC06u, 0x0029334Eu,
+    0x009ED34Du, 0x00F85C05u, 0x0053CDDDu, 0x00354295u,
+    0x00BA4120u, 0x00DCCE68u, 0x00775FB0u, 0x0011D0F8u,
+    0x00A630FBu, 0x00C0BFB3u, 0x006B2E6Bu, 0x000DA123u,
+    0x00F365FAu, 0x0095EAB2u, 0x003E7B6Au, 0x0058F422u,
+    0x00EF1421u, 0x00899B69u, 0x00220AB1u, 0x004485F9u,
+    0x00CB864Cu, 0x00AD0904u, 0x000698DCu, 0x00601794u,
+    0x00D7F797u, 0x00B178DFu, 0x001AE907u, 0x007C664Fu,
+    0x00612C4Eu, 0x0007A306u, 0x00AC32DEu, 0x00CABD96u,
+    0x007D5D95u, 0x001BD2DDu, 0x00B04305u, 0x00D6CC4Du,
+    0x0059CFF8u, 0x003F40B0u, 0x0094D168u, 0x00F25E20u,
+    0x0045BE23u, 0x0023316Bu, 0x0088A0B3u, 0x00EE2FFBu,
+    0x0010EB22u, 0x0076646Au, 0x00DDF5B2u, 0x00BB7AFAu,
+    0x000C9AF9u, 0x006A15B1u, 0x00C18469u, 0x00A70B21u,
+    0x00280894u, 0x004E87DCu, 0x00E51604u, 0x0083994Cu,
+    0x0034794Fu, 0x0052F607u, 0x00F967DFu, 0x009FE897u,
+    0x00C3F3DDu, 0x00A57C95u, 0x000EED4Du, 0x00686205u,
+    0x00DF8206u, 0x00B90D4Eu, 0x00129C96u, 0x007413DEu,
+    0x00FB106Bu, 0x009D9F23u, 0x00360EFBu, 0x005081B3u,
+    0x00E761B0u, 0x0081EEF8u, 0x002A7F20u, 0x004CF068u,
+    0x00B234B1u, 0x00D4BBF9u, 0x007F2A21u, 0x0019A569u,
+    0x00AE456Au, 0x00C8CA22u, 0x00635BFAu, 0x0005D4B2u,
+    0x008AD707u, 0x00EC584Fu, 0x0047C997u, 0x002146DFu,
+    0x0096A6DCu, 0x00F02994u, 0x005BB84Cu, 0x003D3704u,
+    0x00207D05u, 0x0046F24Du, 0x00ED6395u, 0x008BECDDu,
+    0x003C0CDEu, 0x005A8396u, 0x00F1124Eu, 0x00979D06u,
+    0x00189EB3u, 0x007E11FBu, 0x00D58023u, 0x00B30F6Bu,
+    0x0004EF68u, 0x00626020u, 0x00C9F1F8u, 0x00AF7EB0u,
+    0x0051BA69u, 0x00373521u, 0x009CA4F9u, 0x00FA2BB1u,
+    0x004DCBB2u, 0x002B44FAu, 0x0080D522u, 0x00E65A6Au,
+    0x006959DFu, 0x000FD697u, 0x00A4474Fu, 0x00C2C807u,
+    0x00752804u, 0x0013A74Cu, 0x00B83694u, 0x00DEB9DCu,
+  },
+  {
+    0x00000000u, 0x008309D7u, 0x00805F55u, 0x00035682u,
+    0x0086F251u, 0x0005FB86u, 0x0006AD04u, 0x0085A4D3u,
+    0x008BA859u, 0x0008A18Eu, 0x000BF70Cu, 0x0088FEDBu,
+    0x000D5A08u, 0x008E53DFu, 0x008D055Du, 0x000E0C8Au,
+    0x00911C49u, 0x0012159Eu, 0x0011431Cu, 0x00924ACBu,
+    0x0017EE18u, 0x0094E7CFu, 0x0097B14Du, 0x0014B89Au,
+    0x001AB410u, 0x0099BDC7u, 0x009AEB45u, 0x0019E292u,
+    0x009C4641u, 0x001F4F96u, 0x001C1914u, 0x009F10C3u,
+    0x00A47469u, 0x00277DBEu, 0x00242B3Cu, 0x00A722EBu,
+    0x00228638u, 0x00A18FEFu, 0x00A2D96Du, 0x0021D0BAu,
+    0x002FDC30u, 0x00ACD5E7u, 0x00AF8365u, 0x002C8AB2u,
+    0x00A92E61u, 0x002A27B6u, 0x00297134u, 0x00AA78E3u,
+    0x00356820u, 0x00B661F7u, 0x00B53775u, 0x00363EA2u,
+    0x00B39A71u, 0x003093A6u, 0x0033C524u, 0x00B0CCF3u,
+    0x00BEC079u, 0x003DC9AEu, 0x003E9F2Cu, 0x00BD96FBu,
+    0x00383228u, 0x00BB3BFFu, 0x00B86D7Du, 0x003B64AAu,
+    0x00CEA429u, 0x004DADFEu, 0x004EFB7Cu, 0x00CDF2ABu,
+    0x00485678u, 0x00CB5FAFu, 0x00C8092Du, 0x004B00FAu,
+    0x00450C70u, 0x00C605A7u, 0x00C55325u, 0x00465AF2u,
+    0x00C3FE21u, 0x0040F7F6u, 0x0043A174u, 0x00C0A8A3u,
+    0x005FB860u, 0x00DCB1B7u, 0x00DFE735u, 0x005CEEE2u,
+    0x00D94A31u, 0x005A43E6u, 0x00591564u, 0x00DA1CB3u,
+    0x00D41039u, 0x005719EEu, 0x00544F6Cu, 0x00D746BBu,
+    0x0052E268u, 0x00D1EBBFu, 0x00D2BD3Du, 0x0051B4EAu,
+    0x006AD040u, 0x00E9D997u, 0x00EA8F15u, 0x006986C2u,
+    0x00EC2211u, 0x006F2BC6u, 0x006C7D44u, 0x00EF7493u,
+    0x00E17819u, 0x006271CEu, 0x0061274Cu, 0x00E22E9Bu,
+    0x00678A48u, 0x00E4839Fu, 0x00E7D51Du, 0x0064DCCAu,
+    0x00FBCC09u, 0x0078C5DEu, 0x007B935Cu, 0x00F89A8Bu,
+    0x007D3E58u, 0x00FE378Fu, 0x00FD610Du, 0x007E68DAu,
+    0x00706450u, 0x00F36D87u, 0x00F03B05u, 0x007332D2u,
+    0x00F69601u, 0x00759FD6u, 0x0076C954u, 0x00F5C083u,
+    0x001B04A9u, 0x00980D7Eu, 0x009B5BFCu, 0x0018522Bu,
+    0x009DF6F8u, 0x001EFF2Fu, 0x001DA9ADu, 0x009EA07Au,
+    0x0090ACF0u, 0x0013A527u, 0x0010F3A5u, 0x0093FA72u,
+    0x00165EA1u, 0x00955776u, 0x009601F4u, 0x00150823u,
+    0x008A18E0u, 0x00091137u, 0x000A47B5u, 0x00894E62u,
+    0x000CEAB1u, 0x008FE366u, 0x008CB5E4u, 0x000FBC33u,
+    0x0001B0B9u, 0x0082B96Eu, 0x0081EFECu, 0x0002E63Bu,
+    0x008742E8u, 0x00044B3Fu, 0x00071DBDu, 0x0084146Au,
+    0x00BF70C0u, 0x003C7917u, 0x003F2F95u, 0x00BC2642u,
+    0x00398291u, 0x00BA8B46u, 0x00B9DDC4u, 0x003AD413u,
+    0x0034D899u, 0x00B7D14Eu, 0x00B487CCu, 0x00378E1Bu,
+    0x00B22AC8u, 0x0031231Fu, 0x0032759Du, 0x00B17C4Au,
+    0x002E6C89u, 0x00AD655Eu, 0x00AE33DCu, 0x002D3A0Bu,
+    0x00A89ED8u, 0x002B970Fu, 0x0028C18Du, 0x00ABC85Au,
+    0x00A5C4D0u, 0x0026CD07u, 0x00259B85u, 0x00A69252u,
+    0x00233681u, 0x00A03F56u, 0x00A369D4u, 0x00206003u,
+    0x00D5A080u, 0x0056A957u, 0x0055FFD5u, 0x00D6F602u,
+    0x005352D1u, 0x00D05B06u, 0x00D30D84u, 0x00500453u,
+    0x005E08D9u, 0x00DD010Eu, 0x00DE578Cu, 0x005D5E5Bu,
+    0x00D8FA88u, 0x005BF35Fu, 0x0058A5DDu, 0x00DBAC0Au,
+    0x0044BCC9u, 0x00C7B51Eu, 0x00C4E39Cu, 0x0047EA4Bu,
+    0x00C24E98u, 0x0041474Fu, 0x004211CDu, 0x00C1181Au,
+    0x00CF1490u, 0x004C1D47u, 0x004F4BC5u, 0x00CC4212u,
+    0x0049E6C1u, 0x00CAEF16u, 0x00C9B994u, 0x004AB043u,
+    0x0071D4E9u, 0x00F2DD3Eu, 0x00F18BBCu, 0x0072826Bu,
+    0x00F726B8u, 0x00742F6Fu, 0x007779EDu, 0x00F4703Au,
+    0x00FA7CB0u, 0x00797567u, 0x007A23E5u, 0x00F92A32u,
+    0x007C8EE1u, 0x00FF8736u, 0x00FCD1B4u, 0x007FD863u,
+    0x00E0C8A0u, 0x0063C177u, 0x006097F5u, 0x00E39E22u,
+    0x00663AF1u, 0x00E53326u, 0x00E665A4u, 0x00656C73u,
+    0x006B60F9u, 0x00E8692Eu, 0x00EB3FACu, 0x0068367Bu,
+    0x00ED92A8u, 0x006E9B7Fu, 0x006DCDFDu, 0x00EEC42Au,
+  },
+  {
+    0x00000000u, 0x00360952u, 0x006C12A4u, 0x005A1BF6u,
+    0x00D82548u, 0x00EE2C1Au, 0x00B437ECu, 0x00823EBEu,
+    0x0036066Bu, 0x00000F39u, 0x005A14CFu, 0x006C1D9Du,
+    0x00EE2323u, 0x00D82A71u, 0x00823187u, 0x00B438D5u,
+    0x006C0CD6u, 0x005A0584u, 0x00001E72u, 0x00361720u,
+    0x00B4299Eu, 0x008220CCu, 0x00D83B3Au, 0x00EE3268u,
+    0x005A0ABDu, 0x006C03EFu, 0x00361819u, 0x0000114Bu,
+    0x00822FF5u, 0x00B426A7u, 0x00EE3D51u, 0x00D83403u,
+    0x00D819ACu, 0x00EE10FEu, 0x00B40B08u, 0x0082025Au,
+    0x00003CE4u, 0x003635B6u, 0x006C2E40u, 0x005A2712u,
+    0x00EE1FC7u, 0x00D81695u, 0x00820D63u, 0x00B40431u,
+    0x00363A8Fu, 0x000033DDu, 0x005A282Bu, 0x006C2179u,
+    0x00B4157Au, 0x00821C28u, 0x00D807DEu, 0x00EE0E8Cu,
+    0x006C3032u, 0x005A3960u, 0x00002296u, 0x00362BC4u,
+    0x00821311u, 0x00B41A43u, 0x00EE01B5u, 0x00D808E7u,
+    0x005A3659u, 0x006C3F0Bu, 0x003624FDu, 0x00002DAFu,
+    0x00367FA3u, 0x000076F1u, 0x005A6D07u, 0x006C6455u,
+    0x00EE5AEBu, 0x00D853B9u, 0x0082484Fu, 0x00B4411Du,
+    0x000079C8u, 0x0036709Au, 0x006C6B6Cu, 0x005A623Eu,
+    0x00D85C80u, 0x00EE55D2u, 0x00B44E24u, 0x00824776u,
+    0x005A7375u, 0x006C7A27u, 0x003661D1u, 0x00006883u,
+    0x0082563Du, 0x00B45F6Fu, 0x00EE4499u, 0x00D84DCBu,
+    0x006C751Eu, 0x005A7C4Cu, 0x000067BAu, 0x00366EE8u,
+    0x00B45056u, 0x00825904u, 0x00D842F2u, 0x00EE4BA0u,
+    0x00EE660Fu, 0x00D86F5Du, 0x008274ABu, 0x00B47DF9u,
+    0x00364347u, 0x00004A15u, 0x005A51E3u, 0x006C58B1u,
+    0x00D86064u, 0x00EE6936u, 0x00B472C0u, 0x00827B92u,
+    0x0000452Cu, 0x00364C7Eu, 0x006C5788u, 0x005A5EDAu,
+    0x00826AD9u, 0x00B4638Bu, 0x00EE787Du, 0x00D8712Fu,
+    0x005A4F91u, 0x006C46C3u, 0x00365D35u, 0x00005467u,
+    0x00B46CB2u, 0x008265E0u, 0x00D87E16u, 0x00EE7744u,
+    0x006C49FAu, 0x005A40A8u, 0x00005B5Eu, 0x0036520Cu,
+    0x006CFF46u, 0x005AF614u, 0x0000EDE2u, 0x0036E4B0u,
+    0x00B4DA0Eu, 0x0082D35Cu, 0x00D8C8AAu, 0x00EEC1F8u,
+    0x005AF92Du, 0x006CF07Fu, 0x0036EB89u, 0x0000E2DBu,
+    0x0082DC65u, 0x00B4D537u, 0x00EECEC1u, 0x00D8C793u,
+    0x0000F390u, 0x0036FAC2u, 0x006CE134u, 0x005AE866u,
+    0x00D8D6D8u, 0x00EEDF8Au, 0x00B4C47Cu, 0x0082CD2Eu,
+    0x0036F5FBu, 0x0000FCA9u, 0x005AE75Fu, 0x006CEE0Du,
+    0x00EED0B3u, 0x00D8D9E1u, 0x0082C217u, 0x00B4CB45u,
+    0x00B4E6EAu, 0x0082EFB8u, 0x00D8F44Eu, 0x00EEFD1Cu,
+    0x006CC3A2u, 0x005ACAF0u, 0x0000D106u, 0x0036D854u,
+    0x0082E081u, 0x00B4E9D3u, 0x00EEF225u, 0x00D8FB77u,
+    0x005AC5C9u, 0x006CCC9Bu, 0x0036D76Du, 0x0000DE3Fu,
+    0x00D8EA3Cu, 0x00EEE36Eu, 0x00B4F898u, 0x0082F1CAu,
+    0x0000CF74u, 0x0036C626u, 0x006CDDD0u, 0x005AD482u,
+    0x00EEEC57u, 0x00D8E505u, 0x0082FEF3u, 0x00B4F7A1u,
+    0x0036C91Fu, 0x0000C04Du, 0x005ADBBBu, 0x006CD2E9u,
+    0x005A80E5u, 0x006C89B7u, 0x00369241u, 0x00009B13u,
+    0x0082A5ADu, 0x00B4ACFFu, 0x00EEB709u, 0x00D8BE5Bu,
+    0x006C868Eu, 0x005A8FDCu, 0x0000942Au, 0x00369D78u,
+    0x00B4A3C6u, 0x0082AA94u, 0x00D8B162u, 0x00EEB830u,
+    0x00368C33u, 0x00008561u, 0x005A9E97u, 0x006C97C5u,
+    0x00EEA97Bu, 0x00D8A029u, 0x0082BBDFu, 0x00B4B28Du,
+    0x00008A58u, 0x0036830Au, 0x006C98FCu, 0x005A91AEu,
+    0x00D8AF10u, 0x00EEA642u, 0x00B4BDB4u, 0x0082B4E6u,
+    0x00829949u, 0x00B4901Bu, 0x00EE8BEDu, 0x00D882BFu,
+    0x005ABC01u, 0x006CB553u, 0x0036AEA5u, 0x0000A7F7u,
+    0x00B49F22u, 0x00829670u, 0x00D88D86u, 0x00EE84D4u,
+    0x006CBA6Au, 0x005AB338u, 0x0000A8CEu, 0x0036A19Cu,
+    0x00EE959Fu, 0x00D89CCDu, 0x0082873Bu, 0x00B48E69u,
+    0x0036B0D7u, 0x0000B985u, 0x005AA273u, 0x006CAB21u,
+    0x00D893F4u, 0x00EE9AA6u, 0x00B48150u, 0x00828802u,
+    0x0000B6BCu, 0x0036BFEEu, 0x006CA418u, 0x005AAD4Au,
+  },
+  {
+    0x00000000u, 0x00D9FE8Cu, 0x0035B1E3u, 0x00EC4F6Fu,
+    0x006B63C6u, 0x00B29D4Au, 0x005ED225u, 0x00872CA9u,
+    0x00D6C78Cu, 0x000F3900u, 0x00E3766Fu, 0x003A88E3u,
+    0x00BDA44Au, 0x00645AC6u, 0x008815A9u, 0x0051EB25u,
+    0x002BC3E3u, 0x00F23D6Fu, 0x001E7200u, 0x00C78C8Cu,
+    0x0040A025u, 0x00995EA9u, 0x007511C6u, 0x00ACEF4Au,
+    0x00FD046Fu, 0x0024FAE3u, 0x00C8B58Cu, 0x00114B00u,
+    0x009667A9u, 0x004F9925u, 0x00A3D64Au, 0x007A28C6u,
+    0x005787C6u, 0x008E794Au, 0x00623625u, 0x00BBC8A9u,
+    0x003CE400u, 0x00E51A8Cu, 0x000955E3u, 0x00D0AB6Fu,
+    0x0081404Au, 0x0058BEC6u, 0x00B4F1A9u, 0x006D0F25u,
+    0x00EA238Cu, 0x0033DD00u, 0x00DF926Fu, 0x00066CE3u,
+    0x007C4425u, 0x00A5BAA9u, 0x0049F5C6u, 0x00900B4Au,
+    0x001727E3u, 0x00CED96Fu, 0x00229600u, 0x00FB688Cu,
+    0x00AA83A9u, 0x00737D25u, 0x009F324Au, 0x0046CCC6u,
+    0x00C1E06Fu, 0x00181EE3u, 0x00F4518Cu, 0x002DAF00u,
+    0x00AF0F8Cu, 0x0076F100u, 0x009ABE6Fu, 0x004340E3u,
+    0x00C46C4Au, 0x001D92C6u, 0x00F1DDA9u, 0x00282325u,
+    0x0079C800u, 0x00A0368Cu, 0x004C79E3u, 0x0095876Fu,
+    0x0012ABC6u, 0x00CB554Au, 0x00271A25u, 0x00FEE4A9u,
+    0x0084CC6Fu, 0x005D32E3u, 0x00B17D8Cu, 0x00688300u,
+    0x00EFAFA9u, 0x00365125u, 0x00DA1E4Au, 0x0003E0C6u,
+    0x00520BE3u, 0x008BF56Fu, 0x0067BA00u, 0x00BE448Cu,
+    0x00396825u, 0x00E096A9u, 0x000CD9C6u, 0x00D5274Au,
+    0x00F8884Au, 0x002176C6u, 0x00CD39A9u, 0x0014C725u,
+    0x0093EB8Cu, 0x004A1500u, 0x00A65A6Fu, 0x007FA4E3u,
+    0x002E4FC6u, 0x00F7B14Au, 0x001BFE25u, 0x00C200A9u,
+    0x00452C00u, 0x009CD28Cu, 0x00709DE3u, 0x00A9636Fu,
+    0x00D34BA9u, 0x000AB525u, 0x00E6FA4Au, 0x003F04C6u,
+    0x00B8286Fu, 0x0061D6E3u, 0x008D998Cu, 0x00546700u,
+    0x00058C25u, 0x00DC72A9u, 0x00303DC6u, 0x00E9C34Au,
+    0x006EEFE3u, 0x00B7116Fu, 0x005B5E00u, 0x0082A08Cu,
+    0x00D853E3u, 0x0001AD6Fu, 0x00EDE200u, 0x00341C8Cu,
+    0x00B33025u, 0x006ACEA9u, 0x008681C6u, 0x005F7F4Au,
+    0x000E946Fu, 0x00D76AE3u, 0x003B258Cu, 0x00E2DB00u,
+    0x0065F7A9u, 0x00BC0925u, 0x0050464Au, 0x0089B8C6u,
+    0x00F39000u, 0x002A6E8Cu, 0x00C621E3u, 0x001FDF6Fu,
+    0x0098F3C6u, 0x00410D4Au, 0x00AD4225u, 0x0074BCA9u,
+    0x0025578Cu, 0x00FCA900u, 0x0010E66Fu, 0x00C918E3u,
+    0x004E344Au, 0x0097CAC6u, 0x007B85A9u, 0x00A27B25u,
+    0x008FD425u, 0x00562AA9u, 0x00BA65C6u, 0x00639B4Au,
+    0x00E4B7E3u, 0x003D496Fu, 0x00D10600u, 0x0008F88Cu,
+    0x005913A9u, 0x0080ED25u, 0x006CA24Au, 0x00B55CC6u,
+    0x0032706Fu, 0x00EB8EE3u, 0x0007C18Cu, 0x00DE3F00u,
+    0x00A417C6u, 0x007DE94Au, 0x0091A625u, 0x004858A9u,
+    0x00CF7400u, 0x00168A8Cu, 0x00FAC5E3u, 0x00233B6Fu,
+    0x0072D04Au, 0x00AB2EC6u, 0x004761A9u, 0x009E9F25u,
+    0x0019B38Cu, 0x00C04D00u, 0x002C026Fu, 0x00F5FCE3u,
+    0x00775C6Fu, 0x00AEA2E3u, 0x0042ED8Cu, 0x009B1300u,
+    0x001C3FA9u, 0x00C5C125u, 0x00298E4Au, 0x00F070C6u,
+    0x00A19BE3u, 0x0078656Fu, 0x00942A00u, 0x004DD48Cu,
+    0x00CAF825u, 0x001306A9u, 0x00FF49C6u, 0x0026B74Au,
+    0x005C9F8Cu, 0x00856100u, 0x00692E6Fu, 0x00B0D0E3u,
+    0x0037FC4Au, 0x00EE02C6u, 0x00024DA9u, 0x00DBB325u,
+    0x008A5800u, 0x0053A68Cu, 0x00BFE9E3u, 0x0066176Fu,
+    0x00E13BC6u, 0x0038C54Au, 0x00D48A25u, 0x000D74A9u,
+    0x0020DBA9u, 0x00F92525u, 0x00156A4Au, 0x00CC94C6u,
+    0x004BB86Fu, 0x009246E3u, 0x007E098Cu, 0x00A7F700u,
+    0x00F61C25u, 0x002FE2A9u, 0x00C3ADC6u, 0x001A534Au,
+    0x009D7FE3u, 0x0044816Fu, 0x00A8CE00u, 0x0071308Cu,
+    0x000B184Au, 0x00D2E6C6u, 0x003EA9A9u, 0x00E75725u,
+    0x00607B8Cu, 0x00B98500u, 0x0055CA6Fu, 0x008C34E3u,
+    0x00DDDFC6u, 0x0004214Au, 0x00E86E25u, 0x003190A9u,
+    0x00B6BC00u, 0x006F428Cu, 0x00830DE3u, 0x005AF36Fu,
+  },
+  {
+    0x00000000u, 0x0036EB3Du, 0x006DD67Au, 0x005B3D47u,
+    0x00DBACF4u, 0x00ED47C9u, 0x00B67A8Eu, 0x008091B3u,
+    0x00311513u, 0x0007FE2Eu, 0x005CC369u, 0x006A2854u,
+    0x00EAB9E7u, 0x00DC52DAu, 0x00876F9Du, 0x00B184A0u,
+    0x00622A26u, 0x0054C11Bu, 0x000FFC5Cu, 0x00391761u,
+    0x00B986D2u, 0x008F6DEFu, 0x00D450A8u, 0x00E2BB95u,
+    0x00533F35u, 0x0065D408u, 0x003EE94Fu, 0x00080272u,
+    0x008893C1u, 0x00BE78FCu, 0x00E545BBu, 0x00D3AE86u,
+    0x00C4544Cu, 0x00F2BF71u, 0x00A98236u, 0x009F690Bu,
+    0x001FF8B8u, 0x00291385u, 0x00722EC2u, 0x0044C5FFu,
+    0x00F5415Fu, 0x00C3AA62u, 0x00989725u, 0x00AE7C18u,
+    0x002EEDABu, 0x00180696u, 0x00433BD1u, 0x0075D0ECu,
+    0x00A67E6Au, 0x00909557u, 0x00CBA810u, 0x00FD432Du,
+    0x007DD29Eu, 0x004B39A3u, 0x001004E4u, 0x0026EFD9u,
+    0x00976B79u, 0x00A18044u, 0x00FABD03u, 0x00CC563Eu,
+    0x004CC78Du, 0x007A2CB0u, 0x002111F7u, 0x0017FACAu,
+    0x000EE463u, 0x00380F5Eu, 0x00633219u, 0x0055D924u,
+    0x00D54897u, 0x00E3A3AAu, 0x00B89EEDu, 0x008E75D0u,
+    0x003FF170u, 0x00091A4Du, 0x0052270Au, 0x0064CC37u,
+    0x00E45D84u, 0x00D2B6B9u, 0x00898BFEu, 0x00BF60C3u,
+    0x006CCE45u, 0x005A2578u, 0x0001183Fu, 0x0037F302u,
+    0x00B762B1u, 0x0081898Cu, 0x00DAB4CBu, 0x00EC5FF6u,
+    0x005DDB56u, 0x006B306Bu, 0x00300D2Cu, 0x0006E611u,
+    0x008677A2u, 0x00B09C9Fu, 0x00EBA1D8u, 0x00DD4AE5u,
+    0x00CAB02Fu, 0x00FC5B12u, 0x00A76655u, 0x00918D68u,
+    0x00111CDBu, 0x0027F7E6u, 0x007CCAA1u, 0x004A219Cu,
+    0x00FBA53Cu, 0x00CD4E01u, 0x00967346u, 0x00A0987Bu,
+    0x002009C8u, 0x0016E2F5u, 0x004DDFB2u, 0x007B348Fu,
+    0x00A89A09u, 0x009E7134u, 0x00C54C73u, 0x00F3A74Eu,
+    0x007336FDu, 0x0045DDC0u, 0x001EE087u, 0x00280BBAu,
+    0x00998F1Au, 0x00AF6427u, 0x00F45960u, 0x00C2B25Du,
+    0x004223EEu, 0x0074C8D3u, 0x002FF594u, 0x00191EA9u,
+    0x001DC8C6u, 0x002B23FBu, 0x00701EBCu, 0x0046F581u,
+    0x00C66432u, 0x00F08F0Fu, 0x00ABB248u, 0x009D5975u,
+    0x002CDDD5u, 0x001A36E8u, 0x00410BAFu, 0x0077E092u,
+    0x00F77121u, 0x00C19A1Cu, 0x009AA75Bu, 0x00AC4C66u,
+    0x007FE2E0u, 0x004909DDu, 0x0012349Au, 0x0024DFA7u,
+    0x00A44E14u, 0x0092A529u, 0x00C9986Eu, 0x00FF7353u,
+    0x004EF7F3u, 0x00781CCEu, 0x00232189u, 0x0015CAB4u,
+    0x00955B07u, 0x00A3B03Au, 0x00F88D7Du, 0x00CE6640u,
+    0x00D99C8Au, 0x00EF77B7u, 0x00B44AF0u, 0x0082A1CDu,
+    0x0002307Eu, 0x0034DB43u, 0x006FE604u, 0x00590D39u,
+    0x00E88999u, 0x00DE62A4u, 0x00855FE3u, 0x00B3B4DEu,
+    0x0033256Du, 0x0005CE50u, 0x005EF317u, 0x0068182Au,
+    0x00BBB6ACu, 0x008D5D91u, 0x00D660D6u, 0x00E08BEBu,
+    0x00601A58u, 0x0056F165u, 0x000DCC22u, 0x003B271Fu,
+    0x008AA3BFu, 0x00BC4882u, 0x00E775C5u, 0x00D19EF8u,
+    0x00510F4Bu, 0x0067E476u, 0x003CD931u, 0x000A320Cu,
+    0x00132CA5u, 0x0025C798u, 0x007EFADFu, 0x004811E2u,
+    0x00C88051u, 0x00FE6B6Cu, 0x00A5562Bu, 0x0093BD16u,
+    0x002239B6u, 0x0014D28Bu, 0x004FEFCCu, 0x007904F1u,
+    0x00F99542u, 0x00CF7E7Fu, 0x00944338u, 0x00A2A805u,
+    0x00710683u, 0x0047EDBEu, 0x001CD0F9u, 0x002A3BC4u,
+    0x00AAAA77u, 0x009C414Au, 0x00C77C0Du, 0x00F19730u,
+    0x00401390u, 0x0076F8ADu, 0x002DC5EAu, 0x001B2ED7u,
+    0x009BBF64u, 0x00AD5459u, 0x00F6691Eu, 0x00C08223u,
+    0x00D778E9u, 0x00E193D4u, 0x00BAAE93u, 0x008C45AEu,
+    0x000CD41Du, 0x003A3F20u, 0x00610267u, 0x0057E95Au,
+    0x00E66DFAu, 0x00D086C7u, 0x008BBB80u, 0x00BD50BDu,
+    0x003DC10Eu, 0x000B2A33u, 0x00501774u, 0x0066FC49u,
+    0x00B552CFu, 0x0083B9F2u, 0x00D884B5u, 0x00EE6F88u,
+    0x006EFE3Bu, 0x00581506u, 0x00032841u, 0x0035C37Cu,
+    0x008447DCu, 0x00B2ACE1u, 0x00E991A6u, 0x00DF7A9Bu,
+    0x005FEB28u, 0x00690015u, 0x00323D52u, 0x0004D66Fu,
+  },
+  {
+    0x00000000u, 0x003B918Cu, 0x00772318u, 0x004CB294u,
+    0x00EE4630u, 0x00D5D7BCu, 0x00996528u, 0x00A2F4A4u,
+    0x005AC09Bu, 0x00615117u, 0x002DE383u, 0x0016720Fu,
+    0x00B486ABu, 0x008F1727u, 0x00C3A5B3u, 0x00F8343Fu,
+    0x00B58136u, 0x008E10BAu, 0x00C2A22Eu, 0x00F933A2u,
+    0x005BC706u, 0x0060568Au, 0x002CE41Eu, 0x00177592u,
+    0x00EF41ADu, 0x00D4D021u, 0x009862B5u, 0x00A3F339u,
+    0x0001079Du, 0x003A9611u, 0x00762485u, 0x004DB509u,
+    0x00ED4E97u, 0x00D6DF1Bu, 0x009A6D8Fu, 0x00A1FC03u,
+    0x000308A7u, 0x0038992Bu, 0x00742BBFu, 0x004FBA33u,
+    0x00B78E0Cu, 0x008C1F80u, 0x00C0AD14u, 0x00FB3C98u,
+    0x0059C83Cu, 0x006259B0u, 0x002EEB24u, 0x00157AA8u,
+    0x0058CFA1u, 0x00635E2Du, 0x002FECB9u, 0x00147D35u,
+    0x00B68991u, 0x008D181Du, 0x00C1AA89u, 0x00FA3B05u,
+    0x00020F3Au, 0x00399EB6u, 0x00752C22u, 0x004EBDAEu,
+    0x00EC490Au, 0x00D7D886u, 0x009B6A12u, 0x00A0FB9Eu,
+    0x005CD1D5u, 0x00674059u, 0x002BF2CDu, 0x00106341u,
+    0x00B297E5u, 0x00890669u, 0x00C5B4FDu, 0x00FE2571u,
+    0x0006114Eu, 0x003D80C2u, 0x00713256u, 0x004AA3DAu,
+    0x00E8577Eu, 0x00D3C6F2u, 0x009F7466u, 0x00A4E5EAu,
+    0x00E950E3u, 0x00D2C16Fu, 0x009E73FBu, 0x00A5E277u,
+    0x000716D3u, 0x003C875Fu, 0x007035CBu, 0x004BA447u,
+    0x00B39078u, 0x008801F4u, 0x00C4B360u, 0x00FF22ECu,
+    0x005DD648u, 0x006647C4u, 0x002AF550u, 0x001164DCu,
+    0x00B19F42u, 0x008A0ECEu, 0x00C6BC5Au, 0x00FD2DD6u,
+    0x005FD972u, 0x006448FEu, 0x0028FA6Au, 0x00136BE6u,
+    0x00EB5FD9u, 0x00D0CE55u, 0x009C7CC1u, 0x00A7ED4Du,
+    0x000519E9u, 0x003E8865u, 0x00723AF1u, 0x0049AB7Du,
+    0x00041E74u, 0x003F8FF8u, 0x00733D6Cu, 0x0048ACE0u,
+    0x00EA5844u, 0x00D1C9C8u, 0x009D7B5Cu, 0x00A6EAD0u,
+    0x005EDEEFu, 0x00654F63u, 0x0029FDF7u, 0x00126C7Bu,
+    0x00B098DFu, 0x008B0953u, 0x00C7BBC7u, 0x00FC2A4Bu,
+    0x00B9A3AAu, 0x00823226u, 0x00CE80B2u, 0x00F5113Eu,
+    0x0057E59Au, 0x006C7416u, 0x0020C682u, 0x001B570Eu,
+    0x00E36331u, 0x00D8F2BDu, 0x00944029u, 0x00AFD1A5u,
+    0x000D2501u, 0x0036B48Du, 0x007A0619u, 0x00419795u,
+    0x000C229Cu, 0x0037B310u, 0x007B0184u, 0x00409008u,
+    0x00E264ACu, 0x00D9F520u, 0x009547B4u, 0x00AED638u,
+    0x0056E207u, 0x006D738Bu, 0x0021C11Fu, 0x001A5093u,
+    0x00B8A437u, 0x008335BBu, 0x00CF872Fu, 0x00F416A3u,
+    0x0054ED3Du, 0x006F7CB1u, 0x0023CE25u, 0x00185FA9u,
+    0x00BAAB0Du, 0x00813A81u, 0x00CD8815u, 0x00F61999u,
+    0x000E2DA6u, 0x0035BC2Au, 0x00790EBEu, 0x00429F32u,
+    0x00E06B96u, 0x00DBFA1Au, 0x0097488Eu, 0x00ACD902u,
+    0x00E16C0Bu, 0x00DAFD87u, 0x00964F13u, 0x00ADDE9Fu,
+    0x000F2A3Bu, 0x0034BBB7u, 0x00780923u, 0x004398AFu,
+    0x00BBAC90u, 0x00803D1Cu, 0x00CC8F88u, 0x00F71E04u,
+    0x0055EAA0u, 0x006E7B2Cu, 0x0022C9B8u, 0x00195834u,
+    0x00E5727Fu, 0x00DEE3F3u, 0x00925167u, 0x00A9C0EBu,
+    0x000B344Fu, 0x0030A5C3u, 0x007C1757u, 0x004786DBu,
+    0x00BFB2E4u, 0x00842368u, 0x00C891FCu, 0x00F30070u,
+    0x0051F4D4u, 0x006A6558u, 0x0026D7CCu, 0x001D4640u,
+    0x0050F349u, 0x006B62C5u, 0x0027D051u, 0x001C41DDu,
+    0x00BEB579u, 0x008524F5u, 0x00C99661u, 0x00F207EDu,
+    0x000A33D2u, 0x0031A25Eu, 0x007D10CAu, 0x00468146u,
+    0x00E475E2u, 0x00DFE46Eu, 0x009356FAu, 0x00A8C776u,
+    0x00083CE8u, 0x0033AD64u, 0x007F1FF0u, 0x00448E7Cu,
+    0x00E67AD8u, 0x00DDEB54u, 0x009159C0u, 0x00AAC84Cu,
+    0x0052FC73u, 0x00696DFFu, 0x0025DF6Bu, 0x001E4EE7u,
+    0x00BCBA43u, 0x00872BCFu, 0x00CB995Bu, 0x00F008D7u,
+    0x00BDBDDEu, 0x00862C52u, 0x00CA9EC6u, 0x00F10F4Au,
+    0x0053FBEEu, 0x00686A62u, 0x0024D8F6u, 0x001F497Au,
+    0x00E77D45u, 0x00DCECC9u, 0x00905E5Du, 0x00ABCFD1u,
+    0x00093B75u, 0x0032AAF9u, 0x007E186Du, 0x004589E1u,
+  },
+  {
+    0x00000000u, 0x00F50BAFu, 0x006C5BA5u, 0x0099500Au,
+    0x00D8B74Au, 0x002DBCE5u, 0x00B4ECEFu, 0x0041E740u,
+    0x0037226Fu, 0x00C229C0u, 0x005B79CAu, 0x00AE7265u,
+    0x00EF9525u, 0x001A9E8Au, 0x0083CE80u, 0x0076C52Fu,
+    0x006E44DEu, 0x009B4F71u, 0x00021F7Bu, 0x00F714D4u,
+    0x00B6F394u, 0x0043F83Bu, 0x00DAA831u, 0x002FA39Eu,
+    0x005966B1u, 0x00AC6D1Eu, 0x00353D14u, 0x00C036BBu,
+    0x0081D1FBu, 0x0074DA54u, 0x00ED8A5Eu, 0x001881F1u,
+    0x00DC89BCu, 0x00298213u, 0x00B0D219u, 0x0045D9B6u,
+    0x00043EF6u, 0x00F13559u, 0x00686553u, 0x009D6EFCu,
+    0x00EBABD3u, 0x001EA07Cu, 0x0087F076u, 0x0072FBD9u,
+    0x00331C99u, 0x00C61736u, 0x005F473Cu, 0x00AA4C93u,
+    0x00B2CD62u, 0x0047C6CDu, 0x00DE96C7u, 0x002B9D68u,
+    0x006A7A28u, 0x009F7187u, 0x0006218Du, 0x00F32A22u,
+    0x0085EF0Du, 0x0070E4A2u, 0x00E9B4A8u, 0x001CBF07u,
+    0x005D5847u, 0x00A853E8u, 0x003103E2u, 0x00C4084Du,
+    0x003F5F83u, 0x00CA542Cu, 0x00530426u, 0x00A60F89u,
+    0x00E7E8C9u, 0x0012E366u, 0x008BB36Cu, 0x007EB8C3u,
+    0x00087DECu, 0x00FD7643u, 0x00642649u, 0x00912DE6u,
+    0x00D0CAA6u, 0x0025C109u, 0x00BC9103u, 0x00499AACu,
+    0x00511B5Du, 0x00A410F2u, 0x003D40F8u, 0x00C84B57u,
+    0x0089AC17u, 0x007CA7B8u, 0x00E5F7B2u, 0x0010FC1Du,
+    0x00663932u, 0x0093329Du, 0x000A6297u, 0x00FF6938u,
+    0x00BE8E78u, 0x004B85D7u, 0x00D2D5DDu, 0x0027DE72u,
+    0x00E3D63Fu, 0x0016DD90u, 0x008F8D9Au, 0x007A8635u,
+    0x003B6175u, 0x00CE6ADAu, 0x00573AD0u, 0x00A2317Fu,
+    0x00D4F450u, 0x0021FFFFu, 0x00B8AFF5u, 0x004DA45Au,
+    0x000C431Au, 0x00F948B5u, 0x006018BFu, 0x00951310u,
+    0x008D92E1u, 0x0078994Eu, 0x00E1C944u, 0x0014C2EBu,
+    0x005525ABu, 0x00A02E04u, 0x00397E0Eu, 0x00CC75A1u,
+    0x00BAB08Eu, 0x004FBB21u, 0x00D6EB2Bu, 0x0023E084u,
+    0x006207C4u, 0x00970C6Bu, 0x000E5C61u, 0x00FB57CEu,
+    0x007EBF06u, 0x008BB4A9u, 0x0012E4A3u, 0x00E7EF0Cu,
+    0x00A6084Cu, 0x005303E3u, 0x00CA53E9u, 0x003F5846u,
+    0x00499D69u, 0x00BC96C6u, 0x0025C6CCu, 0x00D0CD63u,
+    0x00912A23u, 0x0064218Cu, 0x00FD7186u, 0x00087A29u,
+    0x0010FBD8u, 0x00E5F077u, 0x007CA07Du, 0x0089ABD2u,
+    0x00C84C92u, 0x003D473Du, 0x00A41737u, 0x00511C98u,
+    0x0027D9B7u, 0x00D2D218u, 0x004B8212u, 0x00BE89BDu,
+    0x00FF6EFDu, 0x000A6552u, 0x00933558u, 0x00663EF7u,
+    0x00A236BAu, 0x00573D15u, 0x00CE6D1Fu, 0x003B66B0u,
+    0x007A81F0u, 0x008F8A5Fu, 0x0016DA55u, 0x00E3D1FAu,
+    0x009514D5u, 0x00601F7Au, 0x00F94F70u, 0x000C44DFu,
+    0x004DA39Fu, 0x00B8A830u, 0x0021F83Au, 0x00D4F395u,
+    0x00CC7264u, 0x003979CBu, 0x00A029C1u, 0x0055226Eu,
+    0x0014C52Eu, 0x00E1CE81u, 0x00789E8Bu, 0x008D9524u,
+    0x00FB500Bu, 0x000E5BA4u, 0x00970BAEu, 0x00620001u,
+    0x0023E741u, 0x00D6ECEEu, 0x004FBCE4u, 0x00BAB74Bu,
+    0x0041E085u, 0x00B4EB2Au, 0x002DBB20u, 0x00D8B08Fu,
+    0x009957CFu, 0x006C5C60u, 0x00F50C6Au, 0x000007C5u,
+    0x0076C2EAu, 0x0083C945u, 0x001A994Fu, 0x00EF92E0u,
+    0x00AE75A0u, 0x005B7E0Fu, 0x00C22E05u, 0x003725AAu,
+    0x002FA45Bu, 0x00DAAFF4u, 0x0043FFFEu, 0x00B6F451u,
+    0x00F71311u, 0x000218BEu, 0x009B48B4u, 0x006E431Bu,
+    0x00188634u, 0x00ED8D9Bu, 0x0074DD91u, 0x0081D63Eu,
+    0x00C0317Eu, 0x00353AD1u, 0x00AC6ADBu, 0x00596174u,
+    0x009D6939u, 0x00686296u, 0x00F1329Cu, 0x00043933u,
+    0x0045DE73u, 0x00B0D5DCu, 0x002985D6u, 0x00DC8E79u,
+    0x00AA4B56u, 0x005F40F9u, 0x00C610F3u, 0x00331B5Cu,
+    0x0072FC1Cu, 0x0087F7B3u, 0x001EA7B9u, 0x00EBAC16u,
+    0x00F32DE7u, 0x00062648u, 0x009F7642u, 0x006A7DEDu,
+    0x002B9AADu, 0x00DE9102u, 0x0047C108u, 0x00B2CAA7u,
+    0x00C40F88u, 0x00310427u, 0x00A8542Du, 0x005D5F82u,
+    0x001CB8C2u, 0x00E9B36Du, 0x0070E367u, 0x0085E8C8u,
+  },
+};
+
 #define COMPUTE_CRC24Q(parse, data)  (((parse)->crc << 8) ^ crc24q[data ^ (((parse)->crc >> 16) & 0xff)])
+
+// Compute the CRC-24Q over a span of data, returns the updated 24-bit CRC
+static inline uint32_t crc24qSpan(uint32_t crc, const uint8_t *data, int length)
+{
+    // Process 8 bytes at a time
+    while (length >= 8)
+    {
+        crc = crc24qSlice[6][data[0] ^ ((crc >> 16) & 0xff)]
+            ^ crc24qSlice[5][data[1] ^ ((crc >> 8) & 0xff)]
+            ^ crc24qSlice[4][data[2] ^ (crc & 0xff)]
+            ^ crc24qSlice[3][data[3]]
+            ^ crc24qSlice[2][data[4]]
+            ^ crc24qSlice[1][data[5]]
+            ^ crc24qSlice[0][data[6]]
+            ^ crc24q[data[7]];
+        data += 8;
+        length -= 8;
+    }
+
+    // Process the remaining bytes
+    while (length-- > 0)
+        crc = (crc << 8) ^ crc24q[*data++ ^ ((crc >> 16) & 0xff)];
+    return crc & 0xffffff;
+}
+
+/*
+   u-blox 8-bit Fletcher checksum over a span of data
+
+      CK_A += data
+      CK_B += CK_A
+
+   Four bytes d0 - d3 update the checksum as:
+
+      CK_B += 4 * CK_A + 4 * d0 + 3 * d1 + 2 * d2 + d3
+      CK_A += d0 + d1 + d2 + d3
+
+   The sums are accumulated in 32 bits, the low 8 bits remain exact since
+   256 divides 2^32.
+*/
+static inline void ubloxFletcherSpan(uint8_t *ck_a, uint8_t *ck_b, const uint8_t *data, int length)
+{
+    uint32_t a = *ck_a;
+    uint32_t b = *ck_b;
+
+    // Process 4 bytes at a time
+    while (length >= 4)
+    {
+        b += (a << 2) + (data[0] << 2) + (data[1] * 3) + (data[2] << 1) + data[3];
+        a += data[0] + data[1] + data[2] + data[3];
+        data += 4;
+        length -= 4;
+    }
+
+    // Process the remaining bytes
+    while (length-- > 0)
+    {
+        a += *data++;
+        b += a;
+    }
+    *ck_a = (uint8_t)a;
+    *ck_b = (uint8_t)b;
+}
+
+#endif  // __CRC24Q_H__
@@ -26,796 +26,828 @@
 //  python main_js_zipper.py
 
 static const uint8_t main_js[] PROGMEM = {
-  0x1F, 0x8B, 0x08, 0x08, 0x78, 0xBF, 0xE6, 0x68, 0x02, 0xFF, 0x6D, 0x61, 0x69, 0x6E, 0x2E, 0x6A,
-  0x73, 0x2E, 0x67, 0x7A, 0x69, 0x70, 0x00, 0xED, 0x7D, 0xEB, 0x7A, 0xDB, 0x38, 0x92, 0xE8, 0xFF,
-  0x3C, 0x05, 0x5A, 0x67, 0x4E, 0x4B, 0x1A, 0xCB, 0xB2, 0x24, 0x5F, 0x12, 0xC7, 0xB1, 0x77, 0x7D,
-  0x4B, 0xE2, 0x33, 0xB1, 0xE3, 0xCF, 0x4A, 0x3A, 0x9D, 0x64, 0x72, 0xBC, 0xB4, 0x08, 0xCB, 0x9C,
-  0x48, 0xA4, 0x96, 0xA4, 0x62, 0x7B, 0x66, 0xF3, 0x4E, 0xFB, 0x0C, 0xFB, 0x64, 0xA7, 0x0A, 0x17,
-  0x12, 0x00, 0xC1, 0x8B, 0x2E, 0x76, 0x32, 0x73, 0xDA, 0xDF, 0x4C, 0xDA, 0x26, 0x80, 0xAA, 0x42,
-  0xA1, 0x50, 0x28, 0x14, 0x0A, 0x85, 0x6F, 0x4E, 0x48, 0x86, 0x4E, 0x4C, 0x6F, 0x9D, 0x7B, 0xB2,
-  0x4B, 0xFE, 0xE3, 0x36, 0x7A, 0xBE, 0xB6, 0xF6, 0xA7, 0x7F, 0xDC, 0x7A, 0xBE, 0x1B, 0xDC, 0xB6,
-  0x47, 0xC1, 0xC0, 0x89, 0xBD, 0xC0, 0x6F, 0xDF, 0x04, 0x51, 0xEC, 0x3B, 0x63, 0xFA, 0x7D, 0xED,
-  0x36, 0xFA, 0x8F, 0x9D, 0x27, 0xDF, 0xA0, 0xD1, 0x2D, 0xBD, 0x8A, 0x82, 0xC1, 0x57, 0x1A, 0xEF,
-  0x3C, 0x79, 0x22, 0xAA, 0x3B, 0xAE, 0x7B, 0xFC, 0x8D, 0xFA, 0xF1, 0x1B, 0x2F, 0x8A, 0xA9, 0x4F,
-  0xC3, 0x46, 0x7D, 0x14, 0x38, 0x6E, 0xBD, 0x45, 0x02, 0xFF, 0x0D, 0xFC, 0xD2, 0x84, 0x9A, 0xD7,
-  0x53, 0x7F, 0x80, 0x10, 0xC5, 0xA7, 0x06, 0xC5, 0xFA, 0x4D, 0xF2, 0x8F, 0x27, 0x04, 0x7E, 0x3C,
-  0xDF, 0x8B, 0x3F, 0xD0, 0xAB, 0x3E, 0x03, 0xDB, 0x80, 0xEA, 0xDF, 0x95, 0x06, 0x46, 0xA1, 0x68,
-  0x92, 0x50, 0x01, 0xC4, 0xFB, 0xF4, 0x96, 0xA4, 0x35, 0x44, 0xA7, 0x00, 0x8A, 0x56, 0xAF, 0x1D,
-  0xF8, 0x63, 0x1A, 0x45, 0xCE, 0x90, 0x42, 0x8B, 0x04, 0x78, 0x63, 0x1C, 0x0D, 0x25, 0x48, 0xFC,
-  0x99, 0x38, 0x61, 0x44, 0x4F, 0xFC, 0x41, 0x30, 0xF6, 0xFC, 0x21, 0x16, 0xB6, 0x5D, 0x27, 0x76,
-  0x04, 0xAC, 0xEF, 0x3A, 0x61, 0x43, 0xDA, 0xA0, 0xB2, 0x6D, 0x48, 0xE3, 0x69, 0xE8, 0x13, 0x37,
-  0x18, 0x4C, 0xC7, 0xD0, 0xB1, 0xF6, 0x90, 0xC6, 0xC7, 0x23, 0x8A, 0xBF, 0x1E, 0xDC, 0x9F, 0x40,
-  0x6F, 0x79, 0x9F, 0x90, 0x7D, 0xD7, 0xDE, 0x1D, 0x75, 0xDF, 0x38, 0x48, 0x77, 0x67, 0x47, 0xF9,
-  0x12, 0xF8, 0xC3, 0xF4, 0xD3, 0x64, 0xE4, 0xC4, 0xD7, 0x41, 0x38, 0x3E, 0x0F, 0x29, 0x94, 0xC2,
-  0xF7, 0x5A, 0x7F, 0x1A, 0x7E, 0xA3, 0xF7, 0x41, 0x58, 0xE3, 0x15, 0x86, 0x34, 0x70, 0x69, 0xEC,
-  0x0D, 0x38, 0xA0, 0x8D, 0x4E, 0xBB, 0xD3, 0x35, 0x0A, 0x80, 0xC0, 0x5D, 0xB2, 0xDA, 0xED, 0x6C,
-  0xB6, 0xBB, 0xDB, 0x7A, 0xD1, 0xFE, 0x08, 0xDB, 0x74, 0x37, 0x3B, 0x9D, 0xB6, 0x68, 0x44, 0x07,
-  0xF4, 0xFA, 0x77, 0x56, 0xBD, 0xF7, 0xAC, 0xD3, 0xEB, 0x6C, 0xB5, 0x37, 0xB7, 0x9E, 0xA5, 0x25,
-  0x1F, 0xB1, 0x64, 0xE3, 0x69, 0x77, 0xEB, 0x59, 0x67, 0xA3, 0xBD, 0xD1, 0x59, 0x4F, 0x4B, 0x3E,
-  0x31, 0xDC, 0xCF, 0xB6, 0xB6, 0xB6, 0x36, 0xDB, 0x1B, 0xCF, 0x36, 0x78, 0xC1, 0xC8, 0x89, 0xE2,
-  0x97, 0xDE, 0x88, 0x9E, 0x81, 0xD8, 0x20, 0xE5, 0x35, 0xD9, 0x4B, 0xF8, 0x34, 0x1D, 0x5F, 0xD1,
-  0x30, 0xED, 0xA6, 0xCF, 0xFE, 0x7E, 0x7B, 0x8D, 0xD5, 0xA3, 0x3E, 0x1D, 0xD1, 0x41, 0x4C, 0xDD,
-  0xB4, 0x38, 0x12, 0x5F, 0x58, 0xB1, 0x02, 0x2A, 0xBA, 0x09, 0x40, 0xF0, 0x86, 0xF8, 0x19, 0x25,
-  0x0E, 0xC7, 0xD3, 0x19, 0x45, 0x94, 0x17, 0x06, 0x57, 0xB1, 0xE3, 0xF9, 0xD4, 0x3D, 0xE5, 0x83,
-  0x5D, 0xA9, 0xC2, 0x81, 0x13, 0x51, 0xBD, 0x92, 0x40, 0x21, 0xEA, 0x5C, 0xBC, 0x3B, 0x3C, 0xCD,
-  0x02, 0xC2, 0x1E, 0xBD, 0x73, 0xAE, 0xE0, 0x1F, 0x7A, 0x17, 0x2B, 0xE4, 0x09, 0x31, 0x33, 0xBE,
-  0x22, 0x5B, 0x04, 0xB8, 0x77, 0xF7, 0x13, 0x9A, 0x5F, 0x22, 0x88, 0xC1, 0x52, 0x56, 0x1C, 0xD2,
-  0x41, 0x10, 0xBA, 0xD1, 0xF1, 0xE1, 0xF1, 0x4B, 0xF8, 0xFC, 0xF9, 0xCB, 0x8E, 0xFA, 0xF5, 0x95,
-  0x18, 0x53, 0xA5, 0xE4, 0x7A, 0x3A, 0x1A, 0x9D, 0x03, 0xAC, 0xF7, 0x13, 0x10, 0x5D, 0xA5, 0x5B,
-  0xA2, 0x59, 0x44, 0xE3, 0x77, 0xDE, 0x98, 0x06, 0xD3, 0x58, 0x32, 0xD9, 0x77, 0x8F, 0x40, 0xC6,
-  0xB5, 0x8F, 0x83, 0x1B, 0x3A, 0xF8, 0x7A, 0x46, 0x6F, 0x5F, 0x7A, 0xE1, 0xF8, 0xD6, 0x09, 0xA9,
-  0x56, 0x08, 0xB2, 0x6D, 0x2B, 0x7A, 0x32, 0x08, 0x7C, 0x60, 0xD1, 0x61, 0x00, 0x74, 0x79, 0x3E,
-  0xA0, 0xC6, 0xCE, 0xE0, 0xB0, 0xF1, 0x19, 0x72, 0xF8, 0xF6, 0xED, 0xC5, 0xD1, 0xC9, 0xD9, 0xFE,
-  0xBB, 0xE3, 0xCB, 0x93, 0xB3, 0xF3, 0xF7, 0xEF, 0x2E, 0xDF, 0x7D, 0x3C, 0x3F, 0xBE, 0x3C, 0x3A,
-  0x7A, 0x4E, 0x3A, 0x2D, 0xB2, 0xB6, 0x76, 0x44, 0xAF, 0x9D, 0x29, 0x08, 0xE6, 0xD1, 0x51, 0xDB,
-  0x95, 0x3F, 0x85, 0xED, 0x4E, 0x4F, 0x9F, 0x93, 0x2E, 0x6B, 0x09, 0xBF, 0xB6, 0xC7, 0xF8, 0x53,
-  0x58, 0xFF, 0x12, 0x1B, 0xF4, 0x78, 0x03, 0x52, 0xB5, 0xC5, 0xE5, 0xD1, 0x7E, 0xFF, 0xF5, 0x73,
-  0xB2, 0xCE, 0x9B, 0xAD, 0x56, 0x6E, 0xD6, 0xFF, 0x78, 0x7A, 0xF0, 0xF6, 0xCD, 0x73, 0xB2, 0xC1,
-  0x1B, 0xFE, 0xCF, 0x7F, 0xCB, 0x96, 0xE3, 0x71, 0xBD, 0xA4, 0x57, 0xFD, 0xFE, 0x73, 0xB2, 0x99,
-  0x90, 0x49, 0xFA, 0xFD, 0x76, 0xC4, 0x7E, 0xCA, 0x71, 0x42, 0xC3, 0xAD, 0xF9, 0x1A, 0x8A, 0x6E,
-  0x3E, 0x4D, 0xBA, 0xB9, 0x3A, 0x53, 0x6B, 0xD9, 0xDB, 0x67, 0x69, 0x6F, 0xEB, 0x09, 0x80, 0x5A,
-  0x69, 0x7F, 0x2F, 0xCF, 0xDE, 0x5E, 0x1E, 0x1D, 0x1F, 0x9E, 0x9C, 0xEE, 0x03, 0x8C, 0x6D, 0x39,
-  0xA4, 0xFD, 0x3E, 0x59, 0x25, 0x67, 0x01, 0x71, 0xE9, 0xC0, 0x1B, 0x3B, 0xA3, 0x2A, 0x74, 0xA8,
-  0x70, 0xBA, 0x1D, 0x95, 0x15, 0x33, 0x83, 0x42, 0x86, 0xE8, 0xF0, 0xBA, 0x2A, 0x73, 0xAA, 0xC2,
-  0x3B, 0x39, 0xFB, 0x6D, 0xFF, 0xCD, 0xC9, 0xD1, 0xE5, 0xFB, 0xB3, 0xBF, 0x9C, 0xBD, 0xFD, 0x70,
-  0x06, 0x60, 0x7A, 0x2D, 0xB9, 0x10, 0xC0, 0x74, 0xF9, 0x46, 0x43, 0x50, 0x6F, 0xE9, 0x8C, 0x41,
-  0xD5, 0xD7, 0x16, 0xCA, 0x6F, 0x90, 0x7C, 0x3D, 0xF1, 0x27, 0xD3, 0x58, 0xE8, 0x0C, 0x63, 0x76,
-  0xB5, 0xF3, 0xBA, 0xA1, 0xAE, 0xB8, 0x99, 0x35, 0x4D, 0x2E, 0x5A, 0x6B, 0x6B, 0x38, 0x65, 0x83,
-  0x11, 0x85, 0xF5, 0x7E, 0xD8, 0xA8, 0x79, 0xA2, 0x8A, 0x54, 0x60, 0xCF, 0x49, 0x8D, 0xAC, 0x10,
-  0xAC, 0x0F, 0xD0, 0xB0, 0x3E, 0x92, 0x85, 0xCB, 0x21, 0xD0, 0x81, 0x2B, 0x63, 0x34, 0x19, 0x79,
-  0x71, 0xA3, 0xDE, 0xAA, 0x8B, 0xE5, 0x11, 0x16, 0x2C, 0xD2, 0x18, 0xC1, 0x8A, 0x7C, 0xC7, 0x54,
-  0x38, 0xFC, 0xE7, 0x05, 0xAB, 0xDE, 0x1E, 0x51, 0x7F, 0x18, 0xDF, 0x00, 0xCF, 0xBA, 0xF8, 0x71,
-  0x65, 0x97, 0xF4, 0xD4, 0x25, 0x17, 0xA1, 0x7A, 0xA8, 0xF5, 0xB1, 0xEE, 0xE7, 0xBB, 0x2F, 0x3B,
-  0x5A, 0xC9, 0x37, 0x67, 0x94, 0x14, 0x01, 0x35, 0x5D, 0xA5, 0xD8, 0x24, 0xDF, 0xE5, 0x04, 0x03,
-  0xAC, 0x15, 0x52, 0x6B, 0x61, 0x4B, 0xFE, 0x01, 0x7E, 0x91, 0x3D, 0xE0, 0xCD, 0xFA, 0x13, 0x18,
-  0x38, 0x80, 0x0B, 0xDD, 0x1D, 0x3B, 0xBE, 0x1B, 0x25, 0x45, 0xDE, 0x35, 0x69, 0x78, 0x6E, 0x1B,
-  0x18, 0x31, 0x9A, 0xBA, 0x34, 0x6A, 0xD4, 0x22, 0xF7, 0x34, 0x98, 0xFA, 0x30, 0x46, 0xB5, 0xA6,
-  0x4A, 0x32, 0x07, 0xF3, 0x0E, 0x57, 0xFC, 0xC0, 0x5F, 0x0B, 0xAE, 0xAF, 0x49, 0xFF, 0x88, 0x80,
-  0x2E, 0x74, 0xB4, 0x1A, 0x08, 0x8D, 0x91, 0x0F, 0xCA, 0x9C, 0xE9, 0xE0, 0x9A, 0x09, 0x03, 0x7F,
-  0x6E, 0x3C, 0x97, 0x36, 0x6A, 0xB8, 0x96, 0x9C, 0x3A, 0x3E, 0x70, 0x3D, 0xAC, 0x35, 0x77, 0xB4,
-  0x4A, 0xDF, 0xB5, 0xBF, 0x28, 0xC0, 0xD1, 0x20, 0xC7, 0xE1, 0xD4, 0x0E, 0x18, 0x97, 0xB0, 0x8A,
-  0x80, 0xD3, 0xDF, 0x12, 0xF0, 0x38, 0x22, 0x00, 0x5D, 0x37, 0x44, 0x32, 0x78, 0x32, 0x76, 0x0A,
-  0x50, 0xA5, 0x23, 0x49, 0x2C, 0xA2, 0xD8, 0x8B, 0x47, 0x6C, 0x5D, 0xBB, 0x78, 0xF7, 0x17, 0x36,
-  0x2C, 0x46, 0x5B, 0x18, 0x33, 0xD2, 0x07, 0x2B, 0x6A, 0x52, 0xD3, 0x01, 0x64, 0x96, 0x33, 0xEC,
-  0xB0, 0x32, 0x9C, 0x92, 0xD3, 0x26, 0x29, 0xAA, 0xCD, 0x94, 0xCF, 0x9E, 0x2B, 0x58, 0x6C, 0x0F,
-  0x03, 0xFF, 0xDA, 0x1B, 0x9A, 0xDC, 0x49, 0xC7, 0x06, 0x56, 0xC8, 0x28, 0x08, 0xCB, 0x6A, 0x4D,
-  0x26, 0x65, 0x35, 0x68, 0x7C, 0x43, 0x43, 0x9F, 0xC6, 0x65, 0xF5, 0xFC, 0xB8, 0x00, 0xD4, 0xDA,
-  0x1A, 0xAF, 0xE4, 0x8C, 0x46, 0xC1, 0xED, 0x07, 0xEF, 0xA5, 0xF7, 0x16, 0x94, 0xC8, 0xB1, 0x84,
-  0x3C, 0xF2, 0x80, 0xD5, 0xD0, 0x0C, 0xAA, 0xBD, 0x0C, 0xD0, 0x14, 0x00, 0xAB, 0x94, 0x12, 0x7A,
-  0x37, 0x71, 0xFC, 0x08, 0x54, 0xC1, 0x6C, 0xD0, 0xFA, 0x14, 0xD8, 0x17, 0x16, 0x40, 0xCB, 0xA1,
-  0x1F, 0x27, 0xEB, 0x79, 0x10, 0xC6, 0x87, 0x37, 0x8E, 0xEF, 0xD3, 0xD1, 0x51, 0x18, 0x4C, 0x60,
-  0x93, 0xE0, 0x57, 0x94, 0x6B, 0xCB, 0x38, 0x1E, 0xDF, 0x4D, 0xC0, 0x6E, 0x89, 0x6A, 0xE4, 0xBF,
-  0xFE, 0x8B, 0x58, 0x8A, 0x5F, 0x3A, 0x03, 0x1A, 0xFF, 0x31, 0xC6, 0x0F, 0x33, 0xC6, 0x0B, 0x8D,
-  0x18, 0x39, 0x1F, 0x4D, 0xA3, 0x02, 0xAD, 0x57, 0x3C, 0x32, 0x7C, 0xF4, 0xFE, 0x18, 0x99, 0xAA,
-  0xB3, 0x0F, 0xF6, 0xA3, 0xB5, 0xF1, 0xF4, 0x4E, 0x4C, 0xBB, 0x5E, 0xAD, 0x09, 0x0B, 0x19, 0x6C,
-  0xC6, 0x5F, 0xBF, 0x3B, 0x7D, 0x83, 0x7A, 0xF7, 0xC3, 0x0D, 0xA5, 0xA3, 0xB5, 0x23, 0x2F, 0x24,
-  0xC7, 0xB0, 0xD0, 0xBB, 0x34, 0xAC, 0xCD, 0x3B, 0x1F, 0xD9, 0x84, 0x23, 0x6F, 0x56, 0x0F, 0x60,
-  0xF1, 0x2C, 0x9C, 0x94, 0xA2, 0x0E, 0x01, 0xA4, 0xB0, 0x91, 0x7B, 0xE0, 0x29, 0xCA, 0x21, 0xFD,
-  0x31, 0x45, 0x2B, 0x0E, 0xE2, 0x05, 0xBD, 0xA6, 0x21, 0xF5, 0x07, 0x94, 0xF4, 0x63, 0xE6, 0xEB,
-  0xF9, 0xE1, 0x1A, 0x94, 0xE3, 0x2A, 0x1F, 0x1E, 0x5E, 0xEF, 0x9F, 0x7C, 0x78, 0xAC, 0x26, 0x97,
-  0x62, 0x79, 0xFE, 0x1D, 0xDD, 0x1E, 0x7C, 0x87, 0xFD, 0x1B, 0x0D, 0x11, 0xD0, 0x09, 0xD2, 0x9C,
-  0xB5, 0x42, 0x4F, 0xA7, 0xB0, 0xE9, 0x06, 0x4B, 0x96, 0x12, 0xE7, 0x2A, 0xF8, 0x46, 0x49, 0xB6,
-  0x21, 0x89, 0x69, 0x14, 0x9B, 0xAD, 0x02, 0xD7, 0xBB, 0xBE, 0x87, 0xCD, 0x7F, 0x1C, 0x83, 0xC5,
-  0x1F, 0x11, 0x77, 0x4A, 0x49, 0x1C, 0x90, 0x6B, 0xD1, 0x92, 0x8C, 0xBC, 0xB1, 0xC7, 0xC5, 0x22,
-  0xB2, 0xDA, 0xB4, 0x7B, 0xBB, 0xB0, 0x95, 0xE9, 0x5A, 0x25, 0x86, 0x39, 0x6D, 0x40, 0xE1, 0xA0,
-  0x3A, 0x72, 0xEF, 0x7D, 0x67, 0xEC, 0x0D, 0x00, 0x1B, 0x1D, 0xD9, 0xC6, 0x09, 0x77, 0x0B, 0x3E,
-  0xBD, 0x7D, 0x3B, 0x61, 0x1B, 0x15, 0xEE, 0xC9, 0xE3, 0x7F, 0x34, 0xEA, 0xA7, 0xC1, 0x2D, 0x0D,
-  0xEB, 0x2D, 0x52, 0xEF, 0x76, 0xEB, 0x36, 0x29, 0x60, 0x78, 0xD0, 0xF5, 0xD8, 0x48, 0x20, 0xB4,
-  0xC8, 0xD4, 0x77, 0x41, 0xC2, 0x7D, 0xEA, 0x5A, 0x5A, 0xE4, 0x21, 0x3A, 0x5E, 0xED, 0xC3, 0x66,
-  0x2B, 0x16, 0xC8, 0x7A, 0x8B, 0x23, 0xB3, 0x8D, 0x32, 0xEC, 0x3A, 0xE2, 0x90, 0xB1, 0x7A, 0x88,
-  0x1E, 0x52, 0x07, 0x1D, 0x5D, 0x57, 0xF7, 0x04, 0x8D, 0xE1, 0xA9, 0xEF, 0xC5, 0x25, 0xD2, 0x10,
-  0xB9, 0x2F, 0x43, 0x4A, 0xFB, 0x13, 0x50, 0xAA, 0xB5, 0xA6, 0x86, 0x0B, 0xB4, 0xAF, 0x51, 0xB3,
-  0xEF, 0xFD, 0xBD, 0xAC, 0xD2, 0x8D, 0x13, 0xBA, 0x38, 0xCC, 0x27, 0x47, 0x25, 0x15, 0xB3, 0xC2,
-  0x54, 0xD2, 0xC0, 0x75, 0xEE, 0xA3, 0x0B, 0x3A, 0x76, 0x3C, 0x1F, 0xFA, 0x5A, 0x52, 0x77, 0x12,
-  0x06, 0xB8, 0x3B, 0xE9, 0xA0, 0xA3, 0xB0, 0x5A, 0xD5, 0x6E, 0xF5, 0xAA, 0xBD, 0xEA, 0x55, 0xD7,
-  0xAB, 0x57, 0xDD, 0xA8, 0x5E, 0x75, 0xB3, 0x7A, 0xD5, 0xAD, 0xEA, 0x55, 0x9F, 0x56, 0xA8, 0x1A,
-  0x3A, 0xAE, 0x17, 0x9C, 0xEE, 0x1F, 0x96, 0x0D, 0x15, 0xFD, 0xE6, 0x0D, 0xE8, 0xC1, 0xBB, 0x52,
-  0x21, 0x80, 0xDD, 0xB5, 0xF4, 0xE7, 0x96, 0xD4, 0xBC, 0x72, 0x62, 0x98, 0x46, 0xF7, 0xE7, 0x34,
-  0x1C, 0x30, 0x0D, 0x9B, 0x54, 0x36, 0x15, 0x05, 0xE8, 0x06, 0xCF, 0xD5, 0xED, 0x13, 0x6D, 0xE7,
-  0x58, 0xA6, 0x1D, 0xC3, 0xF8, 0x6B, 0x46, 0x2E, 0x2D, 0x38, 0xAC, 0xF5, 0xF2, 0xB1, 0xE6, 0xB7,
-  0x7A, 0x3F, 0x19, 0x02, 0x57, 0x69, 0x6D, 0x01, 0x92, 0x07, 0xB8, 0x58, 0x85, 0xE3, 0x0B, 0x74,
-  0xC0, 0x66, 0x89, 0x65, 0x7E, 0xD9, 0xC3, 0x60, 0x3C, 0x01, 0x8D, 0x48, 0x1B, 0xCD, 0x99, 0xC1,
-  0xA2, 0x07, 0xF7, 0x82, 0x0E, 0xA8, 0x37, 0xB1, 0x00, 0xCF, 0xD6, 0xD1, 0x31, 0x94, 0xA0, 0x10,
-  0xA2, 0xC7, 0x9D, 0xF7, 0x16, 0xE8, 0xD3, 0x10, 0xEC, 0x88, 0xF8, 0x5C, 0xAD, 0x65, 0xE3, 0xEC,
-  0x9F, 0xD0, 0xC3, 0x34, 0x99, 0xC6, 0x9F, 0xF1, 0x3C, 0x69, 0x57, 0x00, 0xBD, 0x40, 0x59, 0xFD,
-  0xF2, 0x19, 0x2A, 0x4F, 0xE9, 0x2E, 0x7A, 0x05, 0xAC, 0xD0, 0x56, 0x48, 0xED, 0x0B, 0xF0, 0x1E,
-  0xDA, 0x4C, 0x1A, 0x75, 0xE6, 0x9B, 0xA6, 0x78, 0xBA, 0x84, 0x9E, 0x80, 0x19, 0x58, 0x25, 0x17,
-  0xB7, 0xF7, 0x13, 0x3C, 0x9D, 0x92, 0xCC, 0xCE, 0x76, 0xC8, 0x5E, 0xAF, 0x31, 0x37, 0x26, 0xB4,
-  0xAF, 0x70, 0x1B, 0x54, 0x8C, 0x87, 0xD7, 0x6A, 0x70, 0x67, 0x55, 0x55, 0x44, 0xCA, 0x31, 0x90,
-  0x6D, 0x02, 0xA8, 0x67, 0x44, 0x36, 0x49, 0x5F, 0x68, 0x0E, 0x2A, 0x27, 0x4D, 0x05, 0xB8, 0xD9,
-  0x6A, 0xFB, 0x60, 0xB8, 0xF7, 0x47, 0x05, 0xFD, 0xE6, 0xE7, 0x5C, 0x4B, 0xC7, 0xCD, 0x0E, 0xCB,
-  0xB2, 0x58, 0xE5, 0x19, 0xDA, 0x83, 0xE0, 0xFB, 0x68, 0xC7, 0xF7, 0xF1, 0xA1, 0xF0, 0x7D, 0xB2,
-  0xE3, 0xFB, 0xF4, 0x20, 0xF8, 0xA2, 0x89, 0x1F, 0xDC, 0x9E, 0x53, 0x0A, 0x9B, 0x87, 0xA9, 0xCD,
-  0xC6, 0x4D, 0x6C, 0x4E, 0xD2, 0x69, 0x5A, 0x37, 0xBD, 0x13, 0x68, 0x0B, 0xEB, 0x5D, 0x64, 0xEE,
-  0x78, 0x6B, 0xD5, 0x89, 0x10, 0x20, 0xEC, 0xAB, 0x88, 0x15, 0xFE, 0x0A, 0xEB, 0x26, 0xAA, 0xA6,
-  0x17, 0x57, 0xE1, 0xDE, 0x0C, 0xA8, 0x22, 0x6E, 0x57, 0xE3, 0x79, 0x9E, 0x6D, 0x1D, 0x48, 0x0E,
-  0xFB, 0xDA, 0x93, 0x69, 0x74, 0x33, 0xA3, 0x3E, 0x10, 0xB0, 0xE5, 0xA9, 0x60, 0x2E, 0x7C, 0x59,
-  0x61, 0x1E, 0x1C, 0xD7, 0x63, 0x6E, 0x09, 0x98, 0xA0, 0x8D, 0x73, 0xDF, 0x99, 0x64, 0xE0, 0x7A,
-  0xCC, 0xAD, 0xD6, 0xAC, 0x8A, 0x54, 0x8F, 0x58, 0x81, 0xE5, 0xB5, 0x17, 0x71, 0x48, 0x9C, 0x91,
-  0x37, 0xF4, 0x77, 0xEB, 0x23, 0x7A, 0x1D, 0xD7, 0xF7, 0x4C, 0x77, 0xB1, 0xA5, 0x85, 0xBB, 0x87,
-  0x2B, 0x8B, 0x46, 0x1F, 0x0E, 0xDB, 0x1A, 0x16, 0x54, 0x6D, 0x2D, 0xC7, 0xBA, 0x72, 0xA3, 0x17,
-  0x6C, 0xB1, 0x23, 0xF1, 0xFD, 0x84, 0xEE, 0xF2, 0x35, 0xEB, 0x2A, 0xB8, 0xAB, 0x83, 0xBD, 0xB4,
-  0x5B, 0xB7, 0x51, 0x53, 0x27, 0x6C, 0x59, 0xAC, 0x23, 0xB0, 0x93, 0xA3, 0x3A, 0x19, 0x40, 0x85,
-  0x08, 0xFE, 0x84, 0x4D, 0xFB, 0x2A, 0x6B, 0xBD, 0xCA, 0xE1, 0x29, 0xFE, 0xFC, 0x43, 0xFC, 0x5C,
-  0xDF, 0xAB, 0x48, 0xD2, 0x5A, 0x3C, 0x93, 0x94, 0xC2, 0x28, 0x43, 0xD3, 0xEC, 0x88, 0xE0, 0x71,
-  0x31, 0xD2, 0x3D, 0xCB, 0x72, 0xF8, 0xFE, 0xE0, 0xF7, 0xCB, 0x2C, 0x24, 0xE5, 0xA8, 0x5C, 0x88,
-  0x8C, 0xE7, 0xEE, 0xE4, 0xD5, 0xB8, 0xE0, 0xBE, 0xFF, 0x8C, 0xF2, 0x31, 0x80, 0xBC, 0x71, 0xAE,
-  0xE8, 0x48, 0x1E, 0x9E, 0xE7, 0xD4, 0x3B, 0x12, 0x27, 0x58, 0x69, 0x2B, 0x79, 0x92, 0x75, 0x69,
-  0x6E, 0xFD, 0xB0, 0x27, 0x4A, 0x2B, 0x79, 0x90, 0x05, 0x9B, 0xDF, 0x75, 0xDB, 0xD6, 0x57, 0x3D,
-  0xFC, 0xE7, 0xC7, 0x75, 0x4A, 0xE3, 0xCF, 0xDD, 0x2F, 0xE8, 0x22, 0x40, 0x5E, 0x60, 0x38, 0xC1,
-  0x65, 0xB7, 0xF3, 0x74, 0x03, 0x6A, 0xE0, 0xEF, 0x19, 0x40, 0x88, 0xD7, 0x8C, 0x17, 0xF8, 0x65,
-  0x57, 0x85, 0x6D, 0x43, 0x2F, 0x27, 0xE1, 0xA9, 0x8D, 0x04, 0xFC, 0x6B, 0xC7, 0xDA, 0x44, 0x0D,
-  0x57, 0x60, 0x92, 0x72, 0x13, 0x9A, 0xE2, 0x64, 0x98, 0x89, 0x46, 0x4B, 0x95, 0xF1, 0x7A, 0x87,
-  0x51, 0xB0, 0x2F, 0xD9, 0x21, 0xA2, 0xF2, 0xB9, 0xC7, 0xF8, 0x90, 0xF0, 0xC0, 0xDA, 0x79, 0x0B,
-  0xD3, 0x77, 0x77, 0xC9, 0x46, 0x5E, 0xAF, 0xE7, 0x25, 0xC4, 0xFA, 0x79, 0x3D, 0xA5, 0x6F, 0xA3,
-  0xF3, 0xB4, 0x77, 0xD9, 0xAD, 0xC2, 0x0A, 0x68, 0x40, 0xC7, 0xE8, 0x7E, 0x61, 0xD1, 0x1B, 0xD0,
-  0x85, 0x88, 0x52, 0x7F, 0x06, 0x86, 0x25, 0x9F, 0xA4, 0x2C, 0x22, 0x9C, 0x7A, 0xB3, 0xFD, 0xB7,
-  0xC0, 0xF3, 0x1B, 0xF5, 0x7A, 0x33, 0x23, 0x3A, 0x58, 0xFE, 0xA4, 0x80, 0xA8, 0xCC, 0xA8, 0xBA,
-  0xDE, 0x37, 0x4D, 0xA9, 0x0C, 0xC3, 0x60, 0x3A, 0x21, 0x61, 0x70, 0xCB, 0x75, 0xD2, 0x38, 0x1A,
-  0x2A, 0x8C, 0x48, 0xB4, 0x92, 0x29, 0x09, 0x19, 0xB0, 0x23, 0xD6, 0x0F, 0x80, 0xC8, 0xD5, 0x9A,
-  0xD9, 0x5E, 0xA2, 0x1C, 0x04, 0xA3, 0xD5, 0x68, 0xBC, 0xBA, 0x41, 0xF0, 0x97, 0x2D, 0xF6, 0x2F,
-  0xA3, 0x82, 0x35, 0xAF, 0xEF, 0x19, 0x4D, 0x39, 0x73, 0xA0, 0xFD, 0xF3, 0x17, 0x6B, 0xAC, 0x46,
-  0x29, 0x19, 0x4A, 0xEF, 0x34, 0x54, 0x1B, 0x75, 0x5D, 0x11, 0xF3, 0x88, 0x23, 0x43, 0xBD, 0x06,
-  0x7E, 0x1C, 0x06, 0xA3, 0x7A, 0x09, 0x0E, 0xA9, 0xB9, 0x33, 0x5D, 0xE4, 0x9B, 0x17, 0xB5, 0x8C,
-  0x69, 0xAB, 0x4A, 0xEC, 0x9B, 0x90, 0x1C, 0xB0, 0xC7, 0x61, 0x18, 0xA4, 0x74, 0x7A, 0xFE, 0xC8,
-  0xF3, 0x29, 0xFF, 0x06, 0x0A, 0x7F, 0x52, 0x0A, 0x77, 0x0D, 0x18, 0xB2, 0xC7, 0xFF, 0x9D, 0x41,
-  0xE9, 0xB3, 0x85, 0xC6, 0xF3, 0x87, 0x4A, 0x78, 0x8F, 0x65, 0xBF, 0x97, 0xAD, 0x34, 0xCB, 0x62,
-  0xE0, 0xA7, 0xCD, 0x72, 0xB7, 0xEE, 0xD9, 0x3A, 0x33, 0xEF, 0x8B, 0x98, 0x5F, 0xB3, 0xB0, 0x1F,
-  0xD9, 0x3A, 0xB3, 0x74, 0x23, 0x88, 0x1D, 0xD9, 0x2C, 0x6F, 0x7F, 0x97, 0xA9, 0x32, 0x63, 0x27,
-  0x84, 0x37, 0xE5, 0x04, 0xE4, 0x33, 0xF5, 0xBF, 0xD8, 0xEC, 0x53, 0x6B, 0xC5, 0x76, 0x14, 0x0E,
-  0x66, 0xF7, 0x51, 0x64, 0x62, 0x4E, 0x6C, 0xDE, 0x04, 0x5B, 0x60, 0xCA, 0x6C, 0xE6, 0x9E, 0x88,
-  0x81, 0xB4, 0x19, 0x7C, 0x49, 0x74, 0xE4, 0x1C, 0x10, 0x03, 0xF4, 0x39, 0xDA, 0x41, 0xF2, 0xF0,
-  0x4A, 0x03, 0xA6, 0xE2, 0x9D, 0x65, 0xC6, 0x14, 0x01, 0x13, 0x8D, 0x46, 0x64, 0x8D, 0x30, 0x17,
-  0x1A, 0xB9, 0x9A, 0xC6, 0xB1, 0xEA, 0x00, 0xAF, 0x16, 0x7B, 0x11, 0x87, 0xF7, 0x96, 0x65, 0x4A,
-  0xEC, 0x92, 0x84, 0xF3, 0x22, 0x09, 0x63, 0xD0, 0x34, 0x38, 0x19, 0x38, 0xF1, 0xE0, 0x86, 0x34,
-  0x28, 0xCE, 0x73, 0xDB, 0x5A, 0xA7, 0xC5, 0xBB, 0x9C, 0x44, 0xD1, 0x94, 0x92, 0x5B, 0x0F, 0xD6,
-  0xC6, 0x93, 0x23, 0x19, 0xFA, 0xD2, 0xAC, 0x7E, 0xDC, 0x50, 0x1C, 0x9A, 0x52, 0xB1, 0x17, 0x22,
-  0xB6, 0xF0, 0xF1, 0xBA, 0xA1, 0x0C, 0xD9, 0xFE, 0x68, 0x04, 0xFB, 0x99, 0xE1, 0x74, 0x84, 0x01,
-  0x44, 0x4C, 0xC7, 0xF3, 0xE1, 0xC3, 0x13, 0x47, 0xA6, 0x93, 0x8D, 0x91, 0x9B, 0xA1, 0x83, 0xAC,
-  0xB9, 0xCD, 0xDE, 0x7C, 0xF8, 0x31, 0xFA, 0x6E, 0x0B, 0xCD, 0xEA, 0xCB, 0x73, 0x1A, 0xF4, 0x14,
-  0x61, 0x34, 0x92, 0x30, 0x6F, 0xD9, 0xEE, 0x94, 0xBB, 0xCA, 0xF0, 0xD8, 0x77, 0x48, 0x85, 0xED,
-  0x67, 0xEC, 0x84, 0xEB, 0xF5, 0x9D, 0xA4, 0x3A, 0xF3, 0x34, 0x0A, 0xF7, 0xDA, 0x29, 0x2C, 0xFA,
-  0xD9, 0x9A, 0x82, 0x80, 0xA3, 0xC0, 0xAF, 0xC7, 0x64, 0xCA, 0xC3, 0x6E, 0x40, 0x60, 0x1C, 0x60,
-  0xF7, 0x2D, 0xC5, 0x1D, 0x24, 0xF5, 0xBE, 0xC1, 0xE0, 0xDF, 0x3A, 0x91, 0xA2, 0x0B, 0x60, 0x04,
-  0xAE, 0x83, 0x27, 0xD2, 0x7E, 0xD3, 0x83, 0x76, 0x54, 0x36, 0xE5, 0x46, 0xA7, 0xA6, 0xE3, 0xFA,
-  0x32, 0x08, 0x07, 0x14, 0x86, 0x8C, 0x85, 0x4F, 0x0B, 0x02, 0xD2, 0xA1, 0x64, 0xA7, 0xDC, 0xD4,
-  0x89, 0xA6, 0x21, 0x2B, 0xC7, 0xA5, 0xF6, 0xF5, 0xDF, 0xA1, 0x17, 0xAE, 0x17, 0x4D, 0x70, 0x68,
-  0x58, 0x20, 0x3A, 0x9E, 0xD2, 0x90, 0xC3, 0x69, 0x14, 0x07, 0x63, 0xFE, 0x37, 0xEC, 0xC0, 0x90,
-  0x3D, 0xF5, 0xA6, 0xA2, 0x7F, 0x87, 0x22, 0x02, 0x01, 0x35, 0x18, 0x0F, 0x15, 0x3A, 0xF1, 0x17,
-  0x06, 0xF4, 0x12, 0xB5, 0xCD, 0xDC, 0x50, 0x98, 0xAE, 0x3A, 0x60, 0xA7, 0xAD, 0x6A, 0x9C, 0x1F,
-  0xF7, 0x15, 0x2C, 0x17, 0xE6, 0x2B, 0x1A, 0xCC, 0x0D, 0x92, 0xFA, 0xB8, 0xB7, 0x7C, 0x13, 0x0C,
-  0x87, 0xEC, 0x94, 0x67, 0x21, 0x28, 0x67, 0x71, 0xE8, 0x4D, 0xE4, 0x91, 0xEC, 0xE2, 0x90, 0xE4,
-  0x71, 0xEC, 0x9C, 0x90, 0x8C, 0xD8, 0xA5, 0x05, 0x29, 0x3A, 0xBE, 0x83, 0x75, 0xD9, 0x77, 0x46,
-  0xE7, 0x53, 0xA6, 0x62, 0x17, 0x82, 0x75, 0x0E, 0x3B, 0x81, 0xF8, 0x9C, 0x86, 0xD7, 0x74, 0x10,
-  0x1F, 0x06, 0x21, 0x06, 0x54, 0xE0, 0xE9, 0xEC, 0xDC, 0x50, 0xD9, 0x12, 0xC7, 0x57, 0xF8, 0x39,
-  0x21, 0x38, 0x7E, 0x4C, 0x7D, 0xDF, 0x49, 0x02, 0x09, 0x18, 0x85, 0xF3, 0x43, 0x9B, 0xC6, 0xC1,
-  0xC9, 0xE9, 0xFB, 0x31, 0xFA, 0x00, 0xF7, 0xD1, 0xC1, 0x33, 0x5E, 0x5C, 0x22, 0xF6, 0x2F, 0xCE,
-  0xE7, 0x11, 0xD2, 0x04, 0x12, 0xD7, 0x3D, 0x38, 0xFB, 0x30, 0xFA, 0x5F, 0x35, 0x0F, 0x79, 0x89,
-  0x74, 0xA3, 0x99, 0xA5, 0xF1, 0x40, 0x48, 0xF4, 0x01, 0x2E, 0x48, 0x46, 0x09, 0x97, 0xD0, 0x4C,
-  0xC9, 0xD4, 0x9D, 0x64, 0xBE, 0xB9, 0x37, 0x83, 0x89, 0x8C, 0x33, 0xC8, 0x62, 0x07, 0x33, 0x09,
-  0xCD, 0x1A, 0x59, 0x00, 0x6B, 0xA3, 0x7A, 0x3B, 0x85, 0x85, 0x2C, 0xC0, 0x62, 0x23, 0x74, 0xAF,
-  0x58, 0xD8, 0xA2, 0xF8, 0x1E, 0xD6, 0x14, 0x64, 0xC5, 0x88, 0xDD, 0xFB, 0xA9, 0xF9, 0x81, 0x4F,
-  0x6B, 0xFA, 0xBD, 0x16, 0x16, 0x5F, 0x51, 0xDE, 0xF2, 0x6A, 0x14, 0x0C, 0xBE, 0xF2, 0xA6, 0x60,
-  0x3E, 0x85, 0x14, 0xD5, 0xF9, 0x61, 0xFF, 0x37, 0x12, 0xF0, 0xA5, 0x42, 0x84, 0x16, 0xB0, 0xD0,
-  0x5D, 0x05, 0xB6, 0xB8, 0x6D, 0x90, 0xDC, 0xE3, 0xE1, 0x57, 0x10, 0x58, 0x55, 0x6C, 0xAC, 0xB8,
-  0x6E, 0xD6, 0xD6, 0x4E, 0xD2, 0x45, 0x3D, 0xA9, 0x3B, 0x18, 0x45, 0xE2, 0x62, 0x0D, 0x5E, 0x2D,
-  0x48, 0xA2, 0x4B, 0xFF, 0x73, 0x0A, 0x06, 0x30, 0xBF, 0x41, 0x12, 0x84, 0x60, 0x18, 0x34, 0x6A,
-  0x6D, 0x75, 0x6F, 0xD7, 0x22, 0xFC, 0x4F, 0xD7, 0x88, 0x45, 0xB4, 0x85, 0x2C, 0x2B, 0x18, 0x84,
-  0xEF, 0x01, 0xBE, 0xAF, 0xAC, 0xA8, 0x8B, 0x98, 0x42, 0x30, 0xEC, 0xB6, 0x94, 0x06, 0x9F, 0xEF,
-  0xBE, 0xB4, 0x45, 0xFC, 0x31, 0x3B, 0xCC, 0xD2, 0x4B, 0xB8, 0x55, 0xC1, 0x0A, 0x93, 0x21, 0xCB,
-  0x58, 0x9F, 0x2D, 0x8B, 0xF1, 0x99, 0x78, 0x17, 0x70, 0xD1, 0x26, 0x63, 0xEE, 0xFE, 0x63, 0x7F,
-  0xF0, 0xF2, 0x59, 0x99, 0x92, 0xFA, 0x13, 0x9F, 0xFB, 0x41, 0xDC, 0x68, 0x9B, 0x4E, 0xC5, 0xA6,
-  0xE4, 0x17, 0x23, 0x25, 0xB1, 0x36, 0x1E, 0x97, 0x5B, 0xD2, 0xC8, 0xCC, 0xF2, 0xCB, 0x46, 0x87,
-  0xEA, 0x38, 0xAF, 0x44, 0x87, 0xE6, 0x87, 0x07, 0x24, 0x18, 0x81, 0x5C, 0x6F, 0xD5, 0xE1, 0x5F,
-  0x05, 0x14, 0xD0, 0x31, 0x1B, 0xFE, 0xC4, 0xB1, 0x3E, 0x13, 0x0D, 0x89, 0xBF, 0xDE, 0x46, 0x87,
-  0x2C, 0xB4, 0xD3, 0x62, 0x98, 0x89, 0x3E, 0x2C, 0xF0, 0x43, 0x6E, 0x68, 0xA6, 0xA8, 0x32, 0x57,
-  0xE1, 0x70, 0x16, 0x36, 0xB4, 0xF2, 0x27, 0xD2, 0xB7, 0xAB, 0x5C, 0x05, 0x82, 0xCE, 0xA5, 0x97,
-  0x85, 0x1A, 0xB2, 0xB0, 0x45, 0x7A, 0x9D, 0x4E, 0xA7, 0x99, 0x55, 0x19, 0xCC, 0x3B, 0x01, 0xAA,
-  0xA2, 0x45, 0x98, 0x6D, 0x8C, 0xBE, 0x08, 0x4D, 0x85, 0x60, 0xBF, 0xB8, 0x07, 0xC3, 0x30, 0x39,
-  0xF1, 0xFC, 0x84, 0x15, 0x3C, 0x27, 0xD8, 0xED, 0xA4, 0xB5, 0x8E, 0x62, 0x30, 0xA2, 0x4E, 0x28,
-  0x71, 0x54, 0x03, 0x5C, 0xCF, 0x12, 0xD9, 0x9F, 0x0E, 0x06, 0x60, 0x22, 0x33, 0x32, 0x95, 0x9B,
-  0x10, 0x09, 0x1C, 0x51, 0x6E, 0x23, 0x51, 0x14, 0x71, 0x22, 0xA1, 0x2D, 0x02, 0xD7, 0xA9, 0x4B,
-  0x81, 0x57, 0x85, 0x6B, 0xA1, 0x10, 0x6C, 0x72, 0x49, 0x9D, 0xE0, 0xA4, 0x34, 0x92, 0x93, 0xDB,
-  0x92, 0xD7, 0x62, 0xFB, 0x81, 0xDB, 0x37, 0x76, 0x06, 0xAE, 0x08, 0x58, 0x76, 0x5B, 0x23, 0xF7,
-  0x6C, 0xE8, 0x49, 0xC2, 0x85, 0xAA, 0x1D, 0x32, 0x5D, 0xD2, 0x10, 0x4E, 0xA5, 0x84, 0xB2, 0x9D,
-  0xE2, 0x56, 0x18, 0xFB, 0xA4, 0xF9, 0xA1, 0xAC, 0x9E, 0x0C, 0xBE, 0x3B, 0xFA, 0x87, 0xB6, 0x97,
-  0x31, 0x36, 0x5F, 0x33, 0x53, 0x98, 0x41, 0x57, 0x46, 0x9F, 0xA5, 0x4B, 0xC5, 0x14, 0x5A, 0x8E,
-  0x30, 0xD9, 0x90, 0xDB, 0x46, 0x5A, 0x8C, 0x51, 0x2A, 0xED, 0x8A, 0x18, 0xA9, 0xE3, 0x57, 0x13,
-  0x22, 0x2D, 0xEE, 0xD0, 0x24, 0xD1, 0x0A, 0xA6, 0xD0, 0x28, 0xE3, 0x6D, 0xAC, 0xB8, 0x16, 0x49,
-  0x61, 0x17, 0x2F, 0x11, 0x2E, 0x3B, 0x2A, 0xE5, 0x37, 0x25, 0x15, 0x78, 0xA8, 0x31, 0xC5, 0x0E,
-  0xF0, 0x37, 0x5C, 0x6B, 0x14, 0x49, 0x64, 0x65, 0x42, 0xBD, 0xCA, 0xB2, 0x16, 0x5E, 0xBD, 0xEB,
-  0x6D, 0x6E, 0x02, 0xB1, 0x2C, 0x8A, 0xF0, 0x8A, 0xC2, 0xFF, 0xE2, 0x5B, 0x4A, 0x7D, 0xD2, 0x61,
-  0xBB, 0x68, 0x28, 0xAB, 0x41, 0xE1, 0x20, 0x18, 0x8D, 0x9C, 0x49, 0x44, 0x5F, 0x9D, 0xF5, 0xFB,
-  0x3C, 0xE6, 0x92, 0x6D, 0x1C, 0x8D, 0xF9, 0x29, 0x2A, 0xF5, 0xB9, 0x61, 0x0A, 0xFA, 0x62, 0xC0,
-  0xA3, 0xE4, 0x06, 0x4E, 0x48, 0x55, 0x4D, 0x20, 0x0A, 0x6C, 0xE3, 0x8D, 0xFC, 0x93, 0xA3, 0x06,
-  0x35, 0x79, 0x4B, 0x9B, 0x5C, 0x80, 0xD6, 0x5B, 0x65, 0xA5, 0xAB, 0xB8, 0x9A, 0xCF, 0xD8, 0x64,
-  0x3A, 0x29, 0x6A, 0xC0, 0xE5, 0x28, 0x8B, 0x40, 0xED, 0x2B, 0x2C, 0xE4, 0x1E, 0x5A, 0x60, 0x2F,
-  0x3D, 0x3A, 0x72, 0xA3, 0x46, 0x7A, 0x9F, 0xEA, 0x50, 0x30, 0x41, 0x58, 0x40, 0x83, 0x34, 0x80,
-  0xD2, 0x64, 0x4F, 0xC2, 0x54, 0xB1, 0x15, 0x17, 0xB1, 0xAC, 0xC0, 0x6D, 0xB9, 0x9F, 0x47, 0xEC,
-  0xD2, 0x4E, 0xC9, 0x6D, 0x9D, 0x0E, 0x09, 0x36, 0x1D, 0xFA, 0x51, 0x34, 0x6B, 0x3B, 0x1C, 0x4A,
-  0xD1, 0x14, 0x7E, 0xAD, 0xD6, 0xFA, 0x20, 0x8D, 0x07, 0x86, 0xA6, 0x2C, 0x3A, 0xB8, 0x52, 0xBB,
-  0xBE, 0x1A, 0x23, 0x0C, 0x2D, 0x45, 0xCC, 0x70, 0xA5, 0xB6, 0xE7, 0xE7, 0x0A, 0x8B, 0xD4, 0xBD,
-  0x50, 0xB5, 0xD6, 0xB0, 0xA7, 0x8B, 0x54, 0x00, 0xF8, 0x67, 0xA5, 0x96, 0x18, 0xEF, 0x9B, 0x36,
-  0xBC, 0xF5, 0xAE, 0xBD, 0x6A, 0xED, 0xDE, 0x1D, 0x9E, 0xBF, 0x3F, 0x52, 0x68, 0x06, 0xCB, 0xFF,
-  0xBD, 0x3B, 0xA9, 0xD6, 0x96, 0x45, 0x45, 0xA5, 0x4D, 0x99, 0x15, 0x56, 0x91, 0xC3, 0xF7, 0x51,
-  0x4C, 0xC7, 0x0A, 0x87, 0xF9, 0xDF, 0x95, 0xDA, 0x1E, 0xEB, 0x91, 0xD7, 0xD0, 0x3A, 0x89, 0xC5,
-  0xAE, 0xD4, 0xFE, 0xEC, 0x9D, 0xD2, 0x5D, 0x0C, 0xCF, 0x96, 0xAD, 0xF8, 0x2A, 0x60, 0xAA, 0x2D,
-  0x3E, 0x63, 0x84, 0xF8, 0x13, 0xDE, 0x32, 0xA3, 0xAA, 0x78, 0xD0, 0x6C, 0x1A, 0x83, 0x86, 0xAE,
-  0xED, 0x16, 0xDE, 0xFB, 0xDD, 0xD8, 0x56, 0xB4, 0x56, 0x17, 0x63, 0x97, 0x37, 0xB6, 0xA1, 0xA5,
-  0x13, 0x3A, 0x03, 0xD8, 0x73, 0x47, 0xAA, 0xDA, 0xD2, 0x67, 0x58, 0x33, 0x41, 0x8D, 0x73, 0x20,
-  0x0F, 0x2F, 0x57, 0x91, 0x16, 0x47, 0x53, 0x0B, 0x6F, 0x68, 0x76, 0x3A, 0xDD, 0x5E, 0x8B, 0x5D,
-  0x31, 0xCD, 0x2A, 0x4E, 0x5E, 0xCA, 0xD4, 0x67, 0xB7, 0xC3, 0x1A, 0xD8, 0x26, 0xAB, 0xE4, 0x25,
-  0xA2, 0x3C, 0xC4, 0x7B, 0xD3, 0x14, 0xAA, 0x30, 0x6D, 0xD1, 0x90, 0x04, 0xDA, 0xC8, 0xF1, 0x7C,
-  0xF8, 0xF0, 0xAD, 0xC6, 0x14, 0xF7, 0x76, 0x27, 0x57, 0x6F, 0x6F, 0x77, 0x2A, 0xA0, 0xCD, 0x80,
-  0x3E, 0x3C, 0x7B, 0xBB, 0x10, 0xE4, 0xC4, 0x38, 0xC9, 0x73, 0xEE, 0x08, 0x8B, 0x5E, 0x35, 0x57,
-  0x6C, 0x63, 0xED, 0xA7, 0x8D, 0x2E, 0x0F, 0x1D, 0x60, 0x4D, 0xF8, 0x3A, 0x88, 0x62, 0x31, 0xEC,
-  0x9B, 0x99, 0x61, 0xDF, 0xCC, 0x19, 0xF6, 0x6C, 0xB7, 0x73, 0xBA, 0x9E, 0xC5, 0x87, 0xDA, 0x82,
-  0xE3, 0xDB, 0xC6, 0x1F, 0x13, 0x25, 0xFB, 0x38, 0x1B, 0x2A, 0x5B, 0xDF, 0xD8, 0xD5, 0x52, 0xEE,
-  0x34, 0x61, 0xB8, 0xD6, 0x3B, 0x26, 0xA2, 0xF5, 0xCE, 0xDC, 0x7D, 0xE3, 0x1D, 0x79, 0x1F, 0xD1,
-  0xB0, 0x80, 0xA1, 0x96, 0x12, 0x6C, 0xC1, 0x74, 0x4E, 0xFC, 0xB5, 0x37, 0x0C, 0xDA, 0x83, 0x60,
-  0x8C, 0x7F, 0xFD, 0x7B, 0x4D, 0x21, 0xCD, 0xF1, 0x09, 0x46, 0x78, 0x8F, 0x08, 0x2C, 0x95, 0xEC,
-  0x5E, 0x5E, 0x21, 0x61, 0xD2, 0x9F, 0x4D, 0xB8, 0x3F, 0x19, 0x16, 0xE3, 0xF0, 0x36, 0xF4, 0x62,
-  0xE1, 0x15, 0x07, 0x05, 0x43, 0x5C, 0x7E, 0xF5, 0x3F, 0x22, 0xA0, 0x6C, 0x68, 0x9B, 0x20, 0x05,
-  0xB0, 0xC7, 0xBD, 0x27, 0xB7, 0x0E, 0xE8, 0x0A, 0xE0, 0x82, 0xEB, 0x45, 0x28, 0x4B, 0xE4, 0xEC,
-  0xDD, 0xC5, 0xC9, 0x39, 0xEE, 0x8B, 0x09, 0x6C, 0x5A, 0xC9, 0x28, 0x80, 0x65, 0x16, 0x9B, 0xD3,
-  0x3B, 0x58, 0xB6, 0xD1, 0xD3, 0x20, 0x2F, 0x33, 0xB4, 0x25, 0x46, 0xC5, 0xF0, 0x84, 0xBF, 0xF8,
-  0x46, 0x19, 0x37, 0x11, 0x9C, 0x43, 0x45, 0x7C, 0x51, 0x7A, 0x2F, 0xBA, 0x51, 0x11, 0x80, 0x90,
-  0x9C, 0x5E, 0xB7, 0xD3, 0xAD, 0xDA, 0x50, 0x13, 0x83, 0xDA, 0xD5, 0xC8, 0x0D, 0x2F, 0xFB, 0x13,
-  0x27, 0xFC, 0xFA, 0x72, 0xEA, 0x77, 0x6B, 0xB3, 0x03, 0x39, 0xFF, 0x30, 0x23, 0xC9, 0x72, 0xC4,
-  0xF1, 0x96, 0xC8, 0xBF, 0xE3, 0x3F, 0x73, 0x74, 0x1B, 0x61, 0x00, 0x62, 0x80, 0x62, 0x34, 0x1C,
-  0x1A, 0xF3, 0xEB, 0x5D, 0xE8, 0xF8, 0xD1, 0xD8, 0x8B, 0x5F, 0xBD, 0xDA, 0xAF, 0xD9, 0x4F, 0xC3,
-  0xA0, 0xA1, 0xE1, 0x16, 0x41, 0x5B, 0xEA, 0xFD, 0xC1, 0xEF, 0xF2, 0x90, 0xDB, 0x70, 0x08, 0x4D,
-  0xAF, 0xEE, 0x84, 0xC9, 0x5B, 0xEC, 0xFB, 0xA8, 0xF3, 0xE0, 0x63, 0xCF, 0xFD, 0xBF, 0xBB, 0x18,
-  0x48, 0xF1, 0x85, 0xC7, 0x54, 0x8C, 0xD9, 0x6E, 0x00, 0x31, 0x78, 0x6E, 0x44, 0x60, 0x3B, 0x1E,
-  0x32, 0x51, 0x62, 0xB2, 0x89, 0xD5, 0x72, 0xF7, 0xFB, 0x0A, 0xDA, 0xBC, 0xBD, 0x7E, 0x36, 0xC0,
-  0x49, 0x69, 0xC4, 0x7D, 0x1F, 0xC6, 0xDC, 0xD5, 0x6C, 0x77, 0xA5, 0x69, 0xD3, 0x70, 0x17, 0xB1,
-  0x20, 0x13, 0x65, 0xE5, 0xB2, 0x5C, 0xF1, 0xFA, 0xA5, 0xE8, 0x16, 0xA6, 0x54, 0xD2, 0x96, 0xD3,
-  0x0F, 0x8B, 0x8E, 0xCE, 0x51, 0x9B, 0xC1, 0x15, 0x0C, 0xFA, 0x37, 0xB6, 0x68, 0x81, 0x29, 0x10,
-  0xF8, 0x2E, 0x2A, 0x82, 0xAD, 0x0E, 0xFE, 0xDF, 0xB6, 0x7E, 0x6C, 0x75, 0x70, 0x2E, 0x43, 0x99,
-  0xAA, 0x2E, 0x0E, 0x72, 0x2F, 0x96, 0x15, 0x23, 0x3C, 0x0F, 0x22, 0x0F, 0xFF, 0xBB, 0x3F, 0x18,
-  0x4C, 0x41, 0x3D, 0xDE, 0x73, 0x05, 0xBA, 0xD9, 0xEE, 0x5A, 0x10, 0x77, 0xDB, 0x0C, 0xF3, 0x66,
-  0xBB, 0x00, 0xB3, 0x8E, 0x5A, 0x13, 0x76, 0x76, 0x7C, 0x72, 0xCC, 0x62, 0x7E, 0x5B, 0x5A, 0x82,
-  0x1C, 0x93, 0x60, 0x7B, 0xAB, 0x8F, 0xD8, 0x4A, 0x49, 0x9E, 0x53, 0xAD, 0xD5, 0x27, 0x68, 0xA5,
-  0x24, 0xD6, 0x29, 0x6F, 0xF4, 0xC6, 0x89, 0xD1, 0x65, 0xC2, 0x9A, 0xB5, 0x3B, 0xDB, 0x9D, 0xDE,
-  0xF6, 0xC6, 0xD3, 0xED, 0x0A, 0xCD, 0x02, 0x7F, 0x28, 0xDA, 0xF1, 0x54, 0x41, 0xCF, 0x36, 0x3B,
-  0x9B, 0x4F, 0xB7, 0xBA, 0xE5, 0x2D, 0xF7, 0x47, 0xB1, 0x17, 0x4F, 0x5D, 0x66, 0x8D, 0x6D, 0x6E,
-  0x01, 0xCE, 0x67, 0xC5, 0xE8, 0xC4, 0x61, 0xC1, 0x6B, 0xEA, 0x0D, 0x6F, 0x10, 0x5D, 0xA7, 0x4A,
-  0x6D, 0xE3, 0x68, 0x41, 0x6F, 0xF5, 0xBD, 0xE8, 0x74, 0x57, 0x07, 0x97, 0x23, 0xAA, 0x85, 0x24,
-  0x14, 0x4B, 0x1B, 0x48, 0x53, 0xD3, 0x92, 0x84, 0xA0, 0xFC, 0x0C, 0x2F, 0x67, 0x7E, 0x2D, 0x30,
-  0xAC, 0x8B, 0x0D, 0xED, 0xDC, 0xC3, 0x3B, 0xFB, 0x10, 0xCF, 0x36, 0xCC, 0xD9, 0xA6, 0x59, 0x8D,
-  0xA0, 0xCF, 0xCD, 0xA7, 0x1D, 0xF6, 0xD3, 0x22, 0xC9, 0x2F, 0x89, 0x2E, 0x90, 0x65, 0xA8, 0x08,
-  0xC4, 0xAF, 0xD5, 0xD4, 0x50, 0x19, 0xE2, 0x8F, 0x3F, 0x0A, 0xF1, 0xA7, 0x87, 0x42, 0x6C, 0xB9,
-  0x41, 0x5C, 0x49, 0x54, 0x2B, 0xA8, 0xC8, 0xF9, 0xD5, 0xE4, 0x4C, 0xAA, 0xD2, 0xCE, 0xC7, 0xF4,
-  0xB4, 0x0C, 0x16, 0xD0, 0xDF, 0x68, 0x88, 0xD7, 0x5F, 0xE1, 0xDB, 0x1A, 0x8B, 0x0C, 0x4A, 0x43,
-  0x04, 0x2B, 0x0F, 0x82, 0x32, 0x43, 0x56, 0xBB, 0xDD, 0xCE, 0xFA, 0x46, 0x8B, 0x3C, 0x7B, 0xA6,
-  0xED, 0x4A, 0xF9, 0x67, 0x1C, 0x00, 0x2C, 0xA8, 0xB8, 0xF8, 0xE4, 0xA0, 0x34, 0xE7, 0xD6, 0x2A,
-  0xA6, 0x6F, 0xEB, 0xB4, 0x88, 0xF8, 0x8F, 0x82, 0x73, 0x53, 0x0C, 0x3A, 0xFB, 0x65, 0x21, 0x59,
-  0xCB, 0x9B, 0x9D, 0xAB, 0xBD, 0x0E, 0x28, 0x04, 0x76, 0x0E, 0xD0, 0xD6, 0x70, 0xB3, 0x0F, 0x88,
-  0x9B, 0xFD, 0x32, 0xAB, 0xB8, 0x29, 0xB1, 0x3D, 0x96, 0x4D, 0x64, 0x72, 0xAE, 0x9F, 0xD8, 0x8C,
-  0x59, 0xDF, 0x77, 0xE1, 0xA6, 0x8B, 0x03, 0x50, 0xEC, 0xFC, 0xCB, 0xCE, 0xCC, 0x9E, 0x84, 0x99,
-  0xCC, 0x95, 0x2C, 0x56, 0xDC, 0x1C, 0x48, 0xAC, 0xD5, 0x36, 0x96, 0xD5, 0x10, 0xE6, 0xF7, 0x13,
-  0xED, 0x72, 0x86, 0xB1, 0x63, 0xF4, 0xB3, 0xB3, 0x84, 0x7E, 0x16, 0xA3, 0x3D, 0xFF, 0xF0, 0xA8,
-  0x88, 0xD3, 0x0D, 0xD0, 0x83, 0x8D, 0x6B, 0x31, 0xDA, 0x47, 0xEE, 0xAF, 0x22, 0xC7, 0xDD, 0x07,
-  0x42, 0x5B, 0x2C, 0xC7, 0x02, 0xAB, 0x29, 0xC7, 0x9D, 0x87, 0x93, 0xE3, 0xEE, 0x8F, 0x92, 0xE3,
-  0xEE, 0x8F, 0x91, 0xE3, 0x1F, 0x83, 0x76, 0x89, 0xFD, 0x55, 0xB3, 0x1F, 0x3C, 0xB6, 0xFB, 0x27,
-  0xEB, 0x02, 0x2A, 0x76, 0x67, 0xD8, 0x97, 0x07, 0x8B, 0x23, 0x68, 0x06, 0x30, 0x89, 0xBE, 0x57,
-  0xDC, 0x41, 0x33, 0x34, 0x4F, 0x94, 0xB7, 0xDD, 0x35, 0x33, 0x23, 0x24, 0xA1, 0x9F, 0x6A, 0x33,
-  0x35, 0x37, 0xB4, 0x2A, 0xF7, 0x4E, 0xB9, 0xB7, 0x7E, 0x7C, 0xEB, 0xF7, 0xE6, 0x04, 0x24, 0xE9,
-  0xF8, 0x70, 0xB1, 0x79, 0x7B, 0x11, 0x6C, 0xBC, 0x9E, 0xA3, 0x3B, 0x89, 0xD6, 0xAB, 0xCD, 0x3B,
-  0x28, 0x5D, 0x63, 0x7B, 0x32, 0xCB, 0x88, 0xCC, 0x8B, 0x58, 0x51, 0x26, 0x73, 0x0F, 0xC2, 0x22,
-  0x8D, 0x73, 0x70, 0x7F, 0xD7, 0x5D, 0x4B, 0x6A, 0x98, 0x61, 0x89, 0x8B, 0x69, 0x59, 0xA9, 0xA0,
-  0x74, 0x6B, 0x2F, 0x3F, 0xCE, 0xB1, 0xC4, 0xF2, 0x93, 0x31, 0xDB, 0x2C, 0x26, 0x5A, 0x01, 0x72,
-  0xC4, 0xF2, 0x5C, 0x88, 0x43, 0xA0, 0x77, 0xC1, 0x57, 0x8A, 0x6E, 0x2E, 0x56, 0x79, 0xC7, 0x76,
-  0xCD, 0x78, 0x4A, 0x93, 0x6B, 0x7E, 0xB6, 0xFB, 0xC6, 0xD6, 0xC3, 0xA9, 0x62, 0x6C, 0x2D, 0xB2,
-  0xBE, 0xC5, 0xFF, 0x9F, 0x68, 0xD3, 0xF5, 0xAD, 0xBC, 0xB3, 0xAA, 0xF3, 0x22, 0x35, 0x5A, 0xEA,
-  0xE8, 0x28, 0xA5, 0xA4, 0x56, 0xCB, 0xC6, 0x51, 0xB0, 0xD0, 0xCB, 0xBF, 0xD0, 0xFB, 0x0B, 0xEA,
-  0xD3, 0x5B, 0x67, 0x54, 0xCB, 0xBF, 0xA5, 0x60, 0xC8, 0x0A, 0x3F, 0xCE, 0xAD, 0x20, 0x25, 0xA5,
-  0x8E, 0xC8, 0xBC, 0xE0, 0x4F, 0x65, 0xC8, 0xB5, 0x10, 0x98, 0x02, 0x73, 0xC5, 0x1B, 0x4F, 0x3F,
-  0x3A, 0xB7, 0x7C, 0x05, 0x5B, 0xDF, 0xCA, 0x39, 0xA2, 0x63, 0x87, 0x2B, 0x5B, 0xC6, 0x26, 0xA5,
-  0x5F, 0x90, 0xC1, 0xCA, 0x8E, 0xE8, 0xDC, 0x8B, 0x07, 0x37, 0xB8, 0x23, 0xDA, 0xCE, 0x3B, 0x35,
-  0x83, 0x12, 0x8E, 0x6D, 0x7B, 0x61, 0x64, 0x17, 0xD0, 0x92, 0xED, 0xFC, 0x9E, 0xE1, 0xBE, 0xEF,
-  0x99, 0x15, 0x1B, 0x7C, 0xE6, 0xE8, 0xD8, 0x2F, 0x55, 0xF0, 0x19, 0x43, 0x8A, 0xA7, 0xDD, 0x65,
-  0x67, 0xB1, 0x78, 0x06, 0x7E, 0x06, 0x18, 0x83, 0xF0, 0x6B, 0xA7, 0xDF, 0x3F, 0x39, 0xE2, 0xBC,
-  0xDE, 0xEC, 0x98, 0xD6, 0xC2, 0x66, 0xDE, 0xE9, 0x95, 0x72, 0xA4, 0x6E, 0x39, 0x90, 0xB4, 0xA1,
-  0x39, 0x77, 0xA2, 0x08, 0x7E, 0x71, 0x1F, 0x1E, 0x55, 0xF7, 0x71, 0x7A, 0xD4, 0x7D, 0xBC, 0x1E,
-  0xF5, 0x1E, 0xA7, 0x47, 0xBD, 0xC7, 0xEB, 0xD1, 0xFA, 0xE3, 0xF4, 0x68, 0x7D, 0x49, 0x3D, 0x12,
-  0x53, 0xEB, 0xDD, 0xE1, 0xF9, 0xDA, 0xFB, 0xA3, 0x73, 0x53, 0x5D, 0x2A, 0x2B, 0xDF, 0xB7, 0xB8,
-  0xEA, 0x51, 0xB9, 0xD0, 0x0A, 0x13, 0xD9, 0x22, 0x3D, 0xB0, 0xDE, 0xDA, 0xDC, 0x5C, 0xCF, 0x9C,
-  0x91, 0xB3, 0x8F, 0x2A, 0x81, 0x5A, 0x70, 0x4A, 0xC9, 0x91, 0x75, 0x82, 0x44, 0x39, 0x85, 0xAF,
-  0xBE, 0xB5, 0xB6, 0x61, 0xFA, 0x6E, 0xEF, 0xBC, 0xE9, 0xE2, 0x29, 0xEF, 0x3C, 0x6F, 0xB1, 0x8C,
-  0xCE, 0xE7, 0x90, 0xF4, 0xDE, 0x9D, 0xCC, 0x4E, 0x55, 0xD2, 0x68, 0x79, 0x84, 0xF1, 0x38, 0x11,
-  0x91, 0x44, 0xE2, 0x74, 0x1A, 0xD3, 0xBB, 0xAC, 0xD0, 0x60, 0xBC, 0x8E, 0xC1, 0x4A, 0xF8, 0x04,
-  0x30, 0x09, 0xAF, 0xC0, 0xE2, 0x37, 0x78, 0x01, 0x19, 0x38, 0x3E, 0xDB, 0x45, 0x01, 0x29, 0xBC,
-  0x8D, 0x4B, 0x9C, 0x98, 0x6D, 0xA7, 0x22, 0x3C, 0xA9, 0x8C, 0x3D, 0x16, 0x66, 0x93, 0x4B, 0x98,
-  0x5C, 0xFF, 0x59, 0x70, 0x51, 0xBE, 0x40, 0xA7, 0x77, 0x2F, 0xAA, 0xF1, 0x6E, 0xEC, 0xDC, 0x41,
-  0x13, 0x0C, 0x38, 0xBE, 0x1C, 0x7B, 0x3E, 0xF4, 0x32, 0xE2, 0xDC, 0xEB, 0x76, 0x36, 0xBB, 0xBD,
-  0x4E, 0x26, 0x3A, 0xA2, 0xDB, 0x82, 0xEF, 0xAD, 0x9E, 0xEE, 0xE5, 0xD4, 0x02, 0xA0, 0x8A, 0xE3,
-  0x3E, 0x38, 0xBA, 0x37, 0xCC, 0xD8, 0x5B, 0x2E, 0x42, 0x6B, 0xDC, 0xAB, 0x6E, 0xA9, 0x59, 0xFB,
-  0xBA, 0xD5, 0x21, 0x7F, 0x26, 0x3D, 0xF5, 0xB8, 0xCF, 0xD6, 0x28, 0x43, 0xB1, 0xDE, 0xEC, 0xBB,
-  0x2D, 0x10, 0x47, 0xBB, 0x09, 0x53, 0x6D, 0x34, 0xD2, 0x26, 0x27, 0x7E, 0x8C, 0x47, 0x61, 0x23,
-  0x21, 0xCB, 0x59, 0xC6, 0x6C, 0x2D, 0x85, 0x25, 0x76, 0x84, 0x1D, 0xF3, 0xF0, 0x5B, 0x86, 0xA9,
-  0x15, 0x19, 0x9C, 0xC5, 0xC9, 0x4D, 0x13, 0xD6, 0x08, 0x48, 0x47, 0xAF, 0x0F, 0xCF, 0x67, 0x34,
-  0x36, 0x4F, 0xCE, 0xF7, 0x79, 0xF0, 0x4B, 0x0A, 0xE5, 0xE4, 0x5C, 0x0D, 0x92, 0xF1, 0x7D, 0xBF,
-  0xAD, 0xFC, 0x5F, 0x65, 0xCF, 0x71, 0x61, 0x86, 0xD3, 0x12, 0x2C, 0x47, 0x67, 0xFD, 0xC7, 0x40,
-  0xF3, 0x8A, 0x3F, 0xA2, 0xF3, 0x18, 0xA8, 0xFA, 0xD3, 0x2B, 0xF8, 0x77, 0x61, 0x4C, 0xDF, 0x8B,
-  0x64, 0x59, 0xE2, 0x3A, 0x8B, 0x27, 0x42, 0x29, 0x77, 0xB2, 0x4A, 0xB9, 0x63, 0x55, 0xCA, 0x76,
-  0x8C, 0x89, 0x34, 0x9E, 0xBD, 0x3B, 0x9F, 0x5F, 0x10, 0xAD, 0xDE, 0x56, 0xA0, 0x70, 0x34, 0x82,
-  0x1D, 0x53, 0xE0, 0x73, 0xAD, 0xBE, 0x0E, 0x93, 0xE0, 0xA9, 0xBA, 0x77, 0x64, 0xAA, 0xE8, 0xA9,
-  0x4A, 0x63, 0x1A, 0x79, 0x59, 0x16, 0xE9, 0x36, 0x01, 0xDA, 0x06, 0x1E, 0xCB, 0xBA, 0x00, 0x5B,
-  0x09, 0x8C, 0x38, 0xD3, 0x4E, 0x70, 0xD6, 0x19, 0x0F, 0x3A, 0x73, 0xC2, 0xBE, 0x08, 0x02, 0xD8,
-  0x75, 0x8E, 0x98, 0xD8, 0xE0, 0x1E, 0xA5, 0x93, 0x39, 0x95, 0xE4, 0x7B, 0x93, 0x4E, 0x0B, 0xBF,
-  0x1A, 0xC7, 0x53, 0xB3, 0xE2, 0xF1, 0xA2, 0x89, 0x48, 0x1F, 0xF1, 0x10, 0xC8, 0x52, 0x1F, 0xE9,
-  0x24, 0x19, 0xC2, 0x13, 0x57, 0x58, 0x3F, 0x19, 0xE3, 0x87, 0xD9, 0x3E, 0x51, 0x21, 0x02, 0xC5,
-  0xC1, 0x12, 0xC6, 0x15, 0x62, 0x77, 0xAC, 0x6F, 0x17, 0xE8, 0x3A, 0xDD, 0xBC, 0x5D, 0x5A, 0x3D,
-  0x74, 0x87, 0xAA, 0x2D, 0x71, 0x0D, 0x3A, 0xE0, 0x1B, 0x48, 0xF6, 0xF7, 0xE5, 0x34, 0x4A, 0x14,
-  0xBD, 0xC9, 0x52, 0xA1, 0xED, 0x6D, 0x2C, 0x55, 0x23, 0xAC, 0xCB, 0xF7, 0xB3, 0x1A, 0x05, 0x62,
-  0x41, 0x5B, 0x2A, 0xDE, 0x19, 0x9C, 0x26, 0x55, 0xB8, 0xC1, 0x08, 0x2A, 0x8C, 0x17, 0xC9, 0xEF,
-  0x51, 0xC7, 0xD6, 0x78, 0x68, 0x32, 0x01, 0x66, 0xBD, 0x13, 0x7A, 0xF1, 0x7D, 0x2D, 0xCD, 0x3E,
-  0xD0, 0xC9, 0x6E, 0xD3, 0xE5, 0xDB, 0x31, 0xF6, 0x9C, 0x9B, 0xC6, 0x6D, 0x10, 0xBC, 0xD0, 0x2A,
-  0xAA, 0x28, 0xF7, 0x2D, 0xF5, 0xAB, 0x0B, 0x4A, 0xD8, 0xAE, 0x1A, 0xA1, 0xBD, 0x4B, 0xB4, 0xE4,
-  0xCE, 0xE9, 0xFD, 0xAE, 0x7A, 0xE4, 0x7C, 0xA3, 0x07, 0xB1, 0x5F, 0x87, 0x21, 0x38, 0x07, 0x06,
-  0x00, 0x6F, 0x19, 0x1F, 0xD8, 0x3D, 0x17, 0x05, 0x02, 0x3E, 0xE7, 0xC1, 0xFE, 0xAC, 0x99, 0xD6,
-  0x8C, 0xBC, 0x25, 0x95, 0x40, 0x52, 0x2A, 0x3C, 0x68, 0x8E, 0x50, 0xC5, 0x04, 0x31, 0xBA, 0xBB,
-  0xB7, 0xB4, 0xDE, 0x46, 0x3F, 0x65, 0x77, 0xFF, 0xA1, 0xDD, 0x8D, 0xAE, 0x92, 0x30, 0x02, 0xDF,
-  0xE8, 0x03, 0x05, 0xD8, 0x26, 0xA2, 0xD7, 0xB7, 0x8E, 0x17, 0xB7, 0xDB, 0xED, 0xBA, 0x12, 0xAD,
-  0x90, 0x23, 0x83, 0xF6, 0x08, 0x4C, 0x19, 0x7E, 0x99, 0xED, 0xE8, 0x73, 0x49, 0x7C, 0xE2, 0x94,
-  0x7D, 0xA2, 0xE6, 0x9A, 0xE3, 0x97, 0x85, 0x4D, 0x83, 0x58, 0x1F, 0x1C, 0xA5, 0x58, 0xBD, 0xE3,
-  0xA7, 0x0E, 0x5E, 0xDF, 0xF9, 0x86, 0xDD, 0x69, 0xB7, 0xB5, 0x80, 0x0B, 0xE3, 0x46, 0x64, 0x2D,
-  0xCD, 0x8C, 0xD1, 0x2A, 0x62, 0x7C, 0x4B, 0x03, 0x82, 0x2C, 0xCD, 0xB9, 0x6A, 0x60, 0x5E, 0x2B,
-  0x52, 0xEF, 0x37, 0x2D, 0x72, 0xAD, 0x67, 0xF1, 0xAB, 0x3D, 0x8B, 0x5C, 0xEF, 0x59, 0xF4, 0x8A,
-  0xCF, 0xE2, 0xD7, 0x7C, 0x16, 0xBB, 0xEA, 0xB3, 0xC8, 0x75, 0x9F, 0x45, 0xAF, 0xFC, 0x2C, 0x76,
-  0xED, 0x67, 0xD1, 0xAB, 0x3F, 0xCB, 0xB8, 0xFE, 0x33, 0xDF, 0x15, 0xA0, 0x64, 0xF5, 0x4A, 0xEF,
-  0x51, 0xC2, 0xE4, 0xE4, 0x75, 0xFF, 0x09, 0xD6, 0xA6, 0x9F, 0x6B, 0xE9, 0xB0, 0x6A, 0xF6, 0x87,
-  0x52, 0x96, 0x96, 0xD4, 0x12, 0xD6, 0x5B, 0x4B, 0xCA, 0xE5, 0x64, 0xD4, 0x88, 0xD3, 0xAB, 0x3B,
-  0xBD, 0xC6, 0xAB, 0xF3, 0xBE, 0x65, 0x8F, 0x9D, 0xD0, 0xF2, 0xEB, 0xAF, 0xC4, 0xDE, 0x0C, 0x64,
-  0x62, 0xC4, 0x52, 0xD5, 0xCC, 0xDC, 0xF4, 0x80, 0x7A, 0x47, 0xC1, 0x74, 0x2E, 0xA4, 0x6F, 0xDE,
-  0x9E, 0xED, 0xF7, 0x73, 0xE9, 0x6D, 0x1A, 0x0B, 0xAA, 0xED, 0xF2, 0x4B, 0x99, 0xEA, 0x57, 0x04,
-  0x25, 0x83, 0x5E, 0x15, 0x99, 0x9B, 0x00, 0x03, 0x1D, 0x60, 0x2F, 0xC8, 0x6E, 0xFA, 0x27, 0x75,
-  0x54, 0x59, 0x49, 0x85, 0x69, 0x65, 0xC5, 0x14, 0x10, 0x9B, 0x28, 0x64, 0xFB, 0x9B, 0xB9, 0xCB,
-  0x8B, 0xBD, 0x3E, 0xF0, 0xE2, 0x53, 0x67, 0x92, 0xDE, 0x15, 0x1E, 0x7B, 0x3E, 0xFC, 0xE3, 0xDC,
-  0xB5, 0xC8, 0x15, 0x2B, 0x51, 0xEE, 0xF9, 0xB7, 0x12, 0x8D, 0x70, 0x72, 0xA4, 0x4C, 0x66, 0x79,
-  0x1C, 0x9B, 0x64, 0xD4, 0xE2, 0xD4, 0x8D, 0x9D, 0xE8, 0x2B, 0x2F, 0xE0, 0x80, 0xB4, 0x42, 0x94,
-  0x1F, 0x7E, 0x0C, 0x4B, 0x5E, 0x20, 0xCA, 0x26, 0x1E, 0x2A, 0x8B, 0x0F, 0x7B, 0x88, 0x9E, 0x7F,
-  0x68, 0x30, 0x20, 0xBF, 0x92, 0x46, 0x97, 0xBC, 0x78, 0xC1, 0x71, 0x35, 0x9B, 0x38, 0x4A, 0x9D,
-  0xA6, 0x31, 0x3A, 0x05, 0xF9, 0x01, 0xEC, 0x49, 0x07, 0x94, 0xB6, 0x4A, 0xAF, 0xCA, 0xC6, 0xB3,
-  0x68, 0x10, 0x32, 0x1E, 0x2F, 0x99, 0xC5, 0x40, 0xD1, 0x8B, 0xF2, 0xB2, 0x0B, 0xF4, 0xDF, 0x12,
-  0x95, 0x1A, 0xE1, 0xEB, 0x82, 0xEC, 0xBD, 0xC9, 0x09, 0xA8, 0x64, 0xDC, 0xFC, 0x19, 0x83, 0x95,
-  0x44, 0xB7, 0x2A, 0x69, 0x55, 0xD8, 0xA3, 0x8A, 0x7A, 0x1C, 0xF9, 0x4E, 0x9A, 0x47, 0x25, 0xE9,
-  0x1A, 0x56, 0xB2, 0xAC, 0xFC, 0x69, 0xC6, 0x30, 0x97, 0xC6, 0xFC, 0x19, 0x5E, 0xD8, 0xA1, 0x0A,
-  0x38, 0xE9, 0x1E, 0x25, 0x49, 0xD7, 0xF2, 0x4D, 0x66, 0x61, 0xC3, 0x60, 0x77, 0x9E, 0xC1, 0xCF,
-  0x73, 0xC1, 0x7A, 0xF2, 0xAE, 0xEF, 0x93, 0x3C, 0x81, 0x0D, 0x55, 0x18, 0x9A, 0xC9, 0x78, 0xEB,
-  0xCD, 0xAA, 0x3E, 0x72, 0x69, 0xBC, 0xAD, 0x69, 0xDE, 0xBC, 0x49, 0x46, 0x14, 0x89, 0x54, 0x9E,
-  0xD8, 0xBC, 0x66, 0xBD, 0x20, 0x53, 0xFF, 0xAB, 0x8F, 0x89, 0x60, 0x76, 0x7E, 0x36, 0x59, 0x41,
-  0x86, 0xD8, 0x9E, 0x06, 0x7D, 0xC1, 0x4E, 0x77, 0x51, 0xF8, 0x6D, 0xA5, 0x7B, 0x78, 0xE2, 0x5B,
-  0xC8, 0x82, 0x34, 0x42, 0xF8, 0x99, 0x3C, 0x21, 0xFE, 0xE9, 0x3A, 0x9F, 0x3B, 0x4D, 0xB8, 0xA8,
-  0x28, 0xF2, 0x2C, 0x2F, 0x37, 0xEC, 0x58, 0x64, 0x8F, 0xA7, 0x7A, 0x9C, 0x5D, 0xF8, 0x58, 0xBB,
-  0x3F, 0xA4, 0xEF, 0x0F, 0xE9, 0xB3, 0x4B, 0x5F, 0x46, 0x56, 0x7E, 0xD9, 0xD5, 0x14, 0x5E, 0x61,
-  0xFF, 0xB9, 0xEE, 0x8C, 0xC8, 0x18, 0xF9, 0xC0, 0x2E, 0x1D, 0xFE, 0x24, 0xDD, 0x2F, 0x54, 0xF2,
-  0x2A, 0x1D, 0x93, 0x10, 0x36, 0x63, 0xB8, 0xF2, 0xA4, 0x13, 0x6A, 0xBE, 0x99, 0x92, 0xCB, 0xF6,
-  0x79, 0xC9, 0xD0, 0x06, 0x41, 0xE4, 0x23, 0xC3, 0x85, 0xCC, 0x25, 0xF8, 0xF6, 0xD9, 0x0D, 0xB5,
-  0x65, 0xAC, 0x6D, 0xC9, 0x99, 0x88, 0xE5, 0x60, 0x05, 0xAD, 0x8D, 0x70, 0x44, 0x63, 0x1C, 0x2D,
-  0x7E, 0xBD, 0x34, 0x59, 0x5E, 0x8D, 0x5C, 0x6B, 0x69, 0x1E, 0x13, 0x7D, 0x65, 0x4D, 0x57, 0x44,
-  0x31, 0x41, 0x18, 0xAA, 0x86, 0xAC, 0xD3, 0xB2, 0x11, 0x91, 0x66, 0x21, 0x31, 0xB4, 0x5A, 0x21,
-  0x30, 0xA8, 0x54, 0x04, 0x2D, 0x7B, 0xD9, 0x85, 0xA7, 0xDA, 0x8C, 0x44, 0xB0, 0x2D, 0xE7, 0xAF,
-  0xE8, 0x7E, 0xD6, 0xEA, 0xCB, 0xA4, 0x88, 0x49, 0xCD, 0xBE, 0x39, 0xCD, 0xBD, 0x24, 0xAE, 0x8E,
-  0x1B, 0x74, 0xA8, 0x43, 0x14, 0x73, 0x2E, 0xFD, 0x13, 0x8F, 0x4B, 0x6A, 0x3F, 0xC6, 0x78, 0xE3,
-  0x5A, 0x2F, 0x35, 0x88, 0x76, 0x73, 0x73, 0xDE, 0xCC, 0x6D, 0xEF, 0xCF, 0xA5, 0x78, 0xF2, 0x46,
-  0x47, 0x9C, 0x4E, 0x2C, 0x77, 0x78, 0x64, 0xD8, 0xA3, 0x3E, 0x4A, 0x69, 0x30, 0x24, 0xB3, 0xBD,
-  0xFF, 0xF1, 0xCF, 0xA2, 0xB3, 0xF3, 0x58, 0x97, 0x1E, 0x40, 0x6A, 0x99, 0xCA, 0x66, 0xE3, 0x99,
-  0xF2, 0x10, 0x3A, 0x67, 0x92, 0x48, 0xDA, 0xDF, 0x96, 0x64, 0xB3, 0x5D, 0x8C, 0xFA, 0xF6, 0xF9,
-  0x2F, 0xF8, 0x7A, 0xC1, 0x13, 0xE5, 0xDD, 0x34, 0x5E, 0xFC, 0xB9, 0xF3, 0x45, 0xCA, 0x3D, 0x7E,
-  0xF3, 0xA2, 0x33, 0xE7, 0xAC, 0xC1, 0x1D, 0x8D, 0xB2, 0xBC, 0xD9, 0xE4, 0x65, 0xB2, 0xFA, 0x0B,
-  0xD8, 0xE2, 0x68, 0x1F, 0xF6, 0x30, 0x4D, 0x53, 0xD3, 0x06, 0xBC, 0x5B, 0x02, 0xBC, 0xAB, 0x03,
-  0xEF, 0x9A, 0xC0, 0xBB, 0x45, 0xC0, 0x7B, 0x25, 0xC0, 0x7B, 0x3A, 0xF0, 0x9E, 0x09, 0xBC, 0x57,
-  0x04, 0x7C, 0xBD, 0x04, 0xF8, 0xBA, 0x0E, 0x7C, 0xDD, 0x04, 0xBE, 0x9E, 0x00, 0xFF, 0x17, 0x10,
-  0x59, 0x25, 0x95, 0xC7, 0x4D, 0x10, 0x81, 0xA8, 0x4E, 0xE1, 0x57, 0xF8, 0x37, 0x1C, 0xB5, 0x88,
-  0x4F, 0xA9, 0x1B, 0x95, 0xC8, 0xB1, 0x70, 0xC9, 0x60, 0x5B, 0x21, 0xC5, 0xED, 0x38, 0x78, 0x83,
-  0xAF, 0x6B, 0x02, 0x64, 0xDA, 0x68, 0xA6, 0x69, 0xD4, 0x01, 0x64, 0x53, 0x37, 0x63, 0x92, 0x19,
-  0x80, 0x38, 0x33, 0x61, 0xD3, 0xE9, 0x66, 0x3D, 0x55, 0x1E, 0x5D, 0x65, 0xC7, 0x9E, 0x2A, 0x8F,
-  0x8D, 0x6D, 0xF5, 0x73, 0x82, 0x90, 0x91, 0xDF, 0x4C, 0x23, 0x2E, 0x2C, 0xD9, 0xED, 0x11, 0xF1,
-  0x9C, 0x63, 0x36, 0xFB, 0xB8, 0xE5, 0xDB, 0x48, 0xFA, 0x79, 0xA2, 0xE5, 0x1C, 0x90, 0x8D, 0x23,
-  0xE3, 0x52, 0x95, 0x01, 0x17, 0x15, 0xB3, 0x5E, 0x35, 0x2D, 0xC6, 0xCB, 0x73, 0xBB, 0x2D, 0xD8,
-  0xC8, 0xF4, 0x2A, 0x0C, 0x30, 0xDF, 0xDD, 0x74, 0x95, 0x53, 0xE0, 0x5F, 0x7F, 0x25, 0xFC, 0x63,
-  0x2F, 0xFD, 0x98, 0x99, 0x0D, 0xDD, 0xF9, 0xA7, 0x03, 0x00, 0xFE, 0x69, 0x3D, 0x2B, 0x5D, 0xBB,
-  0x13, 0x14, 0x79, 0x61, 0xF3, 0x45, 0x6B, 0x27, 0xB9, 0xB8, 0x2E, 0xF0, 0x3D, 0xA2, 0x9E, 0x8E,
-  0x4F, 0xC9, 0x09, 0x2F, 0xE7, 0x40, 0xD1, 0x0C, 0x66, 0x79, 0xD6, 0xDF, 0x05, 0x2F, 0x1D, 0x3C,
-  0xFE, 0xBA, 0x3F, 0x12, 0x97, 0x9C, 0x74, 0x03, 0x52, 0x2F, 0xCB, 0x66, 0x63, 0xAF, 0xC9, 0x22,
-  0xB2, 0x3F, 0x81, 0x15, 0x86, 0xBA, 0xDA, 0x79, 0x1C, 0xCB, 0x4B, 0xC2, 0x5F, 0xF1, 0xE4, 0xD8,
-  0xD0, 0x63, 0x6B, 0x4D, 0xF5, 0x69, 0x60, 0x62, 0x6F, 0x50, 0xB6, 0xBA, 0x2D, 0xD3, 0xED, 0xF7,
-  0x77, 0x1A, 0x06, 0x29, 0x17, 0x72, 0xBA, 0xDF, 0xC9, 0xB6, 0x91, 0x39, 0x4D, 0x58, 0xE7, 0xFE,
-  0xD5, 0x12, 0xB3, 0xA8, 0x4C, 0xB1, 0xA5, 0x64, 0xF9, 0x9E, 0x19, 0xF2, 0xB3, 0x31, 0x75, 0x32,
-  0xE3, 0xAD, 0xF3, 0x29, 0x35, 0xFC, 0xB1, 0x2F, 0x67, 0xA7, 0xC7, 0xFB, 0x97, 0x3C, 0x23, 0x8E,
-  0xE4, 0x72, 0xD7, 0x56, 0xA3, 0x5F, 0x5E, 0xE3, 0x5D, 0x69, 0x8D, 0xDF, 0x94, 0x1A, 0x1B, 0x96,
-  0x1A, 0x17, 0xA7, 0x87, 0x3A, 0x8C, 0x6C, 0x07, 0x45, 0x94, 0xDE, 0xBF, 0x50, 0x1F, 0xD5, 0x1A,
-  0x17, 0xBF, 0x9F, 0x5E, 0x5E, 0xEC, 0x7F, 0xF8, 0xBD, 0xB8, 0x46, 0xFF, 0xE5, 0xC5, 0xC1, 0xEF,
-  0x26, 0xA3, 0x32, 0x9C, 0xC2, 0xE7, 0x9A, 0xAC, 0x53, 0x5F, 0x79, 0xCB, 0xA9, 0xB3, 0x89, 0x9B,
-  0xD5, 0x02, 0x6C, 0xEA, 0x93, 0x4F, 0xE5, 0xD5, 0x9E, 0x1A, 0xD5, 0x3A, 0xD6, 0x6A, 0xCF, 0xAA,
-  0x41, 0x7B, 0x66, 0x81, 0x66, 0xAB, 0xB7, 0x5D, 0x0D, 0xDC, 0x76, 0x25, 0xE2, 0xBA, 0xBD, 0x4A,
-  0xD0, 0xBA, 0xBD, 0x4A, 0xD0, 0x7A, 0xEB, 0x1D, 0x13, 0x9A, 0xB5, 0x13, 0xEC, 0xAD, 0xAF, 0x4E,
-  0x05, 0x88, 0xFC, 0x51, 0xB0, 0x6C, 0x45, 0xCB, 0xF0, 0x83, 0x91, 0x85, 0x97, 0xDE, 0x6E, 0x3D,
-  0x37, 0xBE, 0xC1, 0xB6, 0xD5, 0x45, 0xA0, 0x53, 0x4D, 0x06, 0x7A, 0x4B, 0x95, 0x81, 0xDE, 0x72,
-  0x65, 0xA0, 0xB7, 0x54, 0x19, 0xE8, 0xFD, 0xB3, 0xC9, 0x00, 0x98, 0x78, 0x98, 0xF3, 0x27, 0x75,
-  0x92, 0x45, 0x59, 0xEF, 0x11, 0x4F, 0x9A, 0x92, 0x82, 0x60, 0x8F, 0xC8, 0xEE, 0x64, 0xEB, 0x7C,
-  0x34, 0xEA, 0x7C, 0xB4, 0xD4, 0xF9, 0x64, 0xD4, 0xF9, 0xA4, 0xA9, 0x6E, 0xA0, 0x46, 0x26, 0x12,
-  0x2F, 0xA4, 0x28, 0xEB, 0xCF, 0x52, 0x9E, 0x11, 0x2E, 0xF7, 0x57, 0x29, 0xEF, 0xFE, 0x1A, 0x95,
-  0x5F, 0xEF, 0x1F, 0x5F, 0xEE, 0x9F, 0x1F, 0x5A, 0xEA, 0xEE, 0x8F, 0x62, 0x31, 0x18, 0x7A, 0x3C,
-  0xD4, 0xD8, 0x09, 0xBF, 0x6A, 0xC1, 0x50, 0xDD, 0x92, 0x88, 0xA7, 0x92, 0xE6, 0x3D, 0x5B, 0x73,
-  0xBE, 0xEF, 0x10, 0xF8, 0x1D, 0xF7, 0x6F, 0xD3, 0x28, 0x06, 0x4A, 0x1B, 0x66, 0x7E, 0x73, 0xB4,
-  0x3F, 0xCE, 0xE8, 0x2D, 0xAC, 0x7C, 0x09, 0xCB, 0x32, 0xC1, 0x43, 0x69, 0x1D, 0x8B, 0x6D, 0x45,
-  0xEF, 0xBC, 0xD8, 0x08, 0x77, 0x60, 0x2F, 0x34, 0xD4, 0xC6, 0x8E, 0xE7, 0x9F, 0xB3, 0x08, 0xAC,
-  0x9D, 0x24, 0x87, 0xB4, 0x78, 0xA5, 0xE7, 0xC4, 0x3F, 0x0F, 0x03, 0x3C, 0x9D, 0x4F, 0xE2, 0x8D,
-  0x4C, 0x9C, 0x08, 0x75, 0xDF, 0x77, 0x55, 0x83, 0x2E, 0x79, 0x4D, 0xDC, 0x9A, 0xC5, 0x3D, 0x25,
-  0xC3, 0x9A, 0xC7, 0xDD, 0x78, 0x86, 0x5C, 0xE6, 0x8E, 0x46, 0x33, 0x57, 0x42, 0x50, 0x61, 0x0B,
-  0x74, 0xF6, 0x8E, 0xF0, 0xAF, 0xD9, 0x8E, 0x18, 0x9D, 0x4C, 0xDF, 0xE1, 0x96, 0x4F, 0x49, 0x80,
-  0xD1, 0x87, 0xCF, 0x0B, 0xDD, 0x50, 0xEE, 0xBD, 0x3D, 0xEE, 0x9F, 0xAF, 0xF7, 0xC8, 0x0D, 0x7B,
-  0x6D, 0x88, 0xBD, 0x63, 0x0E, 0x85, 0x21, 0x7F, 0xC6, 0x1C, 0xDF, 0x9A, 0x60, 0x7E, 0x18, 0x4C,
-  0x2B, 0x90, 0x32, 0x87, 0x5C, 0x87, 0xC1, 0x98, 0xEC, 0x9F, 0xF3, 0x06, 0x43, 0x32, 0x01, 0xAA,
-  0xD4, 0x44, 0xD5, 0xD9, 0xD7, 0xD0, 0x93, 0x2C, 0x91, 0x47, 0x40, 0x49, 0x38, 0xF6, 0x7C, 0xB0,
-  0xB0, 0x6F, 0x3C, 0x30, 0x40, 0xD5, 0x87, 0x2B, 0xB8, 0xB3, 0x38, 0x08, 0x3D, 0x30, 0x7E, 0x9C,
-  0x11, 0x7F, 0xD8, 0x42, 0x6E, 0xBF, 0xCC, 0xD4, 0xF9, 0xBF, 0xEC, 0x12, 0x7F, 0x3A, 0x1A, 0x35,
-  0xCD, 0x0D, 0x8A, 0x99, 0x4D, 0x5F, 0x67, 0x64, 0x51, 0x50, 0x06, 0xBE, 0x76, 0xD5, 0x87, 0x3F,
-  0xDD, 0x5F, 0x8A, 0xAF, 0x54, 0xA8, 0xEF, 0x01, 0xBC, 0xE7, 0xC7, 0x4C, 0x04, 0xFE, 0x0F, 0xFC,
-  0x01, 0x66, 0xD9, 0x5E, 0x8B, 0xB7, 0x6D, 0x88, 0xF4, 0xA7, 0xC9, 0x3F, 0xC0, 0x66, 0x43, 0x3B,
-  0x59, 0x66, 0x19, 0x7B, 0xF9, 0x4D, 0xEB, 0x68, 0x7A, 0x35, 0xF6, 0x62, 0xF9, 0xCE, 0x1D, 0x3E,
-  0x3F, 0x07, 0x93, 0x8C, 0xBD, 0x4C, 0xF1, 0xB9, 0xF3, 0x25, 0xF5, 0x96, 0xA1, 0xBB, 0x59, 0x78,
-  0xCC, 0xF0, 0xE5, 0x15, 0x74, 0xEF, 0xAB, 0xC1, 0x2A, 0xB2, 0xB8, 0xED, 0x4C, 0x26, 0x7C, 0x32,
-  0x65, 0xC1, 0xB6, 0x18, 0xDA, 0x66, 0x0A, 0xD3, 0xF9, 0x9B, 0x73, 0x27, 0xE0, 0xFD, 0x7E, 0xFA,
-  0xE6, 0x75, 0x8C, 0xA1, 0xDA, 0xB0, 0xBB, 0x48, 0x9F, 0x62, 0xC1, 0x0A, 0xED, 0x00, 0x00, 0x36,
-  0x6A, 0xE7, 0x6F, 0xC1, 0x6C, 0x04, 0x2E, 0xAE, 0x4D, 0x59, 0x8F, 0x6A, 0x6A, 0x0D, 0x36, 0x95,
-  0x24, 0x05, 0xEA, 0xCB, 0x5A, 0x3A, 0x17, 0x2C, 0xDB, 0x33, 0xCC, 0x11, 0xCF, 0x0B, 0x3D, 0x74,
-  0xCA, 0x4F, 0xB4, 0x58, 0x49, 0xE3, 0x55, 0x95, 0xDC, 0xD7, 0xDE, 0x35, 0x0D, 0x5C, 0x8C, 0x90,
-  0x3D, 0x47, 0x96, 0x0F, 0x34, 0x33, 0x71, 0xF9, 0x34, 0xCB, 0x7B, 0xF7, 0x3E, 0x6F, 0xF2, 0x6A,
-  0x08, 0x82, 0x70, 0x48, 0xE3, 0x73, 0xC7, 0x0B, 0xA9, 0xCB, 0x94, 0xA9, 0xBE, 0x64, 0x5C, 0xC5,
-  0xFE, 0x4B, 0x56, 0x83, 0x97, 0x59, 0x58, 0xC4, 0x1E, 0x69, 0x63, 0x85, 0x0C, 0x56, 0x10, 0xC7,
-  0xD4, 0x6F, 0x2B, 0xC1, 0x05, 0x79, 0x6F, 0x77, 0x9F, 0xF1, 0x77, 0x69, 0xAC, 0x9B, 0x59, 0x86,
-  0xF1, 0x38, 0x9A, 0x9C, 0xF1, 0x67, 0xC3, 0x23, 0x8B, 0xBA, 0x05, 0xC2, 0x2E, 0x94, 0x87, 0xCE,
-  0x34, 0xA2, 0x8B, 0x5F, 0x40, 0xAB, 0xB1, 0x76, 0x6C, 0xB3, 0x29, 0xE2, 0x54, 0xF3, 0x36, 0xD5,
-  0x2A, 0x9C, 0x94, 0x84, 0x64, 0xA3, 0xEB, 0xB8, 0x2E, 0x7B, 0x5A, 0x08, 0x3D, 0x1B, 0xD4, 0xC7,
-  0x3C, 0xBC, 0x47, 0x6F, 0x4F, 0x41, 0xF7, 0xC6, 0xF8, 0x8D, 0x3F, 0xE3, 0xD6, 0x22, 0x0D, 0x8A,
-  0x55, 0x9A, 0x64, 0x77, 0x4F, 0xDD, 0x3A, 0x0B, 0x86, 0x55, 0xD8, 0x35, 0x67, 0xE3, 0x69, 0xEB,
-  0xEA, 0xD3, 0x36, 0xEC, 0x60, 0x1C, 0x4D, 0x13, 0x76, 0x46, 0x00, 0xBF, 0x70, 0xC8, 0xC9, 0xC6,
-  0xD8, 0x43, 0x6F, 0xBF, 0x73, 0x07, 0xBF, 0xE8, 0x3B, 0x64, 0x5E, 0xED, 0xB3, 0xF7, 0xA5, 0x1D,
-  0xF8, 0x83, 0x91, 0x37, 0xC0, 0x78, 0x9D, 0x84, 0xB7, 0x8D, 0xEC, 0x0D, 0x03, 0x2D, 0xD2, 0x3C,
-  0xE7, 0x72, 0x79, 0xDE, 0xC3, 0x6D, 0x59, 0x3E, 0x71, 0x78, 0x38, 0xE1, 0xAD, 0x28, 0x2D, 0x80,
-  0xFA, 0x74, 0xA0, 0x1A, 0x77, 0xED, 0x0E, 0x59, 0xCB, 0xC5, 0xA7, 0xF8, 0x6F, 0xBE, 0xAB, 0xB3,
-  0xDD, 0x0A, 0x72, 0x19, 0xC4, 0xA5, 0x58, 0x8B, 0x68, 0x53, 0xBA, 0x60, 0x21, 0xCE, 0x92, 0xA9,
-  0x75, 0x66, 0xD2, 0x66, 0xCF, 0xFA, 0xCA, 0xF5, 0x47, 0x24, 0xEA, 0xD9, 0x2F, 0x77, 0x70, 0xFD,
-  0xC1, 0x4C, 0xBC, 0xDC, 0xEC, 0x02, 0xB6, 0x9E, 0xC8, 0x87, 0xF2, 0x16, 0xEE, 0x86, 0x04, 0x54,
-  0xD8, 0x87, 0x1C, 0xFA, 0xD2, 0x0E, 0xE4, 0x77, 0xD2, 0xD2, 0x87, 0xE2, 0x14, 0x9F, 0x73, 0xF7,
-  0x68, 0xAE, 0xCC, 0xA1, 0xBC, 0x7F, 0x68, 0xF0, 0x17, 0x75, 0x6F, 0x98, 0xD8, 0xFE, 0xF3, 0x77,
-  0x8F, 0xBF, 0x18, 0xB8, 0xEC, 0xDE, 0xBD, 0x52, 0x83, 0x3B, 0xCD, 0xCE, 0x71, 0xE2, 0xF3, 0x3B,
-  0xC7, 0x3B, 0x9F, 0xED, 0x5C, 0x26, 0xB1, 0x4B, 0x5E, 0x5A, 0x9A, 0x5A, 0xD3, 0xFE, 0x08, 0x68,
-  0xEE, 0xE3, 0x76, 0x72, 0x1E, 0x6F, 0x75, 0xDB, 0x1B, 0xA5, 0x89, 0x33, 0x1F, 0x30, 0x69, 0xCE,
-  0x4C, 0xB4, 0x6E, 0xB7, 0x3B, 0x73, 0x24, 0xF9, 0xAC, 0x02, 0xBA, 0x93, 0x0F, 0xD9, 0x22, 0x58,
-  0xB6, 0x7C, 0x8E, 0x73, 0xCB, 0x53, 0x41, 0x72, 0x48, 0xFB, 0x1C, 0x51, 0xD2, 0x22, 0xCD, 0x78,
-  0x5F, 0x8C, 0x8B, 0x61, 0x85, 0xF6, 0x79, 0xBD, 0x4D, 0xF2, 0x3A, 0x2C, 0xA3, 0xB7, 0x45, 0x49,
-  0x22, 0x8C, 0xDE, 0xF2, 0xAA, 0xF3, 0xF7, 0xB6, 0xB8, 0xBD, 0xA5, 0xB7, 0xC6, 0x71, 0xC7, 0xE2,
-  0x3D, 0xCE, 0x02, 0xCC, 0xE9, 0xB5, 0xE5, 0x40, 0x85, 0x3F, 0xFA, 0xC8, 0xD3, 0x1B, 0x64, 0x9E,
-  0x2A, 0x2E, 0x64, 0x41, 0x29, 0x30, 0x6B, 0x5E, 0x24, 0x95, 0x1D, 0xD9, 0x87, 0x44, 0xE7, 0x66,
-  0x44, 0x16, 0x54, 0x12, 0x30, 0xD3, 0xB1, 0x8F, 0xBD, 0x6C, 0x71, 0xE0, 0x4C, 0xDD, 0x23, 0xE3,
-  0xC9, 0x43, 0x43, 0xB5, 0xAA, 0x57, 0x10, 0x4B, 0xE5, 0xA4, 0x02, 0x45, 0x5D, 0xBB, 0x0A, 0xAF,
-  0x42, 0x91, 0x58, 0xC9, 0x66, 0xA2, 0x68, 0x5E, 0x5C, 0x33, 0xF4, 0x5E, 0x1F, 0xD6, 0x7B, 0xB0,
-  0xB8, 0xBD, 0xC1, 0x29, 0x2C, 0x38, 0x8B, 0x8D, 0xA9, 0x0E, 0x87, 0xB3, 0x0F, 0x83, 0x44, 0xE4,
-  0x9D, 0x04, 0x2E, 0xFD, 0xFC, 0x36, 0xD5, 0xCB, 0x29, 0xBB, 0xE7, 0x5C, 0x28, 0xFA, 0x2A, 0x40,
-  0xB5, 0xD5, 0x31, 0xBF, 0xE7, 0x92, 0xDD, 0xB7, 0x7E, 0x70, 0x42, 0x9F, 0xBD, 0x15, 0x78, 0xC4,
-  0x5B, 0x12, 0xD6, 0x94, 0x65, 0x05, 0x81, 0x6D, 0x0D, 0xC6, 0x68, 0xEE, 0x4F, 0xE3, 0x60, 0x1C,
-  0xC4, 0xDE, 0x37, 0xDA, 0x26, 0x22, 0xD5, 0x17, 0x87, 0x49, 0xBC, 0x88, 0x5C, 0xC1, 0x3E, 0x1B,
-  0x9D, 0x8A, 0x6E, 0x9A, 0xC8, 0x31, 0xAD, 0xAF, 0xC3, 0x6C, 0xD7, 0x66, 0x98, 0x75, 0x33, 0xF5,
-  0xA3, 0x56, 0x41, 0x23, 0x19, 0x2C, 0xFC, 0x63, 0xC4, 0x7E, 0xFA, 0x11, 0xCB, 0xCF, 0x00, 0xB8,
-  0xE0, 0x5A, 0x52, 0x9A, 0x5A, 0xD0, 0xAE, 0x4D, 0x27, 0x13, 0xF9, 0xFC, 0xFA, 0x5C, 0xEA, 0xA8,
-  0xBC, 0xB9, 0x85, 0x07, 0xE6, 0xDD, 0xFE, 0x05, 0x7B, 0x5E, 0x31, 0x55, 0x40, 0xAE, 0x06, 0x3E,
-  0xA2, 0xB1, 0xE3, 0x8D, 0xA2, 0x19, 0x7B, 0x3E, 0x0B, 0x20, 0x8D, 0x07, 0xEA, 0xDB, 0xD4, 0x73,
-  0xF7, 0x5C, 0x05, 0x92, 0xBF, 0x60, 0x0A, 0x2F, 0x35, 0xD6, 0x2D, 0xEF, 0x64, 0x21, 0xE8, 0xAE,
-  0x9D, 0x9B, 0xC5, 0xA0, 0x6D, 0x26, 0x94, 0xE2, 0x50, 0x5B, 0x82, 0xFD, 0xA4, 0x43, 0x2B, 0xD0,
-  0x47, 0x86, 0x2F, 0x6F, 0x31, 0xE3, 0xA9, 0x10, 0x58, 0xA9, 0xF1, 0x64, 0xA6, 0x8F, 0x5A, 0x90,
-  0x07, 0x85, 0x99, 0x8F, 0x14, 0xB9, 0x57, 0x2B, 0xCF, 0x29, 0xF1, 0x95, 0x40, 0x58, 0xFA, 0xAA,
-  0xE5, 0x67, 0x5A, 0xB0, 0xBB, 0x65, 0xB9, 0x9E, 0xCC, 0x1E, 0xA7, 0xF5, 0x17, 0xE9, 0x74, 0x05,
-  0x28, 0x59, 0x27, 0x43, 0xF2, 0x88, 0xC2, 0x1C, 0x9D, 0xD6, 0x0E, 0xEB, 0x32, 0xE0, 0xF5, 0x07,
-  0x13, 0x1E, 0x0A, 0x7C, 0x66, 0x5F, 0xBC, 0x64, 0x34, 0xC6, 0xC9, 0xE9, 0xB2, 0x3B, 0x91, 0x93,
-  0x75, 0x75, 0x6E, 0xF9, 0x2B, 0x49, 0xE3, 0x6A, 0xD3, 0x3A, 0x22, 0x5D, 0x6B, 0x81, 0x7E, 0x50,
-  0x6A, 0xF2, 0x7C, 0xAB, 0xD5, 0xEA, 0xB2, 0x74, 0xA9, 0xA5, 0x6A, 0xA7, 0x40, 0x85, 0xD9, 0x28,
-  0x33, 0xD4, 0x60, 0x31, 0x69, 0xF9, 0x95, 0xB3, 0xB4, 0x59, 0xF5, 0x2B, 0x1B, 0xAC, 0xEF, 0x4D,
-  0xE5, 0x58, 0x03, 0x47, 0xE6, 0xF0, 0xF8, 0x65, 0xC2, 0x7C, 0xEB, 0xA3, 0x9A, 0xBE, 0x37, 0xF8,
-  0x8A, 0xE7, 0x02, 0xEC, 0x2D, 0x74, 0xE9, 0xA8, 0xE1, 0xEF, 0xE0, 0x1E, 0x38, 0xEE, 0x21, 0xA6,
-  0x2A, 0x6A, 0x64, 0xEB, 0xD8, 0x9E, 0x9D, 0x4C, 0xB2, 0x20, 0x29, 0xB5, 0x97, 0xF0, 0xB8, 0xC2,
-  0xA3, 0xBE, 0xE4, 0xF3, 0xA8, 0xAF, 0xF7, 0x3C, 0xDA, 0x8B, 0x3D, 0x39, 0x89, 0x11, 0x34, 0xF3,
-  0x46, 0x5E, 0x29, 0xC6, 0x91, 0x23, 0xCE, 0xD0, 0xF1, 0xFC, 0x48, 0xDC, 0x77, 0x82, 0x79, 0xAD,
-  0x05, 0x43, 0x7A, 0xBE, 0x4B, 0xEF, 0xF4, 0x84, 0x43, 0xEC, 0xF8, 0x68, 0x47, 0x94, 0x24, 0xCF,
-  0xDB, 0x33, 0x71, 0x91, 0x87, 0x47, 0x2B, 0x2B, 0xAC, 0x34, 0x9B, 0x87, 0x3B, 0x24, 0x13, 0x27,
-  0x8C, 0x23, 0x26, 0x75, 0x49, 0xB3, 0xCF, 0xAC, 0xF2, 0x17, 0x79, 0x55, 0x82, 0x98, 0x61, 0xD7,
-  0x52, 0x87, 0x68, 0xB2, 0xA6, 0x98, 0x57, 0x0C, 0x24, 0xDE, 0x87, 0xB0, 0x78, 0x2A, 0xB3, 0x68,
-  0xF0, 0x5C, 0x38, 0x3B, 0x0D, 0x56, 0x48, 0x9D, 0xC5, 0x24, 0xA7, 0xD2, 0x96, 0x57, 0xF0, 0x31,
-  0xAF, 0xE0, 0x93, 0x2D, 0x75, 0x38, 0xFE, 0x5C, 0x85, 0xD4, 0xF9, 0x5A, 0xEC, 0x0B, 0x4D, 0xAF,
-  0x11, 0x32, 0x76, 0xEF, 0x5A, 0xB8, 0xAA, 0x27, 0x1C, 0x57, 0xCB, 0x27, 0xD3, 0xE8, 0xA6, 0xF1,
-  0xA0, 0x7D, 0xD2, 0x33, 0x95, 0xF1, 0x7B, 0x6F, 0x88, 0x08, 0x97, 0x01, 0x33, 0x20, 0x06, 0xF6,
-  0x7A, 0x94, 0x97, 0xEA, 0x41, 0xBF, 0x00, 0x48, 0x04, 0x06, 0x88, 0x7C, 0x77, 0x4A, 0xB0, 0x91,
-  0x3A, 0xA2, 0xDA, 0xDD, 0x23, 0xB2, 0x67, 0xDC, 0xFC, 0xCA, 0x13, 0x21, 0xA8, 0x6B, 0x17, 0x20,
-  0x6C, 0x80, 0xBC, 0x11, 0xE1, 0xBC, 0x52, 0x56, 0x76, 0x9E, 0x18, 0x57, 0xBC, 0x58, 0xF4, 0x43,
-  0xA3, 0x76, 0xC4, 0xA8, 0x27, 0xA3, 0x60, 0xC0, 0x68, 0x64, 0x29, 0x39, 0x92, 0xE6, 0x2B, 0xA4,
-  0xF6, 0x6F, 0xB5, 0x66, 0x5E, 0x96, 0x79, 0x75, 0x48, 0x90, 0x92, 0x01, 0xC5, 0x1E, 0x80, 0x4E,
-  0xB4, 0x1C, 0x7B, 0x96, 0xB3, 0x11, 0x0F, 0xE4, 0x35, 0x85, 0xFE, 0x03, 0x79, 0x98, 0x1B, 0x94,
-  0xC6, 0xB9, 0xD9, 0xFD, 0x92, 0x53, 0xF5, 0x63, 0xA6, 0x6A, 0x2F, 0xAF, 0xEA, 0xA7, 0x4C, 0xD5,
-  0x75, 0xA3, 0xAA, 0x7D, 0xF6, 0x2B, 0x03, 0x6A, 0xCB, 0x67, 0xA1, 0x52, 0x5D, 0x52, 0xE3, 0x63,
-  0x69, 0x8D, 0x4F, 0x79, 0x35, 0x74, 0xD2, 0xB4, 0xD4, 0x0D, 0xC9, 0x6D, 0x53, 0x85, 0xD1, 0xC4,
-  0x09, 0x43, 0xE7, 0xBE, 0x25, 0x04, 0x80, 0x25, 0xDF, 0x1D, 0x07, 0x7E, 0x10, 0x4D, 0x9C, 0x01,
-  0x25, 0xCC, 0x1D, 0xC2, 0xD4, 0xB0, 0x71, 0xCF, 0x34, 0x15, 0x14, 0x25, 0x60, 0x21, 0x57, 0x0C,
-  0xC4, 0xF5, 0x9A, 0x74, 0xE9, 0x47, 0x61, 0xC8, 0x2A, 0x95, 0xCC, 0xCA, 0xC0, 0xED, 0xF6, 0x3C,
-  0xB0, 0x69, 0xF7, 0xD5, 0x2E, 0x63, 0xA0, 0x9F, 0x19, 0xA2, 0xA1, 0x5C, 0x43, 0xC5, 0x18, 0xFD,
-  0x20, 0xA4, 0x6E, 0xAD, 0x28, 0x45, 0x0D, 0xDB, 0x74, 0x2C, 0x8C, 0x56, 0x94, 0x3E, 0x27, 0xBF,
-  0xAF, 0x7D, 0x5C, 0xFB, 0x54, 0xD3, 0xAF, 0x23, 0x59, 0x7A, 0xFF, 0x82, 0x6C, 0x36, 0x33, 0x56,
-  0x58, 0x2E, 0x4F, 0x23, 0xEF, 0xEF, 0x94, 0xD8, 0x54, 0xB3, 0xA6, 0x1D, 0x93, 0x9B, 0x07, 0xE9,
-  0xD2, 0x39, 0xEB, 0x5A, 0x89, 0x13, 0x34, 0x98, 0xB0, 0xB1, 0x57, 0x02, 0x3D, 0x06, 0xB0, 0x8C,
-  0x80, 0x18, 0x88, 0x0B, 0x07, 0x75, 0x5E, 0x41, 0x9D, 0xA6, 0xFC, 0x4B, 0x3B, 0xE6, 0x17, 0xCB,
-  0xB3, 0x2B, 0x5F, 0xA6, 0xA6, 0x9C, 0x43, 0xAC, 0x58, 0x9F, 0x6D, 0xB9, 0x4C, 0xC0, 0x8B, 0x38,
-  0xBC, 0xB9, 0xBE, 0x28, 0xFC, 0xA9, 0x51, 0xFB, 0x5F, 0xF6, 0x46, 0x02, 0x1B, 0xB4, 0xA5, 0xCE,
-  0xE0, 0xA6, 0x61, 0xDF, 0x27, 0xA8, 0x3A, 0xE9, 0x4F, 0x8D, 0xF8, 0xC6, 0x8B, 0x9A, 0xAC, 0x23,
-  0x8D, 0x66, 0xA1, 0x56, 0xF7, 0x75, 0xAD, 0xDE, 0x8E, 0xA6, 0x57, 0x11, 0xB7, 0x4C, 0xD9, 0x0B,
-  0x78, 0x5A, 0x42, 0x3D, 0x05, 0x68, 0xD2, 0x14, 0x16, 0x3C, 0x7E, 0x17, 0x49, 0x6A, 0xB2, 0x64,
-  0x09, 0x94, 0xFA, 0xCA, 0xF8, 0xB0, 0xFE, 0x85, 0x83, 0x48, 0xF7, 0x4C, 0xDF, 0x75, 0x23, 0x5C,
-  0x86, 0xD2, 0x56, 0x33, 0xC4, 0x65, 0xED, 0x32, 0x63, 0x5C, 0xAF, 0x57, 0xC5, 0x20, 0x97, 0x2D,
-  0x96, 0x65, 0x94, 0xA7, 0xF7, 0xC6, 0x9F, 0x3C, 0xCE, 0xDB, 0x87, 0x8F, 0xF9, 0xDC, 0xE1, 0x63,
-  0x3E, 0x71, 0xF8, 0x83, 0xEC, 0xF3, 0x44, 0x82, 0x66, 0xB7, 0xD1, 0x65, 0xD3, 0x59, 0xED, 0xF4,
-  0x44, 0x04, 0x67, 0xB3, 0xD5, 0x0D, 0x74, 0x8A, 0xBD, 0x6E, 0xCC, 0x16, 0xCD, 0x5A, 0x15, 0xD1,
-  0xE9, 0xD6, 0x22, 0x11, 0x8C, 0x6E, 0x2B, 0x93, 0xF2, 0x6A, 0x94, 0x69, 0x52, 0x66, 0x2F, 0xD3,
-  0x25, 0xE3, 0x01, 0x6C, 0x7F, 0x63, 0xC4, 0xAC, 0xF6, 0x7F, 0x52, 0x47, 0xDB, 0x03, 0xFC, 0xF4,
-  0x7C, 0xB2, 0xED, 0x27, 0x24, 0xD1, 0xF9, 0x7B, 0x8A, 0x8C, 0x6A, 0x2D, 0x33, 0x89, 0x4D, 0x01,
-  0x9C, 0xD9, 0x2C, 0x4E, 0x44, 0xF1, 0xE7, 0xD9, 0x5E, 0x24, 0x63, 0x5B, 0x7D, 0x8B, 0x51, 0xC4,
-  0x59, 0xC5, 0x0D, 0xA8, 0x6E, 0xD6, 0x6E, 0x1C, 0x7A, 0x4A, 0xE3, 0x9B, 0xC0, 0xAD, 0x96, 0xB6,
-  0x35, 0xBD, 0x50, 0x91, 0xCD, 0xD9, 0xAA, 0x80, 0x4C, 0xF9, 0xAF, 0xC0, 0x37, 0x8E, 0x47, 0x2C,
-  0xBE, 0xCD, 0x7C, 0x67, 0x98, 0xCD, 0x5B, 0x9C, 0xEB, 0xD6, 0x03, 0x9C, 0xF0, 0x4D, 0xE4, 0x0A,
-  0xC8, 0xBB, 0x7C, 0xD2, 0x24, 0xAB, 0xA4, 0xA1, 0xD4, 0x31, 0x9D, 0xC5, 0xA2, 0xD2, 0x1A, 0xCB,
-  0xDD, 0x0C, 0x23, 0x96, 0xAD, 0x6A, 0x0F, 0x88, 0x92, 0x4D, 0x9A, 0xC5, 0xC4, 0x4B, 0x33, 0x00,
-  0x68, 0x6D, 0xC7, 0x01, 0x8B, 0x5F, 0x6C, 0xAC, 0x97, 0x65, 0xED, 0xCD, 0x67, 0x97, 0xCE, 0x80,
-  0x12, 0x6E, 0x19, 0xBC, 0xB5, 0xB3, 0xCB, 0xA4, 0xB5, 0x09, 0x3C, 0x78, 0x6C, 0x7E, 0x65, 0xEF,
-  0x0B, 0xD9, 0xD9, 0x65, 0x6E, 0xA7, 0x7F, 0x5A, 0xFD, 0x31, 0x1D, 0x9F, 0x8B, 0x76, 0xAC, 0xBD,
-  0xB6, 0xAB, 0x90, 0x18, 0x93, 0x4A, 0x7B, 0xBB, 0x64, 0xCB, 0xB6, 0x68, 0x8F, 0x9C, 0x58, 0x42,
-  0x49, 0x2B, 0xAF, 0x92, 0x0D, 0xE4, 0x64, 0x2F, 0xEB, 0x6B, 0xCE, 0x5F, 0xA4, 0x2D, 0x5B, 0xEA,
-  0x92, 0x7B, 0x60, 0x59, 0x37, 0x80, 0xA4, 0x3A, 0x21, 0x6A, 0x2F, 0x7B, 0x08, 0xAA, 0x6D, 0x96,
-  0xC6, 0xB0, 0x43, 0x94, 0xE4, 0x77, 0x77, 0x94, 0x3F, 0x5F, 0x24, 0x1D, 0x53, 0xBE, 0xEA, 0x21,
-  0xE9, 0x95, 0xA8, 0x5C, 0xD9, 0xD5, 0xEC, 0xF8, 0x14, 0xC1, 0x0A, 0x31, 0x09, 0xCF, 0x86, 0x41,
-  0x7E, 0xCF, 0xE1, 0x44, 0xF6, 0x96, 0x9B, 0x60, 0x05, 0x40, 0x95, 0x64, 0xFF, 0x5C, 0x5C, 0x31,
-  0x29, 0x2E, 0x62, 0x4B, 0x7E, 0x27, 0x2A, 0x73, 0xC8, 0xA2, 0xDA, 0x38, 0x22, 0x45, 0x42, 0xD7,
-  0x2D, 0x82, 0x66, 0x55, 0x23, 0xB6, 0xC6, 0xBD, 0xFC, 0xC6, 0xB9, 0x91, 0xA9, 0x19, 0x20, 0xDD,
-  0x2F, 0x46, 0x5C, 0xF0, 0x3C, 0xB7, 0x0D, 0xE5, 0x75, 0xC1, 0x19, 0xE0, 0xF4, 0x0A, 0x6E, 0x2D,
-  0x6A, 0x70, 0xB4, 0xC3, 0xBA, 0xBC, 0x0C, 0x23, 0x96, 0x29, 0xBD, 0x93, 0x5B, 0x57, 0x9F, 0x23,
-  0x65, 0xF5, 0x12, 0xA9, 0x29, 0xA9, 0x98, 0x0E, 0x77, 0x7E, 0x45, 0x63, 0x68, 0x4B, 0x2B, 0x9A,
-  0xC3, 0x58, 0xF5, 0x21, 0x07, 0xF5, 0xB6, 0x5B, 0xC4, 0x55, 0xBB, 0x64, 0x0C, 0x61, 0x9A, 0x38,
-  0x9B, 0xE8, 0xF9, 0x7B, 0x91, 0xE7, 0x2E, 0x69, 0x3C, 0x97, 0xF7, 0x4E, 0xB7, 0xC1, 0x0A, 0x3D,
-  0x78, 0x8A, 0x46, 0x2E, 0xF2, 0xE2, 0x19, 0xDB, 0x83, 0xCA, 0x9E, 0x3C, 0x9B, 0x74, 0x98, 0x92,
-  0xF3, 0x80, 0x1E, 0xBD, 0x39, 0xD1, 0x27, 0x9E, 0x3D, 0x99, 0x02, 0x77, 0x0D, 0x64, 0xCD, 0xEE,
-  0xE0, 0x33, 0x19, 0x53, 0xD1, 0xC9, 0xA7, 0xB0, 0x5D, 0x77, 0xF4, 0x99, 0x3B, 0xE7, 0x19, 0x9D,
-  0x7D, 0x55, 0x36, 0xDE, 0xCB, 0x74, 0xF8, 0x19, 0xDB, 0xE7, 0xC5, 0x9C, 0x7E, 0x0A, 0x53, 0x66,
-  0x73, 0xFC, 0x25, 0xB3, 0xE5, 0x87, 0x3A, 0xFF, 0x34, 0xF1, 0x50, 0x6D, 0x2B, 0xB4, 0xA2, 0x9E,
-  0x9A, 0xAB, 0xE5, 0xD2, 0x5C, 0x84, 0x99, 0xB5, 0x52, 0xAF, 0xB0, 0x61, 0xB6, 0xD8, 0x34, 0x3F,
-  0x6C, 0x95, 0x81, 0x78, 0xAA, 0xB9, 0x21, 0x4B, 0x95, 0xE1, 0x83, 0x38, 0x3F, 0x15, 0x19, 0xF8,
-  0x9E, 0xB9, 0x2C, 0xAE, 0x79, 0x31, 0x95, 0xBB, 0xAC, 0xDC, 0xDC, 0x86, 0x7F, 0x95, 0x91, 0x6D,
-  0xFF, 0x0D, 0x34, 0x7B, 0xA3, 0x5E, 0x4F, 0x2E, 0xF0, 0x1A, 0x55, 0x5A, 0xE5, 0x55, 0xFE, 0xFA,
-  0xD7, 0x4C, 0x9D, 0x90, 0xC6, 0xD3, 0xD0, 0x67, 0xA6, 0xBA, 0x41, 0xDD, 0x90, 0xC6, 0x78, 0x6D,
-  0x58, 0x53, 0xC5, 0xEC, 0xA6, 0x36, 0xA8, 0x2C, 0x90, 0x1E, 0x59, 0x66, 0x7D, 0xED, 0x2D, 0x53,
-  0x47, 0xEC, 0xB1, 0x14, 0xD7, 0xDD, 0xC9, 0x35, 0x73, 0xD5, 0xC5, 0xCE, 0x15, 0xB9, 0x75, 0x22,
-  0x82, 0x2B, 0x37, 0xC1, 0xAB, 0xC6, 0xD4, 0x6D, 0x11, 0x3E, 0xA5, 0x09, 0x4B, 0x53, 0xCA, 0xEF,
-  0xA2, 0x47, 0x83, 0x10, 0xF3, 0x19, 0x19, 0xBB, 0x9C, 0x11, 0x3D, 0x75, 0x7C, 0x67, 0x48, 0xC3,
-  0x77, 0x58, 0x33, 0x13, 0xF2, 0xCB, 0xDA, 0xEF, 0xBD, 0x88, 0x43, 0xE2, 0x60, 0x2C, 0xCD, 0x6E,
-  0x7D, 0x44, 0xAF, 0xE3, 0x3A, 0x7C, 0xB8, 0xD9, 0x43, 0x4F, 0xC2, 0x8B, 0x35, 0xF8, 0x05, 0xFF,
-  0xE8, 0x83, 0x22, 0x13, 0x7F, 0xB8, 0x7B, 0x2F, 0xD2, 0xA4, 0xE1, 0xBB, 0xDC, 0xDE, 0xB8, 0x0A,
-  0xEE, 0xEA, 0xC4, 0x73, 0x77, 0xEB, 0x88, 0x90, 0x6F, 0xEC, 0xF7, 0x47, 0xA3, 0x3A, 0x61, 0x69,
-  0xB7, 0xE0, 0x6B, 0x10, 0x8E, 0x57, 0x59, 0xC5, 0x55, 0xDE, 0x54, 0xA1, 0x8B, 0xF9, 0x27, 0xEB,
-  0xB0, 0x3C, 0x1E, 0xE2, 0x1D, 0x50, 0x0E, 0x41, 0x92, 0x1C, 0x0C, 0x87, 0x78, 0xD9, 0x13, 0xE8,
-  0x59, 0x43, 0xB4, 0x6B, 0x71, 0x98, 0xFC, 0xC3, 0xE8, 0x56, 0xD4, 0x36, 0x7B, 0x80, 0x1A, 0x3F,
-  0xCA, 0x6C, 0xB8, 0x35, 0x85, 0x95, 0x77, 0xE3, 0xD1, 0x4D, 0x1C, 0x4F, 0x0A, 0x2F, 0x72, 0x2B,
-  0xF5, 0xC4, 0x7D, 0xEE, 0x57, 0xC7, 0xFC, 0x3A, 0x37, 0xAE, 0xC2, 0xEC, 0xB6, 0x79, 0x2D, 0x6B,
-  0x9B, 0xC9, 0x16, 0xEC, 0xB6, 0xAE, 0xAA, 0x27, 0x40, 0xCE, 0x23, 0x7A, 0xE2, 0x0F, 0x82, 0x31,
-  0xAA, 0x11, 0x59, 0x2D, 0xA4, 0xD1, 0x04, 0xCC, 0x09, 0x46, 0x24, 0x4B, 0x41, 0x25, 0x72, 0x16,
-  0x90, 0xC3, 0xFE, 0x6F, 0x3C, 0xCB, 0x00, 0x58, 0x26, 0x01, 0x5B, 0xFC, 0x9F, 0x54, 0x1F, 0x48,
-  0x30, 0xBD, 0xB5, 0xEE, 0x97, 0x2C, 0xA6, 0xBA, 0xD4, 0x29, 0x9B, 0xF5, 0xEF, 0xA6, 0x70, 0x8B,
-  0x44, 0x4B, 0x19, 0xF9, 0x0E, 0xAE, 0x62, 0xC7, 0x03, 0x31, 0x54, 0xCA, 0xAD, 0x32, 0x6E, 0xAD,
-  0x67, 0xCA, 0x39, 0xBF, 0xA7, 0x9A, 0x54, 0x28, 0x88, 0xE6, 0x16, 0xB5, 0x1E, 0x66, 0x84, 0x65,
-  0x52, 0xA9, 0x1F, 0x38, 0xC8, 0x79, 0x5C, 0x80, 0xF1, 0x55, 0xBA, 0x5E, 0x3E, 0x56, 0x07, 0x2C,
-  0xE5, 0x62, 0xF1, 0x78, 0x61, 0x9D, 0xAA, 0x63, 0xC6, 0xEB, 0x96, 0x8C, 0x9B, 0x48, 0x54, 0xF3,
-  0x43, 0xC7, 0x8E, 0xD1, 0xF0, 0x53, 0x8C, 0x5F, 0x86, 0x1B, 0xE5, 0x63, 0xA8, 0x4C, 0xF1, 0xA3,
-  0xE0, 0xD6, 0x47, 0x3F, 0x53, 0x9A, 0x64, 0x81, 0xA9, 0x54, 0xEA, 0xE2, 0xBC, 0xAD, 0x7E, 0x67,
-  0x1F, 0x21, 0x9E, 0x1C, 0x29, 0x9E, 0x54, 0x8E, 0xD6, 0x67, 0x9E, 0xB3, 0xB7, 0xD7, 0x0C, 0x58,
-  0x5F, 0x40, 0x9E, 0x1F, 0xA8, 0x66, 0xCD, 0x9A, 0x4F, 0xC5, 0xC9, 0x57, 0x63, 0x5E, 0xF2, 0x5B,
-  0xFB, 0xF8, 0xA0, 0x2F, 0xA6, 0xB0, 0xC1, 0xA4, 0x12, 0x51, 0xCC, 0x4A, 0xF4, 0x1C, 0x38, 0x49,
-  0x55, 0x45, 0x7A, 0x55, 0x98, 0xBB, 0x76, 0xEA, 0x9B, 0x62, 0x91, 0x4E, 0x9D, 0xC4, 0xD3, 0x70,
-  0x14, 0x07, 0x03, 0xCC, 0xED, 0x07, 0xD2, 0xB6, 0x86, 0x20, 0xFE, 0x8D, 0x91, 0x8F, 0x7E, 0x72,
-  0x8D, 0x9B, 0x9F, 0x53, 0xF0, 0x98, 0x94, 0x0F, 0x7D, 0xE7, 0xBF, 0x3A, 0x8C, 0x9A, 0x5D, 0x57,
-  0x0C, 0x83, 0x10, 0x63, 0x75, 0x23, 0x98, 0x80, 0x17, 0x3C, 0x05, 0xA5, 0x0A, 0xB5, 0xDB, 0xD2,
-  0x1D, 0xDF, 0xBE, 0x09, 0xE9, 0x35, 0xE6, 0xFC, 0x93, 0xD5, 0x84, 0xD0, 0xA5, 0xB8, 0x30, 0xCF,
-  0x64, 0xCE, 0xE8, 0xCB, 0x65, 0x4F, 0xF1, 0x2D, 0xCA, 0x45, 0x76, 0xF6, 0xC1, 0xCF, 0x4B, 0xD5,
-  0x80, 0xFB, 0x83, 0x14, 0xAA, 0x96, 0xAC, 0xC1, 0xCF, 0xA4, 0x6A, 0x48, 0x2B, 0x62, 0xBA, 0x86,
-  0xE4, 0xBD, 0x9A, 0x64, 0x65, 0x4A, 0x56, 0xFC, 0x34, 0x0E, 0xB7, 0x4C, 0xC2, 0xA9, 0x9E, 0x44,
-  0x64, 0x59, 0xF2, 0xFD, 0x24, 0xEF, 0xA0, 0x24, 0x33, 0xEE, 0xD2, 0x7E, 0xC7, 0xB7, 0x91, 0xD8,
-  0xEA, 0x2E, 0x4E, 0x4C, 0x32, 0x0A, 0x51, 0x95, 0x2C, 0x73, 0xB3, 0xA6, 0xE4, 0x84, 0xB4, 0x01,
-  0xB7, 0x66, 0x85, 0xAC, 0x2E, 0x99, 0x77, 0x19, 0x81, 0x64, 0x7D, 0xA9, 0xED, 0x54, 0x56, 0x9D,
-  0x85, 0xBA, 0x33, 0x21, 0xA4, 0x5C, 0x63, 0x6A, 0xAF, 0x8B, 0x5E, 0xD0, 0x6B, 0x50, 0x91, 0x37,
-  0x3C, 0x43, 0x4F, 0x72, 0x8E, 0x5C, 0x68, 0x59, 0x68, 0x86, 0xB2, 0x91, 0xC2, 0x8C, 0x65, 0x8C,
-  0x79, 0xE9, 0x19, 0x12, 0xAF, 0xA4, 0xFF, 0xC1, 0x5F, 0xBB, 0x4B, 0xC9, 0xF8, 0xC3, 0x21, 0xCD,
-  0x99, 0xE4, 0x87, 0x13, 0x6A, 0x09, 0x5C, 0x9F, 0x84, 0xC1, 0x10, 0xB3, 0x7D, 0x03, 0x60, 0xF9,
-  0xEB, 0x6B, 0xC7, 0x77, 0x47, 0x98, 0x40, 0x59, 0x65, 0x2C, 0x83, 0x92, 0x6D, 0xCE, 0x34, 0x0C,
-  0xA6, 0xDC, 0xE5, 0x39, 0x73, 0x66, 0x69, 0xCA, 0xFD, 0x4E, 0x22, 0x73, 0xEF, 0x2C, 0x0D, 0x9D,
-  0x2B, 0xFE, 0x42, 0x31, 0xFB, 0x6F, 0x7E, 0x43, 0x23, 0xAF, 0x51, 0x61, 0x46, 0x23, 0x25, 0x0F,
-  0x9C, 0xC1, 0x05, 0x99, 0x7F, 0x26, 0x1D, 0xDC, 0x09, 0x0D, 0x07, 0x94, 0x85, 0xB1, 0xF0, 0xB2,
-  0xF6, 0x88, 0xE5, 0xAA, 0x21, 0x6B, 0x84, 0xFF, 0x19, 0x07, 0x31, 0x6E, 0xF4, 0xFE, 0x8C, 0x07,
-  0x37, 0x4A, 0x1A, 0x1F, 0x01, 0xF6, 0xC0, 0x09, 0x15, 0x1F, 0xEC, 0xA9, 0x13, 0xDF, 0xB4, 0xC3,
-  0x60, 0x0A, 0xD4, 0x08, 0xB0, 0x4A, 0x56, 0xD0, 0xA9, 0x92, 0x08, 0xC9, 0x30, 0x4E, 0x2C, 0xED,
-  0x70, 0xAA, 0xFD, 0x6F, 0x21, 0x90, 0xD4, 0x4D, 0x33, 0xDD, 0xB2, 0x3D, 0xBF, 0x20, 0x79, 0x0F,
-  0xF3, 0xFA, 0x75, 0xCC, 0x73, 0xC6, 0x02, 0x3C, 0x35, 0x25, 0x9B, 0x6E, 0x8B, 0xDC, 0x86, 0x1E,
-  0x4B, 0xFB, 0xC3, 0xC4, 0x1B, 0x8C, 0x08, 0x26, 0xD3, 0xEC, 0x11, 0xBD, 0x9A, 0x25, 0xD9, 0xAB,
-  0x21, 0x13, 0x3A, 0x23, 0xCB, 0xF0, 0xF2, 0x54, 0x4C, 0x24, 0xC9, 0xC5, 0x54, 0xC6, 0x48, 0xE9,
-  0x19, 0x5C, 0xC6, 0x04, 0x67, 0xDF, 0x12, 0x25, 0x8E, 0x99, 0x94, 0xB8, 0xEF, 0xE9, 0xE0, 0xFE,
-  0xC4, 0x9D, 0x95, 0x6A, 0x85, 0x1F, 0xAA, 0x9C, 0xCF, 0xC5, 0x8C, 0x97, 0x0E, 0x10, 0xE9, 0xEA,
-  0x40, 0xD5, 0x39, 0x30, 0x17, 0xD0, 0x7D, 0x04, 0x20, 0xA0, 0xA6, 0x60, 0xE3, 0x81, 0xC8, 0x6C,
-  0x70, 0x80, 0xEB, 0x66, 0xE6, 0xED, 0x3A, 0x71, 0x5B, 0xF4, 0x5B, 0x5C, 0x94, 0x69, 0x81, 0xBB,
-  0x3E, 0x13, 0x48, 0xF6, 0x3B, 0x9E, 0xD6, 0x7D, 0x1E, 0xF7, 0xD9, 0x96, 0xB4, 0xE4, 0xA3, 0xCD,
-  0x24, 0x42, 0xD2, 0xC1, 0x5E, 0x2E, 0x57, 0x12, 0x62, 0x6E, 0x6F, 0x3C, 0xB3, 0xAD, 0xE4, 0x00,
-  0x98, 0x27, 0xA9, 0x28, 0xE9, 0x5C, 0x51, 0xD2, 0x8C, 0xA4, 0x73, 0xBC, 0xD2, 0x3C, 0x9D, 0x2B,
-  0x6A, 0xA9, 0x75, 0x8E, 0x57, 0xAC, 0xD8, 0xB9, 0xA9, 0x3B, 0x29, 0xE9, 0xD6, 0x7B, 0x77, 0x52,
-  0xDE, 0xB3, 0xA9, 0x3B, 0x99, 0xB9, 0x4F, 0xB9, 0x6D, 0xB4, 0xDE, 0x24, 0xE8, 0x8D, 0x0E, 0x75,
-  0x3B, 0x5D, 0x99, 0xD4, 0x55, 0xEF, 0x91, 0x7B, 0x33, 0x98, 0xC8, 0xA7, 0x37, 0xB3, 0xBD, 0x12,
-  0x05, 0x47, 0xAF, 0x0F, 0xCF, 0xED, 0xFD, 0x51, 0xD2, 0x2F, 0x9D, 0x9C, 0xEB, 0xF4, 0x49, 0xA8,
-  0x85, 0x7D, 0x53, 0xD2, 0x23, 0x95, 0xB7, 0x57, 0xE9, 0x86, 0x82, 0xDB, 0x20, 0xFC, 0xCA, 0x42,
-  0xDB, 0x74, 0x7B, 0xD8, 0x88, 0x82, 0xC4, 0x6F, 0xF8, 0x8E, 0xEA, 0x19, 0x6F, 0x50, 0x39, 0x19,
-  0xB8, 0xD2, 0xE6, 0x4B, 0x1D, 0x2F, 0xD9, 0x27, 0x65, 0x7F, 0xDA, 0xED, 0xF7, 0x4D, 0xF3, 0xD9,
-  0xB0, 0xF8, 0x54, 0x84, 0x79, 0x06, 0x1F, 0x32, 0x59, 0xAD, 0x87, 0x36, 0x9D, 0xF1, 0x6C, 0x41,
-  0xA7, 0x69, 0x1C, 0x37, 0x69, 0x59, 0xE8, 0x35, 0x0F, 0x24, 0x2B, 0xB3, 0xA5, 0xF4, 0x3F, 0xA3,
-  0xB7, 0x32, 0x8F, 0xA1, 0x36, 0xBE, 0x06, 0x03, 0xCD, 0x93, 0x1D, 0x1C, 0x98, 0xD3, 0x68, 0x28,
-  0xDE, 0x88, 0x94, 0x39, 0xFC, 0x0E, 0x05, 0x44, 0x28, 0xC1, 0xA4, 0x90, 0xF8, 0x5A, 0x2D, 0x5B,
-  0x05, 0xF0, 0x82, 0x3F, 0x1D, 0x4F, 0xF0, 0xF9, 0xF0, 0x9D, 0x22, 0xEB, 0x58, 0xDC, 0xCD, 0x3D,
-  0x34, 0x08, 0xCB, 0x0B, 0x28, 0x11, 0x44, 0xE4, 0xE2, 0x07, 0x41, 0xF1, 0xF1, 0x16, 0x3D, 0xBE,
-  0x9D, 0x14, 0x10, 0xA4, 0xA6, 0x66, 0xA4, 0x54, 0xC5, 0xD1, 0x17, 0xF9, 0xF4, 0x70, 0x8B, 0xAE,
-  0xB8, 0x17, 0x60, 0xBB, 0x09, 0x66, 0x8A, 0x7C, 0x64, 0x99, 0x35, 0x26, 0x38, 0xAE, 0xEC, 0xB0,
-  0xED, 0xFC, 0x43, 0x94, 0x0A, 0xD4, 0x28, 0x12, 0x4B, 0xD4, 0x7C, 0xB2, 0x53, 0x20, 0x26, 0x0A,
-  0xE8, 0x3C, 0x29, 0x51, 0x88, 0x5F, 0xD9, 0x55, 0x1B, 0xA4, 0x5B, 0x00, 0xFE, 0x58, 0xB4, 0x5E,
-  0x22, 0xA3, 0xE4, 0xA0, 0x50, 0x1B, 0x00, 0x5D, 0x5F, 0x5D, 0x1C, 0x2A, 0x23, 0xA0, 0xBC, 0x35,
-  0xCA, 0x8E, 0x87, 0x73, 0x48, 0xC8, 0x34, 0x6D, 0x61, 0x6D, 0x89, 0x46, 0x7B, 0x70, 0xA2, 0xAC,
-  0x21, 0x1B, 0xA9, 0x96, 0x1C, 0x10, 0xA3, 0xB6, 0x29, 0xBC, 0x98, 0xE2, 0x50, 0x86, 0x24, 0xAB,
-  0xC7, 0xAE, 0x52, 0x34, 0x98, 0x83, 0x80, 0xE5, 0xA7, 0xE0, 0xBB, 0x25, 0x09, 0xAC, 0x69, 0xCD,
-  0x9E, 0xA8, 0x95, 0xA7, 0xE1, 0xB9, 0x0A, 0x3E, 0x6B, 0xFE, 0xDA, 0x0C, 0x51, 0xB6, 0x2C, 0xB6,
-  0xAC, 0x12, 0x00, 0xB7, 0xCD, 0x3C, 0x2D, 0x0B, 0x6B, 0x0E, 0xCA, 0x66, 0xD6, 0xA7, 0x50, 0x3B,
-  0xC4, 0x76, 0x4C, 0xCE, 0x05, 0x59, 0x28, 0x4E, 0x39, 0xED, 0x93, 0x00, 0xE0, 0xD2, 0xE9, 0x23,
-  0x08, 0x4D, 0xF2, 0x78, 0x12, 0x58, 0x38, 0x22, 0xF1, 0xBC, 0xAB, 0xAE, 0x6C, 0x13, 0x1C, 0xBF,
-  0xF1, 0x1A, 0x8D, 0x6B, 0xFD, 0x6F, 0xAD, 0x7F, 0xB9, 0x38, 0x95, 0xE7, 0x89, 0x8C, 0xF6, 0x2C,
-  0xE9, 0xD8, 0xF1, 0xC5, 0xC5, 0xDB, 0x8B, 0xDA, 0x7C, 0x5A, 0x08, 0xD8, 0xC1, 0x17, 0x3E, 0x96,
-  0x90, 0xC4, 0xF9, 0x06, 0xD6, 0x1C, 0x77, 0x86, 0xEF, 0x18, 0x6B, 0x95, 0xEB, 0x7D, 0x7B, 0x45,
-  0x63, 0x4D, 0xF9, 0xE8, 0x07, 0x94, 0xA5, 0xFA, 0xC9, 0x88, 0x61, 0xD3, 0xD5, 0x9C, 0x96, 0xAC,
-  0xC1, 0xD6, 0xC9, 0xC3, 0xF7, 0x17, 0x17, 0xC7, 0x67, 0xEF, 0x6C, 0xDD, 0xCC, 0xED, 0xA1, 0xA4,
-  0x03, 0xD5, 0xEC, 0x74, 0x82, 0xBA, 0x0E, 0x8F, 0xFB, 0x1F, 0xBD, 0x6F, 0xAA, 0x0A, 0x37, 0xF1,
-  0x98, 0xE6, 0x2F, 0x8B, 0x5B, 0x00, 0x42, 0xBF, 0xD5, 0x58, 0x74, 0xAF, 0xC6, 0x87, 0x9D, 0x42,
-  0x40, 0x76, 0x6A, 0xF4, 0xFC, 0xB4, 0x08, 0xFD, 0x3C, 0x6F, 0xAB, 0x62, 0x97, 0x43, 0xBD, 0x91,
-  0x22, 0x8D, 0x22, 0x67, 0x95, 0x8D, 0x75, 0x86, 0x1F, 0xDD, 0x9C, 0xD0, 0x8F, 0xB8, 0x96, 0xFE,
-  0xF8, 0xF1, 0xB5, 0x2E, 0xD0, 0x95, 0xA6, 0x7B, 0x46, 0xBA, 0xB3, 0x43, 0x01, 0xFD, 0x7F, 0x25,
-  0xB2, 0xDE, 0xA2, 0xAB, 0xE5, 0x5A, 0xE9, 0xDE, 0x1F, 0xCB, 0xB8, 0xBE, 0x8C, 0x5B, 0x96, 0x4A,
-  0x5D, 0x34, 0x1F, 0x7A, 0xA1, 0xD4, 0xB1, 0x59, 0x97, 0x49, 0x83, 0x20, 0xDB, 0x22, 0x39, 0xE4,
-  0x70, 0xD5, 0x29, 0xA5, 0x9C, 0xE0, 0xCB, 0xF0, 0x57, 0x54, 0x98, 0xDD, 0x5A, 0x6E, 0x1A, 0x73,
-  0x2B, 0x29, 0x4D, 0xAB, 0x2A, 0x96, 0xD0, 0xB2, 0x6B, 0xCC, 0x03, 0x4D, 0xAD, 0x32, 0x9D, 0xCE,
-  0xB4, 0x81, 0x64, 0x83, 0x2E, 0xF5, 0xDA, 0xAB, 0x02, 0xFA, 0xB6, 0x27, 0x88, 0x1D, 0x89, 0x5D,
-  0xE4, 0xF0, 0x16, 0xDE, 0x27, 0xE9, 0x15, 0xB1, 0x1A, 0x1A, 0x79, 0x7C, 0xAA, 0x3E, 0x3D, 0x0D,
-  0x2C, 0xDC, 0x1D, 0x66, 0xE6, 0xF2, 0xAE, 0xAA, 0xA3, 0x0D, 0x60, 0x8A, 0x6B, 0xDE, 0x44, 0xB3,
-  0x9B, 0x71, 0xA9, 0x19, 0x4F, 0x04, 0x68, 0xF7, 0x60, 0x5F, 0x79, 0xDF, 0xA8, 0x4F, 0x1C, 0xF6,
-  0x40, 0x5D, 0x1D, 0xE3, 0xC7, 0x42, 0x96, 0x17, 0x3D, 0x0E, 0xEF, 0x71, 0x25, 0x92, 0x2F, 0x32,
-  0xF3, 0xC0, 0x89, 0xFB, 0x09, 0x0F, 0xAB, 0x13, 0xFB, 0x27, 0xFD, 0x9D, 0x56, 0xE2, 0xF9, 0xE4,
-  0xE8, 0xA8, 0xED, 0xCA, 0x1F, 0xF9, 0x5C, 0x69, 0x32, 0x0C, 0xD9, 0xD7, 0x9D, 0x11, 0xE7, 0xB1,
-  0x0F, 0xA8, 0xF4, 0xBD, 0x68, 0xE6, 0x99, 0x54, 0x32, 0xE7, 0x0B, 0xCF, 0xEA, 0xCB, 0x8F, 0xD1,
-  0x8D, 0x72, 0xD5, 0x2F, 0x51, 0x8F, 0x18, 0x1B, 0x68, 0xF9, 0x8E, 0xAF, 0xB6, 0x8F, 0x9D, 0x91,
-  0xA5, 0x84, 0xAB, 0xAA, 0xB7, 0xD7, 0x6F, 0x28, 0x4B, 0x20, 0x6F, 0x9E, 0xCD, 0xD9, 0x5E, 0x5A,
-  0xE6, 0x19, 0x57, 0xF1, 0xEA, 0x18, 0x8A, 0x17, 0xB9, 0xBD, 0x71, 0xD8, 0x72, 0x35, 0x64, 0x8C,
-  0x07, 0x1E, 0x4F, 0xA3, 0x44, 0x2B, 0x0F, 0x1C, 0x9F, 0x50, 0x64, 0x08, 0x53, 0x99, 0x9E, 0x0F,
-  0x83, 0x0F, 0x7A, 0x0E, 0xAF, 0x03, 0x46, 0xA2, 0xCA, 0x3E, 0xE1, 0xDF, 0x78, 0x2D, 0x7C, 0x61,
-  0x21, 0xF0, 0x47, 0xF7, 0xE2, 0x14, 0x2F, 0x6A, 0x91, 0xD5, 0x16, 0x06, 0x06, 0xB5, 0xD8, 0x30,
-  0xB5, 0xF5, 0x93, 0x2A, 0xF5, 0xC1, 0x2D, 0xC9, 0x78, 0x53, 0xF5, 0xEA, 0xF7, 0x9E, 0x22, 0xD7,
-  0x1B, 0x7A, 0x71, 0x3A, 0x4C, 0xA0, 0x5D, 0x33, 0xCF, 0xFD, 0x61, 0x45, 0x9D, 0x5D, 0x6C, 0x21,
-  0xB7, 0xF2, 0x69, 0x65, 0xA5, 0x28, 0x4B, 0x97, 0x8A, 0x06, 0xA1, 0xD4, 0x57, 0xEB, 0xCD, 0x74,
-  0xE0, 0x60, 0x0B, 0x8F, 0xDD, 0x1F, 0x8D, 0xC8, 0x30, 0x08, 0xDC, 0x0A, 0xAD, 0x09, 0xB4, 0x4E,
-  0xC7, 0x77, 0xE6, 0xE6, 0x6D, 0x44, 0xAE, 0xF4, 0xAB, 0x08, 0x80, 0xF4, 0x27, 0xCC, 0xF9, 0xB8,
-  0x32, 0x3B, 0xC5, 0x65, 0x1B, 0x15, 0x10, 0x1F, 0x8C, 0x16, 0x88, 0xB4, 0xA1, 0x67, 0x37, 0x41,
-  0xF5, 0x23, 0x23, 0x30, 0xDB, 0x51, 0x78, 0x26, 0x41, 0x14, 0x79, 0x18, 0xB0, 0xC4, 0xA5, 0x01,
-  0xE7, 0xA7, 0x94, 0x93, 0x74, 0x2A, 0xA6, 0x1F, 0x4E, 0x4F, 0xDB, 0x63, 0xFE, 0x93, 0x7E, 0x23,
-  0xB6, 0x8F, 0xAB, 0xB6, 0x8F, 0xA7, 0xA7, 0xFD, 0x7E, 0x3B, 0x62, 0x3F, 0x5A, 0x73, 0x62, 0xF9,
-  0x0C, 0x00, 0x56, 0xD3, 0xCF, 0x4F, 0xAC, 0x72, 0xC2, 0x42, 0xEC, 0x17, 0xE7, 0xDC, 0xFF, 0xC1,
-  0x28, 0x2E, 0x3F, 0x68, 0x93, 0x0D, 0x98, 0x65, 0xDB, 0x9D, 0xF5, 0xF5, 0x8D, 0xA7, 0x1D, 0x9C,
-  0x5E, 0x8C, 0x7F, 0xED, 0x34, 0x84, 0x2C, 0x9D, 0xE9, 0x7B, 0xA4, 0xB7, 0x0C, 0xC4, 0x6F, 0x71,
-  0xDE, 0x75, 0xD8, 0x25, 0x5E, 0x98, 0x61, 0x3D, 0x7C, 0xF7, 0x2E, 0xB8, 0xC5, 0xE7, 0xFE, 0x36,
-  0x3A, 0xA4, 0xB3, 0x49, 0x7A, 0x9B, 0xED, 0x5E, 0x67, 0x63, 0xDB, 0x42, 0x4A, 0xAA, 0x8B, 0xF6,
-  0xC8, 0xFA, 0x92, 0x29, 0xE9, 0x31, 0x62, 0xD6, 0x53, 0x62, 0x56, 0xBB, 0x9D, 0xCD, 0xD5, 0x6E,
-  0x77, 0xB5, 0xB3, 0xD9, 0xEE, 0x6E, 0xF5, 0x6C, 0xE4, 0xD8, 0x35, 0xDA, 0x1E, 0x46, 0x61, 0x2E,
-  0x89, 0xB4, 0xA7, 0x48, 0xD3, 0x35, 0xBD, 0xA5, 0x21, 0xA7, 0xA7, 0xDB, 0x45, 0x6A, 0x9E, 0x3D,
-  0xDB, 0xDE, 0xEE, 0x91, 0xC6, 0x11, 0x97, 0x2C, 0xAC, 0xC2, 0x7F, 0x6B, 0x26, 0x34, 0x4A, 0x69,
-  0xD7, 0x2C, 0xB2, 0x64, 0xA2, 0x72, 0x53, 0x2C, 0x5D, 0x42, 0x76, 0x6C, 0xB5, 0x55, 0x89, 0xE3,
-  0x0D, 0xD4, 0x2F, 0xF6, 0x36, 0xA9, 0xA8, 0x08, 0x6B, 0x2F, 0xF9, 0x3B, 0x07, 0x87, 0x1C, 0x4F,
-  0x81, 0x40, 0xFE, 0x69, 0xAF, 0x6D, 0x65, 0x37, 0x6F, 0x69, 0x2D, 0x52, 0xAD, 0x79, 0x9F, 0x0E,
-  0x1D, 0xCC, 0xFC, 0xD9, 0xF7, 0x86, 0xBE, 0x6E, 0x3C, 0xE9, 0x2A, 0xAC, 0x93, 0xEA, 0xCF, 0x54,
-  0x59, 0x27, 0xC5, 0xDC, 0xEC, 0xC4, 0x00, 0xD0, 0x7D, 0x45, 0xB7, 0xB7, 0x50, 0x82, 0xEA, 0xFC,
-  0x21, 0xC7, 0x0B, 0x16, 0x25, 0x0A, 0xF4, 0x30, 0x3A, 0xF0, 0x6D, 0xE9, 0x69, 0x94, 0xC6, 0x84,
-  0xEB, 0x44, 0xE8, 0x37, 0xD9, 0x92, 0xCE, 0xAF, 0xAE, 0xB2, 0x67, 0xCC, 0x41, 0x39, 0xA6, 0xE2,
-  0xEE, 0xF0, 0xF7, 0xCC, 0x3D, 0x9F, 0xA7, 0x98, 0x64, 0x25, 0x94, 0x2F, 0x60, 0x2D, 0xE6, 0x81,
-  0x60, 0x17, 0xA9, 0x05, 0x52, 0x89, 0x86, 0x44, 0x80, 0xC7, 0xF4, 0xC6, 0xA9, 0xEB, 0x36, 0x2C,
-  0x37, 0xE8, 0x69, 0x56, 0x56, 0x78, 0xF1, 0x25, 0x47, 0xB2, 0xA1, 0xF8, 0x29, 0x26, 0x70, 0xCF,
-  0x2D, 0xDD, 0x82, 0x35, 0x6E, 0x6D, 0x2D, 0xAB, 0xF0, 0xD4, 0x07, 0x7B, 0xE6, 0x37, 0x51, 0x38,
-  0x5C, 0x25, 0x94, 0x80, 0x5F, 0x16, 0x67, 0x27, 0x45, 0x3C, 0xCC, 0x9C, 0x9D, 0xA4, 0x02, 0x5B,
-  0xFD, 0x81, 0xBC, 0xBF, 0x97, 0x0A, 0x39, 0x1B, 0x1E, 0xB0, 0xB9, 0x89, 0x98, 0x36, 0x1A, 0x14,
-  0x21, 0xDA, 0x3A, 0x08, 0x05, 0x34, 0xBF, 0xB8, 0xD7, 0x51, 0x61, 0xA4, 0xEB, 0x7D, 0x5A, 0x6D,
-  0x75, 0x37, 0xD1, 0xD4, 0xFC, 0xC8, 0x58, 0xBB, 0xEC, 0xC7, 0x1E, 0xE2, 0x04, 0x81, 0x88, 0x59,
-  0x60, 0x49, 0x01, 0xA2, 0x04, 0xCD, 0xE9, 0xA9, 0x1A, 0x84, 0xFB, 0xD2, 0x03, 0xCB, 0x04, 0x56,
-  0x57, 0xCD, 0xD2, 0x48, 0xED, 0x11, 0x16, 0xFC, 0xFE, 0xF6, 0x9A, 0xBD, 0xCB, 0x8D, 0x83, 0xB1,
-  0xDA, 0x35, 0xDD, 0xF9, 0x8B, 0xB2, 0xFE, 0xF2, 0xEC, 0xED, 0xE5, 0xD1, 0xF1, 0xE1, 0xC9, 0xE9,
-  0xFE, 0x1B, 0x63, 0x14, 0x22, 0x0A, 0x33, 0xD5, 0xC5, 0x6E, 0x25, 0xF4, 0x18, 0xEC, 0x56, 0xC5,
-  0x81, 0xEF, 0x29, 0x79, 0x0B, 0x2B, 0xCB, 0xD2, 0x89, 0xA4, 0x32, 0x5A, 0x6D, 0x22, 0xF9, 0xF8,
-  0xE7, 0x84, 0x5F, 0xA2, 0x01, 0xB0, 0x4C, 0xB9, 0x2E, 0x63, 0xB1, 0x28, 0x25, 0xB2, 0x95, 0x14,
-  0xC8, 0x1A, 0xD9, 0x82, 0x15, 0x90, 0x5D, 0xFB, 0x94, 0x38, 0xD6, 0xC8, 0xFA, 0x16, 0xE6, 0x3C,
-  0x68, 0x1A, 0x37, 0x16, 0x95, 0x19, 0xDC, 0xB4, 0x22, 0xF8, 0x33, 0x32, 0xDE, 0xBA, 0x25, 0x5C,
-  0x70, 0xE6, 0x6D, 0x16, 0xCE, 0xBC, 0x8D, 0x64, 0xE6, 0x69, 0xE6, 0xC7, 0xF2, 0x26, 0x5E, 0xC5,
-  0x69, 0xA7, 0x2C, 0x2A, 0xEA, 0xF8, 0xE7, 0x4C, 0x36, 0x53, 0xF0, 0x67, 0x9D, 0x5E, 0xB9, 0x93,
-  0xCB, 0x2E, 0x85, 0x1A, 0x6B, 0x58, 0x28, 0xA8, 0x68, 0x60, 0x01, 0x6C, 0x17, 0xC1, 0x59, 0x45,
-  0x6A, 0x2E, 0xE9, 0x69, 0x77, 0x34, 0x0F, 0x59, 0x22, 0x40, 0x9A, 0xB4, 0x74, 0xF9, 0x78, 0xAF,
-  0x3E, 0xD0, 0x80, 0x5F, 0x9E, 0x9E, 0x5E, 0x1E, 0xED, 0xF7, 0x5F, 0x1B, 0xC3, 0x2E, 0x42, 0x9C,
-  0x52, 0xA5, 0x23, 0xEE, 0x2A, 0xAC, 0x9A, 0x77, 0x59, 0xD2, 0x31, 0x56, 0x1F, 0xB2, 0xEF, 0x7C,
-  0x51, 0xC4, 0x22, 0x67, 0xE8, 0xD4, 0xFA, 0xDD, 0x2F, 0x8A, 0x2A, 0xCC, 0x8C, 0xDE, 0x23, 0x0F,
-  0x46, 0xFE, 0x58, 0xF4, 0x92, 0xB1, 0x90, 0xA6, 0xFB, 0xD2, 0xC7, 0x02, 0x94, 0xEF, 0x4F, 0x36,
-  0x1C, 0x3F, 0xCD, 0xCA, 0xA4, 0xB0, 0xA7, 0xCA, 0x02, 0xA5, 0x76, 0xA8, 0x97, 0x76, 0x28, 0xBB,
-  0x42, 0xFD, 0xB8, 0xE5, 0x23, 0x47, 0xE6, 0x8C, 0x05, 0x84, 0x0B, 0x5D, 0xEA, 0x35, 0x5A, 0xAA,
-  0xCC, 0xED, 0x94, 0xB0, 0x21, 0x55, 0xB0, 0x0F, 0xD6, 0x41, 0xA1, 0xE1, 0xC8, 0xC3, 0x69, 0xB8,
-  0x8A, 0xB3, 0x89, 0xFC, 0xFF, 0xA6, 0xDC, 0xF4, 0x71, 0xE8, 0x25, 0xE3, 0x40, 0x1E, 0xC6, 0xAA,
-  0xE7, 0x13, 0xF8, 0x27, 0x1A, 0x8C, 0x9F, 0x4D, 0xB5, 0xFD, 0xAB, 0x69, 0x35, 0xDB, 0xE6, 0xDE,
-  0xD2, 0x8C, 0x6F, 0xED, 0x45, 0xCF, 0x2C, 0xE5, 0xCD, 0x24, 0x3F, 0xCA, 0x76, 0xD3, 0xEE, 0x31,
-  0xC0, 0xF7, 0x6D, 0xD9, 0x95, 0x12, 0xF4, 0xEF, 0x71, 0x70, 0x93, 0x10, 0x0C, 0x4A, 0x3C, 0x43,
-  0x49, 0x7D, 0xE9, 0x96, 0x31, 0x6A, 0x1A, 0x17, 0x2E, 0x6D, 0x55, 0x76, 0xF4, 0x53, 0x00, 0xC5,
-  0x9D, 0x8F, 0x1E, 0xE4, 0xF4, 0x62, 0x62, 0x8B, 0x04, 0xD3, 0x18, 0xFF, 0x70, 0xC4, 0x11, 0x01,
-  0x34, 0xEA, 0x07, 0xBA, 0xC3, 0x1F, 0xBD, 0xD7, 0x57, 0xC0, 0xE5, 0x31, 0x25, 0x75, 0x63, 0xAA,
-  0xD5, 0x5B, 0x84, 0xC6, 0x03, 0xED, 0x41, 0x5F, 0x64, 0x04, 0xA3, 0x43, 0xA1, 0xAB, 0x65, 0x13,
-  0x35, 0xFB, 0xE1, 0x80, 0xF0, 0x98, 0x2A, 0xA7, 0x9A, 0xFC, 0x9A, 0x82, 0x45, 0x52, 0xAB, 0x8B,
-  0x6A, 0xD3, 0xAA, 0x0E, 0x52, 0xC9, 0x1C, 0x58, 0x87, 0xCD, 0x3C, 0x1A, 0x56, 0xC9, 0xB0, 0x1F,
-  0xAC, 0x2D, 0x48, 0xE6, 0xA5, 0xB2, 0x17, 0x81, 0xFD, 0xD4, 0x82, 0xD0, 0x96, 0x0A, 0x4C, 0x9A,
-  0xDC, 0x4B, 0x06, 0xD9, 0xFF, 0x78, 0x7A, 0xF0, 0xF6, 0x0D, 0x03, 0x6A, 0xDE, 0xFF, 0x18, 0x05,
-  0xFE, 0x90, 0xE5, 0xB6, 0x38, 0xA2, 0xC3, 0x90, 0x9A, 0x5E, 0x89, 0xCC, 0x48, 0x18, 0x43, 0x0B,
-  0x9B, 0x26, 0x13, 0x80, 0xB5, 0x1E, 0x4C, 0xFE, 0xAD, 0xCE, 0x8E, 0x91, 0x3B, 0x2C, 0x29, 0x7D,
-  0x41, 0x72, 0x35, 0xA6, 0xDC, 0x4B, 0xDB, 0xE5, 0x2A, 0xFD, 0x23, 0x91, 0xA7, 0xA7, 0xCD, 0x4C,
-  0x8E, 0xB2, 0x05, 0x87, 0x37, 0x8F, 0xB4, 0x64, 0x0A, 0x65, 0x58, 0xB8, 0x02, 0xB3, 0x0A, 0x0F,
-  0xD6, 0x93, 0xAA, 0x3B, 0xD9, 0x13, 0x93, 0x25, 0x09, 0xCA, 0x5C, 0xC4, 0xAD, 0x3E, 0x06, 0x75,
-  0x5C, 0xE6, 0xE6, 0xA2, 0xEF, 0x7F, 0xFE, 0x5B, 0x27, 0x10, 0xBF, 0xD5, 0x6B, 0x3A, 0x99, 0xF3,
-  0xC0, 0x25, 0xB6, 0x7E, 0x2F, 0x5D, 0xB7, 0x5C, 0x2A, 0x7E, 0xC5, 0x65, 0xA8, 0x97, 0xA5, 0x82,
-  0x53, 0x36, 0x4A, 0xCB, 0x87, 0xAA, 0xA8, 0x99, 0xE5, 0x75, 0x5E, 0xB1, 0x7C, 0x96, 0x4F, 0xF1,
-  0x43, 0xC2, 0x36, 0x36, 0xA3, 0xFF, 0x12, 0xDA, 0x57, 0xA3, 0xF9, 0xD4, 0xE6, 0xC7, 0x9E, 0x85,
-  0x66, 0x01, 0xA0, 0x88, 0xE6, 0xCA, 0x7A, 0x7F, 0x6B, 0xE9, 0x7A, 0xBF, 0xDF, 0x9F, 0x5B, 0xF3,
-  0x67, 0x58, 0xF4, 0x48, 0x2B, 0x82, 0x90, 0xBA, 0xF9, 0x17, 0x05, 0x1B, 0xE1, 0xAB, 0x8F, 0x44,
-  0xF9, 0xC2, 0x0B, 0x86, 0x8D, 0xF8, 0x7A, 0x76, 0x25, 0xF9, 0x6B, 0xAD, 0xF6, 0x50, 0x7D, 0x68,
-  0xCE, 0xBD, 0x2A, 0xD9, 0x68, 0x27, 0x0F, 0xCD, 0x78, 0x43, 0xBD, 0x2E, 0x5D, 0xDC, 0x95, 0x4B,
-  0x8D, 0x56, 0xB5, 0xB0, 0x64, 0x01, 0x5A, 0xB0, 0x27, 0xC5, 0xE3, 0xF0, 0xC8, 0x7D, 0x31, 0x16,
-  0x8F, 0x07, 0x98, 0xD1, 0x45, 0x1D, 0xCA, 0x5C, 0xF4, 0xD1, 0xF1, 0x19, 0x71, 0x95, 0x32, 0xD0,
-  0x69, 0x00, 0xAB, 0x9B, 0x6C, 0xB3, 0xF6, 0x57, 0x77, 0xAD, 0x1D, 0xE3, 0xA5, 0xE5, 0x41, 0x73,
-  0x87, 0xE8, 0x49, 0x15, 0xE4, 0xE1, 0x39, 0xEC, 0x84, 0x5B, 0x3C, 0x5D, 0x17, 0x6C, 0x5C, 0x6F,
-  0x42, 0x35, 0x10, 0x93, 0xE7, 0x1A, 0xDB, 0xC3, 0xCD, 0xB2, 0xBC, 0x9A, 0xB4, 0xAA, 0x04, 0xBC,
-  0xC0, 0x67, 0x6D, 0x6F, 0x8E, 0xD5, 0xB4, 0x2C, 0x59, 0x22, 0x13, 0xD9, 0x0A, 0xC2, 0xC5, 0x18,
-  0x04, 0xAD, 0x9C, 0x03, 0x5F, 0x61, 0xD9, 0x85, 0xD5, 0xED, 0xBB, 0xAF, 0x6D, 0xD8, 0x05, 0x68,
-  0x27, 0xF5, 0x16, 0xC8, 0xAD, 0xBB, 0x72, 0xB3, 0xB8, 0x92, 0x1F, 0x41, 0x66, 0x15, 0xB8, 0xC5,
-  0x07, 0xB3, 0x48, 0x51, 0x15, 0x16, 0x03, 0xC0, 0x5F, 0x5F, 0x7E, 0x6E, 0x24, 0x49, 0xE6, 0x23,
-  0x51, 0x7B, 0xEF, 0x7F, 0xF5, 0x2D, 0x8F, 0xFB, 0x1A, 0xE9, 0xB8, 0x07, 0x78, 0xC5, 0xB7, 0x51,
-  0x79, 0xDB, 0x9E, 0x83, 0x4B, 0xF5, 0x4E, 0x2C, 0x15, 0x21, 0xEC, 0xA9, 0x72, 0x51, 0xA6, 0x6E,
-  0xD0, 0xA5, 0xA2, 0xBC, 0x2C, 0xC2, 0x49, 0x1E, 0x0E, 0x29, 0x5F, 0x8F, 0x73, 0x31, 0xAF, 0x3E,
-  0x10, 0x66, 0x66, 0xBD, 0x14, 0xF0, 0x38, 0xF1, 0x2C, 0x2D, 0xBD, 0xBF, 0x45, 0x78, 0x35, 0x9F,
-  0xD6, 0x03, 0x60, 0x2E, 0x67, 0xF6, 0xEA, 0xC3, 0xA0, 0x37, 0x17, 0xD2, 0x42, 0xCE, 0x3F, 0x44,
-  0xC7, 0xAB, 0xE0, 0xE6, 0xDC, 0x7F, 0x28, 0xB6, 0x57, 0x22, 0x81, 0x8F, 0x40, 0x01, 0x09, 0xDF,
-  0x9F, 0xE4, 0x69, 0xBB, 0xEF, 0x4F, 0xFE, 0x1F, 0x4F, 0xF5, 0xAB, 0x73, 0xBF, 0x23, 0x00
+  0x1F, 0x8B, 0x08, 0x08, 0x48, 0xCA, 0xD3, 0x6A, 0x02, 0xFF, 0x6D, 0x61, 0x69, 0x6E, 0x2E, 0x6A,
+  0x73, 0x2E, 0x67, 0x7A, 0x69, 0x70, 0x00, 0xED, 0x7D, 0xE9, 0x7A, 0x1B, 0x39, 0x92, 0xE0, 0x7F,
+  0x3F, 0x05, 0x8A, 0xDB, 0x5B, 0x24, 0x5B, 0x14, 0x45, 0x52, 0x87, 0x0F, 0x59, 0xEA, 0xD1, 0x65,
+  0x5B, 0x3B, 0x96, 0xAC, 0x4F, 0x94, 0xCB, 0xE5, 0xAA, 0xF6, 0x6A, 0x52, 0x4C, 0x88, 0xCA, 0x36,
+  0x99, 0xC9, 0xC9, 0x4C, 0xEA, 0xE8, 0x1E, 0xBF, 0xD3, 0x3C, 0xC3, 0x3C, 0xD9, 0x46, 0xE0, 0xC8,
+  0x04, 0x90, 0xC8, 0x83, 0x87, 0x64, 0x77, 0x6F, 0xE9, 0xEB, 0x76, 0x49, 0x09, 0x20, 0x22, 0x10,
+  0x08, 0x04, 0x02, 0x81, 0x40, 0xE0, 0xD6, 0x09, 0xC9, 0xD0, 0x89, 0xE9, 0x9D, 0xF3, 0x40, 0x76,
+  0xC8, 0x7F, 0xDC, 0x45, 0xAF, 0xD6, 0xD6, 0xFE, 0xF4, 0x8F, 0x3B, 0xCF, 0x77, 0x83, 0xBB, 0xF6,
+  0x28, 0x18, 0x38, 0xB1, 0x17, 0xF8, 0xED, 0x9B, 0x20, 0x8A, 0x7D, 0x67, 0x4C, 0xBF, 0xAD, 0xDD,
+  0x45, 0xFF, 0xB1, 0xFD, 0xEC, 0x16, 0x1A, 0xDD, 0xD1, 0xAB, 0x28, 0x18, 0x7C, 0xA5, 0xF1, 0xF6,
+  0xB3, 0x67, 0xA2, 0xBA, 0xE3, 0xBA, 0x47, 0xB7, 0xD4, 0x8F, 0xDF, 0x7B, 0x51, 0x4C, 0x7D, 0x1A,
+  0x36, 0xEA, 0xA3, 0xC0, 0x71, 0xEB, 0x2D, 0x12, 0xF8, 0xEF, 0xE1, 0x97, 0x26, 0xD4, 0xBC, 0x9E,
+  0xFA, 0x03, 0x84, 0x28, 0x3E, 0x35, 0x28, 0xD6, 0x6F, 0x92, 0x7F, 0x3C, 0x23, 0xF0, 0xE3, 0xF9,
+  0x5E, 0xFC, 0x89, 0x5E, 0xF5, 0x19, 0xD8, 0x06, 0x54, 0xFF, 0xA6, 0x34, 0x30, 0x0A, 0x45, 0x93,
+  0x84, 0x0A, 0x20, 0xDE, 0xA7, 0x77, 0x24, 0xAD, 0x21, 0x3A, 0x05, 0x50, 0xB4, 0x7A, 0xED, 0xC0,
+  0x1F, 0xD3, 0x28, 0x72, 0x86, 0x14, 0x5A, 0x24, 0xC0, 0x1B, 0xE3, 0x68, 0x28, 0x41, 0xE2, 0xCF,
+  0xC4, 0x09, 0x23, 0x7A, 0xEC, 0x0F, 0x82, 0xB1, 0xE7, 0x0F, 0xB1, 0xB0, 0xED, 0x3A, 0xB1, 0x23,
+  0x60, 0x7D, 0xD3, 0x09, 0x1B, 0xD2, 0x06, 0x95, 0x6D, 0x43, 0x1A, 0x4F, 0x43, 0x9F, 0xB8, 0xC1,
+  0x60, 0x3A, 0x86, 0x8E, 0xB5, 0x87, 0x34, 0x3E, 0x1A, 0x51, 0xFC, 0x75, 0xFF, 0xE1, 0x18, 0x7A,
+  0xCB, 0xFB, 0x84, 0xEC, 0xBB, 0xF6, 0xEE, 0xA9, 0xFB, 0xDE, 0x41, 0xBA, 0x3B, 0xDB, 0xCA, 0x97,
+  0xC0, 0x1F, 0xA6, 0x9F, 0x26, 0x23, 0x27, 0xBE, 0x0E, 0xC2, 0xF1, 0x59, 0x48, 0xA1, 0x14, 0xBE,
+  0xD7, 0xFA, 0xD3, 0xF0, 0x96, 0x3E, 0x04, 0x61, 0x8D, 0x57, 0x18, 0xD2, 0xC0, 0xA5, 0xB1, 0x37,
+  0xE0, 0x80, 0x36, 0x3A, 0xED, 0x4E, 0xD7, 0x28, 0x00, 0x02, 0x77, 0xC8, 0x6A, 0xB7, 0xB3, 0xD9,
+  0xEE, 0xBE, 0xD4, 0x8B, 0xF6, 0x46, 0xD8, 0xA6, 0xBB, 0xD9, 0xE9, 0xB4, 0x45, 0x23, 0x3A, 0xA0,
+  0xD7, 0xBF, 0xB2, 0xEA, 0xBD, 0x17, 0x9D, 0x5E, 0x67, 0xAB, 0xBD, 0xB9, 0xF5, 0x22, 0x2D, 0xF9,
+  0x8C, 0x25, 0x1B, 0xCF, 0xBB, 0x5B, 0x2F, 0x3A, 0x1B, 0xED, 0x8D, 0xCE, 0x7A, 0x5A, 0xF2, 0x1B,
+  0xC3, 0xFD, 0x62, 0x6B, 0x6B, 0x6B, 0xB3, 0xBD, 0xF1, 0x62, 0x83, 0x17, 0x8C, 0x9C, 0x28, 0x7E,
+  0xE3, 0x8D, 0xE8, 0x29, 0x88, 0x0D, 0x52, 0x5E, 0x93, 0xBD, 0x84, 0x4F, 0xD3, 0xF1, 0x15, 0x0D,
+  0xD3, 0x6E, 0xFA, 0xEC, 0xEF, 0x0F, 0xD7, 0x58, 0x3D, 0xEA, 0xD3, 0x11, 0x1D, 0xC4, 0xD4, 0x4D,
+  0x8B, 0x23, 0xF1, 0x85, 0x15, 0x2B, 0xA0, 0xA2, 0x9B, 0x00, 0x04, 0x6F, 0x88, 0x9F, 0x51, 0xE2,
+  0x70, 0x3C, 0x9D, 0x51, 0x44, 0x79, 0x61, 0x70, 0x15, 0x3B, 0x9E, 0x4F, 0xDD, 0x13, 0x3E, 0xD8,
+  0x95, 0x2A, 0xEC, 0x3B, 0x11, 0xD5, 0x2B, 0x09, 0x14, 0xA2, 0xCE, 0xF9, 0xC5, 0xC1, 0x49, 0x16,
+  0x10, 0xF6, 0xE8, 0xC2, 0xB9, 0x82, 0x7F, 0xE8, 0x7D, 0x6C, 0xF4, 0x14, 0x6B, 0x7F, 0xB8, 0xBE,
+  0x8E, 0xA8, 0x36, 0xCE, 0xFC, 0xFB, 0x45, 0x10, 0x3B, 0xA3, 0xEC, 0xE7, 0xF3, 0xE0, 0x2E, 0xB2,
+  0x7C, 0xA5, 0xFF, 0x39, 0xA5, 0x91, 0x80, 0x32, 0x08, 0x7C, 0xF8, 0x55, 0x16, 0x9D, 0x01, 0x65,
+  0x7D, 0xEF, 0xEF, 0x48, 0x79, 0x6F, 0x93, 0xB7, 0x12, 0x12, 0x6E, 0x10, 0x84, 0x23, 0x22, 0x7A,
+  0x72, 0xF1, 0x30, 0xA1, 0xF9, 0x25, 0x82, 0x0F, 0x58, 0xCA, 0x8A, 0x43, 0x3A, 0x08, 0x42, 0x37,
+  0x3A, 0x3A, 0x38, 0x7A, 0x03, 0x9F, 0x7F, 0xFF, 0xB2, 0xAD, 0x7E, 0x7D, 0x2B, 0xC4, 0x49, 0x29,
+  0xB9, 0x9E, 0x8E, 0x46, 0x48, 0xD5, 0xC7, 0x09, 0xCC, 0x1A, 0x85, 0xA3, 0xA2, 0x19, 0x70, 0xE3,
+  0xC2, 0x1B, 0xD3, 0x60, 0x1A, 0xCB, 0xF1, 0xF5, 0xDD, 0x43, 0x98, 0x5E, 0xDA, 0xC7, 0xC1, 0x0D,
+  0x1D, 0x7C, 0x3D, 0xA5, 0x77, 0x6F, 0xBC, 0x70, 0x7C, 0xE7, 0x84, 0x54, 0x2B, 0x84, 0x69, 0x65,
+  0x2B, 0x12, 0x8C, 0x39, 0x08, 0x80, 0x2E, 0xCF, 0x07, 0xD4, 0xD8, 0x19, 0x64, 0x26, 0x9F, 0x9C,
+  0x07, 0x1F, 0x3E, 0x9C, 0x1F, 0x1E, 0x9F, 0xEE, 0x5D, 0x1C, 0x5D, 0x1E, 0x9F, 0x9E, 0x7D, 0xBC,
+  0xB8, 0xBC, 0xF8, 0x7C, 0x76, 0x74, 0x79, 0x78, 0xF8, 0x8A, 0x74, 0x5A, 0x64, 0x6D, 0xED, 0x90,
+  0x5E, 0x3B, 0x53, 0x98, 0x13, 0x87, 0x87, 0x6D, 0x57, 0xFE, 0x14, 0xB6, 0x3B, 0x39, 0x79, 0x45,
+  0xBA, 0xAC, 0x25, 0xFC, 0xDA, 0x1E, 0xE3, 0x4F, 0x61, 0xFD, 0x4B, 0x6C, 0xD0, 0xE3, 0x0D, 0x48,
+  0xD5, 0x16, 0x97, 0x87, 0x7B, 0xFD, 0x77, 0xAF, 0xC8, 0x3A, 0x6F, 0xB6, 0x5A, 0xB9, 0x59, 0xFF,
+  0xF3, 0xC9, 0xFE, 0x87, 0xF7, 0xAF, 0xC8, 0x06, 0x6F, 0xF8, 0x3F, 0xFF, 0x2D, 0x5B, 0x8E, 0xC7,
+  0xF5, 0x92, 0x5E, 0xF5, 0xFB, 0xAF, 0xC8, 0x66, 0x42, 0x26, 0xE9, 0xF7, 0xDB, 0x11, 0xFB, 0x29,
+  0xC7, 0x09, 0x0D, 0xB7, 0xE6, 0x6B, 0x28, 0xBA, 0xF9, 0x3C, 0xE9, 0xE6, 0xEA, 0x4C, 0xAD, 0x65,
+  0x6F, 0x5F, 0xA4, 0xBD, 0xAD, 0x27, 0x00, 0x6A, 0xA5, 0xFD, 0xBD, 0x3C, 0xFD, 0x70, 0x79, 0x78,
+  0x74, 0x70, 0x7C, 0xB2, 0x07, 0x30, 0x5E, 0xCA, 0x21, 0xED, 0xF7, 0xC9, 0x2A, 0x39, 0x0D, 0x88,
+  0x4B, 0x07, 0xDE, 0xD8, 0x19, 0x55, 0xA1, 0x43, 0x85, 0xD3, 0xED, 0xA8, 0xAC, 0x98, 0x19, 0x14,
+  0x32, 0x44, 0x87, 0xD7, 0x55, 0x99, 0x53, 0x15, 0xDE, 0xF1, 0xE9, 0x2F, 0x7B, 0xEF, 0x8F, 0x0F,
+  0x2F, 0x3F, 0x9E, 0xFE, 0xFB, 0xE9, 0x87, 0x4F, 0xA7, 0x00, 0xA6, 0xD7, 0x92, 0x6B, 0x10, 0x4C,
+  0x97, 0x5B, 0x1A, 0x82, 0x66, 0x4D, 0x67, 0x0C, 0x2A, 0x98, 0xB6, 0xD0, 0x3D, 0x83, 0xE4, 0xEB,
+  0xB1, 0x3F, 0x99, 0xC6, 0x42, 0x67, 0x18, 0xB3, 0xAB, 0x9D, 0xD7, 0x0D, 0x75, 0xB1, 0xCF, 0x2C,
+  0xA7, 0x72, 0xBD, 0x5C, 0x5B, 0xC3, 0x29, 0x1B, 0x8C, 0x28, 0x98, 0x1A, 0xC3, 0x46, 0xCD, 0x13,
+  0x55, 0xA4, 0x02, 0x7B, 0x45, 0x6A, 0x64, 0x85, 0x60, 0x7D, 0x80, 0x86, 0xF5, 0x91, 0x2C, 0x5C,
+  0x89, 0x81, 0x0E, 0x5C, 0x94, 0xA3, 0xC9, 0xC8, 0x8B, 0x1B, 0xF5, 0x56, 0x5D, 0xAC, 0xCC, 0xB0,
+  0x56, 0x92, 0xC6, 0x08, 0x94, 0xED, 0x3D, 0x53, 0x94, 0xF0, 0x9F, 0xD7, 0xAC, 0x7A, 0x7B, 0x44,
+  0xFD, 0x61, 0x7C, 0x03, 0x3C, 0xEB, 0xE2, 0xC7, 0x15, 0xD0, 0x94, 0xEA, 0x6A, 0x8F, 0x50, 0x3D,
+  0x5C, 0x70, 0xB0, 0xEE, 0xEF, 0xF7, 0x5F, 0xB6, 0xB5, 0x92, 0x5B, 0xA6, 0xA5, 0x79, 0x11, 0x50,
+  0xD3, 0x55, 0x8A, 0x4D, 0xF2, 0x5D, 0x4E, 0x30, 0xC0, 0x5A, 0x21, 0xB5, 0x16, 0xB6, 0xE4, 0x1F,
+  0xE0, 0x17, 0xD9, 0x03, 0xDE, 0xAC, 0x3F, 0x81, 0x81, 0x03, 0xB8, 0xD0, 0xDD, 0xB1, 0xE3, 0xBB,
+  0x51, 0x52, 0xE4, 0x5D, 0x93, 0x86, 0xE7, 0xB6, 0x81, 0x11, 0xA3, 0xA9, 0x4B, 0xA3, 0x46, 0x2D,
+  0x72, 0x4F, 0x82, 0xA9, 0x0F, 0x63, 0x54, 0x6B, 0xAA, 0x24, 0x73, 0x30, 0x17, 0x68, 0x6C, 0x04,
+  0xFE, 0x5A, 0x70, 0x7D, 0x4D, 0xFA, 0x87, 0x04, 0x74, 0xA1, 0xA3, 0xD5, 0x40, 0x68, 0x8C, 0x7C,
+  0x50, 0xE6, 0x4C, 0x07, 0xD7, 0x4C, 0x18, 0xF8, 0x73, 0xE3, 0xB9, 0xB4, 0x51, 0xC3, 0xE5, 0xE4,
+  0xC4, 0xF1, 0x81, 0xEB, 0x61, 0xAD, 0xB9, 0xAD, 0x55, 0xFA, 0xA6, 0xFD, 0x45, 0x01, 0x8E, 0x06,
+  0x39, 0x0E, 0xA7, 0x76, 0xC0, 0xB8, 0x7A, 0x56, 0x04, 0x9C, 0xFE, 0x96, 0x80, 0xC7, 0x11, 0x01,
+  0xE8, 0xBA, 0x0D, 0x94, 0xC1, 0x93, 0x31, 0x91, 0x80, 0x2A, 0x1D, 0x49, 0x62, 0x8C, 0xC5, 0x5E,
+  0x3C, 0x62, 0xEB, 0xDA, 0xF9, 0xC5, 0xBF, 0xB3, 0x61, 0x31, 0xDA, 0xC2, 0x98, 0x91, 0x3E, 0x18,
+  0x70, 0x93, 0x9A, 0x0E, 0x20, 0xB3, 0x9C, 0x61, 0x87, 0x95, 0xE1, 0x94, 0x9C, 0x36, 0x49, 0x51,
+  0xCD, 0xB5, 0x7C, 0xF6, 0x5C, 0xC1, 0x62, 0x7B, 0x10, 0xF8, 0xD7, 0xDE, 0xD0, 0xE4, 0x4E, 0x3A,
+  0x36, 0xB0, 0x42, 0x46, 0x41, 0x58, 0x56, 0x6B, 0x32, 0x29, 0xAB, 0x41, 0xE3, 0x1B, 0x1A, 0xFA,
+  0x34, 0x2E, 0xAB, 0xE7, 0xC7, 0x05, 0xA0, 0xD6, 0xD6, 0x78, 0x25, 0x67, 0x34, 0x0A, 0xEE, 0x3E,
+  0x79, 0x6F, 0xBC, 0x0F, 0xA0, 0x44, 0x8E, 0x24, 0xE4, 0x91, 0x07, 0xAC, 0x86, 0x66, 0x50, 0xED,
+  0x4D, 0x80, 0xA6, 0x00, 0x18, 0xC4, 0x94, 0xD0, 0xFB, 0x89, 0xE3, 0x47, 0xA0, 0x0A, 0x66, 0x83,
+  0xD6, 0xA7, 0xC0, 0xBE, 0xB0, 0x00, 0x5A, 0x0E, 0xFD, 0x38, 0x59, 0xCF, 0x82, 0x30, 0x3E, 0xB8,
+  0x71, 0x7C, 0x9F, 0x8E, 0x0E, 0xC3, 0x60, 0x02, 0xFB, 0x13, 0xBF, 0xA2, 0x5C, 0x5B, 0xC6, 0xF1,
+  0xE8, 0x7E, 0x02, 0x76, 0x4B, 0x54, 0x23, 0xFF, 0xF5, 0x5F, 0xC4, 0x52, 0xFC, 0xC6, 0x19, 0xD0,
+  0xF8, 0x8F, 0x31, 0x7E, 0x9C, 0x31, 0x5E, 0x68, 0xC4, 0xC8, 0xD9, 0x68, 0x1A, 0x15, 0x68, 0xBD,
+  0xE2, 0x91, 0xE1, 0xA3, 0xF7, 0xC7, 0xC8, 0x54, 0x9D, 0x7D, 0xB0, 0x15, 0xAE, 0x8D, 0xA7, 0xF7,
+  0x62, 0xDA, 0xF5, 0x6A, 0x4D, 0x58, 0xC8, 0x7C, 0x1A, 0xBE, 0xBB, 0x38, 0x79, 0x8F, 0x7A, 0xF7,
+  0xD3, 0x0D, 0xA5, 0xA3, 0xB5, 0x43, 0x2F, 0x24, 0x47, 0xB0, 0xD0, 0xBB, 0x34, 0xAC, 0xCD, 0x3B,
+  0x1F, 0xD9, 0x84, 0x23, 0xEF, 0x57, 0xF7, 0x61, 0xF1, 0x2C, 0x9C, 0x94, 0xA2, 0x0E, 0x01, 0xA4,
+  0xB0, 0x87, 0x7C, 0xE4, 0x29, 0xCA, 0x21, 0xFD, 0x31, 0x45, 0x2B, 0x0E, 0xE2, 0x39, 0xBD, 0xA6,
+  0x21, 0xF5, 0x07, 0x94, 0xF4, 0x63, 0xE6, 0x66, 0xFA, 0xEE, 0x1A, 0x94, 0xE3, 0x2A, 0x1F, 0x1E,
+  0x5E, 0xEF, 0x9F, 0x7C, 0x78, 0xAC, 0x26, 0x97, 0x62, 0x79, 0xFE, 0x1D, 0x3D, 0x2E, 0x7C, 0x87,
+  0xFD, 0x0B, 0x0D, 0x11, 0xD0, 0x31, 0xD2, 0x9C, 0xB5, 0x42, 0x4F, 0xA6, 0xB0, 0xE9, 0x06, 0x4B,
+  0x96, 0x12, 0xE7, 0x2A, 0xB8, 0xA5, 0x24, 0xDB, 0x90, 0xC4, 0x34, 0x8A, 0xCD, 0x56, 0x81, 0xEB,
+  0x5D, 0x3F, 0xC0, 0xE6, 0x3F, 0x8E, 0xC1, 0xE2, 0x8F, 0x88, 0x3B, 0xA5, 0x24, 0x0E, 0xC8, 0xB5,
+  0x68, 0x49, 0x46, 0xDE, 0xD8, 0xE3, 0x62, 0x11, 0x59, 0x6D, 0xDA, 0xDD, 0x1D, 0xD8, 0xCA, 0x74,
+  0xAD, 0x12, 0xC3, 0xFC, 0x45, 0xA0, 0x70, 0x50, 0x1D, 0xB9, 0x0F, 0xBE, 0x33, 0xF6, 0x06, 0x80,
+  0x8D, 0x8E, 0x6C, 0xE3, 0x84, 0xBB, 0x05, 0x9F, 0xDE, 0x7D, 0x98, 0xB0, 0x8D, 0x0A, 0x77, 0x22,
+  0xF2, 0x3F, 0x1A, 0xF5, 0x93, 0xE0, 0x8E, 0x86, 0xF5, 0x16, 0xA9, 0x77, 0xBB, 0x75, 0x9B, 0x14,
+  0x30, 0x3C, 0xE8, 0xF5, 0x6C, 0x24, 0x10, 0x5A, 0x64, 0xEA, 0xBB, 0x20, 0xE1, 0x3E, 0x75, 0x2D,
+  0x2D, 0xF2, 0x10, 0x1D, 0xAD, 0xF6, 0x61, 0xB3, 0x15, 0x0B, 0x64, 0xBD, 0xC5, 0x91, 0xD9, 0x46,
+  0x19, 0x76, 0x1D, 0x71, 0xC8, 0x58, 0x3D, 0x44, 0xE7, 0xAC, 0x83, 0x3E, 0xB6, 0xAB, 0x07, 0x82,
+  0xC6, 0xF0, 0xD4, 0xF7, 0xE2, 0x12, 0x69, 0x88, 0xDC, 0x37, 0x21, 0xA5, 0xFD, 0x09, 0x28, 0xD5,
+  0x5A, 0x53, 0xC3, 0x05, 0xDA, 0xD7, 0xA8, 0x89, 0xDE, 0xA8, 0x92, 0x4A, 0x37, 0x4E, 0xE8, 0xE2,
+  0x30, 0x1F, 0x1F, 0x96, 0x54, 0xCC, 0x0A, 0x53, 0x49, 0x03, 0xD7, 0x79, 0x88, 0xCE, 0xE9, 0xD8,
+  0xF1, 0x7C, 0xE8, 0x6B, 0x49, 0xDD, 0x49, 0x18, 0xE0, 0xEE, 0xA4, 0x83, 0x3E, 0xCA, 0x6A, 0x55,
+  0xBB, 0xD5, 0xAB, 0xF6, 0xAA, 0x57, 0x5D, 0xAF, 0x5E, 0x75, 0xA3, 0x7A, 0xD5, 0xCD, 0xEA, 0x55,
+  0xB7, 0xAA, 0x57, 0x7D, 0x5E, 0xA1, 0x6A, 0xE8, 0xB8, 0x5E, 0x70, 0xB2, 0x77, 0x50, 0x36, 0x54,
+  0xF4, 0xD6, 0x1B, 0xD0, 0xFD, 0x8B, 0x52, 0x21, 0x80, 0xDD, 0xB5, 0x74, 0x25, 0x97, 0xD4, 0xBC,
+  0x72, 0x62, 0x98, 0x46, 0x0F, 0x67, 0x34, 0x1C, 0x30, 0x0D, 0x5B, 0x4C, 0x26, 0x48, 0xC8, 0xFE,
+  0xF4, 0x1A, 0x56, 0x21, 0xDC, 0x21, 0x44, 0x4A, 0x6D, 0x53, 0xAD, 0x80, 0x26, 0xF1, 0x5C, 0xDD,
+  0x9A, 0xD1, 0xF6, 0x99, 0x65, 0xBA, 0x34, 0x8C, 0xBF, 0x66, 0xA4, 0xD8, 0x82, 0xC3, 0x5A, 0x2F,
+  0x1F, 0x6B, 0x7E, 0xAB, 0x8F, 0x93, 0x21, 0x8C, 0x01, 0xAD, 0x2D, 0x40, 0xF2, 0x00, 0x97, 0xB6,
+  0x70, 0x7C, 0x8E, 0xEE, 0xDA, 0x2C, 0xB1, 0xCC, 0x8B, 0x7B, 0x10, 0x8C, 0x27, 0xA0, 0x3F, 0x69,
+  0xA3, 0x39, 0x33, 0x58, 0xF4, 0xF7, 0x9E, 0xD3, 0x01, 0xF5, 0x26, 0x16, 0xE0, 0xD9, 0x3A, 0x3A,
+  0x86, 0x12, 0x14, 0x42, 0x50, 0xF9, 0x29, 0x83, 0x05, 0xFA, 0x34, 0x04, 0xAB, 0x23, 0x3E, 0x53,
+  0x6B, 0xD9, 0x38, 0xFB, 0x27, 0xF4, 0x47, 0x4D, 0xA6, 0xF1, 0xEF, 0x78, 0xF0, 0xB5, 0x23, 0x80,
+  0x9E, 0xA3, 0x64, 0x7F, 0xF9, 0x1D, 0x2A, 0x4F, 0xE9, 0x0E, 0xFA, 0x10, 0xAC, 0xD0, 0x56, 0x48,
+  0xED, 0x0B, 0xF0, 0x1E, 0xDA, 0x4C, 0x1A, 0x75, 0xE6, 0xC9, 0xA6, 0x78, 0x0C, 0x86, 0x7E, 0x83,
+  0x19, 0x58, 0x25, 0x97, 0xC2, 0x8F, 0x13, 0x3C, 0x46, 0x93, 0xCC, 0xCE, 0x76, 0xC8, 0x5E, 0xAF,
+  0x31, 0x37, 0x26, 0xB4, 0xC6, 0x70, 0xD3, 0x54, 0x8C, 0x87, 0xD7, 0x6A, 0x70, 0xD7, 0x56, 0x55,
+  0x44, 0xCA, 0x79, 0x95, 0x6D, 0x02, 0xA8, 0x87, 0x59, 0x36, 0x49, 0x5F, 0x68, 0x0E, 0x2A, 0x47,
+  0x62, 0x05, 0xB8, 0xD9, 0xDA, 0xFC, 0x68, 0xB8, 0xF7, 0x46, 0x05, 0xFD, 0xE6, 0x07, 0x72, 0x4B,
+  0xC7, 0xCD, 0x4E, 0xF5, 0xB2, 0x58, 0xE5, 0x61, 0xDF, 0xA3, 0xE0, 0xFB, 0x6C, 0xC7, 0xF7, 0xF9,
+  0xB1, 0xF0, 0xFD, 0x66, 0xC7, 0xF7, 0xDB, 0xA3, 0xE0, 0x8B, 0x26, 0x7E, 0x70, 0x77, 0x46, 0x29,
+  0x6C, 0x35, 0xA6, 0x36, 0x8B, 0x38, 0xB1, 0x50, 0x49, 0xA7, 0x69, 0xDD, 0x22, 0x4F, 0xA0, 0x2D,
+  0xAC, 0x8E, 0x91, 0xB9, 0x3F, 0xAE, 0x55, 0x27, 0x42, 0x80, 0xB0, 0xAF, 0x22, 0x56, 0xF8, 0x2B,
+  0xAC, 0x9B, 0xA8, 0x9A, 0x5E, 0x5F, 0x85, 0xBB, 0x33, 0xA0, 0x8A, 0xB8, 0x15, 0x8E, 0xA7, 0x7F,
+  0xB6, 0x75, 0x20, 0x39, 0x1A, 0x6C, 0x4F, 0xA6, 0xD1, 0xCD, 0x8C, 0xFA, 0x40, 0xC0, 0x96, 0x67,
+  0x88, 0xB9, 0xF0, 0x65, 0x85, 0x79, 0x70, 0x5C, 0x8F, 0xB9, 0xDD, 0x60, 0x82, 0x36, 0x0E, 0xA8,
+  0x67, 0x92, 0x81, 0xEB, 0x31, 0xB7, 0x71, 0xB3, 0x2A, 0x52, 0x3D, 0x0B, 0x06, 0x96, 0xD7, 0x5E,
+  0xC7, 0x21, 0x71, 0x46, 0xDE, 0xD0, 0xDF, 0xA9, 0x8F, 0xE8, 0x75, 0x5C, 0xDF, 0x35, 0x9D, 0xCB,
+  0x96, 0x16, 0xEE, 0x2E, 0xAE, 0x2C, 0x1A, 0x7D, 0x38, 0x6C, 0x6B, 0x58, 0x50, 0xB5, 0xB5, 0x1C,
+  0xEB, 0xCA, 0x8D, 0x5E, 0xB3, 0xC5, 0x8E, 0xC4, 0x0F, 0x13, 0xBA, 0xC3, 0xD7, 0xAC, 0xAB, 0xE0,
+  0xBE, 0x0E, 0x06, 0xD3, 0x4E, 0xDD, 0x46, 0x4D, 0x9D, 0xB0, 0x65, 0xB1, 0x8E, 0xC0, 0x8E, 0x0F,
+  0xEB, 0x64, 0x00, 0x15, 0x22, 0xF8, 0x13, 0xB6, 0xF8, 0xAB, 0xAC, 0xF5, 0x2A, 0x87, 0xA7, 0x78,
+  0xFF, 0x0F, 0xF0, 0x73, 0x7D, 0xB7, 0x22, 0x49, 0x6B, 0xF1, 0x4C, 0x52, 0x0A, 0xA3, 0x0C, 0x4D,
+  0xB3, 0x23, 0x82, 0x87, 0xCB, 0x48, 0xF7, 0x4C, 0xCB, 0xE1, 0x98, 0x85, 0x1A, 0xD8, 0x87, 0x57,
+  0x3D, 0xBA, 0xE7, 0xCB, 0xFD, 0xCC, 0xF2, 0xC8, 0x23, 0x02, 0xF2, 0xC1, 0x27, 0x11, 0x03, 0x73,
+  0xC1, 0xFF, 0xB8, 0xFF, 0xEB, 0x65, 0x16, 0xB6, 0x12, 0x16, 0x20, 0x04, 0xDE, 0x73, 0xB7, 0xF3,
+  0x6A, 0x9C, 0xF3, 0x73, 0x8E, 0x8C, 0xEA, 0x34, 0x80, 0xBC, 0x77, 0xAE, 0xE8, 0x48, 0x06, 0x0A,
+  0xE4, 0xD4, 0x3B, 0x14, 0xA7, 0x75, 0x69, 0x2B, 0x79, 0x6A, 0x77, 0x69, 0x6E, 0x73, 0xB1, 0x27,
+  0x4A, 0x2B, 0x79, 0x68, 0x07, 0x1B, 0xFD, 0x75, 0xDB, 0x36, 0x5F, 0x0D, 0x74, 0xE0, 0x47, 0x93,
+  0x4A, 0xE3, 0xDF, 0xBB, 0x5F, 0xD0, 0x1D, 0x82, 0xBC, 0xC0, 0xA8, 0x8D, 0xCB, 0x6E, 0xE7, 0xF9,
+  0x06, 0xD4, 0xC0, 0xDF, 0x33, 0x80, 0x10, 0xAF, 0x19, 0x1B, 0xF1, 0xD3, 0x8E, 0x0A, 0xDB, 0x86,
+  0x5E, 0xAA, 0x90, 0x13, 0x1B, 0x09, 0xF8, 0xD7, 0xB6, 0xB5, 0x89, 0x1A, 0x9A, 0xC1, 0xE4, 0xFC,
+  0x26, 0x34, 0x27, 0x83, 0x61, 0xE4, 0x1A, 0x2D, 0x55, 0xC6, 0xEB, 0x1D, 0xC6, 0x69, 0x79, 0xC9,
+  0x0E, 0x4C, 0x95, 0xCF, 0x3D, 0xC6, 0x87, 0x84, 0x07, 0xD6, 0xCE, 0x5B, 0x98, 0xBE, 0xB3, 0x43,
+  0x36, 0xF2, 0x7A, 0x3D, 0x2F, 0x21, 0xD6, 0xCF, 0xEB, 0x29, 0x7D, 0x1B, 0x9D, 0xE7, 0xBD, 0xCB,
+  0x6E, 0x15, 0x56, 0x40, 0x03, 0x3A, 0x46, 0x57, 0x13, 0x8B, 0x54, 0x81, 0x2E, 0x44, 0x94, 0xFA,
+  0x33, 0x30, 0x2C, 0xF9, 0x24, 0x65, 0x11, 0xE1, 0xD4, 0x9B, 0xED, 0xBF, 0x05, 0x9E, 0xDF, 0xA8,
+  0xD7, 0x9B, 0x19, 0xD1, 0xC1, 0xF2, 0x67, 0x05, 0x44, 0x65, 0x46, 0xD5, 0xF5, 0x6E, 0x35, 0x95,
+  0x38, 0x0C, 0x83, 0xE9, 0x84, 0x84, 0xC1, 0x1D, 0xD7, 0xA8, 0xE3, 0x68, 0xA8, 0x30, 0x22, 0xD1,
+  0xA9, 0xA6, 0x24, 0x64, 0xC0, 0x8E, 0x58, 0x3F, 0x00, 0x22, 0x57, 0xCA, 0x66, 0x7B, 0x89, 0x72,
+  0x10, 0x8C, 0x56, 0xA3, 0xF1, 0xEA, 0x06, 0xC1, 0x5F, 0xB6, 0xD8, 0xBF, 0x8C, 0x0A, 0xD6, 0xBC,
+  0xBE, 0x6B, 0x34, 0xE5, 0xCC, 0x81, 0xF6, 0xAF, 0x5E, 0xAF, 0xB1, 0x1A, 0xA5, 0x64, 0x28, 0xBD,
+  0xD3, 0x50, 0x6D, 0xD4, 0xF5, 0x65, 0x84, 0x07, 0x76, 0x19, 0x8B, 0x43, 0xE0, 0xC7, 0x61, 0x30,
+  0xAA, 0x97, 0xE0, 0x90, 0xEB, 0x4E, 0xA6, 0x8B, 0x7C, 0xEB, 0xA5, 0x96, 0x31, 0x6D, 0x55, 0x89,
+  0x7D, 0x13, 0x92, 0x03, 0xF6, 0x28, 0x0C, 0x83, 0x94, 0x4E, 0xCF, 0x1F, 0x79, 0x3E, 0xE5, 0xDF,
+  0x60, 0xB9, 0x9A, 0x94, 0xC2, 0x5D, 0x03, 0x86, 0xEC, 0xF2, 0x7F, 0x67, 0x58, 0xB2, 0xD8, 0x32,
+  0xE9, 0xF9, 0x43, 0x25, 0x94, 0xC9, 0xB2, 0x5B, 0xCD, 0x56, 0x9A, 0x65, 0x29, 0xF3, 0xD3, 0x66,
+  0xB9, 0x8E, 0x87, 0x6C, 0x9D, 0x99, 0x77, 0x75, 0xCC, 0x87, 0x5B, 0xD8, 0x8F, 0x6C, 0x9D, 0x59,
+  0xBA, 0x01, 0xEB, 0xAD, 0x6C, 0x96, 0xB7, 0x3B, 0xCD, 0x54, 0x99, 0xB1, 0x13, 0xC2, 0x73, 0x74,
+  0x0C, 0xF2, 0x99, 0xFA, 0x9A, 0x6C, 0xD6, 0xB5, 0xB5, 0x62, 0x3B, 0x0A, 0x07, 0xB3, 0x7B, 0x58,
+  0x32, 0xF1, 0x35, 0x36, 0x5F, 0x88, 0x2D, 0x08, 0x67, 0x36, 0x63, 0x55, 0x84, 0x9A, 0xDA, 0x0C,
+  0x8E, 0x24, 0x08, 0x75, 0x0E, 0x88, 0x01, 0xFA, 0x57, 0xED, 0x20, 0x79, 0x14, 0xAB, 0x01, 0x53,
+  0xF1, 0x44, 0x33, 0x53, 0x90, 0x80, 0x81, 0x49, 0x23, 0xB2, 0x46, 0x98, 0xBB, 0x90, 0x5C, 0x4D,
+  0xE3, 0x58, 0x75, 0xF6, 0x57, 0x8B, 0x33, 0x89, 0xC3, 0x07, 0xCB, 0x32, 0x25, 0xF6, 0x78, 0xC2,
+  0xF5, 0x92, 0x84, 0x6C, 0x68, 0x1A, 0x9C, 0x0C, 0x9C, 0x78, 0x70, 0x43, 0x1A, 0x14, 0xE7, 0xB9,
+  0x6D, 0xAD, 0xD3, 0x62, 0x7B, 0x8E, 0xA3, 0x68, 0x4A, 0xC9, 0x9D, 0x07, 0x6B, 0xE3, 0xF1, 0xA1,
+  0x0C, 0xF3, 0x69, 0x56, 0x3F, 0x5A, 0x29, 0x0E, 0xC3, 0xA9, 0xD8, 0x0B, 0x11, 0x47, 0xF9, 0x74,
+  0xDD, 0x50, 0x86, 0x6C, 0x6F, 0x34, 0x82, 0xDD, 0xD8, 0x70, 0x3A, 0xC2, 0x60, 0x29, 0xA6, 0xE3,
+  0xF9, 0xF0, 0xE1, 0xE9, 0x2A, 0xD3, 0xC9, 0xC6, 0xC8, 0xCD, 0xD0, 0x41, 0xD6, 0xDC, 0x66, 0x6F,
+  0x3E, 0xFE, 0x18, 0x7D, 0xB3, 0x85, 0xA1, 0xF5, 0xE5, 0x99, 0x14, 0xFA, 0xB9, 0x30, 0xF2, 0x4A,
+  0x98, 0xB7, 0x6C, 0x6F, 0xCD, 0x1D, 0x7D, 0x78, 0xC4, 0x3D, 0xA4, 0xC2, 0xF6, 0x33, 0xF6, 0xF1,
+  0xF5, 0xFA, 0x76, 0x52, 0x9D, 0xF9, 0x49, 0x85, 0x73, 0xF0, 0x04, 0x16, 0xFD, 0x6C, 0x4D, 0x41,
+  0xC0, 0x61, 0xE0, 0xD7, 0x63, 0x32, 0xE5, 0x21, 0x46, 0x20, 0x30, 0x0E, 0xB0, 0xFB, 0x8E, 0xE2,
+  0xFE, 0x97, 0x7A, 0xB7, 0x30, 0xF8, 0x77, 0x4E, 0xA4, 0xE8, 0x02, 0x18, 0x81, 0xEB, 0xE0, 0x99,
+  0xB4, 0xDF, 0xF4, 0x00, 0x25, 0x95, 0x4D, 0xB9, 0x91, 0xB8, 0xE9, 0xB8, 0xBE, 0x09, 0xC2, 0x01,
+  0x85, 0x21, 0x63, 0x51, 0xEA, 0x82, 0x80, 0x74, 0x28, 0xD9, 0x89, 0x3E, 0x75, 0xA2, 0x69, 0xC8,
+  0xCA, 0x71, 0xA9, 0x7D, 0xF7, 0x77, 0xE8, 0x85, 0xEB, 0x45, 0x13, 0x1C, 0x1A, 0x16, 0xEF, 0x8F,
+  0x27, 0x52, 0xE4, 0x60, 0x1A, 0xC5, 0xC1, 0x98, 0xFF, 0x0D, 0xFB, 0x47, 0x64, 0x4F, 0xBD, 0xA9,
+  0xE8, 0xDF, 0xA1, 0x88, 0xB6, 0x40, 0x0D, 0xC6, 0xC3, 0xA2, 0x8E, 0xFD, 0x85, 0x01, 0xBD, 0x41,
+  0x6D, 0x33, 0x37, 0x14, 0xA6, 0xAB, 0xF6, 0xD9, 0xC9, 0xB2, 0x1A, 0xD3, 0xC8, 0x3D, 0x1D, 0xCB,
+  0x85, 0xF9, 0x96, 0x06, 0x73, 0x83, 0xA4, 0x3E, 0xEE, 0x8C, 0xDF, 0x07, 0xC3, 0x21, 0x3B, 0xD1,
+  0x5A, 0x08, 0xCA, 0x69, 0x1C, 0x7A, 0x13, 0x79, 0xFC, 0xBC, 0x38, 0x24, 0x79, 0xF4, 0x3C, 0x27,
+  0x24, 0x23, 0x4E, 0x6B, 0x41, 0x8A, 0x8E, 0xEE, 0x61, 0x5D, 0xF6, 0x9D, 0xD1, 0xD9, 0x94, 0xA9,
+  0xD8, 0x85, 0x60, 0x9D, 0xC1, 0x4E, 0x20, 0x3E, 0xA3, 0xE1, 0x35, 0x1D, 0xC4, 0x07, 0x41, 0x88,
+  0xC1, 0x23, 0x78, 0x12, 0x3D, 0x37, 0x54, 0xB6, 0xC4, 0xF1, 0x15, 0x7E, 0x4E, 0x08, 0x8E, 0x1F,
+  0x53, 0xDF, 0x77, 0x92, 0xA0, 0x09, 0x46, 0xE1, 0xFC, 0xD0, 0xA6, 0x71, 0x70, 0x7C, 0xF2, 0x71,
+  0x8C, 0x1E, 0xCC, 0x3D, 0x74, 0x4F, 0x8D, 0x17, 0x97, 0x88, 0xBD, 0xF3, 0xB3, 0x79, 0x84, 0x34,
+  0x81, 0xC4, 0x75, 0x0F, 0xCE, 0x3E, 0x74, 0x82, 0xA8, 0xE6, 0x21, 0x2F, 0x91, 0x4E, 0x40, 0xB3,
+  0x34, 0x1E, 0x08, 0x89, 0xDE, 0xC7, 0x05, 0xC9, 0x28, 0xE1, 0x12, 0x9A, 0x29, 0x99, 0xBA, 0x93,
+  0xCC, 0x37, 0xF7, 0x66, 0x30, 0x91, 0x31, 0x15, 0x59, 0xEC, 0x60, 0x26, 0xA1, 0x59, 0x23, 0x0B,
+  0x60, 0x6D, 0x54, 0x2F, 0x01, 0xB1, 0xF0, 0x0C, 0x58, 0x6C, 0x84, 0xEE, 0x15, 0x0B, 0x5B, 0x14,
+  0x3F, 0xC0, 0x9A, 0x82, 0xAC, 0x18, 0xB1, 0xEB, 0x55, 0x35, 0x3F, 0xF0, 0x69, 0x4D, 0xBF, 0x3E,
+  0xC4, 0x62, 0x49, 0xCA, 0x5B, 0x5E, 0x8D, 0x82, 0xC1, 0x57, 0xDE, 0x14, 0xCC, 0xA7, 0x90, 0xA2,
+  0x3A, 0x3F, 0xE8, 0xFF, 0x42, 0x02, 0xBE, 0x54, 0x88, 0x30, 0x0A, 0x16, 0xA6, 0xAC, 0xC0, 0x16,
+  0x37, 0x2B, 0x92, 0xEB, 0x52, 0xFC, 0xBA, 0x05, 0xAB, 0x8A, 0x8D, 0x15, 0xD7, 0xCD, 0xDA, 0xDA,
+  0x71, 0xBA, 0xA8, 0x27, 0x75, 0x07, 0xA3, 0x48, 0xDC, 0x5F, 0xC2, 0x6B, 0x14, 0x49, 0x24, 0xED,
+  0x7F, 0x4E, 0xC1, 0x00, 0xE6, 0x17, 0x75, 0x82, 0x10, 0x0C, 0x83, 0x46, 0xAD, 0xAD, 0xEE, 0xED,
+  0x5A, 0x84, 0xFF, 0xE9, 0x1A, 0x71, 0x97, 0xB6, 0xF0, 0x6C, 0x05, 0x83, 0xF0, 0x3D, 0xC0, 0xF7,
+  0x95, 0x15, 0x75, 0x11, 0x53, 0x08, 0x86, 0xDD, 0x96, 0xD2, 0xE0, 0xF7, 0xFB, 0x2F, 0x6D, 0x11,
+  0x6B, 0xCD, 0x8E, 0xE2, 0xF4, 0x12, 0x6E, 0x55, 0xB0, 0xC2, 0x64, 0xC8, 0x32, 0xD6, 0x67, 0xCB,
+  0x62, 0x7C, 0x26, 0xDE, 0x05, 0x5C, 0xB4, 0xC9, 0x98, 0x3B, 0x2F, 0xD9, 0x1F, 0xBC, 0x7C, 0x56,
+  0xA6, 0xA4, 0xDE, 0xD0, 0x57, 0x7E, 0x10, 0x37, 0xDA, 0xA6, 0x4B, 0xB4, 0x29, 0xF9, 0xC5, 0x48,
+  0x49, 0xAC, 0x8D, 0xA7, 0xE5, 0x96, 0x34, 0x32, 0xB3, 0xFC, 0xB2, 0xD1, 0xA1, 0xBA, 0xFD, 0x2B,
+  0xD1, 0xA1, 0x9D, 0x22, 0x00, 0x12, 0x8C, 0xB6, 0xAE, 0xB7, 0xEA, 0xF0, 0xAF, 0x02, 0x0A, 0xE8,
+  0x98, 0x0D, 0x7F, 0x72, 0x2C, 0x30, 0x13, 0x0D, 0xC9, 0x69, 0x83, 0x8D, 0x0E, 0x59, 0x68, 0xA7,
+  0xC5, 0x30, 0x13, 0x7D, 0x58, 0xE0, 0x87, 0xDC, 0xD0, 0x4C, 0x51, 0x65, 0x6E, 0x1C, 0xE2, 0x2C,
+  0x6C, 0x68, 0xE5, 0xCF, 0xA4, 0x67, 0x5A, 0xB9, 0xF6, 0x04, 0x9D, 0x4B, 0x2F, 0x46, 0x35, 0x64,
+  0x61, 0x8B, 0xF4, 0x3A, 0x9D, 0x4E, 0x33, 0xAB, 0x32, 0x98, 0x77, 0x02, 0x54, 0x45, 0x8B, 0x30,
+  0xDB, 0x18, 0x7D, 0x11, 0x9A, 0x0A, 0xC1, 0x7E, 0x71, 0x0F, 0x86, 0x61, 0x72, 0xE2, 0xE9, 0x0F,
+  0x2B, 0x78, 0x45, 0xB0, 0xDB, 0x49, 0x6B, 0x1D, 0xC5, 0x60, 0x44, 0x9D, 0x50, 0xE2, 0xA8, 0x06,
+  0xB8, 0x9E, 0x25, 0xB2, 0x3F, 0x1D, 0x0C, 0xC0, 0x44, 0x66, 0x64, 0x2A, 0xB7, 0x3E, 0x12, 0x38,
+  0xA2, 0xDC, 0x46, 0xA2, 0x28, 0xE2, 0x44, 0x42, 0x5B, 0x04, 0xAE, 0x53, 0x97, 0x02, 0xAF, 0x0A,
+  0xD7, 0x42, 0x21, 0xD8, 0xE4, 0x92, 0x3A, 0xC1, 0x49, 0x69, 0x24, 0x27, 0x97, 0x52, 0xAF, 0xC5,
+  0xF6, 0x03, 0xB7, 0x6F, 0xEC, 0x04, 0x5F, 0x11, 0xB0, 0xEC, 0xB6, 0x46, 0xEE, 0xD9, 0xD0, 0x93,
+  0x84, 0x0B, 0x55, 0x3B, 0x64, 0xBA, 0xA4, 0x21, 0x9C, 0x4A, 0x09, 0x65, 0xDB, 0xC5, 0xAD, 0x30,
+  0xCE, 0x4B, 0xF3, 0x43, 0x59, 0x3D, 0x19, 0x7C, 0x77, 0xF4, 0x0F, 0x6D, 0x2F, 0x63, 0x6C, 0xBE,
+  0x66, 0xA6, 0x30, 0x83, 0xAE, 0x8C, 0x3E, 0x4B, 0x97, 0x8A, 0x29, 0xB4, 0x1C, 0xC0, 0xB2, 0x21,
+  0xB7, 0x8D, 0xB4, 0x18, 0xA3, 0x54, 0xDA, 0x15, 0x31, 0x52, 0xC7, 0xAF, 0x26, 0x44, 0x5A, 0xDC,
+  0x17, 0x4A, 0x62, 0x2D, 0x4C, 0xA1, 0x51, 0xC6, 0xDB, 0x58, 0x71, 0x2D, 0x92, 0xC2, 0xEE, 0xB7,
+  0x22, 0x5C, 0x76, 0xD0, 0xCB, 0xEF, 0x5E, 0x2A, 0xF0, 0x50, 0x63, 0x8A, 0x1D, 0xE0, 0x2F, 0xB8,
+  0xD6, 0x28, 0x92, 0xC8, 0xCA, 0x84, 0x7A, 0x95, 0x65, 0x2D, 0xBC, 0x66, 0xD8, 0xDB, 0xDC, 0x04,
+  0x62, 0x59, 0xC4, 0xE4, 0x15, 0x85, 0xFF, 0xC5, 0x77, 0x94, 0xFA, 0xA4, 0xC3, 0x76, 0xD1, 0x50,
+  0x56, 0x83, 0xC2, 0x41, 0x30, 0x1A, 0x39, 0x93, 0x88, 0xBE, 0x3D, 0xED, 0xF7, 0x79, 0x7C, 0x29,
+  0xDB, 0x38, 0x1A, 0xF3, 0x53, 0x54, 0xEA, 0x73, 0xC3, 0x14, 0xF4, 0xC5, 0x80, 0x47, 0x04, 0x0E,
+  0x9C, 0x90, 0xAA, 0x9A, 0x40, 0x14, 0xD8, 0xC6, 0x1B, 0xF9, 0x27, 0x47, 0x0D, 0x6A, 0xF2, 0x96,
+  0x36, 0xB9, 0x00, 0xAD, 0xB7, 0xCA, 0x4A, 0x57, 0x71, 0x35, 0x9F, 0xB1, 0xC9, 0x74, 0x52, 0xD4,
+  0x80, 0xCB, 0x51, 0x16, 0x81, 0xDA, 0x57, 0x58, 0xC8, 0x3D, 0xB4, 0xC0, 0xDE, 0x78, 0x74, 0xE4,
+  0x46, 0x8D, 0xF4, 0xEE, 0xD8, 0x81, 0x60, 0x82, 0xB0, 0x80, 0x06, 0x69, 0xB0, 0xA8, 0xC9, 0x9E,
+  0x84, 0xA9, 0x62, 0x2B, 0x2E, 0xE2, 0x76, 0x81, 0xDB, 0x72, 0x3F, 0x8F, 0xD8, 0xA5, 0x9D, 0x92,
+  0xDB, 0x3A, 0x1D, 0x12, 0x6C, 0x3A, 0xF4, 0xA3, 0x68, 0xD6, 0x76, 0x38, 0x94, 0xA2, 0x29, 0xFC,
+  0x5A, 0xAD, 0xF5, 0x7E, 0x1A, 0xFB, 0x0C, 0x4D, 0x59, 0x24, 0x74, 0xA5, 0x76, 0x7D, 0x35, 0x1E,
+  0x1A, 0x5A, 0x8A, 0xF8, 0xE8, 0x4A, 0x6D, 0xCF, 0xCE, 0x14, 0x16, 0xA9, 0x7B, 0xA1, 0x6A, 0xAD,
+  0x61, 0x4F, 0x17, 0xA9, 0x00, 0xF0, 0xCF, 0x4A, 0x2D, 0x31, 0xB6, 0x39, 0x6D, 0x78, 0xE7, 0x5D,
+  0x7B, 0xD5, 0xDA, 0x5D, 0x1C, 0x9C, 0x7D, 0x3C, 0x54, 0x68, 0x06, 0xCB, 0xFF, 0xA3, 0x3B, 0xA9,
+  0xD6, 0x96, 0xC5, 0x74, 0xA5, 0x4D, 0x99, 0x15, 0x56, 0x91, 0xC3, 0x0F, 0x51, 0x4C, 0xC7, 0x0A,
+  0x87, 0xF9, 0xDF, 0x95, 0xDA, 0x1E, 0xE9, 0x51, 0xE6, 0xD0, 0x3A, 0x89, 0x3B, 0xAF, 0xD4, 0xFE,
+  0xF4, 0x42, 0xE9, 0x2E, 0x86, 0xA2, 0xCB, 0x56, 0x7C, 0x15, 0x30, 0xD5, 0x16, 0x9F, 0x31, 0x42,
+  0xFC, 0x09, 0x6F, 0x99, 0x51, 0x55, 0x3C, 0x40, 0x38, 0x8D, 0xA0, 0x43, 0xD7, 0x76, 0x0B, 0xEF,
+  0x38, 0x6F, 0xBC, 0x54, 0xB4, 0x56, 0x17, 0xE3, 0xB4, 0x37, 0x5E, 0x42, 0x4B, 0x27, 0x74, 0x06,
+  0xB0, 0xE7, 0x8E, 0x54, 0xB5, 0xA5, 0xCF, 0xB0, 0x66, 0x82, 0x1A, 0xE7, 0x40, 0x1E, 0x5E, 0xAE,
+  0x22, 0x2D, 0x8E, 0xA6, 0x16, 0xDE, 0x46, 0xED, 0x74, 0xBA, 0xBD, 0x16, 0xBB, 0x4E, 0x9B, 0x55,
+  0x9C, 0xBC, 0x94, 0xA9, 0xCF, 0x6E, 0x87, 0x35, 0xB0, 0x4D, 0x56, 0xC9, 0x4B, 0x44, 0x79, 0x80,
+  0x77, 0xC4, 0x29, 0x54, 0x61, 0xDA, 0xA2, 0x21, 0x09, 0xB4, 0x91, 0xE3, 0xF9, 0xF0, 0xE1, 0xB6,
+  0xC6, 0x14, 0xF7, 0xCB, 0x4E, 0xAE, 0xDE, 0x7E, 0xD9, 0xA9, 0x80, 0x36, 0x03, 0xFA, 0xE0, 0xF4,
+  0xC3, 0x42, 0x90, 0x13, 0xE3, 0x24, 0xCF, 0xB9, 0x23, 0x2C, 0x7A, 0xD5, 0x5C, 0xB1, 0x8D, 0xB5,
+  0x9F, 0x36, 0xBA, 0x3C, 0x70, 0x80, 0x35, 0xE1, 0xBB, 0x20, 0x8A, 0xC5, 0xB0, 0x6F, 0x66, 0x86,
+  0x7D, 0x33, 0x67, 0xD8, 0xB3, 0xDD, 0xCE, 0xE9, 0x7A, 0x16, 0x1F, 0x6A, 0x0B, 0x8E, 0xEF, 0x25,
+  0xFE, 0x98, 0x28, 0xD9, 0xC7, 0xD9, 0x50, 0xD9, 0xFA, 0xC6, 0xAE, 0xD1, 0x72, 0xA7, 0x09, 0xC3,
+  0xB5, 0xDE, 0x31, 0x11, 0xAD, 0x77, 0xE6, 0xEE, 0x1B, 0xEF, 0xC8, 0xC7, 0x88, 0x86, 0x05, 0x0C,
+  0xB5, 0x94, 0x60, 0x0B, 0xA6, 0x73, 0xE2, 0xAF, 0xBD, 0x61, 0xD0, 0x1E, 0x04, 0x63, 0xFC, 0xEB,
+  0xDF, 0x6A, 0x0A, 0x69, 0x8E, 0x4F, 0x30, 0x9A, 0x7D, 0x44, 0x60, 0xA9, 0x64, 0x77, 0x10, 0x0B,
+  0x09, 0x93, 0xFE, 0x6C, 0xC2, 0xFD, 0xC9, 0xB0, 0x18, 0x87, 0x77, 0xA1, 0x17, 0x0B, 0xAF, 0x38,
+  0x28, 0x18, 0xE2, 0xF2, 0x34, 0x07, 0x11, 0x01, 0x65, 0x43, 0xDB, 0x04, 0x29, 0x80, 0x3D, 0xEE,
+  0x03, 0xB9, 0x73, 0x40, 0x57, 0x00, 0x17, 0x5C, 0x2F, 0x42, 0x59, 0x22, 0xA7, 0x17, 0xE7, 0xC7,
+  0x67, 0xB8, 0x2F, 0x26, 0xB0, 0x69, 0x25, 0xA3, 0x00, 0x96, 0x59, 0x6C, 0x4E, 0xEF, 0x61, 0xD9,
+  0x46, 0x4F, 0x83, 0xBC, 0xB8, 0xD1, 0x96, 0x18, 0x15, 0xC3, 0x13, 0xFE, 0xE2, 0x1B, 0x65, 0xDC,
+  0x44, 0x70, 0x0E, 0x15, 0xF1, 0x45, 0xE9, 0xBD, 0xE8, 0x46, 0x45, 0x00, 0x42, 0x72, 0x7A, 0xDD,
+  0x4E, 0xB7, 0x6A, 0x43, 0x4D, 0x0C, 0x6A, 0x57, 0x23, 0x37, 0xBC, 0xEC, 0x4F, 0x9C, 0xF0, 0xEB,
+  0x9B, 0xA9, 0xDF, 0xAD, 0xCD, 0x0E, 0xE4, 0xEC, 0xD3, 0x8C, 0x24, 0xCB, 0x11, 0xC7, 0x1B, 0x31,
+  0xFF, 0x86, 0xFF, 0xCC, 0xD1, 0x6D, 0x84, 0x01, 0x88, 0x01, 0x8A, 0xD1, 0x70, 0x68, 0xCC, 0xAF,
+  0x8B, 0xD0, 0xF1, 0xA3, 0xB1, 0x17, 0xBF, 0x7D, 0xBB, 0x57, 0xB3, 0x9F, 0x86, 0x41, 0x43, 0xC3,
+  0x2D, 0x82, 0xB6, 0xD4, 0xC7, 0xFD, 0x5F, 0xE5, 0x21, 0xB7, 0xE1, 0x10, 0x9A, 0x5E, 0xDD, 0x0B,
+  0x93, 0xB7, 0xD8, 0xF7, 0x51, 0xE7, 0xA1, 0xD3, 0x9E, 0xFB, 0x7F, 0x77, 0x30, 0x90, 0xE2, 0x0B,
+  0x8F, 0xA9, 0x18, 0xB3, 0xDD, 0x00, 0x62, 0xF0, 0xDC, 0x88, 0xC0, 0x76, 0x3C, 0x64, 0xA2, 0xC4,
+  0x64, 0x13, 0xAB, 0xE5, 0xEE, 0xF7, 0x15, 0xB4, 0x79, 0x7B, 0xFD, 0x6C, 0x80, 0x93, 0xD2, 0x88,
+  0xFB, 0x3E, 0x8C, 0xB9, 0xAB, 0xD9, 0xEE, 0x4A, 0xD3, 0xA6, 0xE1, 0x2E, 0x62, 0x41, 0x26, 0xCA,
+  0xCA, 0x65, 0xB9, 0xCE, 0xF6, 0x53, 0xD1, 0x8D, 0x53, 0xA9, 0xA4, 0x2D, 0xA7, 0x1F, 0x16, 0x1D,
+  0x9D, 0xA3, 0x36, 0x83, 0x2B, 0x18, 0xF4, 0x5B, 0xB6, 0x68, 0x81, 0x29, 0x10, 0xF8, 0x2E, 0x2A,
+  0x82, 0xAD, 0x0E, 0xFE, 0xDF, 0xB6, 0x7E, 0x6C, 0x75, 0x70, 0x2E, 0x43, 0x99, 0xAA, 0x2E, 0xF6,
+  0x73, 0x2F, 0xD1, 0x15, 0x23, 0x3C, 0x0B, 0x22, 0x0F, 0xFF, 0xBB, 0x37, 0x18, 0x4C, 0x41, 0x3D,
+  0x3E, 0x70, 0x05, 0xBA, 0xD9, 0xEE, 0x5A, 0x10, 0x77, 0xDB, 0x0C, 0xF3, 0x66, 0xBB, 0x00, 0xB3,
+  0x8E, 0x5A, 0x13, 0x76, 0x76, 0x7C, 0x72, 0xC4, 0x22, 0x96, 0x5B, 0x5A, 0x1E, 0x22, 0x93, 0x60,
+  0x7B, 0xAB, 0xCF, 0xD8, 0x4A, 0xC9, 0x51, 0x54, 0xAD, 0xD5, 0x6F, 0xD0, 0x4A, 0xC9, 0x5F, 0x54,
+  0xDE, 0xE8, 0xBD, 0x13, 0xA3, 0xCB, 0x84, 0x35, 0x6B, 0x77, 0x5E, 0x76, 0x7A, 0x2F, 0x37, 0x9E,
+  0xBF, 0xAC, 0xD0, 0x2C, 0xF0, 0x87, 0xA2, 0x1D, 0xCF, 0xC8, 0xF4, 0x62, 0xB3, 0xB3, 0xF9, 0x7C,
+  0xAB, 0x5B, 0xDE, 0x72, 0x6F, 0x14, 0x7B, 0xF1, 0xD4, 0x65, 0xD6, 0xD8, 0xE6, 0x16, 0xE0, 0x7C,
+  0x51, 0x8C, 0x4E, 0x1C, 0x16, 0xBC, 0xA3, 0xDE, 0xF0, 0x06, 0xD1, 0x75, 0xAA, 0xD4, 0x36, 0x8E,
+  0x16, 0xF4, 0x56, 0xDF, 0x8A, 0x4E, 0x77, 0x75, 0x70, 0x39, 0xA2, 0x5A, 0x48, 0x42, 0xB1, 0xB4,
+  0x81, 0x34, 0x35, 0x2D, 0x09, 0x17, 0xCA, 0xCF, 0xF0, 0x72, 0xE6, 0xD7, 0x02, 0xC3, 0xBA, 0xD8,
+  0xD0, 0xCE, 0x3D, 0xBC, 0xB3, 0x0F, 0xF1, 0x6C, 0xC3, 0x9C, 0x6D, 0x9A, 0xD5, 0x08, 0xFA, 0xDC,
+  0x7C, 0xDE, 0x61, 0x3F, 0x2D, 0x92, 0xFC, 0x92, 0xE8, 0x02, 0x59, 0x86, 0x8A, 0x40, 0xFC, 0x5A,
+  0x4D, 0x0D, 0x95, 0x21, 0xFE, 0xFC, 0xBD, 0x10, 0xFF, 0xF6, 0x58, 0x88, 0x2D, 0xB7, 0xA5, 0x2B,
+  0x89, 0x6A, 0x05, 0x15, 0x39, 0xBF, 0x9A, 0x9C, 0x49, 0x55, 0xDA, 0xF9, 0x98, 0x9E, 0x96, 0xC1,
+  0x02, 0xFA, 0x0B, 0x0D, 0xF1, 0xAA, 0x2F, 0x7C, 0x5B, 0x63, 0x91, 0x41, 0x69, 0x88, 0x60, 0xE5,
+  0x41, 0x50, 0x66, 0xC8, 0x6A, 0xB7, 0xDB, 0x59, 0xDF, 0x68, 0x91, 0x17, 0x2F, 0xB4, 0x5D, 0x29,
+  0xFF, 0x8C, 0x03, 0x80, 0x05, 0x15, 0x17, 0x9F, 0x1C, 0x94, 0xE6, 0xDC, 0x5A, 0xC5, 0x2C, 0x79,
+  0x9D, 0x16, 0x11, 0xFF, 0x51, 0x70, 0x6E, 0x8A, 0x41, 0x67, 0xBF, 0x2C, 0x24, 0x6B, 0x79, 0xB3,
+  0x73, 0xB5, 0xD7, 0x01, 0x85, 0xC0, 0xCE, 0x01, 0xDA, 0x1A, 0x6E, 0xF6, 0x01, 0x71, 0xB3, 0x5F,
+  0x66, 0x15, 0x37, 0x25, 0xB6, 0xC7, 0xB2, 0x89, 0x4C, 0xCE, 0xF5, 0x13, 0x9B, 0x31, 0xEB, 0xFB,
+  0x2E, 0xDC, 0x74, 0x71, 0x00, 0x8A, 0x9D, 0x7F, 0xD9, 0x99, 0xD9, 0x93, 0x30, 0x93, 0xB9, 0x92,
+  0xC5, 0x8A, 0x9B, 0x03, 0x89, 0xB5, 0xDA, 0xC6, 0xB2, 0x1A, 0xC2, 0xFC, 0x7E, 0xA2, 0x5D, 0xCE,
+  0x30, 0x76, 0x8C, 0x7E, 0x76, 0x96, 0xD0, 0xCF, 0x62, 0xB4, 0x67, 0x9F, 0x9E, 0x14, 0x71, 0xBA,
+  0x01, 0x7A, 0xB4, 0x71, 0x2D, 0x46, 0xFB, 0xC4, 0xFD, 0x3D, 0x8F, 0x07, 0x78, 0x27, 0x24, 0xFE,
+  0x2E, 0xE3, 0xCB, 0xA6, 0x4F, 0xF7, 0x91, 0xD0, 0x16, 0x4F, 0x1F, 0x81, 0xD5, 0x9C, 0x3E, 0x9D,
+  0xC7, 0x9B, 0x3E, 0xDD, 0xEF, 0x35, 0x7D, 0xBA, 0xDF, 0x67, 0xFA, 0x7C, 0x1F, 0xB4, 0x4F, 0xDC,
+  0x5F, 0x65, 0xFA, 0x2C, 0x0B, 0xAD, 0x9A, 0xD7, 0xE2, 0xA9, 0x9D, 0x5D, 0x59, 0x87, 0x57, 0xB1,
+  0xF3, 0xC6, 0xBE, 0x18, 0x5A, 0xDC, 0x5E, 0x33, 0x80, 0x49, 0x56, 0x37, 0xC5, 0xF9, 0x35, 0x43,
+  0xF3, 0x64, 0xA9, 0xB2, 0x3B, 0xA2, 0x66, 0x84, 0x24, 0xB4, 0x71, 0x6D, 0xA6, 0xE6, 0xC6, 0x1A,
+  0xC2, 0x7D, 0x71, 0xEE, 0x9D, 0x1F, 0xDF, 0xF9, 0xBD, 0x39, 0x01, 0x49, 0x3A, 0x3E, 0x9D, 0x6F,
+  0xDE, 0x9D, 0x07, 0x1B, 0xEF, 0xE6, 0xE8, 0x4E, 0xA2, 0x6C, 0x6B, 0xF3, 0x0E, 0x4A, 0xD7, 0xD8,
+  0x8C, 0xCD, 0x32, 0x22, 0xF3, 0x22, 0x56, 0x74, 0xD8, 0xDC, 0x83, 0xB0, 0x48, 0xE3, 0x1C, 0xDC,
+  0xDF, 0x74, 0x47, 0x9A, 0x1A, 0x54, 0x59, 0xE2, 0x50, 0x5B, 0x56, 0x92, 0x2F, 0xDD, 0xB6, 0xCD,
+  0x8F, 0xEA, 0x2C, 0xB1, 0x73, 0x65, 0x84, 0x3A, 0x8B, 0x00, 0x57, 0x80, 0x1C, 0xB2, 0x0C, 0x26,
+  0xE2, 0xC8, 0xEB, 0x22, 0xF8, 0x4A, 0xD1, 0xA9, 0xC7, 0x2A, 0x6F, 0xDB, 0xAE, 0x84, 0x4F, 0x69,
+  0x72, 0xA9, 0xD1, 0x76, 0x37, 0xDC, 0x7A, 0x14, 0x57, 0x8C, 0xAD, 0x45, 0xD6, 0xB7, 0xF8, 0xFF,
+  0x13, 0x6D, 0xBA, 0xBE, 0x95, 0x77, 0x32, 0x77, 0x56, 0xA4, 0x46, 0x4B, 0xDD, 0x3A, 0xA5, 0x94,
+  0xD4, 0x6A, 0xD9, 0xA8, 0x11, 0x16, 0x68, 0xFA, 0xEF, 0xF4, 0xE1, 0x9C, 0xFA, 0xF4, 0xCE, 0x19,
+  0xD5, 0xF2, 0xEF, 0x64, 0x18, 0xB2, 0xC2, 0x0F, 0xAF, 0x2B, 0x48, 0x49, 0xA9, 0xDB, 0x35, 0x2F,
+  0xD4, 0x55, 0x19, 0x72, 0x2D, 0xE0, 0xA7, 0xC0, 0x4A, 0xF2, 0xC6, 0xD3, 0xCF, 0xCE, 0x1D, 0x5F,
+  0xC1, 0xD6, 0xB7, 0x72, 0x0E, 0x24, 0xD9, 0x51, 0xD2, 0x96, 0xB1, 0x25, 0xEB, 0x17, 0xE4, 0x26,
+  0xB3, 0x23, 0x3A, 0xF3, 0xE2, 0xC1, 0x0D, 0xEE, 0xFF, 0x5E, 0xE6, 0x9D, 0x11, 0x42, 0x09, 0xC7,
+  0xF6, 0x72, 0x61, 0x64, 0xE7, 0xD0, 0x92, 0xED, 0x73, 0x5F, 0xE0, 0x2E, 0xF7, 0x85, 0x15, 0x1B,
+  0x7C, 0xE6, 0xE8, 0xD8, 0x2F, 0x55, 0xF0, 0x19, 0x43, 0x8A, 0x67, 0xFB, 0x65, 0x27, 0xCF, 0x78,
+  0xE2, 0x7F, 0x0A, 0x18, 0x83, 0xF0, 0x6B, 0xA7, 0xDF, 0x3F, 0x3E, 0xE4, 0xBC, 0xDE, 0xEC, 0x98,
+  0xD6, 0xC2, 0x66, 0xDE, 0x59, 0x9D, 0x12, 0x40, 0x60, 0x39, 0x7E, 0xB5, 0xA1, 0x39, 0x73, 0xA2,
+  0x08, 0x7E, 0x71, 0x1F, 0x1F, 0x55, 0xF7, 0x69, 0x7A, 0xD4, 0x7D, 0xBA, 0x1E, 0xF5, 0x9E, 0xA6,
+  0x47, 0xBD, 0xA7, 0xEB, 0xD1, 0xFA, 0xD3, 0xF4, 0x68, 0x7D, 0x49, 0x3D, 0x12, 0x53, 0xEB, 0xE2,
+  0xE0, 0x6C, 0xED, 0xE3, 0xE1, 0x99, 0xA9, 0x2E, 0x95, 0x95, 0xEF, 0x36, 0xAE, 0x1A, 0x18, 0x20,
+  0xB4, 0xC2, 0x44, 0xB6, 0x48, 0x8F, 0xE7, 0xB7, 0x36, 0x37, 0xD7, 0x33, 0x11, 0x01, 0xEC, 0xA3,
+  0x4A, 0xA0, 0x16, 0x8A, 0x53, 0x72, 0x40, 0x9F, 0x20, 0x51, 0x62, 0x0E, 0xAA, 0x3B, 0x12, 0x6C,
+  0x98, 0xBE, 0xD9, 0x3B, 0x6F, 0x3A, 0xB4, 0xCA, 0x3B, 0xCF, 0x5B, 0x2C, 0xA3, 0xF3, 0x39, 0x24,
+  0x7D, 0x74, 0x27, 0xB3, 0x53, 0x95, 0x34, 0x5A, 0x1E, 0x61, 0x3C, 0x2A, 0x46, 0x24, 0xFC, 0x38,
+  0x99, 0xC6, 0xF4, 0x3E, 0x2B, 0x34, 0x18, 0x9D, 0x64, 0xB0, 0x12, 0x3E, 0x01, 0x4C, 0xC2, 0x2B,
+  0xB0, 0x68, 0x15, 0x5E, 0x40, 0x06, 0x8E, 0xCF, 0x76, 0x51, 0x40, 0x0A, 0x6F, 0xE3, 0x12, 0x27,
+  0x66, 0xDB, 0xA9, 0x08, 0xCF, 0x65, 0x63, 0x8F, 0x05, 0x15, 0xE5, 0x12, 0x26, 0xD7, 0x7F, 0x16,
+  0x4A, 0x95, 0x2F, 0xD0, 0xE9, 0x4D, 0x93, 0x6A, 0xBC, 0x1B, 0x3B, 0xF7, 0xD0, 0x04, 0xC3, 0xAB,
+  0x2F, 0xC7, 0x9E, 0x0F, 0xBD, 0x8C, 0x38, 0xF7, 0xBA, 0x9D, 0xCD, 0x6E, 0xAF, 0x93, 0x89, 0x05,
+  0xE9, 0xB6, 0xE0, 0x7B, 0xAB, 0xA7, 0xFB, 0x74, 0xB5, 0x70, 0xAF, 0xE2, 0x28, 0x17, 0x8E, 0xEE,
+  0x3D, 0x33, 0xF6, 0x96, 0x8B, 0xD0, 0x1A, 0xE5, 0xAB, 0x5B, 0x6A, 0xD6, 0xBE, 0x6E, 0x75, 0xC8,
+  0x9F, 0x49, 0x4F, 0x3D, 0xDC, 0xB4, 0x35, 0xCA, 0x50, 0xAC, 0x37, 0xFB, 0x66, 0x0B, 0x3B, 0xD2,
+  0xEE, 0xFD, 0x54, 0x1B, 0x8D, 0xB4, 0xC9, 0xB1, 0x1F, 0xE3, 0xC1, 0xDF, 0x48, 0xC8, 0x72, 0x96,
+  0x31, 0x5B, 0x4B, 0x61, 0x89, 0x1D, 0x61, 0xC7, 0x3C, 0xEA, 0x97, 0x41, 0x79, 0x45, 0x06, 0x67,
+  0x71, 0xDA, 0xDA, 0x84, 0x35, 0x02, 0xD2, 0xE1, 0xBB, 0x83, 0xB3, 0x19, 0x8D, 0xCD, 0xE3, 0xB3,
+  0x3D, 0x1E, 0xEA, 0x93, 0x42, 0x39, 0x3E, 0x53, 0x43, 0x82, 0x7C, 0xDF, 0x6F, 0x2B, 0xFF, 0x57,
+  0xD9, 0x73, 0x54, 0x98, 0xBB, 0xB6, 0x04, 0xCB, 0xE1, 0x69, 0xFF, 0x29, 0xD0, 0xBC, 0xE5, 0x2F,
+  0x33, 0x3D, 0x05, 0xAA, 0xFE, 0xF4, 0x0A, 0xFE, 0x5D, 0x18, 0xD3, 0xB7, 0x22, 0x59, 0x96, 0xB8,
+  0x4E, 0xE3, 0x89, 0x50, 0xCA, 0x9D, 0xAC, 0x52, 0xEE, 0x58, 0x95, 0xB2, 0x1D, 0x63, 0x22, 0x8D,
+  0xA7, 0x17, 0x67, 0xF3, 0x0B, 0xA2, 0xD5, 0xC9, 0x0B, 0x14, 0x8E, 0x46, 0xB0, 0x63, 0x0A, 0x7C,
+  0xAE, 0xD5, 0xD7, 0x61, 0x12, 0x3C, 0x57, 0xF7, 0x8E, 0x4C, 0x15, 0x3D, 0x57, 0x69, 0x4C, 0xE3,
+  0x4C, 0xCB, 0xE2, 0xFA, 0x26, 0x40, 0xDB, 0xC0, 0x63, 0x39, 0x26, 0x60, 0x2B, 0x81, 0xF1, 0x75,
+  0xDA, 0x79, 0xD5, 0x3A, 0xE3, 0x41, 0x67, 0x4E, 0xD8, 0xE7, 0x41, 0x00, 0xBB, 0xCE, 0x11, 0x13,
+  0x1B, 0xDC, 0xA3, 0x74, 0x32, 0x67, 0xB0, 0x7C, 0x6F, 0xD2, 0x69, 0xE1, 0x57, 0xE3, 0x30, 0x6E,
+  0x56, 0x3C, 0x5E, 0x34, 0x11, 0xC9, 0x32, 0x1E, 0x03, 0x59, 0xEA, 0x21, 0x9D, 0x24, 0x43, 0x78,
+  0xEC, 0x0A, 0xEB, 0x27, 0x63, 0xFC, 0x30, 0xDB, 0x27, 0x2A, 0x44, 0xA0, 0x38, 0x58, 0xC2, 0xB8,
+  0x42, 0xA4, 0x92, 0xF5, 0x55, 0x0A, 0x5D, 0xA7, 0x9B, 0x77, 0x69, 0xAB, 0x07, 0x2A, 0x51, 0xB5,
+  0x25, 0xAE, 0x41, 0xFB, 0x7C, 0x03, 0xC9, 0xFE, 0xBE, 0x9C, 0x46, 0x89, 0xA2, 0x37, 0x59, 0x2A,
+  0xB4, 0xBD, 0x8D, 0xA5, 0x6A, 0x3C, 0x79, 0xF9, 0x7E, 0x56, 0xA3, 0x40, 0x2C, 0x68, 0x4B, 0xC5,
+  0x3B, 0x83, 0xD3, 0xA4, 0x0A, 0x37, 0x18, 0x41, 0x85, 0xD1, 0x31, 0xF9, 0x3D, 0xEA, 0xD8, 0x1A,
+  0x0F, 0x4D, 0x26, 0xC0, 0xAC, 0x77, 0x42, 0x2F, 0x7E, 0xA8, 0xA5, 0xB9, 0x16, 0x3A, 0xD9, 0x6D,
+  0xBA, 0x7C, 0x15, 0xC8, 0x9E, 0x1F, 0xD5, 0xB8, 0xFB, 0x82, 0xD7, 0x77, 0x45, 0x15, 0xE5, 0x76,
+  0xA9, 0x7E, 0x51, 0x43, 0x09, 0x52, 0x56, 0xE3, 0xD1, 0x77, 0x88, 0x96, 0xB6, 0x3B, 0xBD, 0xCD,
+  0x56, 0x8F, 0x9C, 0x5B, 0xBA, 0x1F, 0xFB, 0x75, 0x18, 0x82, 0x33, 0x60, 0x00, 0xF0, 0x96, 0xF1,
+  0x81, 0xDD, 0xEA, 0x51, 0x20, 0xE0, 0x43, 0x2D, 0xEC, 0xCF, 0x9A, 0x69, 0xCD, 0xC8, 0x3B, 0x61,
+  0x09, 0x24, 0xA5, 0xC2, 0xA3, 0xE6, 0x73, 0x55, 0x4C, 0x10, 0xA3, 0xBB, 0xBB, 0x4B, 0xEB, 0x6D,
+  0xF4, 0x43, 0x76, 0xF7, 0x1F, 0xDA, 0x4D, 0xF0, 0x2A, 0xE9, 0x31, 0xF0, 0xE1, 0x47, 0x50, 0x80,
+  0x6D, 0x22, 0x7A, 0x7D, 0xE7, 0x78, 0x71, 0xBB, 0xDD, 0xAE, 0x2B, 0xB1, 0x19, 0x39, 0x32, 0x68,
+  0x8F, 0x37, 0x95, 0xC1, 0xA6, 0xD9, 0x8E, 0xBE, 0x92, 0xC4, 0x27, 0x4E, 0xD9, 0x67, 0x6A, 0x5E,
+  0x40, 0x7E, 0x35, 0xDA, 0x34, 0x88, 0xF5, 0xC1, 0x51, 0x8A, 0xD5, 0x1B, 0x8D, 0xEA, 0xE0, 0xF5,
+  0x9D, 0x5B, 0xEC, 0x4E, 0xBB, 0xAD, 0x85, 0x97, 0x18, 0xF7, 0x3F, 0x6B, 0x69, 0x1E, 0x90, 0x56,
+  0x11, 0xE3, 0x5B, 0x1A, 0x10, 0x64, 0x69, 0xCE, 0xC5, 0x0A, 0xF3, 0x12, 0x95, 0x7A, 0x9B, 0x6B,
+  0x91, 0x4B, 0x4C, 0x8B, 0x5F, 0x64, 0x5A, 0xE4, 0x32, 0xD3, 0xA2, 0x17, 0x9A, 0x16, 0xBF, 0xD4,
+  0xB4, 0xD8, 0xC5, 0xA6, 0x45, 0x2E, 0x37, 0x2D, 0x7A, 0xC1, 0x69, 0xB1, 0x4B, 0x4E, 0x8B, 0x5E,
+  0x74, 0x5A, 0xC6, 0x65, 0xA7, 0xF9, 0x2E, 0x3C, 0x25, 0xAB, 0x57, 0x7A, 0x6B, 0x14, 0x26, 0x27,
+  0xAF, 0xFB, 0x4F, 0xB0, 0x36, 0xFD, 0x58, 0x4B, 0x87, 0x55, 0xB3, 0x3F, 0x96, 0xB2, 0xB4, 0x24,
+  0xD2, 0xB0, 0xDE, 0xD1, 0x52, 0xAE, 0x62, 0xA3, 0x46, 0x9C, 0x5E, 0xDD, 0xEB, 0x35, 0xDE, 0x9E,
+  0xF5, 0x2D, 0x7B, 0xEC, 0x84, 0x96, 0x9F, 0x7F, 0x26, 0xF6, 0x66, 0x20, 0x13, 0x23, 0x96, 0x98,
+  0x67, 0xE6, 0xA6, 0xFB, 0xD4, 0x3B, 0x0C, 0xA6, 0x73, 0x21, 0x7D, 0xFF, 0xE1, 0x74, 0xAF, 0x9F,
+  0x4B, 0x6F, 0xD3, 0x58, 0x50, 0x6D, 0x57, 0x7D, 0xCA, 0x54, 0xBF, 0x22, 0x28, 0x19, 0xF4, 0xAA,
+  0xC8, 0xDC, 0x04, 0x18, 0xE8, 0x00, 0x7B, 0x41, 0x96, 0xD7, 0x20, 0xA9, 0xA3, 0xCA, 0x4A, 0x2A,
+  0x4C, 0x2B, 0x2B, 0xA6, 0x80, 0xD8, 0x44, 0x21, 0xDB, 0xDF, 0xCC, 0xCD, 0x65, 0xEC, 0xF5, 0xBE,
+  0x17, 0x9F, 0x38, 0x93, 0xF4, 0x66, 0xF4, 0xD8, 0xF3, 0xE1, 0x1F, 0xE7, 0xBE, 0x45, 0xAE, 0x58,
+  0x89, 0x92, 0xD5, 0xA0, 0x95, 0x68, 0x84, 0xE3, 0x43, 0x65, 0x32, 0xCB, 0xE3, 0xD8, 0x24, 0x7F,
+  0x18, 0xA7, 0x6E, 0xEC, 0x44, 0x5F, 0x79, 0x01, 0x07, 0xA4, 0x15, 0xA2, 0xFC, 0xF0, 0x63, 0x58,
+  0xF2, 0x1A, 0x51, 0x36, 0xF1, 0x50, 0x59, 0x7C, 0xD8, 0x45, 0xF4, 0xFC, 0x43, 0x83, 0x01, 0xF9,
+  0x99, 0x34, 0xBA, 0xE4, 0xF5, 0x6B, 0x8E, 0xAB, 0xD9, 0xC4, 0x51, 0xEA, 0x34, 0x8D, 0xD1, 0x29,
+  0xC8, 0x86, 0x60, 0x4F, 0xB1, 0xA0, 0xB4, 0x55, 0x7A, 0x55, 0x36, 0x9E, 0x45, 0x83, 0x90, 0xF1,
+  0x78, 0xC9, 0x9C, 0x0D, 0x8A, 0x5E, 0x94, 0x57, 0x7B, 0xA0, 0xFF, 0x96, 0x18, 0xDC, 0x08, 0xDF,
+  0x8D, 0x64, 0x2F, 0x89, 0x4E, 0x40, 0x25, 0xE3, 0xE6, 0xCF, 0x18, 0xAC, 0x24, 0x96, 0x57, 0x49,
+  0x22, 0xC3, 0x9E, 0xCB, 0xD4, 0xA3, 0xE6, 0xB7, 0xD3, 0xAC, 0x31, 0x49, 0xD7, 0xB0, 0x92, 0x65,
+  0xE5, 0x4F, 0xF3, 0xA3, 0xB9, 0x34, 0xE6, 0x6F, 0x3B, 0xC3, 0x0E, 0x55, 0xC0, 0x49, 0xF7, 0x28,
+  0x49, 0x72, 0x9A, 0x5B, 0x99, 0x73, 0x0E, 0x43, 0xFB, 0x79, 0xBE, 0x42, 0xCF, 0x05, 0xEB, 0xC9,
+  0xBB, 0x7E, 0x48, 0xB2, 0x22, 0x36, 0x54, 0x61, 0x68, 0x26, 0xE3, 0xAD, 0x37, 0xAB, 0xFA, 0x7C,
+  0xA9, 0xF1, 0x6A, 0xAA, 0x79, 0xCF, 0x28, 0x19, 0x51, 0x24, 0x52, 0x79, 0x3C, 0xF5, 0x9A, 0xF5,
+  0x82, 0x4C, 0xFD, 0xAF, 0x3E, 0xA6, 0xBD, 0xD9, 0xFE, 0xD1, 0x64, 0x05, 0x19, 0x62, 0x7B, 0xF4,
+  0xF5, 0x35, 0x3B, 0xDD, 0x45, 0xE1, 0xB7, 0x95, 0xEE, 0xE2, 0x89, 0x6F, 0x21, 0x0B, 0xD2, 0x78,
+  0xE8, 0x17, 0xF2, 0x84, 0xF8, 0x87, 0xEB, 0x7C, 0xEE, 0x34, 0xE1, 0xA2, 0xA2, 0xC8, 0xB3, 0xBC,
+  0xCA, 0xB1, 0x6D, 0x91, 0x3D, 0x9E, 0xD8, 0x72, 0x76, 0xE1, 0x63, 0xED, 0xFE, 0x90, 0xBE, 0x3F,
+  0xA4, 0xCF, 0x2E, 0x7D, 0x19, 0x59, 0xF9, 0x69, 0x47, 0x53, 0x78, 0x85, 0xFD, 0xE7, 0xBA, 0x33,
+  0x22, 0x63, 0xE4, 0x03, 0xBB, 0x62, 0xF9, 0x83, 0x74, 0xBF, 0x50, 0xC9, 0xAB, 0x74, 0x4C, 0x42,
+  0xD8, 0x8C, 0xE1, 0xCA, 0x93, 0x4E, 0xA8, 0xF9, 0x66, 0x4A, 0x2E, 0xDB, 0xE7, 0x25, 0x43, 0x1B,
+  0x04, 0x91, 0x7D, 0x0D, 0x17, 0x32, 0x97, 0xE0, 0xAB, 0x76, 0x37, 0xD4, 0x96, 0x9F, 0xB7, 0x25,
+  0x67, 0x22, 0x96, 0x83, 0x15, 0xB4, 0x36, 0xC2, 0x11, 0x8D, 0x71, 0xB4, 0xF8, 0x65, 0xDA, 0x64,
+  0x79, 0x35, 0x32, 0xCB, 0xA5, 0x59, 0x5B, 0xF4, 0x95, 0x35, 0x5D, 0x11, 0xC5, 0x04, 0x61, 0xA8,
+  0x1A, 0xB2, 0x4E, 0xCB, 0x46, 0x44, 0x9A, 0x73, 0xC5, 0xD0, 0x6A, 0x85, 0xC0, 0xA0, 0x52, 0x11,
+  0xB4, 0xEC, 0xD5, 0x1E, 0x9E, 0x58, 0x34, 0x12, 0xC1, 0xB6, 0x9C, 0xBF, 0xA2, 0xFB, 0x59, 0xAB,
+  0x2F, 0x93, 0x10, 0x27, 0x35, 0xFB, 0xE6, 0x34, 0xF7, 0x92, 0xB8, 0x3A, 0x6E, 0xD0, 0xA1, 0x0E,
+  0x51, 0xCC, 0xB9, 0xF4, 0x4F, 0x3C, 0x2E, 0xA9, 0x7D, 0x1F, 0xE3, 0x8D, 0x6B, 0xBD, 0xD4, 0x20,
+  0xDA, 0xC9, 0xCD, 0xF0, 0x33, 0xB7, 0xBD, 0x3F, 0x97, 0xE2, 0xC9, 0x1B, 0x1D, 0x71, 0x3A, 0xB1,
+  0xDC, 0xE1, 0x91, 0x61, 0x8F, 0xFA, 0x28, 0xA5, 0xC1, 0x90, 0xCC, 0xF6, 0xFE, 0xC7, 0x3F, 0x8B,
+  0xCE, 0xCE, 0x63, 0x5D, 0x7A, 0x00, 0xA9, 0xE5, 0x65, 0x9B, 0x8D, 0x67, 0xCA, 0x13, 0xF7, 0x9C,
+  0x49, 0xE2, 0x89, 0x82, 0xB6, 0x24, 0x9B, 0xED, 0x62, 0xD4, 0x57, 0xED, 0x7F, 0xC2, 0xB7, 0x1A,
+  0x9E, 0x29, 0x8F, 0xDC, 0xF1, 0xE2, 0xDF, 0x3B, 0x5F, 0xA4, 0xDC, 0xE3, 0x37, 0x2F, 0x3A, 0x75,
+  0x4E, 0x1B, 0xE2, 0x45, 0x11, 0x51, 0xDE, 0x6C, 0xF2, 0x32, 0x59, 0xFD, 0x35, 0x6C, 0x71, 0xB4,
+  0x0F, 0xBB, 0x98, 0x94, 0xAA, 0x69, 0x03, 0xDE, 0x2D, 0x01, 0xDE, 0xD5, 0x81, 0x77, 0x4D, 0xE0,
+  0xDD, 0x22, 0xE0, 0xBD, 0x12, 0xE0, 0x3D, 0x1D, 0x78, 0xCF, 0x04, 0xDE, 0x2B, 0x02, 0xBE, 0x5E,
+  0x02, 0x7C, 0x5D, 0x07, 0xBE, 0x6E, 0x02, 0x5F, 0x4F, 0x80, 0xFF, 0x0B, 0x88, 0xAC, 0x92, 0xB8,
+  0xE4, 0x26, 0x88, 0x40, 0x54, 0xA7, 0xF0, 0x2B, 0xFC, 0x1B, 0x8E, 0x5A, 0xC4, 0xA7, 0xD4, 0x8D,
+  0x4A, 0xE4, 0x58, 0xB8, 0x64, 0xB0, 0xAD, 0x90, 0xE2, 0x76, 0x1C, 0xBC, 0xC7, 0x77, 0x53, 0x01,
+  0x32, 0x6D, 0x34, 0xD3, 0xA4, 0xF1, 0x00, 0xB2, 0xA9, 0x9B, 0x31, 0xC9, 0x0C, 0x40, 0x9C, 0x99,
+  0xB0, 0xE9, 0x74, 0xB3, 0x9E, 0x2A, 0x8F, 0xAE, 0xB2, 0x63, 0x4F, 0x95, 0xC7, 0xC6, 0x4B, 0xF5,
+  0x73, 0x82, 0x90, 0x91, 0xDF, 0x4C, 0x23, 0x2E, 0x2C, 0xB9, 0xFC, 0x11, 0xF1, 0x9C, 0x63, 0x36,
+  0xFB, 0xB8, 0xE5, 0xDB, 0x48, 0xFA, 0x79, 0xA2, 0xE5, 0x1C, 0x90, 0x8D, 0x23, 0xE3, 0x52, 0x95,
+  0x01, 0x17, 0x15, 0xB3, 0x5E, 0x35, 0x2D, 0xC6, 0xCB, 0x73, 0xBB, 0x2D, 0xD8, 0xC8, 0xF4, 0x2A,
+  0x0C, 0x30, 0xDF, 0xDD, 0x74, 0x95, 0x53, 0xE0, 0x9F, 0x7F, 0x26, 0xFC, 0x63, 0x2F, 0xFD, 0x98,
+  0x99, 0x0D, 0xDD, 0xF9, 0xA7, 0x03, 0x00, 0xFE, 0x61, 0x3D, 0x2B, 0x5D, 0xBB, 0x13, 0x14, 0x79,
+  0x61, 0xF3, 0x45, 0x6B, 0x27, 0xB9, 0xB8, 0x2E, 0xF0, 0x3D, 0xA2, 0x9E, 0x7C, 0x50, 0xC9, 0x80,
+  0x2F, 0xE7, 0x40, 0xD1, 0x0C, 0x66, 0x59, 0xE5, 0x2F, 0x82, 0x37, 0x0E, 0x1E, 0x7F, 0x3D, 0x1C,
+  0x8A, 0x4B, 0x4E, 0xBA, 0x01, 0xA9, 0x97, 0x65, 0x73, 0xCF, 0xD7, 0x64, 0x11, 0xD9, 0x9B, 0xC0,
+  0x0A, 0x43, 0x5D, 0xED, 0x3C, 0x8E, 0x65, 0x61, 0xE1, 0xEF, 0xB3, 0x72, 0x6C, 0xE8, 0xB1, 0xB5,
+  0x26, 0x36, 0x35, 0x30, 0xB1, 0xF7, 0x42, 0x5B, 0xDD, 0x96, 0xE9, 0xF6, 0xFB, 0x3B, 0x0D, 0x83,
+  0x94, 0x0B, 0x39, 0xDD, 0xEF, 0x64, 0xDB, 0xC8, 0x0C, 0x2E, 0xAC, 0x73, 0xFF, 0x6A, 0x69, 0x68,
+  0x54, 0xA6, 0xD8, 0x12, 0xD0, 0x7C, 0xCB, 0x0C, 0xF9, 0xE9, 0x98, 0x3A, 0x99, 0xF1, 0xD6, 0xF9,
+  0x94, 0x1A, 0xFE, 0xD8, 0x97, 0xD3, 0x93, 0xA3, 0xBD, 0x4B, 0x9E, 0xFF, 0x47, 0x72, 0xB9, 0x6B,
+  0xAB, 0xD1, 0x2F, 0xAF, 0x71, 0x51, 0x5A, 0xE3, 0x17, 0xA5, 0xC6, 0x86, 0xA5, 0xC6, 0xF9, 0xC9,
+  0x81, 0x0E, 0x23, 0xDB, 0x41, 0x11, 0xA5, 0xF7, 0x2F, 0xD4, 0x47, 0xB5, 0xC6, 0xF9, 0xAF, 0x27,
+  0x97, 0xE7, 0x7B, 0x9F, 0x7E, 0x2D, 0xAE, 0xD1, 0x7F, 0x73, 0xBE, 0xFF, 0xAB, 0xC9, 0xA8, 0x0C,
+  0xA7, 0xF0, 0x71, 0x2A, 0xEB, 0xD4, 0x57, 0x5E, 0xAE, 0xEA, 0x6C, 0xE2, 0x66, 0xB5, 0x00, 0x9B,
+  0xFA, 0xC0, 0x55, 0x79, 0xB5, 0xE7, 0x46, 0xB5, 0x8E, 0xB5, 0xDA, 0x8B, 0x6A, 0xD0, 0x5E, 0x58,
+  0xA0, 0xD9, 0xEA, 0xBD, 0xAC, 0x06, 0xEE, 0x65, 0x25, 0xE2, 0xBA, 0xBD, 0x4A, 0xD0, 0xBA, 0xBD,
+  0x4A, 0xD0, 0x7A, 0xEB, 0x1D, 0x13, 0x9A, 0xB5, 0x13, 0xEC, 0x65, 0xB3, 0x4E, 0x05, 0x88, 0xFC,
+  0x09, 0xB4, 0x6C, 0x45, 0xCB, 0xF0, 0x83, 0x91, 0x85, 0x97, 0xDE, 0xEE, 0x3C, 0x37, 0xBE, 0xC1,
+  0xB6, 0xD5, 0x45, 0xA0, 0x53, 0x4D, 0x06, 0x7A, 0x4B, 0x95, 0x81, 0xDE, 0x72, 0x65, 0xA0, 0xB7,
+  0x54, 0x19, 0xE8, 0xFD, 0xB3, 0xC9, 0x00, 0x98, 0x78, 0x98, 0xE1, 0x28, 0x75, 0x92, 0x45, 0x59,
+  0xEF, 0x11, 0x4F, 0x11, 0x93, 0x82, 0x60, 0x0F, 0xFE, 0x6E, 0x67, 0xEB, 0x7C, 0x36, 0xEA, 0x7C,
+  0xB6, 0xD4, 0xF9, 0xCD, 0xA8, 0xF3, 0x9B, 0xA6, 0xBA, 0x81, 0x1A, 0x99, 0x36, 0xBD, 0x90, 0xA2,
+  0xAC, 0x3F, 0x4B, 0x79, 0xF2, 0xB9, 0xDC, 0x5F, 0xA5, 0xBC, 0xD1, 0x6C, 0x54, 0x7E, 0xB7, 0x77,
+  0x74, 0xB9, 0x77, 0x76, 0x60, 0xA9, 0xBB, 0x37, 0x8A, 0xC5, 0x60, 0xE8, 0xF1, 0x50, 0x63, 0x27,
+  0xFC, 0xAA, 0x05, 0x43, 0x75, 0x4B, 0x22, 0x9E, 0x4A, 0x9A, 0xF7, 0x6C, 0xCD, 0xF9, 0xBE, 0x43,
+  0xE0, 0x77, 0xDC, 0xBF, 0x4D, 0xA3, 0x18, 0x28, 0x6D, 0x98, 0xD9, 0xDC, 0xD1, 0xFE, 0x38, 0xA5,
+  0x77, 0xB0, 0xF2, 0x25, 0x2C, 0xCB, 0x04, 0x0F, 0xA5, 0x75, 0x2C, 0xB6, 0x15, 0xBD, 0xF7, 0x62,
+  0x23, 0xDC, 0x81, 0xBD, 0x47, 0x51, 0x1B, 0x3B, 0x9E, 0x7F, 0xC6, 0x22, 0xB0, 0xB6, 0x93, 0x8C,
+  0xD9, 0xE2, 0x4D, 0xA2, 0x63, 0xFF, 0x2C, 0x0C, 0xF0, 0x74, 0x3E, 0x89, 0x37, 0x32, 0x71, 0x22,
+  0xD4, 0x3D, 0xDF, 0x55, 0x0D, 0xBA, 0xE4, 0xE5, 0x77, 0x6B, 0xCE, 0xFA, 0x94, 0x0C, 0x6B, 0xD6,
+  0x7A, 0xE3, 0xC9, 0x78, 0x99, 0x29, 0x1B, 0xCD, 0x5C, 0x09, 0x41, 0x85, 0x2D, 0xD0, 0xD9, 0x3B,
+  0xC2, 0xBF, 0x66, 0x3B, 0x62, 0x74, 0x32, 0x7D, 0x33, 0x5D, 0x3E, 0x9C, 0x01, 0x46, 0x1F, 0x3E,
+  0xA6, 0x74, 0x43, 0xB9, 0xF7, 0xF6, 0xA8, 0x7F, 0xB6, 0xDE, 0x23, 0x37, 0xEC, 0x6D, 0x25, 0xF6,
+  0xE6, 0x3C, 0x14, 0x86, 0xFC, 0xC9, 0x79, 0x7C, 0x59, 0x83, 0xF9, 0x61, 0x30, 0xAD, 0x40, 0xCA,
+  0x1C, 0x72, 0x1D, 0x06, 0x63, 0xB2, 0x77, 0xC6, 0x1B, 0x0C, 0xC9, 0x04, 0xA8, 0x52, 0xD3, 0x72,
+  0x67, 0x5F, 0xAE, 0x4F, 0x72, 0x62, 0x1E, 0x02, 0x25, 0xE1, 0xD8, 0xF3, 0xC1, 0xC2, 0xBE, 0xF1,
+  0xC0, 0x00, 0x55, 0x9F, 0xE9, 0xE0, 0xCE, 0xE2, 0x20, 0xF4, 0xC0, 0xF8, 0x71, 0x46, 0xFC, 0x19,
+  0x0F, 0xB9, 0xFD, 0x32, 0x1F, 0x0A, 0xF8, 0x69, 0x87, 0xF8, 0xD3, 0xD1, 0xA8, 0x69, 0x6E, 0x50,
+  0xCC, 0xB7, 0x03, 0x74, 0x46, 0x16, 0x05, 0x65, 0xE0, 0xDB, 0x5E, 0x7D, 0xF8, 0xD3, 0xFD, 0xA9,
+  0xF8, 0x4A, 0x85, 0xFA, 0xFA, 0xC1, 0x47, 0x7E, 0xCC, 0x44, 0xE0, 0xFF, 0xC0, 0x1F, 0x60, 0x56,
+  0xB6, 0xEF, 0xF6, 0xE0, 0x1C, 0xFD, 0x19, 0xF9, 0x4F, 0xB0, 0xD9, 0xD0, 0x4E, 0x96, 0x59, 0x7E,
+  0x62, 0x7E, 0xD3, 0x3A, 0x9A, 0x5E, 0x8D, 0xBD, 0x58, 0xBE, 0xEA, 0x87, 0x8F, 0xED, 0xC1, 0x24,
+  0x63, 0xEF, 0x70, 0xFC, 0xDE, 0xF9, 0x92, 0x7A, 0xCB, 0xD0, 0xDD, 0x2C, 0x3C, 0x66, 0xF8, 0xCE,
+  0x0C, 0xBA, 0xF7, 0xD5, 0x60, 0x15, 0x59, 0xDC, 0x76, 0x26, 0x13, 0x3E, 0x99, 0xB2, 0x60, 0x5B,
+  0x0C, 0x6D, 0x33, 0x85, 0xE9, 0xFC, 0xCD, 0xB9, 0x17, 0xF0, 0x7E, 0x3D, 0x79, 0xFF, 0x2E, 0xC6,
+  0x50, 0x6D, 0xD8, 0x5D, 0xA4, 0x0F, 0xCF, 0x60, 0x85, 0x76, 0x00, 0x00, 0x1B, 0xB5, 0xB3, 0x0F,
+  0x60, 0x36, 0x02, 0x17, 0xD7, 0xA6, 0xAC, 0x47, 0x35, 0xB5, 0x06, 0x9B, 0x4A, 0x92, 0x02, 0xF5,
+  0x1D, 0x31, 0x9D, 0x0B, 0x96, 0xED, 0x19, 0x66, 0xC4, 0xE7, 0x85, 0x1E, 0x3A, 0xE5, 0x27, 0x5A,
+  0xAC, 0xA4, 0xF1, 0x86, 0x8C, 0x0E, 0x4C, 0x79, 0xFE, 0x50, 0xD3, 0xC0, 0xC5, 0x08, 0xD9, 0xE3,
+  0x6B, 0xF9, 0x40, 0x33, 0x13, 0x97, 0x4F, 0x33, 0x7B, 0xA5, 0x5A, 0xEE, 0xE4, 0xD5, 0x10, 0x04,
+  0xE1, 0x90, 0xC6, 0x67, 0x8E, 0x17, 0x52, 0x97, 0x29, 0x53, 0x7D, 0xC9, 0xB8, 0x8A, 0xFD, 0x37,
+  0xAC, 0x06, 0x2F, 0xB3, 0xB0, 0x88, 0x3D, 0x49, 0xC7, 0x0A, 0x19, 0xAC, 0x20, 0x8E, 0xA9, 0xDF,
+  0x56, 0x82, 0x0B, 0xF2, 0xDE, 0x59, 0x3F, 0xE5, 0xAF, 0xF0, 0x58, 0x37, 0xB3, 0x0C, 0xE3, 0x51,
+  0x34, 0x39, 0xE5, 0x4F, 0xBC, 0x47, 0x16, 0x75, 0x0B, 0x84, 0x9D, 0x2B, 0xCF, 0xBA, 0x69, 0x44,
+  0x17, 0xBF, 0xF7, 0x56, 0x63, 0xED, 0xD8, 0x66, 0x53, 0xC4, 0xA9, 0xE6, 0x6D, 0xAA, 0x55, 0x38,
+  0x29, 0x09, 0xC9, 0x46, 0xD7, 0x71, 0x5D, 0xF6, 0x90, 0x12, 0x7A, 0x36, 0xA8, 0x8F, 0x59, 0x87,
+  0x0F, 0x3F, 0x9C, 0x80, 0xEE, 0x8D, 0xF1, 0x1B, 0x7F, 0xB4, 0xAE, 0x45, 0x1A, 0x14, 0xAB, 0x34,
+  0xC9, 0xCE, 0xAE, 0xBA, 0x75, 0x16, 0x0C, 0xAB, 0xB0, 0x6B, 0xCE, 0xC6, 0xD3, 0xD6, 0xD5, 0x87,
+  0x7C, 0xD8, 0xC1, 0x38, 0x9A, 0x26, 0xEC, 0x8C, 0x00, 0x7E, 0xE1, 0x90, 0x93, 0x8D, 0xB1, 0x87,
+  0xDE, 0x7E, 0xE7, 0x1E, 0x7E, 0xD1, 0x77, 0xC8, 0xBC, 0xDA, 0xEF, 0xDE, 0x97, 0x76, 0xE0, 0x0F,
+  0x46, 0xDE, 0x00, 0xE3, 0x75, 0x12, 0xDE, 0x36, 0xB2, 0x37, 0x0C, 0xB4, 0x48, 0xF3, 0x9C, 0xCB,
+  0xE5, 0x79, 0xCF, 0xD4, 0x65, 0xF9, 0xC4, 0xE1, 0xE1, 0x84, 0xB7, 0xA2, 0xB4, 0x00, 0xEA, 0xD3,
+  0x81, 0x6A, 0xDC, 0xB5, 0x3B, 0x64, 0x2D, 0x17, 0x9F, 0xE2, 0xBF, 0xF9, 0xA6, 0xCE, 0x76, 0x2B,
+  0xC8, 0x65, 0x10, 0x97, 0x62, 0x2D, 0xA2, 0x4D, 0xE9, 0x82, 0x85, 0x38, 0x4B, 0x5E, 0xDA, 0x99,
+  0x49, 0x9B, 0x3D, 0xC7, 0x2D, 0xD7, 0x1F, 0x91, 0xA8, 0x67, 0xBF, 0xDC, 0xC1, 0xF5, 0x07, 0x33,
+  0xF1, 0x72, 0xB3, 0x0B, 0xD8, 0x7A, 0x22, 0x9F, 0x05, 0x5C, 0xB8, 0x1B, 0x12, 0x50, 0x61, 0x1F,
+  0x72, 0xE8, 0x4B, 0x3B, 0x90, 0xDF, 0x49, 0x4B, 0x1F, 0x8A, 0x13, 0x9A, 0xCE, 0xDD, 0xA3, 0xB9,
+  0xF2, 0xA4, 0xF2, 0xFE, 0xA1, 0xC1, 0x5F, 0xD4, 0xBD, 0x61, 0x62, 0xFB, 0xCF, 0xDF, 0x3D, 0xFE,
+  0x3E, 0xE2, 0xB2, 0x7B, 0xF7, 0x56, 0x0D, 0xEE, 0x34, 0x3B, 0xC7, 0x89, 0xCF, 0xEF, 0x1C, 0xEF,
+  0x7C, 0xB6, 0x73, 0x99, 0xC4, 0x2E, 0x79, 0x69, 0x69, 0x6A, 0x4D, 0xFB, 0x93, 0xA7, 0xB9, 0x4F,
+  0xF9, 0xC9, 0x79, 0xBC, 0xD5, 0x6D, 0x6F, 0x94, 0xA6, 0x09, 0x7D, 0xC4, 0xA4, 0x39, 0x33, 0xD1,
+  0xFA, 0xB2, 0xDD, 0x99, 0x23, 0xA5, 0x69, 0x15, 0xD0, 0x9D, 0x7C, 0xC8, 0x16, 0xC1, 0xB2, 0x65,
+  0xAF, 0x9C, 0x5B, 0x9E, 0x0A, 0x52, 0x61, 0xDA, 0xE7, 0x88, 0x92, 0x16, 0x69, 0xC6, 0xFB, 0x62,
+  0x5C, 0x0C, 0x2B, 0xB4, 0xCF, 0xEB, 0x6D, 0x92, 0xD7, 0x61, 0x19, 0xBD, 0x2D, 0x4A, 0x12, 0x61,
+  0xF4, 0x96, 0x57, 0x9D, 0xBF, 0xB7, 0xC5, 0xED, 0x2D, 0xBD, 0x35, 0x8E, 0x3B, 0x16, 0xEF, 0x71,
+  0x16, 0x60, 0x4E, 0xAF, 0x2D, 0x07, 0x2A, 0xFC, 0x89, 0x4B, 0x9E, 0xDE, 0x20, 0xF3, 0x30, 0x73,
+  0x21, 0x0B, 0x4A, 0x81, 0x59, 0xF3, 0x22, 0xA9, 0xEC, 0xC8, 0x3E, 0x9B, 0x3A, 0x37, 0x23, 0xB2,
+  0xA0, 0x92, 0x80, 0x99, 0x8E, 0x7D, 0xEC, 0x65, 0x8B, 0x7D, 0x67, 0xEA, 0x1E, 0x1A, 0x0F, 0x3C,
+  0x1A, 0xAA, 0x55, 0xBD, 0x82, 0x58, 0x2A, 0x27, 0x15, 0x28, 0xEA, 0xDA, 0x55, 0x78, 0x15, 0x8A,
+  0xC4, 0x4A, 0x36, 0x13, 0x45, 0xF3, 0xE2, 0x9A, 0xA1, 0xF7, 0xFA, 0xB0, 0x3E, 0x80, 0xC5, 0xED,
+  0x0D, 0x4E, 0x60, 0xC1, 0x59, 0x6C, 0x4C, 0x75, 0x38, 0x9C, 0x7D, 0x18, 0x24, 0x22, 0xEF, 0x24,
+  0x70, 0xE9, 0xE7, 0xB7, 0xA9, 0xDE, 0x4C, 0xD9, 0x3D, 0xE7, 0x42, 0xD1, 0x57, 0x01, 0xAA, 0xAD,
+  0x8E, 0xF8, 0x3D, 0x97, 0xEC, 0xBE, 0xF5, 0x93, 0x13, 0xFA, 0xEC, 0x65, 0xC4, 0x43, 0xDE, 0x92,
+  0xB0, 0xA6, 0x2C, 0x2B, 0x08, 0x6C, 0x6B, 0x30, 0x46, 0x73, 0x6F, 0x1A, 0x07, 0xE3, 0x20, 0xF6,
+  0x6E, 0x69, 0x9B, 0x88, 0x54, 0x5F, 0x1C, 0x26, 0xF1, 0x22, 0x72, 0x05, 0xFB, 0x6C, 0x74, 0x2A,
+  0xBA, 0x69, 0x22, 0xC7, 0xB4, 0xBE, 0x0E, 0xB3, 0x5D, 0x9B, 0x61, 0xD6, 0xCD, 0xD4, 0x8F, 0x5A,
+  0x05, 0x8D, 0x64, 0xB0, 0xF0, 0x8F, 0x11, 0xFB, 0xE1, 0x47, 0x2C, 0x3F, 0x03, 0xE0, 0x82, 0x6B,
+  0x49, 0x69, 0x6A, 0x41, 0xBB, 0x36, 0x9D, 0x4C, 0xE4, 0x63, 0xF3, 0x73, 0xA9, 0xA3, 0xF2, 0xE6,
+  0x16, 0x1E, 0x98, 0x77, 0xFB, 0x17, 0xEC, 0x79, 0xC5, 0x54, 0x01, 0xB9, 0x1A, 0xF8, 0x90, 0xC6,
+  0x8E, 0x37, 0x8A, 0x66, 0xEC, 0xF9, 0x2C, 0x80, 0x34, 0x1E, 0xA8, 0x2F, 0x71, 0xCF, 0xDD, 0x73,
+  0x15, 0x48, 0xFE, 0x82, 0x29, 0xBC, 0xD4, 0x58, 0xB7, 0xBC, 0x93, 0x85, 0xA0, 0xBB, 0x76, 0x6E,
+  0x16, 0x83, 0xB6, 0x99, 0x50, 0x8A, 0x43, 0x6D, 0x09, 0xF6, 0x93, 0x0E, 0xAD, 0x40, 0x1F, 0x19,
+  0xBE, 0xBC, 0xC5, 0x8C, 0xA7, 0x42, 0x60, 0xA5, 0xC6, 0x93, 0x99, 0x3E, 0x6A, 0x41, 0x1E, 0x14,
+  0x66, 0x3E, 0x52, 0xE4, 0x5E, 0xAD, 0x3C, 0xA7, 0xC4, 0x57, 0x02, 0x61, 0xE9, 0xAB, 0x96, 0x9F,
+  0x69, 0xC1, 0xEE, 0x96, 0xE5, 0x7A, 0x32, 0x7B, 0x9C, 0xD6, 0x5F, 0xA4, 0xD3, 0x15, 0xA0, 0x64,
+  0x9D, 0x0C, 0xC9, 0x93, 0x11, 0x73, 0x74, 0x5A, 0x3B, 0xAC, 0xCB, 0x80, 0xD7, 0x9F, 0x87, 0x78,
+  0x2C, 0xF0, 0x99, 0x7D, 0xF1, 0x92, 0xD1, 0x18, 0x27, 0xA7, 0xCB, 0xEE, 0x44, 0x4E, 0xD6, 0xD5,
+  0xB9, 0xE5, 0xAF, 0x24, 0x8D, 0xAB, 0x4D, 0xEB, 0x88, 0x74, 0xAD, 0x05, 0xFA, 0x41, 0xA9, 0xC9,
+  0xF3, 0xAD, 0x56, 0xAB, 0xCB, 0xD2, 0xA5, 0x96, 0xAA, 0x9D, 0x02, 0x15, 0x66, 0xA3, 0xCC, 0x50,
+  0x83, 0xC5, 0xA4, 0xE5, 0x57, 0xCE, 0xD2, 0x66, 0xD5, 0xAF, 0x6C, 0xB0, 0xBE, 0x35, 0x95, 0x63,
+  0x0D, 0x1C, 0x99, 0x83, 0xA3, 0x37, 0x09, 0xF3, 0xAD, 0x4F, 0x88, 0xFA, 0xDE, 0xE0, 0x2B, 0x9E,
+  0x0B, 0xB0, 0x97, 0xDF, 0xA5, 0xA3, 0x86, 0xBF, 0xFA, 0xBB, 0xEF, 0xB8, 0x07, 0x98, 0xAA, 0xA8,
+  0x91, 0xAD, 0x63, 0x7B, 0x64, 0x33, 0xC9, 0x82, 0xA4, 0xD4, 0x5E, 0xC2, 0x53, 0x12, 0x4F, 0xFA,
+  0x6E, 0xD1, 0x93, 0xBE, 0x55, 0xF4, 0x64, 0xEF, 0x13, 0xE5, 0x24, 0x46, 0xD0, 0xCC, 0x1B, 0x79,
+  0xA5, 0x18, 0x47, 0x8E, 0x38, 0x43, 0xC7, 0xF3, 0x23, 0x71, 0xDF, 0x09, 0xE6, 0xB5, 0x16, 0x0C,
+  0xE9, 0xF9, 0x2E, 0xBD, 0xD7, 0x13, 0x0E, 0xB1, 0xE3, 0xA3, 0x6D, 0x51, 0xF2, 0x1A, 0x0F, 0xDC,
+  0x83, 0xD0, 0x8D, 0x98, 0xB8, 0xC8, 0xC3, 0xA3, 0x95, 0x15, 0x56, 0x9A, 0xCD, 0xC3, 0x1D, 0x92,
+  0x89, 0x13, 0xC6, 0x11, 0x93, 0xBA, 0xA4, 0xD9, 0xEF, 0xAC, 0xF2, 0x17, 0x79, 0x55, 0x82, 0x98,
+  0x61, 0xD7, 0x52, 0x87, 0x68, 0xB2, 0xA6, 0x98, 0x57, 0x0C, 0x24, 0xDE, 0x87, 0xB0, 0x78, 0x2A,
+  0xB3, 0x68, 0xF0, 0x5C, 0x38, 0x3B, 0x0D, 0x56, 0x48, 0x9D, 0xC5, 0x24, 0xA7, 0xD2, 0x96, 0x57,
+  0xF0, 0x39, 0xAF, 0xE0, 0x37, 0x5B, 0xEA, 0x70, 0xFC, 0xB9, 0x0A, 0xA9, 0xF3, 0xB5, 0xD8, 0x17,
+  0x9A, 0x5E, 0x23, 0x64, 0xEC, 0xDE, 0xB1, 0x70, 0x55, 0x4F, 0x38, 0xAE, 0x96, 0x4F, 0xA6, 0xD1,
+  0x4D, 0xE3, 0x51, 0xFB, 0xA4, 0x67, 0x2A, 0xE3, 0xF7, 0xDE, 0x10, 0x11, 0x2E, 0x03, 0x66, 0x40,
+  0x0C, 0xEC, 0xF5, 0x28, 0x2F, 0xD5, 0x83, 0x7E, 0x01, 0x90, 0x08, 0x0C, 0x10, 0xF9, 0xEE, 0x94,
+  0x60, 0x23, 0x75, 0x44, 0xB5, 0xBB, 0x47, 0x64, 0xD7, 0xB8, 0xF9, 0x95, 0x27, 0x42, 0x50, 0xD7,
+  0x2E, 0x40, 0xD8, 0x00, 0x79, 0x23, 0xC2, 0x79, 0xA5, 0xAC, 0x6C, 0x3F, 0x33, 0xAE, 0x78, 0xB1,
+  0xE8, 0x87, 0x46, 0xED, 0x90, 0x51, 0x4F, 0x46, 0xC1, 0x80, 0xD1, 0xC8, 0x52, 0x72, 0x24, 0xCD,
+  0x57, 0x48, 0xED, 0x2F, 0xB5, 0x66, 0x5E, 0x96, 0x79, 0x75, 0x48, 0x90, 0x92, 0x01, 0xC5, 0x1E,
+  0x80, 0x4E, 0xB4, 0x1C, 0x7B, 0x96, 0xB3, 0x11, 0x0F, 0xE4, 0x35, 0x85, 0xFE, 0x1D, 0x79, 0x98,
+  0x1B, 0x94, 0xC6, 0xB9, 0xD9, 0xFD, 0x92, 0x53, 0xF5, 0x73, 0xA6, 0x6A, 0x2F, 0xAF, 0xEA, 0x6F,
+  0x99, 0xAA, 0xEB, 0x46, 0x55, 0xFB, 0xEC, 0x57, 0x06, 0xD4, 0x96, 0xCF, 0x42, 0xA5, 0xBA, 0xA4,
+  0xC6, 0xE7, 0xD2, 0x1A, 0xBF, 0xE5, 0xD5, 0xD0, 0x49, 0xD3, 0x52, 0x37, 0x24, 0xB7, 0x4D, 0x15,
+  0x46, 0x13, 0x27, 0x0C, 0x9D, 0x87, 0x96, 0x10, 0x00, 0x96, 0x7C, 0x77, 0x1C, 0xF8, 0x41, 0x34,
+  0x71, 0x06, 0x94, 0x30, 0x77, 0x08, 0x53, 0xC3, 0xC6, 0x3D, 0xD3, 0x54, 0x50, 0x94, 0x80, 0x85,
+  0x5C, 0x31, 0x10, 0xD7, 0x6B, 0xD2, 0xA5, 0x1F, 0x85, 0x21, 0xAB, 0x54, 0x32, 0x2B, 0x03, 0xB7,
+  0xDB, 0xF3, 0xC0, 0xA6, 0xDD, 0x57, 0xBB, 0x8C, 0x81, 0x7E, 0x66, 0x88, 0x86, 0x72, 0x0D, 0x15,
+  0x63, 0xF4, 0x83, 0x90, 0xBA, 0xB5, 0xA2, 0x14, 0x35, 0x6C, 0xD3, 0xB1, 0x30, 0x5A, 0x51, 0xFA,
+  0x8A, 0xFC, 0xBA, 0xF6, 0x79, 0xED, 0xB7, 0x9A, 0x7E, 0x1D, 0xC9, 0xD2, 0xFB, 0xD7, 0x64, 0xB3,
+  0x99, 0xB1, 0xC2, 0x72, 0x79, 0x1A, 0x79, 0x7F, 0xA7, 0xC4, 0xA6, 0x9A, 0x35, 0xED, 0x98, 0xDC,
+  0x3C, 0x48, 0x97, 0xCE, 0x59, 0xD7, 0x4A, 0x9C, 0xA0, 0xC1, 0x84, 0x8D, 0xBD, 0x12, 0xE8, 0x31,
+  0x80, 0x65, 0x04, 0xC4, 0x40, 0x5C, 0x38, 0xA8, 0xF3, 0x0A, 0xEA, 0x34, 0xE5, 0x5F, 0xDA, 0x31,
+  0xBF, 0x58, 0x9E, 0x5D, 0xF9, 0x32, 0x35, 0xE5, 0x1C, 0x62, 0xC5, 0xFA, 0x6C, 0xCB, 0x65, 0x02,
+  0x5E, 0xC4, 0xE1, 0xCD, 0xF5, 0x45, 0xE1, 0x4F, 0x8D, 0xDA, 0xFF, 0xB2, 0x37, 0x12, 0xD8, 0xA0,
+  0x2D, 0x75, 0x06, 0x37, 0x0D, 0xFB, 0x3E, 0x41, 0xD5, 0x49, 0x7F, 0x6A, 0xC4, 0x37, 0x5E, 0xD4,
+  0x64, 0x1D, 0x69, 0x34, 0x0B, 0xB5, 0xBA, 0xAF, 0x6B, 0xF5, 0x76, 0x34, 0xBD, 0x8A, 0xB8, 0x65,
+  0xCA, 0xDE, 0xFB, 0xD3, 0x12, 0xEA, 0x29, 0x40, 0x93, 0xA6, 0xB0, 0xE0, 0xF1, 0xBB, 0x48, 0x52,
+  0x93, 0x25, 0x4B, 0xA0, 0xD4, 0x57, 0xC6, 0x87, 0xF5, 0x2F, 0x1C, 0x44, 0xBA, 0x67, 0xFA, 0xA6,
+  0x1B, 0xE1, 0x32, 0x94, 0xB6, 0x9A, 0x21, 0x2E, 0x6B, 0x97, 0x19, 0xE3, 0x7A, 0xBD, 0x2A, 0x06,
+  0xB9, 0x6C, 0xB1, 0x2C, 0xA3, 0x3C, 0xBD, 0x37, 0xFE, 0xEC, 0x69, 0x5E, 0x7A, 0x7C, 0xCA, 0xC7,
+  0x1D, 0x9F, 0xF2, 0x41, 0xC7, 0xEF, 0x64, 0x9F, 0x27, 0x12, 0x34, 0xBB, 0x8D, 0x2E, 0x9B, 0xCE,
+  0x6A, 0xA7, 0x27, 0x22, 0x38, 0x9B, 0xAD, 0x6E, 0xA0, 0x53, 0xEC, 0x75, 0x63, 0xB6, 0x68, 0xD6,
+  0xAA, 0x88, 0x4E, 0xB7, 0x16, 0x89, 0x60, 0x74, 0x5B, 0x99, 0x94, 0x57, 0xA3, 0x4C, 0x93, 0x32,
+  0x7B, 0x99, 0x2E, 0x19, 0x8F, 0x60, 0xFB, 0x1B, 0x23, 0x66, 0xB5, 0xFF, 0x93, 0x3A, 0xDA, 0x1E,
+  0xE0, 0x87, 0xE7, 0x93, 0x6D, 0x3F, 0x21, 0x89, 0xCE, 0xDF, 0x53, 0x64, 0x54, 0x6B, 0x99, 0x49,
+  0x6C, 0x0A, 0xE0, 0xCC, 0x66, 0x71, 0x22, 0x8A, 0x3F, 0xCE, 0xF6, 0x22, 0x19, 0xDB, 0xEA, 0x5B,
+  0x8C, 0x22, 0xCE, 0x2A, 0x6E, 0x40, 0x75, 0xB3, 0x76, 0xE3, 0xD0, 0x13, 0x1A, 0xDF, 0x04, 0x6E,
+  0xB5, 0xB4, 0xAD, 0xE9, 0x85, 0x8A, 0x6C, 0xCE, 0x56, 0x05, 0x64, 0xCA, 0x7F, 0x05, 0xBE, 0x71,
+  0x3C, 0x62, 0xF1, 0x6D, 0xE6, 0x3B, 0xC3, 0x6C, 0xDE, 0xE2, 0x5C, 0xB7, 0x1E, 0xE0, 0x84, 0x6F,
+  0x22, 0x57, 0x40, 0xDE, 0xE5, 0x93, 0x26, 0x59, 0x25, 0x0D, 0xA5, 0x8E, 0xE9, 0x2C, 0x16, 0x95,
+  0xD6, 0x58, 0xEE, 0x66, 0x18, 0xB1, 0x6C, 0x55, 0x7B, 0x40, 0x94, 0x6C, 0xD2, 0x2C, 0x26, 0x5E,
+  0x9A, 0x01, 0x40, 0x6B, 0x3B, 0x0E, 0x58, 0xFC, 0x62, 0x63, 0xBD, 0x2C, 0x6B, 0x6F, 0x3E, 0xBB,
+  0x74, 0x06, 0x94, 0x70, 0xCB, 0xE0, 0xAD, 0x9D, 0x5D, 0x26, 0xAD, 0x4D, 0xE0, 0xC1, 0x53, 0xF3,
+  0x2B, 0x7B, 0x5F, 0xC8, 0xCE, 0x2E, 0x73, 0x3B, 0xFD, 0xC3, 0xEA, 0x8F, 0xE9, 0xF8, 0x4C, 0xB4,
+  0x63, 0xED, 0xB5, 0x5D, 0x85, 0xC4, 0x98, 0x54, 0xDA, 0xDD, 0x21, 0x5B, 0xB6, 0x45, 0x7B, 0xE4,
+  0xC4, 0x12, 0x4A, 0x5A, 0x79, 0x95, 0x6C, 0x20, 0x27, 0x7B, 0x59, 0x5F, 0x73, 0xFE, 0x22, 0x6D,
+  0xD9, 0x52, 0x97, 0xDC, 0x03, 0xCB, 0xBA, 0x01, 0x24, 0xD5, 0x09, 0x51, 0xBB, 0xD9, 0x43, 0x50,
+  0x6D, 0xB3, 0x34, 0x86, 0x1D, 0xA2, 0x24, 0xBF, 0xBB, 0xAD, 0xFC, 0xF9, 0x3A, 0xE9, 0x98, 0xF2,
+  0x55, 0x0F, 0x49, 0xAF, 0x44, 0xE5, 0xCA, 0x8E, 0x66, 0xC7, 0xA7, 0x08, 0x56, 0x88, 0x49, 0x78,
+  0x36, 0x0C, 0xF2, 0x5B, 0x0E, 0x27, 0xB2, 0xB7, 0xDC, 0x04, 0x2B, 0x00, 0xAA, 0x24, 0xFB, 0xC7,
+  0xE2, 0x8A, 0x49, 0x71, 0x11, 0x5B, 0xF2, 0x3B, 0x51, 0x99, 0x43, 0x16, 0xD5, 0xC6, 0x11, 0x29,
+  0x12, 0xBA, 0x6E, 0x11, 0x34, 0xAB, 0x1A, 0xB1, 0x35, 0xEE, 0xE5, 0x37, 0xCE, 0x8D, 0x4C, 0xCD,
+  0x00, 0xE9, 0x7E, 0x31, 0xE2, 0x82, 0xE7, 0xB9, 0x6D, 0x28, 0xAF, 0x0B, 0xCE, 0x00, 0xA7, 0x57,
+  0x70, 0x6B, 0x51, 0x83, 0xA3, 0x1D, 0xD6, 0xE5, 0x65, 0x18, 0xB1, 0x4C, 0xE9, 0xED, 0xDC, 0xBA,
+  0xFA, 0x1C, 0x29, 0xAB, 0x97, 0x48, 0x4D, 0x49, 0xC5, 0x74, 0xB8, 0xF3, 0x2B, 0x1A, 0x43, 0x5B,
+  0x5A, 0xD1, 0x1C, 0xC6, 0xAA, 0x0F, 0x39, 0xA8, 0xB7, 0xDD, 0x22, 0xAE, 0xDA, 0x25, 0x63, 0x08,
+  0xD3, 0xC4, 0xD9, 0x44, 0xCF, 0xDF, 0x8A, 0x3C, 0x77, 0x49, 0xE3, 0xB9, 0xBC, 0x77, 0xBA, 0x0D,
+  0x56, 0xE8, 0xC1, 0x53, 0x34, 0x72, 0x91, 0x17, 0xCF, 0xD8, 0x1E, 0x54, 0xF6, 0xE4, 0xD9, 0xA4,
+  0xC3, 0x94, 0x9C, 0x47, 0xF4, 0xE8, 0xCD, 0x89, 0x3E, 0xF1, 0xEC, 0xC9, 0x14, 0xB8, 0x6B, 0x20,
+  0x6B, 0x76, 0x07, 0x9F, 0xC9, 0x98, 0x8A, 0x4E, 0x3E, 0x85, 0xED, 0xBA, 0xA3, 0xCF, 0xDC, 0x39,
+  0xCF, 0xE8, 0xEC, 0xAB, 0xB2, 0xF1, 0x5E, 0xA6, 0xC3, 0xCF, 0xD8, 0x3E, 0x2F, 0xE6, 0xF4, 0x53,
+  0x98, 0x32, 0x9B, 0xE3, 0x2F, 0x99, 0x2D, 0xDF, 0xD5, 0xF9, 0xA7, 0x89, 0x87, 0x6A, 0x5B, 0xA1,
+  0x15, 0xF5, 0xDC, 0x5C, 0x2D, 0x97, 0xE6, 0x22, 0xCC, 0xAC, 0x95, 0x7A, 0x85, 0x0D, 0xB3, 0xC5,
+  0xA6, 0xF9, 0x61, 0xAB, 0x0C, 0xC4, 0x73, 0xCD, 0x0D, 0x59, 0xAA, 0x0C, 0x1F, 0xC5, 0xF9, 0xA9,
+  0xC8, 0xC0, 0xB7, 0xCC, 0x65, 0x71, 0xCD, 0x8B, 0xA9, 0xDC, 0x65, 0xE5, 0xE6, 0x36, 0xFC, 0xAB,
+  0x8C, 0x6C, 0xFB, 0x6F, 0xA0, 0xD9, 0x1B, 0xF5, 0x7A, 0x72, 0x81, 0xD7, 0xA8, 0xD2, 0x2A, 0xAF,
+  0xF2, 0xD7, 0xBF, 0x66, 0xEA, 0x84, 0x34, 0x9E, 0x86, 0x3E, 0x33, 0xD5, 0x0D, 0xEA, 0x86, 0x34,
+  0xC6, 0x6B, 0xC3, 0x9A, 0x2A, 0x66, 0x37, 0xB5, 0x41, 0x65, 0x81, 0xF4, 0xC8, 0x32, 0xEB, 0x6B,
+  0x6F, 0x99, 0x3A, 0x62, 0x8F, 0xA5, 0xB8, 0xEE, 0x8E, 0xAF, 0x99, 0xAB, 0x2E, 0x76, 0xAE, 0xC8,
+  0x9D, 0x13, 0x11, 0x5C, 0xB9, 0x09, 0x5E, 0x35, 0xA6, 0x6E, 0x8B, 0xF0, 0x29, 0x4D, 0x58, 0x9A,
+  0x52, 0x7E, 0x17, 0x3D, 0x1A, 0x84, 0x98, 0xCF, 0xC8, 0xD8, 0xE5, 0x8C, 0xE8, 0x89, 0xE3, 0x3B,
+  0x43, 0x1A, 0x5E, 0x60, 0xCD, 0x4C, 0xC8, 0x2F, 0x6B, 0xBF, 0xFB, 0x3A, 0x0E, 0x89, 0x83, 0xB1,
+  0x34, 0x3B, 0xF5, 0x11, 0xBD, 0x8E, 0xEB, 0xF0, 0xE1, 0x66, 0x17, 0x3D, 0x09, 0xAF, 0xD7, 0xE0,
+  0x17, 0xFC, 0xA3, 0x0F, 0x8A, 0x4C, 0xFC, 0xE1, 0xEE, 0xBE, 0x4E, 0x93, 0x86, 0xEF, 0x70, 0x7B,
+  0xE3, 0x2A, 0xB8, 0xAF, 0x13, 0xCF, 0xDD, 0xA9, 0x23, 0x42, 0xBE, 0xB1, 0xDF, 0x1B, 0x8D, 0xEA,
+  0x84, 0xA5, 0xDD, 0x82, 0xAF, 0x41, 0x38, 0x5E, 0x65, 0x15, 0x57, 0x79, 0x53, 0x85, 0x2E, 0xE6,
+  0x9F, 0xAC, 0xC3, 0xF2, 0x78, 0x80, 0x77, 0x40, 0x39, 0x04, 0x49, 0x72, 0x30, 0x1C, 0xE2, 0x65,
+  0x4F, 0xA0, 0x67, 0x0D, 0xD1, 0xAE, 0xC5, 0x61, 0xF2, 0x0F, 0xA3, 0xBB, 0xB6, 0x9D, 0xE9, 0x2D,
+  0xF2, 0x92, 0x5F, 0x7C, 0x2E, 0x08, 0x0B, 0x96, 0x15, 0xCF, 0x83, 0xBB, 0xC8, 0x70, 0x79, 0x8A,
+  0x92, 0x8B, 0x20, 0x66, 0x92, 0x61, 0x29, 0x12, 0x17, 0xC0, 0x31, 0x51, 0x98, 0x82, 0x3D, 0x11,
+  0x04, 0xBC, 0xE1, 0x8C, 0x6A, 0xC3, 0xA8, 0xDE, 0x2C, 0x59, 0xE1, 0x74, 0x51, 0x50, 0x76, 0xD0,
+  0xC2, 0x88, 0x10, 0x60, 0x88, 0xC3, 0x32, 0x0D, 0xE0, 0x3D, 0x7B, 0x14, 0x0D, 0x76, 0x49, 0x1E,
+  0xAD, 0x84, 0x16, 0xFB, 0x33, 0xC4, 0xFE, 0x60, 0x16, 0x77, 0x50, 0xB1, 0x60, 0x72, 0xC4, 0x81,
+  0x94, 0x1F, 0xA8, 0x05, 0x02, 0x84, 0x8A, 0x93, 0x37, 0x07, 0xCB, 0xC3, 0xBB, 0x55, 0x33, 0xD0,
+  0x9A, 0x1D, 0x08, 0xAE, 0xAF, 0x31, 0xDD, 0x03, 0xC8, 0x3E, 0xA7, 0x5E, 0xD9, 0xE7, 0x46, 0x41,
+  0x18, 0x7F, 0x08, 0x5D, 0xF6, 0x10, 0x8F, 0xC6, 0x75, 0x7C, 0xF4, 0x4E, 0x26, 0xFF, 0x4B, 0x27,
+  0x5C, 0xEA, 0xB7, 0x99, 0x86, 0xA3, 0x38, 0x18, 0x60, 0xBA, 0x2D, 0x18, 0x8D, 0x35, 0xA4, 0x9A,
+  0xDD, 0xE1, 0xFF, 0x0B, 0xC7, 0xC5, 0x9E, 0x21, 0xE2, 0xBF, 0xA2, 0xFF, 0xEA, 0xE7, 0x01, 0xFA,
+  0xB3, 0xD9, 0xC7, 0x6B, 0x85, 0x30, 0x94, 0xC3, 0x67, 0xA9, 0x26, 0xAB, 0xFD, 0x8C, 0xD4, 0xB0,
+  0x5A, 0x09, 0x59, 0x98, 0xAF, 0x12, 0x4B, 0x02, 0xFC, 0xC3, 0x28, 0xEA, 0x7E, 0xD1, 0x1A, 0x83,
+  0x06, 0x62, 0x15, 0xC0, 0x28, 0x84, 0x45, 0xE6, 0xE3, 0xF9, 0x31, 0x5E, 0x5C, 0x67, 0x6F, 0xE2,
+  0x35, 0xD4, 0x9E, 0x61, 0x64, 0xB3, 0x2F, 0x82, 0xED, 0x45, 0x6E, 0xC3, 0xD0, 0x1B, 0x37, 0x94,
+  0xAC, 0x92, 0x08, 0x0C, 0x8D, 0xB3, 0x2A, 0xD0, 0x0E, 0x9D, 0x98, 0x9A, 0x80, 0x94, 0xFC, 0xF6,
+  0xD5, 0x32, 0x0E, 0x64, 0xC3, 0xE7, 0x58, 0xCA, 0x81, 0xBC, 0xE0, 0x39, 0xD0, 0x25, 0x43, 0x1F,
+  0x0C, 0x2D, 0x36, 0xFA, 0x11, 0x1F, 0x7E, 0xBC, 0x7D, 0xEE, 0x5C, 0xC7, 0x30, 0x8E, 0x89, 0x24,
+  0x8D, 0xF9, 0xBC, 0xC3, 0x48, 0xFE, 0xC1, 0x28, 0x60, 0x56, 0x6B, 0x08, 0x22, 0x70, 0x1D, 0xD2,
+  0xE8, 0x86, 0xBA, 0x7A, 0x4A, 0xC6, 0x7C, 0x1D, 0x87, 0x39, 0x18, 0x85, 0xDC, 0xE0, 0xE5, 0x05,
+  0x73, 0x22, 0x98, 0xEE, 0x67, 0x54, 0xAE, 0xCA, 0x54, 0x62, 0x2F, 0xC9, 0xA3, 0xC4, 0xCA, 0xB4,
+  0xD6, 0xCA, 0xBC, 0x85, 0xC5, 0x23, 0xA2, 0xC7, 0xC0, 0xDE, 0x31, 0xAE, 0xCD, 0x8C, 0x11, 0x40,
+  0x1A, 0xF0, 0x38, 0x62, 0xB5, 0x59, 0x52, 0x37, 0x91, 0x05, 0x84, 0x1C, 0xF4, 0x7F, 0xE1, 0x79,
+  0x3B, 0xC0, 0xD6, 0x0F, 0x98, 0x39, 0x5D, 0x5D, 0x33, 0xAE, 0xEC, 0xE8, 0x64, 0x18, 0xE4, 0x29,
+  0xAA, 0xE3, 0xC4, 0x89, 0x6F, 0xDA, 0x40, 0x4D, 0x43, 0x53, 0x1C, 0xE9, 0xEC, 0xFF, 0x20, 0x05,
+  0xDA, 0x14, 0xE2, 0xE6, 0x0C, 0xAA, 0x4B, 0xC3, 0x89, 0x6F, 0xB9, 0xC0, 0xEC, 0x57, 0x27, 0x06,
+  0x57, 0x56, 0x58, 0xC0, 0x26, 0x54, 0x4D, 0x5B, 0x44, 0xA4, 0xE2, 0xC0, 0x41, 0xF6, 0x91, 0xA5,
+  0x2C, 0x53, 0x89, 0x3A, 0x94, 0x1A, 0xF8, 0xD7, 0x3A, 0x54, 0xD3, 0xDE, 0xD5, 0xB5, 0x84, 0xDA,
+  0x32, 0xD5, 0x15, 0xE9, 0x89, 0xA6, 0x91, 0x20, 0xE3, 0xED, 0x11, 0xE6, 0xC7, 0x48, 0xD4, 0x40,
+  0x26, 0x3F, 0x86, 0xCC, 0xCE, 0x72, 0x4E, 0xAF, 0xA6, 0xDE, 0xC8, 0xD5, 0x35, 0x1C, 0x99, 0x46,
+  0x28, 0xB1, 0xEC, 0xFD, 0x60, 0x7C, 0xDE, 0x90, 0x4D, 0x6F, 0xB6, 0x69, 0x82, 0x2A, 0x78, 0xF4,
+  0xA8, 0x66, 0xAC, 0x90, 0x12, 0xC7, 0x24, 0x57, 0x4B, 0x55, 0x91, 0xAB, 0x67, 0xB5, 0xB5, 0x3C,
+  0xB3, 0xCC, 0x8B, 0x94, 0x73, 0x99, 0x95, 0x3E, 0xB8, 0x8A, 0x1D, 0x0F, 0x16, 0x64, 0xA5, 0xDC,
+  0xBA, 0xDA, 0x5B, 0xEB, 0x99, 0x2B, 0x3E, 0xBF, 0xB1, 0x9F, 0x54, 0x28, 0x58, 0xC0, 0x44, 0x2D,
+  0x65, 0x8A, 0x24, 0x45, 0xF7, 0xE3, 0xD1, 0x0D, 0x28, 0x8D, 0x42, 0x15, 0xA2, 0xD4, 0xD3, 0x86,
+  0x86, 0x6B, 0x65, 0x99, 0x5E, 0xAF, 0x96, 0x75, 0x45, 0xC8, 0x46, 0x72, 0xB8, 0x72, 0x66, 0xA6,
+  0xAC, 0x36, 0xCB, 0xE4, 0xAC, 0xC4, 0x05, 0x98, 0x98, 0x4A, 0xD7, 0x6D, 0xEE, 0x59, 0x7D, 0xAC,
+  0xF6, 0x59, 0xF2, 0xD9, 0xE2, 0xF1, 0xC2, 0x3A, 0x55, 0xC7, 0x8C, 0xD7, 0x2D, 0x19, 0x37, 0x91,
+  0xB2, 0xEB, 0xBB, 0x8E, 0x1D, 0xA3, 0xE1, 0x87, 0x18, 0xBF, 0x0C, 0x37, 0xCA, 0xC7, 0x50, 0xD1,
+  0xCD, 0x87, 0xC1, 0x9D, 0x8F, 0x2B, 0x5B, 0x3A, 0x87, 0x99, 0x71, 0x49, 0x5D, 0x9C, 0xAB, 0xD5,
+  0xB3, 0x97, 0x20, 0xC4, 0xE3, 0x43, 0xE5, 0x4C, 0x89, 0xA3, 0xF5, 0xD9, 0x19, 0xC2, 0x87, 0x6B,
+  0x06, 0xAC, 0x2F, 0x20, 0xCF, 0x0F, 0x54, 0xDB, 0xD7, 0x9B, 0x8F, 0x66, 0xCA, 0xF7, 0xB3, 0xDE,
+  0xF0, 0xFC, 0x25, 0xF8, 0xB4, 0x39, 0x26, 0xF3, 0xC2, 0xF4, 0x3A, 0x51, 0xCC, 0x4A, 0xF4, 0x6C,
+  0x60, 0x49, 0x55, 0x45, 0x7A, 0x55, 0x98, 0x3B, 0x76, 0xEA, 0x9B, 0xC9, 0x8A, 0x6A, 0x37, 0xBB,
+  0x10, 0xC4, 0x5F, 0x18, 0xF9, 0xCC, 0x32, 0x52, 0xB9, 0xF9, 0x7B, 0x0A, 0x1E, 0xD3, 0x93, 0x32,
+  0xA3, 0xC6, 0x61, 0xD4, 0xEC, 0xB8, 0x62, 0x18, 0x84, 0x18, 0xAB, 0x2E, 0x31, 0x53, 0x9D, 0x83,
+  0x86, 0x85, 0xDA, 0x6D, 0x79, 0x30, 0xD9, 0xBE, 0x01, 0xFB, 0x01, 0xB3, 0x9F, 0xCA, 0x6A, 0x42,
+  0xE8, 0x52, 0x5C, 0x68, 0x48, 0xE7, 0x8C, 0xBE, 0xDC, 0x00, 0x28, 0xD6, 0xA7, 0xDC, 0x6E, 0xCC,
+  0x3E, 0xF8, 0x79, 0x49, 0x6B, 0xD0, 0x53, 0x92, 0x42, 0xD5, 0xD2, 0xD6, 0xF8, 0x99, 0xA4, 0x35,
+  0x69, 0x45, 0x4C, 0x5C, 0x93, 0xBC, 0xDC, 0x95, 0xAC, 0xE1, 0xC9, 0xDE, 0x27, 0xBD, 0x91, 0x50,
+  0x26, 0xE1, 0x54, 0x4F, 0xA7, 0xB4, 0x2C, 0xF9, 0x7E, 0x96, 0x77, 0x64, 0x9C, 0x19, 0x77, 0xE9,
+  0xC9, 0x48, 0x0C, 0x08, 0x71, 0x76, 0x9C, 0x51, 0x88, 0xAA, 0x64, 0x99, 0x6E, 0x2B, 0x25, 0x3B,
+  0xAE, 0x0D, 0xB8, 0x35, 0x3F, 0x6E, 0x75, 0xC9, 0xBC, 0xCF, 0x08, 0x24, 0xEB, 0x4B, 0x6D, 0xBB,
+  0xB2, 0xEA, 0x2C, 0xD4, 0x9D, 0x09, 0x21, 0xE5, 0x1A, 0x53, 0x7B, 0x67, 0x59, 0x18, 0x18, 0xA9,
+  0x91, 0xB2, 0x90, 0x99, 0xC1, 0xD3, 0x86, 0xBD, 0xF1, 0x0C, 0x89, 0x57, 0x12, 0xA1, 0xE1, 0xAF,
+  0xDD, 0xA5, 0xE4, 0x3E, 0xE3, 0x90, 0xE6, 0x4C, 0x77, 0xC6, 0x09, 0xB5, 0xEC, 0x41, 0x26, 0x61,
+  0x30, 0xC4, 0x77, 0x0F, 0x00, 0xB0, 0xFC, 0xF5, 0x1D, 0x58, 0x68, 0x23, 0x4C, 0x25, 0xAF, 0x32,
+  0xB6, 0x78, 0x0B, 0x33, 0x10, 0xD9, 0xC3, 0x66, 0x69, 0xCA, 0x3D, 0xF0, 0x22, 0x87, 0xF9, 0x2C,
+  0x0D, 0x9D, 0x2B, 0xFE, 0x56, 0x3B, 0xFB, 0x6F, 0x7E, 0x43, 0x23, 0xC3, 0x5B, 0x61, 0x6E, 0x37,
+  0x25, 0x23, 0xA6, 0xC1, 0x05, 0x99, 0x89, 0x2B, 0x1D, 0xDC, 0x09, 0x0D, 0x07, 0x94, 0x05, 0xF4,
+  0xF1, 0xB2, 0xF6, 0x88, 0x65, 0xED, 0x22, 0x6B, 0x84, 0xFF, 0x19, 0x33, 0x23, 0x9C, 0xFC, 0x19,
+  0x8F, 0xB0, 0x95, 0x84, 0x66, 0x02, 0xEC, 0xBE, 0x13, 0x2A, 0xA7, 0x51, 0x6C, 0x2F, 0x12, 0xC2,
+  0xB6, 0xD9, 0x6D, 0x08, 0xB0, 0x4A, 0x7E, 0xE4, 0xA9, 0x92, 0x12, 0xCE, 0x30, 0x4E, 0x2C, 0xED,
+  0x70, 0xAA, 0xFD, 0x6F, 0x21, 0x90, 0xD4, 0x4D, 0x73, 0x7E, 0x33, 0xEF, 0xA7, 0x20, 0x79, 0x17,
+  0x33, 0x9C, 0x76, 0xCC, 0x88, 0x8B, 0x02, 0x3C, 0x35, 0x25, 0xAF, 0x78, 0x8B, 0xDC, 0x85, 0x1E,
+  0x4B, 0x80, 0xC6, 0xC4, 0x1B, 0x8C, 0x08, 0x26, 0xD3, 0xEC, 0x39, 0xD1, 0x9A, 0x25, 0xED, 0xB5,
+  0x21, 0x13, 0x3A, 0x23, 0xCB, 0xF0, 0xF2, 0xA4, 0x74, 0x24, 0xC9, 0x4A, 0x57, 0xC6, 0x48, 0x79,
+  0x46, 0xB2, 0x8C, 0x09, 0xCE, 0xBE, 0x25, 0x4A, 0x1C, 0x73, 0xCA, 0x71, 0x2F, 0xFC, 0xFE, 0xC3,
+  0xB1, 0x3B, 0x2B, 0xD5, 0x0A, 0x3F, 0x54, 0x39, 0x9F, 0x8B, 0x19, 0x6F, 0x1C, 0x20, 0xD2, 0xD5,
+  0x81, 0xAA, 0x73, 0x60, 0x2E, 0xA0, 0x7B, 0x08, 0x40, 0x40, 0x4D, 0xC1, 0xC6, 0x03, 0x91, 0xE3,
+  0x65, 0x1F, 0xD7, 0xCD, 0xCC, 0x2B, 0x9E, 0xE2, 0xDE, 0xFC, 0x6D, 0x5C, 0x94, 0x73, 0x86, 0x1F,
+  0x02, 0x25, 0x90, 0xEC, 0xB7, 0xDD, 0xAD, 0xCE, 0x35, 0x7E, 0x7A, 0x55, 0xD2, 0x92, 0x8F, 0x36,
+  0x93, 0x08, 0x49, 0xC7, 0x99, 0xE2, 0xCE, 0xC2, 0xD4, 0xC0, 0x2F, 0x37, 0x5E, 0xD8, 0x56, 0x72,
+  0x00, 0xCC, 0xD3, 0xF5, 0x94, 0x74, 0xAE, 0x28, 0x7D, 0x50, 0xD2, 0x39, 0x5E, 0x69, 0x9E, 0xCE,
+  0x15, 0xB5, 0xD4, 0x3A, 0xC7, 0x2B, 0x56, 0xEC, 0xDC, 0xD4, 0x9D, 0x94, 0x74, 0xEB, 0xA3, 0x3B,
+  0x29, 0xEF, 0xD9, 0xD4, 0x9D, 0xCC, 0xDC, 0xA7, 0xDC, 0x36, 0x5A, 0x6F, 0x12, 0xF4, 0x46, 0x87,
+  0xBA, 0x9D, 0xAE, 0x4C, 0x6F, 0xAD, 0xF7, 0xC8, 0xBD, 0x19, 0x4C, 0xE4, 0x23, 0xC4, 0xD9, 0x5E,
+  0x89, 0x82, 0xC3, 0x77, 0x07, 0x67, 0xF6, 0xFE, 0x28, 0x89, 0xE8, 0x8E, 0xCF, 0x74, 0xFA, 0x24,
+  0xD4, 0x5A, 0xB3, 0xF4, 0x2C, 0xB3, 0x62, 0x7B, 0x95, 0x6E, 0x28, 0xB8, 0x0B, 0xC2, 0xAF, 0x2C,
+  0xC8, 0x57, 0xB7, 0x87, 0x8D, 0x78, 0x70, 0xFC, 0x86, 0x2F, 0x4A, 0x9F, 0xF2, 0x06, 0x95, 0x9F,
+  0x45, 0x50, 0xDA, 0x7C, 0xA9, 0x63, 0xBA, 0x91, 0xA4, 0xEC, 0x4F, 0x3B, 0xFD, 0xBE, 0x69, 0x3E,
+  0x1B, 0x16, 0x9F, 0x8A, 0x30, 0xCF, 0xE0, 0x43, 0x26, 0xAB, 0xF5, 0xD0, 0xA6, 0x33, 0x1E, 0x70,
+  0xE9, 0x34, 0x8D, 0x83, 0x77, 0xED, 0x3D, 0x0E, 0xED, 0x2C, 0x86, 0x95, 0xD9, 0x1E, 0x37, 0x39,
+  0xA5, 0x77, 0x32, 0xA3, 0xAB, 0x36, 0xBE, 0x06, 0x03, 0xCD, 0x33, 0x6E, 0x1C, 0x98, 0x93, 0x68,
+  0x28, 0x5E, 0xCB, 0x95, 0xD9, 0x4C, 0x0F, 0x04, 0x44, 0x28, 0xC1, 0xF4, 0xB8, 0xF8, 0x6E, 0x37,
+  0xF7, 0x45, 0x79, 0x11, 0xA1, 0xE3, 0x49, 0xFC, 0xA0, 0x0A, 0xA5, 0xC5, 0x3A, 0x16, 0x59, 0x0A,
+  0x0E, 0x0C, 0xC2, 0xF2, 0x42, 0xEB, 0x04, 0x11, 0xB9, 0xF8, 0x41, 0x50, 0x7C, 0xCC, 0x27, 0x82,
+  0x6E, 0xB0, 0x80, 0x20, 0x35, 0x35, 0x23, 0xB9, 0x34, 0xF3, 0xCF, 0x73, 0xB1, 0xC2, 0x2D, 0xBA,
+  0xE2, 0x5E, 0x80, 0xED, 0x26, 0x98, 0x29, 0xF2, 0xB9, 0x79, 0xD6, 0x98, 0xE0, 0xB8, 0x32, 0x0F,
+  0xDA, 0xD9, 0xA7, 0x28, 0x15, 0xA8, 0x51, 0x24, 0x96, 0xA8, 0xF9, 0x64, 0xA7, 0x40, 0x4C, 0x14,
+  0xD0, 0x79, 0x52, 0xA2, 0x10, 0xBF, 0xB2, 0xA3, 0x36, 0x48, 0xB7, 0x00, 0x2D, 0xDC, 0x1E, 0x18,
+  0x25, 0x32, 0x5E, 0x18, 0x0A, 0xB5, 0x01, 0xD0, 0xF5, 0xD5, 0xF9, 0x81, 0x32, 0x02, 0xCA, 0xAB,
+  0xCB, 0x2C, 0x50, 0x26, 0x87, 0x84, 0x4C, 0xD3, 0x16, 0xD6, 0x96, 0x68, 0xB4, 0xA7, 0x77, 0xCA,
+  0x1A, 0xB2, 0x91, 0x6A, 0xC9, 0x01, 0x31, 0x6A, 0x9B, 0xC2, 0x8B, 0xC9, 0x5E, 0xE5, 0xE5, 0x0C,
+  0x35, 0x00, 0x45, 0x8A, 0x06, 0x73, 0x10, 0xB0, 0x4C, 0x3D, 0x7C, 0xB7, 0x24, 0x81, 0x35, 0xAD,
+  0x79, 0x64, 0xB5, 0xF2, 0xF4, 0xA2, 0x82, 0x82, 0xCF, 0x9A, 0xC9, 0x3B, 0x43, 0x94, 0x2D, 0x9F,
+  0x37, 0xAB, 0x04, 0xC0, 0x6D, 0x33, 0x4F, 0xCB, 0x47, 0x9D, 0x83, 0xB2, 0x99, 0xF5, 0x29, 0xD4,
+  0x0E, 0xB0, 0x1D, 0x93, 0x73, 0x41, 0x16, 0x8A, 0x53, 0x4E, 0xFB, 0xE4, 0x2A, 0x44, 0xE9, 0xF4,
+  0x11, 0x84, 0x26, 0x19, 0x8D, 0x09, 0x2C, 0x1C, 0x91, 0x78, 0xE8, 0x5A, 0x57, 0xB6, 0x09, 0x8E,
+  0x5F, 0x78, 0x8D, 0xC6, 0xB5, 0xFE, 0xB7, 0xD6, 0xBF, 0x5C, 0x9C, 0xCA, 0x43, 0x6D, 0x46, 0x7B,
+  0x96, 0x7E, 0xF1, 0xE8, 0xFC, 0xFC, 0xC3, 0x79, 0x6D, 0x3E, 0x2D, 0x04, 0xEC, 0xE0, 0x0B, 0x1F,
+  0x4B, 0xCD, 0xE4, 0xDC, 0x82, 0x35, 0xC7, 0x4F, 0x31, 0xB6, 0x8D, 0xB5, 0xCA, 0xF5, 0x6E, 0xDF,
+  0xD2, 0x58, 0x53, 0x3E, 0xFA, 0xC9, 0x43, 0xA9, 0x7E, 0x32, 0xA2, 0x79, 0x75, 0x35, 0xA7, 0xA5,
+  0xAD, 0xB1, 0x75, 0xF2, 0xE0, 0xE3, 0xF9, 0xF9, 0xD1, 0xE9, 0x85, 0xAD, 0x9B, 0xB9, 0x3D, 0x94,
+  0x74, 0xA0, 0x9A, 0x9D, 0x4E, 0x50, 0xD7, 0xB9, 0x4E, 0xFC, 0xF4, 0x7D, 0x53, 0x55, 0xB8, 0x89,
+  0xC7, 0x34, 0x7F, 0x59, 0x04, 0x17, 0x10, 0x7A, 0xCB, 0xCF, 0x65, 0x34, 0x3E, 0x6C, 0x17, 0x02,
+  0xB2, 0x53, 0xA3, 0x67, 0xEA, 0x46, 0xE8, 0x67, 0x79, 0x5B, 0x15, 0xBB, 0x1C, 0xEA, 0x8D, 0x14,
+  0x69, 0x14, 0xD9, 0xFB, 0x6C, 0xAC, 0x33, 0xFC, 0xE8, 0xE6, 0x84, 0x7E, 0xC2, 0xB5, 0xF4, 0xFB,
+  0x8F, 0xAF, 0x75, 0x81, 0xAE, 0x34, 0xDD, 0x33, 0xD2, 0x9D, 0x1D, 0x0A, 0xE8, 0xFF, 0x5B, 0x91,
+  0xFF, 0x1B, 0x5D, 0x2D, 0xD7, 0x4A, 0xF7, 0xFE, 0x58, 0xC6, 0xF5, 0x65, 0xDC, 0xB2, 0x54, 0xEA,
+  0xA2, 0xF9, 0xD8, 0x0B, 0xA5, 0x8E, 0xCD, 0xBA, 0x4C, 0x1A, 0x04, 0xD9, 0x16, 0xC9, 0x21, 0x87,
+  0xAB, 0x4E, 0x29, 0x25, 0x96, 0x49, 0x5E, 0x04, 0x40, 0x85, 0xD9, 0xAD, 0xE5, 0x3E, 0xE8, 0x60,
+  0x25, 0xA5, 0x69, 0x55, 0xC5, 0x12, 0x5A, 0x76, 0x8D, 0x79, 0xA4, 0xA9, 0x55, 0xA6, 0xD3, 0x99,
+  0x36, 0x90, 0x6C, 0xD0, 0xA5, 0x5E, 0x7B, 0x5F, 0x45, 0xDF, 0xF6, 0x04, 0xB1, 0x23, 0xB1, 0x8B,
+  0xD7, 0x0C, 0x84, 0xF7, 0x49, 0x7A, 0x45, 0xAC, 0x86, 0x46, 0x1E, 0x9F, 0xAA, 0x4F, 0x4F, 0x03,
+  0x0B, 0x77, 0x87, 0x99, 0xAF, 0x1A, 0x54, 0xD5, 0xD1, 0x06, 0x30, 0xC5, 0x35, 0x6F, 0xA2, 0xD9,
+  0xC9, 0xB8, 0xD4, 0x8C, 0xC7, 0x52, 0xB4, 0x90, 0xA0, 0xB7, 0xDE, 0x2D, 0xF5, 0x89, 0xC3, 0x9E,
+  0xEA, 0xAC, 0x63, 0x24, 0x6D, 0xC8, 0x5E, 0x88, 0x88, 0xC3, 0x07, 0x5C, 0x89, 0xE4, 0xDB, 0xF4,
+  0x3C, 0x04, 0xE8, 0x61, 0xC2, 0x03, 0x8C, 0xC5, 0xFE, 0x49, 0x7F, 0xB1, 0x9A, 0x78, 0x3E, 0x39,
+  0x3C, 0x6C, 0xBB, 0xF2, 0x47, 0x3E, 0xDC, 0x9C, 0x0C, 0x43, 0xF6, 0x9D, 0x7B, 0xC4, 0x79, 0xE4,
+  0x03, 0x2A, 0x7D, 0x2F, 0x9A, 0x79, 0x30, 0x9A, 0xCC, 0xF9, 0xD6, 0xBD, 0xFA, 0x06, 0x6E, 0x74,
+  0xA3, 0x5C, 0x7A, 0x4E, 0xD4, 0x23, 0x46, 0x49, 0x5B, 0xBE, 0xBB, 0x74, 0xE0, 0x8D, 0x9D, 0x91,
+  0xA5, 0x84, 0xAB, 0xAA, 0x0F, 0xD7, 0xEF, 0x29, 0x7B, 0x4A, 0xC3, 0x3C, 0x9B, 0xB3, 0xBD, 0x39,
+  0xCF, 0x73, 0x4F, 0xE3, 0x25, 0x5A, 0x14, 0x2F, 0x72, 0x77, 0xE3, 0xB0, 0xE5, 0x6A, 0xC8, 0x18,
+  0x0F, 0x3C, 0x9E, 0x46, 0x89, 0x56, 0x1E, 0x38, 0x3E, 0xA1, 0xC8, 0x10, 0xA6, 0x32, 0x3D, 0x1F,
+  0x06, 0x1F, 0xF4, 0x1C, 0x5E, 0x8C, 0x8E, 0x44, 0x95, 0x3D, 0xC2, 0xBF, 0xF1, 0x5A, 0xF8, 0xD6,
+  0x4C, 0xE0, 0x8F, 0x1E, 0xC4, 0x29, 0x5E, 0xD4, 0x22, 0xAB, 0x2D, 0x0C, 0x91, 0x6C, 0xB1, 0x61,
+  0x6A, 0xEB, 0x27, 0x55, 0xEA, 0xD3, 0x83, 0x92, 0xF1, 0xA6, 0xEA, 0xD5, 0x6F, 0x80, 0x46, 0xAE,
+  0x37, 0xF4, 0xE2, 0x74, 0x98, 0x40, 0xBB, 0x66, 0x1E, 0x3E, 0xC5, 0x8A, 0x3A, 0xBB, 0xD8, 0x42,
+  0x6E, 0xE5, 0xD3, 0xCA, 0x4A, 0x51, 0xBE, 0x42, 0x15, 0x0D, 0x42, 0xA9, 0xAF, 0xD6, 0x9B, 0xE9,
+  0xC0, 0xC1, 0x16, 0x1E, 0xBB, 0x3F, 0x1A, 0x91, 0x61, 0x10, 0xB8, 0x15, 0x5A, 0x13, 0x68, 0x9D,
+  0x8E, 0xEF, 0xCC, 0xCD, 0xDB, 0x88, 0x5C, 0xE9, 0x57, 0x11, 0x00, 0xE9, 0x4F, 0x98, 0xF3, 0x99,
+  0x79, 0x76, 0x8A, 0xCB, 0x36, 0x2A, 0x20, 0x3E, 0x18, 0x2D, 0x10, 0x69, 0x43, 0xCF, 0xEE, 0xC4,
+  0xEB, 0x47, 0x46, 0x60, 0xB6, 0xA3, 0xF0, 0x4C, 0x82, 0x28, 0xF2, 0x30, 0x2C, 0x8F, 0x4B, 0x03,
+  0xCE, 0x4F, 0x29, 0x27, 0xE9, 0x54, 0x4C, 0x3F, 0x9C, 0x9C, 0xB4, 0xC7, 0xFC, 0x27, 0xFD, 0x46,
+  0x6C, 0x1F, 0x57, 0x6D, 0x1F, 0x4F, 0x4E, 0xFA, 0xFD, 0x76, 0xC4, 0x7E, 0xB4, 0xE6, 0xC4, 0xF2,
+  0x19, 0x00, 0xAC, 0xA6, 0x9F, 0x9F, 0x59, 0xE5, 0x84, 0x5D, 0x36, 0x5A, 0x9C, 0x73, 0xFF, 0x07,
+  0xE3, 0x59, 0xFD, 0xA0, 0x4D, 0x36, 0x60, 0x96, 0xBD, 0xEC, 0xAC, 0xAF, 0x6F, 0x3C, 0xEF, 0xE0,
+  0xF4, 0x62, 0xFC, 0x6B, 0xA7, 0xC1, 0xB4, 0xE9, 0x4C, 0xDF, 0x25, 0xBD, 0x65, 0x20, 0xFE, 0x80,
+  0xF3, 0xAE, 0xC3, 0xD2, 0x19, 0xC0, 0x0C, 0xEB, 0xE1, 0x0B, 0xA0, 0xC1, 0x1D, 0x3E, 0x7C, 0xBA,
+  0xD1, 0x21, 0x9D, 0x4D, 0xD2, 0xDB, 0x6C, 0xF7, 0x3A, 0x1B, 0x2F, 0x2D, 0xA4, 0xA4, 0xBA, 0x68,
+  0x97, 0xAC, 0x2F, 0x99, 0x92, 0x1E, 0x23, 0x66, 0x3D, 0x25, 0x66, 0xB5, 0xDB, 0xD9, 0x5C, 0xED,
+  0x76, 0x57, 0x3B, 0x9B, 0xED, 0xEE, 0x56, 0xCF, 0x46, 0x8E, 0x5D, 0xA3, 0xED, 0x62, 0x3C, 0xFA,
+  0x92, 0x48, 0x7B, 0x8E, 0x34, 0x5D, 0xD3, 0x3B, 0x1A, 0x72, 0x7A, 0xBA, 0x5D, 0xA4, 0xE6, 0xC5,
+  0x8B, 0x97, 0x2F, 0x7B, 0xA4, 0x71, 0xC8, 0x25, 0x0B, 0xAB, 0xF0, 0xDF, 0x9A, 0x09, 0x8D, 0x52,
+  0xDA, 0x35, 0x8B, 0x2C, 0x99, 0xA8, 0xDC, 0x14, 0x4B, 0x97, 0x90, 0x6D, 0x5B, 0x6D, 0x55, 0xE2,
+  0x78, 0x03, 0xF5, 0x8B, 0xBD, 0x4D, 0x2A, 0x2A, 0xC2, 0xDA, 0x4B, 0xFE, 0xCE, 0xC1, 0x21, 0xC7,
+  0x53, 0x20, 0x90, 0x7F, 0xDA, 0x6B, 0x5B, 0xD9, 0xCD, 0x5B, 0x5A, 0x8B, 0x54, 0x6B, 0xDE, 0xA7,
+  0x43, 0x07, 0x73, 0x20, 0xF7, 0xBD, 0xA1, 0xAF, 0x1B, 0x4F, 0xBA, 0x0A, 0xEB, 0xA4, 0xFA, 0x33,
+  0x55, 0xD6, 0x49, 0x31, 0x37, 0x3B, 0x31, 0x14, 0x7E, 0x4F, 0xD1, 0xED, 0x2D, 0x94, 0xA0, 0x3A,
+  0x7F, 0xD2, 0xF6, 0x9C, 0xC5, 0xCB, 0x03, 0x3D, 0x8C, 0x0E, 0x32, 0xF6, 0xFC, 0x69, 0x94, 0xDE,
+  0x8E, 0xD1, 0x89, 0xD0, 0xEF, 0xF4, 0x26, 0x9D, 0x5F, 0x5D, 0x45, 0x40, 0x1F, 0x41, 0x39, 0xA6,
+  0xE2, 0x0E, 0x8B, 0x15, 0x9A, 0x0C, 0x9E, 0xCF, 0x93, 0xED, 0xB2, 0x12, 0xCA, 0x17, 0xB0, 0x16,
+  0xF3, 0x40, 0xB0, 0x94, 0x12, 0x02, 0xA9, 0x44, 0x43, 0x22, 0xC0, 0x63, 0x7A, 0xE3, 0xD4, 0x75,
+  0x1B, 0x96, 0x1B, 0xF4, 0x34, 0x2B, 0x2B, 0xBC, 0xF8, 0x92, 0x23, 0xD9, 0x50, 0xFC, 0x1C, 0xA3,
+  0x4B, 0x73, 0x4B, 0xB7, 0x60, 0x8D, 0x5B, 0x5B, 0xCB, 0x2A, 0x3C, 0xF5, 0xE9, 0xB2, 0xF9, 0x4D,
+  0x14, 0x0E, 0x57, 0x09, 0x25, 0xE0, 0x69, 0x33, 0xD8, 0x49, 0x11, 0xBF, 0x70, 0xC3, 0x4E, 0x52,
+  0x81, 0xAD, 0xFE, 0x40, 0xDE, 0x64, 0x4E, 0x85, 0x9C, 0x0D, 0x0F, 0xD8, 0xDC, 0x44, 0x4C, 0x1B,
+  0x0D, 0x8A, 0x10, 0x6D, 0x1D, 0x84, 0x02, 0x9A, 0x5F, 0x61, 0xEE, 0xA8, 0x30, 0xD2, 0xF5, 0x3E,
+  0xAD, 0xB6, 0xBA, 0x93, 0x68, 0x6A, 0x7E, 0x64, 0xAC, 0x5D, 0x7B, 0x66, 0x4F, 0x12, 0x83, 0x40,
+  0xC4, 0x34, 0x2A, 0x46, 0x94, 0xA0, 0x39, 0x39, 0x51, 0x23, 0x49, 0xDF, 0x78, 0x60, 0x99, 0xC0,
+  0xEA, 0xAA, 0x59, 0x1A, 0xA9, 0x3D, 0xC2, 0xAE, 0x01, 0x7D, 0xB8, 0x6E, 0xB0, 0xF5, 0x17, 0x06,
+  0x63, 0xB5, 0x6B, 0xBA, 0xF3, 0x17, 0x65, 0xFD, 0xE5, 0xE9, 0x87, 0xCB, 0xC3, 0xA3, 0x83, 0xE3,
+  0x93, 0xBD, 0xF7, 0xC6, 0x28, 0x44, 0x14, 0x66, 0xAA, 0x8B, 0xDD, 0x4A, 0xE8, 0x31, 0xD8, 0xAD,
+  0x8A, 0x03, 0xDF, 0x53, 0xF2, 0x16, 0x56, 0x96, 0xA5, 0x13, 0x49, 0x65, 0xB4, 0xDA, 0x44, 0xF2,
+  0xF1, 0xCF, 0x09, 0xBF, 0x44, 0x03, 0x60, 0x99, 0x72, 0x71, 0xD0, 0x62, 0x51, 0x4A, 0x64, 0x2B,
+  0x29, 0x90, 0x35, 0xB2, 0x05, 0x2B, 0x20, 0xBB, 0x00, 0x2F, 0x71, 0xAC, 0x91, 0xF5, 0x2D, 0xCC,
+  0xFE, 0xD2, 0x34, 0xEE, 0x6E, 0x2B, 0x33, 0xB8, 0x69, 0x45, 0xF0, 0x67, 0x64, 0xBC, 0x75, 0x4B,
+  0xB8, 0xE0, 0xCC, 0xDB, 0x2C, 0x9C, 0x79, 0x1B, 0xC9, 0xCC, 0xD3, 0xCC, 0x8F, 0xE5, 0x4D, 0xBC,
+  0x8A, 0xD3, 0x4E, 0x59, 0x54, 0xD4, 0xF1, 0xCF, 0x99, 0x6C, 0xA6, 0xE0, 0xCF, 0x3A, 0xBD, 0x72,
+  0x27, 0x97, 0x5D, 0x0A, 0x35, 0xD6, 0xB0, 0x50, 0x50, 0xD1, 0xC0, 0x02, 0xD8, 0x2E, 0x82, 0xB3,
+  0x8A, 0xD4, 0x5C, 0xD2, 0xD3, 0xEE, 0x68, 0x1E, 0xB2, 0x44, 0x80, 0x34, 0x69, 0xE9, 0xF2, 0xF1,
+  0x5E, 0x7D, 0xA4, 0x01, 0xBF, 0x3C, 0x39, 0xB9, 0x3C, 0xDC, 0xEB, 0xBF, 0x33, 0x86, 0x5D, 0x84,
+  0x38, 0xA5, 0x4A, 0x47, 0xDC, 0x33, 0x59, 0x35, 0x6F, 0xF5, 0xA5, 0x63, 0x2C, 0x14, 0x31, 0xB6,
+  0xC4, 0x6C, 0x41, 0xE9, 0x80, 0xE4, 0x0C, 0x9D, 0x5A, 0xBF, 0xFB, 0x45, 0x51, 0x85, 0x99, 0xD1,
+  0x7B, 0xE2, 0xC1, 0xC8, 0x1F, 0x8B, 0x5E, 0x32, 0x16, 0xD2, 0x74, 0x5F, 0xFA, 0x58, 0x80, 0xF2,
+  0xFD, 0xC1, 0x86, 0xE3, 0x87, 0x59, 0x99, 0x14, 0xF6, 0x54, 0x59, 0xA0, 0xD4, 0x0E, 0xF5, 0xD2,
+  0x0E, 0x65, 0x57, 0xA8, 0xEF, 0xB7, 0x7C, 0xE4, 0xC8, 0x9C, 0xB1, 0x80, 0x70, 0xA1, 0x4B, 0xBD,
+  0x46, 0x4B, 0x95, 0xB9, 0xED, 0x12, 0x36, 0xA4, 0x0A, 0xF6, 0xD1, 0x3A, 0x28, 0x34, 0x1C, 0x79,
+  0x3C, 0x0D, 0x57, 0x71, 0x36, 0x91, 0xFF, 0xDF, 0x94, 0x9B, 0x3E, 0x0E, 0xBD, 0x64, 0x1C, 0xC8,
+  0xE3, 0x58, 0xF5, 0x7C, 0x02, 0xFF, 0x40, 0x83, 0xF1, 0xA3, 0xA9, 0xB6, 0x7F, 0x35, 0xAD, 0x66,
+  0xDB, 0xDC, 0x5B, 0x9A, 0xF1, 0xAD, 0xBD, 0xE8, 0x99, 0xA5, 0xBC, 0x99, 0x64, 0x8A, 0x7A, 0xD9,
+  0xB4, 0x7B, 0x0C, 0xF0, 0xA5, 0x6F, 0x76, 0xA5, 0x04, 0xFD, 0x7B, 0x1C, 0xDC, 0x24, 0x04, 0x83,
+  0x12, 0xCF, 0x50, 0x52, 0x5F, 0xBA, 0x65, 0x8C, 0x9A, 0xC6, 0xD5, 0x73, 0x5B, 0x95, 0x6D, 0xFD,
+  0x14, 0x40, 0x71, 0xE7, 0xA3, 0x07, 0x39, 0xBD, 0xA2, 0xDD, 0x22, 0xC1, 0x34, 0xC6, 0x3F, 0x1C,
+  0x71, 0x44, 0x00, 0x8D, 0xFA, 0x81, 0xEE, 0xF0, 0x47, 0xEF, 0xF5, 0x15, 0x70, 0x79, 0x4C, 0x49,
+  0xDD, 0x98, 0x6A, 0xF5, 0x16, 0xA1, 0xF1, 0x40, 0x7B, 0xDA, 0x1C, 0x19, 0xC1, 0xE8, 0x50, 0xE8,
+  0x6A, 0xD9, 0x44, 0xCD, 0x7E, 0x38, 0x20, 0x3C, 0xA6, 0xCA, 0xA9, 0x26, 0xBF, 0xA6, 0x60, 0x91,
+  0xD4, 0xEA, 0xA2, 0xDA, 0xB4, 0xAA, 0x83, 0x54, 0x32, 0x07, 0xD6, 0x61, 0x33, 0x8F, 0x86, 0x55,
+  0x32, 0xEC, 0x07, 0x6B, 0x0B, 0x92, 0x79, 0xA9, 0xEC, 0x45, 0x60, 0x3F, 0xB5, 0x20, 0xB4, 0xA5,
+  0x02, 0x93, 0x26, 0xF7, 0x92, 0x41, 0xF6, 0x3F, 0x9F, 0xEC, 0x7F, 0xE0, 0x77, 0x6F, 0xCD, 0xFB,
+  0x1F, 0xA3, 0xC0, 0x1F, 0xB2, 0x2C, 0x3F, 0x87, 0x74, 0x18, 0x52, 0xD3, 0x2B, 0x91, 0x19, 0x09,
+  0x63, 0x68, 0x61, 0xD3, 0x64, 0x02, 0xB0, 0xD6, 0x83, 0xC9, 0xBF, 0xD5, 0xD9, 0x36, 0xB2, 0x28,
+  0x26, 0xA5, 0xAF, 0x49, 0xAE, 0xC6, 0x94, 0x7B, 0x69, 0xBB, 0x5C, 0xA5, 0x7F, 0x24, 0xF2, 0xF4,
+  0xBC, 0x99, 0xC9, 0xD6, 0xB8, 0xE0, 0xF0, 0xE6, 0x91, 0x96, 0x4C, 0xA1, 0x0C, 0x0B, 0x57, 0x60,
+  0x56, 0xE1, 0xC1, 0x7A, 0x52, 0x75, 0x3B, 0x7B, 0x62, 0xB2, 0x24, 0x41, 0x99, 0x8B, 0xB8, 0xD5,
+  0xA7, 0xA0, 0x8E, 0xCB, 0xDC, 0x5C, 0xF4, 0xFD, 0xCF, 0x7F, 0xEB, 0x04, 0xE2, 0xB7, 0x7A, 0x4D,
+  0x27, 0x73, 0x1E, 0xB8, 0xC4, 0xD6, 0xEF, 0xA5, 0xEB, 0x96, 0x4B, 0xC5, 0xAF, 0xB8, 0x0C, 0xF5,
+  0xB2, 0x54, 0x70, 0xCA, 0x46, 0x69, 0xF9, 0x50, 0x15, 0x35, 0xB3, 0xBC, 0xCE, 0x2B, 0x96, 0xCF,
+  0xF2, 0x29, 0x7E, 0x4C, 0xD8, 0xC6, 0x66, 0xF4, 0x5F, 0x42, 0xFB, 0x6A, 0x34, 0x9F, 0xD8, 0xFC,
+  0xD8, 0xB3, 0xD0, 0x2C, 0x00, 0x14, 0xD1, 0x5C, 0x59, 0xEF, 0x6F, 0x2D, 0x5D, 0xEF, 0xF7, 0xFB,
+  0x73, 0x6B, 0xFE, 0x0C, 0x8B, 0x9E, 0x68, 0x45, 0x10, 0x52, 0x37, 0xFF, 0xA2, 0x60, 0x23, 0x7C,
+  0xF5, 0x89, 0x28, 0x5F, 0x78, 0xC1, 0xB0, 0x11, 0x5F, 0xCF, 0xAE, 0x24, 0x7F, 0xAD, 0xD5, 0x1E,
+  0xAB, 0x0F, 0xCD, 0xB9, 0x57, 0x25, 0x1B, 0xED, 0xE4, 0xB1, 0x19, 0x6F, 0xA8, 0xD7, 0xA5, 0x8B,
+  0xBB, 0x72, 0xA9, 0xD1, 0xAA, 0x16, 0x96, 0x2C, 0x40, 0x0B, 0xF6, 0xA4, 0x78, 0x1C, 0x9E, 0xB8,
+  0x2F, 0xC6, 0xE2, 0xF1, 0x08, 0x33, 0xBA, 0xA8, 0x43, 0x99, 0x8B, 0x3E, 0x3A, 0x3E, 0x23, 0xAE,
+  0x52, 0x06, 0x3A, 0x0D, 0x60, 0x75, 0x93, 0x6D, 0xD6, 0xFE, 0xEA, 0xAE, 0xB5, 0x63, 0xBC, 0xB4,
+  0x3C, 0x68, 0x6E, 0x13, 0x3D, 0xA9, 0x82, 0x3C, 0x3C, 0x87, 0x9D, 0x70, 0x8B, 0x27, 0x2E, 0x84,
+  0x8D, 0xEB, 0x4D, 0xA8, 0x06, 0x62, 0xF2, 0xAC, 0x8B, 0xBB, 0xB8, 0x59, 0x96, 0x57, 0x93, 0x56,
+  0x95, 0x80, 0x17, 0xF8, 0xAC, 0xED, 0xCD, 0xB1, 0x9A, 0x96, 0x2F, 0x50, 0xE4, 0x64, 0x5C, 0x41,
+  0xB8, 0x18, 0x83, 0xA0, 0x95, 0x73, 0xE0, 0x2B, 0x2C, 0xCF, 0xBA, 0xBA, 0x7D, 0xF7, 0xB5, 0x0D,
+  0xBB, 0x00, 0xED, 0xA4, 0xDE, 0x02, 0xB9, 0x75, 0x57, 0x6E, 0x16, 0x57, 0xF2, 0x23, 0xC8, 0xAC,
+  0x02, 0x77, 0xF8, 0x74, 0x20, 0x29, 0xAA, 0xC2, 0x62, 0x00, 0xF8, 0x3B, 0xF4, 0xAF, 0x2C, 0x19,
+  0x9A, 0x48, 0xA3, 0xF6, 0xD1, 0xFF, 0xEA, 0x5B, 0x9E, 0x39, 0x37, 0x1E, 0x26, 0x18, 0xE0, 0x15,
+  0xDF, 0x46, 0xE5, 0x6D, 0x7B, 0x0E, 0x2E, 0xD5, 0x3B, 0xB1, 0x54, 0x84, 0xB0, 0xA7, 0xCA, 0x45,
+  0x99, 0xBA, 0x41, 0x97, 0x8A, 0xF2, 0xB2, 0x08, 0x27, 0x79, 0x3C, 0xA4, 0x7C, 0x3D, 0xCE, 0xC5,
+  0xBC, 0xFA, 0x48, 0x98, 0x99, 0xF5, 0x52, 0xC0, 0xE3, 0xC4, 0xB3, 0xB4, 0xF4, 0xFE, 0x16, 0xE1,
+  0xD5, 0x7C, 0x5A, 0x8F, 0x80, 0xB9, 0x9C, 0xD9, 0xAB, 0x8F, 0x83, 0xDE, 0x5C, 0x48, 0x0B, 0x39,
+  0xFF, 0x18, 0x1D, 0xAF, 0x82, 0x9B, 0x73, 0xFF, 0xB1, 0xD8, 0x5E, 0x89, 0x04, 0x3E, 0x02, 0x05,
+  0x24, 0x7C, 0x7B, 0x96, 0xA7, 0xED, 0xBE, 0x3D, 0xFB, 0x7F, 0x63, 0xF6, 0xD5, 0x49, 0x1E, 0x2B,
+  0x00
 }; ///main_js
 
 //To convert AP-Config\index.html to index_html[], run the Python index_html_zipper.py script in the Tools folder:
@@ -823,913 +855,944 @@ static const uint8_t main_js[] PROGMEM = {
 //  python index_html_zipper.py
 
 static const uint8_t index_html[] PROGMEM = {
-  0x1F, 0x8B, 0x08, 0x08, 0x78, 0xBF, 0xE6, 0x68, 0x02, 0xFF, 0x69, 0x6E, 0x64, 0x65, 0x78, 0x2E,
+  0x1F, 0x8B, 0x08, 0x08, 0x47, 0xCA, 0xD3, 0x6A, 0x02, 0xFF, 0x69, 0x6E, 0x64, 0x65, 0x78, 0x2E,
   0x68, 0x74, 0x6D, 0x6C, 0x2E, 0x67, 0x7A, 0x69, 0x70, 0x00, 0xED, 0x7D, 0xDB, 0x72, 0xDB, 0xC8,
-  0x92, 0xE0, 0xBB, 0xBF, 0xA2, 0x86, 0xB3, 0x33, 0x96, 0xE7, 0x88, 0x14, 0x49, 0x5D, 0x2C, 0xEB,
-  0xD8, 0x8C, 0xD0, 0xD5, 0x56, 0x1C, 0x49, 0xE6, 0x8A, 0xF2, 0x71, 0x77, 0x6F, 0xEC, 0x76, 0x80,
+  0x92, 0xE0, 0xBB, 0xBF, 0xA2, 0x86, 0x67, 0x67, 0x2C, 0xCF, 0x88, 0x14, 0x49, 0x5D, 0x6C, 0xEB,
+  0xD8, 0x8A, 0xD0, 0xD5, 0x56, 0x1C, 0xC9, 0xE6, 0x8A, 0xF2, 0x71, 0x77, 0x6F, 0xEC, 0x76, 0x80,
   0x40, 0x91, 0xC4, 0x31, 0x08, 0xA0, 0x81, 0x82, 0x2E, 0x3D, 0x31, 0x13, 0xE7, 0x33, 0x66, 0x3E,
-  0x64, 0x7F, 0x60, 0x3F, 0xE5, 0x7C, 0xC9, 0x66, 0x66, 0x15, 0x40, 0x00, 0x04, 0x49, 0x00, 0xE2,
-  0x55, 0x2D, 0x77, 0xB4, 0x24, 0x82, 0xA8, 0x5B, 0x56, 0x66, 0x56, 0x66, 0x56, 0x5E, 0x3E, 0xFE,
-  0xD3, 0xD9, 0xD7, 0xD3, 0xBB, 0x9F, 0xDB, 0xE7, 0x6C, 0x20, 0x86, 0x56, 0xEB, 0xCD, 0x47, 0xFC,
-  0xC5, 0x2C, 0xCD, 0xEE, 0x7F, 0xAA, 0x70, 0xBB, 0xD2, 0x7A, 0x03, 0x4F, 0xB8, 0x66, 0xB4, 0xDE,
-  0x30, 0xF8, 0xF7, 0x71, 0xC8, 0x85, 0xC6, 0xF4, 0x81, 0xE6, 0xF9, 0x5C, 0x7C, 0xAA, 0x04, 0xA2,
-  0x57, 0x3D, 0xAC, 0xB0, 0x9D, 0xF8, 0x97, 0x03, 0x21, 0xDC, 0x2A, 0xFF, 0x2D, 0x30, 0xEF, 0x3F,
-  0x55, 0x7E, 0xAA, 0x7E, 0x3B, 0xAE, 0x9E, 0x3A, 0x43, 0x57, 0x13, 0x66, 0xD7, 0xE2, 0x15, 0xA6,
-  0x3B, 0xB6, 0xE0, 0x36, 0xB4, 0xBC, 0x3C, 0xFF, 0xC4, 0x8D, 0x3E, 0xDF, 0xD6, 0x07, 0x9E, 0x33,
-  0xE4, 0x9F, 0x1A, 0xA3, 0x4E, 0x84, 0x29, 0x2C, 0xDE, 0xEA, 0xB8, 0x9A, 0xF7, 0xE3, 0x22, 0xB0,
-  0xD9, 0xED, 0xDD, 0x5F, 0x58, 0x87, 0x8B, 0xC0, 0xFD, 0xB8, 0x23, 0xBF, 0x89, 0x0D, 0x65, 0x6B,
-  0xD0, 0xB4, 0x72, 0x6F, 0xF2, 0x07, 0xD7, 0xF1, 0x44, 0x85, 0xBE, 0xC1, 0x7F, 0xD1, 0x28, 0x0F,
-  0xA6, 0x21, 0x06, 0x9F, 0x0C, 0x7E, 0x6F, 0xEA, 0xBC, 0x4A, 0x1F, 0xB6, 0x99, 0x69, 0x9B, 0xC2,
-  0xD4, 0xAC, 0xAA, 0xAF, 0x6B, 0x16, 0x0C, 0xBC, 0xCD, 0x86, 0xDA, 0xA3, 0x39, 0x0C, 0x86, 0xA3,
-  0x07, 0x81, 0xCF, 0x3D, 0xFA, 0xA4, 0xC1, 0x9C, 0x3F, 0xD5, 0xB7, 0x99, 0x3F, 0xF0, 0x4C, 0xFB,
-  0x47, 0x55, 0x38, 0xD5, 0x9E, 0x29, 0x3E, 0x3D, 0x71, 0x7F, 0x34, 0x5B, 0x0B, 0xBE, 0x60, 0x1E,
-  0xB7, 0x3E, 0x55, 0x7C, 0xF1, 0x64, 0x71, 0x7F, 0xC0, 0xB9, 0xA8, 0xB0, 0x81, 0xC7, 0x7B, 0xF0,
-  0xC4, 0xD3, 0x77, 0xBA, 0x8E, 0x23, 0x7C, 0xE1, 0x69, 0x6E, 0x6D, 0x68, 0xDA, 0x35, 0xDD, 0xF7,
-  0x2B, 0x39, 0x1B, 0xD2, 0xD3, 0x78, 0x03, 0x5F, 0xF7, 0x4C, 0x57, 0x30, 0xF8, 0x4E, 0xBE, 0xF0,
-  0xB7, 0xDF, 0x02, 0xEE, 0x3D, 0x55, 0x77, 0x6B, 0x07, 0xB5, 0x3A, 0x75, 0xFE, 0x37, 0x78, 0xF5,
-  0xE3, 0x8E, 0x7C, 0x6D, 0x42, 0x9B, 0xE4, 0x6C, 0x0A, 0x35, 0xE8, 0x06, 0xB6, 0x01, 0x13, 0x1A,
-  0x6F, 0x17, 0x6F, 0xD8, 0x8A, 0xB6, 0xE0, 0x7F, 0x6C, 0x19, 0x8E, 0x1E, 0x0C, 0x61, 0x17, 0xDE,
-  0xD5, 0x1C, 0x7B, 0xEB, 0xAD, 0x6E, 0x99, 0xFA, 0x8F, 0xB7, 0xDB, 0xEC, 0x6D, 0x4D, 0x38, 0xFD,
-  0xBE, 0xC5, 0xAB, 0x5D, 0x61, 0xC3, 0xC7, 0x5E, 0x60, 0xEB, 0xC2, 0x74, 0x6C, 0xB6, 0xC5, 0xDF,
-  0xB1, 0x7F, 0x8F, 0x5A, 0xCB, 0x1E, 0x60, 0xF9, 0x81, 0xE7, 0x41, 0x17, 0x77, 0x9A, 0xD7, 0xE7,
-  0xA2, 0xA6, 0x0F, 0x4C, 0xCB, 0x80, 0xCF, 0xFF, 0xAB, 0xFE, 0xBF, 0xDF, 0xA9, 0x6E, 0x4E, 0x2D,
-  0xCD, 0xF7, 0xB7, 0xDE, 0x9A, 0xB0, 0xE3, 0x55, 0x5D, 0xF3, 0xB8, 0xA8, 0x1A, 0xCE, 0x83, 0xCD,
-  0x62, 0x9F, 0x03, 0xF7, 0xED, 0xBB, 0x3F, 0x47, 0x1D, 0xFF, 0xC7, 0x3B, 0x39, 0xDD, 0xF4, 0xEC,
-  0x11, 0xD8, 0xA3, 0xC9, 0xD7, 0x7C, 0x01, 0x08, 0xAB, 0x57, 0xFB, 0x9E, 0x13, 0xB8, 0xA9, 0x69,
-  0x0D, 0xB8, 0xD9, 0x1F, 0x88, 0x23, 0x56, 0xFF, 0x73, 0xE2, 0xB1, 0x73, 0xCF, 0xBD, 0x9E, 0xE5,
-  0x3C, 0x1C, 0xB1, 0x81, 0x69, 0x18, 0xDC, 0x4E, 0x7E, 0x0B, 0x10, 0xB4, 0x7D, 0x13, 0x17, 0x7A,
-  0xA4, 0x3A, 0x60, 0xF5, 0xDA, 0x9E, 0xCF, 0xB8, 0xE6, 0xF3, 0xE4, 0x9B, 0x5D, 0xC7, 0x33, 0x00,
-  0xFB, 0xBA, 0x8E, 0x10, 0xCE, 0xF0, 0x88, 0xF9, 0x8E, 0x65, 0x1A, 0xAC, 0xE1, 0x3E, 0xB2, 0x7F,
-  0xD6, 0xEB, 0xF8, 0x5F, 0x6C, 0x29, 0x6F, 0x46, 0xF3, 0xB5, 0x4C, 0x5F, 0xAC, 0xF7, 0x6C, 0xF1,
-  0x9F, 0xAB, 0x19, 0x86, 0x69, 0xF7, 0xAB, 0x9E, 0x9C, 0xD3, 0x7E, 0xDD, 0x7D, 0xCC, 0x5E, 0x8E,
-  0xEC, 0x16, 0x88, 0xC2, 0x67, 0xC2, 0xD8, 0xCE, 0x7E, 0x3E, 0x48, 0xAD, 0x54, 0x7E, 0x77, 0xC4,
-  0x6C, 0xC7, 0x4E, 0x4D, 0x72, 0x08, 0xD8, 0x63, 0xDA, 0x55, 0x8B, 0xF7, 0x10, 0x10, 0x13, 0xC6,
-  0xEC, 0x06, 0xB0, 0x04, 0xFB, 0xA8, 0x07, 0x48, 0xEB, 0xA7, 0x7A, 0x76, 0x02, 0x01, 0xC4, 0xCA,
-  0x13, 0x40, 0x8C, 0xCF, 0xD6, 0xB4, 0xF1, 0xEB, 0x73, 0xCF, 0x73, 0xBC, 0x54, 0x4B, 0xC3, 0xF4,
-  0x5D, 0x4B, 0x7B, 0x3A, 0x62, 0xF2, 0x95, 0xE4, 0xB4, 0x74, 0xC7, 0x72, 0x60, 0xBE, 0x1E, 0x37,
-  0x92, 0xCF, 0x7B, 0xC0, 0xBC, 0xAA, 0xBE, 0xF9, 0x3B, 0x0C, 0xE8, 0x0F, 0x35, 0xCB, 0xE2, 0xDE,
-  0xB4, 0x61, 0x3B, 0x81, 0xAE, 0x23, 0x3C, 0x8A, 0x0F, 0xDC, 0xF7, 0x78, 0x7A, 0xE3, 0xA7, 0x0D,
-  0x1D, 0x7D, 0xFF, 0xA0, 0x50, 0xAA, 0xEB, 0x58, 0xC6, 0xA4, 0xED, 0x7B, 0xAC, 0x52, 0xFB, 0xD4,
-  0xAC, 0x26, 0x6F, 0x04, 0xFE, 0x23, 0xF6, 0x7C, 0xC4, 0x76, 0xEB, 0xFF, 0x32, 0xB9, 0x57, 0xD9,
-  0x43, 0xB3, 0x3E, 0xAD, 0xE3, 0xE6, 0x14, 0xB4, 0x0A, 0x7B, 0xD8, 0x9B, 0xDA, 0xC3, 0xDE, 0xE4,
-  0x1E, 0x34, 0x21, 0x80, 0xE9, 0xA6, 0x1A, 0xBB, 0x4E, 0x48, 0x2D, 0x5A, 0x17, 0x48, 0x20, 0x10,
-  0x29, 0x80, 0xFF, 0x5E, 0x35, 0x6D, 0x83, 0x3F, 0x1E, 0xB1, 0x46, 0xBD, 0x9E, 0x22, 0x09, 0x45,
-  0x0A, 0x8D, 0x31, 0x68, 0xC0, 0xA1, 0x54, 0x55, 0x10, 0x39, 0xA8, 0x67, 0x7C, 0x4B, 0xD3, 0x15,
-  0x8E, 0x0B, 0x64, 0x94, 0x9C, 0xAC, 0x62, 0x6F, 0x92, 0xA1, 0x7D, 0xDC, 0x91, 0x47, 0xF7, 0x9B,
-  0x8F, 0x5D, 0xC7, 0x78, 0x52, 0x3C, 0xDE, 0x30, 0xEF, 0x99, 0x8E, 0x7C, 0xF3, 0x53, 0x05, 0x0F,
-  0x4A, 0x0D, 0x10, 0xC4, 0xAB, 0x30, 0xD3, 0xF8, 0x54, 0x51, 0xCB, 0xBB, 0x84, 0xC7, 0x95, 0x11,
-  0x37, 0xA4, 0x06, 0x9A, 0x65, 0xF6, 0xED, 0x4F, 0x15, 0x9A, 0x6F, 0x25, 0x6C, 0xAE, 0xDE, 0x8F,
-  0xBD, 0x4B, 0xEF, 0x9B, 0xC3, 0x7E, 0xBA, 0xBB, 0x0B, 0xD3, 0xE2, 0x37, 0x70, 0x5A, 0x57, 0x46,
-  0x47, 0xCB, 0x89, 0xFC, 0xB6, 0xF9, 0xEB, 0xE9, 0x80, 0x56, 0xD3, 0xAF, 0xB9, 0x76, 0xBF, 0x02,
-  0x03, 0xC1, 0xB9, 0xAD, 0xBE, 0x63, 0x16, 0xBF, 0xE7, 0x56, 0xA5, 0x05, 0x0C, 0xDA, 0xD5, 0xEC,
-  0x78, 0x9F, 0x6D, 0xEE, 0xE9, 0x70, 0x30, 0x54, 0x12, 0x03, 0x13, 0x72, 0xCB, 0x99, 0x11, 0xFA,
-  0xC1, 0x60, 0x08, 0x86, 0x4F, 0x95, 0x90, 0x1C, 0x14, 0x35, 0x54, 0x5A, 0x7F, 0x3A, 0x78, 0x0F,
-  0x30, 0x82, 0x3E, 0x63, 0xAB, 0xDC, 0x81, 0x65, 0x2A, 0x08, 0xC9, 0x3F, 0xA7, 0x41, 0x2B, 0xD5,
-  0x31, 0x31, 0x9D, 0xF8, 0xAE, 0x10, 0x12, 0x8E, 0xF6, 0x50, 0x6E, 0xA1, 0x04, 0xB2, 0xC7, 0x41,
-  0x74, 0xBA, 0xB4, 0xDB, 0x9E, 0x83, 0x84, 0x1B, 0x87, 0x73, 0xB7, 0x75, 0x8B, 0xDF, 0x09, 0x80,
-  0xC5, 0xC7, 0x9D, 0x6E, 0xEB, 0x63, 0xD7, 0xA3, 0xFF, 0x51, 0x02, 0x92, 0x22, 0x0C, 0x33, 0x7D,
-  0xE0, 0x17, 0x78, 0x26, 0x23, 0xB8, 0x58, 0xDB, 0x42, 0x8E, 0xCC, 0x1E, 0x34, 0x53, 0xD4, 0x6A,
-  0xB5, 0x65, 0x4D, 0x1D, 0xC5, 0x39, 0x8B, 0x0B, 0x9E, 0x31, 0x73, 0x76, 0x06, 0x9D, 0x4D, 0x98,
-  0xFA, 0x40, 0xF3, 0x81, 0x37, 0x3F, 0x30, 0xEA, 0x63, 0x19, 0x93, 0xED, 0x99, 0xDE, 0xF0, 0x01,
-  0x44, 0x80, 0x6F, 0xAE, 0xE5, 0x68, 0x46, 0xF6, 0xAC, 0xD3, 0xF3, 0xBD, 0x50, 0x6D, 0x58, 0xE0,
-  0x1A, 0x9A, 0xE0, 0xC0, 0x2A, 0x65, 0xAB, 0x1A, 0x4B, 0x6E, 0x82, 0x5C, 0x48, 0xB8, 0x11, 0x39,
-  0x17, 0xD3, 0x7A, 0x93, 0x49, 0x52, 0x88, 0xC7, 0xB8, 0xD4, 0xE8, 0x7D, 0x10, 0x4D, 0x87, 0xD5,
-  0x46, 0x13, 0x64, 0x2C, 0x24, 0xA4, 0x88, 0x5E, 0x3C, 0xF1, 0xA3, 0xEA, 0xA3, 0x20, 0x1C, 0xA3,
-  0x93, 0x84, 0x94, 0xFC, 0xDD, 0xBC, 0x30, 0xA5, 0xA8, 0x8C, 0xE2, 0x59, 0x6C, 0x36, 0xB9, 0xC1,
-  0x1C, 0x03, 0x6C, 0x63, 0x32, 0x60, 0x87, 0xD0, 0xA8, 0xAD, 0xF5, 0x79, 0xCE, 0x05, 0x79, 0xCE,
-  0xC3, 0xD8, 0x3E, 0x76, 0x2D, 0x47, 0xFF, 0xF1, 0xE7, 0x78, 0x07, 0x33, 0x3A, 0x91, 0xC7, 0x09,
-  0xB2, 0xE7, 0x14, 0xB3, 0xC1, 0x7F, 0xB8, 0xF8, 0x70, 0xE7, 0x8E, 0x62, 0xBC, 0x02, 0x20, 0x16,
-  0x3E, 0xFE, 0x2B, 0xF7, 0x7C, 0xE0, 0xD0, 0x93, 0x39, 0xC2, 0x7D, 0xBD, 0x56, 0x57, 0x2C, 0x01,
-  0x11, 0x61, 0x6C, 0x8C, 0x51, 0xAF, 0xBF, 0x73, 0x23, 0x77, 0xAF, 0xBF, 0x9C, 0x9F, 0x55, 0x2F,
-  0x3E, 0xB4, 0x63, 0xB3, 0x8B, 0x8D, 0xC3, 0x66, 0x0C, 0x24, 0xD1, 0xED, 0xE4, 0xEE, 0xF2, 0x6C,
-  0xF2, 0x00, 0x67, 0x12, 0x25, 0x4F, 0xAC, 0x80, 0x0B, 0xC0, 0xC6, 0x01, 0xBB, 0x3C, 0x83, 0xA3,
-  0x15, 0xFE, 0xE5, 0x1C, 0x43, 0x77, 0x40, 0x6C, 0x32, 0x6D, 0xC0, 0x75, 0xFF, 0xEA, 0xEA, 0xCB,
-  0xE4, 0x71, 0xAE, 0xAE, 0x06, 0x47, 0x63, 0xDD, 0x24, 0xBB, 0xEA, 0x73, 0xC7, 0xE0, 0x20, 0x35,
-  0x5F, 0x69, 0x62, 0x72, 0x3F, 0x7B, 0xB0, 0xFC, 0x0F, 0xF5, 0xE6, 0x87, 0xBD, 0xF7, 0x1F, 0xD4,
-  0x0C, 0xB7, 0xF3, 0x76, 0x3B, 0x0D, 0xCE, 0xD5, 0x46, 0x7D, 0xBF, 0xD6, 0x38, 0xDC, 0xAF, 0xEF,
-  0xBF, 0x3F, 0x68, 0x14, 0xEC, 0xF8, 0xD8, 0x9A, 0x32, 0xDF, 0xC6, 0xFE, 0x01, 0xCC, 0xF8, 0x30,
-  0x9C, 0x2C, 0xDB, 0x3A, 0x6E, 0x9F, 0xBE, 0x1B, 0x87, 0x67, 0x2E, 0xC4, 0x89, 0xC1, 0xFA, 0xFC,
-  0xF4, 0xFC, 0x62, 0xF2, 0xA0, 0xF8, 0xED, 0x2C, 0x68, 0x73, 0x9D, 0xF7, 0x7E, 0x9A, 0x06, 0x90,
-  0xE6, 0x61, 0xBD, 0x59, 0x3F, 0xA8, 0xED, 0x1F, 0x1C, 0xE6, 0x84, 0x07, 0xF6, 0xF8, 0xF3, 0x94,
-  0x1E, 0xF7, 0xDE, 0x37, 0x0E, 0x0E, 0xEB, 0x7B, 0xB5, 0xBD, 0xFA, 0x6E, 0x81, 0x1E, 0x7F, 0x99,
-  0x86, 0x0B, 0x87, 0x07, 0x07, 0x07, 0xFB, 0xB5, 0xBD, 0xC3, 0xBD, 0xF4, 0x61, 0x3C, 0x0B, 0xB0,
-  0x71, 0x96, 0x96, 0xF9, 0x79, 0xE0, 0x85, 0x9C, 0x63, 0x28, 0xAA, 0xF5, 0xB4, 0x30, 0x33, 0xCE,
-  0xEE, 0xE8, 0x1C, 0x19, 0xE3, 0x47, 0xFF, 0x54, 0xAD, 0xB2, 0x6A, 0xF8, 0x8F, 0xC1, 0x89, 0xDD,
-  0x03, 0x31, 0x86, 0x9D, 0x3A, 0x76, 0xCF, 0xEC, 0xC7, 0xBE, 0xA8, 0x56, 0x5B, 0xE3, 0x7C, 0x4C,
-  0x0D, 0x6F, 0x80, 0x5A, 0x06, 0x3A, 0x51, 0x5F, 0x73, 0xAB, 0xCD, 0x0C, 0xD6, 0xF5, 0x51, 0xEA,
-  0x1D, 0x91, 0x40, 0x25, 0x6C, 0x06, 0xFF, 0x57, 0x5D, 0xCF, 0x84, 0xC9, 0x3D, 0xB1, 0x91, 0xAE,
-  0x2C, 0x59, 0xAF, 0x2B, 0xA7, 0x20, 0x67, 0x50, 0x61, 0xE2, 0xC9, 0x85, 0x65, 0xC8, 0x2E, 0x2A,
-  0x0C, 0x4E, 0x2C, 0xAD, 0x2A, 0x5B, 0xD0, 0x31, 0x62, 0x69, 0xAE, 0xCF, 0x2B, 0x99, 0x7B, 0x24,
-  0x5F, 0x25, 0xAD, 0xFA, 0x53, 0xE5, 0x9F, 0xC3, 0x77, 0xDB, 0xC9, 0xDE, 0x35, 0xCF, 0xD4, 0xAA,
-  0xFC, 0x11, 0x36, 0xC0, 0xE0, 0x78, 0x9E, 0x6A, 0x16, 0x74, 0x27, 0x9F, 0xE2, 0xD1, 0xE1, 0x39,
-  0x96, 0x3F, 0x1A, 0x27, 0xD9, 0xB6, 0x95, 0x39, 0x6A, 0x12, 0x80, 0x81, 0xA7, 0x91, 0xE6, 0xFF,
-  0xD1, 0x4C, 0x2C, 0x0D, 0x95, 0xF6, 0xD1, 0x61, 0x48, 0x2A, 0x3C, 0x6A, 0xF3, 0xAC, 0x6B, 0xB2,
-  0x94, 0x96, 0x8F, 0xA7, 0x9C, 0x99, 0x85, 0x33, 0x12, 0x20, 0x99, 0x18, 0x33, 0x69, 0x9B, 0xC2,
-  0x65, 0xB0, 0x61, 0x17, 0xF6, 0x49, 0x91, 0x6B, 0xBE, 0x95, 0x25, 0xBA, 0xD1, 0x3C, 0x83, 0xE1,
-  0x8F, 0x2A, 0xCA, 0xDB, 0x69, 0x7C, 0xCA, 0x6A, 0xD1, 0x73, 0xBC, 0xA1, 0xD2, 0xDC, 0x01, 0x53,
-  0x9B, 0x13, 0x20, 0x17, 0x83, 0xDE, 0xD1, 0xC4, 0x17, 0x24, 0xE1, 0xA9, 0x7E, 0x85, 0x50, 0x08,
-  0xD1, 0xF5, 0xAB, 0x40, 0x76, 0x3A, 0x1F, 0x92, 0x41, 0x4C, 0xCA, 0xEF, 0x13, 0xBB, 0x20, 0xED,
-  0x1F, 0xAD, 0x6C, 0x20, 0x5A, 0x70, 0x8B, 0xEB, 0x82, 0x69, 0x4C, 0x6D, 0x0C, 0x03, 0x34, 0x00,
-  0xAD, 0x9B, 0xDB, 0x0C, 0xFA, 0x87, 0x23, 0x9A, 0x29, 0x49, 0x15, 0x54, 0x71, 0x07, 0x9E, 0x6B,
-  0x22, 0x7C, 0xB1, 0xC6, 0x8E, 0x85, 0x94, 0xF2, 0xB6, 0xE3, 0x52, 0xD3, 0x83, 0x09, 0x07, 0x78,
-  0x00, 0x10, 0xF6, 0xA9, 0x63, 0x6E, 0x8C, 0xDE, 0x0F, 0xF1, 0x42, 0x1F, 0x68, 0x76, 0x9F, 0xFB,
-  0x0C, 0x05, 0x30, 0x5F, 0xBB, 0x87, 0x57, 0x1E, 0x68, 0x3C, 0x50, 0x67, 0x7B, 0x3D, 0x8E, 0x86,
-  0xA0, 0x68, 0x32, 0x20, 0x83, 0x45, 0xFD, 0x80, 0xDA, 0x4D, 0xEF, 0xBD, 0xED, 0x40, 0x9B, 0x24,
-  0x72, 0xBD, 0xC5, 0x17, 0x5D, 0x98, 0x8C, 0xCF, 0x8D, 0xDA, 0x14, 0xD8, 0x8E, 0x81, 0x8F, 0x50,
-  0xCD, 0xB4, 0x7B, 0x4E, 0x55, 0x37, 0x3D, 0x1D, 0x06, 0x14, 0xFC, 0x51, 0x44, 0x64, 0x39, 0xF4,
-  0x71, 0xA7, 0x26, 0x31, 0xAD, 0x14, 0xF3, 0xCA, 0x46, 0x81, 0x14, 0xC3, 0xCA, 0x81, 0x1E, 0x28,
-  0x47, 0xB5, 0x66, 0x6C, 0x7E, 0x36, 0xAB, 0x4D, 0x68, 0xB7, 0x21, 0xA7, 0x9B, 0x0A, 0x0A, 0xD3,
-  0x76, 0x03, 0xA1, 0xD8, 0x8B, 0xA7, 0x19, 0xA6, 0x53, 0x51, 0xB6, 0x56, 0x05, 0xFF, 0x5B, 0xF9,
-  0xEC, 0x5E, 0x03, 0xB9, 0xE3, 0x53, 0xA5, 0x3E, 0xAB, 0x3B, 0x4B, 0xEB, 0x72, 0x2B, 0x4E, 0xE5,
-  0x75, 0xD2, 0x05, 0x5B, 0x6A, 0xE3, 0xE1, 0xC4, 0xA6, 0x37, 0x9E, 0x05, 0xCA, 0x17, 0x01, 0xC9,
-  0x46, 0x61, 0x48, 0x36, 0x24, 0x24, 0x1B, 0xCD, 0xDD, 0xBD, 0xFD, 0x83, 0xF7, 0x87, 0x1F, 0xEA,
-  0xA3, 0xBF, 0x5E, 0xA1, 0xAA, 0xA0, 0xDA, 0x2C, 0x0C, 0xD5, 0xA6, 0x84, 0xEA, 0x2B, 0x04, 0x15,
-  0x04, 0x77, 0x0B, 0x43, 0x70, 0xF7, 0x15, 0x82, 0x09, 0x08, 0xEE, 0x15, 0x86, 0xE0, 0xDE, 0x2B,
-  0x04, 0x13, 0x10, 0xDC, 0x2F, 0x0C, 0xC1, 0xFD, 0x57, 0x08, 0x26, 0x20, 0x78, 0x50, 0x18, 0x82,
-  0x07, 0xAF, 0x10, 0x4C, 0x40, 0xF0, 0x7D, 0x61, 0x08, 0xBE, 0x9F, 0x1F, 0x04, 0xE7, 0x08, 0x42,
-  0x39, 0x4D, 0x78, 0x3F, 0x9A, 0xA7, 0x34, 0xCE, 0x87, 0x6A, 0x68, 0xFC, 0xAA, 0x45, 0x19, 0x24,
-  0x77, 0xE9, 0x8F, 0x3D, 0xFA, 0x49, 0x03, 0x51, 0x1F, 0x91, 0x0C, 0x37, 0x15, 0x2C, 0xD8, 0xF9,
-  0xD1, 0x6C, 0x10, 0x24, 0xF5, 0x31, 0x1C, 0xF4, 0x90, 0x86, 0x7B, 0x5F, 0x64, 0x13, 0x51, 0x50,
-  0xAF, 0x24, 0x20, 0xA2, 0x94, 0xD5, 0x84, 0x06, 0x2D, 0x77, 0x65, 0x7A, 0xAF, 0x6E, 0xBA, 0x01,
-  0x5D, 0xF1, 0x45, 0x7D, 0xC7, 0xAE, 0xFD, 0x70, 0x7F, 0xDD, 0x69, 0x7B, 0x3B, 0x91, 0x02, 0xC6,
-  0x07, 0x3A, 0x25, 0x25, 0xE8, 0x1A, 0x54, 0x16, 0x34, 0xB1, 0x26, 0x07, 0x53, 0x97, 0x7D, 0x53,
-  0x86, 0x9B, 0x3F, 0xAA, 0x8C, 0xDB, 0x4B, 0xD4, 0x6D, 0xEF, 0x7E, 0x0E, 0xEA, 0x52, 0xD6, 0x8D,
-  0xA4, 0x9D, 0x82, 0xAE, 0x71, 0x84, 0x4D, 0x37, 0x06, 0x0A, 0x7B, 0x2A, 0x93, 0x0C, 0x20, 0x99,
-  0x98, 0x38, 0x5D, 0x7F, 0xA5, 0x2B, 0x5B, 0xFB, 0x14, 0xFD, 0x0D, 0xC6, 0xC6, 0xD9, 0x7A, 0x57,
-  0x51, 0x37, 0x15, 0xEA, 0x41, 0xB6, 0xB1, 0x60, 0x41, 0x9A, 0x75, 0x4C, 0xBB, 0x96, 0x93, 0x48,
-  0xAB, 0xC2, 0xA8, 0x4A, 0xF7, 0x34, 0x5D, 0x38, 0xB0, 0x72, 0x83, 0xF7, 0xB4, 0xC0, 0x12, 0xFE,
-  0x2C, 0xB5, 0x75, 0x21, 0xAA, 0xEB, 0x2C, 0x8E, 0x94, 0x1F, 0xAB, 0xBD, 0x18, 0xF4, 0xAF, 0xFD,
-  0xFE, 0xDC, 0x10, 0x3A, 0xCB, 0x9E, 0x93, 0xF1, 0x6A, 0xCA, 0x84, 0xF7, 0xF9, 0xA6, 0xD3, 0x59,
-  0xA6, 0xFD, 0x6E, 0x28, 0x80, 0x6F, 0xC6, 0x8D, 0x78, 0x73, 0xB6, 0xD8, 0xE1, 0x7A, 0x4A, 0x99,
-  0xEB, 0x62, 0x0D, 0xB3, 0xE1, 0x1E, 0x83, 0x54, 0xCA, 0x50, 0xD7, 0xB7, 0x7D, 0x7F, 0xC5, 0x56,
-  0xBA, 0xA4, 0x81, 0x6E, 0xEA, 0x5A, 0x26, 0x5B, 0xE7, 0x98, 0x2B, 0xAA, 0x8D, 0xA9, 0x26, 0x3A,
-  0xBA, 0xEC, 0xE2, 0x9A, 0x1F, 0x78, 0x44, 0xE3, 0xB7, 0x9A, 0xE0, 0x97, 0x78, 0xD2, 0x4C, 0xA1,
-  0xC8, 0xEB, 0xD1, 0xEB, 0x0C, 0xDF, 0x3F, 0xCA, 0x75, 0xDA, 0x4D, 0x67, 0xC1, 0x13, 0xCE, 0xC6,
-  0x26, 0xF1, 0xC3, 0x46, 0x13, 0x49, 0x7A, 0x97, 0x8D, 0x18, 0x7A, 0x1E, 0x7E, 0x11, 0x3B, 0xFF,
-  0x53, 0x0B, 0xFC, 0xF2, 0x7B, 0xE2, 0x26, 0x32, 0x7E, 0xD2, 0x5F, 0xDA, 0x33, 0x3B, 0xC6, 0x7F,
-  0x5F, 0x7E, 0x3F, 0xCA, 0xF5, 0xDE, 0x1C, 0x99, 0x6A, 0x8A, 0xB9, 0xDE, 0x0D, 0x38, 0xB3, 0x83,
-  0x61, 0x97, 0x7B, 0xCC, 0xE9, 0x31, 0xF2, 0xC8, 0x00, 0xFC, 0xF5, 0xD1, 0x50, 0x68, 0x39, 0xBA,
-  0x44, 0xE6, 0x7F, 0xFC, 0xFD, 0xBF, 0x7A, 0xE6, 0x23, 0xF7, 0xFF, 0xF1, 0xF7, 0xFF, 0x66, 0x2E,
-  0xBC, 0xE8, 0x73, 0x40, 0x5B, 0xA3, 0xC6, 0x8E, 0xED, 0x27, 0x31, 0x30, 0xED, 0x3E, 0xD3, 0xBA,
-  0xCE, 0x3D, 0x67, 0x7B, 0x5F, 0x7E, 0x07, 0x99, 0xF2, 0x09, 0xB0, 0x06, 0x4D, 0x97, 0xA3, 0x6B,
-  0x36, 0x78, 0xB9, 0xCF, 0x7D, 0xEA, 0x09, 0xE8, 0x6D, 0x87, 0x7A, 0xEE, 0xA3, 0x13, 0x03, 0xBA,
-  0xDE, 0xE8, 0x1E, 0x87, 0xA5, 0xE9, 0x26, 0xF7, 0x6B, 0xEC, 0xC6, 0x01, 0x24, 0x60, 0x38, 0xA3,
-  0x18, 0xA0, 0x99, 0x87, 0x97, 0xCB, 0xA6, 0x4F, 0x7E, 0x58, 0x1E, 0x79, 0x60, 0x21, 0xEB, 0x6F,
-  0xC0, 0x60, 0x64, 0xC9, 0x34, 0x6D, 0x76, 0x82, 0x37, 0xFB, 0x43, 0xC7, 0xE0, 0x35, 0x76, 0x26,
-  0x4F, 0x82, 0x23, 0x9C, 0x4C, 0x8D, 0x5D, 0x99, 0x43, 0x13, 0xDD, 0x67, 0x6A, 0xF5, 0x7A, 0xBD,
-  0xD1, 0x6C, 0x52, 0xBB, 0x3A, 0x7C, 0x91, 0x63, 0xDB, 0x17, 0x7A, 0x5C, 0xE4, 0x3D, 0x36, 0x46,
-  0xEF, 0xCD, 0x10, 0x07, 0x73, 0x9C, 0x31, 0x13, 0x28, 0x43, 0x0A, 0xA9, 0xFB, 0x65, 0x08, 0x23,
-  0x2E, 0x49, 0x4A, 0x14, 0xCA, 0x94, 0x25, 0x63, 0xD7, 0x04, 0xE3, 0xF4, 0x93, 0x63, 0x18, 0x37,
-  0xBB, 0x69, 0x59, 0x01, 0x73, 0x96, 0xE4, 0x17, 0x1B, 0x37, 0x71, 0x9F, 0x4E, 0x00, 0xC2, 0x0B,
-  0x32, 0x5C, 0x4F, 0x1D, 0x06, 0xE1, 0xC3, 0x96, 0xE3, 0x7D, 0xDC, 0x81, 0x5F, 0x34, 0xDE, 0x7A,
-  0xB0, 0xA4, 0x0E, 0xD7, 0x2B, 0xAD, 0x0E, 0xD1, 0xA7, 0xCF, 0xBA, 0x5C, 0x3C, 0x70, 0x20, 0x91,
-  0xD8, 0x3B, 0xFE, 0x9A, 0xF1, 0x9B, 0x29, 0x33, 0xAD, 0x01, 0x27, 0x00, 0xB2, 0x97, 0x58, 0x66,
-  0xA2, 0x17, 0x23, 0xB0, 0x01, 0x1B, 0x98, 0x00, 0x10, 0x3B, 0x34, 0x15, 0x59, 0x6C, 0x02, 0xEF,
-  0x5D, 0xE0, 0x55, 0xE0, 0x3F, 0xBD, 0xC0, 0x92, 0xFC, 0x41, 0x68, 0x3F, 0x88, 0x45, 0x25, 0x5E,
-  0xE6, 0xF7, 0xE8, 0x31, 0xD5, 0xE3, 0x0F, 0xD1, 0x0C, 0x34, 0xDD, 0x73, 0x7C, 0xF8, 0x05, 0xBC,
-  0x09, 0xDE, 0x86, 0x17, 0xEF, 0xF9, 0x13, 0xDB, 0x6A, 0xEE, 0xFD, 0x89, 0x0D, 0x9C, 0xC0, 0xF3,
-  0xDF, 0xCD, 0x83, 0x3B, 0x45, 0xEC, 0xA8, 0x81, 0xEF, 0x1C, 0x36, 0x3E, 0x1C, 0x84, 0xC3, 0x03,
-  0x47, 0x22, 0x90, 0xE7, 0x86, 0x66, 0xCC, 0x7D, 0xEB, 0x95, 0x29, 0xCD, 0x95, 0x29, 0x11, 0x05,
-  0x95, 0xE4, 0x4A, 0xD0, 0x76, 0x0E, 0x6C, 0xA9, 0xC4, 0xD7, 0x33, 0x55, 0x59, 0xF2, 0x91, 0x79,
-  0xB2, 0xB5, 0xA1, 0xA9, 0x5F, 0x03, 0x2A, 0x5A, 0x67, 0x9E, 0xE3, 0x4A, 0x89, 0x33, 0x97, 0xE1,
-  0x23, 0xDE, 0xB4, 0xD2, 0x3A, 0x93, 0x9F, 0x18, 0x7D, 0xCC, 0x61, 0xAB, 0x90, 0xAA, 0x9B, 0xB2,
-  0x15, 0x25, 0xBA, 0x1A, 0x9B, 0x57, 0x72, 0xB3, 0x0C, 0x35, 0x4B, 0xB9, 0x5B, 0x33, 0x80, 0xE7,
-  0xB8, 0x24, 0x62, 0x8C, 0xEE, 0xD9, 0xDA, 0x8E, 0x27, 0x30, 0x2A, 0xE1, 0xE3, 0x8E, 0xFC, 0xAA,
-  0x50, 0x7B, 0x18, 0xAE, 0x23, 0x48, 0xFC, 0x01, 0x2A, 0x2A, 0xD5, 0xC3, 0x2E, 0xCC, 0x80, 0x1B,
-  0x20, 0xF8, 0x80, 0x56, 0x61, 0x97, 0xEA, 0x61, 0xAF, 0xD2, 0x3A, 0x0E, 0x84, 0x33, 0x74, 0x84,
-  0x79, 0x5F, 0x6E, 0x15, 0xFB, 0x78, 0x18, 0x68, 0xA5, 0x9A, 0x1E, 0xC0, 0xE0, 0xA6, 0xD7, 0x75,
-  0x3C, 0x9B, 0xB3, 0x46, 0xBF, 0x54, 0x17, 0xEF, 0x63, 0x5D, 0x34, 0xCB, 0x75, 0x71, 0x18, 0xEB,
-  0x62, 0xAF, 0x5C, 0x17, 0x1F, 0x2A, 0xAD, 0xEF, 0x9E, 0xE9, 0x8B, 0x52, 0x8D, 0x1B, 0x80, 0x47,
-  0x27, 0xE6, 0x8F, 0x1C, 0xD0, 0x07, 0xB6, 0x49, 0x68, 0xDE, 0x5A, 0x92, 0xCF, 0xC1, 0xB1, 0xF1,
-  0xB7, 0xC0, 0x17, 0xE1, 0xB1, 0x28, 0xB8, 0x67, 0x6B, 0x16, 0xD3, 0xAC, 0xBE, 0xE3, 0x99, 0x62,
-  0x30, 0xC4, 0x03, 0x66, 0xA8, 0x09, 0x7D, 0x40, 0xDF, 0x83, 0xA6, 0x2B, 0x6D, 0x27, 0x9A, 0xEB,
-  0x5A, 0xA6, 0x92, 0xEA, 0xB9, 0x7D, 0x6F, 0x7A, 0x8E, 0x8D, 0xE3, 0xAA, 0xA3, 0x56, 0x79, 0x29,
-  0x30, 0x73, 0xE8, 0x7A, 0x70, 0x9E, 0xC9, 0xBE, 0x3D, 0xAE, 0x73, 0x40, 0x3F, 0xEF, 0xAD, 0x2F,
-  0x87, 0x71, 0x41, 0x59, 0x95, 0x1D, 0xC0, 0x21, 0x1C, 0x3F, 0xAF, 0x95, 0xD3, 0x43, 0x80, 0x4E,
-  0x04, 0xCE, 0xBD, 0x69, 0xA0, 0x73, 0x02, 0x9C, 0x7B, 0x1E, 0x9C, 0xCA, 0xBA, 0x1E, 0xD0, 0x39,
-  0x19, 0x3A, 0x7F, 0x63, 0x98, 0x00, 0xB0, 0xE9, 0x1A, 0x7A, 0x60, 0xD2, 0x88, 0xF1, 0x81, 0x70,
-  0xEA, 0x00, 0xA7, 0xC0, 0xF6, 0x03, 0x93, 0xE8, 0x97, 0x01, 0x7C, 0x04, 0xF2, 0x03, 0x3A, 0x45,
-  0x89, 0x23, 0x51, 0x83, 0x3E, 0xBC, 0x6D, 0x4F, 0x5A, 0x12, 0x9E, 0xC9, 0x16, 0x6C, 0x9C, 0x85,
-  0x8E, 0x41, 0xE8, 0x62, 0x01, 0x5A, 0x01, 0x9E, 0xC6, 0x78, 0xC0, 0xC3, 0x39, 0x0F, 0x73, 0x8F,
-  0xC6, 0x03, 0x95, 0x06, 0x7B, 0x07, 0x2D, 0x44, 0x0A, 0x10, 0xD1, 0x2C, 0xE5, 0xBC, 0xF5, 0xA7,
-  0x98, 0x5A, 0x11, 0xF2, 0x94, 0x75, 0xF2, 0x8F, 0x88, 0x9D, 0x47, 0x71, 0x56, 0xDA, 0xE1, 0xB6,
-  0xEF, 0x78, 0x17, 0x01, 0x7A, 0x5D, 0x96, 0xB6, 0xC6, 0x66, 0x79, 0xE9, 0x2D, 0xDC, 0xCC, 0x3E,
-  0x34, 0xED, 0x73, 0x8B, 0xDF, 0x57, 0x32, 0xA5, 0x82, 0x83, 0x31, 0xAB, 0xFA, 0x35, 0x6C, 0x6B,
-  0xE7, 0xAF, 0x0C, 0x9B, 0x10, 0x1A, 0x1C, 0x2D, 0xD9, 0x3E, 0x09, 0xE3, 0x63, 0x4C, 0x1C, 0xE3,
-  0xE1, 0x04, 0x10, 0xCF, 0x0C, 0x8E, 0x31, 0x23, 0x3E, 0x21, 0xAB, 0x26, 0x2D, 0x44, 0x3E, 0x90,
-  0x80, 0x65, 0x99, 0x82, 0x4C, 0x97, 0x5D, 0x8E, 0x52, 0xAA, 0x21, 0x51, 0x12, 0xB4, 0xEB, 0x35,
-  0x36, 0x5D, 0x16, 0xBF, 0x8A, 0x50, 0x3B, 0x55, 0xE4, 0x2A, 0x62, 0x8A, 0xAC, 0xA6, 0xC4, 0x34,
-  0x85, 0x14, 0xB9, 0x2E, 0x22, 0xD4, 0xCB, 0x0B, 0xB8, 0x84, 0x58, 0x34, 0xE2, 0x9F, 0xDE, 0x7C,
-  0x2D, 0x82, 0xF7, 0xA7, 0x3B, 0x37, 0xF5, 0x55, 0xE1, 0xFB, 0x08, 0x9F, 0xD1, 0xC7, 0x4D, 0xB3,
-  0x64, 0x04, 0x4A, 0x26, 0x72, 0x8F, 0x18, 0xE8, 0x81, 0x71, 0x02, 0xBA, 0x11, 0x52, 0x45, 0xE8,
-  0xEF, 0x8D, 0x2C, 0xB7, 0x59, 0x4F, 0x3D, 0xBE, 0x7D, 0xA5, 0x87, 0xD9, 0xF4, 0x80, 0xB8, 0x92,
-  0x97, 0x1C, 0xE0, 0xDD, 0x55, 0x50, 0x83, 0xB4, 0x3D, 0xDB, 0x3E, 0x62, 0x0A, 0xF1, 0xC6, 0xD3,
-  0x01, 0xD7, 0x7F, 0x9C, 0x38, 0x8F, 0xDC, 0xCF, 0x49, 0x13, 0x89, 0xD6, 0xD0, 0xE8, 0x34, 0xF1,
-  0x39, 0x8F, 0xF6, 0x31, 0x4F, 0xA9, 0xEB, 0x2E, 0x2E, 0xA8, 0x80, 0x88, 0xA1, 0x6B, 0x2E, 0x89,
-  0x28, 0x20, 0x4F, 0xC0, 0x44, 0x55, 0x08, 0x2E, 0xC8, 0x1C, 0xF2, 0x1D, 0x14, 0x6D, 0x24, 0x6D,
-  0xC0, 0x41, 0xE0, 0x39, 0x20, 0xC0, 0x00, 0x0D, 0x98, 0xAE, 0xC5, 0x47, 0xB4, 0x13, 0x59, 0x1E,
-  0xA2, 0xAF, 0x92, 0x0B, 0x06, 0x19, 0xC9, 0x19, 0xF2, 0xB8, 0x94, 0xE3, 0x33, 0xC3, 0xD4, 0x05,
-  0x8A, 0x53, 0x28, 0x04, 0xD9, 0x1C, 0xE8, 0x0C, 0xBD, 0x4A, 0x03, 0x0F, 0x25, 0x32, 0x98, 0x06,
-  0xF7, 0x30, 0x52, 0x25, 0xD9, 0x0D, 0xCD, 0x87, 0x04, 0x58, 0x24, 0x45, 0x29, 0xA8, 0x4A, 0xAB,
-  0x88, 0x14, 0xA2, 0x92, 0x2F, 0x93, 0xFB, 0xA9, 0xB4, 0xE2, 0xA6, 0x05, 0x33, 0x58, 0x0C, 0x4A,
-  0x74, 0x62, 0xE0, 0xF8, 0x3C, 0x5A, 0x1A, 0x88, 0x84, 0xD0, 0x49, 0x28, 0xC8, 0x0D, 0xE5, 0x52,
-  0xBB, 0x1C, 0x3F, 0x13, 0x1B, 0x30, 0x02, 0x0F, 0xFF, 0x8E, 0xE4, 0x2A, 0x5D, 0xB3, 0xF4, 0x20,
-  0x5A, 0x5F, 0xC4, 0x1A, 0x3E, 0xB7, 0x3B, 0xDB, 0xAC, 0x73, 0x72, 0x0C, 0x3F, 0x3F, 0x5F, 0x7D,
-  0xBD, 0x39, 0xEE, 0xC0, 0x1F, 0x27, 0xDC, 0x3C, 0x73, 0x82, 0x6D, 0x62, 0x12, 0x9F, 0x35, 0xCB,
-  0xB4, 0xB8, 0xB3, 0x8E, 0xBE, 0xA9, 0xB9, 0x4E, 0x03, 0x1D, 0x51, 0x3F, 0x71, 0x4B, 0x3B, 0x9B,
-  0x04, 0xC6, 0xDA, 0x2B, 0xE6, 0x2F, 0x69, 0x23, 0xE8, 0x3E, 0x26, 0xC9, 0x01, 0x40, 0x58, 0x69,
-  0xC1, 0x8F, 0x9D, 0xFF, 0xF9, 0x4B, 0xA7, 0x33, 0x9B, 0x34, 0x24, 0xC3, 0x19, 0x1F, 0x83, 0x9E,
-  0x87, 0x17, 0x70, 0xF4, 0x08, 0x66, 0x1D, 0x39, 0x76, 0x48, 0xFE, 0x93, 0x3D, 0xF6, 0x26, 0x00,
-  0x09, 0x51, 0x0C, 0xF4, 0x62, 0xF8, 0xB9, 0x64, 0x08, 0xC9, 0x81, 0x37, 0x02, 0x8F, 0x24, 0xA9,
-  0x01, 0x2E, 0xC9, 0x3F, 0x96, 0x8D, 0x4A, 0xE1, 0xF0, 0x9B, 0x00, 0x2B, 0xC9, 0xA2, 0x2A, 0x2D,
-  0xF9, 0x7B, 0xC9, 0x90, 0x0A, 0x07, 0xDF, 0x08, 0xA4, 0x92, 0x4C, 0x1D, 0x90, 0x4A, 0xFE, 0xB1,
-  0x6C, 0xA4, 0x0A, 0x87, 0x2F, 0x0C, 0x2B, 0x37, 0xBB, 0xC3, 0x59, 0xF2, 0x54, 0x11, 0xC0, 0xA3,
-  0xF3, 0xC3, 0x73, 0x01, 0xCE, 0x6D, 0x14, 0x45, 0x6E, 0x84, 0x67, 0xBA, 0xA7, 0x96, 0x89, 0x11,
-  0xDF, 0xAD, 0x73, 0x7A, 0xC4, 0x6E, 0xEE, 0x6E, 0x2F, 0xDB, 0x4C, 0x3E, 0x5C, 0x2C, 0xD4, 0x33,
-  0xE6, 0xB0, 0x24, 0xC9, 0xEC, 0x1B, 0x49, 0x2B, 0x20, 0x92, 0xC9, 0xC5, 0xEA, 0x34, 0x3A, 0x8A,
-  0x2C, 0x68, 0x40, 0xC6, 0xA8, 0x66, 0x10, 0x72, 0x40, 0x3A, 0x93, 0x19, 0x54, 0x70, 0x24, 0x29,
-  0xA6, 0x68, 0x20, 0x8D, 0xF8, 0x24, 0xBA, 0xF8, 0xDC, 0xC3, 0xE0, 0x9B, 0x1A, 0xFB, 0xD9, 0x09,
-  0xBC, 0x30, 0x12, 0x67, 0x18, 0xF8, 0x02, 0xD5, 0x99, 0x07, 0x13, 0x6F, 0xBA, 0x65, 0xD8, 0xB0,
-  0x87, 0x4E, 0x67, 0x4C, 0x13, 0x0C, 0xAF, 0x05, 0x85, 0x39, 0xE4, 0x71, 0x21, 0xE6, 0xCC, 0xF4,
-  0x11, 0x02, 0x1B, 0x16, 0x41, 0x83, 0x5B, 0x67, 0x8F, 0x36, 0x2D, 0x74, 0x93, 0xC9, 0x0C, 0xF8,
-  0xCA, 0xA7, 0xF9, 0xE4, 0xD6, 0x7F, 0xD3, 0xF2, 0x7E, 0x6C, 0x1A, 0xBF, 0x9E, 0xC2, 0xD6, 0x70,
-  0xEF, 0x8B, 0xE3, 0xE7, 0x50, 0x4E, 0x67, 0xBA, 0x63, 0xEE, 0x8F, 0x29, 0xD0, 0xB2, 0xFB, 0x99,
-  0x3D, 0xE3, 0xF8, 0x47, 0xF9, 0x6E, 0xBB, 0x26, 0x79, 0x65, 0x1E, 0x14, 0xBD, 0xBA, 0x9A, 0xE1,
-  0x99, 0x39, 0x01, 0x48, 0xB9, 0xEF, 0xAD, 0xB2, 0xDB, 0x2F, 0xFE, 0xEE, 0x6A, 0xD9, 0xA8, 0xD3,
-  0x4E, 0xA4, 0xBA, 0x5A, 0x3E, 0xEA, 0xE0, 0xF8, 0xCB, 0x46, 0x9D, 0x99, 0x96, 0x83, 0x09, 0x60,
-  0x7A, 0x06, 0xF2, 0x60, 0xFB, 0x97, 0x87, 0x3C, 0x70, 0xA2, 0x78, 0xAB, 0x44, 0x1E, 0x1C, 0x7F,
-  0xED, 0xF9, 0x0E, 0x01, 0xE9, 0x19, 0xA8, 0x83, 0xED, 0x5F, 0x26, 0xEA, 0xB4, 0xBF, 0xAF, 0x1A,
-  0x79, 0x58, 0xFB, 0xFB, 0x46, 0xE0, 0x0F, 0x40, 0xEA, 0x99, 0x18, 0xD4, 0xFE, 0xFE, 0x92, 0x70,
-  0xE8, 0xDA, 0x09, 0x6C, 0xD1, 0x76, 0x4C, 0x5B, 0x54, 0xCA, 0x60, 0x08, 0x35, 0xCF, 0x71, 0x34,
-  0x41, 0xFF, 0x6B, 0x8C, 0x1E, 0x31, 0x20, 0x94, 0x42, 0x8E, 0x51, 0xFB, 0x97, 0x89, 0x1A, 0xCF,
-  0x64, 0x2F, 0x13, 0x2F, 0x95, 0xF2, 0x23, 0xCF, 0xEC, 0xB7, 0xCA, 0xB3, 0x9F, 0xF7, 0x12, 0xB7,
-  0x97, 0x82, 0x5F, 0x65, 0xD9, 0x4F, 0xBC, 0x87, 0x75, 0xC2, 0xB1, 0xC8, 0xA2, 0xD0, 0xC8, 0x6B,
-  0xCF, 0xC9, 0x6D, 0x62, 0x88, 0x2F, 0xFF, 0x0E, 0x33, 0x5F, 0x0E, 0x4D, 0xF1, 0xF9, 0xF3, 0x71,
-  0xA5, 0x15, 0x7E, 0x60, 0xF0, 0x09, 0x95, 0x6E, 0xC9, 0x9A, 0xF3, 0xED, 0xFE, 0x73, 0xEC, 0x0D,
-  0x93, 0x26, 0x34, 0x73, 0x3F, 0x03, 0x9B, 0x7A, 0xE4, 0xC6, 0xB2, 0xA3, 0x99, 0xE8, 0x3A, 0x47,
-  0x27, 0xF0, 0x60, 0x82, 0xBA, 0xDF, 0x02, 0x13, 0x3D, 0x64, 0xE0, 0xAF, 0x7E, 0x60, 0x69, 0xDE,
-  0xE8, 0x92, 0x44, 0x65, 0x55, 0x23, 0x23, 0x05, 0xDD, 0xC2, 0xA0, 0x87, 0x29, 0xDB, 0x42, 0xF8,
-  0x0E, 0x65, 0xC0, 0xDB, 0x3B, 0xE6, 0xAB, 0x6C, 0x22, 0xF8, 0xBD, 0xEC, 0x12, 0x7E, 0xD9, 0x4C,
-  0x43, 0xA7, 0x31, 0x4C, 0xCA, 0xAA, 0x59, 0xD6, 0x93, 0x0A, 0x9C, 0x52, 0x97, 0x45, 0x9A, 0xC7,
-  0x7D, 0xC1, 0xB4, 0x7B, 0xCD, 0xA4, 0x84, 0xBD, 0x69, 0x9B, 0x48, 0x86, 0x21, 0x63, 0xCD, 0x43,
-  0xAA, 0x26, 0x7F, 0x8F, 0xD1, 0x4C, 0x17, 0x8E, 0xC7, 0x7A, 0x81, 0x08, 0x3C, 0xF2, 0x81, 0xC2,
-  0x4C, 0xAD, 0x8E, 0x3D, 0x9D, 0x90, 0x10, 0xA9, 0x00, 0x6C, 0xCE, 0x03, 0x9A, 0x7A, 0xBE, 0x02,
-  0xC8, 0xCF, 0x01, 0x70, 0x9E, 0xCD, 0xC5, 0x4C, 0x73, 0xD6, 0x1C, 0x69, 0xB1, 0x0C, 0x3D, 0x82,
-  0x18, 0x84, 0x53, 0xBE, 0x71, 0x44, 0x38, 0xE3, 0x4A, 0x0B, 0x6D, 0x62, 0x64, 0xB2, 0xC2, 0x8B,
-  0xF5, 0xB8, 0x11, 0x90, 0x55, 0x99, 0xED, 0x08, 0x16, 0xBE, 0x99, 0x8B, 0x4E, 0xE7, 0x49, 0xAB,
-  0x59, 0x93, 0x2D, 0x86, 0x66, 0xCF, 0x77, 0x4A, 0x57, 0xF4, 0xF8, 0x55, 0x26, 0x04, 0x74, 0x3D,
-  0xC7, 0x08, 0x74, 0xE1, 0xB3, 0x87, 0x81, 0xA9, 0x0F, 0xD8, 0x00, 0xD3, 0xE3, 0x84, 0x73, 0xC3,
-  0xEB, 0x51, 0x1B, 0xA9, 0xE4, 0xDE, 0x14, 0x4F, 0xDB, 0xEC, 0xC9, 0x09, 0x88, 0xCC, 0x82, 0x10,
-  0xBA, 0x26, 0x5A, 0x85, 0x35, 0x03, 0x2F, 0x81, 0xA3, 0x26, 0x63, 0x10, 0xEF, 0x3E, 0x31, 0x32,
-  0x8E, 0xCA, 0x5B, 0x52, 0xF4, 0x18, 0x8F, 0xEE, 0x63, 0x8B, 0x53, 0xDC, 0xC2, 0xA8, 0x2E, 0xAF,
-  0x03, 0x78, 0xAE, 0x33, 0x6B, 0x2C, 0x58, 0xB0, 0x90, 0x3D, 0x52, 0x71, 0x39, 0xF4, 0xAB, 0x3E,
-  0x91, 0x31, 0x80, 0xD3, 0xFC, 0xD4, 0x64, 0x68, 0x61, 0x14, 0xCB, 0xDA, 0xE7, 0x42, 0x85, 0x05,
-  0x5F, 0x99, 0xBE, 0xD8, 0x7A, 0x37, 0x16, 0x34, 0x3B, 0x34, 0xE8, 0x97, 0xCA, 0x57, 0x3C, 0x31,
-  0x08, 0x71, 0xBA, 0xE5, 0x39, 0x47, 0x80, 0xE2, 0xCC, 0x60, 0x44, 0x0C, 0xF4, 0x9C, 0x3A, 0x4A,
-  0xC9, 0x58, 0x45, 0xEC, 0x77, 0xFA, 0x1E, 0x2A, 0x00, 0x51, 0xEC, 0x9D, 0x1F, 0x8F, 0x58, 0x84,
-  0xA6, 0xCF, 0x0F, 0x5A, 0x1C, 0xED, 0xF5, 0xAC, 0xA8, 0xE1, 0xF9, 0xDE, 0x03, 0xDC, 0x5C, 0x9F,
-  0x1F, 0x93, 0xBB, 0xC0, 0xED, 0xF1, 0xF7, 0x9F, 0x28, 0x3D, 0x16, 0x9E, 0x7C, 0xE2, 0xC1, 0x61,
-  0x43, 0xC7, 0x47, 0x52, 0x1E, 0x0E, 0x1D, 0x9B, 0x3C, 0x34, 0x30, 0x0F, 0x3E, 0x3A, 0x4F, 0xC0,
-  0x2E, 0xFA, 0xD2, 0x99, 0x55, 0xC2, 0xA3, 0x1B, 0x88, 0xA4, 0xDF, 0x83, 0x1F, 0xB8, 0xF8, 0xAE,
-  0x2F, 0xBD, 0x59, 0xE1, 0xC4, 0xB5, 0xD9, 0xFB, 0x7A, 0x2C, 0xD1, 0x96, 0x6A, 0xE8, 0xD7, 0xD8,
-  0xB9, 0x06, 0xBC, 0x23, 0xEC, 0x47, 0x86, 0x86, 0x48, 0x86, 0xA9, 0x36, 0x4A, 0x71, 0x97, 0xB0,
-  0x01, 0x4D, 0xCF, 0x50, 0x64, 0xCF, 0xB6, 0xEA, 0xEF, 0x68, 0xE2, 0x03, 0xE7, 0x01, 0xA6, 0x23,
-  0x30, 0x92, 0x84, 0x82, 0x4D, 0x64, 0x6F, 0x94, 0xCE, 0x56, 0x4D, 0x79, 0xAB, 0xC1, 0x3E, 0x01,
-  0xAE, 0x8F, 0xBE, 0x8C, 0xBE, 0xC1, 0xF0, 0xBC, 0x06, 0xBA, 0x5C, 0x6D, 0xB3, 0x7D, 0xF5, 0x8E,
-  0xFC, 0x4E, 0x85, 0xBC, 0xEC, 0x33, 0x8A, 0xE4, 0x7B, 0x17, 0x63, 0x3B, 0x04, 0x30, 0x10, 0x2B,
-  0xB6, 0xD9, 0xE7, 0x0E, 0xFD, 0xB8, 0xC3, 0x1F, 0x7F, 0x95, 0x3E, 0x17, 0xB7, 0xD7, 0xA7, 0x2A,
-  0x8C, 0xCE, 0x3F, 0x62, 0x75, 0x94, 0xEC, 0x9A, 0xF5, 0x8D, 0x4C, 0x0E, 0x36, 0x2B, 0x1C, 0x76,
-  0x3A, 0xB9, 0x4C, 0xC9, 0x5B, 0x97, 0x91, 0x20, 0x71, 0x3F, 0x23, 0x3F, 0x62, 0x66, 0x8F, 0x65,
-  0x73, 0x05, 0xC4, 0x59, 0xDE, 0x78, 0xBE, 0x00, 0x7B, 0xC8, 0x35, 0xB5, 0xBB, 0xFE, 0xA4, 0x64,
-  0x01, 0xF9, 0x8E, 0xC8, 0x88, 0x9D, 0x52, 0x64, 0xFA, 0x9D, 0x73, 0x13, 0xEB, 0x79, 0x94, 0x1E,
-  0x00, 0x90, 0xA2, 0x43, 0xF1, 0x52, 0x70, 0xB4, 0xE5, 0xEA, 0x36, 0xEC, 0x82, 0x6D, 0x21, 0xEE,
-  0x3D, 0xEE, 0xBF, 0xCB, 0x99, 0x59, 0x20, 0x67, 0x2C, 0xD1, 0x62, 0xA0, 0xAA, 0x62, 0x56, 0x17,
-  0x03, 0xD8, 0xAB, 0x64, 0xE7, 0x09, 0xD8, 0xAA, 0xEF, 0x4A, 0x41, 0x96, 0xFD, 0x89, 0xDD, 0xFE,
-  0x74, 0xFD, 0xD8, 0x2C, 0x06, 0xE1, 0x1C, 0x98, 0x1B, 0x3B, 0xA0, 0xF1, 0x80, 0xAD, 0x2C, 0x38,
-  0xB0, 0x29, 0xC7, 0xE3, 0xCC, 0xB9, 0xA7, 0x52, 0x1A, 0x50, 0x28, 0xDE, 0x2A, 0x53, 0x1A, 0xC8,
-  0xAC, 0xEC, 0xFE, 0xA2, 0x92, 0x92, 0x9E, 0xC4, 0xBA, 0x2E, 0x24, 0x36, 0xC4, 0x1A, 0x4E, 0xD8,
-  0x07, 0x04, 0x64, 0x46, 0x82, 0xF1, 0xCA, 0x64, 0x21, 0x2F, 0x06, 0xEC, 0x54, 0x56, 0x04, 0x82,
-  0xC0, 0x3A, 0x65, 0x45, 0x98, 0xBA, 0xFC, 0x92, 0x39, 0x4B, 0xB1, 0x7F, 0x19, 0x46, 0x7A, 0x69,
-  0xCB, 0xC4, 0x48, 0x33, 0x5D, 0x2E, 0x12, 0x99, 0x95, 0x42, 0x40, 0xDD, 0xC1, 0xC3, 0x8E, 0xEA,
-  0x27, 0xCC, 0xB7, 0x14, 0x3E, 0x4F, 0x9A, 0xBA, 0x54, 0xC3, 0x99, 0x76, 0x8D, 0xB8, 0x6D, 0x71,
-  0x6C, 0x84, 0x96, 0xFC, 0xAB, 0x7A, 0x69, 0x2F, 0xD9, 0xB3, 0xF6, 0x52, 0x86, 0xF4, 0xBA, 0x20,
-  0x75, 0x99, 0x80, 0x38, 0x51, 0xF2, 0x01, 0x10, 0xCC, 0x34, 0x86, 0xD3, 0x64, 0xBE, 0x8A, 0x3B,
-  0xA2, 0x9C, 0xF2, 0x82, 0xFD, 0xB0, 0xA9, 0x7A, 0x8D, 0xA0, 0x9C, 0x03, 0x5D, 0xCE, 0x9C, 0x2E,
-  0x65, 0x68, 0x37, 0x50, 0xD3, 0xFA, 0xC7, 0xDF, 0xFF, 0xCB, 0x0F, 0x8F, 0x24, 0xCC, 0x5A, 0x80,
-  0x3D, 0x87, 0x3D, 0xD6, 0x28, 0x86, 0x97, 0x7A, 0x84, 0x9E, 0x50, 0x1C, 0x22, 0x47, 0x75, 0x14,
-  0x95, 0x68, 0xE2, 0x32, 0x8E, 0x49, 0xFB, 0x81, 0xE2, 0x99, 0x0B, 0x6A, 0xE1, 0x23, 0xD0, 0xB2,
-  0xC0, 0x38, 0xA2, 0x83, 0x7A, 0x14, 0x2D, 0xFC, 0x00, 0x12, 0xD5, 0x40, 0x06, 0x11, 0x69, 0x46,
-  0x98, 0xD8, 0x55, 0x4E, 0x00, 0x67, 0x8B, 0x36, 0x96, 0x1E, 0xCC, 0x2C, 0x5A, 0x04, 0x8E, 0x06,
-  0xFA, 0xA1, 0x9D, 0x8E, 0x5A, 0x0E, 0x83, 0x9C, 0x87, 0x5C, 0x0C, 0x1C, 0x83, 0x81, 0xF4, 0x68,
-  0x72, 0x0C, 0xBC, 0xFA, 0xCF, 0xDD, 0xBA, 0x3E, 0xCC, 0x88, 0x9B, 0x42, 0xD1, 0x14, 0x55, 0xCF,
-  0x7B, 0xE0, 0x2E, 0x35, 0x76, 0x69, 0xEB, 0x30, 0xBE, 0x1F, 0x06, 0x50, 0x85, 0x7E, 0xF9, 0x5F,
-  0xBB, 0xE8, 0xCA, 0x22, 0x07, 0xBE, 0x33, 0x87, 0x3C, 0xCC, 0xBA, 0x70, 0x2B, 0x8D, 0x4D, 0x06,
-  0x26, 0xDE, 0xB0, 0x19, 0x66, 0x43, 0x8F, 0xB9, 0xFB, 0x9A, 0xB2, 0x2F, 0x1E, 0x05, 0x3D, 0xD1,
-  0x58, 0x24, 0x29, 0x63, 0x3C, 0x16, 0x4C, 0xC1, 0xC4, 0x38, 0xB1, 0x13, 0x8E, 0x25, 0x25, 0x46,
-  0x2F, 0x99, 0x7E, 0x38, 0x69, 0x83, 0x7C, 0x64, 0x28, 0x7C, 0xBA, 0x0A, 0xAF, 0x0C, 0xA3, 0x24,
-  0x0F, 0x2A, 0xA4, 0x8A, 0xF2, 0xD1, 0x62, 0x02, 0x1B, 0x2A, 0xC7, 0x30, 0x8A, 0x07, 0xA8, 0xCB,
-  0xC0, 0xB1, 0xFD, 0x5A, 0x7D, 0x38, 0x92, 0x34, 0x0F, 0x48, 0xD4, 0x3C, 0xA8, 0xD7, 0xFD, 0x6D,
-  0xD6, 0xA8, 0xD1, 0x07, 0x7A, 0x61, 0xE3, 0x9C, 0x6A, 0x42, 0x0E, 0xB0, 0x4A, 0x8F, 0x1A, 0x67,
-  0x84, 0x0F, 0x2A, 0x33, 0xC0, 0xD4, 0x6B, 0xA5, 0x46, 0x33, 0x2B, 0xD2, 0x04, 0x31, 0x6B, 0x76,
-  0x2A, 0xA9, 0x18, 0xE6, 0xA1, 0x63, 0x14, 0xDB, 0xF2, 0xDF, 0x95, 0xBE, 0x02, 0x48, 0x04, 0x81,
-  0xE7, 0x08, 0x00, 0x2E, 0xEE, 0x08, 0x91, 0x01, 0x98, 0xDC, 0x17, 0x01, 0xE3, 0x6D, 0x37, 0xFD,
-  0x9A, 0x29, 0xB6, 0xA2, 0xB6, 0xE2, 0x37, 0xC7, 0x8A, 0xCC, 0x9F, 0x75, 0xD3, 0x94, 0x81, 0x4F,
-  0x21, 0x27, 0x9A, 0xD9, 0x2D, 0x71, 0xAA, 0xDD, 0x33, 0xD6, 0x11, 0xC0, 0x23, 0xF0, 0xEC, 0x8D,
-  0xB8, 0xD6, 0xCC, 0xA6, 0x5B, 0xC3, 0xE7, 0xA0, 0x1E, 0x21, 0x9D, 0xC2, 0xBF, 0x6E, 0x75, 0x77,
-  0x91, 0xA8, 0x37, 0x06, 0xEC, 0x32, 0x38, 0x98, 0xEE, 0x64, 0x8D, 0xD3, 0x10, 0xD0, 0x89, 0xFB,
-  0x5C, 0x89, 0xE8, 0x02, 0x3B, 0x19, 0x17, 0x87, 0xA2, 0xD4, 0xD0, 0x19, 0x82, 0x51, 0x31, 0x81,
-  0x48, 0x0E, 0xD0, 0xA2, 0x5F, 0x89, 0x63, 0x45, 0x56, 0x4B, 0x6A, 0xB1, 0xAD, 0xD3, 0x81, 0x83,
-  0x41, 0x30, 0x58, 0x80, 0x82, 0x39, 0xB3, 0x1D, 0x32, 0x3E, 0xAB, 0x12, 0x1A, 0xEF, 0xC2, 0x3A,
-  0x0D, 0x2B, 0x11, 0xAF, 0xE2, 0x62, 0x95, 0x88, 0x89, 0x41, 0x91, 0x30, 0x85, 0xD2, 0x05, 0x08,
-  0x53, 0x54, 0x51, 0x46, 0x0A, 0x46, 0xDC, 0x44, 0x9B, 0x76, 0xB8, 0xCE, 0x68, 0x1D, 0x2C, 0x56,
-  0xA2, 0x03, 0x45, 0x11, 0x69, 0xD4, 0xC6, 0x08, 0xED, 0xA4, 0xF1, 0x4C, 0x4A, 0x17, 0xC3, 0x21,
-  0x37, 0x4C, 0x29, 0x46, 0x75, 0x79, 0xDF, 0x0C, 0x23, 0xC0, 0xC9, 0xF1, 0xF6, 0xF6, 0xEE, 0xF4,
-  0x7A, 0xFC, 0x22, 0xEA, 0x58, 0x89, 0x66, 0x91, 0xEC, 0x63, 0xFA, 0x52, 0xB0, 0x8A, 0xE4, 0x3C,
-  0x92, 0x37, 0xDA, 0xED, 0x36, 0xDB, 0x72, 0x65, 0x71, 0x27, 0x9F, 0x83, 0x14, 0x18, 0x78, 0x4C,
-  0x04, 0xC2, 0x01, 0x3D, 0xC7, 0x7A, 0x47, 0xE9, 0xEE, 0xF1, 0xAD, 0x94, 0xFC, 0xC1, 0xB4, 0xBE,
-  0x86, 0x46, 0x7B, 0xBA, 0x77, 0x23, 0x23, 0x9E, 0x1E, 0x89, 0x97, 0x31, 0xD9, 0x24, 0xAC, 0x18,
-  0xF4, 0xD6, 0x1F, 0xC1, 0x0D, 0x13, 0xBA, 0x38, 0x81, 0x65, 0x70, 0x6F, 0x1B, 0x94, 0x1B, 0xCB,
-  0x01, 0xDC, 0x72, 0x36, 0x4F, 0x2C, 0x21, 0xD0, 0xCE, 0x41, 0x26, 0x99, 0xE1, 0xB6, 0x3E, 0x8D,
-  0x92, 0x69, 0x0A, 0x52, 0xF1, 0x0A, 0xF1, 0x08, 0xE9, 0x4E, 0x56, 0x7B, 0x51, 0x69, 0x65, 0xD5,
-  0xD6, 0x27, 0x68, 0xBB, 0x9E, 0xFB, 0x30, 0x1A, 0xD1, 0x7E, 0x89, 0x7B, 0x70, 0x62, 0x06, 0xD3,
-  0xE6, 0x48, 0x95, 0x67, 0xD8, 0xE8, 0x0B, 0x3F, 0x24, 0xE8, 0x89, 0x31, 0xF3, 0xB9, 0x4F, 0xF2,
-  0xB0, 0x1E, 0xCC, 0x8C, 0x0D, 0x2A, 0x76, 0x13, 0x99, 0x57, 0x24, 0x48, 0x37, 0x4E, 0x14, 0x02,
-  0x4C, 0x78, 0xFF, 0x1C, 0x8E, 0x9D, 0xEB, 0xF9, 0xEE, 0xAD, 0x26, 0x9A, 0xD8, 0x02, 0x9F, 0x40,
-  0x1B, 0x83, 0x69, 0xAE, 0x5C, 0xA7, 0xF9, 0x73, 0x50, 0x45, 0x66, 0xB7, 0xF1, 0x91, 0xD0, 0xE4,
-  0x76, 0x85, 0x51, 0x02, 0xB4, 0xAD, 0x17, 0x78, 0xEB, 0xFE, 0xCB, 0xF9, 0x59, 0x3E, 0xB3, 0xD9,
-  0x82, 0x2E, 0x28, 0x63, 0xDC, 0xBB, 0x1D, 0xA8, 0x4C, 0x1F, 0x2A, 0xC2, 0x54, 0xCE, 0x32, 0xC6,
-  0x81, 0x31, 0x37, 0x87, 0x43, 0x6F, 0x48, 0xAE, 0xF9, 0xD3, 0xCE, 0xCF, 0x3B, 0xBF, 0x20, 0x94,
-  0xB8, 0xBF, 0x81, 0xD9, 0xEE, 0x66, 0xDB, 0x79, 0xF3, 0x24, 0x70, 0x9B, 0x17, 0x05, 0x24, 0x12,
-  0xB6, 0xED, 0xE6, 0xC5, 0xF2, 0x34, 0x1B, 0x39, 0x97, 0x45, 0xA8, 0x26, 0x51, 0x55, 0x9C, 0x8C,
-  0x7E, 0x3A, 0xCA, 0x7F, 0x21, 0x3F, 0x1B, 0x56, 0x53, 0xD5, 0xAB, 0xC3, 0xBC, 0xCB, 0x29, 0x24,
-  0xDD, 0xC6, 0x16, 0x9C, 0xB3, 0x7B, 0x37, 0xD5, 0xEE, 0x39, 0xF2, 0xEB, 0xCB, 0xC6, 0xA1, 0x9F,
-  0xF3, 0xE1, 0xD0, 0xCF, 0x2F, 0x06, 0x87, 0x7E, 0x2E, 0x89, 0x43, 0x3F, 0xBF, 0xE2, 0xD0, 0x24,
-  0x1C, 0xFA, 0x25, 0x1F, 0x0E, 0xFD, 0xF2, 0x62, 0x70, 0xE8, 0x97, 0x92, 0x38, 0xF4, 0xCB, 0x2B,
-  0x0E, 0xA5, 0x9D, 0x91, 0x41, 0x7E, 0x42, 0xE9, 0x5C, 0xCA, 0xE9, 0x79, 0xB0, 0x28, 0x5F, 0x41,
-  0x83, 0x95, 0x22, 0xD2, 0x2C, 0xB7, 0xE1, 0xF8, 0x9A, 0x0B, 0x21, 0x52, 0xBC, 0xE5, 0x8B, 0x40,
-  0x25, 0xB9, 0x8B, 0xA7, 0xA1, 0x13, 0xCD, 0x37, 0xBC, 0xD6, 0x88, 0x49, 0xD1, 0x2B, 0x4F, 0x2E,
-  0x4B, 0x59, 0xDF, 0xD0, 0x48, 0xD0, 0x4B, 0x48, 0xC7, 0xCA, 0xAA, 0x41, 0xD9, 0x48, 0x40, 0x4E,
-  0xFE, 0x2D, 0x80, 0x7D, 0x81, 0xE9, 0xEB, 0x8E, 0xFB, 0xB4, 0xE3, 0xA2, 0xE3, 0xAC, 0x32, 0x80,
-  0x8C, 0x49, 0xD4, 0x9B, 0x2D, 0x47, 0xE7, 0x4F, 0xD0, 0xBA, 0x58, 0xEE, 0x53, 0x44, 0x7D, 0x4A,
-  0x93, 0xCD, 0x1D, 0xD1, 0xE6, 0xA4, 0xBA, 0xA8, 0x37, 0xEA, 0xCD, 0x23, 0xB9, 0x53, 0x53, 0x2B,
-  0xF9, 0x66, 0x8F, 0x19, 0xCF, 0x4D, 0xAA, 0x32, 0x7E, 0x9E, 0xA6, 0x8B, 0xCF, 0xE2, 0x9C, 0x26,
-  0x7D, 0xE7, 0x9B, 0xBF, 0x53, 0xA2, 0xCD, 0xDC, 0xB8, 0x11, 0xB9, 0xA7, 0x84, 0xF5, 0xA2, 0x77,
-  0xF7, 0xEB, 0xF9, 0x9C, 0x53, 0xA2, 0x49, 0xA7, 0x72, 0x54, 0xA2, 0xE6, 0x2A, 0xCD, 0x53, 0xC7,
-  0x2C, 0x5E, 0xCC, 0x96, 0xC5, 0xEB, 0xD0, 0xB2, 0x44, 0x09, 0xD9, 0x3C, 0xA9, 0x30, 0xA7, 0x0C,
-  0xD9, 0x1C, 0x0D, 0x79, 0xB2, 0xA4, 0x21, 0x77, 0x69, 0xC8, 0xD3, 0x25, 0x8D, 0x86, 0xA9, 0x57,
-  0xF1, 0xE0, 0xBA, 0x1B, 0x68, 0xE2, 0xD2, 0xBF, 0x73, 0x9C, 0x2B, 0xC7, 0xEE, 0xDF, 0x39, 0x27,
-  0xFC, 0x4C, 0x62, 0x20, 0xF0, 0x91, 0x89, 0x13, 0x29, 0x94, 0xC4, 0xB9, 0xF4, 0xA4, 0x67, 0xE7,
-  0x1B, 0x5D, 0x57, 0x19, 0x64, 0xEC, 0x92, 0x68, 0x8E, 0x26, 0x24, 0xCD, 0x30, 0x92, 0x92, 0xC9,
-  0x7C, 0xED, 0x46, 0xAA, 0x7B, 0x34, 0x16, 0x1D, 0x1B, 0x46, 0x41, 0xEB, 0xD0, 0x14, 0xD7, 0x32,
-  0x6D, 0xA1, 0xB3, 0x0E, 0xFB, 0x0F, 0x6D, 0x5C, 0xF3, 0x9A, 0xB7, 0x01, 0x08, 0x28, 0xF8, 0x22,
-  0x67, 0x3E, 0x1A, 0x01, 0xE7, 0x7E, 0x46, 0x9F, 0xD6, 0xC5, 0x26, 0x07, 0x08, 0x00, 0xB2, 0xC4,
-  0xB6, 0xAC, 0x94, 0xA1, 0x19, 0x14, 0xA9, 0xB3, 0x4D, 0x26, 0xB8, 0xA8, 0x54, 0x91, 0xC7, 0x75,
-  0x38, 0x2D, 0x62, 0x92, 0x04, 0xBD, 0x2D, 0x17, 0xC5, 0x4C, 0xF1, 0x82, 0x2D, 0x73, 0xF3, 0xB8,
-  0xC9, 0x9E, 0xFF, 0xE5, 0xC2, 0x67, 0xEE, 0x4C, 0xBD, 0x5B, 0x68, 0xAC, 0xFE, 0x6E, 0xE1, 0x33,
-  0x65, 0xDD, 0x52, 0x77, 0x6C, 0xF3, 0xBD, 0x52, 0xE8, 0xAB, 0x5E, 0x4B, 0xDE, 0xFB, 0x6C, 0xF0,
-  0xAD, 0xC2, 0xE7, 0x68, 0xE5, 0xA3, 0x9B, 0x85, 0xDC, 0x94, 0x97, 0x87, 0xB3, 0x25, 0x6E, 0x16,
-  0x32, 0x46, 0x8B, 0x6E, 0x17, 0xAE, 0xAE, 0x06, 0xB9, 0x07, 0x5E, 0xFB, 0x4B, 0x08, 0x58, 0x4C,
-  0xFA, 0xDE, 0x01, 0x1F, 0xBD, 0xDE, 0x3A, 0x3C, 0x4F, 0xBD, 0x8E, 0xF1, 0x87, 0x2B, 0x4D, 0x90,
-  0xFE, 0xF3, 0xA6, 0x08, 0xA2, 0x66, 0x90, 0xD6, 0xA4, 0x82, 0x94, 0xD0, 0xBF, 0x29, 0x02, 0xA3,
-  0x88, 0x7D, 0xA6, 0x6C, 0x76, 0xDB, 0x32, 0x86, 0x97, 0x04, 0x0C, 0x8A, 0x5B, 0xF0, 0x54, 0xCB,
-  0x97, 0x63, 0x78, 0x89, 0x63, 0x06, 0xEA, 0x23, 0x0B, 0x45, 0x0D, 0x18, 0x60, 0xFD, 0x71, 0x23,
-  0x84, 0x42, 0x09, 0xE4, 0x50, 0x4D, 0x5F, 0x8C, 0x85, 0x57, 0x4A, 0xE4, 0x82, 0x24, 0xCF, 0x0B,
-  0xAC, 0x67, 0x20, 0x32, 0xED, 0xB3, 0xC5, 0x6C, 0xBE, 0x93, 0xC2, 0x8F, 0x41, 0x16, 0x97, 0x23,
-  0x31, 0x39, 0x54, 0x7E, 0x24, 0x49, 0x5A, 0x7A, 0x92, 0x13, 0x9E, 0x6E, 0xEB, 0xD9, 0xD4, 0xFB,
-  0xE3, 0xC2, 0x8D, 0x33, 0x09, 0xFE, 0xD8, 0x92, 0xAC, 0xBA, 0x32, 0x9B, 0x98, 0xC7, 0xB3, 0x7A,
-  0x7C, 0x39, 0x3E, 0xCF, 0x7D, 0x1A, 0x5F, 0x6B, 0xDE, 0x8F, 0x1D, 0x18, 0x0D, 0x1D, 0x28, 0xCB,
-  0x1D, 0xE1, 0xF3, 0x91, 0x3A, 0x62, 0x92, 0xC7, 0x17, 0x8E, 0x4D, 0xD9, 0x31, 0x95, 0x19, 0x3C,
-  0xB7, 0x2C, 0xD3, 0xF5, 0x1D, 0xD3, 0x88, 0xAA, 0x80, 0xC1, 0x84, 0xC3, 0x62, 0x61, 0x4A, 0x40,
-  0x89, 0x24, 0x2F, 0xD4, 0xB7, 0x34, 0x05, 0xB9, 0xF8, 0xFB, 0xF8, 0x7C, 0xE8, 0xD8, 0x01, 0x95,
-  0x0A, 0x51, 0x7E, 0xF9, 0xB8, 0x45, 0xB6, 0x51, 0x44, 0x70, 0x59, 0xB8, 0xF0, 0x52, 0x44, 0x80,
-  0xC9, 0x6D, 0xF2, 0x9D, 0xC9, 0xAE, 0xF7, 0x8A, 0xC8, 0x6E, 0xC5, 0x2F, 0xE4, 0x22, 0x4C, 0xCE,
-  0xBB, 0xA6, 0x7C, 0x37, 0x42, 0x39, 0x5F, 0x73, 0xC7, 0x27, 0xB2, 0xF0, 0x52, 0x82, 0xCF, 0xE2,
-  0x24, 0x79, 0x4B, 0xB8, 0xEF, 0x15, 0xB0, 0x22, 0x4F, 0x2E, 0xE5, 0x8E, 0xC4, 0x91, 0xAC, 0xE3,
-  0xDE, 0xA8, 0xC4, 0xED, 0x5F, 0x58, 0x74, 0x08, 0xB8, 0x09, 0x2A, 0x34, 0x45, 0xF8, 0x18, 0x45,
-  0x5B, 0x69, 0x96, 0x0E, 0x4D, 0x91, 0xBF, 0x60, 0x1A, 0x33, 0x99, 0x03, 0x9E, 0x33, 0x78, 0x44,
-  0x3C, 0xA7, 0xC4, 0x09, 0xB2, 0x08, 0x2D, 0xE7, 0xB2, 0x27, 0xF3, 0x34, 0x70, 0x63, 0x3B, 0x9A,
-  0x9A, 0xCC, 0xF4, 0xAF, 0x26, 0x4C, 0x01, 0x46, 0xFF, 0xE6, 0x07, 0x5D, 0xE1, 0x69, 0x94, 0x45,
-  0xFF, 0xDF, 0x64, 0x8D, 0x25, 0xE5, 0x31, 0x7B, 0x0C, 0xBF, 0x6D, 0x5B, 0x63, 0x8A, 0x67, 0x61,
-  0x6C, 0xCB, 0xF1, 0x6D, 0x7B, 0x94, 0xC7, 0x25, 0xE2, 0x46, 0x51, 0xCC, 0x36, 0x74, 0x87, 0x5F,
-  0x50, 0x8D, 0x98, 0xD0, 0x6D, 0x76, 0xC4, 0xCF, 0x06, 0xD0, 0xC3, 0x93, 0x2C, 0x26, 0x28, 0x03,
-  0x87, 0x54, 0x35, 0x43, 0x9C, 0x16, 0xF9, 0xB6, 0x6A, 0xEA, 0xEE, 0xCA, 0x75, 0x80, 0xDF, 0x0C,
-  0x12, 0xA3, 0x6E, 0x53, 0x10, 0x4F, 0x60, 0xCB, 0x17, 0xA8, 0x49, 0x54, 0xA4, 0x26, 0x5E, 0xD0,
-  0x30, 0x5A, 0x27, 0x6D, 0x39, 0x05, 0xF5, 0x58, 0x0F, 0xDA, 0x93, 0xAF, 0x0C, 0x58, 0xAA, 0xC2,
-  0xC0, 0x00, 0xC3, 0xF9, 0x26, 0x5C, 0xFC, 0x31, 0xAA, 0x8A, 0xB4, 0x81, 0x4A, 0xDF, 0xB3, 0x53,
-  0x5D, 0x6C, 0x3E, 0x81, 0x37, 0x27, 0x10, 0x38, 0xCB, 0x95, 0x21, 0x29, 0x9B, 0xD0, 0x2D, 0xE8,
-  0xE2, 0xB8, 0x7D, 0x9A, 0xA6, 0x73, 0x78, 0xB4, 0xA6, 0x64, 0x0E, 0x33, 0xCB, 0xA0, 0x72, 0xCD,
-  0x30, 0xF2, 0x12, 0xB8, 0xA2, 0x90, 0xBC, 0xE4, 0xFD, 0x4A, 0x7C, 0x45, 0x88, 0x6F, 0x49, 0x9A,
-  0xB5, 0x26, 0xB7, 0x56, 0xEE, 0x6C, 0x0E, 0x41, 0x7B, 0x3C, 0xF7, 0xA2, 0x42, 0x8E, 0x7C, 0xC5,
-  0xBF, 0x69, 0x98, 0xAD, 0x61, 0x5E, 0x39, 0x7B, 0x71, 0xC4, 0x70, 0x66, 0xFA, 0x82, 0xCA, 0xDF,
-  0x45, 0xA7, 0x14, 0xC5, 0x85, 0x28, 0x79, 0x59, 0x41, 0x25, 0x44, 0x43, 0x29, 0x3E, 0x27, 0x44,
-  0xE6, 0xE8, 0xB0, 0x0A, 0xFC, 0x80, 0x72, 0x8E, 0x51, 0xCA, 0x15, 0x47, 0x50, 0x4D, 0x28, 0xBB,
-  0x2F, 0x43, 0x65, 0x65, 0x74, 0xAF, 0xE9, 0x0F, 0xE5, 0x49, 0x85, 0x74, 0xA3, 0xD9, 0x4F, 0x0C,
-  0x70, 0x8D, 0x53, 0x5E, 0x2E, 0xBF, 0xC6, 0x8E, 0x87, 0x98, 0x52, 0x8F, 0x48, 0xC0, 0x50, 0x88,
-  0x8F, 0xD4, 0xD1, 0xE5, 0x3D, 0x4C, 0xBC, 0x02, 0x73, 0xF4, 0x28, 0x60, 0x44, 0x9A, 0x1A, 0x71,
-  0x8A, 0x9B, 0xEB, 0x93, 0x51, 0xDE, 0x98, 0xB2, 0xBF, 0x10, 0x57, 0xB9, 0x24, 0xEA, 0x17, 0x32,
-  0xA7, 0x24, 0x9A, 0xBE, 0x34, 0x63, 0x9B, 0x5A, 0xDC, 0x6D, 0x18, 0x26, 0x34, 0x29, 0x2D, 0xAB,
-  0x62, 0x0D, 0xCF, 0xE3, 0x08, 0xD1, 0x28, 0x32, 0xC1, 0xE6, 0x3A, 0xB0, 0x06, 0x3C, 0xDA, 0x94,
-  0x56, 0x6D, 0x14, 0xE1, 0x12, 0xE1, 0x47, 0x77, 0x80, 0xEF, 0xE8, 0x74, 0x78, 0x8E, 0xF3, 0x09,
-  0x20, 0x38, 0x5B, 0x8C, 0x22, 0xE3, 0x7D, 0xD3, 0x18, 0xEB, 0x4F, 0x95, 0xF4, 0x8E, 0x1D, 0xCC,
-  0xAA, 0x9C, 0x54, 0xF8, 0x02, 0x7C, 0x63, 0x76, 0x3D, 0x25, 0xD3, 0x16, 0xE7, 0x20, 0xEA, 0x58,
-  0xC5, 0x33, 0xDC, 0x3F, 0x62, 0x17, 0x00, 0x2E, 0xB1, 0xF5, 0xBE, 0x51, 0x3B, 0x04, 0xD8, 0xCB,
-  0x4F, 0xEC, 0xAA, 0x7A, 0x82, 0x93, 0xD8, 0x3A, 0xF8, 0x80, 0xCF, 0xEE, 0xBE, 0xB6, 0x1B, 0xF5,
-  0x83, 0xAD, 0xFD, 0x66, 0xED, 0xC3, 0xBB, 0x17, 0xE9, 0x11, 0xB6, 0x3A, 0xE6, 0x93, 0x22, 0xB2,
-  0x32, 0x4C, 0x28, 0xD9, 0xC5, 0x8B, 0xB4, 0xFC, 0x03, 0x3E, 0xFF, 0x8A, 0xA2, 0x75, 0x19, 0xF1,
-  0x44, 0x49, 0xBA, 0x5B, 0xAB, 0xE7, 0x2B, 0xD3, 0x4D, 0x7A, 0xA1, 0x8C, 0xDD, 0x26, 0xEE, 0x71,
-  0x9A, 0xE2, 0x1E, 0xC4, 0x2A, 0x82, 0x61, 0x9A, 0x53, 0x48, 0xDD, 0x77, 0x3B, 0xC1, 0x72, 0x64,
-  0x16, 0x33, 0x12, 0x59, 0xE4, 0xD7, 0x24, 0x79, 0xA3, 0x23, 0xA8, 0xC7, 0xB8, 0x21, 0xEB, 0x0B,
-  0x6F, 0x33, 0x7F, 0x80, 0xFA, 0x31, 0xA6, 0x6C, 0x44, 0xA2, 0x44, 0x4B, 0x34, 0x85, 0xC8, 0x82,
-  0xAC, 0x5D, 0x7B, 0x25, 0xF1, 0x39, 0x5A, 0xFE, 0x22, 0xD4, 0x0D, 0x73, 0xDE, 0x15, 0xBF, 0xB6,
-  0x51, 0x5D, 0x2C, 0x8D, 0xB2, 0xC9, 0xF5, 0x62, 0x39, 0xD4, 0x1D, 0x7A, 0xBD, 0x86, 0xFE, 0x03,
-  0x95, 0x32, 0xD7, 0x76, 0xE4, 0x6D, 0xBF, 0x62, 0xDA, 0xFE, 0x0C, 0x2A, 0xAE, 0x0C, 0x07, 0xA7,
-  0xAC, 0x31, 0x4C, 0x63, 0xE1, 0xD2, 0xC2, 0x83, 0x58, 0xEA, 0xD5, 0x18, 0x6F, 0xAE, 0xC4, 0x85,
-  0x28, 0x2D, 0x23, 0xB9, 0x68, 0xC7, 0xDD, 0xB0, 0xD1, 0x9D, 0xFB, 0x0F, 0x48, 0x85, 0x07, 0x0B,
-  0x8C, 0x63, 0x88, 0x10, 0xAC, 0x54, 0x2C, 0x43, 0xD8, 0xFA, 0x35, 0x9E, 0x61, 0xE1, 0x84, 0x34,
-  0xFF, 0x78, 0x86, 0x2B, 0x4D, 0xEC, 0xE0, 0xCD, 0x37, 0x5E, 0xF0, 0xBD, 0x86, 0x35, 0xAC, 0x28,
-  0xAC, 0x21, 0xA4, 0xA0, 0x9C, 0xA1, 0x0D, 0xB9, 0xB7, 0x27, 0xBE, 0xB9, 0x73, 0x8F, 0x84, 0x18,
-  0x9D, 0x4A, 0xD9, 0xD1, 0x10, 0xA3, 0xEF, 0xD7, 0x2C, 0x22, 0x62, 0xAF, 0x5E, 0xAB, 0x7F, 0xA8,
-  0x37, 0x3F, 0xEC, 0xBD, 0xFF, 0xC0, 0xAA, 0x8D, 0xFA, 0x7E, 0xAD, 0x71, 0xB8, 0x5F, 0xDF, 0x7F,
-  0x7F, 0xD0, 0x60, 0x8D, 0xFD, 0x03, 0xF8, 0xEE, 0xF0, 0xC3, 0x7C, 0xC3, 0x21, 0x96, 0x30, 0x5E,
-  0x18, 0x0B, 0xB1, 0x84, 0xA1, 0x72, 0x04, 0x42, 0x4C, 0x9C, 0x45, 0xA1, 0x7B, 0xF4, 0x72, 0x33,
-  0x7E, 0x8D, 0x82, 0x98, 0x10, 0x05, 0x31, 0x2E, 0x44, 0xCE, 0x3D, 0x12, 0x22, 0x1C, 0x62, 0x01,
-  0xD1, 0x10, 0x8B, 0x9E, 0x7D, 0x7C, 0x8C, 0xC5, 0x44, 0x45, 0x2C, 0x7A, 0x05, 0xC9, 0x51, 0x36,
-  0x3E, 0x3A, 0x22, 0x7E, 0x74, 0xFD, 0x61, 0x82, 0x24, 0x16, 0x92, 0x62, 0x6D, 0xE1, 0xB5, 0x85,
-  0x3B, 0xDC, 0xBB, 0xC7, 0x9A, 0x7F, 0x89, 0xDA, 0xC2, 0xF2, 0xE1, 0xD2, 0x6A, 0x0B, 0x87, 0x73,
-  0x58, 0x4D, 0x6D, 0x61, 0x9F, 0x46, 0x47, 0xC1, 0x3B, 0x70, 0x09, 0xB9, 0x43, 0x5B, 0xF8, 0x5B,
-  0x7F, 0xAC, 0xC8, 0x30, 0x25, 0x4F, 0x1D, 0x2B, 0x31, 0xFC, 0x95, 0x52, 0xAA, 0xC9, 0x1A, 0xC3,
-  0x52, 0x9A, 0x17, 0xE8, 0xE0, 0xA1, 0xE9, 0x98, 0xA0, 0x4C, 0x29, 0xC4, 0xC9, 0x7E, 0x02, 0x99,
-  0xB7, 0xCC, 0x4E, 0x94, 0x37, 0x7E, 0x39, 0x75, 0x87, 0xE5, 0x86, 0xAE, 0xBC, 0xEE, 0xB0, 0x9C,
-  0x46, 0xAC, 0x24, 0xEE, 0xAF, 0xF5, 0x55, 0x57, 0x1E, 0x66, 0x8D, 0x75, 0x2C, 0xD2, 0x97, 0x05,
-  0xA8, 0x62, 0x45, 0xD4, 0x32, 0x7A, 0x78, 0x11, 0x85, 0xFA, 0x12, 0xEB, 0xC2, 0xC2, 0xB8, 0xAB,
-  0x45, 0x21, 0x9C, 0xC1, 0xF2, 0x51, 0x28, 0x5F, 0x0D, 0xE2, 0x2C, 0x50, 0x3D, 0x03, 0x89, 0x64,
-  0x0F, 0x2F, 0x0F, 0x89, 0xB0, 0xC0, 0xE9, 0x6A, 0x91, 0x88, 0x8A, 0xC9, 0xAE, 0x3F, 0x1F, 0x52,
-  0x80, 0x7A, 0x06, 0x0A, 0xC9, 0x1E, 0x5E, 0x26, 0x0A, 0xB5, 0xBF, 0xAF, 0x01, 0x12, 0xB5, 0xBF,
-  0x6F, 0x08, 0x1E, 0x11, 0xB4, 0x9E, 0x89, 0x49, 0xD8, 0xC7, 0x4B, 0xC2, 0xA5, 0x51, 0xC1, 0x53,
-  0x80, 0xCD, 0x82, 0x2B, 0x13, 0xAF, 0x35, 0x9A, 0x24, 0x00, 0x51, 0x0A, 0x49, 0xE2, 0x3D, 0xBC,
-  0x4C, 0x14, 0x79, 0x36, 0xBB, 0x59, 0x4E, 0x85, 0xE2, 0x67, 0xE0, 0xD9, 0x02, 0x6B, 0x14, 0x67,
-  0x43, 0xF3, 0x99, 0x98, 0xB6, 0x6A, 0x76, 0x34, 0xF5, 0x26, 0x7D, 0x91, 0x3A, 0x5C, 0x63, 0xE5,
-  0x3A, 0x5C, 0x73, 0x33, 0x74, 0xB8, 0xC6, 0xB3, 0x75, 0xB8, 0xC6, 0x0B, 0xD5, 0xE1, 0x1A, 0x2B,
-  0xD7, 0xE1, 0x9A, 0x9B, 0xA2, 0xC3, 0x35, 0x9E, 0xAD, 0xC3, 0x35, 0x5E, 0xA8, 0x0E, 0xD7, 0x58,
-  0xB9, 0xF8, 0xDD, 0xDC, 0x0C, 0x1D, 0xAE, 0xF1, 0x6C, 0x1D, 0xAE, 0xF1, 0x62, 0x75, 0xB8, 0xC6,
-  0x3A, 0xE8, 0x70, 0xCD, 0x4D, 0xD1, 0xE1, 0x1A, 0x73, 0xD0, 0xE1, 0x1A, 0x2F, 0x54, 0x87, 0x6B,
-  0x2C, 0x5C, 0x87, 0x6B, 0x6E, 0x86, 0x0E, 0xD7, 0x78, 0xB6, 0x0E, 0xD7, 0x78, 0xB1, 0x3A, 0x5C,
-  0x63, 0x13, 0x74, 0xB8, 0xE6, 0xA6, 0xE8, 0x70, 0x8D, 0x39, 0xE8, 0x70, 0x2B, 0xC5, 0x35, 0x2C,
-  0x03, 0x7B, 0xE1, 0x78, 0xAC, 0x17, 0x88, 0xC0, 0xE3, 0x8C, 0xEA, 0xCB, 0xFA, 0xD3, 0xCA, 0xB1,
-  0x45, 0xD7, 0x7C, 0x9A, 0x65, 0x39, 0x0F, 0xDF, 0xCD, 0x0B, 0xF3, 0x2B, 0xAC, 0xE8, 0x1C, 0xEF,
-  0x3F, 0x6D, 0x2E, 0x66, 0xDE, 0xE3, 0x4E, 0xBF, 0xD6, 0x6E, 0x14, 0x49, 0xBE, 0x97, 0xFB, 0xAE,
-  0x9B, 0x20, 0x0F, 0xBC, 0x1F, 0x27, 0x7B, 0xE3, 0x88, 0x70, 0xAE, 0x95, 0x16, 0x5E, 0x03, 0xE3,
-  0x43, 0x8A, 0x14, 0x88, 0xDF, 0x7B, 0xB3, 0x2A, 0x55, 0x24, 0x0D, 0xDF, 0xCC, 0xEF, 0xFD, 0xFB,
-  0x9C, 0xEB, 0xF0, 0x18, 0x82, 0x64, 0x4D, 0x36, 0x67, 0xDC, 0xF9, 0xDC, 0x7C, 0x3F, 0xD4, 0x55,
-  0xF9, 0x57, 0x9B, 0xDD, 0xDE, 0xFD, 0x05, 0x6B, 0x6D, 0x19, 0x81, 0x2E, 0xC2, 0x82, 0xF7, 0x03,
-  0x0D, 0xA3, 0x3C, 0xD4, 0xDC, 0x80, 0xE4, 0x6C, 0x1B, 0xEF, 0xB6, 0xEF, 0x4D, 0xF1, 0xB4, 0xCD,
-  0x9E, 0x9C, 0x80, 0x6E, 0xC0, 0x83, 0x10, 0xBA, 0x58, 0x99, 0x8B, 0x6B, 0x14, 0x0B, 0x12, 0x35,
-  0x19, 0x83, 0x78, 0xF7, 0x49, 0xC6, 0x6F, 0xCB, 0xE2, 0xA7, 0xA6, 0xCF, 0xA4, 0xD7, 0x58, 0xC6,
-  0x8D, 0x78, 0xA5, 0x84, 0x2B, 0xCC, 0x3C, 0x7D, 0x47, 0xE6, 0x90, 0x63, 0x40, 0x7E, 0x3D, 0xB1,
-  0xD2, 0xF2, 0xAC, 0x6B, 0xF6, 0x29, 0x1D, 0x2B, 0x2F, 0xA6, 0xC8, 0xAD, 0xA8, 0xCF, 0xC5, 0xF5,
-  0xA8, 0xAC, 0x37, 0xA6, 0xA7, 0xA4, 0x44, 0x00, 0x49, 0x17, 0xA6, 0xA1, 0x41, 0xBF, 0x9C, 0x40,
-  0x20, 0xEB, 0x99, 0x58, 0xED, 0x7A, 0xBA, 0x67, 0x45, 0x8E, 0xCA, 0xD7, 0x13, 0xAA, 0x5C, 0x63,
-  0x24, 0xBD, 0xF4, 0x14, 0xB8, 0xF6, 0xFB, 0x38, 0xC5, 0xE9, 0x23, 0x15, 0x2A, 0x84, 0x3D, 0xDE,
-  0xF7, 0xF4, 0x8D, 0xA3, 0xDA, 0x75, 0xB7, 0xE4, 0x5F, 0xFD, 0xD1, 0x7C, 0x4E, 0x35, 0xEB, 0xD1,
-  0x5E, 0xCE, 0xF2, 0xDF, 0x9A, 0xAF, 0x6B, 0x0B, 0x2D, 0x00, 0x63, 0xAA, 0x3C, 0x60, 0xE4, 0x43,
-  0x53, 0xC4, 0x32, 0x16, 0x50, 0x74, 0xA7, 0x86, 0xE1, 0x1B, 0x86, 0xA4, 0x29, 0xA4, 0xC8, 0xC6,
-  0x97, 0xDF, 0x89, 0x18, 0x55, 0xF1, 0x77, 0x9F, 0x35, 0xEA, 0xF5, 0xFD, 0x6D, 0xF8, 0xF9, 0x7E,
-  0x0F, 0x7F, 0x1E, 0xD2, 0xCF, 0x0F, 0xF8, 0xB3, 0xD1, 0xDC, 0x93, 0xD1, 0x57, 0xF5, 0x5A, 0xD8,
-  0xA8, 0xD1, 0xDC, 0xAD, 0xAB, 0x30, 0x2E, 0xE5, 0xC1, 0x0E, 0x67, 0x02, 0x25, 0x55, 0xC0, 0x6F,
-  0x29, 0x4D, 0x85, 0x1F, 0x96, 0x11, 0x7E, 0x80, 0xF1, 0x6D, 0x83, 0xFC, 0x81, 0xD1, 0x1F, 0x4C,
-  0x68, 0xA6, 0xE5, 0x78, 0x2A, 0x19, 0x82, 0x9A, 0x2B, 0xC6, 0x8F, 0xEF, 0xC0, 0xB9, 0x22, 0x77,
-  0x21, 0x9C, 0xD1, 0xA8, 0x8A, 0x30, 0xD5, 0x0D, 0x6E, 0xD6, 0xE3, 0xC9, 0x16, 0x62, 0xB5, 0x97,
-  0x19, 0x95, 0x56, 0x46, 0xCE, 0x01, 0xFC, 0xC4, 0x33, 0x0D, 0x83, 0xDB, 0xF8, 0x3E, 0xCE, 0x95,
-  0xB2, 0xAD, 0x60, 0xA5, 0x3F, 0x84, 0x00, 0x96, 0x34, 0xDC, 0x2C, 0xAF, 0x9A, 0xA9, 0xB5, 0xCE,
-  0x8B, 0x60, 0xF8, 0x94, 0xD2, 0xE7, 0x23, 0xA7, 0x6D, 0x4A, 0x50, 0x22, 0x1C, 0xF7, 0x68, 0x5F,
-  0xFA, 0x6C, 0xCF, 0x3E, 0xCB, 0x93, 0x4D, 0xBB, 0x0E, 0xE0, 0xFB, 0x30, 0x6C, 0x5D, 0xCE, 0xEF,
-  0x32, 0xDB, 0xC7, 0x32, 0x96, 0xD7, 0xC4, 0xE3, 0x3E, 0x17, 0x77, 0x0E, 0x22, 0x8A, 0x3A, 0x20,
-  0x28, 0x27, 0xEB, 0x2D, 0x3E, 0x86, 0x5D, 0xCF, 0x75, 0x42, 0x84, 0x0D, 0xF3, 0xB9, 0x58, 0xE6,
-  0x4D, 0x1B, 0xB3, 0x3A, 0x60, 0x5C, 0x39, 0x0F, 0x27, 0x21, 0x89, 0x21, 0x60, 0x22, 0x80, 0xE4,
-  0x3B, 0xEF, 0x1D, 0x06, 0x1D, 0xB0, 0xA8, 0x07, 0xA0, 0x3A, 0xFB, 0x47, 0x21, 0xD0, 0xCC, 0x86,
-  0x0D, 0xE2, 0xED, 0x30, 0x79, 0x1C, 0x55, 0x16, 0xED, 0x59, 0x99, 0xE3, 0x71, 0xD6, 0x20, 0x24,
-  0x19, 0x57, 0xC3, 0x7F, 0x20, 0xA5, 0xD8, 0x3E, 0x70, 0x2D, 0x49, 0x68, 0xB1, 0xE7, 0xE9, 0x23,
-  0x3C, 0x4E, 0x61, 0x06, 0x68, 0x6E, 0xA6, 0xC1, 0xFA, 0x9A, 0x9B, 0xE9, 0xED, 0x16, 0x6E, 0xF6,
-  0x04, 0x7F, 0xE2, 0xF4, 0xE9, 0x2B, 0xCB, 0x8F, 0xD3, 0x34, 0x42, 0xB7, 0xBA, 0x3C, 0x67, 0x6E,
-  0x26, 0x68, 0xB2, 0xCF, 0xE1, 0x4E, 0xA2, 0xF3, 0x42, 0xC7, 0x6C, 0xA2, 0x69, 0xE6, 0x90, 0xA9,
-  0xA8, 0x18, 0xDB, 0xB1, 0x27, 0x6D, 0x7D, 0x02, 0xD4, 0x81, 0x4C, 0x04, 0x80, 0x87, 0x71, 0x6C,
-  0xFD, 0x78, 0xF8, 0x56, 0x9E, 0x73, 0x3A, 0x67, 0xE3, 0x75, 0x16, 0x6A, 0xCC, 0xE4, 0xBF, 0x89,
-  0xA5, 0x67, 0x8C, 0x34, 0x99, 0xE5, 0xB6, 0x56, 0xE3, 0xF4, 0x2B, 0x27, 0x7C, 0x11, 0xA0, 0x9A,
-  0x57, 0x69, 0x29, 0x68, 0xCB, 0x8F, 0xCB, 0xF0, 0xF7, 0x4D, 0x0E, 0x9F, 0x43, 0x2A, 0x02, 0xC1,
-  0xE3, 0xFD, 0xDC, 0x7C, 0x7E, 0x39, 0x70, 0xCD, 0xAE, 0x83, 0xFB, 0x70, 0x79, 0xFD, 0x0D, 0x79,
-  0xDE, 0x50, 0x03, 0x2D, 0x1C, 0xFE, 0x1F, 0xD5, 0x25, 0x26, 0x61, 0x81, 0xB2, 0x3B, 0x61, 0x62,
-  0x0B, 0x5B, 0xBB, 0x07, 0x49, 0x85, 0xF2, 0x31, 0xB1, 0xAF, 0x18, 0x52, 0xA8, 0xB9, 0x2E, 0x70,
-  0x5D, 0x72, 0x95, 0x46, 0x5F, 0xE0, 0x00, 0xD8, 0xBB, 0x23, 0x30, 0x40, 0x16, 0xD5, 0x1C, 0x10,
-  0x5E, 0x08, 0x5F, 0x41, 0x68, 0xF9, 0x8E, 0x75, 0x92, 0x0D, 0xDE, 0x07, 0x29, 0x88, 0x47, 0x9D,
-  0x6B, 0x16, 0xFA, 0x04, 0x53, 0x45, 0x6F, 0x94, 0x47, 0x80, 0x0A, 0xAA, 0xB1, 0x1E, 0x54, 0xD7,
-  0xAA, 0x83, 0xA2, 0x8A, 0xCF, 0x2A, 0x64, 0x96, 0x25, 0x23, 0x30, 0xC2, 0x0A, 0xF6, 0x8D, 0x72,
-  0x82, 0x1C, 0x5B, 0x66, 0xDF, 0x46, 0x24, 0xA8, 0xB4, 0x8E, 0xE1, 0x31, 0xED, 0x27, 0xD9, 0x55,
-  0x58, 0xF4, 0xCD, 0x62, 0xD1, 0x79, 0xC2, 0x64, 0x96, 0x24, 0xE7, 0xE3, 0x9A, 0x31, 0xAF, 0x81,
-  0x4E, 0x79, 0x57, 0x4C, 0x10, 0x76, 0x85, 0xD9, 0x7B, 0x62, 0x03, 0x38, 0xC2, 0x65, 0x62, 0x26,
-  0xD2, 0xD7, 0x19, 0x95, 0xF0, 0x0E, 0x28, 0x27, 0x0B, 0xE0, 0xDB, 0xA8, 0x38, 0xB6, 0x0A, 0xD3,
-  0xBE, 0xE7, 0xA0, 0xCE, 0x5B, 0xFC, 0x1F, 0x7F, 0xFF, 0x6F, 0x9F, 0xF5, 0x3C, 0x0C, 0xE8, 0x06,
-  0x95, 0x20, 0x7A, 0x2B, 0x86, 0x83, 0x32, 0x38, 0xC0, 0xD8, 0x44, 0xB1, 0x39, 0xB7, 0x0D, 0x35,
-  0x6E, 0x3F, 0x35, 0x87, 0xC1, 0xCF, 0xDA, 0x43, 0x25, 0x3B, 0x94, 0x7B, 0xBC, 0x38, 0xA7, 0xF6,
-  0xC0, 0x8E, 0x6D, 0x38, 0x78, 0x8F, 0xF2, 0x83, 0x67, 0x2A, 0x06, 0xC4, 0x98, 0x16, 0x86, 0x15,
-  0xF4, 0xA8, 0x3E, 0x3A, 0x62, 0xB8, 0x4C, 0x87, 0xA3, 0xE1, 0x58, 0xA4, 0x63, 0x3D, 0x69, 0x0F,
-  0xB5, 0xA2, 0xB6, 0xA1, 0x79, 0x19, 0x43, 0x66, 0x6F, 0xDE, 0x2C, 0xF2, 0x2B, 0x1B, 0x2C, 0x5F,
-  0xEC, 0x5E, 0x5B, 0xED, 0xE5, 0x8C, 0x2E, 0xDD, 0xD8, 0xBB, 0x65, 0x2D, 0xB2, 0xF3, 0x8A, 0xF3,
-  0x29, 0x81, 0xAD, 0x6D, 0x53, 0xE8, 0x83, 0xBC, 0xF8, 0x4A, 0x2F, 0xAF, 0x08, 0x63, 0x5D, 0x1C,
-  0xFB, 0x15, 0x67, 0x67, 0xE3, 0xAC, 0xDC, 0xD1, 0xBC, 0x58, 0x4B, 0x6F, 0x6F, 0x20, 0xDE, 0xDE,
-  0x82, 0x18, 0x9D, 0x17, 0x6D, 0xF1, 0xDD, 0x15, 0x61, 0x2D, 0x6C, 0x8C, 0xF5, 0x8A, 0xB4, 0xB3,
-  0x91, 0x96, 0xB6, 0x33, 0x2F, 0xCE, 0xE2, 0xCB, 0xAB, 0x46, 0xD9, 0xF9, 0x09, 0xA7, 0x7E, 0x4F,
-  0x09, 0xEA, 0xDF, 0x07, 0x9C, 0x5B, 0x67, 0xA6, 0x0A, 0xF7, 0xAB, 0xB4, 0xD4, 0x63, 0x46, 0xCF,
-  0xD9, 0x9D, 0x09, 0xE3, 0x45, 0xDF, 0xBE, 0x99, 0x6E, 0xA0, 0x12, 0xF2, 0xAD, 0xC5, 0x0A, 0xB2,
-  0x13, 0x27, 0xBE, 0x5A, 0x51, 0x16, 0xE5, 0xD3, 0x07, 0x02, 0x99, 0x40, 0x90, 0x19, 0xE1, 0xBC,
-  0x54, 0xE8, 0x24, 0x69, 0x68, 0x03, 0xAE, 0x61, 0xE2, 0xA1, 0x98, 0xA0, 0x7A, 0x41, 0x76, 0x8A,
-  0x4D, 0x15, 0x53, 0xE7, 0x89, 0x8D, 0xA7, 0xCE, 0xB0, 0x0B, 0xC4, 0x44, 0x9B, 0x8A, 0x48, 0xE7,
-  0x57, 0x5A, 0xEA, 0x51, 0x0C, 0x13, 0xFD, 0x45, 0xA3, 0x56, 0xC6, 0x2C, 0xDE, 0xCC, 0x95, 0x6F,
-  0x63, 0xAA, 0xA9, 0x2E, 0xF1, 0x6D, 0x8F, 0x6B, 0x5E, 0x0C, 0x63, 0xFC, 0xF8, 0xC5, 0x23, 0x20,
-  0xD3, 0x54, 0x94, 0x40, 0x94, 0xC2, 0xBD, 0x87, 0x76, 0x9B, 0x88, 0x4C, 0xE5, 0x8C, 0x9A, 0xD2,
-  0xA9, 0xA7, 0xCD, 0xBD, 0x1E, 0x26, 0x8A, 0x59, 0xB5, 0x6D, 0xD3, 0x75, 0x17, 0x64, 0xD7, 0x6C,
-  0xB7, 0x4B, 0xD9, 0x34, 0xA3, 0x66, 0xCF, 0xB4, 0x67, 0x4A, 0x3F, 0x8F, 0x04, 0x90, 0x53, 0x56,
-  0x4D, 0x37, 0xF6, 0xC6, 0x5A, 0xD9, 0x36, 0x23, 0x10, 0x14, 0xB4, 0x6B, 0x96, 0xB8, 0xB9, 0x3E,
-  0xA3, 0xD8, 0x79, 0x76, 0x79, 0x76, 0x14, 0x0A, 0x08, 0x03, 0xE8, 0xF0, 0x01, 0x16, 0x7B, 0x79,
-  0x36, 0x25, 0xA7, 0xD2, 0xCE, 0x31, 0x4A, 0x09, 0x53, 0x93, 0x22, 0x9D, 0x61, 0xEE, 0x75, 0x90,
-  0xE6, 0x4C, 0x8B, 0xFD, 0xE0, 0xF0, 0x27, 0xEC, 0x3F, 0x1C, 0x25, 0xD1, 0x30, 0x06, 0x7C, 0x7D,
-  0xCB, 0xD1, 0x0C, 0x08, 0x2C, 0x60, 0xCA, 0x48, 0x0E, 0xFB, 0x0B, 0xB4, 0x9E, 0x28, 0x93, 0xAC,
-  0x34, 0x8F, 0x43, 0x1C, 0xC5, 0x4E, 0xA3, 0x44, 0x03, 0x7E, 0x94, 0xD3, 0x21, 0xFE, 0xFD, 0x54,
-  0x66, 0x16, 0x6B, 0xBC, 0x0C, 0x5B, 0xF0, 0xC4, 0x79, 0x2F, 0x31, 0x0F, 0x84, 0xCA, 0x06, 0x9C,
-  0xA0, 0xD2, 0x51, 0xB2, 0x06, 0x5F, 0x9A, 0x83, 0x63, 0x46, 0xE0, 0x8D, 0x36, 0x89, 0xA9, 0xB2,
-  0xA1, 0x7D, 0x4F, 0x73, 0x07, 0xA6, 0x7E, 0xCB, 0xFB, 0xB0, 0xC4, 0x33, 0xCF, 0x71, 0x25, 0x3B,
-  0xC9, 0xA5, 0xB3, 0xA5, 0x9B, 0x53, 0x75, 0x53, 0xF5, 0x84, 0xC9, 0x47, 0xB3, 0xBD, 0xF7, 0x92,
-  0xC9, 0xC9, 0xC6, 0xBA, 0xCC, 0x9C, 0x67, 0x52, 0xF1, 0x30, 0xD4, 0xAC, 0x73, 0x55, 0x39, 0x4D,
-  0xA6, 0xC0, 0xAA, 0x57, 0x5A, 0xDF, 0x3A, 0xF9, 0xD2, 0x52, 0x8D, 0xE7, 0x21, 0x3B, 0xFF, 0x36,
-  0xBB, 0xE5, 0xEC, 0x24, 0x56, 0xF3, 0x45, 0xE3, 0x8E, 0x04, 0xE6, 0x93, 0x13, 0x78, 0x6C, 0x04,
-  0x35, 0x90, 0x87, 0xFA, 0xE4, 0x41, 0x45, 0xFE, 0x19, 0x52, 0xB9, 0x55, 0x89, 0xBF, 0x95, 0xFB,
-  0x87, 0x42, 0xFD, 0x9E, 0xC7, 0x7F, 0x0B, 0xB8, 0xAD, 0x3F, 0xC5, 0x90, 0xFB, 0x5B, 0x67, 0x9D,
-  0xF0, 0x5A, 0x8A, 0x14, 0xDE, 0x33, 0x90, 0xDE, 0x75, 0x3B, 0x5C, 0x60, 0xCE, 0x16, 0x7F, 0xE2,
-  0x89, 0xF6, 0x3C, 0x6E, 0x5D, 0xE8, 0x0E, 0x03, 0x4E, 0x92, 0x5B, 0x6E, 0xF3, 0x07, 0xCD, 0x52,
-  0x97, 0x17, 0xF0, 0x80, 0xA9, 0x27, 0x39, 0xF3, 0x21, 0x3E, 0xF7, 0xE6, 0x22, 0x3E, 0x85, 0x39,
-  0x19, 0x53, 0x66, 0x1A, 0x47, 0x14, 0xBA, 0x7E, 0x47, 0x8E, 0x4A, 0x47, 0x31, 0x12, 0x31, 0x83,
-  0xB5, 0x3A, 0x0F, 0xAC, 0x79, 0xC8, 0xF0, 0x24, 0xC6, 0x8B, 0x09, 0x3A, 0xA0, 0x9F, 0xB6, 0xE5,
-  0xDD, 0x5A, 0xA4, 0x17, 0x6A, 0x42, 0xF0, 0xA1, 0x4B, 0x09, 0x66, 0x95, 0xBF, 0x21, 0xFE, 0xF9,
-  0xF6, 0x8B, 0x33, 0xE4, 0x6F, 0xC9, 0xCF, 0x70, 0x9B, 0x39, 0x78, 0xB3, 0xA1, 0x61, 0x3F, 0xDB,
-  0xF8, 0x9D, 0x87, 0xEB, 0xA3, 0x81, 0x0A, 0x73, 0xED, 0x15, 0x9A, 0x72, 0x96, 0xE0, 0x1C, 0x1E,
-  0x97, 0x37, 0xA5, 0xDC, 0xD5, 0xF6, 0x9C, 0x9E, 0x69, 0xF1, 0x3B, 0xE7, 0x07, 0xB7, 0xE7, 0x10,
-  0x8F, 0x32, 0x9E, 0xC6, 0x58, 0x89, 0x77, 0x6A, 0x1C, 0x46, 0x03, 0x1D, 0xAD, 0xC8, 0xA5, 0xF5,
-  0xB2, 0x27, 0x59, 0xA5, 0xE3, 0xF5, 0x35, 0xDB, 0xFC, 0x5D, 0x8A, 0xE2, 0x03, 0xCD, 0xC7, 0xC4,
-  0x4E, 0x8E, 0xE7, 0x3A, 0xE4, 0x47, 0x06, 0x4C, 0xD3, 0xEE, 0x77, 0x04, 0xE8, 0x94, 0x43, 0x36,
-  0x26, 0x1F, 0x68, 0xBA, 0x8E, 0xF6, 0xC1, 0x6D, 0xE9, 0xA9, 0x6A, 0x92, 0x90, 0xE0, 0x71, 0xF2,
-  0x7C, 0x45, 0xAA, 0xA4, 0xDE, 0xF5, 0xC0, 0x07, 0xF4, 0x55, 0x39, 0xA1, 0xF0, 0x3E, 0x8E, 0x16,
-  0x2E, 0x70, 0xE1, 0x71, 0x74, 0x04, 0x94, 0x7E, 0x62, 0x55, 0x16, 0xDE, 0x4E, 0x77, 0x5C, 0xCD,
-  0xFB, 0x71, 0x11, 0xD8, 0x12, 0x42, 0x9B, 0xE1, 0xEA, 0xFA, 0x9C, 0x88, 0x90, 0xF7, 0x73, 0xF6,
-  0xD4, 0x9F, 0x81, 0xDA, 0xB9, 0xBD, 0xF5, 0xA7, 0xF7, 0xB3, 0x78, 0x8F, 0xFD, 0x85, 0x3B, 0x34,
-  0x61, 0x60, 0xA6, 0xBF, 0x52, 0x9D, 0x7F, 0xDE, 0x5A, 0x3E, 0x2E, 0xA8, 0x9C, 0xA2, 0x1F, 0x6B,
-  0x39, 0x49, 0x85, 0x1F, 0x01, 0x6B, 0x4C, 0x77, 0xC7, 0xC6, 0x6B, 0xA5, 0xB4, 0x4F, 0x5D, 0x4E,
-  0x39, 0xBD, 0x9D, 0x06, 0x20, 0x7F, 0x5E, 0xEC, 0xFD, 0x74, 0xA0, 0xC1, 0x01, 0x6C, 0x45, 0x8A,
-  0x43, 0xD8, 0xDF, 0xAC, 0xB4, 0x6E, 0xB1, 0x23, 0x28, 0xEA, 0xEB, 0x44, 0x0B, 0xE0, 0x30, 0xA6,
-  0x02, 0x76, 0x32, 0x2E, 0x1A, 0x1F, 0x90, 0x07, 0xF6, 0x11, 0x2B, 0xA8, 0x46, 0x24, 0xFB, 0x4C,
-  0x4E, 0x59, 0x3E, 0xCA, 0x52, 0x20, 0x8A, 0xE9, 0x0E, 0x7B, 0x87, 0x75, 0x50, 0x1F, 0xF0, 0x67,
-  0x29, 0x05, 0xE2, 0xC3, 0x01, 0x36, 0xC7, 0x9F, 0xE5, 0xF4, 0x8F, 0x0F, 0x4D, 0x6C, 0x4F, 0xBF,
-  0x4A, 0x75, 0xB0, 0x7B, 0xB8, 0x87, 0x1D, 0xD0, 0xAF, 0x52, 0x1D, 0xEC, 0xBF, 0xA7, 0x15, 0xD0,
-  0xAF, 0x72, 0x4B, 0x68, 0xEC, 0xCB, 0x35, 0xD0, 0xEF, 0x52, 0x5D, 0x34, 0x77, 0xEB, 0xB4, 0x0A,
-  0xF9, 0xBB, 0x54, 0x17, 0x7B, 0x07, 0x75, 0xB9, 0x91, 0xF4, 0xBB, 0xDC, 0x56, 0x36, 0x1B, 0x72,
-  0x33, 0xE9, 0xF7, 0xFA, 0x29, 0x85, 0x77, 0xE4, 0xF1, 0x0F, 0xB4, 0x44, 0xE2, 0x0C, 0xDE, 0x61,
-  0xA2, 0x7C, 0x71, 0x7B, 0x7C, 0x76, 0xF9, 0x95, 0x21, 0xD3, 0x0A, 0x3D, 0xF6, 0x75, 0x20, 0xE6,
-  0xBE, 0xF4, 0xC3, 0x07, 0x61, 0x5B, 0xC7, 0xFA, 0xA3, 0x58, 0x4D, 0x05, 0x53, 0x5F, 0x0E, 0x1C,
-  0x14, 0x5D, 0xD0, 0x23, 0x08, 0xC9, 0x28, 0x26, 0xB5, 0xD0, 0xF6, 0x77, 0x5D, 0xFF, 0x65, 0xE9,
-  0x88, 0x08, 0xEE, 0x39, 0xB1, 0xB7, 0x54, 0x57, 0x95, 0xD6, 0x75, 0xF0, 0xC8, 0xD4, 0x87, 0xC2,
-  0x7C, 0x2D, 0xDD, 0x59, 0xD6, 0x64, 0xE7, 0xC1, 0xDB, 0x00, 0x99, 0x6F, 0xAE, 0xCF, 0x8F, 0xCB,
-  0x5A, 0x46, 0xDA, 0xED, 0xCE, 0xCE, 0xF9, 0x3D, 0x06, 0x62, 0xDC, 0x01, 0x96, 0xF6, 0x31, 0x7B,
-  0x6C, 0x19, 0xE2, 0x96, 0xCB, 0x1B, 0x06, 0x8F, 0x6A, 0x65, 0x00, 0xF2, 0xCB, 0xE6, 0x69, 0x39,
-  0x6E, 0x07, 0xDA, 0xF5, 0xD9, 0xE9, 0xCE, 0xD9, 0xF1, 0xE9, 0x7A, 0x92, 0xE7, 0xD9, 0xF1, 0xDD,
-  0x71, 0x92, 0x16, 0x95, 0x84, 0xA1, 0x02, 0x68, 0x0C, 0xB3, 0x47, 0x9E, 0x78, 0x22, 0xE5, 0x19,
-  0x8A, 0xBB, 0x24, 0xAB, 0xAE, 0xA9, 0x17, 0x81, 0x5E, 0x4D, 0xCD, 0x62, 0x77, 0x3F, 0xED, 0xDC,
-  0xFE, 0x84, 0xF4, 0x6A, 0xA9, 0xE4, 0xF5, 0xF1, 0xF2, 0x47, 0x35, 0x86, 0x1B, 0xA4, 0xB6, 0x26,
-  0xD1, 0xDA, 0x0D, 0x40, 0x3A, 0x62, 0x2E, 0xC7, 0x7E, 0x60, 0x06, 0x06, 0x73, 0x02, 0x81, 0x02,
-  0x37, 0xAA, 0x3D, 0xFB, 0xB6, 0xAF, 0x3C, 0x56, 0x81, 0x89, 0x88, 0xB0, 0x31, 0xCA, 0xE3, 0x30,
-  0x0F, 0xD8, 0x97, 0xA8, 0x23, 0x54, 0x9F, 0x6C, 0xAA, 0x03, 0xA3, 0xFC, 0x5C, 0x3B, 0x67, 0xC7,
-  0x3B, 0x9D, 0xD3, 0x2B, 0x99, 0xED, 0x56, 0x97, 0x7B, 0x59, 0x93, 0x37, 0x8F, 0x3B, 0x67, 0xA6,
-  0x27, 0xEF, 0xC1, 0xE3, 0xD3, 0x48, 0xB8, 0xD2, 0x0A, 0x10, 0xBD, 0x35, 0x9D, 0xAE, 0x76, 0xD5,
-  0x16, 0x26, 0xDE, 0x55, 0xCA, 0x55, 0xCF, 0xF4, 0x86, 0x78, 0x45, 0x30, 0xC9, 0x73, 0x16, 0x01,
-  0xB5, 0x71, 0xF6, 0xD9, 0x90, 0xB2, 0x51, 0x64, 0x99, 0x07, 0x0F, 0x92, 0x12, 0xD6, 0x19, 0x6E,
-  0xC3, 0x33, 0x05, 0xAC, 0x44, 0x8F, 0x63, 0x73, 0x7D, 0x15, 0xAF, 0x5E, 0xC5, 0xAB, 0x3F, 0x8E,
-  0x78, 0x75, 0x69, 0x4B, 0x36, 0x8C, 0xD1, 0x84, 0xDB, 0x2A, 0xBC, 0x32, 0x2D, 0x6C, 0x8D, 0xF3,
-  0xF7, 0x89, 0xB2, 0x56, 0x8C, 0x81, 0xC5, 0xF8, 0x97, 0x84, 0xDF, 0x9A, 0x09, 0x5A, 0xB9, 0x98,
-  0x18, 0x56, 0x01, 0xF6, 0xE0, 0x18, 0x68, 0xE3, 0xD9, 0x32, 0xAF, 0x34, 0xE0, 0xF3, 0x35, 0xC4,
-  0xCB, 0x2B, 0xC8, 0xF3, 0xF8, 0x44, 0xA3, 0x0B, 0xD3, 0xF0, 0x29, 0xA3, 0xC7, 0x8B, 0xB7, 0xC8,
-  0x67, 0xCE, 0x65, 0xC9, 0x66, 0xF9, 0xCF, 0xDC, 0xE6, 0x84, 0xBE, 0x9A, 0x5C, 0x35, 0x3A, 0x86,
-  0xB0, 0x8E, 0x92, 0x08, 0xE0, 0x78, 0x86, 0xF7, 0x86, 0x2A, 0x88, 0x78, 0x18, 0x00, 0xEE, 0xF6,
-  0x28, 0xA7, 0xCE, 0xB6, 0x8C, 0xEF, 0x85, 0xFD, 0xC6, 0x28, 0xDC, 0x28, 0xBA, 0xA5, 0xC6, 0x6E,
-  0xF9, 0x6F, 0x81, 0xE9, 0x71, 0x7F, 0x54, 0x28, 0x3D, 0x1D, 0xD0, 0xAF, 0x4C, 0xF1, 0xB2, 0x83,
-  0x46, 0xBD, 0xBE, 0x5D, 0xAF, 0xD7, 0x03, 0x5F, 0x89, 0x23, 0xAA, 0xCE, 0x34, 0xCA, 0x20, 0x1F,
-  0xA2, 0xAF, 0xE4, 0x0C, 0xB8, 0x78, 0xE0, 0xDC, 0x96, 0xEF, 0xF9, 0xB5, 0x8D, 0xB6, 0xE4, 0x4F,
-  0x20, 0x95, 0x33, 0x8E, 0xE1, 0xD1, 0x7E, 0x61, 0x8A, 0x79, 0xD6, 0x0D, 0x41, 0x5A, 0x7E, 0x48,
-  0xCC, 0xEB, 0x0E, 0x20, 0x7F, 0x22, 0x01, 0x4F, 0x9F, 0x7F, 0x0D, 0xFC, 0x7C, 0x36, 0xF7, 0x12,
-  0x77, 0x05, 0x77, 0xE3, 0xBB, 0xCC, 0xB6, 0xFE, 0xDF, 0xFF, 0xF5, 0x73, 0xD4, 0x38, 0x7D, 0x4E,
-  0x9D, 0xBE, 0xFC, 0x06, 0xE9, 0xE2, 0x9E, 0xB1, 0x33, 0x61, 0x59, 0xA8, 0x72, 0xDF, 0xAC, 0xDE,
-  0x5E, 0x5A, 0x99, 0xDC, 0xC4, 0x7A, 0xAF, 0x88, 0x31, 0x2C, 0x12, 0xFF, 0xDA, 0x71, 0x06, 0x24,
-  0x11, 0x6F, 0x23, 0xF0, 0x6A, 0x04, 0x99, 0xF2, 0xD8, 0x14, 0xF5, 0xB1, 0x4E, 0x38, 0x44, 0x76,
-  0x76, 0x9C, 0xDD, 0xB9, 0xD1, 0xE7, 0x45, 0x55, 0xA2, 0x99, 0x08, 0xD5, 0x76, 0x2C, 0xCD, 0x33,
-  0xC5, 0xD3, 0x82, 0xF1, 0x29, 0x1C, 0xE6, 0xA8, 0x00, 0x93, 0x4A, 0x68, 0x5F, 0xD9, 0x93, 0x1E,
-  0xDF, 0xC2, 0xD1, 0x57, 0x25, 0xF4, 0xB1, 0xC9, 0xA6, 0xA1, 0x5B, 0x93, 0xDC, 0xAE, 0x71, 0x0B,
-  0x0A, 0x96, 0x74, 0x1B, 0xB3, 0x14, 0x5D, 0x68, 0x96, 0x55, 0xBC, 0xAF, 0x02, 0xA5, 0xE1, 0x16,
-  0x72, 0x6D, 0x8C, 0x16, 0x1B, 0x29, 0x9B, 0xF8, 0x66, 0x1F, 0x65, 0xC3, 0x07, 0x8C, 0xF0, 0x05,
-  0xA9, 0x7E, 0x00, 0x5D, 0x29, 0x37, 0x31, 0x9D, 0xCC, 0x17, 0x5B, 0x9E, 0x84, 0x15, 0x87, 0xF5,
-  0xBD, 0x93, 0x15, 0xB3, 0x1E, 0x92, 0x2F, 0xF4, 0x14, 0x04, 0xE8, 0x8D, 0x98, 0x48, 0x14, 0x03,
-  0xF2, 0x8B, 0x49, 0x73, 0xF4, 0x66, 0x3D, 0x04, 0xFC, 0x2F, 0xCA, 0x9D, 0x94, 0x4C, 0x94, 0x57,
-  0x4E, 0xBF, 0x8F, 0xEE, 0x9E, 0x69, 0x79, 0x7F, 0x26, 0x54, 0xA4, 0x81, 0x53, 0x35, 0x5F, 0xA8,
-  0x5E, 0x30, 0x73, 0x2A, 0xE3, 0x7A, 0x43, 0xF6, 0x12, 0x97, 0xAC, 0x46, 0xC0, 0xB8, 0x2C, 0xE4,
-  0x47, 0x91, 0xF4, 0xC6, 0x71, 0x46, 0xFE, 0x3B, 0x29, 0xEA, 0xEF, 0xD6, 0x23, 0xA3, 0xA2, 0xFE,
-  0xC4, 0x6E, 0xAF, 0x3B, 0x35, 0x74, 0x7F, 0xE8, 0x05, 0x96, 0x52, 0x9C, 0xD1, 0x4B, 0x8B, 0x59,
-  0xE6, 0x0F, 0xD0, 0x26, 0x02, 0xBC, 0x16, 0x14, 0x9E, 0x09, 0x6A, 0x73, 0x60, 0x29, 0xED, 0xB8,
-  0xC3, 0xA5, 0xAB, 0x04, 0x0A, 0x3E, 0x54, 0x08, 0xDE, 0x57, 0x71, 0x21, 0xAA, 0x7C, 0xFC, 0x2F,
-  0xE7, 0x67, 0xD5, 0x8B, 0x0F, 0x6D, 0x76, 0x69, 0x0B, 0x8C, 0xBE, 0xA7, 0xAF, 0xAE, 0x35, 0x3B,
-  0xD0, 0x64, 0xFF, 0x43, 0xAC, 0x57, 0x9D, 0xB0, 0x8B, 0xCE, 0xD6, 0x54, 0x0A, 0xA4, 0x1E, 0x5B,
-  0xA5, 0xAE, 0xB1, 0x76, 0x7E, 0xC9, 0xDF, 0x8E, 0x6F, 0xEF, 0x9A, 0xDF, 0x4E, 0x7E, 0xBA, 0xB4,
-  0x23, 0x4A, 0x83, 0x4F, 0xB0, 0x33, 0x48, 0x11, 0x5F, 0xA7, 0x07, 0x3F, 0xD1, 0x66, 0x50, 0x07,
-  0xCB, 0xF0, 0x44, 0x8E, 0xCF, 0x74, 0x49, 0x16, 0xA4, 0x18, 0x40, 0xE4, 0xFC, 0x1D, 0x3B, 0xB6,
-  0x68, 0x56, 0x65, 0xBC, 0xD6, 0xAF, 0x8D, 0xD5, 0x8D, 0xC3, 0xBA, 0x8B, 0x68, 0x69, 0x8F, 0x48,
-  0xEC, 0xE6, 0xFC, 0x6B, 0xF5, 0xEC, 0xC3, 0xE9, 0x06, 0x44, 0xAD, 0xCC, 0xC7, 0x71, 0x85, 0x52,
-  0x0A, 0xBE, 0x20, 0xBF, 0x15, 0x5C, 0x4F, 0x29, 0xB7, 0x95, 0x58, 0xC3, 0x6C, 0xB0, 0xC7, 0x20,
-  0x95, 0x72, 0x5A, 0x79, 0x30, 0x7B, 0xE6, 0x5A, 0xF9, 0xAC, 0x4C, 0x5D, 0x4B, 0x49, 0x97, 0x95,
-  0x71, 0xCD, 0x13, 0xB6, 0x72, 0x9A, 0xA6, 0x70, 0x03, 0x5A, 0xB4, 0xE3, 0xFD, 0xF0, 0x8F, 0x96,
-  0xC6, 0x00, 0x80, 0x84, 0x99, 0xEE, 0x71, 0x8A, 0x78, 0x84, 0xBD, 0xA6, 0xF3, 0x09, 0xE6, 0x29,
-  0x1C, 0xB6, 0x27, 0x77, 0xCF, 0x56, 0x53, 0xAA, 0xB1, 0x63, 0x90, 0x35, 0xC3, 0x4F, 0x91, 0xE4,
-  0x09, 0x27, 0x23, 0x5E, 0xBD, 0xD9, 0xAA, 0x62, 0x25, 0xF7, 0x45, 0xF8, 0xCE, 0x28, 0x62, 0x21,
-  0x7A, 0x19, 0x2F, 0xCF, 0x6A, 0x7F, 0x98, 0x04, 0x1E, 0x88, 0xE2, 0x6A, 0x43, 0xEB, 0x9D, 0x0E,
-  0xC6, 0x10, 0xC5, 0xB4, 0xF2, 0xDD, 0x31, 0x1D, 0x0D, 0x5F, 0xC9, 0x53, 0x3A, 0xA6, 0xB4, 0x7E,
-  0x5F, 0xC4, 0x89, 0x71, 0x7C, 0xEE, 0xEA, 0xC4, 0x12, 0xB0, 0xC3, 0xF9, 0xA2, 0xAB, 0xD3, 0x5D,
-  0x6C, 0x5A, 0x66, 0x80, 0xF8, 0xFC, 0xDB, 0xD0, 0x0D, 0xFC, 0x61, 0xCC, 0xD8, 0xC2, 0xF6, 0xF7,
-  0xA9, 0x80, 0x59, 0xC7, 0xCD, 0x8D, 0x56, 0x56, 0x78, 0x4F, 0xC3, 0x96, 0x1B, 0xBC, 0xAF, 0x8D,
-  0xBC, 0x64, 0xD9, 0x5C, 0xBF, 0x9D, 0x93, 0x73, 0x2F, 0xBA, 0x6B, 0x8D, 0x0D, 0xA7, 0xC4, 0xC6,
-  0x7C, 0x28, 0x71, 0x1D, 0xF7, 0xB3, 0x34, 0x25, 0x36, 0x5E, 0x00, 0x25, 0x36, 0xF3, 0x52, 0xE2,
-  0xEE, 0xFA, 0xED, 0x5C, 0xB3, 0x14, 0x25, 0x36, 0x37, 0x9C, 0x12, 0x9B, 0xF3, 0xA1, 0xC4, 0x75,
-  0xDC, 0xCF, 0xD2, 0x94, 0xD8, 0x7C, 0x01, 0x94, 0xB8, 0x9B, 0x97, 0x12, 0xF7, 0xD6, 0x6F, 0xE7,
-  0x76, 0x4B, 0x51, 0xE2, 0xEE, 0x86, 0x53, 0xE2, 0xEE, 0x7C, 0x28, 0x71, 0x1D, 0xF7, 0xB3, 0x34,
-  0x25, 0xEE, 0xAE, 0x92, 0x12, 0x23, 0xFB, 0x06, 0x99, 0x13, 0xEE, 0x60, 0xD1, 0xE3, 0x37, 0x86,
-  0xB9, 0x0C, 0x9C, 0xD1, 0x4E, 0x8F, 0x7A, 0xC2, 0x0C, 0x3A, 0xCA, 0x43, 0x97, 0x5D, 0x3B, 0x46,
-  0x71, 0x0F, 0xCA, 0x54, 0x77, 0xA9, 0xC9, 0x62, 0x25, 0x95, 0xE3, 0xF6, 0x3C, 0xFC, 0x28, 0x1B,
-  0x95, 0xD6, 0x71, 0xBB, 0x94, 0xDF, 0x5D, 0xBD, 0xD2, 0x42, 0xCB, 0xC3, 0x5A, 0x3A, 0xDC, 0x1D,
-  0xB7, 0x63, 0xEE, 0x76, 0x2A, 0xB0, 0x52, 0x5A, 0x37, 0x3C, 0x47, 0x33, 0x74, 0xCD, 0x17, 0xA1,
-  0x1B, 0xB2, 0xAE, 0x73, 0xDF, 0x67, 0x14, 0xC4, 0xC7, 0x30, 0x7C, 0x98, 0x1B, 0x58, 0xC5, 0xA4,
-  0x2A, 0xC1, 0x5C, 0x63, 0xD0, 0x17, 0x99, 0x57, 0xB2, 0x7B, 0x8B, 0x85, 0x17, 0xA3, 0x23, 0xB5,
-  0x25, 0xDF, 0x45, 0x2B, 0x4B, 0xCC, 0x45, 0x9B, 0x4C, 0x2B, 0x98, 0xAA, 0x1D, 0x1B, 0xCB, 0x64,
-  0x21, 0x98, 0x3A, 0xAE, 0x8D, 0x2E, 0xD0, 0x1E, 0x0C, 0x5E, 0x7B, 0xB9, 0x69, 0x83, 0xEE, 0x4E,
-  0xDB, 0x3B, 0xDF, 0xCE, 0xDA, 0x2F, 0xC9, 0x08, 0x0B, 0x4B, 0x82, 0x15, 0x95, 0x32, 0xC3, 0x26,
-  0x9A, 0x66, 0x83, 0x3F, 0x09, 0xB0, 0x94, 0x2D, 0x56, 0xE8, 0xEE, 0x37, 0xC3, 0x5D, 0x2B, 0x6B,
-  0xEC, 0x8C, 0x25, 0xCD, 0xC1, 0x1E, 0x3B, 0xF7, 0x04, 0x38, 0xF7, 0xE2, 0xD4, 0x32, 0x29, 0xFF,
-  0x32, 0x4C, 0x9E, 0xC9, 0xBF, 0x97, 0x92, 0xC1, 0x26, 0x1A, 0x78, 0x2A, 0xB5, 0x47, 0xA5, 0x1A,
-  0x60, 0xB7, 0xE5, 0xFB, 0x27, 0xCE, 0x23, 0xA7, 0x92, 0x15, 0xCB, 0x62, 0x9F, 0x3D, 0x59, 0x5F,
-  0x89, 0x1B, 0xDB, 0x93, 0x98, 0x5D, 0xC4, 0xE6, 0xDC, 0xC0, 0x1F, 0x48, 0xEF, 0x66, 0x2C, 0xA5,
-  0x42, 0x2C, 0xAE, 0x6F, 0xDE, 0x73, 0x1B, 0x11, 0x99, 0xFC, 0x99, 0x6B, 0x9B, 0x9A, 0x8A, 0x3C,
-  0x97, 0xA0, 0xE7, 0x66, 0xED, 0x6F, 0x19, 0x51, 0x26, 0x97, 0xAC, 0x12, 0x61, 0x44, 0xF9, 0x04,
-  0x25, 0xA5, 0x72, 0x40, 0x84, 0x0B, 0xC3, 0x32, 0xCF, 0x95, 0x32, 0x6E, 0x4D, 0x54, 0x08, 0x1B,
-  0x1E, 0xCC, 0xBC, 0x12, 0x1F, 0x51, 0xE4, 0xD1, 0x0A, 0x5D, 0x77, 0x6C, 0xCA, 0x6E, 0xEE, 0x85,
-  0xE7, 0x73, 0xE8, 0x2D, 0x30, 0xC0, 0x55, 0xC8, 0xA2, 0x66, 0xE4, 0x54, 0x00, 0x73, 0xD5, 0x69,
-  0xAE, 0xF2, 0xBA, 0x35, 0xBC, 0x3C, 0x41, 0x92, 0x20, 0xC7, 0xFD, 0xDA, 0x6B, 0x4E, 0x86, 0xA2,
-  0x3A, 0x45, 0x0A, 0xD5, 0xF2, 0xDF, 0x65, 0xC4, 0xA8, 0x31, 0xD1, 0xC7, 0xA6, 0x17, 0xE7, 0x8C,
-  0x16, 0x83, 0xA1, 0x53, 0xA5, 0x68, 0x0F, 0x1B, 0xCE, 0x93, 0x98, 0x22, 0x42, 0x51, 0x0C, 0x1E,
-  0x8F, 0x83, 0xC0, 0x8F, 0x67, 0x3B, 0x6B, 0x7E, 0xD8, 0x3B, 0x7C, 0x45, 0xFD, 0xD2, 0xA8, 0x4F,
-  0x3B, 0x5D, 0x1C, 0xDB, 0xB1, 0xD9, 0x4A, 0x93, 0x8D, 0xAC, 0x4C, 0x9C, 0x0B, 0x2B, 0x89, 0x22,
-  0x46, 0xCA, 0xBF, 0x97, 0x24, 0xCE, 0xA9, 0x81, 0x73, 0x8B, 0x73, 0xF2, 0xFD, 0x75, 0x11, 0xE7,
-  0xA8, 0x2A, 0x2B, 0x33, 0xED, 0xAE, 0x13, 0x80, 0x20, 0x47, 0xA7, 0x99, 0x2A, 0xCE, 0x89, 0xB9,
-  0x0C, 0x93, 0xC2, 0x9D, 0xF4, 0x48, 0x0D, 0x8F, 0x3B, 0xAC, 0xE1, 0x27, 0x5F, 0x5D, 0x4F, 0x37,
-  0x81, 0x85, 0xC9, 0x77, 0x72, 0x03, 0x17, 0x29, 0xDF, 0xC9, 0x11, 0x96, 0x2E, 0xDF, 0xC9, 0x61,
-  0x5F, 0xCF, 0x98, 0x97, 0x7F, 0xC6, 0xC4, 0x76, 0xBA, 0xC8, 0x19, 0x33, 0x6A, 0xF6, 0xC7, 0x3C,
-  0x63, 0xBE, 0x19, 0x6E, 0x78, 0xCC, 0xA0, 0x79, 0x66, 0xA9, 0xC7, 0xCC, 0x68, 0xEC, 0x7C, 0x27,
-  0x4D, 0x60, 0xB8, 0xEB, 0x72, 0xC6, 0x8C, 0xAC, 0xAD, 0x74, 0x8C, 0xF8, 0xD0, 0x2D, 0x56, 0x8B,
-  0x92, 0x85, 0x57, 0x19, 0x40, 0xF2, 0x8F, 0x74, 0x7A, 0x44, 0xFB, 0xB8, 0xB0, 0x03, 0x24, 0x30,
-  0xDC, 0xA5, 0x1F, 0x1D, 0xD1, 0xAA, 0xD6, 0xEE, 0xF4, 0x40, 0x42, 0xCD, 0x3E, 0x3D, 0x1A, 0xF5,
-  0x46, 0xA3, 0xFE, 0x7A, 0x7C, 0x94, 0x38, 0x3E, 0x92, 0xBB, 0x5D, 0xE4, 0x04, 0x49, 0xB4, 0x7C,
-  0x01, 0x59, 0x11, 0x65, 0x1E, 0xBA, 0x17, 0x74, 0xB1, 0x41, 0x0B, 0x2A, 0x75, 0xAF, 0x11, 0x6F,
-  0x99, 0x0D, 0xF9, 0x38, 0xB0, 0x52, 0x97, 0x1A, 0x94, 0x30, 0x6C, 0xAD, 0xEE, 0x34, 0xA6, 0x2F,
-  0xE7, 0xB9, 0x59, 0x11, 0xB3, 0xAF, 0x99, 0x0B, 0xA6, 0x43, 0x94, 0x37, 0xCC, 0x34, 0xD1, 0x72,
-  0xB9, 0x0F, 0x47, 0x77, 0xCA, 0xB1, 0x8F, 0x73, 0xC9, 0x0B, 0xF6, 0xB5, 0xD7, 0x2B, 0x9D, 0x30,
-  0xBD, 0xD3, 0xAE, 0xDE, 0x38, 0x0F, 0xEB, 0x99, 0x81, 0x8B, 0x12, 0x4D, 0x61, 0x14, 0x0D, 0xCC,
-  0x72, 0xB7, 0x19, 0xA6, 0x69, 0x89, 0x12, 0x5A, 0xC9, 0x1B, 0x64, 0x20, 0xC0, 0x2A, 0xFD, 0xB1,
-  0x8D, 0xF6, 0xE3, 0xE8, 0xD1, 0x10, 0x4E, 0x1D, 0x53, 0x5E, 0x31, 0x13, 0xB8, 0xC9, 0x7B, 0x9F,
-  0x2A, 0xD7, 0xAB, 0x7A, 0xF6, 0xBE, 0x4F, 0x51, 0x64, 0x5F, 0x9C, 0x07, 0x7E, 0x8F, 0x89, 0x32,
-  0x4E, 0x00, 0x24, 0xC2, 0x71, 0xC4, 0x80, 0x75, 0xDA, 0x6D, 0x1C, 0xCB, 0x76, 0xC4, 0x68, 0x38,
-  0x41, 0xF6, 0x67, 0x1F, 0xAD, 0xD4, 0x98, 0xE6, 0xE2, 0xCF, 0xF8, 0x38, 0xD6, 0xE4, 0xE4, 0xEA,
-  0x3C, 0x1E, 0x27, 0x4A, 0x03, 0xC2, 0xAE, 0x6C, 0x5C, 0x62, 0x18, 0x02, 0x55, 0xD9, 0xFC, 0x16,
-  0xD9, 0x4A, 0xC1, 0x0C, 0x18, 0x48, 0x58, 0x5D, 0x1F, 0x9F, 0x46, 0x25, 0x3F, 0x68, 0x0E, 0xF0,
-  0x60, 0x72, 0xB5, 0x8F, 0xE3, 0xE3, 0xA3, 0x93, 0x93, 0xA3, 0xD3, 0xD3, 0xA3, 0xB3, 0xB3, 0xA3,
-  0xF3, 0xF3, 0xA3, 0x8B, 0x8B, 0xB2, 0xEE, 0x2A, 0xA5, 0x67, 0xDD, 0xD6, 0x4C, 0x4C, 0x03, 0x47,
-  0x93, 0xF7, 0x8F, 0x8A, 0xE5, 0x59, 0xC8, 0xD3, 0x7F, 0xFC, 0x1C, 0xE7, 0xDC, 0x03, 0x68, 0xF8,
-  0xD3, 0x8A, 0x9F, 0xD8, 0x7C, 0x7D, 0x2D, 0xEB, 0xD8, 0x50, 0xCD, 0x5C, 0x4A, 0xA7, 0xC0, 0xB8,
-  0xE1, 0xD4, 0x18, 0x1E, 0xED, 0xBB, 0x8F, 0x7F, 0xCE, 0x03, 0x06, 0x75, 0x44, 0x27, 0x8F, 0x5E,
-  0x84, 0x0C, 0x9C, 0xC8, 0xB8, 0x0F, 0x72, 0x13, 0x2A, 0x93, 0xCE, 0xF0, 0x4C, 0xB1, 0x38, 0xDF,
-  0xFD, 0x54, 0xA4, 0xDE, 0xB9, 0xD1, 0x30, 0xA0, 0xE0, 0xA1, 0x43, 0x09, 0xE9, 0x5D, 0xC0, 0xE5,
-  0xBC, 0x00, 0xCE, 0x04, 0x9C, 0x84, 0x42, 0x85, 0xEC, 0x23, 0x71, 0x89, 0x57, 0x69, 0xB1, 0xF4,
-  0xFB, 0x0F, 0x8E, 0xD2, 0x0B, 0xFD, 0x6D, 0xC6, 0x1F, 0x4D, 0x81, 0x0E, 0x3A, 0x4A, 0x76, 0x92,
-  0x9E, 0x35, 0x64, 0x6F, 0xA4, 0xDB, 0x36, 0x9F, 0x0B, 0xD8, 0x4C, 0x05, 0x68, 0x59, 0x8C, 0xE7,
-  0x2D, 0xAE, 0xEA, 0x2D, 0xDA, 0x1D, 0x7D, 0x8E, 0x39, 0xD1, 0xBF, 0xD9, 0xA6, 0x50, 0xA1, 0x4D,
-  0xFE, 0x83, 0xE6, 0x22, 0xC5, 0x86, 0x97, 0x75, 0xDC, 0x57, 0xEE, 0x37, 0x00, 0x63, 0xAC, 0xF7,
-  0x35, 0x0C, 0x6C, 0x4A, 0x96, 0x65, 0xF7, 0x91, 0x6F, 0xDA, 0xC0, 0xC6, 0x80, 0x2D, 0x3F, 0x80,
-  0xF2, 0x09, 0xFC, 0xF6, 0x0F, 0x1B, 0x37, 0x5F, 0x34, 0x2F, 0x50, 0xEE, 0x60, 0xFB, 0x82, 0x86,
-  0x95, 0x0B, 0x07, 0x65, 0x50, 0x45, 0x33, 0x61, 0xD8, 0xAF, 0x7C, 0x88, 0x51, 0x6C, 0xB9, 0x76,
-  0x27, 0xC4, 0xF5, 0xBC, 0x89, 0x32, 0x9E, 0x6F, 0x92, 0x49, 0xCC, 0x3A, 0xD7, 0x1C, 0x03, 0x9B,
-  0x3A, 0xE4, 0xC6, 0x0A, 0x49, 0x11, 0x88, 0x8B, 0x12, 0x12, 0x68, 0xBA, 0x4E, 0x75, 0x13, 0x35,
-  0x2C, 0x39, 0x6F, 0xF1, 0x30, 0x1C, 0xDE, 0x95, 0x87, 0x08, 0x9D, 0x77, 0xB2, 0xF4, 0x4B, 0x08,
-  0x03, 0x36, 0x0C, 0xF0, 0xF6, 0xDE, 0xF4, 0x7C, 0x21, 0x13, 0xD3, 0xD1, 0x4A, 0xE0, 0xCF, 0x1E,
-  0x86, 0xC7, 0x53, 0x34, 0xA1, 0xA4, 0x55, 0x20, 0x4F, 0xA2, 0xE0, 0xD9, 0x97, 0x02, 0x9B, 0x40,
-  0x59, 0xCF, 0x3B, 0x2E, 0xA7, 0x9D, 0x13, 0x09, 0xFC, 0x99, 0x70, 0x52, 0x14, 0x3C, 0x13, 0x7A,
-  0xD4, 0xA5, 0x14, 0x04, 0xC6, 0xCF, 0x86, 0xD6, 0x88, 0xA4, 0x8A, 0x1F, 0x0D, 0x6E, 0xD6, 0xB4,
-  0xAF, 0xFD, 0x7E, 0x4A, 0x7B, 0xEF, 0x04, 0xE4, 0x48, 0xB9, 0x82, 0x6B, 0xF5, 0x75, 0xE1, 0x68,
-  0xBE, 0x6B, 0x3B, 0x0F, 0x27, 0xA1, 0xC1, 0xB3, 0xD2, 0x8A, 0xFE, 0x64, 0xE8, 0xAC, 0x0B, 0x8A,
-  0x3F, 0x5F, 0x12, 0x93, 0x4A, 0x4D, 0x64, 0xF5, 0xDC, 0x87, 0xAA, 0xF8, 0xA0, 0x78, 0xB2, 0x4D,
-  0x76, 0x5F, 0x04, 0x05, 0xB0, 0x0A, 0x10, 0x25, 0xE5, 0x59, 0xED, 0x73, 0xDB, 0xF0, 0xF1, 0x3A,
-  0x52, 0xFA, 0xD1, 0xDC, 0x9B, 0x5A, 0xCC, 0x6E, 0x2C, 0x1C, 0xFA, 0x86, 0x94, 0x2E, 0x2C, 0xD3,
-  0x09, 0x1C, 0xCA, 0xEE, 0x23, 0xDB, 0x81, 0xD3, 0x7C, 0xA0, 0xDD, 0x73, 0xA6, 0x94, 0xC6, 0xD0,
-  0xFE, 0x5C, 0x2E, 0x15, 0xC7, 0x26, 0x1F, 0xF3, 0x73, 0xB5, 0x6A, 0x75, 0x9E, 0x7C, 0xC1, 0x87,
-  0x2F, 0xC9, 0xAC, 0x25, 0x57, 0x54, 0xCA, 0xAE, 0x95, 0x68, 0x9A, 0xBD, 0x39, 0x09, 0x78, 0xA5,
-  0x2C, 0x5B, 0xBE, 0x6C, 0xBE, 0x4E, 0xA6, 0xAD, 0x19, 0x2B, 0x7A, 0x86, 0x6D, 0x2B, 0x70, 0x2D,
-  0x20, 0xD9, 0x1B, 0xFE, 0x70, 0xA1, 0x12, 0x6D, 0x9F, 0x99, 0xF7, 0x05, 0xCD, 0x5B, 0xD3, 0xF9,
-  0xEB, 0xD8, 0x00, 0x95, 0x96, 0x02, 0x7E, 0xF8, 0x20, 0x4F, 0x2D, 0x41, 0x24, 0x71, 0xD2, 0xEB,
-  0xC5, 0x8F, 0xB0, 0xD9, 0x5F, 0x81, 0x0F, 0xC1, 0xAE, 0x7D, 0x73, 0xFB, 0x20, 0xFC, 0xF0, 0xC9,
-  0x9A, 0xED, 0x7D, 0xBD, 0x56, 0x7F, 0x8E, 0x4D, 0x63, 0x86, 0xD6, 0xAF, 0x59, 0x66, 0xDF, 0x06,
-  0xB0, 0xE3, 0x15, 0x99, 0x37, 0xEB, 0x38, 0x9B, 0x26, 0x5E, 0x9C, 0x22, 0xE8, 0xE2, 0x70, 0xCA,
-  0xA3, 0x8C, 0xCE, 0xE6, 0xE7, 0x91, 0xAC, 0xA1, 0xA7, 0xFA, 0xC7, 0x6B, 0x46, 0x1A, 0x93, 0xAC,
-  0x5A, 0xF0, 0x45, 0xB4, 0x21, 0x23, 0xC4, 0x5D, 0x72, 0x62, 0x29, 0x39, 0x9D, 0xA8, 0x40, 0x16,
-  0x9C, 0x21, 0xA0, 0x37, 0x32, 0xB3, 0xC7, 0xB0, 0xCA, 0x5B, 0x94, 0x09, 0x1E, 0xE4, 0xD5, 0x51,
-  0xEA, 0x0B, 0x95, 0x4F, 0xCA, 0x57, 0x6A, 0xEA, 0xDA, 0xE6, 0x8A, 0x8D, 0xC9, 0x64, 0xE1, 0x42,
-  0xC2, 0x0D, 0x47, 0xA1, 0x4C, 0x8A, 0x5F, 0x33, 0x65, 0xA1, 0xB9, 0x6A, 0x71, 0xB7, 0xA7, 0x23,
-  0x92, 0x3C, 0x26, 0xA7, 0xA2, 0x13, 0x0E, 0xE7, 0xF8, 0x08, 0x0B, 0x96, 0xA7, 0x9A, 0xC5, 0xA7,
-  0xB2, 0x22, 0x61, 0x87, 0xD6, 0x1E, 0xE1, 0x18, 0x1E, 0x2A, 0x9A, 0x69, 0x4B, 0x8D, 0x0A, 0xB0,
-  0x0F, 0xF3, 0xAE, 0xF4, 0xB8, 0x26, 0x02, 0x4C, 0x22, 0x06, 0xD4, 0xC1, 0x86, 0xDA, 0x13, 0x53,
-  0xC6, 0x5D, 0x5F, 0xC8, 0xB2, 0xB1, 0x37, 0xF0, 0xD1, 0xE3, 0x68, 0xBB, 0xE0, 0x78, 0x4A, 0x11,
-  0x6A, 0xF6, 0x4C, 0x6E, 0x19, 0x0C, 0x23, 0xE6, 0x5E, 0x90, 0xD5, 0x62, 0x32, 0x7B, 0xF3, 0x66,
-  0x29, 0x00, 0x49, 0x6E, 0x29, 0x0B, 0x0C, 0x98, 0xF7, 0x9F, 0xB9, 0x48, 0x30, 0xBE, 0xFC, 0x95,
-  0xB7, 0x73, 0x71, 0xD6, 0x74, 0xF7, 0xF3, 0xE5, 0xAB, 0xFD, 0x44, 0xEF, 0xC8, 0x55, 0xBF, 0xB9,
-  0x06, 0xD5, 0xD2, 0x70, 0xD8, 0xFD, 0x6E, 0xAD, 0xB1, 0x57, 0x6B, 0xEC, 0xE7, 0xE5, 0xA8, 0x12,
-  0x2E, 0xAD, 0x8F, 0xAE, 0xE7, 0xF4, 0xC9, 0xA8, 0x16, 0xE7, 0x17, 0xB2, 0xDB, 0xB6, 0xFA, 0xEA,
-  0x44, 0xF3, 0x22, 0x52, 0x6A, 0x34, 0x2B, 0x80, 0x90, 0x8F, 0xF0, 0x47, 0xBD, 0x9E, 0x0F, 0xE9,
-  0x15, 0x84, 0x1F, 0x4C, 0x43, 0x0C, 0x8E, 0x76, 0xEB, 0x75, 0x32, 0xA3, 0x02, 0x0F, 0x52, 0x9D,
-  0xE7, 0xD6, 0x2F, 0xB3, 0xE7, 0x36, 0x45, 0xCD, 0xDC, 0x7D, 0xFF, 0x2F, 0x39, 0x34, 0x4D, 0x05,
-  0x87, 0x85, 0x78, 0x1C, 0xE5, 0x3D, 0xB0, 0x93, 0x9C, 0x34, 0xAD, 0xE7, 0x17, 0x88, 0xC7, 0xC5,
-  0x9A, 0x82, 0x15, 0x75, 0x89, 0xD7, 0x05, 0x62, 0xA6, 0x8F, 0x24, 0x68, 0x06, 0xDD, 0xA1, 0x29,
-  0x42, 0xCC, 0xB9, 0xA0, 0xE7, 0x8E, 0x2D, 0x2B, 0x08, 0xC4, 0x41, 0x8B, 0x02, 0xD4, 0x77, 0xCD,
-  0x14, 0x68, 0x1B, 0xD8, 0x99, 0x3E, 0xB0, 0x7C, 0x99, 0x9D, 0x5C, 0xDE, 0xBC, 0x29, 0xED, 0x9B,
-  0x30, 0xE7, 0x02, 0xDC, 0x8A, 0x18, 0x80, 0x8F, 0x06, 0xB6, 0x29, 0xDE, 0xFA, 0x23, 0x26, 0xDB,
-  0x7D, 0x62, 0x52, 0x3A, 0x24, 0x2B, 0x2F, 0x08, 0xD6, 0x36, 0x92, 0x21, 0x15, 0xD1, 0xA4, 0x1C,
-  0x78, 0x64, 0xCD, 0x0A, 0x1D, 0x56, 0x99, 0x3B, 0x00, 0x36, 0x80, 0xD7, 0x73, 0xED, 0xD3, 0x55,
-  0x39, 0xAF, 0x4E, 0x2D, 0x42, 0x3F, 0x46, 0x11, 0xB8, 0xB2, 0x32, 0x06, 0x97, 0x69, 0xC8, 0x3D,
-  0x91, 0xC3, 0x46, 0x02, 0x3D, 0x66, 0xEF, 0xBF, 0x75, 0xA4, 0x33, 0x6A, 0xE0, 0x3E, 0xE7, 0xC6,
-  0x3A, 0xD9, 0x53, 0x24, 0xB6, 0x5F, 0xC2, 0x2E, 0x62, 0x29, 0xA2, 0x8E, 0x28, 0x53, 0x60, 0x26,
-  0xD5, 0x69, 0xC6, 0x94, 0xE7, 0x74, 0x9F, 0x4D, 0x1D, 0x96, 0xBD, 0xD1, 0x3E, 0xD1, 0x7C, 0x5E,
-  0xB2, 0xB6, 0x55, 0xEB, 0xE6, 0xAE, 0xBD, 0x7E, 0x37, 0xE1, 0xED, 0x40, 0x5D, 0x3E, 0xCB, 0x3D,
-  0x34, 0x6D, 0x2C, 0x9E, 0xEC, 0xD0, 0x9D, 0x35, 0x95, 0x7B, 0x40, 0x0D, 0xE0, 0x4E, 0xC6, 0x5E,
-  0x47, 0xF7, 0x2D, 0x6D, 0xBA, 0x6F, 0xF9, 0x6A, 0xE3, 0x97, 0xB7, 0xDC, 0xE7, 0x62, 0x73, 0x53,
-  0xCB, 0xCD, 0xDB, 0xB3, 0x34, 0xCA, 0xBC, 0x8B, 0xA9, 0x70, 0x01, 0x94, 0x9D, 0x33, 0x76, 0x0A,
-  0x2A, 0xF7, 0x32, 0x1C, 0x4B, 0x67, 0x27, 0xFD, 0x9D, 0xBB, 0x8B, 0xA8, 0xC6, 0x86, 0xA6, 0xEE,
-  0x39, 0xB0, 0x48, 0x32, 0x2E, 0x90, 0xB2, 0x25, 0x88, 0x29, 0x6F, 0x93, 0x91, 0x6F, 0x08, 0xFC,
-  0x4C, 0xEB, 0xF3, 0x51, 0xD2, 0x42, 0x0B, 0xE6, 0x98, 0x30, 0xE9, 0xE5, 0x2B, 0xC9, 0xBD, 0x86,
-  0x35, 0x6E, 0xE2, 0x20, 0x9F, 0xE5, 0xD2, 0xB0, 0x58, 0x97, 0x4D, 0x90, 0xEF, 0x60, 0x1E, 0x98,
-  0x11, 0xF9, 0xD7, 0xA1, 0x69, 0x07, 0x82, 0xFB, 0x19, 0x4E, 0x9B, 0x7B, 0x29, 0xA7, 0xCD, 0xF7,
-  0x63, 0x4E, 0x9B, 0xD7, 0xDA, 0x23, 0xE6, 0xB6, 0x9E, 0x1D, 0xD1, 0x89, 0x15, 0x3A, 0xB6, 0x60,
-  0xA4, 0x77, 0xAB, 0x8A, 0xE8, 0xFC, 0x8A, 0xA5, 0xDE, 0x91, 0x67, 0xC1, 0xCA, 0x11, 0xA3, 0x64,
-  0x69, 0x18, 0x54, 0xFE, 0xF5, 0x81, 0xC9, 0xEF, 0x11, 0xF9, 0x2C, 0xB9, 0x31, 0x2A, 0xCC, 0x99,
-  0x6B, 0xE8, 0x2C, 0x7A, 0xA7, 0xEA, 0x75, 0x07, 0xA3, 0x7C, 0xD3, 0x96, 0x09, 0x62, 0x16, 0xBE,
-  0x67, 0x39, 0xF0, 0x03, 0xA4, 0xBE, 0xA1, 0x34, 0x68, 0xDB, 0x38, 0xA7, 0x6D, 0xD4, 0xDF, 0x84,
-  0xA9, 0x33, 0x3F, 0xF0, 0xEE, 0xB9, 0x2C, 0x4F, 0xAF, 0x41, 0x67, 0x1E, 0xEA, 0x7F, 0x61, 0x89,
-  0x08, 0x8C, 0x24, 0x85, 0xD1, 0xE3, 0xAE, 0xA8, 0x7B, 0x00, 0x6B, 0xB5, 0x11, 0x35, 0x76, 0x85,
-  0x23, 0xC0, 0x43, 0x6C, 0xDC, 0x3C, 0x3C, 0x1C, 0x7D, 0xF3, 0x72, 0x9C, 0x55, 0x73, 0x16, 0xAD,
-  0x20, 0x2D, 0xCA, 0x1F, 0x02, 0x5B, 0x50, 0x55, 0x1E, 0xC7, 0xD1, 0x36, 0x97, 0x91, 0x64, 0xBC,
-  0xDD, 0x33, 0x33, 0xCD, 0x2C, 0x83, 0x3A, 0x55, 0x69, 0x8D, 0x65, 0xD0, 0xE7, 0x95, 0xAA, 0x5D,
-  0x42, 0x14, 0xBA, 0x50, 0x02, 0x04, 0x5A, 0x4A, 0x52, 0x41, 0x92, 0x06, 0x35, 0x32, 0xCE, 0x21,
-  0x7D, 0x86, 0xDC, 0x5F, 0xF7, 0xB8, 0x86, 0x11, 0x66, 0x59, 0xA4, 0x48, 0xDF, 0x21, 0x29, 0x4A,
-  0xD7, 0x3A, 0x8B, 0xCE, 0x0A, 0x15, 0x56, 0xA0, 0x49, 0xFA, 0x94, 0x74, 0xF8, 0xC2, 0x49, 0x6D,
-  0x81, 0xB4, 0x96, 0x42, 0xC2, 0x02, 0xD4, 0x96, 0x6C, 0xB9, 0x50, 0x7A, 0xC3, 0x41, 0x61, 0xE7,
-  0xA5, 0xCE, 0xAB, 0x86, 0xC8, 0xE9, 0x07, 0x56, 0xBE, 0x26, 0x4C, 0x7A, 0xC0, 0x18, 0xB5, 0x27,
-  0x6C, 0x3F, 0x24, 0xD5, 0x91, 0x1A, 0x8A, 0x3A, 0xCB, 0x91, 0x44, 0x99, 0x5C, 0xC8, 0x85, 0xFF,
-  0x62, 0x4B, 0xBB, 0x81, 0xE6, 0x93, 0x2F, 0x26, 0x3A, 0x17, 0xE7, 0xBF, 0xC2, 0x48, 0xB5, 0xA0,
-  0xFB, 0x98, 0x1F, 0xC7, 0xF2, 0xB0, 0xEA, 0x97, 0xE7, 0xA5, 0x07, 0x47, 0xB4, 0x87, 0x56, 0x36,
-  0x00, 0xD7, 0x9C, 0xCC, 0x77, 0x09, 0x13, 0x5E, 0xAC, 0x7B, 0xB4, 0xDF, 0x75, 0xF0, 0x23, 0xDD,
-  0x88, 0xC0, 0x83, 0x55, 0x7B, 0xE3, 0x9D, 0x5A, 0x0E, 0x3A, 0xC7, 0x91, 0x2D, 0x24, 0xF0, 0xA8,
-  0x54, 0x30, 0x32, 0x5B, 0xBA, 0x80, 0xC7, 0x79, 0xFA, 0x8A, 0x03, 0x3B, 0x36, 0xAF, 0xFD, 0xA1,
-  0x0B, 0xCA, 0x34, 0x52, 0x44, 0x3C, 0xAF, 0xEA, 0x32, 0xC7, 0xB7, 0xED, 0x74, 0x2D, 0x19, 0x78,
-  0xB4, 0x94, 0x02, 0x31, 0x31, 0x1D, 0x24, 0x36, 0x8B, 0xBC, 0x8E, 0x21, 0xF3, 0xBF, 0x9F, 0x8B,
-  0x87, 0x0B, 0x22, 0x42, 0x1E, 0x63, 0x58, 0xA0, 0xAD, 0xB1, 0x5B, 0x4E, 0x45, 0xAC, 0x75, 0x2C,
-  0x81, 0xE5, 0x53, 0x75, 0x68, 0x69, 0xC0, 0x23, 0x57, 0xF9, 0x46, 0xBD, 0xBE, 0xBF, 0x03, 0x3F,
-  0x0E, 0x22, 0x01, 0x41, 0x33, 0x0C, 0x59, 0x21, 0x15, 0xFB, 0x00, 0x64, 0x7E, 0x01, 0x05, 0x1E,
-  0x53, 0x7B, 0xB4, 0x16, 0xD5, 0x1D, 0x47, 0xD3, 0xC1, 0x3A, 0x39, 0x1E, 0x20, 0x55, 0x29, 0x89,
-  0x14, 0xBA, 0xC9, 0xC5, 0x55, 0xD4, 0x58, 0x2C, 0x1C, 0x8C, 0x6D, 0xE5, 0x29, 0xE7, 0xB8, 0x00,
-  0xC6, 0x99, 0x44, 0x58, 0xA4, 0xD5, 0x50, 0x4F, 0x04, 0x59, 0x34, 0x2F, 0xFE, 0x26, 0x4D, 0x19,
-  0x68, 0x13, 0x33, 0xD5, 0xBA, 0x54, 0x5E, 0x21, 0xE8, 0x6B, 0xA8, 0xD9, 0x4F, 0xAA, 0xA0, 0x7A,
-  0x6E, 0xF1, 0x73, 0xA1, 0xFC, 0x37, 0x2F, 0x0F, 0xCE, 0x2D, 0x4A, 0x3C, 0x47, 0x1A, 0xCD, 0x40,
-  0xBF, 0xDC, 0xD7, 0x4A, 0xE3, 0x6D, 0xD7, 0x34, 0x7C, 0x9D, 0xCC, 0xD7, 0x61, 0x04, 0xCF, 0xED,
-  0xD4, 0x38, 0x31, 0x56, 0x20, 0x27, 0xE9, 0x78, 0x97, 0x95, 0xD6, 0x28, 0x50, 0xA8, 0xED, 0x39,
-  0xC2, 0x01, 0x32, 0x2D, 0x6E, 0x7C, 0x1F, 0xEF, 0x76, 0xC2, 0x0A, 0xE6, 0x64, 0x84, 0xEF, 0xB4,
-  0xDB, 0xA5, 0x4D, 0xF0, 0x57, 0xE7, 0x65, 0x2D, 0xF0, 0xB9, 0x42, 0xD9, 0x96, 0x6D, 0x81, 0x3F,
-  0x8D, 0x62, 0x1A, 0x30, 0x1C, 0x0C, 0xB9, 0xD1, 0x29, 0xF6, 0x6C, 0xEA, 0xF1, 0xA0, 0x31, 0xEE,
-  0xE1, 0xCD, 0x0A, 0x46, 0xDA, 0xE2, 0x26, 0x93, 0x0A, 0xB2, 0x05, 0x30, 0x7C, 0x17, 0x8F, 0x2C,
-  0xBB, 0x72, 0x1E, 0xAA, 0xE7, 0x36, 0xF7, 0xFA, 0x4F, 0x6C, 0x0B, 0x80, 0xF4, 0x8E, 0x42, 0xD6,
-  0x44, 0xE0, 0xD9, 0xB1, 0x77, 0x9C, 0x5E, 0x2F, 0xA6, 0x40, 0x63, 0x2C, 0x9A, 0xE6, 0x83, 0x94,
-  0xA8, 0x79, 0xD6, 0x13, 0x59, 0x6C, 0x3F, 0x5F, 0x76, 0xE2, 0xF5, 0xC8, 0x49, 0x45, 0xC7, 0xD7,
-  0x5E, 0x2D, 0xFC, 0x51, 0xB0, 0x80, 0xA6, 0x0B, 0xC7, 0x7B, 0x52, 0x30, 0x8C, 0x45, 0x39, 0xC8,
-  0xE7, 0x21, 0x70, 0xFD, 0x65, 0x98, 0xFC, 0xD3, 0x73, 0xC9, 0x23, 0x00, 0xCE, 0x17, 0x79, 0xD3,
-  0xAB, 0x96, 0xC7, 0x23, 0xF7, 0xF0, 0xEA, 0x08, 0x0F, 0x41, 0x2C, 0x71, 0x8F, 0x01, 0x40, 0x94,
-  0xC2, 0x80, 0x74, 0x13, 0x0F, 0x2F, 0x8C, 0xE8, 0x90, 0x8D, 0x02, 0x30, 0xB1, 0xEC, 0x9E, 0x49,
-  0xD9, 0x26, 0x1D, 0x50, 0x5D, 0x1C, 0xFD, 0x47, 0xD4, 0xA2, 0x06, 0x27, 0xF1, 0x93, 0xB2, 0x04,
-  0xD9, 0x78, 0x99, 0x82, 0xB7, 0xC3, 0x43, 0xCD, 0x24, 0x1F, 0x1C, 0xB2, 0x24, 0x65, 0xC6, 0x41,
-  0x8C, 0xC6, 0x58, 0x60, 0xCC, 0xC3, 0xDA, 0xA6, 0xB2, 0x98, 0xE5, 0x3F, 0x3F, 0x59, 0x9B, 0xEE,
-  0xA5, 0xF1, 0xA9, 0x4C, 0x2C, 0x43, 0xA4, 0x3C, 0xD3, 0x2E, 0xDC, 0x39, 0x29, 0x24, 0x4D, 0xC4,
-  0x31, 0xDC, 0xCA, 0x8D, 0x72, 0x42, 0xEA, 0x99, 0xDA, 0xF1, 0x88, 0xB2, 0x66, 0x29, 0xDE, 0xE1,
-  0x8D, 0x7B, 0x72, 0xE4, 0x67, 0x5C, 0xB9, 0xBF, 0x99, 0xCD, 0x34, 0xA8, 0xC0, 0x98, 0x64, 0x14,
-  0x06, 0xEF, 0x06, 0xFD, 0x5F, 0xC8, 0x37, 0xE9, 0x0C, 0xFF, 0x64, 0xF8, 0xF7, 0x74, 0x67, 0xD6,
-  0x39, 0x68, 0xAF, 0x45, 0x1C, 0xFC, 0x10, 0xEC, 0x67, 0xD2, 0xEC, 0x04, 0x73, 0x94, 0x7F, 0xC8,
-  0xAB, 0x5C, 0x76, 0xEA, 0x04, 0x48, 0x97, 0xCB, 0x60, 0x5F, 0x89, 0x69, 0x2C, 0x9F, 0x77, 0x1D,
-  0x33, 0x12, 0x4A, 0x99, 0x14, 0x5D, 0xB3, 0x95, 0x50, 0x65, 0x9B, 0x03, 0x5E, 0x65, 0x84, 0x51,
-  0x87, 0xE4, 0xF8, 0x27, 0x9B, 0x80, 0xBC, 0x6F, 0x03, 0xDD, 0x53, 0xFC, 0x61, 0x15, 0xFE, 0x90,
-  0x7C, 0x47, 0x7F, 0x02, 0x06, 0xE0, 0x53, 0x61, 0x53, 0xE9, 0xEB, 0x47, 0xF8, 0x80, 0x32, 0x6B,
-  0xF1, 0x58, 0x86, 0xCD, 0xAD, 0xD5, 0x78, 0x0E, 0x70, 0xF2, 0x6C, 0x42, 0xA8, 0xD5, 0x85, 0x1E,
-  0x10, 0xAE, 0xA9, 0x89, 0x84, 0x11, 0x03, 0x73, 0x0E, 0x47, 0x38, 0x4F, 0x75, 0x5F, 0x28, 0x20,
-  0x21, 0xD5, 0xF8, 0xCD, 0x14, 0x8F, 0xBC, 0x1C, 0x3E, 0x8F, 0x29, 0x90, 0xA7, 0xA2, 0x17, 0x22,
-  0x38, 0xAC, 0x53, 0xFC, 0x42, 0x0A, 0x00, 0xEB, 0x9E, 0x70, 0x5C, 0xCD, 0xF6, 0xEC, 0xCB, 0x69,
-  0x1B, 0x04, 0xBF, 0x10, 0xDC, 0x01, 0xDA, 0x61, 0xF1, 0xD9, 0x82, 0x99, 0x66, 0x7C, 0xF4, 0x7C,
-  0x47, 0xB0, 0x31, 0xD0, 0xDD, 0x70, 0x9A, 0x78, 0xF0, 0x2E, 0x99, 0xC3, 0xC6, 0xCD, 0x82, 0x11,
-  0xB4, 0x88, 0xCF, 0xA2, 0x5A, 0x81, 0xEB, 0xA8, 0x85, 0x8C, 0x50, 0xE5, 0x74, 0x62, 0xE8, 0x6A,
-  0xFD, 0x28, 0xAB, 0x29, 0x1C, 0xCB, 0x00, 0xF0, 0x6D, 0x76, 0x76, 0xD3, 0xD9, 0x66, 0x9F, 0x41,
-  0x3F, 0x7A, 0x00, 0x4E, 0x8C, 0x32, 0x64, 0x27, 0xE8, 0x62, 0x4F, 0xD7, 0x9A, 0xFF, 0x63, 0x83,
-  0x7D, 0x49, 0x66, 0xBB, 0xEC, 0x11, 0x28, 0x2E, 0xDB, 0xC9, 0x14, 0x60, 0x21, 0x20, 0x17, 0x9D,
-  0x0A, 0x2C, 0x44, 0xB7, 0xCB, 0x76, 0xA2, 0xBC, 0xCD, 0xFE, 0x98, 0x1D, 0xF0, 0x22, 0xB5, 0x61,
-  0xAB, 0xF2, 0x0B, 0x01, 0x6C, 0x43, 0x94, 0x22, 0x37, 0x24, 0x75, 0xBA, 0x66, 0xA1, 0x1D, 0x59,
-  0xE8, 0xD2, 0x48, 0xF6, 0x92, 0x73, 0x87, 0xED, 0xCF, 0x39, 0x6B, 0x58, 0x0C, 0x31, 0x72, 0xDB,
-  0xED, 0x46, 0x6D, 0x56, 0x63, 0xAF, 0x9B, 0x3B, 0x55, 0x00, 0x4F, 0x9A, 0x41, 0x16, 0xF0, 0xC6,
-  0x26, 0x50, 0x02, 0x2E, 0xE4, 0x15, 0xF9, 0x0B, 0x23, 0x7F, 0x3E, 0xB0, 0xA5, 0xB0, 0x1F, 0x1A,
-  0xBD, 0x10, 0xF4, 0x57, 0xA7, 0xF1, 0x0C, 0x12, 0x50, 0x6F, 0x6D, 0x02, 0x19, 0x84, 0x0B, 0x7A,
-  0x25, 0x85, 0xC2, 0xA4, 0x90, 0x1F, 0x74, 0x29, 0x72, 0x50, 0x0D, 0x5F, 0x08, 0x49, 0x48, 0xA1,
-  0x74, 0x06, 0x45, 0xC4, 0x24, 0xD7, 0x4D, 0xA0, 0x0A, 0x5F, 0x4E, 0x77, 0x08, 0xD3, 0x7D, 0xA5,
-  0x8C, 0xE2, 0x94, 0xA1, 0x50, 0xA2, 0x30, 0x61, 0xC8, 0x76, 0x6B, 0x78, 0xB3, 0x39, 0x5D, 0x65,
-  0x79, 0x4E, 0x59, 0xCD, 0x70, 0xE9, 0x37, 0xC2, 0x4D, 0xE4, 0x1D, 0xCE, 0x26, 0xA3, 0x08, 0x5D,
-  0x31, 0x36, 0x65, 0x76, 0xBA, 0xE1, 0xE2, 0xA9, 0x86, 0xC7, 0x06, 0x88, 0xF4, 0x4C, 0xA4, 0x9B,
-  0x46, 0x73, 0x77, 0x7D, 0x3D, 0x53, 0x8A, 0x97, 0x12, 0xDD, 0xAF, 0xCC, 0xC7, 0xC5, 0x3B, 0x89,
-  0xFC, 0xE1, 0x4E, 0xE6, 0xF2, 0x33, 0x4D, 0x35, 0x5A, 0x5C, 0xF1, 0xD0, 0xF9, 0x18, 0x37, 0x11,
-  0x2B, 0x56, 0x6D, 0xD7, 0xB4, 0x85, 0xBB, 0x20, 0x93, 0x26, 0xAC, 0xAE, 0x94, 0x35, 0x73, 0xD4,
-  0xEE, 0x99, 0x86, 0xCC, 0x11, 0x78, 0x53, 0x36, 0x4C, 0x5C, 0xF3, 0x3A, 0x99, 0x2F, 0x47, 0x2B,
-  0x5E, 0x88, 0xE5, 0xB2, 0x28, 0x13, 0xB5, 0x91, 0x7A, 0x2C, 0xEB, 0xFC, 0xD1, 0x05, 0xD8, 0xDA,
-  0xB3, 0x98, 0x28, 0xBE, 0xCA, 0xC2, 0x77, 0x8F, 0x96, 0xEC, 0x31, 0x28, 0x43, 0x00, 0xE4, 0xAD,
-  0x8A, 0xF2, 0x62, 0x1D, 0x6A, 0x8F, 0xE6, 0x30, 0x18, 0x46, 0xFE, 0x54, 0xAC, 0xCB, 0xC5, 0x03,
-  0xE7, 0x36, 0x48, 0x21, 0x74, 0x4D, 0x67, 0xDE, 0xF3, 0x28, 0xA2, 0xAC, 0xC6, 0xCE, 0x6B, 0xFD,
-  0x9A, 0x2A, 0xDF, 0x2A, 0xF9, 0x32, 0xD9, 0x4A, 0xF1, 0x4A, 0xE6, 0x00, 0xAF, 0x8F, 0xFD, 0xD1,
-  0x15, 0x33, 0x76, 0x85, 0x31, 0x01, 0xFF, 0xE7, 0x80, 0x7D, 0x62, 0x07, 0x7B, 0xFE, 0x2B, 0xEB,
-  0x9E, 0xC4, 0xBA, 0xD3, 0xF8, 0x93, 0x8B, 0x75, 0xA7, 0x1A, 0x2D, 0x8F, 0x75, 0xCF, 0x8D, 0x64,
-  0x3C, 0xAE, 0x9B, 0x98, 0x31, 0x68, 0x16, 0xBD, 0x84, 0xEF, 0xAD, 0x01, 0xAD, 0xB8, 0xE1, 0x5C,
-  0xC2, 0x5A, 0x86, 0x2A, 0x7E, 0x57, 0xB7, 0x1C, 0xFD, 0xC7, 0x34, 0xE2, 0xA8, 0x36, 0xEB, 0x23,
-  0xF2, 0x18, 0xF5, 0x42, 0xF4, 0x81, 0xDF, 0x7D, 0x62, 0xFF, 0xD9, 0x08, 0x5E, 0x49, 0x64, 0x2A,
-  0x89, 0x44, 0xF8, 0x92, 0x9B, 0x3E, 0xC2, 0x16, 0x9B, 0x47, 0x1C, 0xB7, 0x8E, 0x23, 0xCE, 0xB8,
-  0x35, 0xD3, 0xD4, 0x83, 0xEF, 0x31, 0x7A, 0x71, 0x0D, 0xA8, 0x43, 0x38, 0xE4, 0x05, 0x84, 0x75,
-  0xD0, 0xAA, 0xC2, 0x33, 0x5D, 0x4C, 0x8C, 0xAA, 0x3D, 0x85, 0x77, 0xFA, 0x5E, 0xE4, 0xD4, 0x4B,
-  0xD4, 0x82, 0x39, 0x08, 0x03, 0x3F, 0x76, 0x8F, 0x54, 0x7F, 0xC5, 0xFE, 0x29, 0xD8, 0x3F, 0x42,
-  0x88, 0xBC, 0xD8, 0x1F, 0xB5, 0xD8, 0x50, 0xEC, 0x07, 0x79, 0x55, 0x66, 0x94, 0xCB, 0x45, 0x02,
-  0xD1, 0xDB, 0x6B, 0x24, 0x51, 0x71, 0x04, 0x32, 0xE0, 0xBD, 0x05, 0xC2, 0xF4, 0x3D, 0xCF, 0x4B,
-  0x07, 0x8D, 0x7A, 0xFD, 0x95, 0x14, 0x66, 0x92, 0xC2, 0x08, 0x3B, 0x0A, 0xD1, 0x43, 0xD4, 0x6C,
-  0x03, 0x89, 0x22, 0xC4, 0x9B, 0x4B, 0x63, 0x16, 0x45, 0x44, 0x18, 0x76, 0x79, 0xB6, 0x12, 0x72,
-  0xD0, 0x31, 0x6D, 0x09, 0x79, 0x85, 0x9A, 0x3D, 0x53, 0x11, 0x45, 0x0A, 0xED, 0x63, 0x08, 0xFF,
-  0xB9, 0xDD, 0x19, 0x85, 0x11, 0x63, 0x5D, 0xAB, 0x81, 0xE6, 0x69, 0x3A, 0x68, 0x10, 0x7F, 0x5C,
-  0x79, 0x68, 0x86, 0xA1, 0x33, 0x85, 0x0D, 0xB9, 0x29, 0x60, 0xD4, 0x66, 0x71, 0xE8, 0x3F, 0x27,
-  0x53, 0x0F, 0x86, 0xEB, 0xB2, 0x6B, 0xCD, 0x06, 0xAD, 0xD3, 0x9B, 0xAF, 0xB1, 0xC7, 0xB1, 0xF5,
-  0x28, 0x51, 0x1C, 0x8E, 0x72, 0x65, 0xFA, 0xE4, 0xA4, 0x23, 0x3D, 0x3F, 0x2C, 0xAE, 0x06, 0xAD,
-  0x94, 0x4B, 0xB4, 0x3B, 0xC5, 0xDE, 0x93, 0x36, 0x0D, 0x4D, 0x30, 0x03, 0x5D, 0xC4, 0xE7, 0x90,
-  0x69, 0x08, 0xCA, 0x1C, 0x63, 0x82, 0x71, 0x28, 0xD1, 0x5B, 0x7E, 0x53, 0x50, 0x02, 0xFC, 0xCA,
-  0x0A, 0x14, 0x03, 0xCE, 0x5A, 0x59, 0x83, 0xE2, 0x4B, 0x9C, 0x9B, 0x3D, 0x28, 0x6F, 0x56, 0xBA,
-  0xCE, 0x19, 0xEB, 0x98, 0xBF, 0xF3, 0xA8, 0xD0, 0x8D, 0x6F, 0xE0, 0xC7, 0xC9, 0x41, 0xE6, 0x75,
-  0x76, 0x7D, 0x82, 0x14, 0xC6, 0x76, 0xD8, 0x85, 0xC7, 0xE3, 0xED, 0xF0, 0x63, 0xC7, 0x05, 0xB6,
-  0x3B, 0x9D, 0xD7, 0xCE, 0xEA, 0xB8, 0xF8, 0xED, 0x02, 0xA5, 0xCB, 0x4C, 0xEF, 0xF0, 0x1D, 0x3E,
-  0x9C, 0x76, 0x38, 0x09, 0x4F, 0xC1, 0xE8, 0xAD, 0xC5, 0x7B, 0xE2, 0xED, 0x0C, 0x1E, 0x24, 0x06,
-  0x2D, 0x0C, 0xBE, 0xFF, 0xB8, 0x03, 0x7F, 0xCC, 0x7C, 0x13, 0x21, 0x98, 0xE7, 0x4D, 0xA3, 0x95,
-  0x60, 0x9A, 0x23, 0xFF, 0xBD, 0x70, 0x2D, 0x1D, 0x8A, 0x28, 0x3A, 0xB6, 0xAC, 0xCA, 0x44, 0xDF,
-  0xBF, 0x82, 0xF5, 0x01, 0x62, 0x00, 0x22, 0x72, 0xC6, 0xF0, 0x74, 0x98, 0xEA, 0x34, 0xD7, 0xBE,
-  0x1D, 0xE1, 0xCD, 0x0F, 0x8C, 0x06, 0x65, 0x29, 0x38, 0x7F, 0xA4, 0x60, 0x89, 0x5F, 0x43, 0x0F,
-  0xB5, 0x5F, 0xEB, 0x35, 0xF1, 0x28, 0xA6, 0xCF, 0x23, 0x6C, 0xBF, 0x4F, 0x78, 0x92, 0xE7, 0xCD,
-  0x09, 0xC0, 0x95, 0xA1, 0x6B, 0x08, 0x89, 0xCB, 0x33, 0x09, 0xEA, 0xC9, 0x53, 0xCA, 0x07, 0xDE,
-  0x09, 0x7B, 0xC3, 0xE2, 0x0C, 0x27, 0x4F, 0x71, 0x82, 0x95, 0xED, 0x43, 0xB3, 0xD9, 0xA8, 0xEF,
-  0x36, 0x7E, 0xAD, 0x37, 0xEB, 0x8D, 0xFA, 0x81, 0xCC, 0x1F, 0x91, 0x07, 0xC0, 0xD0, 0x8C, 0xFD,
-  0x65, 0x91, 0x9B, 0x31, 0x36, 0xAF, 0x3F, 0xDC, 0x7E, 0x34, 0xEB, 0x1F, 0xF2, 0xEF, 0xC7, 0x5E,
-  0xFD, 0x70, 0x59, 0xFB, 0xA1, 0xE6, 0xB5, 0x11, 0xFB, 0x01, 0xDF, 0xE0, 0x61, 0xD0, 0x9A, 0x72,
-  0x7A, 0xE4, 0xDA, 0x48, 0x79, 0x96, 0xE6, 0xD8, 0xCA, 0xE9, 0xD7, 0x72, 0x95, 0x91, 0x04, 0x17,
-  0x03, 0xC0, 0x19, 0xD6, 0xE0, 0x21, 0x76, 0x2C, 0xFF, 0xCA, 0x97, 0x26, 0x24, 0xE7, 0x5E, 0xCF,
-  0xF3, 0xAD, 0x32, 0x6B, 0x03, 0x31, 0x0A, 0x93, 0x97, 0xD2, 0xEA, 0xD4, 0xDF, 0xF3, 0x58, 0x5F,
-  0x8E, 0x2D, 0x9F, 0xEC, 0x8F, 0x30, 0x45, 0x63, 0x2D, 0x9C, 0xA2, 0x77, 0x62, 0x7A, 0x5E, 0xFC,
-  0xBB, 0x31, 0x3A, 0xCF, 0x1B, 0xF1, 0x7C, 0xBC, 0x32, 0x55, 0x2D, 0x0A, 0x7F, 0x33, 0xF2, 0xF0,
-  0xCA, 0xCC, 0xAF, 0x6F, 0x0A, 0x2B, 0x72, 0xD9, 0xD9, 0x9F, 0xDD, 0x8C, 0x7C, 0xCF, 0xF5, 0x58,
-  0xBA, 0xE7, 0x99, 0xA9, 0x9C, 0xA7, 0x67, 0x53, 0x56, 0xE2, 0xA0, 0x5C, 0x1C, 0xA6, 0x74, 0x0D,
-  0xFC, 0x49, 0xC9, 0xE8, 0x4B, 0x06, 0x08, 0xD9, 0x46, 0x4A, 0x9F, 0x4A, 0xBE, 0x3D, 0xF0, 0x26,
-  0xCB, 0xDF, 0xD9, 0xF6, 0x8A, 0xAC, 0x44, 0xE2, 0x29, 0xDD, 0x17, 0x03, 0xA0, 0x7D, 0x50, 0x08,
-  0xE0, 0xEF, 0x06, 0x99, 0x2B, 0x1A, 0xCD, 0xF0, 0x51, 0x7D, 0x5A, 0x0E, 0x8E, 0x29, 0x19, 0x88,
-  0xB4, 0x7B, 0x7E, 0x22, 0xEC, 0x31, 0x2D, 0x4D, 0xA6, 0x7F, 0x48, 0x92, 0x12, 0xBE, 0x2B, 0xEF,
-  0x8B, 0x29, 0x9B, 0x10, 0x7C, 0x9A, 0x88, 0x2B, 0xA9, 0xEB, 0xEF, 0x31, 0xE3, 0x02, 0x76, 0x85,
-  0x86, 0x84, 0x46, 0x64, 0x48, 0x98, 0x4E, 0x88, 0xA1, 0x74, 0x2F, 0x67, 0x5B, 0xAA, 0x60, 0x79,
-  0xA2, 0x87, 0x30, 0x74, 0xB2, 0x48, 0x40, 0xE5, 0x24, 0x17, 0x8C, 0x1C, 0xDB, 0x26, 0xB7, 0xAA,
-  0xF0, 0xE6, 0x60, 0x65, 0xC2, 0xAC, 0xCD, 0x71, 0x02, 0x81, 0xD3, 0xCD, 0xDC, 0x24, 0x6C, 0x33,
-  0xDA, 0xA4, 0x73, 0xAC, 0x6D, 0x08, 0x4A, 0xEF, 0xC4, 0x8D, 0xA2, 0x20, 0xC6, 0xF1, 0xFD, 0xF1,
-  0xF8, 0xD0, 0xB9, 0x57, 0x76, 0x9F, 0x68, 0x94, 0x12, 0x1B, 0xA6, 0x56, 0x90, 0xB5, 0x61, 0x39,
-  0xA2, 0x57, 0xDD, 0xD6, 0xBF, 0xDA, 0x5D, 0xDF, 0xFD, 0x73, 0xDE, 0xED, 0x48, 0x3D, 0x4A, 0x7F,
-  0xF4, 0x75, 0xCF, 0x74, 0x05, 0xF3, 0x3D, 0x1D, 0xF0, 0xC0, 0xD3, 0x77, 0x30, 0x12, 0xBB, 0xF6,
-  0x37, 0x9A, 0x81, 0xFC, 0x4A, 0xBE, 0x1B, 0x6B, 0xF6, 0x31, 0xFE, 0x9C, 0x44, 0x08, 0xC7, 0xA6,
-  0x22, 0x50, 0x0E, 0x66, 0xF9, 0xF3, 0xD9, 0x27, 0x66, 0x38, 0x7A, 0x80, 0xF6, 0xBD, 0xDA, 0x6F,
-  0x01, 0xF7, 0x9E, 0xA4, 0xA2, 0xE4, 0x78, 0xA0, 0x2A, 0x6D, 0xBD, 0xAD, 0x09, 0xF1, 0xF6, 0x5D,
-  0xD4, 0x32, 0x6C, 0x53, 0x03, 0xF1, 0xE3, 0x5C, 0xD3, 0x07, 0x5B, 0x82, 0x7D, 0x6A, 0xB1, 0x7F,
-  0x4F, 0xCC, 0x1F, 0xF3, 0x5D, 0x75, 0x1D, 0x47, 0xF8, 0xC2, 0xD3, 0xDC, 0xDA, 0x9D, 0x6C, 0xB1,
-  0x25, 0x46, 0x9D, 0xFC, 0xC7, 0x3B, 0x35, 0xC3, 0x70, 0x5E, 0xB0, 0x09, 0xA0, 0x81, 0x03, 0xEF,
-  0xF9, 0xB8, 0x33, 0x10, 0x43, 0x60, 0xC0, 0xFF, 0x1F, 0xB4, 0x4F, 0x97, 0xA6, 0x17, 0xDA, 0x00
+  0x64, 0x7F, 0x60, 0x3F, 0xE5, 0x7C, 0xC9, 0x66, 0x66, 0x15, 0x40, 0x00, 0x04, 0x89, 0x8B, 0x78,
+  0x55, 0xCB, 0x1D, 0x2D, 0x89, 0x20, 0xEA, 0x96, 0x95, 0x99, 0x95, 0x99, 0x95, 0x97, 0x0F, 0xFF,
+  0x74, 0xF6, 0xF5, 0xF4, 0xF6, 0xE7, 0xCE, 0x39, 0x1B, 0x8A, 0x91, 0x75, 0xF4, 0xEA, 0x03, 0xFE,
+  0x62, 0x96, 0x66, 0x0F, 0x3E, 0xD6, 0xB8, 0x5D, 0x3B, 0x7A, 0x05, 0x4F, 0xB8, 0x66, 0x1C, 0xBD,
+  0x62, 0xF0, 0xEF, 0xC3, 0x88, 0x0B, 0x8D, 0xE9, 0x43, 0xCD, 0xF3, 0xB9, 0xF8, 0x58, 0x0B, 0x44,
+  0xBF, 0xFE, 0xAE, 0xC6, 0x76, 0xE2, 0x5F, 0x0E, 0x85, 0x70, 0xEB, 0xFC, 0xB7, 0xC0, 0xBC, 0xFB,
+  0x58, 0xFB, 0xA9, 0xFE, 0xED, 0xB8, 0x7E, 0xEA, 0x8C, 0x5C, 0x4D, 0x98, 0x3D, 0x8B, 0xD7, 0x98,
+  0xEE, 0xD8, 0x82, 0xDB, 0xD0, 0xF2, 0xF2, 0xFC, 0x23, 0x37, 0x06, 0x7C, 0x5B, 0x1F, 0x7A, 0xCE,
+  0x88, 0x7F, 0x6C, 0x8D, 0x3B, 0x11, 0xA6, 0xB0, 0xF8, 0x51, 0xD7, 0xD5, 0xBC, 0x1F, 0x17, 0x81,
+  0xCD, 0x6E, 0x6E, 0xFF, 0xC2, 0xBA, 0x5C, 0x04, 0xEE, 0x87, 0x1D, 0xF9, 0x4D, 0x6C, 0x28, 0x5B,
+  0x83, 0xA6, 0xB5, 0x3B, 0x93, 0xDF, 0xBB, 0x8E, 0x27, 0x6A, 0xF4, 0x0D, 0xFE, 0x8B, 0x46, 0xB9,
+  0x37, 0x0D, 0x31, 0xFC, 0x68, 0xF0, 0x3B, 0x53, 0xE7, 0x75, 0xFA, 0xB0, 0xCD, 0x4C, 0xDB, 0x14,
+  0xA6, 0x66, 0xD5, 0x7D, 0x5D, 0xB3, 0x60, 0xE0, 0x6D, 0x36, 0xD2, 0x1E, 0xCC, 0x51, 0x30, 0x1A,
+  0x3F, 0x08, 0x7C, 0xEE, 0xD1, 0x27, 0x0D, 0xE6, 0xFC, 0xB1, 0xB9, 0xCD, 0xFC, 0xA1, 0x67, 0xDA,
+  0x3F, 0xEA, 0xC2, 0xA9, 0xF7, 0x4D, 0xF1, 0xF1, 0x91, 0xFB, 0xE3, 0xD9, 0x5A, 0xF0, 0x05, 0xF3,
+  0xB8, 0xF5, 0xB1, 0xE6, 0x8B, 0x47, 0x8B, 0xFB, 0x43, 0xCE, 0x45, 0x8D, 0x0D, 0x3D, 0xDE, 0x87,
+  0x27, 0x9E, 0xBE, 0xD3, 0x73, 0x1C, 0xE1, 0x0B, 0x4F, 0x73, 0x1B, 0x23, 0xD3, 0x6E, 0xE8, 0xBE,
+  0x5F, 0x2B, 0xD8, 0x90, 0x9E, 0xC6, 0x1B, 0xF8, 0xBA, 0x67, 0xBA, 0x82, 0xC1, 0x77, 0xF2, 0x85,
+  0xBF, 0xFD, 0x16, 0x70, 0xEF, 0xB1, 0xBE, 0xDB, 0x38, 0x68, 0x34, 0xA9, 0xF3, 0xBF, 0xC1, 0xAB,
+  0x1F, 0x76, 0xE4, 0x6B, 0x53, 0xDA, 0x24, 0x67, 0x53, 0xAA, 0x41, 0x2F, 0xB0, 0x0D, 0x98, 0xD0,
+  0x64, 0xBB, 0x78, 0xC3, 0xA3, 0x68, 0x0B, 0xFE, 0xC7, 0x96, 0xE1, 0xE8, 0xC1, 0x08, 0x76, 0xE1,
+  0x4D, 0xC3, 0xB1, 0xB7, 0x5E, 0xEB, 0x96, 0xA9, 0xFF, 0x78, 0xBD, 0xCD, 0x5E, 0x37, 0x84, 0x33,
+  0x18, 0x58, 0xBC, 0xDE, 0x13, 0x36, 0x7C, 0xEC, 0x07, 0xB6, 0x2E, 0x4C, 0xC7, 0x66, 0x5B, 0xFC,
+  0x0D, 0xFB, 0xF7, 0xA8, 0xB5, 0xEC, 0x01, 0x96, 0x1F, 0x78, 0x1E, 0x74, 0x71, 0xAB, 0x79, 0x03,
+  0x2E, 0x1A, 0xFA, 0xD0, 0xB4, 0x0C, 0xF8, 0xFC, 0xBF, 0x9A, 0xFF, 0xFB, 0x8D, 0xEA, 0xE6, 0xD4,
+  0xD2, 0x7C, 0x7F, 0xEB, 0xB5, 0x09, 0x3B, 0x5E, 0xD7, 0x35, 0x8F, 0x8B, 0xBA, 0xE1, 0xDC, 0xDB,
+  0x2C, 0xF6, 0x39, 0x70, 0x5F, 0xBF, 0xF9, 0x73, 0xD4, 0xF1, 0x7F, 0xBC, 0x91, 0xD3, 0x4D, 0xCF,
+  0x1E, 0x81, 0x3D, 0x9E, 0x7C, 0xC3, 0x17, 0x80, 0xB0, 0x7A, 0x7D, 0xE0, 0x39, 0x81, 0x9B, 0x9A,
+  0xD6, 0x90, 0x9B, 0x83, 0xA1, 0x38, 0x64, 0xCD, 0x3F, 0x27, 0x1E, 0x3B, 0x77, 0xDC, 0xEB, 0x5B,
+  0xCE, 0xFD, 0x21, 0x1B, 0x9A, 0x86, 0xC1, 0xED, 0xE4, 0xB7, 0x00, 0x41, 0xDB, 0x37, 0x71, 0xA1,
+  0x87, 0xAA, 0x03, 0xD6, 0x6C, 0xEC, 0xF9, 0x8C, 0x6B, 0x3E, 0x4F, 0xBE, 0xD9, 0x73, 0x3C, 0x03,
+  0xB0, 0xAF, 0xE7, 0x08, 0xE1, 0x8C, 0x0E, 0x99, 0xEF, 0x58, 0xA6, 0xC1, 0x5A, 0xEE, 0x03, 0xFB,
+  0x93, 0xDE, 0xC4, 0xFF, 0x62, 0x4B, 0x79, 0x35, 0x9E, 0xAF, 0x65, 0xFA, 0x62, 0xBD, 0x67, 0x8B,
+  0xFF, 0x5C, 0xCD, 0x30, 0x4C, 0x7B, 0x50, 0xF7, 0xE4, 0x9C, 0xF6, 0x9B, 0xEE, 0x43, 0xF6, 0x72,
+  0x64, 0xB7, 0x40, 0x14, 0x3E, 0x13, 0xC6, 0x76, 0xF6, 0xF3, 0x61, 0x6A, 0xA5, 0xF2, 0xBB, 0x43,
+  0x66, 0x3B, 0x76, 0x6A, 0x92, 0x23, 0xC0, 0x1E, 0xD3, 0xAE, 0x5B, 0xBC, 0x8F, 0x80, 0x98, 0x32,
+  0x66, 0x2F, 0x80, 0x25, 0xD8, 0x87, 0x7D, 0x40, 0x5A, 0x3F, 0xD5, 0xB3, 0x13, 0x08, 0x20, 0x56,
+  0x9E, 0x00, 0x62, 0x7C, 0xB6, 0xA6, 0x8D, 0x5F, 0x9F, 0x7B, 0x9E, 0xE3, 0xA5, 0x5A, 0x1A, 0xA6,
+  0xEF, 0x5A, 0xDA, 0xE3, 0x21, 0x93, 0xAF, 0x24, 0xA7, 0xA5, 0x3B, 0x96, 0x03, 0xF3, 0xF5, 0xB8,
+  0x91, 0x7C, 0xDE, 0x07, 0xE6, 0x55, 0xF7, 0xCD, 0xDF, 0x61, 0x40, 0x7F, 0xA4, 0x59, 0x16, 0xF7,
+  0x66, 0x0D, 0xDB, 0x0D, 0x74, 0x1D, 0xE1, 0x51, 0x7E, 0xE0, 0x81, 0xC7, 0xD3, 0x1B, 0x3F, 0x6B,
+  0xE8, 0xE8, 0xFB, 0x7B, 0x85, 0x52, 0x3D, 0xC7, 0x32, 0xA6, 0x6D, 0xDF, 0x43, 0x9D, 0xDA, 0xA7,
+  0x66, 0x35, 0x7D, 0x23, 0xF0, 0x1F, 0xB1, 0xE7, 0x43, 0xB6, 0xDB, 0xFC, 0xE7, 0xE9, 0xBD, 0xCA,
+  0x1E, 0xDA, 0xCD, 0x59, 0x1D, 0xB7, 0x67, 0xA0, 0x55, 0xD8, 0xC3, 0xDE, 0xCC, 0x1E, 0xF6, 0xA6,
+  0xF7, 0xA0, 0x09, 0x01, 0x4C, 0x37, 0xD5, 0xD8, 0x75, 0x42, 0x6A, 0xD1, 0x7A, 0x40, 0x02, 0x81,
+  0x48, 0x01, 0xFC, 0xF7, 0xBA, 0x69, 0x1B, 0xFC, 0xE1, 0x90, 0xB5, 0x9A, 0xCD, 0x14, 0x49, 0x28,
+  0x52, 0x68, 0x4D, 0x40, 0x03, 0x0E, 0xA5, 0xBA, 0x82, 0xC8, 0x41, 0x33, 0xE3, 0x5B, 0x9A, 0xAE,
+  0x70, 0x5C, 0x20, 0xA3, 0xE4, 0x64, 0x15, 0x7B, 0x93, 0x0C, 0xED, 0xC3, 0x8E, 0x3C, 0xBA, 0x5F,
+  0x7D, 0xE8, 0x39, 0xC6, 0xA3, 0xE2, 0xF1, 0x86, 0x79, 0xC7, 0x74, 0xE4, 0x9B, 0x1F, 0x6B, 0x78,
+  0x50, 0x6A, 0x80, 0x20, 0x5E, 0x8D, 0x99, 0xC6, 0xC7, 0x9A, 0x5A, 0xDE, 0x25, 0x3C, 0xAE, 0x8D,
+  0xB9, 0x21, 0x35, 0xD0, 0x2C, 0x73, 0x60, 0x7F, 0xAC, 0xD1, 0x7C, 0x6B, 0x61, 0x73, 0xF5, 0x7E,
+  0xEC, 0x5D, 0x7A, 0xDF, 0x1C, 0x0D, 0xD2, 0xDD, 0x5D, 0x98, 0x16, 0xFF, 0x02, 0xA7, 0x75, 0x6D,
+  0x7C, 0xB4, 0x9C, 0xC8, 0x6F, 0xDB, 0xBF, 0x9E, 0x0E, 0x69, 0x35, 0x83, 0x86, 0x6B, 0x0F, 0x6A,
+  0x30, 0x10, 0x9C, 0xDB, 0xEA, 0x3B, 0x66, 0xF1, 0x3B, 0x6E, 0xD5, 0x8E, 0x80, 0x41, 0xBB, 0x9A,
+  0x1D, 0xEF, 0xB3, 0xC3, 0x3D, 0x1D, 0x0E, 0x86, 0x5A, 0x62, 0x60, 0x42, 0x6E, 0x39, 0x33, 0x42,
+  0x3F, 0x18, 0x0C, 0xC1, 0xF0, 0xB1, 0x16, 0x92, 0x83, 0xA2, 0x86, 0xDA, 0xD1, 0xBF, 0x1D, 0xBC,
+  0x05, 0x18, 0x41, 0x9F, 0xB1, 0x55, 0xEE, 0xC0, 0x32, 0x15, 0x84, 0xE4, 0x9F, 0xB3, 0xA0, 0x95,
+  0xEA, 0x98, 0x98, 0x4E, 0x7C, 0x57, 0x08, 0x09, 0xC7, 0x7B, 0x28, 0xB7, 0x50, 0x02, 0xD9, 0xE3,
+  0x20, 0x3A, 0x5D, 0xDA, 0x1D, 0xCF, 0x41, 0xC2, 0x8D, 0xC3, 0xB9, 0x77, 0x74, 0x83, 0xDF, 0x09,
+  0x80, 0xC5, 0x87, 0x9D, 0xDE, 0xD1, 0x87, 0x9E, 0x47, 0xFF, 0xA3, 0x04, 0x24, 0x45, 0x18, 0x66,
+  0xFA, 0xC0, 0x2F, 0xF0, 0x4C, 0x46, 0x70, 0xB1, 0x8E, 0x85, 0x1C, 0x99, 0xDD, 0x6B, 0xA6, 0x68,
+  0x34, 0x1A, 0xCB, 0x9A, 0x3A, 0x8A, 0x73, 0x16, 0x17, 0x3C, 0x63, 0xE6, 0xEC, 0x0C, 0x3A, 0x9B,
+  0x32, 0xF5, 0xA1, 0xE6, 0x03, 0x6F, 0xBE, 0x67, 0xD4, 0xC7, 0x32, 0x26, 0xDB, 0x37, 0xBD, 0xD1,
+  0x3D, 0x88, 0x00, 0xDF, 0x5C, 0xCB, 0xD1, 0x8C, 0xEC, 0x59, 0xA7, 0xE7, 0x7B, 0xA1, 0xDA, 0xB0,
+  0xC0, 0x35, 0x34, 0xC1, 0x81, 0x55, 0xCA, 0x56, 0x0D, 0x96, 0xDC, 0x04, 0xB9, 0x90, 0x70, 0x23,
+  0x0A, 0x2E, 0xE6, 0xE8, 0x55, 0x26, 0x49, 0x21, 0x1E, 0xE3, 0x52, 0xA3, 0xF7, 0x41, 0x34, 0x1D,
+  0xD5, 0x5B, 0x6D, 0x90, 0xB1, 0x90, 0x90, 0x22, 0x7A, 0xF1, 0xC4, 0x8F, 0xBA, 0x8F, 0x82, 0x70,
+  0x8C, 0x4E, 0x12, 0x52, 0xF2, 0x77, 0xF3, 0xC2, 0x94, 0xA2, 0x32, 0x8A, 0x67, 0xB1, 0xD9, 0x14,
+  0x06, 0x73, 0x0C, 0xB0, 0xAD, 0xE9, 0x80, 0x1D, 0x41, 0xA3, 0x8E, 0x36, 0xE0, 0x05, 0x17, 0xE4,
+  0x39, 0xF7, 0x13, 0xFB, 0xD8, 0xB3, 0x1C, 0xFD, 0xC7, 0x9F, 0xE3, 0x1D, 0xE4, 0x74, 0x22, 0x8F,
+  0x13, 0x64, 0xCF, 0x29, 0x66, 0x83, 0xFF, 0x70, 0xF1, 0xE1, 0xCE, 0x1D, 0xC6, 0x78, 0x05, 0x40,
+  0x2C, 0x7C, 0xFC, 0x57, 0xEE, 0xF9, 0xC0, 0xA1, 0xA7, 0x73, 0x84, 0xBB, 0x66, 0xA3, 0xA9, 0x58,
+  0x02, 0x22, 0xC2, 0xC4, 0x18, 0xE3, 0x5E, 0x7F, 0xE7, 0x46, 0xE1, 0x5E, 0x7F, 0x39, 0x3F, 0xAB,
+  0x5F, 0xBC, 0xEF, 0xC4, 0x66, 0x17, 0x1B, 0x87, 0xE5, 0x0C, 0x24, 0xD1, 0xED, 0xE4, 0xF6, 0xF2,
+  0x6C, 0xFA, 0x00, 0x67, 0x12, 0x25, 0x4F, 0xAC, 0x80, 0x0B, 0xC0, 0xC6, 0x21, 0xBB, 0x3C, 0x83,
+  0xA3, 0x15, 0xFE, 0x15, 0x1C, 0x43, 0x77, 0x40, 0x6C, 0x32, 0x6D, 0xC0, 0x75, 0xFF, 0xEA, 0xEA,
+  0xF3, 0xF4, 0x71, 0xAE, 0xAE, 0x86, 0x87, 0x13, 0xDD, 0x24, 0xBB, 0x1A, 0x70, 0xC7, 0xE0, 0x20,
+  0x35, 0x5F, 0x69, 0x62, 0x7A, 0x3F, 0x7B, 0xB0, 0xFC, 0xF7, 0xCD, 0xF6, 0xFB, 0xBD, 0xB7, 0xEF,
+  0xD5, 0x0C, 0xB7, 0x8B, 0x76, 0x3B, 0x0B, 0xCE, 0xF5, 0x56, 0x73, 0xBF, 0xD1, 0x7A, 0xB7, 0xDF,
+  0xDC, 0x7F, 0x7B, 0xD0, 0x2A, 0xD9, 0xF1, 0xB1, 0x35, 0x63, 0xBE, 0xAD, 0xFD, 0x03, 0x98, 0xF1,
+  0xBB, 0x70, 0xB2, 0x6C, 0xEB, 0xB8, 0x73, 0xFA, 0x66, 0x12, 0x9E, 0x85, 0x10, 0x27, 0x06, 0xEB,
+  0xF3, 0xD3, 0xF3, 0x8B, 0xE9, 0x83, 0xE2, 0xB7, 0x79, 0xD0, 0xE6, 0x3A, 0xEF, 0xFF, 0x34, 0x0B,
+  0x20, 0xED, 0x77, 0xCD, 0x76, 0xF3, 0xA0, 0xB1, 0x7F, 0xF0, 0xAE, 0x20, 0x3C, 0xB0, 0xC7, 0x9F,
+  0x67, 0xF4, 0xB8, 0xF7, 0xB6, 0x75, 0xF0, 0xAE, 0xB9, 0xD7, 0xD8, 0x6B, 0xEE, 0x96, 0xE8, 0xF1,
+  0x97, 0x59, 0xB8, 0xF0, 0xEE, 0xE0, 0xE0, 0x60, 0xBF, 0xB1, 0xF7, 0x6E, 0x2F, 0x7D, 0x18, 0xE7,
+  0x01, 0x36, 0xCE, 0xD2, 0x32, 0x3F, 0x0F, 0xBD, 0x90, 0x73, 0x8C, 0x44, 0xBD, 0x99, 0x16, 0x66,
+  0x26, 0xD9, 0x1D, 0x9D, 0x23, 0x13, 0xFC, 0xE8, 0x9F, 0xEA, 0x75, 0x56, 0x0F, 0xFF, 0x31, 0x38,
+  0xB1, 0xFB, 0x20, 0xC6, 0xB0, 0x53, 0xC7, 0xEE, 0x9B, 0x83, 0xD8, 0x17, 0xF5, 0xFA, 0xD1, 0x24,
+  0x1F, 0x53, 0xC3, 0x1B, 0xA0, 0x96, 0x81, 0x4E, 0x34, 0xD0, 0xDC, 0x7A, 0x3B, 0x83, 0x75, 0x7D,
+  0x90, 0x7A, 0x47, 0x24, 0x50, 0x09, 0x9B, 0xC1, 0xFF, 0x75, 0xD7, 0x33, 0x61, 0x72, 0x8F, 0x6C,
+  0xAC, 0x2B, 0x4B, 0xD6, 0xEB, 0xCA, 0x29, 0xC8, 0x19, 0xD4, 0x98, 0x78, 0x74, 0x61, 0x19, 0xB2,
+  0x8B, 0x1A, 0x83, 0x13, 0x4B, 0xAB, 0xCB, 0x16, 0x74, 0x8C, 0x58, 0x9A, 0xEB, 0xF3, 0x5A, 0xE6,
+  0x1E, 0xC9, 0x57, 0x49, 0xAB, 0xFE, 0x58, 0xFB, 0x53, 0xF8, 0x6E, 0x27, 0xD9, 0xBB, 0xE6, 0x99,
+  0x5A, 0x9D, 0x3F, 0xC0, 0x06, 0x18, 0x1C, 0xCF, 0x53, 0xCD, 0x82, 0xEE, 0xE4, 0x53, 0x3C, 0x3A,
+  0x3C, 0xC7, 0xF2, 0xC7, 0xE3, 0x24, 0xDB, 0x1E, 0x65, 0x8E, 0x9A, 0x04, 0x60, 0xE0, 0x69, 0xA4,
+  0xF9, 0x7F, 0x30, 0x13, 0x4B, 0x43, 0xA5, 0x7D, 0x7C, 0x18, 0x92, 0x0A, 0x8F, 0xDA, 0x3C, 0xEB,
+  0x99, 0x2C, 0xA5, 0xE5, 0xE3, 0x29, 0x67, 0x66, 0xE1, 0x8C, 0x04, 0x48, 0x26, 0xC6, 0x4C, 0xDB,
+  0xA6, 0x70, 0x19, 0x6C, 0xD4, 0x83, 0x7D, 0x52, 0xE4, 0x5A, 0x6C, 0x65, 0x89, 0x6E, 0x34, 0xCF,
+  0x60, 0xF8, 0xA3, 0x8E, 0xF2, 0x76, 0x1A, 0x9F, 0xB2, 0x5A, 0xF4, 0x1D, 0x6F, 0xA4, 0x34, 0x77,
+  0xC0, 0xD4, 0xF6, 0x14, 0xC8, 0xC5, 0xA0, 0x77, 0x38, 0xF5, 0x05, 0x49, 0x78, 0xAA, 0x5F, 0x21,
+  0x14, 0x42, 0xF4, 0xFC, 0x3A, 0x90, 0x9D, 0xCE, 0x47, 0x64, 0x10, 0x93, 0xF2, 0xFB, 0xD4, 0x2E,
+  0x48, 0xFB, 0x47, 0x2B, 0x1B, 0x88, 0x16, 0xDC, 0xE2, 0xBA, 0x60, 0x1A, 0x53, 0x1B, 0xC3, 0x00,
+  0x0D, 0x40, 0xEB, 0xE6, 0x36, 0x83, 0xFE, 0xE1, 0x88, 0x66, 0x4A, 0x52, 0x05, 0x55, 0xDC, 0x81,
+  0xE7, 0x9A, 0x08, 0x5F, 0x6C, 0xB0, 0x63, 0x21, 0xA5, 0xBC, 0xED, 0xB8, 0xD4, 0x74, 0x6F, 0xC2,
+  0x01, 0x1E, 0x00, 0x84, 0x7D, 0xEA, 0x98, 0x1B, 0xE3, 0xF7, 0x43, 0xBC, 0xD0, 0x87, 0x9A, 0x3D,
+  0xE0, 0x3E, 0x43, 0x01, 0xCC, 0xD7, 0xEE, 0xE0, 0x95, 0x7B, 0x1A, 0x0F, 0xD4, 0xD9, 0x7E, 0x9F,
+  0xA3, 0x21, 0x28, 0x9A, 0x0C, 0xC8, 0x60, 0x51, 0x3F, 0xA0, 0x76, 0xD3, 0x7B, 0xAF, 0xBB, 0xD0,
+  0x26, 0x89, 0x5C, 0xAF, 0xF1, 0x45, 0x17, 0x26, 0xE3, 0x73, 0xA3, 0x31, 0x03, 0xB6, 0x13, 0xE0,
+  0x23, 0x54, 0x33, 0xED, 0xBE, 0x53, 0xD7, 0x4D, 0x4F, 0x87, 0x01, 0x05, 0x7F, 0x10, 0x11, 0x59,
+  0x8E, 0x7C, 0xDC, 0xA9, 0x69, 0x4C, 0x2B, 0xC5, 0xBC, 0xB2, 0x51, 0x20, 0xC5, 0xB0, 0x0A, 0xA0,
+  0x07, 0xCA, 0x51, 0x47, 0x39, 0x9B, 0x9F, 0xCD, 0x6A, 0x13, 0xDA, 0x6D, 0xC8, 0xE9, 0x66, 0x82,
+  0xC2, 0xB4, 0xDD, 0x40, 0x28, 0xF6, 0xE2, 0x69, 0x86, 0xE9, 0xD4, 0x94, 0xAD, 0x55, 0xC1, 0xFF,
+  0x46, 0x3E, 0xBB, 0xD3, 0x40, 0xEE, 0xF8, 0x58, 0x6B, 0xE6, 0x75, 0x67, 0x69, 0x3D, 0x6E, 0xC5,
+  0xA9, 0xBC, 0x49, 0xBA, 0xE0, 0x91, 0xDA, 0x78, 0x38, 0xB1, 0xE9, 0x8D, 0x27, 0x81, 0xF2, 0x59,
+  0x40, 0xB2, 0x55, 0x1A, 0x92, 0x2D, 0x09, 0xC9, 0x56, 0x7B, 0x77, 0x6F, 0xFF, 0xE0, 0xED, 0xBB,
+  0xF7, 0xCD, 0xF1, 0x5F, 0x2F, 0x50, 0x55, 0x50, 0x6D, 0x97, 0x86, 0x6A, 0x5B, 0x42, 0xF5, 0x05,
+  0x82, 0x0A, 0x82, 0xBB, 0xA5, 0x21, 0xB8, 0xFB, 0x02, 0xC1, 0x04, 0x04, 0xF7, 0x4A, 0x43, 0x70,
+  0xEF, 0x05, 0x82, 0x09, 0x08, 0xEE, 0x97, 0x86, 0xE0, 0xFE, 0x0B, 0x04, 0x13, 0x10, 0x3C, 0x28,
+  0x0D, 0xC1, 0x83, 0x17, 0x08, 0x26, 0x20, 0xF8, 0xB6, 0x34, 0x04, 0xDF, 0xCE, 0x0F, 0x82, 0x73,
+  0x04, 0xA1, 0x9C, 0x26, 0xBC, 0x1F, 0xCD, 0x53, 0x1A, 0xE7, 0x43, 0x35, 0x34, 0x7E, 0xD5, 0xA2,
+  0x0C, 0x92, 0xBB, 0xF4, 0xC7, 0x1E, 0xFD, 0xA4, 0x81, 0xA8, 0x8F, 0x48, 0x86, 0x9B, 0x09, 0x16,
+  0xEC, 0xFC, 0x30, 0x1F, 0x04, 0x49, 0x7D, 0x0C, 0x07, 0x7D, 0x47, 0xC3, 0xBD, 0x2D, 0xB3, 0x89,
+  0x28, 0xA8, 0xD7, 0x12, 0x10, 0x51, 0xCA, 0x6A, 0x42, 0x83, 0x96, 0xBB, 0x32, 0xBB, 0x57, 0x37,
+  0xDD, 0x80, 0xAE, 0xF8, 0xA2, 0xBE, 0x63, 0xD7, 0x7E, 0xB8, 0xBF, 0xEE, 0xAC, 0xBD, 0x9D, 0x4A,
+  0x01, 0x93, 0x03, 0x9D, 0x92, 0x12, 0x74, 0x0D, 0x2A, 0x0B, 0x9A, 0x58, 0x93, 0x83, 0xA9, 0xCB,
+  0xBE, 0x19, 0xC3, 0xCD, 0x1F, 0x55, 0x26, 0xED, 0x25, 0xEA, 0xB6, 0x77, 0xBF, 0x00, 0x75, 0x29,
+  0xEB, 0x46, 0xD2, 0x4E, 0x41, 0xD7, 0x38, 0xC2, 0xA6, 0x1B, 0x03, 0x85, 0x3D, 0xB5, 0x69, 0x06,
+  0x90, 0x4C, 0x4C, 0x9C, 0xAD, 0xBF, 0xD2, 0x95, 0xAD, 0x7D, 0x8A, 0xFE, 0x06, 0x13, 0xE3, 0x6C,
+  0xBD, 0xA9, 0xA9, 0x9B, 0x0A, 0xF5, 0x20, 0xDB, 0x58, 0xB0, 0x20, 0xCD, 0x3A, 0xA6, 0x5D, 0xCB,
+  0x49, 0xA4, 0x55, 0x61, 0x54, 0xA5, 0xFB, 0x9A, 0x2E, 0x1C, 0x58, 0xB9, 0xC1, 0xFB, 0x5A, 0x60,
+  0x09, 0x3F, 0x4F, 0x6D, 0x5D, 0x88, 0xEA, 0x9A, 0xC7, 0x91, 0x8A, 0x63, 0xB5, 0x17, 0x83, 0xFE,
+  0xB5, 0x3F, 0x98, 0x1B, 0x42, 0x67, 0xD9, 0x73, 0x32, 0x5E, 0x4D, 0x99, 0xF0, 0x3E, 0x7D, 0xE9,
+  0x76, 0x97, 0x69, 0xBF, 0x1B, 0x09, 0xE0, 0x9B, 0x71, 0x23, 0xDE, 0x9C, 0x2D, 0x76, 0xB8, 0x9E,
+  0x4A, 0xE6, 0xBA, 0x58, 0xC3, 0x6C, 0xB8, 0xC7, 0x20, 0x95, 0x32, 0xD4, 0x0D, 0x6C, 0xDF, 0x5F,
+  0xB1, 0x95, 0x2E, 0x69, 0xA0, 0x9B, 0xB9, 0x96, 0xE9, 0xD6, 0x39, 0xE6, 0x8A, 0x7A, 0x6B, 0xA6,
+  0x89, 0x8E, 0x2E, 0xBB, 0xB8, 0xE6, 0x07, 0x1E, 0xD1, 0xF8, 0x8D, 0x26, 0xF8, 0x25, 0x9E, 0x34,
+  0x33, 0x28, 0xF2, 0x7A, 0xFC, 0x3A, 0xC3, 0xF7, 0x0F, 0x0B, 0x9D, 0x76, 0xB3, 0x59, 0xF0, 0x94,
+  0xB3, 0xB1, 0x4D, 0xFC, 0xB0, 0xD5, 0x46, 0x92, 0xDE, 0x65, 0x63, 0x86, 0x5E, 0x84, 0x5F, 0xC4,
+  0xCE, 0xFF, 0xD4, 0x02, 0x3F, 0xFF, 0x9E, 0xB8, 0x89, 0x8C, 0x9F, 0xF4, 0x97, 0x76, 0x6E, 0xC7,
+  0xF8, 0xEF, 0xF3, 0xEF, 0x87, 0x85, 0xDE, 0x9B, 0x23, 0x53, 0x4D, 0x31, 0xD7, 0xDB, 0x21, 0x67,
+  0x76, 0x30, 0xEA, 0x71, 0x8F, 0x39, 0x7D, 0x46, 0x1E, 0x19, 0x80, 0xBF, 0x3E, 0x1A, 0x0A, 0x2D,
+  0x47, 0x97, 0xC8, 0xFC, 0x8F, 0xBF, 0xFF, 0x57, 0xDF, 0x7C, 0xE0, 0xFE, 0x3F, 0xFE, 0xFE, 0xDF,
+  0xCC, 0x85, 0x17, 0x7D, 0x0E, 0x68, 0x6B, 0x34, 0xD8, 0xB1, 0xFD, 0x28, 0x86, 0xA6, 0x3D, 0x60,
+  0x5A, 0xCF, 0xB9, 0xE3, 0x6C, 0xEF, 0xF3, 0xEF, 0x20, 0x53, 0x3E, 0x02, 0xD6, 0xA0, 0xE9, 0x72,
+  0x7C, 0xCD, 0x06, 0x2F, 0x0F, 0xB8, 0x4F, 0x3D, 0x01, 0xBD, 0xED, 0x50, 0xCF, 0x03, 0x74, 0x62,
+  0x40, 0xD7, 0x1B, 0xDD, 0xE3, 0xB0, 0x34, 0xDD, 0xE4, 0x7E, 0x83, 0x7D, 0x71, 0x00, 0x09, 0x18,
+  0xCE, 0x28, 0x06, 0x68, 0xE6, 0xE1, 0xE5, 0xB2, 0xE9, 0x93, 0x1F, 0x96, 0x47, 0x1E, 0x58, 0xC8,
+  0xFA, 0x5B, 0x30, 0x18, 0x59, 0x32, 0x4D, 0x9B, 0x9D, 0xE0, 0xCD, 0xFE, 0xC8, 0x31, 0x78, 0x83,
+  0x9D, 0xC9, 0x93, 0xE0, 0x10, 0x27, 0xD3, 0x60, 0x57, 0xE6, 0xC8, 0x44, 0xF7, 0x99, 0x46, 0xB3,
+  0xD9, 0x6C, 0xB5, 0xDB, 0xD4, 0xAE, 0x09, 0x5F, 0x14, 0xD8, 0xF6, 0x85, 0x1E, 0x17, 0x45, 0x8F,
+  0x8D, 0xF1, 0x7B, 0x39, 0xE2, 0x60, 0x81, 0x33, 0x66, 0x0A, 0x65, 0x48, 0x21, 0x75, 0xBF, 0x0A,
+  0x61, 0xC4, 0x25, 0x49, 0x89, 0x42, 0x99, 0xB2, 0x64, 0xEC, 0x9A, 0x60, 0x92, 0x7E, 0x0A, 0x0C,
+  0xE3, 0x66, 0x37, 0xAD, 0x2A, 0x60, 0xE6, 0x49, 0x7E, 0xB1, 0x71, 0x13, 0xF7, 0xE9, 0x04, 0x20,
+  0xBC, 0x20, 0xC3, 0xF5, 0x34, 0x61, 0x10, 0x3E, 0x3A, 0x72, 0xBC, 0x0F, 0x3B, 0xF0, 0x8B, 0xC6,
+  0x5B, 0x0F, 0x96, 0xD4, 0xE5, 0x7A, 0xED, 0xA8, 0x4B, 0xF4, 0xE9, 0xB3, 0x1E, 0x17, 0xF7, 0x1C,
+  0x48, 0x24, 0xF6, 0x8E, 0xBF, 0x66, 0xFC, 0x66, 0xC6, 0x4C, 0x1B, 0xC0, 0x09, 0x80, 0xEC, 0x25,
+  0x96, 0x99, 0xE8, 0xC5, 0x08, 0x6C, 0xC0, 0x06, 0x26, 0x00, 0xC4, 0x0E, 0x4D, 0x45, 0x16, 0x9B,
+  0xC0, 0x7B, 0x17, 0x78, 0x15, 0xF8, 0x4F, 0x3F, 0xB0, 0x24, 0x7F, 0x10, 0xDA, 0x0F, 0x62, 0x51,
+  0x89, 0x97, 0xF9, 0x1D, 0x7A, 0x4C, 0xF5, 0xF9, 0x7D, 0x34, 0x03, 0x4D, 0xF7, 0x1C, 0x1F, 0x7E,
+  0x01, 0x6F, 0x82, 0xB7, 0xE1, 0xC5, 0x3B, 0xFE, 0xC8, 0xB6, 0xDA, 0x7B, 0xFF, 0xC6, 0x86, 0x4E,
+  0xE0, 0xF9, 0x6F, 0xE6, 0xC1, 0x9D, 0x22, 0x76, 0xD4, 0xC2, 0x77, 0xDE, 0xB5, 0xDE, 0x1F, 0x84,
+  0xC3, 0x03, 0x47, 0x22, 0x90, 0x17, 0x86, 0x66, 0xCC, 0x7D, 0xEB, 0x85, 0x29, 0xCD, 0x95, 0x29,
+  0x11, 0x05, 0x55, 0xE4, 0x4A, 0xD0, 0x76, 0x0E, 0x6C, 0xA9, 0xC2, 0xD7, 0xB9, 0xAA, 0x2C, 0xF9,
+  0xC8, 0x3C, 0xDA, 0xDA, 0xC8, 0xD4, 0xAF, 0x01, 0x15, 0xAD, 0x33, 0xCF, 0x71, 0xA5, 0xC4, 0x59,
+  0xC8, 0xF0, 0x11, 0x6F, 0x5A, 0x3B, 0x3A, 0x93, 0x9F, 0x18, 0x7D, 0x2C, 0x60, 0xAB, 0x90, 0xAA,
+  0x9B, 0xB2, 0x15, 0x25, 0xBA, 0x9A, 0x98, 0x57, 0x72, 0xB3, 0x0C, 0x35, 0x4B, 0xB9, 0x5B, 0x39,
+  0xC0, 0x73, 0x5C, 0x12, 0x31, 0xC6, 0xF7, 0x6C, 0x1D, 0xC7, 0x13, 0x18, 0x95, 0xF0, 0x61, 0x47,
+  0x7E, 0x55, 0xAA, 0x3D, 0x0C, 0xD7, 0x15, 0x24, 0xFE, 0x00, 0x15, 0x55, 0xEA, 0x61, 0x17, 0x66,
+  0xC0, 0x0D, 0x10, 0x7C, 0x40, 0xAB, 0xB0, 0x2B, 0xF5, 0xB0, 0x57, 0x3B, 0x3A, 0x0E, 0x84, 0x33,
+  0x72, 0x84, 0x79, 0x57, 0x6D, 0x15, 0xFB, 0x78, 0x18, 0x68, 0x95, 0x9A, 0x1E, 0xC0, 0xE0, 0xA6,
+  0xD7, 0x73, 0x3C, 0x9B, 0xB3, 0xD6, 0xA0, 0x52, 0x17, 0x6F, 0x63, 0x5D, 0xB4, 0xAB, 0x75, 0xF1,
+  0x2E, 0xD6, 0xC5, 0x5E, 0xB5, 0x2E, 0xDE, 0xD7, 0x8E, 0xBE, 0x7B, 0xA6, 0x2F, 0x2A, 0x35, 0x6E,
+  0x01, 0x1E, 0x9D, 0x98, 0x3F, 0x0A, 0x40, 0x1F, 0xD8, 0x26, 0xA1, 0xF9, 0xD1, 0x92, 0x7C, 0x0E,
+  0x8E, 0x8D, 0xBF, 0x05, 0xBE, 0x08, 0x8F, 0x45, 0xC1, 0x3D, 0x5B, 0xB3, 0x98, 0x66, 0x0D, 0x1C,
+  0xCF, 0x14, 0xC3, 0x11, 0x1E, 0x30, 0x23, 0x4D, 0xE8, 0x43, 0xFA, 0x1E, 0x34, 0x5D, 0x69, 0x3B,
+  0xD1, 0x5C, 0xD7, 0x32, 0x95, 0x54, 0xCF, 0xED, 0x3B, 0xD3, 0x73, 0x6C, 0x1C, 0x57, 0x1D, 0xB5,
+  0xCA, 0x4B, 0x81, 0x99, 0x23, 0xD7, 0x83, 0xF3, 0x4C, 0xF6, 0xED, 0x71, 0x9D, 0x03, 0xFA, 0x79,
+  0xAF, 0x7D, 0x39, 0x8C, 0x0B, 0xCA, 0xAA, 0xEC, 0x00, 0x0E, 0xE1, 0xF8, 0x79, 0xAD, 0x9C, 0x1E,
+  0x02, 0x74, 0x22, 0x70, 0xEE, 0x4C, 0x03, 0x9D, 0x13, 0xE0, 0xDC, 0xF3, 0xE0, 0x54, 0xD6, 0xF5,
+  0x80, 0xCE, 0xC9, 0xD0, 0xF9, 0x1B, 0xC3, 0x04, 0x80, 0x4D, 0x37, 0xD0, 0x03, 0x93, 0x46, 0x8C,
+  0x0F, 0x84, 0x53, 0x07, 0x38, 0x05, 0xB6, 0x1F, 0x98, 0x44, 0xBF, 0x0C, 0xE0, 0x23, 0x90, 0x1F,
+  0xD0, 0x29, 0x4A, 0x1C, 0x89, 0x1A, 0x0C, 0xE0, 0x6D, 0x7B, 0xDA, 0x92, 0xF0, 0x4C, 0xB6, 0x60,
+  0xE3, 0x2C, 0x74, 0x0C, 0x42, 0x17, 0x0B, 0xD0, 0x0A, 0xF0, 0x34, 0xC6, 0x03, 0x1E, 0xCE, 0x79,
+  0x98, 0x7B, 0x34, 0x1E, 0xA8, 0x34, 0xD8, 0x3B, 0x68, 0x21, 0x52, 0x80, 0x88, 0x66, 0x29, 0xE7,
+  0xAD, 0x3F, 0xC6, 0xD4, 0x8A, 0x90, 0xA7, 0xAC, 0x93, 0x7F, 0x44, 0xEC, 0x3C, 0x8A, 0xB3, 0xD2,
+  0x2E, 0xB7, 0x7D, 0xC7, 0xBB, 0x08, 0xD0, 0xEB, 0xB2, 0xB2, 0x35, 0x36, 0xCB, 0x4B, 0x6F, 0xE1,
+  0x66, 0xF6, 0x91, 0x69, 0x9F, 0x5B, 0xFC, 0xAE, 0x96, 0x29, 0x15, 0x1C, 0x4C, 0x58, 0xD5, 0xAF,
+  0x61, 0x5B, 0xBB, 0x7F, 0x65, 0xD8, 0x84, 0xD0, 0xE0, 0x70, 0xC9, 0xF6, 0x49, 0x18, 0x1F, 0x63,
+  0xE2, 0x18, 0x0F, 0x27, 0x80, 0x78, 0x66, 0x70, 0x8C, 0x19, 0xF1, 0x09, 0x59, 0x35, 0x69, 0x21,
+  0xF2, 0x81, 0x04, 0x2C, 0xCB, 0x14, 0x64, 0xBA, 0xEC, 0x71, 0x94, 0x52, 0x0D, 0x89, 0x92, 0xA0,
+  0x5D, 0xAF, 0xB1, 0xE9, 0xB2, 0xFC, 0x55, 0x84, 0xDA, 0xA9, 0x32, 0x57, 0x11, 0x33, 0x64, 0x35,
+  0x25, 0xA6, 0x29, 0xA4, 0x28, 0x74, 0x11, 0xA1, 0x5E, 0x5E, 0xC0, 0x25, 0xC4, 0xA2, 0x11, 0xFF,
+  0xF4, 0xCB, 0xD7, 0x32, 0x78, 0x7F, 0xBA, 0xF3, 0xA5, 0xB9, 0x2A, 0x7C, 0x1F, 0xE3, 0x33, 0xFA,
+  0xB8, 0x69, 0x96, 0x8C, 0x40, 0xC9, 0x44, 0xEE, 0x31, 0x03, 0x3D, 0x30, 0x4E, 0x40, 0x37, 0x42,
+  0xAA, 0x08, 0xFD, 0xBD, 0x91, 0xE5, 0xB6, 0x9B, 0xA9, 0xC7, 0x37, 0x2F, 0xF4, 0x90, 0x4F, 0x0F,
+  0x88, 0x2B, 0x45, 0xC9, 0x01, 0xDE, 0x5D, 0x05, 0x35, 0x48, 0xDB, 0xB3, 0xED, 0x23, 0xA6, 0x10,
+  0x6F, 0x3C, 0x1D, 0x72, 0xFD, 0xC7, 0x89, 0xF3, 0xC0, 0xFD, 0x82, 0x34, 0x91, 0x68, 0x0D, 0x8D,
+  0x4E, 0x13, 0x9F, 0x8B, 0x68, 0x1F, 0xF3, 0x94, 0xBA, 0x6E, 0xE3, 0x82, 0x0A, 0x88, 0x18, 0xBA,
+  0xE6, 0x92, 0x88, 0x02, 0xF2, 0x04, 0x4C, 0x54, 0x85, 0xE0, 0x82, 0xCC, 0x21, 0xDF, 0x41, 0xD1,
+  0x46, 0xD2, 0x06, 0x1C, 0x04, 0x9E, 0x03, 0x02, 0x0C, 0xD0, 0x80, 0xE9, 0x5A, 0x7C, 0x4C, 0x3B,
+  0x91, 0xE5, 0x21, 0xFA, 0x2A, 0xB9, 0x60, 0x90, 0x91, 0x9C, 0x11, 0x8F, 0x4B, 0x39, 0x3E, 0x33,
+  0x4C, 0x5D, 0xA0, 0x38, 0x85, 0x42, 0x90, 0xCD, 0x81, 0xCE, 0xD0, 0xAB, 0x34, 0xF0, 0x50, 0x22,
+  0x83, 0x69, 0x70, 0x0F, 0x23, 0x55, 0x92, 0xDD, 0xD0, 0x7C, 0x48, 0x80, 0x45, 0x52, 0x94, 0x82,
+  0xAA, 0xB4, 0x8A, 0x48, 0x21, 0x2A, 0xF9, 0x32, 0xB9, 0x9F, 0x4A, 0x2B, 0x6E, 0x5A, 0x30, 0x83,
+  0xC5, 0xA0, 0x44, 0x27, 0x86, 0x8E, 0xCF, 0xA3, 0xA5, 0x81, 0x48, 0x08, 0x9D, 0x84, 0x82, 0xDC,
+  0x48, 0x2E, 0xB5, 0xC7, 0xF1, 0x33, 0xB1, 0x01, 0x23, 0xF0, 0xF0, 0xEF, 0x48, 0xAE, 0xD2, 0x35,
+  0x4B, 0x0F, 0xA2, 0xF5, 0x45, 0xAC, 0xE1, 0x53, 0xA7, 0xBB, 0xCD, 0xBA, 0x27, 0xC7, 0xF0, 0xF3,
+  0xD3, 0xD5, 0xD7, 0x2F, 0xC7, 0x5D, 0xF8, 0xE3, 0x84, 0x9B, 0x67, 0x4E, 0xB0, 0x4D, 0x4C, 0xE2,
+  0x93, 0x66, 0x99, 0x16, 0x77, 0xD6, 0xD1, 0x37, 0xB5, 0xD0, 0x69, 0xA0, 0x23, 0xEA, 0x27, 0x6E,
+  0x69, 0xF3, 0x49, 0x60, 0xA2, 0xBD, 0x62, 0xFE, 0x92, 0x36, 0x82, 0xDE, 0x43, 0x92, 0x1C, 0x00,
+  0x84, 0xB5, 0x23, 0xF8, 0xB1, 0xF3, 0x3F, 0x7F, 0xE9, 0x76, 0xF3, 0x49, 0x43, 0x32, 0x9C, 0xC9,
+  0x31, 0xE8, 0x79, 0x78, 0x01, 0x47, 0x8F, 0x60, 0xD6, 0x91, 0x63, 0x87, 0xE4, 0x3F, 0xD9, 0x63,
+  0x6F, 0x02, 0x90, 0x10, 0xC5, 0x40, 0x2F, 0x86, 0x9F, 0x4B, 0x86, 0x90, 0x1C, 0x78, 0x23, 0xF0,
+  0x48, 0x92, 0x1A, 0xE0, 0x92, 0xFC, 0x63, 0xD9, 0xA8, 0x14, 0x0E, 0xBF, 0x09, 0xB0, 0x92, 0x2C,
+  0xAA, 0x76, 0x24, 0x7F, 0x2F, 0x19, 0x52, 0xE1, 0xE0, 0x1B, 0x81, 0x54, 0x92, 0xA9, 0x03, 0x52,
+  0xC9, 0x3F, 0x96, 0x8D, 0x54, 0xE1, 0xF0, 0xA5, 0x61, 0xE5, 0x66, 0x77, 0x98, 0x27, 0x4F, 0x95,
+  0x01, 0x3C, 0x3A, 0x3F, 0x3C, 0x15, 0xE0, 0xDC, 0x46, 0x51, 0xE4, 0x8B, 0xF0, 0x4C, 0xF7, 0xD4,
+  0x32, 0x31, 0xE2, 0xFB, 0xE8, 0x9C, 0x1E, 0xB1, 0x2F, 0xB7, 0x37, 0x97, 0x1D, 0x26, 0x1F, 0x2E,
+  0x16, 0xEA, 0x19, 0x73, 0x58, 0x92, 0x64, 0xF6, 0x8D, 0xA4, 0x15, 0x10, 0xC9, 0xE4, 0x62, 0x75,
+  0x1A, 0x1D, 0x45, 0x16, 0x34, 0x20, 0x63, 0x54, 0x33, 0x08, 0x39, 0x20, 0x9D, 0xC9, 0x0C, 0x2A,
+  0x38, 0x92, 0x14, 0x53, 0x34, 0x90, 0x46, 0x7C, 0x12, 0x5D, 0x7C, 0xEE, 0x61, 0xF0, 0x4D, 0x83,
+  0xFD, 0xEC, 0x04, 0x5E, 0x18, 0x89, 0x33, 0x0A, 0x7C, 0x81, 0xEA, 0xCC, 0xBD, 0x89, 0x37, 0xDD,
+  0x32, 0x6C, 0xD8, 0x43, 0xA7, 0x33, 0xA6, 0x09, 0x86, 0xD7, 0x82, 0xC2, 0x1C, 0xF1, 0xB8, 0x10,
+  0x73, 0x66, 0xFA, 0x08, 0x81, 0x0D, 0x8B, 0xA0, 0xC1, 0xAD, 0xB3, 0xC7, 0x9B, 0x16, 0xBA, 0xC9,
+  0x64, 0x06, 0x7C, 0x15, 0xD3, 0x7C, 0x0A, 0xEB, 0xBF, 0x69, 0x79, 0x3F, 0x36, 0x8D, 0x5F, 0x4F,
+  0x61, 0x6B, 0xB8, 0xF7, 0xD9, 0xF1, 0x0B, 0x28, 0xA7, 0xB9, 0xEE, 0x98, 0xFB, 0x13, 0x0A, 0xB4,
+  0xEC, 0x3E, 0xB7, 0x67, 0x1C, 0xFF, 0xB0, 0xD8, 0x6D, 0xD7, 0x34, 0xAF, 0xCC, 0x83, 0xB2, 0x57,
+  0x57, 0x39, 0x9E, 0x99, 0x53, 0x80, 0x54, 0xF8, 0xDE, 0x2A, 0xBB, 0xFD, 0xE2, 0xEF, 0xAE, 0x96,
+  0x8D, 0x3A, 0x9D, 0x44, 0xAA, 0xAB, 0xE5, 0xA3, 0x0E, 0x8E, 0xBF, 0x6C, 0xD4, 0xC9, 0xB5, 0x1C,
+  0x4C, 0x01, 0xD3, 0x13, 0x90, 0x07, 0xDB, 0x3F, 0x3F, 0xE4, 0x81, 0x13, 0xC5, 0x5B, 0x25, 0xF2,
+  0xE0, 0xF8, 0x6B, 0xCF, 0x77, 0x08, 0x48, 0x4F, 0x40, 0x1D, 0x6C, 0xFF, 0x3C, 0x51, 0xA7, 0xF3,
+  0x7D, 0xD5, 0xC8, 0xC3, 0x3A, 0xDF, 0x37, 0x02, 0x7F, 0x00, 0x52, 0x4F, 0xC4, 0xA0, 0xCE, 0xF7,
+  0xE7, 0x84, 0x43, 0xD7, 0x4E, 0x60, 0x8B, 0x8E, 0x63, 0xDA, 0xA2, 0x56, 0x05, 0x43, 0xA8, 0x79,
+  0x81, 0xA3, 0x09, 0xFA, 0x5F, 0x63, 0xF4, 0x88, 0x01, 0xA1, 0x12, 0x72, 0x8C, 0xDB, 0x3F, 0x4F,
+  0xD4, 0x78, 0x22, 0x7B, 0x99, 0x7A, 0xA9, 0x54, 0x1C, 0x79, 0xF2, 0xDF, 0xAA, 0xCE, 0x7E, 0xDE,
+  0x4A, 0xDC, 0x5E, 0x0A, 0x7E, 0x55, 0x65, 0x3F, 0xF1, 0x1E, 0xD6, 0x09, 0xC7, 0x22, 0x8B, 0x42,
+  0xAB, 0xA8, 0x3D, 0xA7, 0xB0, 0x89, 0x21, 0xBE, 0xFC, 0x5B, 0xCC, 0x7C, 0x39, 0x32, 0xC5, 0xA7,
+  0x4F, 0xC7, 0xB5, 0xA3, 0xF0, 0x03, 0x83, 0x4F, 0xA8, 0x74, 0x4B, 0xD6, 0x5C, 0x6C, 0xF7, 0x9F,
+  0x62, 0x6F, 0x98, 0x36, 0xA1, 0xDC, 0xFD, 0x0C, 0x6C, 0xEA, 0x91, 0x1B, 0xCB, 0x8E, 0x66, 0xA2,
+  0xEB, 0x1C, 0x9D, 0xC0, 0x83, 0x09, 0xEA, 0x7E, 0x0B, 0x4C, 0xF4, 0x90, 0x81, 0xBF, 0x06, 0x81,
+  0xA5, 0x79, 0xE3, 0x4B, 0x12, 0x95, 0x55, 0x8D, 0x8C, 0x14, 0x74, 0x0B, 0x83, 0x1E, 0xA6, 0x6C,
+  0x0B, 0xE1, 0x3B, 0x92, 0x01, 0x6F, 0x6F, 0x98, 0xAF, 0xB2, 0x89, 0xE0, 0xF7, 0xB2, 0x4B, 0xF8,
+  0x65, 0x33, 0x0D, 0x9D, 0xC6, 0x30, 0x29, 0xAB, 0x66, 0x59, 0x8F, 0x2A, 0x70, 0x4A, 0x5D, 0x16,
+  0x69, 0x1E, 0xF7, 0x05, 0xD3, 0xEE, 0x34, 0x93, 0x12, 0xF6, 0xA6, 0x6D, 0x22, 0x19, 0x86, 0x8C,
+  0x35, 0x0F, 0xA9, 0x9A, 0xFE, 0x3D, 0x46, 0x33, 0x5D, 0x38, 0x1E, 0xEB, 0x07, 0x22, 0xF0, 0xC8,
+  0x07, 0x0A, 0x33, 0xB5, 0x3A, 0xF6, 0x6C, 0x42, 0x42, 0xA4, 0x02, 0xB0, 0x39, 0xF7, 0x68, 0xEA,
+  0xF9, 0x0A, 0x20, 0x3F, 0x07, 0xC0, 0x79, 0x36, 0x17, 0xB9, 0xE6, 0xAC, 0x39, 0xD2, 0x62, 0x15,
+  0x7A, 0x04, 0x31, 0x08, 0xA7, 0xFC, 0xC5, 0x11, 0xE1, 0x8C, 0x6B, 0x47, 0x68, 0x13, 0x23, 0x93,
+  0x15, 0x5E, 0xAC, 0xC7, 0x8D, 0x80, 0xAC, 0xCE, 0x6C, 0x47, 0xB0, 0xF0, 0xCD, 0x42, 0x74, 0x3A,
+  0x4F, 0x5A, 0xCD, 0x9A, 0x6C, 0x39, 0x34, 0x7B, 0xBA, 0x53, 0xBA, 0xA2, 0xC7, 0xAF, 0x32, 0x21,
+  0xA0, 0xEB, 0x39, 0x46, 0xA0, 0x0B, 0x9F, 0xDD, 0x0F, 0x4D, 0x7D, 0xC8, 0x86, 0x98, 0x1E, 0x27,
+  0x9C, 0x1B, 0x5E, 0x8F, 0xDA, 0x48, 0x25, 0x77, 0xA6, 0x78, 0xDC, 0x66, 0x8F, 0x4E, 0x40, 0x64,
+  0x16, 0x84, 0xD0, 0x35, 0xD1, 0x2A, 0xAC, 0x19, 0x78, 0x09, 0x1C, 0x35, 0x99, 0x80, 0x78, 0xEF,
+  0x91, 0x91, 0x71, 0x54, 0xDE, 0x92, 0xA2, 0xC7, 0x78, 0x74, 0x1F, 0x5B, 0x9E, 0xE2, 0x16, 0x46,
+  0x75, 0x45, 0x1D, 0xC0, 0x0B, 0x9D, 0x59, 0x13, 0xC1, 0x82, 0xA5, 0xEC, 0x91, 0x8A, 0xCB, 0xA1,
+  0x5F, 0xF5, 0x89, 0x8C, 0x01, 0x9C, 0xE5, 0xA7, 0x26, 0x43, 0x0B, 0xA3, 0x58, 0xD6, 0x01, 0x17,
+  0x2A, 0x2C, 0xF8, 0xCA, 0xF4, 0xC5, 0xD6, 0x9B, 0x89, 0xA0, 0xD9, 0x91, 0x41, 0xBF, 0x54, 0xBE,
+  0xE2, 0xA9, 0x41, 0x88, 0xB3, 0x2D, 0xCF, 0x05, 0x02, 0x14, 0x73, 0x83, 0x11, 0x31, 0xD0, 0x73,
+  0xE6, 0x28, 0x15, 0x63, 0x15, 0xB1, 0xDF, 0xD9, 0x7B, 0xA8, 0x00, 0x44, 0xB1, 0x77, 0x7E, 0x3C,
+  0x62, 0x11, 0x9A, 0x3E, 0x3D, 0x68, 0x71, 0xBC, 0xD7, 0x79, 0x51, 0xC3, 0xF3, 0xBD, 0x07, 0xF8,
+  0x72, 0x7D, 0x7E, 0x4C, 0xEE, 0x02, 0x37, 0xC7, 0xDF, 0x7F, 0xA2, 0xF4, 0x58, 0x78, 0xF2, 0x89,
+  0x7B, 0x87, 0x8D, 0x1C, 0x1F, 0x49, 0x79, 0x34, 0x72, 0x6C, 0xF2, 0xD0, 0xC0, 0x3C, 0xF8, 0xE8,
+  0x3C, 0x01, 0xBB, 0xE8, 0x4B, 0x67, 0x56, 0x09, 0x8F, 0x5E, 0x20, 0x92, 0x7E, 0x0F, 0x7E, 0xE0,
+  0xE2, 0xBB, 0xBE, 0xF4, 0x66, 0x85, 0x13, 0xD7, 0x66, 0x6F, 0x9B, 0xB1, 0x44, 0x5B, 0xAA, 0xA1,
+  0xDF, 0x60, 0xE7, 0x1A, 0xF0, 0x8E, 0xB0, 0x1F, 0x19, 0x1A, 0x22, 0x19, 0xA6, 0xDA, 0x28, 0xC5,
+  0x5D, 0xC2, 0x06, 0x34, 0x3D, 0x43, 0x91, 0x3D, 0xDB, 0x6A, 0xBE, 0xA1, 0x89, 0x0F, 0x9D, 0x7B,
+  0x98, 0x8E, 0xC0, 0x48, 0x12, 0x0A, 0x36, 0x91, 0xBD, 0x51, 0x3A, 0x5B, 0x35, 0xE5, 0xAD, 0x16,
+  0xFB, 0x08, 0xB8, 0x3E, 0xFE, 0x32, 0xFA, 0x06, 0xC3, 0xF3, 0x5A, 0xE8, 0x72, 0xB5, 0xCD, 0xF6,
+  0xD5, 0x3B, 0xF2, 0x3B, 0x15, 0xF2, 0xB2, 0xCF, 0x28, 0x92, 0xEF, 0x4D, 0x8C, 0xED, 0x10, 0xC0,
+  0x40, 0xAC, 0xD8, 0x66, 0x9F, 0xBA, 0xF4, 0xE3, 0x16, 0x7F, 0xFC, 0x55, 0xFA, 0x5C, 0xDC, 0x5C,
+  0x9F, 0xAA, 0x30, 0x3A, 0xFF, 0x90, 0x35, 0x51, 0xB2, 0x6B, 0x37, 0x37, 0x32, 0x39, 0x58, 0x5E,
+  0x38, 0xEC, 0x6C, 0x72, 0x99, 0x91, 0xB7, 0x2E, 0x23, 0x41, 0xE2, 0x7E, 0x46, 0x7E, 0xC4, 0xCC,
+  0x1E, 0xAB, 0xE6, 0x0A, 0x88, 0xB3, 0xBC, 0xC9, 0x7C, 0x01, 0xF6, 0x88, 0x6B, 0x6A, 0x77, 0xFD,
+  0x69, 0xC9, 0x02, 0x8A, 0x1D, 0x91, 0x11, 0x3B, 0xA5, 0xC8, 0xF4, 0x5B, 0xE7, 0x4B, 0xAC, 0xE7,
+  0x71, 0x7A, 0x00, 0x40, 0x8A, 0x2E, 0xC5, 0x4B, 0xC1, 0xD1, 0x56, 0xA8, 0xDB, 0xB0, 0x0B, 0xB6,
+  0x85, 0xB8, 0xF7, 0xB0, 0xFF, 0xA6, 0x60, 0x66, 0x81, 0x82, 0xB1, 0x44, 0x8B, 0x81, 0xAA, 0x8A,
+  0x59, 0x5D, 0x0C, 0x60, 0xAF, 0x92, 0x9D, 0x27, 0x60, 0xAB, 0xBE, 0xAB, 0x04, 0x59, 0xF6, 0x6F,
+  0xEC, 0xE6, 0xA7, 0xEB, 0x87, 0x76, 0x39, 0x08, 0x2F, 0x16, 0xC4, 0x37, 0x28, 0x01, 0x9D, 0x04,
+  0xC8, 0x3C, 0x19, 0x86, 0x21, 0x01, 0x63, 0x09, 0xF3, 0x1F, 0xC0, 0x37, 0xF2, 0x0B, 0x7A, 0x3E,
+  0x3D, 0x1B, 0xEA, 0x17, 0x4A, 0x45, 0xED, 0xAE, 0x4A, 0x64, 0xFC, 0x3E, 0x54, 0xBC, 0x99, 0xDC,
+  0xDA, 0x7A, 0x72, 0x29, 0x7D, 0xD3, 0xB2, 0xFC, 0x6D, 0x7A, 0x0C, 0xDA, 0x03, 0xC8, 0x93, 0x26,
+  0x46, 0x62, 0x3C, 0x8E, 0x79, 0xFD, 0x16, 0x31, 0x55, 0x60, 0xAF, 0x6F, 0x24, 0xDB, 0x87, 0x25,
+  0xBA, 0xC0, 0xB1, 0xFB, 0xA6, 0x87, 0x1A, 0x99, 0x4C, 0x18, 0xC9, 0x74, 0x68, 0x83, 0x7A, 0x5B,
+  0xAC, 0x19, 0x9E, 0x63, 0xDB, 0xAC, 0x7B, 0x71, 0x73, 0xF2, 0x93, 0x6C, 0xF9, 0x83, 0xBB, 0xA2,
+  0x11, 0x9D, 0xDE, 0x6A, 0x20, 0x33, 0xCC, 0x05, 0xC9, 0x29, 0xCC, 0x01, 0xFB, 0xF2, 0x39, 0xC8,
+  0x08, 0x56, 0xF8, 0x22, 0x9C, 0x5E, 0xDC, 0x0E, 0x98, 0x8A, 0x9D, 0x88, 0x12, 0x52, 0x52, 0x56,
+  0xC9, 0x0D, 0x92, 0x38, 0x0B, 0x20, 0x67, 0x4C, 0x78, 0x44, 0xE1, 0xAF, 0xB6, 0xE0, 0xA0, 0xBB,
+  0x02, 0x8F, 0x33, 0xE7, 0x9E, 0x4A, 0xB7, 0x41, 0x61, 0xA2, 0xAB, 0x4C, 0xB7, 0x21, 0x2B, 0x06,
+  0xF8, 0x8B, 0x4A, 0x98, 0x7B, 0x12, 0xEB, 0xBA, 0x94, 0x48, 0x1B, 0x6B, 0x38, 0x65, 0x1F, 0x10,
+  0x90, 0x19, 0xC9, 0xEF, 0x6B, 0xD3, 0x15, 0x90, 0x18, 0xB0, 0x53, 0x19, 0x3B, 0x08, 0x02, 0xEB,
+  0x94, 0xB1, 0x63, 0xE6, 0xF2, 0x2B, 0xE6, 0xD3, 0xC5, 0xFE, 0x65, 0x88, 0xF3, 0xA5, 0x2D, 0x93,
+  0x76, 0xE5, 0xBA, 0x03, 0x25, 0xB2, 0x7E, 0x85, 0x80, 0xBA, 0x85, 0x87, 0x5D, 0xD5, 0x4F, 0x98,
+  0x0B, 0x2C, 0x7C, 0x9E, 0x34, 0xC3, 0xAA, 0x86, 0xB9, 0x36, 0xB7, 0xB8, 0xDD, 0x7B, 0x62, 0x84,
+  0x23, 0xF9, 0x57, 0xFD, 0xD2, 0x5E, 0xB2, 0xD7, 0xF7, 0xA5, 0x0C, 0x37, 0x77, 0x41, 0x23, 0x30,
+  0x7D, 0x3E, 0x4E, 0x8C, 0x01, 0x4A, 0x83, 0xC6, 0x70, 0x9A, 0xCC, 0x57, 0x31, 0x71, 0x54, 0xEF,
+  0x40, 0xB0, 0x1F, 0x36, 0x55, 0x56, 0x12, 0x94, 0x0F, 0xA3, 0xC7, 0x99, 0xD3, 0xA3, 0xEA, 0x01,
+  0x06, 0x5A, 0x01, 0xFE, 0xF1, 0xF7, 0xFF, 0xF2, 0x43, 0x71, 0x09, 0x33, 0x6A, 0xC8, 0x13, 0x43,
+  0xF6, 0xD8, 0xA0, 0xF8, 0x72, 0xEA, 0xD1, 0xF4, 0x49, 0x54, 0xA7, 0x20, 0x0A, 0x14, 0xE3, 0x69,
+  0xE2, 0xF2, 0x9C, 0xD0, 0x7E, 0x20, 0xB3, 0x77, 0x5D, 0xCF, 0x79, 0x00, 0x5A, 0x16, 0x18, 0xE3,
+  0x76, 0xD0, 0x8C, 0x22, 0xD9, 0xEF, 0x41, 0xDA, 0x1F, 0xCA, 0x00, 0x37, 0xCD, 0x08, 0x93, 0x0E,
+  0xCB, 0x09, 0xE0, 0x6C, 0xD1, 0xFE, 0xD7, 0x87, 0x99, 0x45, 0x8B, 0xC0, 0xD1, 0x0C, 0xE6, 0xD8,
+  0xE9, 0x88, 0xFA, 0x30, 0x00, 0x7F, 0xC4, 0xC5, 0xD0, 0x31, 0x18, 0x68, 0x36, 0x26, 0xC7, 0xA0,
+  0xC0, 0xFF, 0xDC, 0x6D, 0xEA, 0xA3, 0x8C, 0x98, 0x3E, 0x54, 0x9B, 0xD0, 0x2C, 0x72, 0x07, 0xDC,
+  0xA5, 0xC1, 0x2E, 0x6D, 0x1D, 0xC6, 0xF7, 0xC3, 0xE0, 0xBE, 0x30, 0x66, 0xE4, 0x6B, 0x0F, 0xDD,
+  0xAC, 0xE4, 0xC0, 0xB7, 0xE6, 0x88, 0x87, 0x19, 0x41, 0x6E, 0xA4, 0x21, 0xD4, 0xC0, 0xA4, 0x30,
+  0x36, 0xC3, 0x4C, 0xFD, 0x31, 0x57, 0x74, 0x53, 0xF6, 0xC5, 0xA3, 0x80, 0x3C, 0x1A, 0x8B, 0xB4,
+  0x38, 0x8C, 0x15, 0x84, 0x29, 0x98, 0x18, 0xC3, 0x78, 0xC2, 0xB1, 0xDC, 0xC9, 0xF8, 0x25, 0xD3,
+  0x0F, 0x27, 0x6D, 0x90, 0xFF, 0x16, 0x85, 0xF6, 0xD7, 0xE1, 0x95, 0x51, 0x94, 0x80, 0x44, 0x85,
+  0xFB, 0x51, 0xAE, 0x64, 0x4C, 0xAE, 0x44, 0xA5, 0x42, 0xC6, 0xB1, 0x2A, 0x4D, 0x19, 0xD4, 0xB8,
+  0xDF, 0x68, 0x8E, 0xC6, 0x5A, 0xD0, 0x01, 0xA9, 0x41, 0x07, 0xCD, 0x26, 0x9C, 0xF6, 0xAD, 0x06,
+  0x7D, 0xA0, 0x17, 0x36, 0xCE, 0xE1, 0x2B, 0xE4, 0x00, 0xAB, 0xF4, 0xF6, 0x72, 0xC6, 0xF8, 0xA0,
+  0xB2, 0x56, 0xCC, 0xBC, 0xF2, 0x6C, 0xB5, 0xB3, 0xA2, 0xA0, 0x10, 0xB3, 0xF2, 0xD3, 0x9C, 0xC5,
+  0x30, 0x0F, 0x9D, 0xF6, 0xD8, 0x96, 0xFF, 0xA6, 0xF2, 0xF5, 0x54, 0x22, 0x41, 0x41, 0x81, 0xE0,
+  0xF4, 0xF2, 0x4E, 0x3A, 0x19, 0x80, 0x29, 0x7C, 0x49, 0x35, 0xD9, 0x76, 0xD3, 0xAF, 0x40, 0x63,
+  0x2B, 0xEA, 0x28, 0x7E, 0x73, 0xAC, 0xC8, 0xFC, 0x49, 0xB7, 0xA0, 0x19, 0xF8, 0x14, 0x72, 0xA2,
+  0xDC, 0x6E, 0x89, 0x53, 0xED, 0x9E, 0xB1, 0xAE, 0x00, 0x1E, 0x81, 0x67, 0x6F, 0xC4, 0xB5, 0x72,
+  0x9B, 0x6E, 0x8D, 0x9E, 0x82, 0x7A, 0x84, 0x74, 0x0A, 0xFF, 0x7A, 0xF5, 0xDD, 0x45, 0xA2, 0xDE,
+  0x04, 0xB0, 0xAB, 0xE0, 0x60, 0xBA, 0x93, 0x35, 0x4E, 0x91, 0x41, 0x27, 0xEE, 0x53, 0x25, 0xA2,
+  0x0B, 0xEC, 0x64, 0x52, 0x1C, 0x8A, 0xD2, 0x96, 0x67, 0x08, 0x46, 0xE5, 0x04, 0x22, 0x39, 0xC0,
+  0x11, 0xFD, 0x4A, 0x1C, 0x2B, 0xB2, 0x92, 0xD7, 0x11, 0xDB, 0x3A, 0x1D, 0x3A, 0x18, 0xA0, 0x85,
+  0xC5, 0x51, 0x40, 0xE3, 0xCB, 0xDD, 0xB3, 0x4F, 0xAA, 0xBC, 0xCB, 0x9B, 0xB0, 0x86, 0xC8, 0x4A,
+  0xC4, 0xAB, 0xB8, 0x58, 0x25, 0x62, 0x62, 0x50, 0x24, 0x4C, 0xA1, 0x74, 0x01, 0xC2, 0x14, 0x55,
+  0x3B, 0x92, 0x82, 0x11, 0x37, 0xF1, 0xBE, 0x25, 0x5C, 0x67, 0xB4, 0x0E, 0x16, 0x2B, 0x1F, 0x83,
+  0xA2, 0x88, 0xBC, 0x70, 0xC1, 0xEC, 0x01, 0x49, 0xC3, 0xAE, 0x94, 0x2E, 0x46, 0x23, 0x6E, 0x98,
+  0x52, 0x8C, 0xEA, 0xF1, 0x81, 0x19, 0x66, 0x27, 0x20, 0xA7, 0xF0, 0x9B, 0xDB, 0xD3, 0xEB, 0xC9,
+  0x4B, 0xD2, 0x63, 0x25, 0x9A, 0x45, 0xB2, 0x8F, 0xE9, 0x4B, 0xC1, 0x2A, 0x92, 0xF3, 0x48, 0xDE,
+  0xE8, 0x74, 0x3A, 0x6C, 0xCB, 0x95, 0x85, 0xC7, 0x7C, 0x0E, 0x52, 0x60, 0x00, 0xCA, 0x77, 0x20,
+  0x1C, 0x54, 0xCB, 0xDF, 0x50, 0x29, 0x06, 0x7C, 0x2B, 0x25, 0x7F, 0x30, 0x6D, 0xA0, 0xE1, 0x85,
+  0x12, 0xDD, 0x09, 0x93, 0x81, 0x59, 0x8F, 0xC4, 0xCB, 0x98, 0x6C, 0x12, 0x56, 0xB3, 0x7A, 0xED,
+  0x8F, 0xE1, 0x86, 0xC9, 0x86, 0x9C, 0xC0, 0x32, 0xB8, 0xB7, 0x0D, 0xCA, 0x8D, 0xE5, 0x00, 0x6E,
+  0x39, 0x9B, 0x27, 0x96, 0x10, 0x68, 0xE7, 0x20, 0x93, 0xE4, 0x84, 0x54, 0xCC, 0xA2, 0x64, 0x9A,
+  0x82, 0x54, 0xBC, 0x42, 0x3C, 0x42, 0xBA, 0x93, 0x95, 0x88, 0x54, 0xCA, 0x63, 0xB5, 0xF5, 0x09,
+  0xDA, 0x6E, 0x16, 0x3E, 0x8C, 0xC6, 0xB4, 0x5F, 0xC1, 0x47, 0x83, 0x98, 0xC1, 0xAC, 0x39, 0x52,
+  0x55, 0x24, 0x36, 0xFE, 0xC2, 0x0F, 0x09, 0x7A, 0x6A, 0x3E, 0x87, 0xC2, 0x27, 0x79, 0x58, 0xAB,
+  0x28, 0x67, 0x83, 0xCA, 0xDD, 0x92, 0x17, 0x15, 0x09, 0xD2, 0x8D, 0x13, 0x45, 0x2A, 0x13, 0x9E,
+  0x69, 0xEF, 0x26, 0xCE, 0xF5, 0x62, 0x16, 0xAE, 0xA9, 0xE6, 0xDF, 0xC0, 0x27, 0xD0, 0xC6, 0x60,
+  0x5A, 0x28, 0x0F, 0x6F, 0xF1, 0xFC, 0x68, 0x91, 0x49, 0x78, 0x72, 0x24, 0x34, 0x07, 0x5F, 0x61,
+  0x04, 0x0B, 0x6D, 0xEB, 0x05, 0x7A, 0x84, 0xFC, 0x72, 0x7E, 0x56, 0xCC, 0xA4, 0xBB, 0x20, 0x4B,
+  0x68, 0x8C, 0x7B, 0x77, 0x02, 0x95, 0x85, 0x46, 0x45, 0x3F, 0xCB, 0x59, 0xC6, 0x38, 0x30, 0xE6,
+  0x8D, 0x71, 0xE8, 0x0D, 0xC9, 0x35, 0x7F, 0xDA, 0xF9, 0x79, 0xE7, 0x17, 0x84, 0x12, 0xF7, 0x37,
+  0x30, 0x13, 0x63, 0xFE, 0x1D, 0x44, 0x51, 0x23, 0xFA, 0x3C, 0x28, 0x20, 0x91, 0x4C, 0x70, 0xB7,
+  0x28, 0x96, 0xA7, 0xD9, 0xC8, 0xB9, 0x2C, 0x90, 0x36, 0x8D, 0xAA, 0xE2, 0x64, 0xF4, 0xD3, 0x61,
+  0x71, 0x67, 0x91, 0x7C, 0x58, 0xCD, 0x54, 0xAF, 0xDE, 0x15, 0x5D, 0x4E, 0x29, 0xE9, 0x36, 0xB6,
+  0xE0, 0x82, 0xDD, 0xBB, 0xA9, 0x76, 0x4F, 0x91, 0x5F, 0x9F, 0x37, 0x0E, 0xFD, 0x5C, 0x0C, 0x87,
+  0x7E, 0x7E, 0x36, 0x38, 0xF4, 0x73, 0x45, 0x1C, 0xFA, 0xF9, 0x05, 0x87, 0xA6, 0xE1, 0xD0, 0x2F,
+  0xC5, 0x70, 0xE8, 0x97, 0x67, 0x83, 0x43, 0xBF, 0x54, 0xC4, 0xA1, 0x5F, 0x5E, 0x70, 0x28, 0x85,
+  0x43, 0x36, 0xC8, 0x4F, 0x28, 0x9D, 0x4B, 0x39, 0xBD, 0x08, 0x16, 0x15, 0x2B, 0xB6, 0xB1, 0x52,
+  0x44, 0xCA, 0x73, 0x69, 0x8F, 0xAF, 0xB9, 0x14, 0x22, 0xC5, 0x5B, 0x3E, 0x0B, 0x54, 0x92, 0xBB,
+  0x78, 0x1A, 0x3A, 0x78, 0x7D, 0xC3, 0x6B, 0x8D, 0x98, 0x14, 0xBD, 0xF2, 0xC4, 0xC7, 0x94, 0x91,
+  0x10, 0x8D, 0x04, 0xFD, 0x84, 0x74, 0xAC, 0xAC, 0x1A, 0x94, 0x29, 0x07, 0xE4, 0xE4, 0xDF, 0x02,
+  0xD8, 0x17, 0x98, 0xBE, 0xEE, 0xB8, 0x8F, 0x3B, 0x2E, 0x3A, 0x75, 0x2B, 0x03, 0xC8, 0x84, 0x44,
+  0xBD, 0xD9, 0x72, 0x74, 0xF1, 0xE4, 0xC1, 0x8B, 0xE5, 0x3E, 0x65, 0xD4, 0xA7, 0x34, 0xD9, 0xDC,
+  0x12, 0x6D, 0x4E, 0xF5, 0x52, 0x51, 0x6F, 0x1E, 0xCA, 0x9D, 0x9A, 0x59, 0x65, 0x3A, 0x7B, 0xCC,
+  0x78, 0xDE, 0x5C, 0x95, 0x8D, 0xF6, 0x34, 0x5D, 0x18, 0x19, 0xE7, 0x34, 0xED, 0x3B, 0xDF, 0xFC,
+  0x9D, 0x92, 0xC0, 0x16, 0xC6, 0x8D, 0xC8, 0xAF, 0x27, 0xAC, 0x65, 0xBE, 0xBB, 0xDF, 0x2C, 0xE6,
+  0xD5, 0x13, 0x4D, 0x3A, 0x95, 0x3F, 0x15, 0x35, 0x57, 0x69, 0x9E, 0x3A, 0x66, 0xF1, 0x42, 0xCB,
+  0x2C, 0x5E, 0x23, 0x99, 0x25, 0xCA, 0x1B, 0x17, 0x49, 0xD3, 0x3A, 0x63, 0xC8, 0xF6, 0x78, 0xC8,
+  0x93, 0x25, 0x0D, 0xB9, 0x4B, 0x43, 0x9E, 0x2E, 0x69, 0x34, 0x4C, 0x0B, 0x8C, 0x07, 0xD7, 0xED,
+  0x50, 0x13, 0x97, 0xFE, 0xAD, 0xE3, 0x5C, 0x39, 0xF6, 0xE0, 0xD6, 0x39, 0xE1, 0x67, 0x12, 0x03,
+  0x81, 0x8F, 0x4C, 0x9D, 0x48, 0xA9, 0x04, 0xE3, 0x95, 0x27, 0x9D, 0x9F, 0x0B, 0x77, 0x5D, 0x65,
+  0x90, 0x89, 0x4B, 0xA2, 0x39, 0x9A, 0x90, 0x34, 0xC3, 0x48, 0x4A, 0x26, 0xF3, 0xB5, 0x1B, 0xA9,
+  0xEE, 0xD1, 0x58, 0x74, 0x6C, 0x18, 0x25, 0xAD, 0x43, 0x33, 0xDC, 0x1E, 0xB5, 0x85, 0xCE, 0x3A,
+  0xEC, 0x3F, 0xB4, 0x71, 0xCD, 0x6B, 0xDE, 0x06, 0x20, 0xA0, 0xE0, 0x8B, 0x9C, 0xF9, 0x78, 0x04,
+  0x9C, 0xFB, 0x19, 0x7D, 0x5A, 0x17, 0x9B, 0x1C, 0x20, 0x00, 0xC8, 0x12, 0xDB, 0xB2, 0x8A, 0x8B,
+  0x66, 0x50, 0x14, 0xD9, 0xB6, 0x72, 0xFC, 0x53, 0x65, 0xB4, 0x3C, 0xAE, 0xC3, 0x69, 0x11, 0x93,
+  0x24, 0xE8, 0x6D, 0xB9, 0x28, 0x66, 0x8A, 0x67, 0x6C, 0x99, 0x9B, 0xC7, 0x4D, 0xF6, 0xFC, 0x2F,
+  0x17, 0x3E, 0x71, 0x67, 0xE6, 0xDD, 0x42, 0x6B, 0xF5, 0x77, 0x0B, 0x9F, 0x28, 0x23, 0x9C, 0xBA,
+  0x63, 0x9B, 0xEF, 0x95, 0xC2, 0x40, 0xF5, 0x5A, 0xF1, 0xDE, 0x67, 0x83, 0x6F, 0x15, 0x3E, 0x45,
+  0x2B, 0x1F, 0xDF, 0x2C, 0x14, 0xA6, 0xBC, 0x22, 0x9C, 0x2D, 0x71, 0xB3, 0x90, 0x31, 0x5A, 0x74,
+  0xBB, 0x70, 0x75, 0x35, 0x2C, 0x3C, 0xF0, 0xDA, 0x5F, 0x42, 0xC0, 0x62, 0xD2, 0xF7, 0x0E, 0xF8,
+  0xE8, 0xE5, 0xD6, 0xE1, 0x69, 0xEA, 0x75, 0x8C, 0x3F, 0x5C, 0x69, 0x82, 0xF4, 0x9F, 0x57, 0x65,
+  0x10, 0x35, 0x83, 0xB4, 0xA6, 0x15, 0x4B, 0x85, 0xFE, 0x4D, 0x11, 0x18, 0x65, 0xEC, 0x33, 0x55,
+  0x33, 0x2F, 0x57, 0x31, 0xBC, 0x24, 0x60, 0x50, 0xDE, 0x82, 0xA7, 0x5A, 0x3E, 0x1F, 0xC3, 0x4B,
+  0x1C, 0x33, 0x50, 0x1F, 0x59, 0x28, 0x6A, 0xC0, 0x00, 0xEB, 0x8F, 0x1B, 0x21, 0x14, 0x2A, 0x20,
+  0x87, 0x6A, 0xFA, 0x6C, 0x2C, 0xBC, 0x52, 0x22, 0x17, 0x24, 0x79, 0x5E, 0x60, 0xAD, 0x0D, 0x91,
+  0x69, 0x9F, 0x2D, 0x67, 0xF3, 0x9D, 0x16, 0x1A, 0x0F, 0xB2, 0xB8, 0x1C, 0x89, 0xC9, 0xA1, 0x8A,
+  0x23, 0x49, 0xD2, 0xD2, 0x93, 0x9C, 0xF0, 0x6C, 0x5B, 0xCF, 0xA6, 0xDE, 0x1F, 0x97, 0x6E, 0x9C,
+  0x49, 0xF0, 0xC7, 0x96, 0x64, 0xD5, 0xB5, 0x7C, 0x62, 0x9E, 0xCC, 0x38, 0xF3, 0xF9, 0xF8, 0xBC,
+  0xF0, 0x69, 0x7C, 0xAD, 0x79, 0x3F, 0x76, 0x60, 0x34, 0x74, 0xA0, 0xAC, 0x76, 0x84, 0xCF, 0x47,
+  0xEA, 0x88, 0x49, 0x1E, 0x9F, 0x39, 0x36, 0x65, 0xC7, 0x54, 0x02, 0xF3, 0xDC, 0xB2, 0x4C, 0xD7,
+  0x77, 0x4C, 0x23, 0xAA, 0x50, 0x07, 0x13, 0x0E, 0x0B, 0xD9, 0x29, 0x01, 0x25, 0x92, 0xBC, 0x50,
+  0xDF, 0xD2, 0x14, 0xE4, 0xE2, 0xEF, 0xE3, 0xF3, 0x91, 0x63, 0x07, 0x54, 0xC6, 0x46, 0xF9, 0xE5,
+  0xE3, 0x16, 0xD9, 0x46, 0x19, 0xC1, 0x65, 0xE1, 0xC2, 0x4B, 0x19, 0x01, 0xA6, 0xB0, 0xC9, 0x37,
+  0x97, 0x5D, 0xEF, 0x95, 0x91, 0xDD, 0xCA, 0x5F, 0xC8, 0x45, 0x98, 0x5C, 0x74, 0x4D, 0xC5, 0x6E,
+  0x84, 0x0A, 0xBE, 0xE6, 0x4E, 0x4E, 0x64, 0xE1, 0x65, 0x2E, 0x9F, 0xC4, 0x49, 0x08, 0xBF, 0xB2,
+  0x79, 0x22, 0x53, 0xC1, 0xA1, 0x16, 0xEF, 0x8B, 0xC3, 0xBD, 0x12, 0x56, 0xE4, 0x2C, 0xBD, 0x59,
+  0xEA, 0xC5, 0x48, 0x1C, 0xD2, 0x39, 0x37, 0xE6, 0x4C, 0x1B, 0xB3, 0x7F, 0x61, 0x41, 0x2C, 0xE0,
+  0x26, 0xA8, 0xD0, 0x94, 0xE1, 0x63, 0x14, 0x6D, 0xA5, 0x59, 0x3A, 0x34, 0x45, 0xFE, 0x82, 0x29,
+  0xF6, 0x64, 0x7D, 0x02, 0xCE, 0xE0, 0x11, 0xF1, 0x9C, 0x0A, 0x27, 0xC8, 0x22, 0xB4, 0x9C, 0xCB,
+  0xBE, 0xCC, 0x21, 0xC2, 0x8D, 0xED, 0x68, 0x6A, 0xB2, 0x0A, 0x85, 0x9A, 0x30, 0x05, 0x18, 0xFD,
+  0xAB, 0x1F, 0xF4, 0x84, 0xA7, 0x51, 0x85, 0x87, 0x7F, 0x95, 0xF5, 0xBF, 0x94, 0xC7, 0xEC, 0x31,
+  0xFC, 0xB6, 0x6D, 0x8D, 0x29, 0x9E, 0x85, 0xB1, 0x2D, 0xC7, 0x37, 0x9D, 0x71, 0x8E, 0xA1, 0x88,
+  0x1B, 0x45, 0xF9, 0x04, 0xA0, 0x3B, 0xFC, 0x82, 0xEA, 0x17, 0x85, 0x6E, 0xB3, 0x63, 0x7E, 0x36,
+  0x84, 0x1E, 0x1E, 0x65, 0xA1, 0x4B, 0x19, 0x38, 0xA4, 0x2A, 0x6D, 0xE2, 0xB4, 0xC8, 0xB7, 0x55,
+  0x53, 0x77, 0x57, 0xAE, 0x03, 0xFC, 0x66, 0x98, 0x18, 0x75, 0x9B, 0x82, 0x78, 0x02, 0x5B, 0xBE,
+  0x40, 0x4D, 0xA2, 0x02, 0x4A, 0xF1, 0x62, 0x9B, 0xD1, 0x3A, 0x69, 0xCB, 0x29, 0xA8, 0xC7, 0xBA,
+  0xD7, 0x1E, 0x7D, 0x65, 0xC0, 0x52, 0xD5, 0x2F, 0x86, 0x18, 0xCE, 0x37, 0xE5, 0xE2, 0x8F, 0x51,
+  0xC5, 0xAE, 0x0D, 0x54, 0xFA, 0x9E, 0x9C, 0x86, 0x65, 0xF3, 0x09, 0xBC, 0x3D, 0x85, 0xC0, 0x59,
+  0xA1, 0xEC, 0x5D, 0xD9, 0x84, 0x6E, 0x41, 0x17, 0xC7, 0x9D, 0xD3, 0x34, 0x9D, 0xC3, 0xA3, 0x35,
+  0x25, 0x73, 0x98, 0x59, 0x06, 0x95, 0x6B, 0x86, 0x51, 0x94, 0xC0, 0x15, 0x85, 0x14, 0x25, 0xEF,
+  0x17, 0xE2, 0x9B, 0x73, 0x44, 0xFA, 0x3C, 0x34, 0x6B, 0x4D, 0x6E, 0xAD, 0xDC, 0xD9, 0x02, 0x82,
+  0xF6, 0x64, 0x5E, 0x50, 0x85, 0x1C, 0xC5, 0x0A, 0xD3, 0xD3, 0x30, 0x5B, 0xA3, 0xA2, 0x72, 0xF6,
+  0xE2, 0x88, 0xE1, 0xCC, 0xF4, 0x05, 0x95, 0x66, 0x8C, 0x4E, 0x29, 0x8A, 0x0B, 0x51, 0xF2, 0xB2,
+  0x82, 0x4A, 0x88, 0x86, 0x52, 0x7C, 0x4E, 0x88, 0xCC, 0xD1, 0x61, 0x15, 0xF8, 0x01, 0xE5, 0xC3,
+  0xA3, 0x74, 0x40, 0x8E, 0xA0, 0x7A, 0x65, 0xF6, 0x40, 0x86, 0xCA, 0xCA, 0xE8, 0x5E, 0xD3, 0x1F,
+  0xC9, 0x93, 0x0A, 0xE9, 0x46, 0xB3, 0x1F, 0x19, 0xE0, 0x1A, 0xA7, 0x9C, 0x71, 0x7E, 0x83, 0x1D,
+  0x8F, 0x30, 0xDD, 0x23, 0x91, 0x80, 0xA1, 0x10, 0x1F, 0xA9, 0xA3, 0xC7, 0xFB, 0x98, 0x14, 0x08,
+  0xE6, 0xE8, 0x51, 0xC0, 0x88, 0x34, 0x35, 0xE2, 0x14, 0x37, 0xD7, 0x27, 0xA3, 0xBA, 0x31, 0x65,
+  0x7F, 0x21, 0xAE, 0x72, 0x49, 0xD4, 0x2F, 0x65, 0x4E, 0x49, 0x34, 0x7D, 0x6E, 0xC6, 0x36, 0xB5,
+  0xB8, 0x9B, 0x30, 0x4C, 0x68, 0x5A, 0xCA, 0x60, 0xC5, 0x1A, 0x9E, 0xC6, 0x11, 0xA2, 0x51, 0x64,
+  0xF2, 0xD7, 0x75, 0x60, 0x0D, 0x78, 0xB4, 0x29, 0xAD, 0xDA, 0x28, 0xC3, 0x25, 0xC2, 0x8F, 0xEE,
+  0x10, 0xDF, 0xD1, 0xE9, 0xF0, 0x9C, 0xE4, 0x13, 0x40, 0x70, 0xB6, 0x18, 0x47, 0xC6, 0xFB, 0xA6,
+  0x31, 0xD1, 0x9F, 0x2A, 0x37, 0x1F, 0x3B, 0x98, 0x55, 0xA9, 0xB3, 0xF0, 0x05, 0xF8, 0xC6, 0xEC,
+  0x79, 0x4A, 0xA6, 0x2D, 0xCF, 0x41, 0xD4, 0xB1, 0x8A, 0x67, 0xB8, 0x7F, 0xC8, 0x2E, 0x00, 0x5C,
+  0x62, 0xEB, 0x6D, 0xAB, 0xF1, 0x0E, 0x60, 0x2F, 0x3F, 0xB1, 0xAB, 0xFA, 0x09, 0x4E, 0x62, 0xEB,
+  0xE0, 0x3D, 0x3E, 0xBB, 0xFD, 0xDA, 0x69, 0x35, 0x0F, 0xB6, 0xF6, 0xDB, 0x8D, 0xF7, 0x6F, 0x9E,
+  0xA5, 0x47, 0xD8, 0xEA, 0x98, 0x4F, 0x8A, 0xC8, 0xAA, 0x30, 0xA1, 0x64, 0x17, 0xCF, 0xD2, 0xF2,
+  0x0F, 0xF8, 0xFC, 0x2B, 0x8A, 0xD6, 0x55, 0xC4, 0x13, 0x25, 0xE9, 0x6E, 0xAD, 0x9E, 0xAF, 0xCC,
+  0x36, 0xE9, 0x85, 0x32, 0x76, 0x87, 0xB8, 0xC7, 0x69, 0x8A, 0x7B, 0x10, 0xAB, 0x08, 0x46, 0x69,
+  0x4E, 0x21, 0x75, 0xDF, 0xED, 0x04, 0xCB, 0x91, 0x19, 0xF6, 0x48, 0x64, 0x91, 0x5F, 0x93, 0xE4,
+  0x8D, 0x8E, 0xA0, 0x1E, 0xE3, 0x86, 0xAC, 0x7D, 0xBD, 0xCD, 0xFC, 0x21, 0xEA, 0xC7, 0x98, 0x4E,
+  0x14, 0x89, 0x12, 0x2D, 0xD1, 0x14, 0x22, 0x0B, 0xB2, 0x76, 0xE3, 0x85, 0xC4, 0xE7, 0x68, 0xF9,
+  0x8B, 0x50, 0x37, 0xCC, 0xC7, 0x58, 0xFE, 0xDA, 0x46, 0x75, 0xB1, 0x34, 0xCA, 0x26, 0xD7, 0x8B,
+  0xE5, 0x50, 0x77, 0xE8, 0xF5, 0x1A, 0xFA, 0x0F, 0xD4, 0xAA, 0x5C, 0xDB, 0x91, 0xB7, 0xFD, 0x8A,
+  0x69, 0xFB, 0x13, 0xA8, 0xB8, 0x32, 0x1C, 0x9C, 0xB2, 0xC6, 0x30, 0x8D, 0x85, 0x4B, 0x0B, 0x0F,
+  0x62, 0xA9, 0x57, 0x63, 0xBC, 0xB9, 0x12, 0x17, 0xA2, 0x94, 0xA1, 0xE4, 0xA2, 0x1D, 0x77, 0xC3,
+  0x46, 0x77, 0xEE, 0x3F, 0x20, 0x15, 0x1E, 0x2C, 0x30, 0x8E, 0x21, 0x42, 0xB0, 0x4A, 0xB1, 0x0C,
+  0x61, 0xEB, 0x97, 0x78, 0x86, 0x85, 0x13, 0xD2, 0xFC, 0xE3, 0x19, 0xAE, 0x34, 0xB1, 0x83, 0x37,
+  0xDF, 0x78, 0xC1, 0xF7, 0x12, 0xD6, 0xB0, 0xA2, 0xB0, 0x86, 0x90, 0x82, 0x0A, 0x86, 0x36, 0x14,
+  0xDE, 0x9E, 0xF8, 0xE6, 0xCE, 0x3D, 0x12, 0x62, 0x7C, 0x2A, 0x65, 0x47, 0x43, 0x8C, 0xBF, 0x5F,
+  0xB3, 0x88, 0x88, 0xBD, 0x66, 0xA3, 0xF9, 0xBE, 0xD9, 0x7E, 0xBF, 0xF7, 0xF6, 0x3D, 0xAB, 0xB7,
+  0x9A, 0xFB, 0x8D, 0xD6, 0xBB, 0xFD, 0xE6, 0xFE, 0xDB, 0x83, 0x16, 0x6B, 0xED, 0x1F, 0xC0, 0x77,
+  0xEF, 0xDE, 0xCF, 0x37, 0x1C, 0x62, 0x09, 0xE3, 0x85, 0xB1, 0x10, 0x4B, 0x18, 0xAA, 0x40, 0x20,
+  0xC4, 0xD4, 0x59, 0x94, 0xBA, 0x47, 0xAF, 0x36, 0xE3, 0x97, 0x28, 0x88, 0x29, 0x51, 0x10, 0x93,
+  0x42, 0xE4, 0xDC, 0x23, 0x21, 0xC2, 0x21, 0x16, 0x10, 0x0D, 0xB1, 0xE8, 0xD9, 0xC7, 0xC7, 0x58,
+  0x4C, 0x54, 0xC4, 0xA2, 0x57, 0x90, 0x1C, 0x65, 0xE3, 0xA3, 0x23, 0xE2, 0x47, 0xD7, 0x1F, 0x26,
+  0x48, 0x62, 0x21, 0x29, 0xD6, 0x16, 0x5E, 0xF7, 0xBA, 0xCB, 0xBD, 0x3B, 0xAC, 0x47, 0x99, 0xA8,
+  0x7B, 0x2D, 0x1F, 0x2E, 0xAD, 0xEE, 0x75, 0x38, 0x87, 0xD5, 0xD4, 0xBD, 0xF6, 0x69, 0x74, 0x14,
+  0xBC, 0x03, 0x97, 0x90, 0x3B, 0xB4, 0x85, 0xBF, 0xF6, 0x27, 0x0A, 0x60, 0x53, 0xF2, 0xD4, 0x89,
+  0xF2, 0xD7, 0x5F, 0x29, 0xA5, 0x9A, 0xAC, 0x7F, 0x2D, 0xA5, 0x79, 0x81, 0x0E, 0x1E, 0x9A, 0x8E,
+  0x09, 0xCA, 0x94, 0x42, 0x9C, 0xEC, 0x27, 0x90, 0x79, 0xCB, 0xEC, 0x44, 0xE9, 0xED, 0xE7, 0x53,
+  0x13, 0x5B, 0x6E, 0xE8, 0xCA, 0x6B, 0x62, 0xCB, 0x69, 0xC4, 0xCA, 0x35, 0xFF, 0xDA, 0x5C, 0x75,
+  0x55, 0x6C, 0xD6, 0x5A, 0xC7, 0x02, 0x92, 0x59, 0x80, 0x2A, 0x57, 0xE0, 0x2F, 0xA3, 0x87, 0x67,
+  0x51, 0x44, 0x32, 0xB1, 0x2E, 0x2C, 0xDA, 0xBC, 0x5A, 0x14, 0xC2, 0x19, 0x2C, 0x1F, 0x85, 0x8A,
+  0xD5, 0xC7, 0xCE, 0x02, 0xD5, 0x13, 0x90, 0x48, 0xF6, 0xF0, 0xFC, 0x90, 0x08, 0x8B, 0xEF, 0xAE,
+  0x16, 0x89, 0xA8, 0xD0, 0xF1, 0xFA, 0xF3, 0x21, 0x05, 0xA8, 0x27, 0xA0, 0x90, 0xEC, 0xE1, 0x79,
+  0xA2, 0x50, 0xE7, 0xFB, 0x1A, 0x20, 0x51, 0xE7, 0xFB, 0x86, 0xE0, 0x11, 0x41, 0xEB, 0x89, 0x98,
+  0x84, 0x7D, 0x3C, 0x27, 0x5C, 0x1A, 0x17, 0xE3, 0x05, 0xD8, 0x2C, 0xB8, 0x6A, 0xF6, 0x5A, 0xA3,
+  0x49, 0x02, 0x10, 0x95, 0x90, 0x24, 0xDE, 0xC3, 0xF3, 0x44, 0x91, 0x27, 0xB3, 0x9B, 0xE5, 0x54,
+  0xCF, 0x7E, 0x02, 0x9E, 0x2D, 0xB0, 0x7E, 0x76, 0x36, 0x34, 0x9F, 0x88, 0x69, 0xCF, 0x8D, 0x1D,
+  0xDD, 0x08, 0x7D, 0x74, 0x61, 0x5A, 0xE2, 0xC9, 0xD2, 0xD1, 0x34, 0x4C, 0xC3, 0xC4, 0xE4, 0xB9,
+  0xFD, 0xCA, 0x19, 0x00, 0x1A, 0xAD, 0xA8, 0x50, 0x1A, 0x65, 0x4F, 0x8F, 0x2A, 0x99, 0x61, 0x61,
+  0x1C, 0x1F, 0x63, 0xDA, 0xE8, 0x5E, 0x9D, 0xFC, 0xE6, 0x7C, 0xF2, 0x9D, 0x39, 0x7F, 0x38, 0x64,
+  0xAD, 0xF6, 0x6E, 0x73, 0xBB, 0xD5, 0x7C, 0xBB, 0x57, 0x87, 0x1F, 0x6F, 0x37, 0xA3, 0x20, 0xD9,
+  0xBA, 0x92, 0x66, 0x02, 0xF9, 0x2A, 0x11, 0x66, 0xBC, 0x87, 0x55, 0x92, 0xE5, 0x4C, 0x07, 0x97,
+  0x45, 0x9A, 0x56, 0x5A, 0x2B, 0x37, 0xAD, 0xB4, 0x37, 0xC3, 0xB4, 0xD2, 0x7A, 0xB2, 0x69, 0xA5,
+  0xF5, 0x4C, 0x4D, 0x2B, 0xAD, 0x95, 0x9B, 0x56, 0xDA, 0x9B, 0x62, 0x5A, 0x69, 0x3D, 0xD9, 0xB4,
+  0xD2, 0x7A, 0xA6, 0xA6, 0x95, 0xD6, 0xCA, 0xB5, 0xE2, 0xF6, 0x66, 0x98, 0x56, 0x5A, 0x4F, 0x36,
+  0xAD, 0xB4, 0x9E, 0xAD, 0x69, 0xA5, 0xB5, 0x0E, 0xA6, 0x95, 0xF6, 0xA6, 0x98, 0x56, 0x5A, 0x73,
+  0x30, 0xAD, 0xB4, 0x9E, 0xA9, 0x69, 0xA5, 0xB5, 0x70, 0xD3, 0x4A, 0x7B, 0x33, 0x4C, 0x2B, 0xAD,
+  0x27, 0x9B, 0x56, 0x5A, 0xCF, 0xD6, 0xB4, 0xD2, 0xDA, 0x04, 0xD3, 0x4A, 0x7B, 0x53, 0x4C, 0x2B,
+  0xAD, 0x39, 0x98, 0x56, 0x5A, 0xCF, 0xD4, 0xB4, 0xD2, 0x5A, 0xB9, 0x69, 0xA5, 0xFD, 0x62, 0x5A,
+  0xF9, 0xA3, 0x9A, 0x56, 0x5A, 0x4F, 0x36, 0xAD, 0xAC, 0x94, 0x2C, 0xB1, 0x68, 0xFA, 0x85, 0xE3,
+  0xB1, 0x7E, 0x20, 0x02, 0x8F, 0x33, 0xAA, 0xC6, 0xEE, 0xCF, 0x2A, 0x5E, 0x1A, 0x39, 0xC5, 0x68,
+  0x96, 0xE5, 0xDC, 0x7F, 0x37, 0x2F, 0xCC, 0xAF, 0xB0, 0x9E, 0x73, 0xF4, 0x16, 0xB2, 0xB9, 0xC8,
+  0xF5, 0x7A, 0x9A, 0xED, 0x04, 0xD6, 0x2A, 0x93, 0xAA, 0xB6, 0xB0, 0x67, 0x18, 0xC1, 0x1D, 0x44,
+  0x32, 0x9C, 0xEC, 0x17, 0x47, 0x84, 0x73, 0xAD, 0x1D, 0xA1, 0xD3, 0x14, 0x3E, 0xA4, 0xB8, 0xBA,
+  0xB8, 0x97, 0x18, 0xAB, 0x13, 0x2D, 0x85, 0x6F, 0x16, 0x8F, 0x95, 0x79, 0x8A, 0xF3, 0x58, 0x0C,
+  0x3D, 0xB2, 0x26, 0xBB, 0x22, 0x0E, 0xF3, 0xD5, 0x66, 0x37, 0xB7, 0x7F, 0xC1, 0xCA, 0x94, 0x46,
+  0xA0, 0x0B, 0x9F, 0xDD, 0x0F, 0x4D, 0x7D, 0xC8, 0x86, 0x1A, 0xC6, 0x44, 0xAA, 0xB9, 0x01, 0xB9,
+  0xD9, 0x36, 0x7A, 0x82, 0xDD, 0x99, 0xE2, 0x71, 0x9B, 0x3D, 0x3A, 0x01, 0xF9, 0x8B, 0x05, 0x21,
+  0x74, 0xB1, 0x8E, 0x25, 0xD7, 0x28, 0x72, 0x32, 0x6A, 0x32, 0x01, 0xF1, 0xDE, 0xA3, 0xCC, 0x76,
+  0x22, 0x4B, 0x85, 0x03, 0xEF, 0x92, 0x3E, 0xD6, 0x19, 0xFE, 0x63, 0x9B, 0xC1, 0xBA, 0x0A, 0x90,
+  0x25, 0xAB, 0xD7, 0xAB, 0x39, 0xA5, 0xCD, 0xE8, 0x58, 0xF9, 0xFC, 0x46, 0x4E, 0xB8, 0x03, 0x2E,
+  0xAE, 0xE5, 0xF1, 0x70, 0x65, 0xFA, 0x02, 0x93, 0x39, 0x53, 0xDA, 0x9C, 0xA4, 0xC3, 0xEF, 0xC8,
+  0xA0, 0x5F, 0x4E, 0x20, 0x90, 0xF5, 0x8C, 0xC1, 0x22, 0x40, 0x96, 0x17, 0xCE, 0x60, 0x60, 0xF1,
+  0x3A, 0x7C, 0x9F, 0xE3, 0x87, 0x98, 0xF0, 0x32, 0x26, 0xD4, 0x93, 0x4D, 0xC7, 0x4E, 0x72, 0xE1,
+  0x63, 0x20, 0x6F, 0x0E, 0xB8, 0xF8, 0xA7, 0xF0, 0x39, 0xE6, 0x9D, 0x91, 0x7E, 0x75, 0xD7, 0xFE,
+  0x00, 0xA7, 0x38, 0x7B, 0x24, 0xCD, 0x33, 0xB5, 0x3A, 0x31, 0x2A, 0x83, 0x63, 0xCC, 0xA5, 0x66,
+  0x61, 0xD7, 0xF4, 0x54, 0x31, 0xEC, 0x98, 0x63, 0xDE, 0x64, 0xDF, 0xB3, 0x37, 0x8E, 0x0E, 0xD4,
+  0x1B, 0x8A, 0x46, 0xFA, 0x60, 0x46, 0xE7, 0x8A, 0xE6, 0x71, 0x51, 0x47, 0x1C, 0x62, 0x3D, 0x40,
+  0x67, 0xC4, 0x25, 0xF9, 0xC8, 0x70, 0xEE, 0x6D, 0x44, 0x1C, 0x73, 0xD6, 0x56, 0xE7, 0x79, 0x3B,
+  0xCF, 0xD7, 0x11, 0x94, 0x16, 0x80, 0x11, 0xC8, 0x1E, 0x30, 0xF2, 0x91, 0x29, 0x62, 0xF9, 0x7D,
+  0x28, 0x17, 0x82, 0x86, 0xC1, 0x8E, 0x86, 0xA4, 0x29, 0xA4, 0xC8, 0xD6, 0xE7, 0xDF, 0x89, 0x18,
+  0x23, 0x21, 0xA2, 0xD5, 0x6C, 0xEE, 0x6F, 0x33, 0x14, 0x14, 0xF0, 0xE7, 0x3B, 0xFA, 0xF9, 0x1E,
+  0x7F, 0xB6, 0xDA, 0x7B, 0x32, 0x56, 0xB9, 0xD9, 0x08, 0x1B, 0xA1, 0x4C, 0xA1, 0x82, 0x9E, 0x55,
+  0xBC, 0x17, 0x9C, 0x09, 0x94, 0x82, 0x08, 0xBF, 0xA5, 0xA4, 0x4E, 0xBE, 0x4C, 0x01, 0x06, 0xCF,
+  0x61, 0x7C, 0xDB, 0xA0, 0xE8, 0x19, 0xF4, 0x9E, 0x16, 0x9A, 0x69, 0x39, 0x9E, 0x4A, 0x1D, 0xA4,
+  0xE6, 0x8A, 0xD9, 0x56, 0x76, 0xE0, 0x5C, 0x61, 0x09, 0xB1, 0xA6, 0xC1, 0xAE, 0x4C, 0xF8, 0xD2,
+  0x3F, 0x64, 0x4D, 0x7C, 0xB9, 0xDD, 0x8C, 0xA7, 0x26, 0x92, 0x09, 0xC7, 0x08, 0x4A, 0x30, 0x9E,
+  0xA0, 0xE4, 0x44, 0x0E, 0xF0, 0x13, 0xCF, 0x34, 0x0C, 0x6E, 0xE3, 0xFB, 0x38, 0x57, 0xCA, 0x4D,
+  0x86, 0x75, 0x71, 0x11, 0x02, 0x58, 0x00, 0x78, 0xB3, 0x7C, 0x50, 0x53, 0xCE, 0xA6, 0xF2, 0xB8,
+  0xA8, 0x82, 0xE1, 0x89, 0xDE, 0xB0, 0x58, 0x39, 0xFE, 0xA8, 0xF7, 0x1C, 0xE3, 0xB1, 0x36, 0x0E,
+  0x71, 0xA2, 0x74, 0x5E, 0xC2, 0x71, 0x0F, 0xF7, 0x65, 0x84, 0x53, 0xFE, 0x59, 0x9E, 0x6C, 0xDA,
+  0x73, 0x00, 0xDF, 0x47, 0x61, 0xEB, 0x5C, 0x6E, 0x9A, 0x19, 0xA5, 0x90, 0x1D, 0x91, 0x10, 0xCB,
+  0x02, 0xE6, 0x71, 0x9F, 0x8B, 0x5B, 0x07, 0x11, 0x45, 0x1D, 0x10, 0x94, 0xC1, 0xFC, 0x06, 0x1F,
+  0xC3, 0xAE, 0x17, 0x3A, 0x21, 0xC2, 0x86, 0xC5, 0x02, 0x12, 0x8A, 0x26, 0x59, 0x5B, 0x1D, 0x30,
+  0xAE, 0x9C, 0xFB, 0x93, 0x90, 0xC4, 0x10, 0x30, 0x11, 0x40, 0x8A, 0x9D, 0xF7, 0x0E, 0x83, 0x0E,
+  0x58, 0xD4, 0x03, 0x50, 0x9D, 0xFD, 0xA3, 0x14, 0x68, 0xF2, 0x61, 0x83, 0x78, 0x3B, 0x4A, 0x1E,
+  0x47, 0xB5, 0x45, 0xC7, 0x21, 0x14, 0x78, 0x9C, 0x35, 0x08, 0x49, 0xC6, 0xF5, 0xF0, 0x1F, 0x48,
+  0x29, 0xB6, 0x0F, 0x5C, 0x4B, 0x12, 0x5A, 0xEC, 0x79, 0xFA, 0x08, 0x8F, 0x53, 0x98, 0x01, 0x4A,
+  0xAE, 0x69, 0xB0, 0x81, 0xE6, 0x66, 0xFA, 0x86, 0x87, 0x9B, 0x3D, 0x25, 0xFA, 0x26, 0x7D, 0xFA,
+  0x12, 0xF0, 0x7C, 0x9A, 0x46, 0xE8, 0x84, 0x5E, 0xE4, 0xCC, 0xCD, 0x04, 0x4D, 0xF6, 0x39, 0xDC,
+  0x4D, 0x74, 0x5E, 0xEA, 0x98, 0x4D, 0x34, 0xCD, 0x1C, 0x32, 0x15, 0x43, 0x6A, 0x3B, 0xF6, 0xB4,
+  0xAD, 0x4F, 0x80, 0x3A, 0x90, 0x69, 0x73, 0xF0, 0x30, 0x8E, 0xAD, 0x1F, 0x0F, 0xDF, 0xDA, 0x53,
+  0x4E, 0xE7, 0x6C, 0xBC, 0xCE, 0x42, 0x8D, 0x5C, 0xFE, 0x9B, 0x58, 0x7A, 0xC6, 0x48, 0xD3, 0x59,
+  0xEE, 0xD1, 0x6A, 0x42, 0x64, 0xE4, 0x84, 0x2F, 0x02, 0x54, 0xF3, 0x6A, 0x47, 0x0A, 0xDA, 0xF2,
+  0xE3, 0x32, 0xA2, 0x63, 0x92, 0xC3, 0x17, 0x90, 0x8A, 0x40, 0xF0, 0x78, 0x3B, 0xB7, 0x08, 0x19,
+  0x0E, 0x5C, 0xB3, 0xE7, 0xE0, 0x3E, 0x5C, 0x5E, 0x7F, 0x43, 0x9E, 0x37, 0xD2, 0x4C, 0x1B, 0x64,
+  0x11, 0x4C, 0x4E, 0x2A, 0xCB, 0xAD, 0x48, 0x61, 0x81, 0x72, 0x21, 0x62, 0x1A, 0x28, 0x5B, 0xBB,
+  0x03, 0x49, 0x85, 0xB2, 0x17, 0xB2, 0xAF, 0x18, 0x80, 0xAF, 0xB9, 0x2E, 0x70, 0x5D, 0x0A, 0x2C,
+  0xC2, 0xC8, 0x99, 0x00, 0xD8, 0xBB, 0x23, 0x30, 0x9D, 0x04, 0xAA, 0x39, 0x20, 0xBC, 0x10, 0xBE,
+  0x82, 0xD0, 0xF2, 0xDD, 0x04, 0x41, 0xC6, 0xE0, 0x03, 0x90, 0x82, 0x78, 0xD4, 0xB9, 0x66, 0x61,
+  0x04, 0x0D, 0x20, 0xB5, 0xFE, 0x88, 0xF2, 0x08, 0x50, 0x41, 0x3D, 0xD6, 0x83, 0xEA, 0x5A, 0x75,
+  0x50, 0x56, 0xF1, 0x59, 0x85, 0xCC, 0xB2, 0x64, 0x04, 0x46, 0x58, 0xC1, 0xBE, 0x51, 0x06, 0xAD,
+  0x63, 0xCB, 0x1C, 0xD8, 0x88, 0x04, 0xB5, 0xA3, 0x63, 0x78, 0x4C, 0xFB, 0x49, 0xE6, 0x4E, 0x16,
+  0x7D, 0xB3, 0x58, 0x74, 0x9E, 0x32, 0x99, 0x25, 0xC9, 0xF9, 0xB8, 0x66, 0xCC, 0x02, 0xA4, 0x53,
+  0x96, 0x32, 0x13, 0x84, 0x5D, 0x61, 0xF6, 0x1F, 0xD9, 0x10, 0x8E, 0x70, 0x99, 0xC6, 0x90, 0xF4,
+  0x75, 0x44, 0x61, 0x9A, 0x20, 0xC7, 0x28, 0x46, 0xE6, 0x45, 0xD9, 0xDB, 0x54, 0x52, 0x93, 0x3B,
+  0x0E, 0xEA, 0xBC, 0xC5, 0xFF, 0xF1, 0xF7, 0xFF, 0xF6, 0x59, 0xDF, 0xC3, 0xF4, 0x27, 0xA0, 0x12,
+  0x44, 0x6F, 0xC5, 0x70, 0x50, 0x86, 0xD2, 0x19, 0x9B, 0x28, 0x36, 0x17, 0x36, 0x37, 0xC7, 0x4D,
+  0xCD, 0xE6, 0x28, 0xF8, 0x59, 0xBB, 0xAF, 0x65, 0x27, 0x3E, 0x99, 0x2C, 0x65, 0xAD, 0xDD, 0xB3,
+  0x63, 0x1B, 0x0E, 0xDE, 0xC3, 0xE2, 0xE0, 0x99, 0x89, 0x01, 0x31, 0xA6, 0x85, 0x41, 0x78, 0x7D,
+  0x50, 0xCB, 0x25, 0xC7, 0x92, 0xC9, 0xE3, 0x34, 0x1C, 0x8B, 0x74, 0xAC, 0x47, 0xED, 0xBE, 0x51,
+  0xD6, 0x36, 0x34, 0x2F, 0x63, 0x48, 0xFE, 0xE6, 0xE5, 0x91, 0x5F, 0xD5, 0xD4, 0x32, 0xE5, 0xDC,
+  0x4D, 0xD4, 0x5E, 0xE6, 0x74, 0xE9, 0xC6, 0xDE, 0xAD, 0x6A, 0x91, 0x9D, 0x57, 0x54, 0x6C, 0x05,
+  0x6C, 0xED, 0x98, 0x42, 0x1F, 0x16, 0xC5, 0x57, 0x7A, 0x79, 0x45, 0x18, 0xEB, 0xE2, 0xD8, 0x2F,
+  0x38, 0x9B, 0x8F, 0xB3, 0x72, 0x47, 0x8B, 0x62, 0x2D, 0xBD, 0xBD, 0x81, 0x78, 0x7B, 0x03, 0x62,
+  0x74, 0x51, 0xB4, 0xC5, 0x77, 0x57, 0x84, 0xB5, 0xB0, 0x31, 0xD6, 0x0B, 0xD2, 0xE6, 0x23, 0x2D,
+  0x6D, 0x67, 0x51, 0x9C, 0xC5, 0x97, 0x57, 0x8D, 0xB2, 0xF3, 0x13, 0x4E, 0xFD, 0xBE, 0x12, 0xD4,
+  0xBF, 0x0F, 0x39, 0xB7, 0xCE, 0x4C, 0x15, 0x1C, 0x5F, 0x3B, 0x52, 0x8F, 0x19, 0x3D, 0x67, 0xB7,
+  0x26, 0x8C, 0x17, 0x7D, 0xFB, 0x6A, 0xB6, 0x81, 0x4A, 0xC8, 0xB7, 0x16, 0x2B, 0xC8, 0x4E, 0x9D,
+  0xF8, 0x6A, 0x45, 0x59, 0x94, 0x4F, 0xEF, 0x09, 0x64, 0x02, 0x41, 0x66, 0x84, 0xF3, 0x52, 0x89,
+  0x06, 0x48, 0x43, 0x1B, 0x72, 0x0D, 0xD3, 0xF4, 0xC5, 0x04, 0xD5, 0x0B, 0xB2, 0x53, 0x6C, 0xAA,
+  0x98, 0x3A, 0x4F, 0x6C, 0x3C, 0x75, 0x46, 0x3D, 0x20, 0x26, 0xDA, 0x54, 0x44, 0x3A, 0xBF, 0x76,
+  0xA4, 0x1E, 0xC5, 0x30, 0xD1, 0x5F, 0x34, 0x6A, 0x65, 0xCC, 0xE2, 0xD5, 0x5C, 0xF9, 0x36, 0x26,
+  0x66, 0xEC, 0x11, 0xDF, 0xF6, 0xB8, 0xE6, 0xC5, 0x30, 0xC6, 0x8F, 0x5F, 0x3C, 0x02, 0x32, 0xCD,
+  0x44, 0x09, 0x44, 0x29, 0xDC, 0x7B, 0x68, 0xB7, 0x89, 0xC8, 0x54, 0xCD, 0xA8, 0x29, 0x7D, 0xED,
+  0x3A, 0xDC, 0xEB, 0x63, 0x5A, 0xB5, 0x55, 0xDB, 0x36, 0x5D, 0x77, 0x41, 0x76, 0xCD, 0x4E, 0xA7,
+  0x92, 0x4D, 0x33, 0x6A, 0xF6, 0x44, 0x7B, 0xA6, 0x74, 0xBF, 0x4A, 0x00, 0x39, 0x65, 0xD5, 0x74,
+  0x63, 0x6F, 0xAC, 0x95, 0x6D, 0x33, 0x02, 0x41, 0x49, 0xBB, 0x66, 0x85, 0x9B, 0xEB, 0x33, 0xCA,
+  0x34, 0xC3, 0x2E, 0xCF, 0x0E, 0x43, 0x01, 0x61, 0x08, 0x1D, 0xDE, 0xC3, 0x62, 0x2F, 0xCF, 0x66,
+  0x64, 0x20, 0xDC, 0x39, 0x46, 0x29, 0x61, 0x66, 0x0A, 0xC1, 0x33, 0xAC, 0x54, 0x02, 0xD2, 0x9C,
+  0x69, 0xB1, 0x1F, 0x1C, 0xFE, 0x84, 0xFD, 0x87, 0xA3, 0x24, 0x1A, 0xC6, 0x80, 0xAF, 0x6F, 0x38,
+  0x9A, 0x01, 0x81, 0x05, 0xCC, 0x18, 0xC9, 0x61, 0x7F, 0x81, 0xD6, 0x53, 0x65, 0x92, 0x95, 0x66,
+  0x3D, 0x8A, 0xA3, 0xD8, 0x69, 0x94, 0x96, 0xC7, 0x8F, 0x32, 0x20, 0xC5, 0xBF, 0x9F, 0xC9, 0xCC,
+  0x62, 0x8D, 0x97, 0x61, 0x0B, 0x9E, 0x3A, 0xEF, 0x25, 0x66, 0x4D, 0x52, 0xB9, 0xF3, 0x13, 0x54,
+  0x3A, 0x4E, 0x6D, 0xE4, 0x4B, 0x73, 0x70, 0xCC, 0x08, 0xBC, 0xD1, 0x26, 0x31, 0x55, 0x64, 0x7B,
+  0xE0, 0x69, 0xEE, 0xD0, 0xD4, 0x6F, 0xF8, 0x00, 0x96, 0x78, 0xE6, 0x39, 0xAE, 0x64, 0x27, 0x85,
+  0x74, 0xB6, 0x74, 0x73, 0xAA, 0x05, 0xAE, 0x9E, 0x30, 0xF9, 0x28, 0xDF, 0xA9, 0x36, 0x99, 0xCA,
+  0x73, 0xA2, 0xCB, 0xCC, 0x79, 0x26, 0x15, 0x0F, 0x43, 0xCD, 0xBA, 0x50, 0x4D, 0xF0, 0x64, 0xC2,
+  0xC8, 0x66, 0xED, 0xE8, 0x5B, 0xB7, 0x58, 0x12, 0xC7, 0xC9, 0xAC, 0x9D, 0xE7, 0xDF, 0xF2, 0x5B,
+  0xE6, 0xA7, 0x7C, 0x9C, 0x2F, 0x1A, 0x77, 0x25, 0x30, 0x1F, 0x9D, 0xC0, 0x63, 0x63, 0xA8, 0x81,
+  0x3C, 0x34, 0x20, 0x0F, 0x2A, 0xF2, 0xCF, 0x90, 0xCA, 0xAD, 0x2A, 0x93, 0xA1, 0xDC, 0x3F, 0x14,
+  0xEA, 0xF7, 0x3D, 0xFE, 0x5B, 0xC0, 0x6D, 0xFD, 0x31, 0x86, 0xDC, 0xDF, 0xBA, 0xEB, 0x84, 0xD7,
+  0x52, 0xA4, 0xF0, 0x9E, 0x80, 0xF4, 0xAE, 0xDB, 0xE5, 0x02, 0x33, 0x9C, 0xF9, 0x53, 0x4F, 0xB4,
+  0xA7, 0x71, 0xEB, 0x52, 0x77, 0x18, 0x70, 0x92, 0xDC, 0x70, 0x9B, 0xDF, 0x6B, 0x96, 0xBA, 0xBC,
+  0x80, 0x07, 0x4C, 0x3D, 0x29, 0xE8, 0xF6, 0xFA, 0xD4, 0x9B, 0x8B, 0xF8, 0x14, 0xE6, 0x64, 0x4C,
+  0xC9, 0x35, 0x8E, 0x28, 0x74, 0xFD, 0x8E, 0x1C, 0x95, 0x8E, 0x62, 0x24, 0x62, 0x06, 0x6B, 0x75,
+  0xEE, 0x59, 0xFB, 0x1D, 0xC3, 0x93, 0x18, 0x2F, 0x26, 0xE8, 0x80, 0x7E, 0xDC, 0x96, 0x77, 0x6B,
+  0x91, 0x5E, 0xA8, 0x09, 0xC1, 0x47, 0x2E, 0xF9, 0x36, 0x2B, 0x7F, 0x43, 0xFC, 0xF3, 0xF5, 0x67,
+  0x67, 0xC4, 0x5F, 0x93, 0x9F, 0xE1, 0x36, 0x73, 0xF0, 0x66, 0x43, 0xC3, 0x7E, 0xB6, 0xF1, 0x3B,
+  0x0F, 0xD7, 0x47, 0x03, 0x95, 0xE6, 0xDA, 0x2B, 0x34, 0xE5, 0x2C, 0xC1, 0x8F, 0x3E, 0x2E, 0x6F,
+  0x4A, 0xB9, 0xAB, 0xE3, 0x39, 0x7D, 0xD3, 0xE2, 0xB7, 0xCE, 0x0F, 0x6E, 0xCF, 0x21, 0x4C, 0x6C,
+  0x32, 0xE9, 0xBF, 0x12, 0xEF, 0xD4, 0x38, 0x8C, 0x06, 0x5A, 0x95, 0xD3, 0xFC, 0x65, 0x5F, 0xB2,
+  0x4A, 0xC7, 0x1B, 0x68, 0xB6, 0xF9, 0xBB, 0x14, 0xC5, 0x87, 0x9A, 0x8F, 0x69, 0x10, 0x1D, 0xCF,
+  0x75, 0xC8, 0x8F, 0x0C, 0x98, 0xA6, 0x3D, 0xE8, 0x0A, 0xD0, 0x29, 0x47, 0x6C, 0x42, 0x3E, 0xD0,
+  0x74, 0x1D, 0xED, 0x83, 0xDB, 0xD2, 0x53, 0xD5, 0x24, 0x21, 0xC1, 0xE3, 0xE4, 0xF9, 0x8A, 0x54,
+  0x49, 0xBD, 0xEB, 0x81, 0x0F, 0xE8, 0xAB, 0x32, 0x28, 0xE2, 0x7D, 0x1C, 0x2D, 0x5C, 0xE0, 0xC2,
+  0xE3, 0xE8, 0x08, 0x28, 0xFD, 0xC8, 0xEA, 0x2C, 0xBC, 0x9D, 0xEE, 0xBA, 0x9A, 0xF7, 0xE3, 0x22,
+  0xB0, 0x25, 0x84, 0x9E, 0xB3, 0x97, 0xBE, 0x0C, 0xD4, 0x7A, 0x3B, 0x67, 0x2F, 0xFD, 0x1C, 0xD4,
+  0x2E, 0xEC, 0xAB, 0x3F, 0xBB, 0x9F, 0xC5, 0x7B, 0xEC, 0x2F, 0xDC, 0xA1, 0x09, 0xE3, 0xA5, 0xFD,
+  0x95, 0xEA, 0xFC, 0xF3, 0xD6, 0xF2, 0x71, 0x41, 0xD5, 0x14, 0xFD, 0x58, 0xCB, 0x69, 0x2A, 0xFC,
+  0x18, 0x58, 0x13, 0xBA, 0x3B, 0x36, 0x5E, 0x2B, 0xA5, 0x7D, 0xE6, 0x72, 0xAA, 0xE9, 0xED, 0x34,
+  0x00, 0xF9, 0xF3, 0x62, 0xEF, 0xA7, 0x43, 0x0D, 0x0E, 0x60, 0x2B, 0x52, 0x1C, 0xC2, 0xFE, 0xF2,
+  0x92, 0xA0, 0xC6, 0x8E, 0xA0, 0xA8, 0xAF, 0x13, 0x2D, 0x80, 0xC3, 0x98, 0xCA, 0xBD, 0xCA, 0x74,
+  0x05, 0xF8, 0x80, 0x3C, 0xB0, 0x0F, 0x59, 0x49, 0x35, 0x22, 0xD9, 0x67, 0x72, 0xCA, 0xF2, 0x51,
+  0x96, 0x02, 0x51, 0x4E, 0x77, 0xD8, 0x7B, 0xD7, 0x04, 0xF5, 0x01, 0x7F, 0x56, 0x52, 0x20, 0xDE,
+  0x1F, 0x60, 0x73, 0xFC, 0x59, 0x4D, 0xFF, 0x78, 0xDF, 0xC6, 0xF6, 0xF4, 0xAB, 0x52, 0x07, 0xBB,
+  0xEF, 0xF6, 0xB0, 0x03, 0xFA, 0x55, 0xA9, 0x83, 0xFD, 0xB7, 0xB4, 0x02, 0xFA, 0x55, 0x6D, 0x09,
+  0xAD, 0x7D, 0xB9, 0x06, 0xFA, 0x5D, 0xA9, 0x8B, 0xF6, 0x6E, 0x93, 0x56, 0x21, 0x7F, 0x57, 0xEA,
+  0x62, 0xEF, 0xA0, 0x29, 0x37, 0x92, 0x7E, 0x57, 0xDB, 0xCA, 0x76, 0x4B, 0x6E, 0x26, 0xFD, 0x5E,
+  0x3F, 0xA5, 0xF0, 0x96, 0x3C, 0xFE, 0x81, 0x96, 0x48, 0x9C, 0xC1, 0x3B, 0x4C, 0x94, 0x2F, 0x6E,
+  0x8E, 0xCF, 0x2E, 0xBF, 0x32, 0x64, 0x5A, 0xA1, 0xC7, 0xBE, 0x0E, 0xC4, 0x3C, 0x90, 0x7E, 0xF8,
+  0x20, 0x6C, 0xEB, 0x58, 0xAD, 0x1B, 0x6B, 0x8F, 0x61, 0xA2, 0xE8, 0xA1, 0x83, 0xA2, 0x0B, 0x7A,
+  0x04, 0x21, 0x19, 0xC5, 0xA4, 0x16, 0xDA, 0xFE, 0x9E, 0xEB, 0x3F, 0x2F, 0x1D, 0x11, 0xC1, 0x3D,
+  0x27, 0xF6, 0x96, 0xEA, 0xAA, 0x76, 0x74, 0x1D, 0x3C, 0x30, 0xF5, 0xA1, 0x34, 0x5F, 0x4B, 0x77,
+  0x96, 0x35, 0xD9, 0x79, 0xF0, 0x36, 0x40, 0xE6, 0x2F, 0xD7, 0xE7, 0xC7, 0x55, 0x2D, 0x23, 0x9D,
+  0x4E, 0x77, 0xE7, 0xFC, 0x0E, 0x03, 0x31, 0x6E, 0x01, 0x4B, 0x07, 0x98, 0x6B, 0xBD, 0x0A, 0x71,
+  0xCB, 0xE5, 0x8D, 0x82, 0x07, 0xB5, 0x32, 0x00, 0xF9, 0x65, 0xFB, 0xB4, 0x1A, 0xB7, 0x03, 0xED,
+  0xFA, 0xEC, 0x74, 0xE7, 0xEC, 0xF8, 0x74, 0x3D, 0xC9, 0xF3, 0xEC, 0xF8, 0xF6, 0x38, 0x49, 0x8B,
+  0x4A, 0xC2, 0x50, 0x01, 0x34, 0x86, 0xD9, 0x27, 0x4F, 0x3C, 0x91, 0xF2, 0x0C, 0xC5, 0x5D, 0x92,
+  0x35, 0x4A, 0xD5, 0x8B, 0x40, 0xAF, 0xA6, 0x66, 0xB1, 0xDB, 0x9F, 0x76, 0x6E, 0x7E, 0x42, 0x7A,
+  0xB5, 0x54, 0xA9, 0x97, 0x78, 0xB1, 0xC0, 0x06, 0xC3, 0x0D, 0x52, 0x5B, 0x93, 0x68, 0xED, 0x06,
+  0x20, 0x1D, 0x31, 0x97, 0x63, 0x3F, 0x30, 0x03, 0x83, 0x39, 0x81, 0x40, 0x81, 0x1B, 0xD5, 0x9E,
+  0x7D, 0xDB, 0x57, 0x1E, 0xAB, 0xC0, 0x44, 0x44, 0xD8, 0x18, 0xE5, 0x71, 0x98, 0x07, 0xEC, 0x4B,
+  0xD4, 0x11, 0xAA, 0x4F, 0x36, 0x55, 0x4D, 0x53, 0x7E, 0xAE, 0xDD, 0xB3, 0xE3, 0x9D, 0xEE, 0xE9,
+  0x95, 0xCC, 0x0D, 0xAF, 0xCB, 0xBD, 0x6C, 0xC8, 0x9B, 0xC7, 0x9D, 0x33, 0xD3, 0x93, 0xF7, 0xE0,
+  0xF1, 0x69, 0x24, 0x5C, 0x69, 0x05, 0x88, 0xDE, 0x9A, 0x4E, 0x57, 0xBB, 0x6A, 0x0B, 0x13, 0xEF,
+  0x2A, 0xE5, 0xAA, 0x6F, 0x7A, 0x23, 0xBC, 0x22, 0x98, 0xE6, 0x39, 0x8B, 0x80, 0xDA, 0x38, 0xFB,
+  0x6C, 0x48, 0xD9, 0x28, 0xB2, 0xCC, 0x83, 0x07, 0x49, 0x09, 0xEB, 0x0C, 0xB7, 0xE1, 0x89, 0x02,
+  0x56, 0xA2, 0xC7, 0x89, 0xB9, 0xBE, 0x88, 0x57, 0x2F, 0xE2, 0xD5, 0x1F, 0x47, 0xBC, 0xBA, 0xB4,
+  0x25, 0x1B, 0xC6, 0x68, 0xC2, 0x6D, 0x15, 0x5E, 0x99, 0x16, 0xB6, 0x26, 0xF9, 0xFB, 0x54, 0x59,
+  0x2B, 0xC6, 0xC0, 0x62, 0xFC, 0x4B, 0xC2, 0x6F, 0xCD, 0x04, 0xAD, 0x42, 0x4C, 0x0C, 0x86, 0xE4,
+  0x1E, 0x1C, 0x03, 0x1D, 0x3C, 0x5B, 0xE6, 0x55, 0x34, 0x63, 0xBE, 0x86, 0x78, 0x79, 0x05, 0x79,
+  0x1E, 0x9F, 0x68, 0x74, 0x61, 0x1A, 0x3E, 0x65, 0xF4, 0x78, 0xF1, 0x16, 0xF9, 0xCC, 0xB9, 0x2C,
+  0xD9, 0x2C, 0xFF, 0x89, 0xDB, 0x9C, 0xD0, 0x57, 0x93, 0xAB, 0x46, 0xC7, 0x10, 0xD6, 0x55, 0x12,
+  0x01, 0x1C, 0xCF, 0xF0, 0xDE, 0x48, 0x05, 0x11, 0x8F, 0x02, 0xC0, 0xDD, 0x3E, 0x25, 0x17, 0xD9,
+  0x96, 0xF1, 0xBD, 0xB0, 0xDF, 0x18, 0x85, 0x1B, 0x45, 0xB7, 0x34, 0xD8, 0x0D, 0xFF, 0x2D, 0x30,
+  0x3D, 0xEE, 0x4B, 0x47, 0x2D, 0x8F, 0xEB, 0x3C, 0x1D, 0xD0, 0xAF, 0x4C, 0xF1, 0xB2, 0x83, 0x56,
+  0xB3, 0xB9, 0xDD, 0x6C, 0x36, 0x03, 0x5F, 0x89, 0x23, 0x16, 0xB7, 0x07, 0xF0, 0x18, 0x65, 0x90,
+  0xF7, 0xD1, 0x57, 0x72, 0x06, 0x5C, 0xDC, 0x73, 0x6E, 0xCB, 0xF7, 0xFC, 0xC6, 0x46, 0x5B, 0xF2,
+  0xA7, 0x90, 0xCA, 0x19, 0xC7, 0xF0, 0x68, 0xBF, 0x34, 0xC5, 0x3C, 0xE9, 0x86, 0x20, 0x2D, 0x3F,
+  0x24, 0xE6, 0x75, 0x0B, 0x90, 0x3F, 0x91, 0x80, 0xA7, 0xCF, 0xBF, 0x06, 0x7E, 0x31, 0x9B, 0x7B,
+  0x85, 0xBB, 0x82, 0xDB, 0xC9, 0x5D, 0x66, 0x5B, 0xFF, 0xEF, 0xFF, 0xFA, 0x05, 0x2A, 0x82, 0x3F,
+  0xA5, 0xAA, 0x6D, 0x71, 0x83, 0x74, 0x79, 0xCF, 0xD8, 0x5C, 0x58, 0x96, 0xAA, 0x73, 0x9B, 0xD7,
+  0xDB, 0x73, 0x2B, 0x2A, 0x9F, 0x58, 0xEF, 0x15, 0x31, 0x86, 0x45, 0xE2, 0x5F, 0x27, 0xCE, 0x80,
+  0x24, 0xE2, 0x6D, 0x04, 0x5E, 0x8D, 0x21, 0x53, 0x1D, 0x9B, 0xA2, 0x3E, 0xD6, 0x09, 0x87, 0xC8,
+  0xCE, 0x8E, 0xB3, 0x3B, 0x37, 0x06, 0xBC, 0xAC, 0x4A, 0x94, 0x8B, 0x50, 0x1D, 0xC7, 0xD2, 0x3C,
+  0x53, 0x3C, 0x2E, 0x18, 0x9F, 0xC2, 0x61, 0x0E, 0x4B, 0x30, 0xA9, 0x84, 0xF6, 0x95, 0x3D, 0xE9,
+  0xC9, 0x2D, 0x1C, 0x7F, 0x55, 0x41, 0x1F, 0x9B, 0x6E, 0x1A, 0xBA, 0x31, 0xC9, 0xED, 0x1A, 0xB7,
+  0xA0, 0x64, 0x01, 0xD4, 0x09, 0x4B, 0xD1, 0x85, 0x66, 0x59, 0xE5, 0xFB, 0x2A, 0x51, 0x48, 0x75,
+  0x21, 0xD7, 0xC6, 0x68, 0xB1, 0x91, 0xB2, 0x89, 0x6F, 0x0E, 0x50, 0x36, 0xBC, 0xC7, 0x08, 0x5F,
+  0x90, 0xEA, 0x87, 0xD0, 0x95, 0x72, 0x13, 0xD3, 0xC9, 0x7C, 0xB1, 0xE5, 0x49, 0x58, 0x71, 0x58,
+  0xDF, 0x1B, 0x59, 0x5F, 0xF2, 0x3E, 0xF9, 0x42, 0x5F, 0x41, 0x80, 0xDE, 0x88, 0x89, 0x44, 0x31,
+  0x20, 0x3F, 0x9B, 0x34, 0x47, 0xAF, 0xD6, 0x43, 0xC0, 0xFF, 0xAC, 0xDC, 0x49, 0xC9, 0x44, 0x79,
+  0xE5, 0x0C, 0x06, 0xE8, 0xEE, 0x99, 0x96, 0xF7, 0x73, 0xA1, 0x22, 0x0D, 0x9C, 0xAA, 0xF9, 0x42,
+  0xF5, 0x82, 0xDC, 0xA9, 0x4C, 0xEA, 0x0D, 0xD9, 0x4B, 0x5C, 0xB2, 0x1A, 0x01, 0xE3, 0xB2, 0x90,
+  0x1F, 0x45, 0xD2, 0x1B, 0xC7, 0x19, 0xF9, 0x6F, 0xA4, 0xA8, 0xBF, 0xDB, 0x8C, 0x8C, 0x8A, 0xFA,
+  0x23, 0xBB, 0xB9, 0xEE, 0x36, 0xD0, 0xFD, 0xA1, 0x1F, 0x58, 0x4A, 0x71, 0x46, 0x2F, 0x2D, 0x66,
+  0x99, 0x3F, 0x40, 0x9B, 0x08, 0xF0, 0x5A, 0x50, 0x78, 0x26, 0xA8, 0xCD, 0x81, 0xA5, 0xB4, 0xE3,
+  0x2E, 0x97, 0xAE, 0x12, 0x28, 0xF8, 0x00, 0x5E, 0xFF, 0x40, 0xAB, 0x25, 0x31, 0x18, 0xE9, 0xE6,
+  0xCF, 0x7E, 0x39, 0x3F, 0xAB, 0x5F, 0xBC, 0xEF, 0xB0, 0x4B, 0x5B, 0x60, 0xF4, 0x3D, 0x7D, 0x75,
+  0xAD, 0xD9, 0x81, 0x26, 0xFB, 0x1F, 0x39, 0x1E, 0x4F, 0xDA, 0x45, 0xF3, 0x35, 0x95, 0x12, 0xA9,
+  0xC7, 0x56, 0xA9, 0x6B, 0xAC, 0x9D, 0x5F, 0xF2, 0xB7, 0xE3, 0x9B, 0xDB, 0xF6, 0xB7, 0x93, 0x9F,
+  0x2E, 0xED, 0x88, 0xD2, 0xE0, 0x13, 0xEC, 0x0C, 0x52, 0xC4, 0xD7, 0xD9, 0xC1, 0x4F, 0xB4, 0x19,
+  0xD4, 0xC1, 0x32, 0x3C, 0x91, 0xE3, 0x33, 0x5D, 0x92, 0x05, 0x29, 0x06, 0x10, 0x39, 0x7F, 0xC7,
+  0x8E, 0x2D, 0x9A, 0xD5, 0x19, 0x6F, 0x0C, 0x1A, 0x13, 0x55, 0x56, 0xB1, 0x4A, 0x31, 0x5A, 0xDA,
+  0x23, 0x12, 0xFB, 0x72, 0xFE, 0xB5, 0x7E, 0xF6, 0xFE, 0x74, 0x03, 0xA2, 0x56, 0xE6, 0xE3, 0xB8,
+  0x42, 0x29, 0x05, 0x9F, 0x91, 0xDF, 0x0A, 0xAE, 0xA7, 0x92, 0xDB, 0x4A, 0xAC, 0x61, 0x36, 0xD8,
+  0x63, 0x90, 0x4A, 0x39, 0xAD, 0xDC, 0x9B, 0x7D, 0x73, 0xAD, 0x7C, 0x56, 0x66, 0xAE, 0xA5, 0xA2,
+  0xCB, 0xCA, 0xA4, 0xE6, 0x09, 0x5B, 0x39, 0x4B, 0x53, 0xF8, 0x02, 0x5A, 0xB4, 0xE3, 0xFD, 0xF0,
+  0x0F, 0x97, 0xC6, 0x00, 0x30, 0x77, 0xB0, 0xEE, 0x71, 0x8A, 0x78, 0x84, 0xBD, 0xA6, 0xF3, 0x09,
+  0xE6, 0x29, 0x1C, 0xB6, 0x27, 0x77, 0xCF, 0x56, 0x53, 0x6A, 0xB0, 0x63, 0x90, 0x35, 0xC3, 0x4F,
+  0x91, 0xE4, 0x09, 0x27, 0x23, 0x5E, 0xBD, 0xD9, 0xAA, 0xBE, 0x33, 0xF7, 0x45, 0xF8, 0xCE, 0x38,
+  0x62, 0x21, 0x7A, 0x19, 0x2F, 0xCF, 0x1A, 0x7F, 0x98, 0x04, 0x1E, 0x88, 0xE2, 0x6A, 0x43, 0x9B,
+  0xDD, 0x2E, 0xC6, 0x10, 0xC5, 0xB4, 0xF2, 0xDD, 0x09, 0x1D, 0x0D, 0x5F, 0x29, 0x52, 0x68, 0xAD,
+  0xB2, 0x7E, 0x5F, 0xC6, 0x89, 0x71, 0x72, 0xEE, 0xEA, 0xC4, 0x12, 0xB0, 0xC3, 0xC5, 0xA2, 0xAB,
+  0xD3, 0x5D, 0x6C, 0x5A, 0x66, 0x80, 0xF8, 0xFC, 0x3B, 0xD0, 0x0D, 0xFC, 0x61, 0xE4, 0x6C, 0x61,
+  0xE7, 0xFB, 0x4C, 0xC0, 0xAC, 0xE3, 0xE6, 0x46, 0x2B, 0x2B, 0xBD, 0xA7, 0x61, 0xCB, 0x0D, 0xDE,
+  0xD7, 0x56, 0x51, 0xB2, 0x6C, 0xAF, 0xDF, 0xCE, 0xC9, 0xB9, 0x97, 0xDD, 0xB5, 0xD6, 0x86, 0x53,
+  0x62, 0x6B, 0x3E, 0x94, 0xB8, 0x8E, 0xFB, 0x59, 0x99, 0x12, 0x5B, 0xCF, 0x80, 0x12, 0xDB, 0x45,
+  0x29, 0x71, 0x77, 0xFD, 0x76, 0xAE, 0x5D, 0x89, 0x12, 0xDB, 0x1B, 0x4E, 0x89, 0xED, 0xF9, 0x50,
+  0xE2, 0x3A, 0xEE, 0x67, 0x65, 0x4A, 0x6C, 0x3F, 0x03, 0x4A, 0xDC, 0x2D, 0x4A, 0x89, 0x7B, 0xEB,
+  0xB7, 0x73, 0xBB, 0x95, 0x28, 0x71, 0x77, 0xC3, 0x29, 0x71, 0x77, 0x3E, 0x94, 0xB8, 0x8E, 0xFB,
+  0x59, 0x99, 0x12, 0x77, 0x57, 0x49, 0x89, 0x91, 0x7D, 0x83, 0xCC, 0x09, 0xB7, 0xB0, 0xE8, 0xC9,
+  0x1B, 0xC3, 0x42, 0x06, 0xCE, 0x68, 0xA7, 0xC7, 0x3D, 0x61, 0x06, 0x1D, 0xE5, 0xA1, 0xCB, 0xAE,
+  0x1D, 0xA3, 0xBC, 0x07, 0x65, 0xAA, 0xBB, 0xD4, 0x64, 0xB1, 0x92, 0xCA, 0x71, 0x67, 0x1E, 0x7E,
+  0x94, 0xAD, 0xDA, 0xD1, 0x71, 0xA7, 0x92, 0xDF, 0x5D, 0xB3, 0x76, 0x84, 0x96, 0x87, 0xB5, 0x74,
+  0xB8, 0x3B, 0xEE, 0xC4, 0xDC, 0xED, 0x54, 0x60, 0xA5, 0xB4, 0x6E, 0x78, 0x8E, 0x66, 0x60, 0xB1,
+  0xA3, 0xD0, 0x0D, 0x59, 0xD7, 0xB9, 0xEF, 0x33, 0x0A, 0xE2, 0x63, 0x18, 0x3E, 0xCC, 0x0D, 0xAC,
+  0x62, 0x52, 0x97, 0x60, 0x6E, 0x30, 0xE8, 0x8B, 0xCC, 0x2B, 0xD9, 0xBD, 0xC5, 0xC2, 0x8B, 0xD1,
+  0x91, 0xDA, 0x92, 0xEF, 0xA2, 0x95, 0x25, 0xE6, 0xA2, 0x4D, 0xA6, 0x15, 0x4C, 0xD5, 0x8E, 0x8D,
+  0x65, 0xB2, 0x10, 0x4C, 0x1D, 0xD7, 0x41, 0x17, 0x68, 0x0F, 0x06, 0x6F, 0x3C, 0xDF, 0xB4, 0x41,
+  0xB7, 0xA7, 0x9D, 0x9D, 0x6F, 0x67, 0x9D, 0xE7, 0x64, 0x84, 0x85, 0x25, 0xC1, 0x8A, 0x2A, 0x99,
+  0x61, 0x13, 0x4D, 0xB3, 0xC1, 0x9F, 0x04, 0x58, 0xCA, 0x16, 0x2B, 0x74, 0xF7, 0x9B, 0xE1, 0xAE,
+  0x95, 0x35, 0x36, 0x67, 0x49, 0x73, 0xB0, 0xC7, 0xCE, 0x3D, 0x01, 0xCE, 0x9D, 0x38, 0xB5, 0x4C,
+  0xCA, 0xBF, 0x0C, 0x93, 0x67, 0xF2, 0xEF, 0xA5, 0x64, 0xB0, 0x89, 0x06, 0x9E, 0x49, 0xED, 0x51,
+  0xA9, 0x06, 0xD8, 0x6D, 0xF9, 0xFE, 0x89, 0xF3, 0xC0, 0xA9, 0x64, 0xC5, 0xB2, 0xD8, 0x67, 0x5F,
+  0xD6, 0x57, 0xE2, 0xC6, 0xF6, 0x34, 0x66, 0x17, 0xB1, 0x39, 0x37, 0xF0, 0x87, 0xD2, 0xBB, 0x19,
+  0x4B, 0xA9, 0x10, 0x8B, 0x1B, 0x98, 0x77, 0xDC, 0x46, 0x44, 0x26, 0x7F, 0xE6, 0xC6, 0xA6, 0xA6,
+  0x22, 0x2F, 0x24, 0xE8, 0xB9, 0x59, 0xFB, 0x5B, 0x45, 0x94, 0x29, 0x24, 0xAB, 0x44, 0x18, 0x51,
+  0x3D, 0x41, 0x49, 0xA5, 0x1C, 0x10, 0xE1, 0xC2, 0xB0, 0xFA, 0x7A, 0xAD, 0x8A, 0x5B, 0x13, 0xD5,
+  0xA7, 0x87, 0x07, 0xB9, 0x57, 0xE2, 0x63, 0x8A, 0x3C, 0x5C, 0xA1, 0xEB, 0x8E, 0x4D, 0xD9, 0xCD,
+  0xBD, 0xF0, 0x7C, 0x0E, 0xBD, 0x05, 0x86, 0xB8, 0x0A, 0x59, 0xD4, 0x8C, 0x9C, 0x0A, 0x60, 0xAE,
+  0x3A, 0xCD, 0x55, 0x5E, 0xB7, 0x86, 0x97, 0x27, 0x48, 0x12, 0xE4, 0xB8, 0xDF, 0x78, 0xC9, 0xC9,
+  0x50, 0x56, 0xA7, 0x48, 0xA1, 0x5A, 0xF1, 0xBB, 0x8C, 0x18, 0x35, 0x26, 0xFA, 0xD8, 0xF4, 0x3A,
+  0xA6, 0xD1, 0x62, 0x30, 0x74, 0xAA, 0x12, 0xED, 0x61, 0xC3, 0x79, 0x12, 0x53, 0x44, 0x28, 0x8A,
+  0xC1, 0xE3, 0x71, 0x10, 0xF8, 0xF1, 0x6C, 0x67, 0xED, 0xF7, 0x7B, 0xEF, 0x5E, 0x50, 0xBF, 0x32,
+  0xEA, 0xD3, 0x4E, 0x97, 0xC7, 0x76, 0x6C, 0xB6, 0xD2, 0x64, 0x23, 0x2B, 0x13, 0xE7, 0xC2, 0x4A,
+  0xA2, 0x88, 0x91, 0xF2, 0xEF, 0x25, 0x89, 0x73, 0x6A, 0xE0, 0xC2, 0xE2, 0x9C, 0x7C, 0x7F, 0x5D,
+  0xC4, 0x39, 0xAA, 0xCA, 0xCA, 0x4C, 0xBB, 0xE7, 0x04, 0x20, 0xC8, 0xD1, 0x69, 0xA6, 0x8A, 0x73,
+  0x62, 0x2E, 0xC3, 0xA4, 0x70, 0x27, 0x3D, 0x52, 0xC3, 0xE3, 0x0E, 0x6B, 0xF8, 0xC9, 0x57, 0xD7,
+  0xD3, 0x4D, 0x60, 0x61, 0xF2, 0x9D, 0xDC, 0xC0, 0x45, 0xCA, 0x77, 0x72, 0x84, 0xA5, 0xCB, 0x77,
+  0x72, 0xD8, 0x97, 0x33, 0xE6, 0xF9, 0x9F, 0x31, 0xB1, 0x9D, 0x2E, 0x73, 0xC6, 0x8C, 0x9B, 0xFD,
+  0x31, 0xCF, 0x98, 0x6F, 0x86, 0x1B, 0x1E, 0x33, 0x68, 0x9E, 0x59, 0xEA, 0x31, 0x33, 0x1E, 0xBB,
+  0xD8, 0x49, 0x13, 0x18, 0xEE, 0xBA, 0x9C, 0x31, 0x63, 0x6B, 0x2B, 0x1D, 0x23, 0x58, 0x71, 0x1E,
+  0xAB, 0x45, 0xC9, 0xC2, 0xAB, 0x0C, 0x20, 0xF9, 0x47, 0x3A, 0x3D, 0xA2, 0x7D, 0x5C, 0xD8, 0x01,
+  0x12, 0x18, 0xEE, 0xD2, 0x8F, 0x8E, 0x68, 0x55, 0x6B, 0x77, 0x7A, 0x20, 0xA1, 0x66, 0x9F, 0x1E,
+  0xAD, 0x66, 0xAB, 0xD5, 0x7C, 0x39, 0x3E, 0x2A, 0x1C, 0x1F, 0xC9, 0xDD, 0x2E, 0x73, 0x82, 0x24,
+  0x5A, 0x3E, 0x83, 0xAC, 0x88, 0x32, 0x0F, 0xDD, 0x33, 0xBA, 0xD8, 0xA0, 0x05, 0x55, 0xBA, 0xD7,
+  0x88, 0xB7, 0xCC, 0x86, 0x7C, 0x1C, 0x58, 0xA9, 0x4B, 0x0D, 0x4A, 0x18, 0xB6, 0x56, 0x77, 0x1A,
+  0xB3, 0x97, 0xF3, 0xD4, 0xAC, 0x88, 0xD9, 0xD7, 0xCC, 0x25, 0xD3, 0x21, 0xCA, 0x1B, 0x66, 0x9A,
+  0x68, 0xB5, 0xDC, 0x87, 0xE3, 0x3B, 0xE5, 0xD8, 0xC7, 0xB9, 0xE4, 0x05, 0xFB, 0xDA, 0xEF, 0x57,
+  0x4E, 0x98, 0xDE, 0xED, 0xD4, 0xBF, 0x38, 0xF7, 0xEB, 0x99, 0x81, 0x8B, 0x12, 0x4D, 0x61, 0x14,
+  0x0D, 0xCC, 0x72, 0xB7, 0x1D, 0xA6, 0x69, 0x89, 0x12, 0x5A, 0xC9, 0x1B, 0x64, 0x20, 0xC0, 0x3A,
+  0xFD, 0xB1, 0x8D, 0xF6, 0xE3, 0xE8, 0xD1, 0x08, 0x4E, 0x1D, 0x53, 0x5E, 0x31, 0x13, 0xB8, 0xC9,
+  0x7B, 0x9F, 0x2A, 0xD7, 0xAB, 0x7A, 0xF6, 0xBE, 0x4F, 0x51, 0x64, 0x9F, 0x9D, 0x7B, 0x7E, 0x87,
+  0x89, 0x32, 0x4E, 0x00, 0x24, 0xC2, 0x71, 0xC4, 0x90, 0x75, 0x3B, 0x1D, 0x1C, 0xCB, 0x76, 0xC4,
+  0x78, 0x38, 0x41, 0xF6, 0x67, 0x1F, 0xAD, 0xD4, 0x98, 0xE6, 0xE2, 0xCF, 0xF8, 0x38, 0xD6, 0xE4,
+  0xE4, 0xEA, 0x3C, 0x1E, 0x27, 0x4A, 0x03, 0xC2, 0xAE, 0x6C, 0x5C, 0x62, 0x18, 0x02, 0x55, 0xD5,
+  0xFC, 0x16, 0xD9, 0x4A, 0x41, 0x0E, 0x0C, 0x24, 0xAC, 0xAE, 0x8F, 0x4F, 0xA3, 0x92, 0x1F, 0x34,
+  0x07, 0x78, 0x30, 0xBD, 0xDA, 0xC7, 0xF1, 0xF1, 0xE1, 0xC9, 0xC9, 0xE1, 0xE9, 0xE9, 0xE1, 0xD9,
+  0xD9, 0xE1, 0xF9, 0xF9, 0xE1, 0xC5, 0x45, 0x55, 0x77, 0x95, 0xCA, 0xB3, 0xEE, 0x68, 0x26, 0xA6,
+  0x81, 0xA3, 0xC9, 0xFB, 0x87, 0xE5, 0xF2, 0x2C, 0x14, 0xE9, 0x3F, 0x7E, 0x8E, 0x73, 0xEE, 0x01,
+  0x34, 0xFC, 0x59, 0xC5, 0x4F, 0x6C, 0xBE, 0xBE, 0x96, 0x75, 0x6C, 0xA8, 0x66, 0x2E, 0xA5, 0x53,
+  0x60, 0xDC, 0x70, 0x6A, 0x8C, 0x0E, 0xF7, 0xDD, 0x87, 0x3F, 0x17, 0x01, 0x83, 0x3A, 0xA2, 0x93,
+  0x47, 0x2F, 0x42, 0x06, 0x4E, 0x64, 0xDC, 0x07, 0xB9, 0x09, 0xB5, 0x69, 0x67, 0x78, 0xA6, 0x58,
+  0x5C, 0xEC, 0x7E, 0x2A, 0x52, 0xEF, 0xDC, 0x68, 0x18, 0x50, 0xF0, 0xD0, 0xA1, 0x84, 0xF4, 0x2E,
+  0xE0, 0x72, 0x5E, 0x00, 0x67, 0x02, 0x4E, 0x42, 0xA1, 0x42, 0xF6, 0x91, 0xB8, 0xC4, 0xAB, 0xB4,
+  0x58, 0xFA, 0xFD, 0x7B, 0x47, 0xE9, 0x85, 0xFE, 0x36, 0xE3, 0x0F, 0xA6, 0x40, 0x07, 0x1D, 0x25,
+  0x3B, 0x49, 0xCF, 0x1A, 0xB2, 0x37, 0xD2, 0x6D, 0x9B, 0xCF, 0x05, 0x6C, 0xA6, 0x02, 0xB4, 0x2C,
+  0xC6, 0xF3, 0x1A, 0x57, 0xF5, 0x1A, 0xED, 0x8E, 0x3E, 0xC7, 0x9C, 0xE8, 0xDF, 0x6C, 0x53, 0xA8,
+  0xD0, 0x26, 0xFF, 0x5E, 0x73, 0x91, 0x62, 0xC3, 0xCB, 0x3A, 0xEE, 0x2B, 0xF7, 0x1B, 0x80, 0x31,
+  0xD6, 0xFB, 0x1A, 0x05, 0x36, 0x25, 0xCB, 0xB2, 0x07, 0xC8, 0x37, 0x6D, 0x60, 0x63, 0xC0, 0x96,
+  0xEF, 0x41, 0xF9, 0x04, 0x7E, 0xFB, 0x87, 0x8D, 0x9B, 0x2F, 0x9B, 0x17, 0xA8, 0x70, 0xB0, 0x7D,
+  0x49, 0xC3, 0xCA, 0x85, 0x83, 0x32, 0xA8, 0xA2, 0x99, 0x30, 0xEC, 0x57, 0x3E, 0xC4, 0x28, 0xB6,
+  0x42, 0xBB, 0x13, 0xE2, 0x7A, 0xD1, 0x44, 0x19, 0x4F, 0x37, 0xC9, 0x24, 0x66, 0x5D, 0x68, 0x8E,
+  0x81, 0x4D, 0x1D, 0x72, 0x63, 0x85, 0xA4, 0x08, 0xC4, 0x45, 0x09, 0x09, 0x34, 0x5D, 0xA7, 0xBA,
+  0x89, 0x1A, 0x96, 0x9C, 0xB7, 0x78, 0x18, 0x0E, 0xEF, 0xCA, 0x43, 0x84, 0xCE, 0x3B, 0x59, 0xFA,
+  0x25, 0x84, 0x01, 0x1B, 0x05, 0x78, 0x7B, 0x6F, 0x7A, 0xBE, 0x90, 0x89, 0xE9, 0x68, 0x25, 0xF0,
+  0x67, 0x1F, 0xC3, 0xE3, 0x29, 0x9A, 0x50, 0xD2, 0x2A, 0x90, 0x27, 0x51, 0x70, 0xFE, 0xA5, 0xC0,
+  0x26, 0x50, 0xD6, 0xD3, 0x8E, 0xCB, 0x59, 0xE7, 0x44, 0x02, 0x7F, 0xA6, 0x9C, 0x14, 0x25, 0xCF,
+  0x84, 0x3E, 0x75, 0x29, 0x05, 0x81, 0xC9, 0xB3, 0xE1, 0x68, 0x4C, 0x52, 0xE5, 0x8F, 0x06, 0x37,
+  0x6B, 0xDA, 0xD7, 0xFE, 0x20, 0xA5, 0xBD, 0x77, 0x03, 0x72, 0xA4, 0x5C, 0xC1, 0xB5, 0xFA, 0xBA,
+  0x70, 0x34, 0xDF, 0xB5, 0x9D, 0xFB, 0x93, 0xD0, 0xE0, 0x59, 0x3B, 0x8A, 0xFE, 0x64, 0xE8, 0xAC,
+  0x0B, 0x8A, 0x3F, 0x5F, 0x12, 0x93, 0x4A, 0x4D, 0x64, 0xF5, 0xDC, 0x87, 0xAA, 0xF8, 0xA0, 0x78,
+  0xB2, 0x4D, 0x76, 0x5F, 0x04, 0x05, 0xB0, 0x0A, 0x10, 0x25, 0xE5, 0x59, 0xED, 0x73, 0xDB, 0xF0,
+  0xF1, 0x3A, 0x52, 0xFA, 0xD1, 0xDC, 0x99, 0x5A, 0xCC, 0x6E, 0x2C, 0x1C, 0xFA, 0x86, 0x94, 0x2E,
+  0x2C, 0xD3, 0x09, 0x1C, 0xCA, 0x1E, 0x20, 0xDB, 0x81, 0xD3, 0x7C, 0xA8, 0xDD, 0x71, 0xA6, 0x94,
+  0xC6, 0xD0, 0xFE, 0x5C, 0x2D, 0x15, 0xC7, 0x26, 0x1F, 0xF3, 0x73, 0xB5, 0x6A, 0x75, 0x1F, 0x7D,
+  0xC1, 0x47, 0xCF, 0xC9, 0xAC, 0x25, 0x57, 0x54, 0xC9, 0xAE, 0x95, 0x68, 0x9A, 0xBD, 0x39, 0x09,
+  0x78, 0xA5, 0x2C, 0x5B, 0xBE, 0x6C, 0xBE, 0x4E, 0xA6, 0xAD, 0x9C, 0x15, 0x3D, 0xC1, 0xB6, 0x15,
+  0xB8, 0x16, 0x90, 0xEC, 0x17, 0x7E, 0x7F, 0xA1, 0x12, 0x6D, 0x9F, 0x99, 0x77, 0x25, 0xCD, 0x5B,
+  0xB3, 0xF9, 0xEB, 0xC4, 0x00, 0xB5, 0x23, 0x05, 0xFC, 0xF0, 0x41, 0x91, 0x5A, 0x82, 0x48, 0xE2,
+  0xA4, 0xD7, 0x8B, 0x1F, 0x61, 0xB3, 0xBF, 0x02, 0x1F, 0x82, 0x5D, 0xFB, 0xE6, 0x0E, 0x40, 0xF8,
+  0xE1, 0xD3, 0x35, 0xDB, 0xBB, 0x66, 0xA3, 0xF9, 0x14, 0x9B, 0x46, 0x8E, 0xD6, 0xAF, 0x59, 0xE6,
+  0xC0, 0x06, 0xB0, 0xE3, 0x15, 0x99, 0x97, 0x77, 0x9C, 0xCD, 0x12, 0x2F, 0x4E, 0x11, 0x74, 0x71,
+  0x38, 0x15, 0x51, 0x46, 0xF3, 0xF9, 0x79, 0x24, 0x6B, 0xE8, 0xA9, 0xFE, 0xF1, 0x9A, 0x91, 0xC6,
+  0x24, 0xAB, 0x16, 0x7C, 0x11, 0x6D, 0xC8, 0x18, 0x71, 0x97, 0x9C, 0x58, 0x4A, 0x4E, 0x27, 0x2A,
+  0x90, 0x05, 0x67, 0x08, 0xE8, 0x8D, 0xCC, 0xEC, 0x33, 0xAC, 0xF2, 0x16, 0x65, 0x82, 0x07, 0x79,
+  0x75, 0x9C, 0xFA, 0x42, 0xE5, 0x93, 0xF2, 0x95, 0x9A, 0xBA, 0xB6, 0xB9, 0x62, 0x63, 0x32, 0x59,
+  0xB8, 0x90, 0x70, 0xC3, 0x51, 0x28, 0x93, 0xE2, 0x57, 0xAE, 0x2C, 0x34, 0x57, 0x2D, 0xEE, 0xE6,
+  0x74, 0x4C, 0x92, 0xC7, 0xE4, 0x54, 0x74, 0xC2, 0xE1, 0x1C, 0x1F, 0x63, 0xC1, 0xF2, 0x54, 0xB3,
+  0xF8, 0x54, 0x56, 0x24, 0xEC, 0xD0, 0xDA, 0x23, 0x1C, 0xC3, 0x43, 0x45, 0x33, 0x6D, 0xA9, 0x51,
+  0x01, 0xF6, 0x61, 0xDE, 0x95, 0x3E, 0xD7, 0x44, 0x80, 0x49, 0xC4, 0x80, 0x3A, 0xD8, 0x48, 0x7B,
+  0x64, 0xCA, 0xB8, 0xEB, 0x0B, 0x59, 0x36, 0xF6, 0x0B, 0x7C, 0xF4, 0x38, 0xDA, 0x2E, 0x38, 0x9E,
+  0x52, 0x84, 0x9A, 0x7D, 0x93, 0x5B, 0x06, 0xC3, 0x88, 0xB9, 0x67, 0x64, 0xB5, 0x98, 0xCE, 0xDE,
+  0xBC, 0x3C, 0x05, 0x20, 0xC9, 0x2D, 0x65, 0x81, 0x01, 0xF3, 0xEE, 0x13, 0x17, 0x09, 0xC6, 0x57,
+  0xBC, 0xF2, 0x76, 0x21, 0xCE, 0x9A, 0xEE, 0x7E, 0xBE, 0x7C, 0x75, 0x90, 0xE8, 0x1D, 0xB9, 0xEA,
+  0x37, 0xD7, 0xA0, 0x5A, 0x1A, 0x0E, 0xBB, 0xDB, 0x6D, 0xB4, 0xF6, 0x1A, 0xAD, 0xFD, 0xA2, 0x1C,
+  0x55, 0xC2, 0xE5, 0xE8, 0x83, 0xEB, 0x39, 0x03, 0x32, 0xAA, 0xC5, 0xF9, 0x85, 0xEC, 0xB6, 0xA3,
+  0xBE, 0x3A, 0xD1, 0xBC, 0x88, 0x94, 0x5A, 0xED, 0x1A, 0x20, 0xE4, 0x03, 0xFC, 0xD1, 0x6C, 0x16,
+  0x43, 0x7A, 0x05, 0xE1, 0x7B, 0xD3, 0x10, 0xC3, 0xC3, 0xDD, 0x66, 0x93, 0xCC, 0xA8, 0xC0, 0x83,
+  0x54, 0xE7, 0x85, 0xF5, 0xCB, 0xEC, 0xB9, 0xCD, 0x50, 0x33, 0x77, 0xDF, 0xFE, 0x73, 0x01, 0x4D,
+  0x53, 0xC1, 0x61, 0x21, 0x1E, 0x47, 0x45, 0x0F, 0xEC, 0x24, 0x27, 0x4D, 0xEB, 0xF9, 0x25, 0xE2,
+  0x71, 0xB1, 0xA6, 0x60, 0x4D, 0x5D, 0xE2, 0xF5, 0x80, 0x98, 0xE9, 0x23, 0x09, 0x9A, 0x41, 0x6F,
+  0x64, 0x8A, 0x10, 0x73, 0x2E, 0xE8, 0xB9, 0x63, 0xCB, 0x0A, 0x02, 0x71, 0xD0, 0xA2, 0x00, 0xF5,
+  0x5D, 0x33, 0x05, 0xDA, 0x06, 0x76, 0x66, 0x0F, 0x2C, 0x5F, 0x66, 0x27, 0x97, 0x5F, 0x5E, 0x55,
+  0xF6, 0x4D, 0x98, 0x73, 0x01, 0x6E, 0x45, 0x0C, 0xC0, 0x47, 0x03, 0xDB, 0x14, 0xAF, 0xFD, 0x31,
+  0x93, 0xED, 0x3D, 0x32, 0x29, 0x1D, 0x92, 0x95, 0x17, 0x04, 0x6B, 0x1B, 0xC9, 0x90, 0x8A, 0x68,
+  0x52, 0x0E, 0x3C, 0xB2, 0x66, 0x85, 0x0E, 0xAB, 0xCC, 0x1D, 0x02, 0x1B, 0xC0, 0xEB, 0xB9, 0xCE,
+  0xE9, 0xAA, 0x9C, 0x57, 0x67, 0x16, 0xA1, 0x9F, 0xA0, 0x08, 0x5C, 0x59, 0x15, 0x83, 0xCB, 0x2C,
+  0xE4, 0x9E, 0xCA, 0x61, 0x23, 0x81, 0x1E, 0xB3, 0xF7, 0xDF, 0x38, 0xD2, 0x19, 0x35, 0x70, 0x9F,
+  0x72, 0x63, 0x9D, 0xEC, 0x29, 0x12, 0xDB, 0x2F, 0x61, 0x17, 0xB1, 0x14, 0x51, 0x57, 0x54, 0x29,
+  0x30, 0x93, 0xEA, 0x34, 0x63, 0xCA, 0x73, 0xBA, 0xCF, 0xA6, 0x0E, 0xAB, 0xDE, 0x68, 0x9F, 0x68,
+  0x3E, 0xAF, 0x58, 0xDB, 0xEA, 0xE8, 0xCB, 0x6D, 0x67, 0xFD, 0x6E, 0xC2, 0x3B, 0x81, 0xBA, 0x7C,
+  0x96, 0x7B, 0x68, 0xDA, 0x58, 0x3C, 0xD9, 0xA1, 0x3B, 0x6B, 0x2A, 0xF7, 0x80, 0x1A, 0xC0, 0xAD,
+  0x8C, 0xBD, 0x8E, 0xEE, 0x5B, 0x3A, 0x74, 0xDF, 0xF2, 0xD5, 0xC6, 0x2F, 0x6F, 0xB8, 0xCF, 0xC5,
+  0xE6, 0xA6, 0x96, 0x9B, 0xB7, 0x67, 0x69, 0x94, 0x79, 0x17, 0x53, 0xE1, 0x02, 0x28, 0xBB, 0x67,
+  0xEC, 0x14, 0x54, 0xEE, 0x65, 0x38, 0x96, 0xE6, 0x27, 0xFD, 0x9D, 0xBB, 0x8B, 0xA8, 0xC6, 0x46,
+  0xA6, 0xEE, 0x39, 0xB0, 0x48, 0x32, 0x2E, 0x90, 0xB2, 0x25, 0x88, 0x29, 0x6F, 0x93, 0x91, 0x6F,
+  0x04, 0xFC, 0x4C, 0x1B, 0xF0, 0x71, 0xD2, 0x42, 0x0B, 0xE6, 0x98, 0x30, 0xE9, 0x15, 0x2B, 0xC9,
+  0xBD, 0x86, 0x35, 0x6E, 0xE2, 0x20, 0xCF, 0x73, 0x69, 0x58, 0xAC, 0xCB, 0x26, 0xC8, 0x77, 0x30,
+  0x0F, 0xCC, 0x88, 0xFC, 0xEB, 0xC8, 0xB4, 0x03, 0xC1, 0xFD, 0x0C, 0xA7, 0xCD, 0xBD, 0x94, 0xD3,
+  0xE6, 0xDB, 0x09, 0xA7, 0xCD, 0x6B, 0xED, 0x01, 0x73, 0x5B, 0xE7, 0x47, 0x74, 0x62, 0x85, 0x8E,
+  0x2D, 0x18, 0xE9, 0xCD, 0xAA, 0x22, 0x3A, 0xBF, 0x62, 0xA9, 0x77, 0xE4, 0x59, 0xB0, 0x72, 0xC4,
+  0x28, 0x59, 0x1A, 0x06, 0x95, 0x7F, 0x7D, 0x68, 0xF2, 0x3B, 0x44, 0x3E, 0x4B, 0x6E, 0x8C, 0x0A,
+  0x73, 0xE6, 0x1A, 0x3A, 0x8B, 0xDE, 0xAA, 0x7A, 0xDD, 0xC1, 0x38, 0xDF, 0xB4, 0x65, 0x82, 0x98,
+  0x85, 0xEF, 0x59, 0x0E, 0xFC, 0x00, 0xA9, 0x6F, 0x24, 0x0D, 0xDA, 0x36, 0xCE, 0x69, 0x1B, 0xF5,
+  0x37, 0x61, 0xEA, 0xCC, 0x0F, 0xBC, 0x3B, 0x2E, 0xCB, 0xD3, 0x6B, 0xD0, 0x99, 0x87, 0xFA, 0x5F,
+  0x58, 0x22, 0x02, 0x23, 0x49, 0x61, 0xF4, 0xB8, 0x2B, 0xEA, 0x1E, 0xC0, 0x5A, 0x6D, 0x44, 0x83,
+  0x5D, 0xE1, 0x08, 0xF0, 0x10, 0x1B, 0xB7, 0xDF, 0xBD, 0x1B, 0x7F, 0xF3, 0x7C, 0x9C, 0x55, 0x0B,
+  0x16, 0xAD, 0x20, 0x2D, 0xCA, 0x1F, 0x01, 0x5B, 0x50, 0x55, 0x1E, 0x27, 0xD1, 0xB6, 0x90, 0x91,
+  0x64, 0xB2, 0xDD, 0x13, 0x33, 0xCD, 0x2C, 0x83, 0x3A, 0x55, 0x69, 0x8D, 0x65, 0xD0, 0xE7, 0x95,
+  0xAA, 0x5D, 0x42, 0x14, 0xBA, 0x50, 0x02, 0x04, 0x5A, 0x4A, 0x52, 0x41, 0x92, 0x06, 0x35, 0x32,
+  0xCE, 0x21, 0x7D, 0x86, 0xDC, 0x5F, 0xF7, 0xB8, 0x86, 0x11, 0x66, 0x59, 0xA4, 0x48, 0xDF, 0x21,
+  0x29, 0x4A, 0xD7, 0x3A, 0x8B, 0xCE, 0x0A, 0x15, 0x56, 0xA0, 0x49, 0xFA, 0x94, 0x74, 0xF8, 0xCC,
+  0x49, 0x6D, 0x81, 0xB4, 0x96, 0x42, 0xC2, 0x12, 0xD4, 0x96, 0x6C, 0xB9, 0x50, 0x7A, 0xC3, 0x41,
+  0x61, 0xE7, 0xA5, 0xCE, 0xAB, 0x86, 0x28, 0xE8, 0x07, 0x56, 0xBD, 0x26, 0x4C, 0x7A, 0xC0, 0x18,
+  0xB5, 0x27, 0x6C, 0x3F, 0x24, 0xD5, 0x91, 0x1A, 0x8A, 0x3A, 0xCB, 0xA1, 0x44, 0x99, 0x42, 0xC8,
+  0x85, 0xFF, 0x62, 0x4B, 0xFB, 0x02, 0xCD, 0xA7, 0x5F, 0x4C, 0x74, 0x2F, 0xCE, 0x7F, 0x85, 0x91,
+  0x1A, 0x41, 0xEF, 0xA1, 0x38, 0x8E, 0x15, 0x61, 0xD5, 0xCF, 0xCF, 0x4B, 0x0F, 0x8E, 0x68, 0x0F,
+  0xAD, 0x6C, 0x00, 0xAE, 0x39, 0x99, 0xEF, 0x12, 0x26, 0xBC, 0x58, 0xF7, 0x68, 0xBF, 0xEB, 0xE2,
+  0x47, 0xBA, 0x11, 0x81, 0x07, 0xAB, 0xF6, 0xC6, 0x3B, 0xB5, 0x1C, 0x74, 0x8E, 0x23, 0x5B, 0x48,
+  0xE0, 0x51, 0xA9, 0x60, 0x64, 0xB6, 0x74, 0x01, 0x8F, 0xF3, 0xF4, 0x15, 0x07, 0x76, 0x6C, 0xDE,
+  0xF8, 0x43, 0x17, 0x94, 0x69, 0xA5, 0x88, 0x78, 0x5E, 0xD5, 0x65, 0x8E, 0x6F, 0x3A, 0xE9, 0x5A,
+  0x32, 0xF0, 0x68, 0x29, 0x05, 0x62, 0x62, 0x3A, 0x48, 0x6C, 0x16, 0x45, 0x1D, 0x43, 0xE6, 0x7F,
+  0x3F, 0x17, 0x0F, 0x17, 0x44, 0x84, 0x3C, 0xC6, 0xB0, 0x40, 0x5B, 0x63, 0x37, 0x9C, 0x8A, 0x58,
+  0xEB, 0x58, 0x02, 0xCB, 0xA7, 0xEA, 0xD0, 0xD2, 0x80, 0x47, 0xAE, 0xF2, 0xAD, 0x66, 0x73, 0x7F,
+  0x07, 0x7E, 0x1C, 0x44, 0x02, 0x82, 0x66, 0x18, 0xB2, 0x42, 0x2A, 0xF6, 0x01, 0xC8, 0xFC, 0x0C,
+  0x0A, 0x3C, 0xA6, 0xF6, 0x68, 0x2D, 0xAA, 0x3B, 0x8E, 0xA7, 0x83, 0x75, 0x72, 0x3C, 0x40, 0xAA,
+  0x4A, 0x12, 0x29, 0x74, 0x53, 0x88, 0xAB, 0xA8, 0xB1, 0x58, 0x38, 0x18, 0xDB, 0x2A, 0x52, 0xCE,
+  0x71, 0x01, 0x8C, 0x33, 0x89, 0xB0, 0x48, 0xAB, 0xA1, 0x9E, 0x08, 0xB2, 0x68, 0x51, 0xFC, 0x4D,
+  0x9A, 0x32, 0xD0, 0x26, 0x66, 0xAA, 0x75, 0xA9, 0xBC, 0x42, 0xD0, 0xD7, 0x48, 0xB3, 0x1F, 0x55,
+  0x41, 0xF5, 0xC2, 0xE2, 0xE7, 0x42, 0xF9, 0x6F, 0x51, 0x1E, 0x5C, 0x58, 0x94, 0x78, 0x8A, 0x34,
+  0x9A, 0x81, 0x7E, 0x85, 0xAF, 0x95, 0x26, 0xDB, 0xAE, 0x69, 0xF8, 0x3A, 0x99, 0xAF, 0xC3, 0x08,
+  0x9E, 0x9B, 0x99, 0x71, 0x62, 0xAC, 0x44, 0x4E, 0xD2, 0xC9, 0x2E, 0x6B, 0x47, 0xE3, 0x40, 0xA1,
+  0x8E, 0xE7, 0x08, 0x07, 0xC8, 0xB4, 0xBC, 0xF1, 0x7D, 0xB2, 0xDB, 0x29, 0x2B, 0x98, 0x93, 0x11,
+  0xBE, 0xDB, 0xE9, 0x54, 0x36, 0xC1, 0x5F, 0x9D, 0x57, 0xB5, 0xC0, 0x17, 0x0A, 0x65, 0x5B, 0xB6,
+  0x05, 0xFE, 0x34, 0x8A, 0x69, 0xC0, 0x70, 0x30, 0xE4, 0x46, 0xA7, 0xD8, 0xB3, 0xA9, 0xC7, 0x83,
+  0xC6, 0xB8, 0x87, 0x37, 0x2B, 0x18, 0x69, 0x8B, 0x9B, 0x4C, 0x2A, 0xC8, 0x16, 0xC0, 0xF0, 0x4D,
+  0x3C, 0xB2, 0xEC, 0xCA, 0xB9, 0xAF, 0x9F, 0xDB, 0xDC, 0x1B, 0x3C, 0xB2, 0x2D, 0x00, 0xD2, 0x1B,
+  0x0A, 0x59, 0x13, 0x81, 0x67, 0xC7, 0xDE, 0x71, 0xFA, 0xFD, 0x98, 0x02, 0x8D, 0xB1, 0x68, 0x9A,
+  0x0F, 0x52, 0xA2, 0xE6, 0x59, 0x8F, 0x64, 0xB1, 0xFD, 0x74, 0xD9, 0x8D, 0xD7, 0x23, 0x27, 0x15,
+  0x1D, 0x5F, 0x7B, 0xB1, 0xF0, 0x47, 0xC1, 0x02, 0x9A, 0x2E, 0x1C, 0xEF, 0x51, 0xC1, 0x30, 0x16,
+  0xE5, 0x20, 0x9F, 0x87, 0xC0, 0xF5, 0x97, 0x61, 0xF2, 0x4F, 0xCF, 0xA5, 0x88, 0x00, 0x38, 0x5F,
+  0xE4, 0x4D, 0xAF, 0x5A, 0x1E, 0x8F, 0xDC, 0xC3, 0xAB, 0x23, 0x3C, 0x04, 0xB1, 0xC4, 0x3D, 0x06,
+  0x00, 0x51, 0x0A, 0x03, 0xD2, 0x4D, 0x3C, 0xBC, 0x30, 0xA2, 0x43, 0x36, 0x0A, 0xC0, 0xC4, 0xB2,
+  0x7B, 0x26, 0x65, 0x9B, 0x74, 0x40, 0x75, 0x71, 0xF4, 0x1F, 0x51, 0x8B, 0x06, 0x9C, 0xC4, 0x8F,
+  0xCA, 0x12, 0x64, 0xE3, 0x65, 0x0A, 0xDE, 0x0E, 0x8F, 0x34, 0x93, 0x7C, 0x70, 0xC8, 0x92, 0x94,
+  0x19, 0x07, 0x31, 0x1E, 0x63, 0x81, 0x31, 0x0F, 0x6B, 0x9B, 0xCA, 0x22, 0xCF, 0x7F, 0x7E, 0xBA,
+  0x36, 0xDD, 0x4F, 0xE3, 0x53, 0x95, 0x58, 0x86, 0x48, 0x79, 0xA6, 0x5D, 0xB8, 0x75, 0x52, 0x48,
+  0x9A, 0x88, 0x63, 0xB8, 0x91, 0x1B, 0xE5, 0x84, 0xD4, 0x33, 0xB3, 0xE3, 0x31, 0x65, 0xE5, 0x29,
+  0xDE, 0xE1, 0x8D, 0x7B, 0x72, 0xE4, 0x27, 0x5C, 0xB9, 0xBF, 0xCA, 0x67, 0x1A, 0x54, 0x60, 0x4C,
+  0x32, 0x0A, 0x83, 0xF7, 0x82, 0xC1, 0x2F, 0xE4, 0x9B, 0x74, 0x86, 0x7F, 0x32, 0xFC, 0x7B, 0xB6,
+  0x33, 0xEB, 0x1C, 0xB4, 0xD7, 0x32, 0x0E, 0x7E, 0x08, 0xF6, 0x33, 0x69, 0x76, 0x82, 0x39, 0xCA,
+  0x3F, 0xE4, 0x55, 0x2E, 0x3B, 0x75, 0x02, 0xA4, 0xCB, 0x65, 0xB0, 0xAF, 0xC4, 0x34, 0x96, 0xCF,
+  0xBB, 0x8E, 0x19, 0x09, 0xA5, 0x4C, 0x8A, 0xAE, 0xD9, 0x4A, 0xA8, 0xB2, 0xCD, 0x01, 0xAF, 0x32,
+  0xC2, 0xA8, 0x43, 0x72, 0xFC, 0x93, 0x4D, 0x40, 0xDE, 0xB7, 0x81, 0xEE, 0x29, 0xFE, 0xB0, 0x0E,
+  0x7F, 0x48, 0xBE, 0xA3, 0x3F, 0x02, 0x03, 0xF0, 0xA9, 0xB0, 0xA9, 0xF4, 0xF5, 0x23, 0x7C, 0x40,
+  0x99, 0xB5, 0x7C, 0x2C, 0xC3, 0xE6, 0xD6, 0x6A, 0x3C, 0x07, 0x38, 0x79, 0x36, 0x21, 0xD4, 0xEA,
+  0x42, 0x0F, 0x08, 0xD7, 0xD4, 0x44, 0xC2, 0x88, 0x81, 0x39, 0x87, 0x23, 0x9C, 0xA7, 0xBA, 0x2F,
+  0x15, 0x90, 0x90, 0x6A, 0xFC, 0x6A, 0x86, 0x47, 0x5E, 0x01, 0x9F, 0xC7, 0x14, 0xC8, 0x53, 0xD1,
+  0x0B, 0x11, 0x1C, 0xD6, 0x29, 0x7E, 0x21, 0x05, 0x80, 0x75, 0x4F, 0x38, 0xAE, 0x66, 0x7B, 0xF6,
+  0xF9, 0xB4, 0x03, 0x82, 0x5F, 0x08, 0xEE, 0x00, 0xED, 0xB0, 0xF8, 0x6C, 0xC1, 0x4C, 0x33, 0x3E,
+  0x7A, 0xB1, 0x23, 0xD8, 0x18, 0xEA, 0x6E, 0x38, 0x4D, 0x3C, 0x78, 0x97, 0xCC, 0x61, 0xE3, 0x66,
+  0xC1, 0x08, 0x5A, 0xC4, 0x67, 0x51, 0xAD, 0xC0, 0x75, 0x34, 0x42, 0x46, 0xA8, 0x72, 0x3A, 0x31,
+  0x74, 0xB5, 0x7E, 0x90, 0xD5, 0x14, 0x8E, 0x65, 0x00, 0xF8, 0x36, 0x3B, 0xFB, 0xD2, 0xDD, 0x66,
+  0x9F, 0x40, 0x3F, 0xBA, 0x07, 0x4E, 0x8C, 0x32, 0x64, 0x37, 0xE8, 0x61, 0x4F, 0xD7, 0x9A, 0xFF,
+  0x63, 0x83, 0x7D, 0x49, 0xF2, 0x5D, 0xF6, 0x08, 0x14, 0x97, 0x9D, 0x64, 0x0A, 0xB0, 0x10, 0x90,
+  0x8B, 0x4E, 0x05, 0x16, 0xA2, 0xDB, 0x65, 0x27, 0x51, 0xDE, 0x66, 0x7F, 0xC2, 0x0E, 0x78, 0x91,
+  0xDA, 0xB0, 0x55, 0xF9, 0x85, 0x00, 0xB6, 0x21, 0x4A, 0x91, 0x1B, 0x92, 0x3A, 0x5D, 0xB3, 0xD0,
+  0x8E, 0x2C, 0x74, 0x69, 0x24, 0x7B, 0xCE, 0xB9, 0xC3, 0xF6, 0xE7, 0x9C, 0x35, 0x2C, 0x86, 0x18,
+  0x85, 0xED, 0x76, 0xE3, 0x36, 0xAB, 0xB1, 0xD7, 0xCD, 0x9D, 0x2A, 0x80, 0x27, 0xE5, 0x90, 0x05,
+  0xBC, 0xB1, 0x09, 0x94, 0x80, 0x0B, 0x79, 0x41, 0xFE, 0xD2, 0xC8, 0x5F, 0x0C, 0x6C, 0x29, 0xEC,
+  0x87, 0x46, 0xCF, 0x04, 0xFD, 0xD5, 0x69, 0x9C, 0x43, 0x02, 0xEA, 0xAD, 0x4D, 0x20, 0x83, 0x70,
+  0x41, 0x2F, 0xA4, 0x50, 0x9A, 0x14, 0x8A, 0x83, 0x2E, 0x45, 0x0E, 0xAA, 0xE1, 0x33, 0x21, 0x09,
+  0x29, 0x94, 0xE6, 0x50, 0x44, 0x4C, 0x72, 0xDD, 0x04, 0xAA, 0xF0, 0xE5, 0x74, 0x47, 0x30, 0xDD,
+  0x17, 0xCA, 0x28, 0x4F, 0x19, 0x0A, 0x25, 0x4A, 0x13, 0x86, 0x6C, 0xB7, 0x86, 0x37, 0x9B, 0xB3,
+  0x55, 0x96, 0xA7, 0x94, 0xD5, 0x0C, 0x97, 0xFE, 0x45, 0xB8, 0x89, 0xBC, 0xC3, 0xD9, 0x64, 0x14,
+  0xA1, 0x2B, 0xC6, 0xA6, 0xE4, 0xA7, 0x1B, 0x2E, 0x9F, 0x6A, 0x78, 0x62, 0x80, 0x48, 0xCF, 0x44,
+  0xBA, 0x69, 0xB5, 0x77, 0xD7, 0xD7, 0x33, 0xA5, 0x7C, 0x29, 0xD1, 0xFD, 0xDA, 0x7C, 0x5C, 0xBC,
+  0x93, 0xC8, 0x1F, 0xEE, 0x64, 0x21, 0x3F, 0xD3, 0x54, 0xA3, 0xC5, 0x15, 0x0F, 0x9D, 0x8F, 0x71,
+  0x13, 0xB1, 0x62, 0xD5, 0x76, 0x4D, 0x5B, 0xB8, 0x0B, 0x32, 0x69, 0xC2, 0xEA, 0x2A, 0x59, 0x33,
+  0xC7, 0xED, 0x9E, 0x68, 0xC8, 0x1C, 0x83, 0x37, 0x65, 0xC3, 0xC4, 0x35, 0xAF, 0x93, 0xF9, 0x72,
+  0xBC, 0xE2, 0x85, 0x58, 0x2E, 0xCB, 0x32, 0x51, 0x1B, 0xA9, 0xC7, 0xB2, 0xCE, 0x1F, 0x5C, 0x80,
+  0xAD, 0x9D, 0xC7, 0x44, 0xF1, 0x55, 0x16, 0xBE, 0x7B, 0xB8, 0x64, 0x8F, 0x41, 0x19, 0x02, 0x20,
+  0x6F, 0x55, 0x94, 0x17, 0xEB, 0x48, 0x7B, 0x30, 0x47, 0xC1, 0x28, 0xF2, 0xA7, 0x62, 0x3D, 0x2E,
+  0xEE, 0x39, 0xB7, 0x41, 0x0A, 0xA1, 0x6B, 0x3A, 0xF3, 0x8E, 0x47, 0x11, 0x65, 0x0D, 0x76, 0xDE,
+  0x18, 0x34, 0x54, 0xF9, 0x56, 0xC9, 0x97, 0xC9, 0x56, 0x8A, 0x57, 0x32, 0x07, 0x78, 0x7D, 0xEC,
+  0x8F, 0xAF, 0x98, 0xB1, 0x2B, 0x8C, 0x09, 0xF8, 0x3F, 0x07, 0xEC, 0x23, 0x3B, 0xD8, 0xF3, 0x5F,
+  0x58, 0xF7, 0x34, 0xD6, 0x9D, 0xC6, 0x9F, 0x42, 0xAC, 0x3B, 0xD5, 0x68, 0x79, 0xAC, 0x7B, 0x6E,
+  0x24, 0xE3, 0x71, 0xDD, 0xC4, 0x8C, 0x41, 0x79, 0xF4, 0x12, 0xBE, 0xB7, 0x06, 0xB4, 0xE2, 0x86,
+  0x73, 0x09, 0x6B, 0x19, 0xAA, 0xF8, 0x5D, 0xDD, 0x72, 0xF4, 0x1F, 0xB3, 0x88, 0xA3, 0xDE, 0x6E,
+  0x8E, 0xC9, 0x63, 0xDC, 0x0B, 0xD1, 0x07, 0x7E, 0xF7, 0x91, 0xFD, 0x67, 0x2B, 0x78, 0x21, 0x91,
+  0x99, 0x24, 0x12, 0xE1, 0x4B, 0x61, 0xFA, 0x08, 0x5B, 0x6C, 0x1E, 0x71, 0xDC, 0x38, 0x8E, 0x38,
+  0xE3, 0x56, 0xAE, 0xA9, 0x07, 0xDF, 0x63, 0xF4, 0xE2, 0x1A, 0x50, 0x87, 0x70, 0xC8, 0x0B, 0x08,
+  0xEB, 0xA0, 0xD5, 0x85, 0x67, 0xBA, 0x98, 0x18, 0x55, 0x7B, 0x0C, 0xEF, 0xF4, 0xBD, 0xC8, 0xA9,
+  0x97, 0xA8, 0x05, 0x73, 0x10, 0x06, 0x7E, 0xEC, 0x1E, 0xA9, 0xF9, 0x82, 0xFD, 0x33, 0xB0, 0x7F,
+  0x8C, 0x10, 0x45, 0xB1, 0x3F, 0x6A, 0xB1, 0xA1, 0xD8, 0x0F, 0xF2, 0xAA, 0xCC, 0x28, 0x57, 0x88,
+  0x04, 0xA2, 0xB7, 0xD7, 0x48, 0xA2, 0xE2, 0x08, 0x64, 0xC0, 0x7B, 0x0B, 0x84, 0xE9, 0x3B, 0x5E,
+  0x94, 0x0E, 0x5A, 0xCD, 0xE6, 0x0B, 0x29, 0xE4, 0x92, 0xC2, 0x18, 0x3B, 0x4A, 0xD1, 0x43, 0xD4,
+  0x6C, 0x03, 0x89, 0x22, 0xC4, 0x9B, 0x4B, 0x23, 0x8F, 0x22, 0x22, 0x0C, 0xBB, 0x3C, 0x5B, 0x09,
+  0x39, 0xE8, 0x98, 0xB6, 0x84, 0xBC, 0x42, 0xCD, 0xBE, 0xA9, 0x88, 0x22, 0x85, 0xF6, 0x31, 0x84,
+  0xFF, 0xD4, 0xE9, 0x8E, 0xC3, 0x88, 0xB1, 0xAE, 0xD5, 0x50, 0xF3, 0x34, 0x1D, 0x34, 0x88, 0x3F,
+  0xAE, 0x3C, 0x94, 0x63, 0xE8, 0x4C, 0x61, 0x43, 0x61, 0x0A, 0x18, 0xB7, 0x59, 0x1C, 0xFA, 0xCF,
+  0xC9, 0xD4, 0x83, 0xE1, 0xBA, 0xEC, 0x5A, 0xB3, 0x41, 0xEB, 0xF4, 0xE6, 0x6B, 0xEC, 0x71, 0x6C,
+  0x3D, 0x4A, 0x14, 0x87, 0xA3, 0x5C, 0x99, 0x3E, 0x39, 0xE9, 0x48, 0xCF, 0x0F, 0x8B, 0xAB, 0x41,
+  0x6B, 0xD5, 0x12, 0xED, 0xCE, 0xB0, 0xF7, 0xA4, 0x4D, 0x43, 0x53, 0xCC, 0x40, 0x17, 0xF1, 0x39,
+  0x64, 0x1A, 0x82, 0x32, 0xC7, 0x98, 0x62, 0x1C, 0x4A, 0xF4, 0x56, 0xDC, 0x14, 0x94, 0x00, 0xBF,
+  0xB2, 0x02, 0xC5, 0x80, 0xB3, 0x56, 0xD6, 0xA0, 0xF8, 0x12, 0xE7, 0x66, 0x0F, 0x2A, 0x9A, 0x95,
+  0xAE, 0x7B, 0xC6, 0xBA, 0xE6, 0xEF, 0x3C, 0x2A, 0x74, 0xE3, 0x1B, 0xF8, 0x71, 0x7A, 0x90, 0x79,
+  0x93, 0x5D, 0x9F, 0x20, 0x85, 0xB1, 0x1D, 0x76, 0xE1, 0xF1, 0x78, 0x3B, 0xFC, 0xD8, 0x75, 0x81,
+  0xED, 0xCE, 0xE6, 0xB5, 0x79, 0x1D, 0xCF, 0x23, 0x09, 0x5F, 0xC2, 0xB9, 0x7A, 0xC6, 0xDA, 0xF1,
+  0x06, 0x20, 0x0A, 0x69, 0x0A, 0x51, 0x04, 0xE9, 0xA9, 0x4B, 0x77, 0x09, 0xF1, 0xDC, 0x79, 0xF2,
+  0x39, 0x70, 0x20, 0x8F, 0xFB, 0xC3, 0x99, 0x15, 0x35, 0x69, 0x4E, 0xC9, 0x18, 0x22, 0x8C, 0x96,
+  0xDA, 0xD6, 0x7C, 0xBD, 0x76, 0x84, 0x11, 0xFC, 0x95, 0xC2, 0x90, 0xA8, 0x0B, 0x83, 0x87, 0x7D,
+  0x6C, 0x47, 0x49, 0x44, 0x31, 0x36, 0xA1, 0x52, 0x8F, 0x3E, 0xEC, 0xB3, 0x9C, 0x14, 0xEE, 0xF8,
+  0xB6, 0xF4, 0x6A, 0x9E, 0x43, 0x97, 0x72, 0x92, 0xB2, 0x4F, 0x0B, 0x99, 0x43, 0xF1, 0x2E, 0xF3,
+  0x63, 0xA8, 0x30, 0x96, 0xEC, 0x30, 0xEB, 0xAC, 0x89, 0xEF, 0xDE, 0xF9, 0x83, 0xE0, 0xB6, 0x94,
+  0xBC, 0x71, 0x46, 0x1F, 0x6B, 0x7B, 0x35, 0x46, 0x02, 0xC1, 0xD0, 0xB1, 0x0C, 0x8E, 0x39, 0xA4,
+  0x7B, 0x0F, 0x79, 0x9E, 0x90, 0x55, 0x76, 0xFE, 0x4C, 0x26, 0xB0, 0x9B, 0x3D, 0x39, 0x7C, 0x29,
+  0x9C, 0xD7, 0xDB, 0xD4, 0xBC, 0x7E, 0xFE, 0xF9, 0xFA, 0xFA, 0xEC, 0x6C, 0xDE, 0x53, 0x9B, 0x75,
+  0xE6, 0xB9, 0x49, 0xB4, 0x17, 0x9A, 0x08, 0xFC, 0x5A, 0x9A, 0x79, 0x4C, 0xCF, 0x25, 0xFC, 0x81,
+  0x52, 0xD5, 0xA6, 0xB9, 0xEB, 0x2D, 0x3E, 0x9C, 0x25, 0x18, 0x0A, 0x4F, 0x0D, 0xF1, 0xDA, 0xE2,
+  0x7D, 0xF1, 0x3A, 0x07, 0xC7, 0xC4, 0x50, 0x91, 0x0D, 0xFC, 0x91, 0xFB, 0x26, 0xE2, 0x5D, 0x91,
+  0x37, 0x8D, 0xA3, 0xC4, 0x3E, 0x8D, 0x7D, 0x67, 0xC3, 0xB5, 0x74, 0x09, 0x13, 0x8F, 0x2D, 0xAB,
+  0x36, 0xD5, 0xEF, 0xB6, 0x64, 0x6D, 0x8E, 0x18, 0x80, 0xE8, 0x28, 0xC5, 0x0D, 0x83, 0xA9, 0xCE,
+  0x72, 0xAB, 0xDD, 0x11, 0xDE, 0xFC, 0xC0, 0x68, 0x50, 0x86, 0x90, 0xF3, 0x07, 0x0A, 0x54, 0xFA,
+  0x35, 0xF4, 0x0E, 0xFD, 0xB5, 0xD9, 0x10, 0x0F, 0x62, 0xF6, 0x3C, 0xC2, 0xF6, 0xFB, 0xC4, 0xA3,
+  0x8B, 0xBC, 0x39, 0x05, 0xB8, 0x32, 0x6C, 0x14, 0x21, 0x71, 0x79, 0x26, 0x41, 0x3D, 0x7D, 0x4A,
+  0xC5, 0xC0, 0x3B, 0x65, 0x6F, 0x58, 0xFC, 0xB0, 0x2F, 0x52, 0x18, 0x64, 0x65, 0xFB, 0xD0, 0x6E,
+  0xB7, 0x9A, 0xBB, 0xAD, 0x5F, 0x9B, 0xED, 0x66, 0xAB, 0x79, 0x20, 0x73, 0xB7, 0x14, 0x01, 0x30,
+  0x34, 0x63, 0x7F, 0x59, 0xE4, 0x66, 0x4C, 0xCC, 0xEB, 0x0F, 0xB7, 0x1F, 0xED, 0xE6, 0xFB, 0xE2,
+  0xFB, 0xB1, 0xD7, 0x7C, 0xB7, 0xAC, 0xFD, 0x50, 0xF3, 0xDA, 0x88, 0xFD, 0x80, 0x6F, 0xF0, 0x30,
+  0x38, 0x9A, 0x71, 0x7A, 0x14, 0xDA, 0x48, 0x79, 0x14, 0x15, 0xD8, 0xCA, 0xD9, 0x57, 0xE2, 0xB5,
+  0xB1, 0xF6, 0x14, 0x03, 0xC0, 0x19, 0xD6, 0xBF, 0x22, 0x76, 0x2C, 0xFF, 0x2A, 0x96, 0xA2, 0xA7,
+  0xE0, 0x5E, 0xCF, 0xF3, 0xAD, 0x2A, 0x6B, 0x03, 0x15, 0x06, 0x13, 0x07, 0xD3, 0xEA, 0xD4, 0xDF,
+  0xF3, 0x58, 0x5F, 0x81, 0x2D, 0x9F, 0xEE, 0x0B, 0x34, 0xC3, 0x5A, 0x54, 0x3A, 0x3D, 0xF6, 0xD4,
+  0xD4, 0xD8, 0xF8, 0x77, 0x6B, 0x7C, 0x9E, 0xB7, 0xE2, 0xF2, 0xBC, 0x4C, 0x13, 0x8D, 0x8A, 0x57,
+  0x4E, 0x0E, 0x6C, 0x99, 0x75, 0xF9, 0x55, 0x69, 0x23, 0x4A, 0x76, 0xE6, 0x75, 0x37, 0x23, 0xD7,
+  0x7A, 0x33, 0x96, 0x6A, 0x3D, 0x37, 0x8D, 0xFA, 0xEC, 0x4C, 0xE6, 0x4A, 0x9A, 0x93, 0x8B, 0x53,
+  0xB2, 0xDC, 0x14, 0xE1, 0xAD, 0x62, 0x70, 0x9E, 0x6D, 0xA4, 0x6C, 0x19, 0xC9, 0xB7, 0x87, 0xDE,
+  0x74, 0xDD, 0x37, 0xDB, 0x56, 0x38, 0x43, 0x79, 0x0B, 0xED, 0x4E, 0x98, 0x7C, 0xC0, 0x07, 0x65,
+  0x1C, 0xFE, 0x6E, 0x91, 0xA9, 0xB0, 0xD5, 0x0E, 0x1F, 0x35, 0x67, 0xE5, 0xBF, 0x99, 0x91, 0xFD,
+  0x4B, 0xBB, 0xE3, 0x27, 0xC2, 0x9E, 0xB0, 0x90, 0xC8, 0xD4, 0x2B, 0x49, 0x52, 0xC2, 0x77, 0xA5,
+  0xAF, 0x06, 0x65, 0xF2, 0x82, 0x4F, 0x53, 0x71, 0x25, 0xE5, 0x7A, 0x32, 0x61, 0xD8, 0xC3, 0xAE,
+  0xD0, 0x88, 0xD7, 0x8A, 0x8C, 0x78, 0xB3, 0x09, 0x31, 0xD4, 0xAC, 0xE5, 0x6C, 0xAB, 0x58, 0xBC,
+  0x92, 0x3D, 0x84, 0x61, 0xCB, 0x65, 0x82, 0x99, 0xA7, 0xB9, 0x3F, 0x15, 0xD8, 0x36, 0xB9, 0x55,
+  0xA5, 0x37, 0x07, 0xAB, 0x82, 0x66, 0x6D, 0x8E, 0x13, 0x08, 0x9C, 0x6E, 0xE6, 0x26, 0x61, 0x9B,
+  0xF1, 0x26, 0x9D, 0x63, 0x5D, 0x51, 0xCD, 0x36, 0xA6, 0x6E, 0x14, 0x05, 0x10, 0x4F, 0xEE, 0x8F,
+  0xC7, 0x47, 0xCE, 0x9D, 0xB2, 0xB9, 0x46, 0xA3, 0x54, 0xD8, 0x30, 0xB5, 0x82, 0xAC, 0x0D, 0x2B,
+  0x10, 0x39, 0xEE, 0x1E, 0xFD, 0x8B, 0xDD, 0xF3, 0xDD, 0x3F, 0x17, 0xDD, 0x8E, 0xD4, 0xA3, 0xF4,
+  0x47, 0x5F, 0xF7, 0x4C, 0x57, 0x30, 0xDF, 0xD3, 0x01, 0x0F, 0x3C, 0x7D, 0x07, 0xB3, 0x20, 0x34,
+  0xFE, 0x46, 0x33, 0x90, 0x5F, 0xC9, 0x77, 0x63, 0xCD, 0x3E, 0xC4, 0x9F, 0x93, 0x08, 0xE1, 0xD8,
+  0x54, 0x80, 0xCD, 0xC1, 0x0C, 0x9B, 0x3E, 0xFB, 0xC8, 0x0C, 0x47, 0x0F, 0xD0, 0xB6, 0xDE, 0xF8,
+  0x2D, 0xE0, 0xDE, 0xA3, 0x54, 0x94, 0x1C, 0x0F, 0x54, 0xA5, 0xAD, 0xD7, 0x0D, 0x21, 0x5E, 0xBF,
+  0x89, 0x5A, 0x86, 0x6D, 0x1A, 0x20, 0x7E, 0x9C, 0x6B, 0xFA, 0x70, 0x4B, 0xB0, 0x8F, 0x47, 0xEC,
+  0xDF, 0x13, 0xF3, 0xC7, 0x5C, 0x73, 0x3D, 0xC7, 0x11, 0xBE, 0xF0, 0x34, 0xB7, 0x71, 0x2B, 0x5B,
+  0x6C, 0x89, 0x71, 0x27, 0xFF, 0xF1, 0x46, 0xCD, 0x30, 0x9C, 0x17, 0x6C, 0x82, 0x63, 0x3C, 0x02,
+  0xEF, 0xF9, 0xB0, 0x33, 0x14, 0x23, 0x60, 0xC0, 0xFF, 0x1F, 0x31, 0xCD, 0x50, 0xD8, 0x5D, 0xE7,
+  0x00
 }; ///index_html
 
 //Content of bootstrap.bundle.min.jss with gzip compression
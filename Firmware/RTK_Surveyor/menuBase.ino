@@ -135,6 +135,12 @@ void menuBase()
                 systemPrint("16) Select survey-in radio: ");
                 systemPrintf("%s\r\n", settings.ntripServer_StartAtSurveyIn ? "WiFi" : "Bluetooth");
             }
+
+            systemPrintf("17) Set RTCM message filter %d: ", serverIndex + 1);
+            systemPrintln(&settings.ntripServer_RtcmFilter[serverIndex][0]);
+
+            systemPrintf("18) Toggle NTRIP version %d: %d\r\n", serverIndex + 1,
+                         settings.ntripServer_NtripVersion[serverIndex]);
         }
         else
         {
@@ -384,6 +390,22 @@ void menuBase()
             settings.ntripServer_StartAtSurveyIn ^= 1;
             restartBase = true;
         }
+        else if ((incoming == 17) && settings.enableNtripServer == true)
+        {
+            // checkUblox runs during getString, read the filter into a local buffer
+            // so that ntripServerSendRTCM never sees a partial filter
+            char filter[sizeof(settings.ntripServer_RtcmFilter[serverIndex])];
+
+            systemPrint("Enter RTCM messages not sent to the caster (ex: 1230,1074-1077): ");
+            if (getString(filter, sizeof(filter)) == INPUT_RESPONSE_VALID)
+                strcpy(&settings.ntripServer_RtcmFilter[serverIndex][0], filter); // Applied to the next RTCM message
+        }
+        else if ((incoming == 18) && settings.enableNtripServer == true)
+        {
+            settings.ntripServer_NtripVersion[serverIndex] =
+                (settings.ntripServer_NtripVersion[serverIndex] == 2) ? 1 : 2;
+            restartBase = true;
+        }
         else if (incoming == INPUT_RESPONSE_GETNUMBER_EXIT)
             break;
         else if (incoming == INPUT_RESPONSE_GETNUMBER_TIMEOUT)
@@ -871,6 +893,8 @@ bool removeFileSD(const char *fileName)
                 }
             }
 #endif  // COMPILE_SD_MMC
+            if (removed)
+                sdDirectoryRemove(fileName);
 
             break;
         } // End Semaphore check
@@ -949,6 +973,7 @@ void recordLineToSD(const char *fileName, const char *lineData)
 
             file.println(lineData);
             file.close();
+            sdDirectoryUpdateFile(fileName);
             break;
         } // End Semaphore check
         else
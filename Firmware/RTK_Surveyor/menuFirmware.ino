@@ -483,6 +483,7 @@ void updateFromSD(const char *firmwareFileName)
                 else
                     SD_MMC.remove(firmwareFileName);
 #endif // COMPILE_SD_MMC
+                sdDirectoryRemove(firmwareFileName);
 
                 theGNSS.factoryDefault(); // Reset everything: baud rate, I2C address, update rate, everything. And save
                                           // to BBR.
@@ -107,6 +107,8 @@ void menuGNSS()
                          settings.minElev);
 
             systemPrintf("14) Minimum satellite signal level for navigation (dBHz): %d\r\n", minCNO);
+
+            systemPrintf("15) Toggle NTRIP version: %d\r\n", settings.ntripClient_NtripVersion);
         }
         else
         {
@@ -299,6 +301,11 @@ void menuGNSS()
                 restartRover = true;
             }
         }
+        else if ((incoming == 15) && settings.enableNtripClient == true)
+        {
+            settings.ntripClient_NtripVersion = (settings.ntripClient_NtripVersion == 2) ? 1 : 2;
+            restartRover = true;
+        }
         else if (incoming == INPUT_RESPONSE_GETNUMBER_EXIT)
             break;
         else if (incoming == INPUT_RESPONSE_GETNUMBER_TIMEOUT)
@@ -68,6 +68,9 @@ void menuMain()
 #else  // COMPILE_NETWORK
         systemPrintln("7) **Network Not Compiled**");
 #endif // COMPILE_NETWORK
+
+        systemPrintln("c) Configure Corrections");
+
 #ifdef COMPILE_ETHERNET
         if (HAS_ETHERNET)
         {
@@ -114,6 +117,8 @@ void menuMain()
             menuWiFi();
         else if (incoming == 7)
             menuNetwork();
+        else if (incoming == 'c')
+            menuCorrections();
         else if (incoming == 'e' && (HAS_ETHERNET))
             menuEthernet();
         else if (incoming == 'n' && (HAS_ETHERNET))
@@ -271,6 +276,7 @@ void menuUserProfiles()
                             SD_MMC.remove(settingsFileName);
                     }
 #endif // COMPILE_SD_MMC
+                    sdDirectoryRemove(settingsFileName);
                 }
 
                 recordProfileNumber(0); // Move to Profile1
@@ -372,6 +378,9 @@ void factoryReset(bool alreadyHasSemaphore)
                 SD_MMC.remove(stationCoordinateGeodeticFileName);
             }
 #endif // COMPILE_SD_MMC
+            sdDirectoryRemove(settingsFileName);
+            sdDirectoryRemove(stationCoordinateECEFFileName);
+            sdDirectoryRemove(stationCoordinateGeodeticFileName);
 
             xSemaphoreGive(sdCardSemaphore);
         } // End sdCardSemaphore
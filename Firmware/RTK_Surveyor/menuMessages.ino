@@ -1,3 +1,22 @@
+// Names of the ring buffer message priority classes
+const char * const messagePriorityName[] =
+{
+    "Low",
+    "Normal",
+    "High",
+    "Critical",
+};
+const int messagePriorityNameEntries = sizeof(messagePriorityName) / sizeof(messagePriorityName[0]);
+
+// Names of the outputs able to filter the GNSS messages, MESSAGE_FILTER_* order
+const char * const messageFilterName[] =
+{
+    "Bluetooth",
+    "SD Card",
+    "Network (PVT)",
+};
+const int messageFilterNameEntries = sizeof(messageFilterName) / sizeof(messageFilterName[0]);
+
 // Control the messages that get logged to SD
 // Control max logging time (limit to a certain number of minutes)
 // The main use case is the setup for a base station to log RAW sentences that then get post processed
@@ -26,6 +45,7 @@ void menuLog()
             if (online.logging)
             {
                 systemPrintf("Current log file name: %s\r\n", logFileName);
+                sdLogDisplayCompression();
             }
         }
         else
@@ -88,6 +108,21 @@ void menuLog()
                 systemPrintln("Disabled");
         }
 
+        if (settings.enableLogging == true)
+        {
+            systemPrint("10) Compress new log files (.ubz): ");
+            if (settings.enableLogCompression == true)
+                systemPrintln("Enabled");
+            else
+                systemPrintln("Disabled");
+
+            systemPrint("11) Write seek index (.idx) for new log files: ");
+            if (settings.enableLogIndex == true)
+                systemPrintln("Enabled");
+            else
+                systemPrintln("Disabled");
+        }
+
         systemPrintln("x) Exit");
 
         int incoming = getNumber(); // Returns EXIT, TIMEOUT, or long
@@ -163,6 +198,14 @@ void menuLog()
         {
             settings.enableNTPFile ^= 1;
         }
+        else if (incoming == 10 && settings.enableLogging == true)
+        {
+            settings.enableLogCompression ^= 1;
+        }
+        else if (incoming == 11 && settings.enableLogging == true)
+        {
+            settings.enableLogIndex ^= 1;
+        }
         else if (incoming == 'x')
             break;
         else if (incoming == INPUT_RESPONSE_GETNUMBER_EXIT)
@@ -203,6 +246,8 @@ void menuMessages()
         systemPrintln("11) Reset to PPP Logging Defaults (NMEAx5 + RXMx2)");
         systemPrintln("12) Turn off all messages");
         systemPrintln("13) Turn on all messages");
+        systemPrintln("14) Set message priorities");
+        systemPrintln("15) Set output message filters");
 
         systemPrintln("x) Exit");
 
@@ -273,6 +318,10 @@ void menuMessages()
             setGNSSMessageRates(settings.ubxMessageRates, 1); // Turn on all messages to report once per fix
             systemPrintln("All messages enabled");
         }
+        else if (incoming == 14)
+            menuMessagePriorities();
+        else if (incoming == 15)
+            menuMessageFilters();
         else if (incoming == INPUT_RESPONSE_GETNUMBER_EXIT)
             break;
         else if (incoming == INPUT_RESPONSE_GETNUMBER_TIMEOUT)
@@ -448,6 +497,194 @@ void inputMessageRate(uint8_t &localMessageRate, uint8_t messageNumber)
     localMessageRate = rate;
 }
 
+// Display the message priority classes and the messages dropped from the
+// ring buffer, allow the priority class of a message to be changed
+void menuMessagePriorities()
+{
+    while (1)
+    {
+        systemPrintln();
+        systemPrintln("Menu: Message Priorities");
+
+        if (settings.enableRingBufferReserves)
+            systemPrintln("When the ring buffer is 7/8 full, the lowest priority messages are dropped first");
+        else
+            systemPrintln("All messages may use the entire ring buffer, the oldest messages are discarded first");
+        systemPrintln("Class          Dropped Messages    Dropped Bytes");
+        for (int priority = 0; priority < RING_BUFFER_PRIORITY_CLASSES; priority++)
+            systemPrintf("%d) %-8s %19d %16d\r\n", priority, messagePriorityName[priority],
+                         gnssRingBuffer.droppedMessages[priority], gnssRingBuffer.droppedBytes[priority]);
+
+        systemPrintln("Enabled messages:");
+        for (int x = 0; x < MAX_UBX_MSG; x++)
+        {
+            int priority = settings.ubxMessagePriorities[x];
+            if (priority >= RING_BUFFER_PRIORITY_CLASSES)
+                priority = RING_BUFFER_PRIORITY_CLASSES - 1;
+            if (settings.ubxMessageRates[x] && messageSupported(x))
+                systemPrintf("    %s: %s\r\n", ubxMessages[x].msgTextName, messagePriorityName[priority]);
+        }
+
+        systemPrintln("1) Set the priority of a message");
+        systemPrintln("2) Reset priorities to defaults");
+        systemPrintln("3) Clear the dropped message counts");
+        systemPrint("4) Reserve ring buffer space for higher priorities: ");
+        systemPrintf("%s\r\n", settings.enableRingBufferReserves ? "Enabled" : "Disabled");
+
+        systemPrintln("x) Exit");
+
+        int incoming = getNumber(); // Returns EXIT, TIMEOUT, or long
+
+        if (incoming == 1)
+        {
+            char messageName[20];
+
+            systemPrint("Enter the message name (UBX_NMEA_GSV): ");
+            if (getString(messageName, sizeof(messageName)) == INPUT_RESPONSE_VALID)
+            {
+                int x;
+                for (x = 0; x < MAX_UBX_MSG; x++)
+                    if (strcasecmp(ubxMessages[x].msgTextName, messageName) == 0)
+                        break;
+                if (x >= MAX_UBX_MSG)
+                    systemPrintln("Error: Unknown message name");
+                else
+                {
+                    systemPrintf("Enter %s priority (0 to %d): ", ubxMessages[x].msgTextName,
+                                 RING_BUFFER_PRIORITY_CLASSES - 1);
+                    int priority = getNumber(); // Returns EXIT, TIMEOUT, or long
+                    if ((priority != INPUT_RESPONSE_GETNUMBER_EXIT) && (priority != INPUT_RESPONSE_GETNUMBER_TIMEOUT))
+                    {
+                        if (priority < 0 || priority >= RING_BUFFER_PRIORITY_CLASSES)
+                            systemPrintln("Error: Priority out of range");
+                        else
+                            settings.ubxMessagePriorities[x] = priority; // Recorded to NVM and file at main menu exit
+                    }
+                }
+            }
+        }
+        else if (incoming == 2)
+        {
+            settings.ubxMessagePriorities[0] = 254;
+            checkMessageRates();
+            systemPrintln("Message priorities reset to defaults");
+        }
+        else if (incoming == 3)
+        {
+            memset(gnssRingBuffer.droppedMessages, 0, sizeof(gnssRingBuffer.droppedMessages));
+            memset(gnssRingBuffer.droppedBytes, 0, sizeof(gnssRingBuffer.droppedBytes));
+        }
+        else if (incoming == 4)
+        {
+            settings.enableRingBufferReserves ^= 1; // Recorded to NVM and file at main menu exit
+            if (gnssRingBuffer.data)
+                ringBufferReserves(&gnssRingBuffer, settings.enableRingBufferReserves);
+        }
+        else if (incoming == INPUT_RESPONSE_GETNUMBER_EXIT)
+            break;
+        else if (incoming == INPUT_RESPONSE_GETNUMBER_TIMEOUT)
+            break;
+        else
+            printUnknown(incoming);
+    }
+
+    clearBuffer(); // Empty buffer of any newline chars
+}
+
+// Select the output to filter the GNSS messages sent to that output
+void menuMessageFilters()
+{
+    while (1)
+    {
+        systemPrintln();
+        systemPrintln("Menu: Output Message Filters");
+
+        for (int output = 0; output < MESSAGE_FILTER_OUTPUTS; output++)
+        {
+            int filtered = 0;
+            for (int x = 0; x < MAX_UBX_MSG; x++)
+                if (settings.ubxMessageRates[x] && (settings.ubxMessageFilters[x] & (1 << output)))
+                    filtered++;
+            systemPrintf("%d) %s: %d enabled messages filtered\r\n", output + 1, messageFilterName[output],
+                         filtered);
+        }
+
+        systemPrintln("x) Exit");
+
+        int incoming = getNumber(); // Returns EXIT, TIMEOUT, or long
+
+        if ((incoming >= 1) && (incoming <= MESSAGE_FILTER_OUTPUTS))
+            menuMessageFilterOutput(incoming - 1);
+        else if (incoming == INPUT_RESPONSE_GETNUMBER_EXIT)
+            break;
+        else if (incoming == INPUT_RESPONSE_GETNUMBER_TIMEOUT)
+            break;
+        else
+            printUnknown(incoming);
+    }
+
+    clearBuffer(); // Empty buffer of any newline chars
+}
+
+// Select the enabled messages sent to an output
+void menuMessageFilterOutput(int output)
+{
+    uint8_t filterBit = 1 << output;
+
+    while (1)
+    {
+        int messageCount = 0;
+        uint8_t messageNumber[MAX_UBX_MSG];
+
+        systemPrintln();
+        systemPrintf("Menu: %s Message Filter\r\n", messageFilterName[output]);
+
+        // Only list the enabled messages
+        for (int x = 0; x < MAX_UBX_MSG; x++)
+        {
+            if (settings.ubxMessageRates[x] && messageSupported(x))
+            {
+                messageNumber[messageCount++] = x;
+                systemPrintf("%d) Message %s: %s\r\n", messageCount, ubxMessages[x].msgTextName,
+                             (settings.ubxMessageFilters[x] & filterBit) ? "Filtered" : "Sent");
+            }
+        }
+
+        systemPrintf("%d) Send all messages\r\n", messageCount + 1);
+        systemPrintf("%d) Send only the NMEA messages\r\n", messageCount + 2);
+
+        systemPrintln("x) Exit");
+
+        int incoming = getNumber(); // Returns EXIT, TIMEOUT, or long
+
+        if ((incoming >= 1) && (incoming <= messageCount))
+            settings.ubxMessageFilters[messageNumber[incoming - 1]] ^= filterBit;
+        else if (incoming == (messageCount + 1))
+        {
+            for (int x = 0; x < MAX_UBX_MSG; x++)
+                settings.ubxMessageFilters[x] &= ~filterBit;
+        }
+        else if (incoming == (messageCount + 2))
+        {
+            for (int x = 0; x < MAX_UBX_MSG; x++)
+            {
+                if (strncmp(ubxMessages[x].msgTextName, "UBX_NMEA_", 9) == 0)
+                    settings.ubxMessageFilters[x] &= ~filterBit;
+                else
+                    settings.ubxMessageFilters[x] |= filterBit;
+            }
+        }
+        else if (incoming == INPUT_RESPONSE_GETNUMBER_EXIT)
+            break;
+        else if (incoming == INPUT_RESPONSE_GETNUMBER_TIMEOUT)
+            break;
+        else
+            printUnknown(incoming);
+    }
+
+    clearBuffer(); // Empty buffer of any newline chars
+}
+
 // Set all GNSS message report rates to one value
 // Useful for turning on or off all messages for resetting and testing
 // We pass in the message array by reference so that we can modify a temp struct
@@ -501,14 +738,7 @@ void beginLogging(const char *customFileName)
                 }
 
                 if (strlen(logFileName) == 0)
-                {
-                    snprintf(logFileName, sizeof(logFileName), "/%s_%02d%02d%02d_%02d%02d%02d.ubx", // SdFat library
-                             platformFilePrefix, rtc.getYear() - 2000, rtc.getMonth() + 1,
-                             rtc.getDay(), // ESP32Time returns month:0-11
-                             rtc.getHour(true), rtc.getMinute(),
-                             rtc.getSecond() // ESP32Time getHour(true) returns hour:0-23
-                    );
-                }
+                    sdLogFileName(logFileName, sizeof(logFileName));
             }
             else
             {
@@ -527,117 +757,53 @@ void beginLogging(const char *customFileName)
                 }
             }
 
+            // Allocate the log file staging buffer, a multiple of the sector size
+            if (!sdLogBuffer)
+            {
+                sdLogBufferSize = settings.sdWriteBufferSize & ~(SD_SECTOR_SIZE - 1);
+                if (sdLogBufferSize < SD_SECTOR_SIZE)
+                    sdLogBufferSize = SD_SECTOR_SIZE;
+                sdLogBuffer = (uint8_t *)malloc(sdLogBufferSize);
+                if (!sdLogBuffer)
+                {
+                    systemPrintln("Failed to allocate sdLogBuffer!");
+                    return;
+                }
+            }
+
+            // Allocate the compression buffers when the log file name has the
+            // compressed log file extension
+            sdLogCompressFree();
+            const char *extension = strrchr(logFileName, '.');
+            if (extension && (strcmp(&extension[1], LOG_COMPRESS_EXTENSION) == 0))
+            {
+                sdLogCompress = (LOG_COMPRESS *)malloc(sizeof(LOG_COMPRESS));
+                sdLogCompressBuffer = (uint8_t *)malloc(LOG_COMPRESS_BLOCK_BYTES +
+                                                        LOG_COMPRESS_OUTPUT_BYTES(LOG_COMPRESS_BLOCK_BYTES));
+                if ((!sdLogCompress) || (!sdLogCompressBuffer))
+                {
+                    sdLogCompressFree();
+                    systemPrintln("Failed to allocate the log compression buffers!");
+                    return;
+                }
+            }
+
             // Attempt to write to file system. This avoids collisions with file writing in F9PSerialReadTask()
             if (xSemaphoreTake(sdCardSemaphore, fatSemaphore_longWait_ms) == pdPASS)
             {
                 markSemaphore(FUNCTION_CREATEFILE);
 
-                // O_CREAT - create the file if it does not exist
-                // O_APPEND - seek to the end of the file prior to each write
-                // O_WRITE - open for write
-                if (ubxFile->open(logFileName, O_CREAT | O_APPEND | O_WRITE) == false)
+                if (sdLogOpen(ubxFile, logFileName, &sdLogPreallocated) == false)
                 {
-                    systemPrintf("Failed to create GNSS UBX data file: %s\r\n", logFileName);
                     online.logging = false;
                     xSemaphoreGive(sdCardSemaphore);
                     return;
                 }
 
-                fileSize = 0;
-                lastLogSize = 0; // Reset counter - used for displaying active logging icon
-
-                bufferOverruns = 0; // Reset counter
-
-                ubxFile->updateFileCreateTimestamp(); // Update the file to create time & date
-
-                startCurrentLogTime_minutes = millis() / 1000L / 60; // Mark now as start of logging
-
-                // If it hasn't been done before, mark the initial start of logging for total run time
-                if (startLogTime_minutes == 0)
-                    startLogTime_minutes = millis() / 1000L / 60;
-
-                // Add NMEA txt message with restart reason
-                char rstReason[30];
-                switch (esp_reset_reason())
-                {
-                case ESP_RST_UNKNOWN:
-                    strcpy(rstReason, "ESP_RST_UNKNOWN");
-                    break;
-                case ESP_RST_POWERON:
-                    strcpy(rstReason, "ESP_RST_POWERON");
-                    break;
-                case ESP_RST_SW:
-                    strcpy(rstReason, "ESP_RST_SW");
-                    break;
-                case ESP_RST_PANIC:
-                    strcpy(rstReason, "ESP_RST_PANIC");
-                    break;
-                case ESP_RST_INT_WDT:
-                    strcpy(rstReason, "ESP_RST_INT_WDT");
-                    break;
-                case ESP_RST_TASK_WDT:
-                    strcpy(rstReason, "ESP_RST_TASK_WDT");
-                    break;
-                case ESP_RST_WDT:
-                    strcpy(rstReason, "ESP_RST_WDT");
-                    break;
-                case ESP_RST_DEEPSLEEP:
-                    strcpy(rstReason, "ESP_RST_DEEPSLEEP");
-                    break;
-                case ESP_RST_BROWNOUT:
-                    strcpy(rstReason, "ESP_RST_BROWNOUT");
-                    break;
-                case ESP_RST_SDIO:
-                    strcpy(rstReason, "ESP_RST_SDIO");
-                    break;
-                default:
-                    strcpy(rstReason, "Unknown");
-                }
+                // Start tracking the epochs for the switch to the next log file
+                logRotateInit(&sdLogRotate);
 
-                // Mark top of log with system information
-                char nmeaMessage[82]; // Max NMEA sentence length is 82
-                createNMEASentence(CUSTOM_NMEA_TYPE_RESET_REASON, nmeaMessage, sizeof(nmeaMessage),
-                                   rstReason); // textID, buffer, sizeOfBuffer, text
-                ubxFile->println(nmeaMessage);
-
-                // Record system firmware versions and info to log
-
-                // SparkFun RTK Express v1.10-Feb 11 2022
-                char firmwareVersion[30]; // v1.3 December 31 2021
-                firmwareVersion[0] = 'v';
-                getFirmwareVersion(&firmwareVersion[1], sizeof(firmwareVersion) -1, true);
-                createNMEASentence(CUSTOM_NMEA_TYPE_SYSTEM_VERSION, nmeaMessage, sizeof(nmeaMessage),
-                                   firmwareVersion); // textID, buffer, sizeOfBuffer, text
-                ubxFile->println(nmeaMessage);
-
-                // ZED-F9P firmware: HPG 1.30
-                createNMEASentence(CUSTOM_NMEA_TYPE_ZED_VERSION, nmeaMessage, sizeof(nmeaMessage),
-                                   zedFirmwareVersion); // textID, buffer, sizeOfBuffer, text
-                ubxFile->println(nmeaMessage);
-
-                // ZED-F9 unique chip ID
-                createNMEASentence(CUSTOM_NMEA_TYPE_ZED_UNIQUE_ID, nmeaMessage, sizeof(nmeaMessage),
-                                   zedUniqueId); // textID, buffer, sizeOfBuffer, text
-                ubxFile->println(nmeaMessage);
-
-                // Device BT MAC. See issue: https://github.com/sparkfun/SparkFun_RTK_Firmware/issues/346
-                char macAddress[5];
-                snprintf(macAddress, sizeof(macAddress), "%02X%02X", btMACAddress[4], btMACAddress[5]);
-                createNMEASentence(CUSTOM_NMEA_TYPE_DEVICE_BT_ID, nmeaMessage, sizeof(nmeaMessage),
-                                   macAddress); // textID, buffer, sizeOfBuffer, text
-                ubxFile->println(nmeaMessage);
-
-                // Record today's time/date into log. This is in case a log is restarted. See issue 440:
-                // https://github.com/sparkfun/SparkFun_RTK_Firmware/issues/440
-                char currentDate[sizeof("230101,120101")];
-                snprintf(currentDate, sizeof(currentDate), "%02d%02d%02d,%02d%02d%02d", rtc.getYear() - 2000,
-                         rtc.getMonth() + 1, rtc.getDay(), // ESP32Time returns month:0-11
-                         rtc.getHour(true), rtc.getMinute(),
-                         rtc.getSecond() // ESP32Time getHour(true) returns hour:0-23
-                );
-                createNMEASentence(CUSTOM_NMEA_TYPE_CURRENT_DATE, nmeaMessage, sizeof(nmeaMessage),
-                                   currentDate); // textID, buffer, sizeOfBuffer, text
-                ubxFile->println(nmeaMessage);
+                sdLogStart();
 
                 if (reuseLastLog == true)
                 {
@@ -672,29 +838,19 @@ void endLogging(bool gotSemaphore, bool releaseSemaphore)
 
             online.logging = false;
 
-            // Record the number of NMEA/RTCM/UBX messages that were filtered out
-            char parserStats[50];
-
-            snprintf(parserStats, sizeof(parserStats), "%d,%d,%d,", failedParserMessages_NMEA,
-                     failedParserMessages_RTCM, failedParserMessages_UBX);
-
-            char nmeaMessage[82]; // Max NMEA sentence length is 82
-            createNMEASentence(CUSTOM_NMEA_TYPE_PARSER_STATS, nmeaMessage, sizeof(nmeaMessage),
-                               parserStats); // textID, buffer, sizeOfBuffer, text
-            ubxFile->println(nmeaMessage);
-            ubxFile->sync();
+            // Finish the log file and discard the next log file
+            sdLogClose();
+            sdLogCancelNext();
 
-            // Reset stats in case a new log is created
-            failedParserMessages_NMEA = 0;
-            failedParserMessages_RTCM = 0;
-            failedParserMessages_UBX = 0;
-
-            // Close down file system
-            ubxFile->close();
             // Done with the log file
             delete ubxFile;
             ubxFile = nullptr;
 
+            // Done with the staging and compression buffers
+            free(sdLogBuffer);
+            sdLogBuffer = nullptr;
+            sdLogCompressFree();
+
             systemPrintln("Log file closed");
 
             // Release the semaphore if requested
@@ -714,6 +870,309 @@ void endLogging(bool gotSemaphore, bool releaseSemaphore)
     }
 }
 
+// Build the name of a new log file from the current date and time
+void sdLogFileName(char *fileName, size_t fileNameSize)
+{
+    snprintf(fileName, fileNameSize, "/%s_%02d%02d%02d_%02d%02d%02d.%s", // SdFat library
+             platformFilePrefix, rtc.getYear() - 2000, rtc.getMonth() + 1,
+             rtc.getDay(), // ESP32Time returns month:0-11
+             rtc.getHour(true), rtc.getMinute(),
+             rtc.getSecond(), // ESP32Time getHour(true) returns hour:0-23
+             sdLogExtension());
+}
+
+// Open or create a log file, preallocated receives the number of bytes
+// pre-allocated for the file.  The caller must hold the sdCardSemaphore.
+// Returns true if the file was opened.
+bool sdLogOpen(FileSdFatMMC *file, const char *fileName, uint64_t *preallocated)
+{
+    uint64_t length;
+
+    *preallocated = 0;
+
+    // O_CREAT - create the file if it does not exist
+    // O_APPEND - seek to the end of the file prior to each write
+    // O_WRITE - open for write
+    if (file->open(fileName, O_CREAT | O_APPEND | O_WRITE) == false)
+    {
+        systemPrintf("Failed to create GNSS UBX data file: %s\r\n", fileName);
+        return false;
+    }
+
+    // Allocate contiguous clusters for a new file to keep cluster
+    // allocation out of the log writes
+    if ((file->fileSize() == 0) && settings.sdPreallocateMB)
+    {
+        length = (uint64_t)settings.sdPreallocateMB * 1024 * 1024;
+        if (file->preAllocate(length) == false)
+            log_d("Failed to pre-allocate %d MB for the log file", settings.sdPreallocateMB);
+        else
+        {
+            // Remove the pre-allocated clusters from the free space, the log
+            // writes only account for the clusters beyond this length
+            *preallocated = length;
+            sdFreeSpaceAdjust(0, length);
+        }
+    }
+
+    file->updateFileCreateTimestamp(); // Update the file to create time & date
+
+    sdDirectoryUpdate(fileName, file->fileSize());
+    return true;
+}
+
+// Start writing to the log file opened by sdLogOpen, the system information
+// is written at the top of the log.  The caller must hold the sdCardSemaphore.
+void sdLogStart()
+{
+    fileSize = ubxFile->fileSize();
+
+    // Align the staging buffer writes with the sectors of the file
+    sdLogBufferBytes = 0;
+    sdLogBufferLimit = sdLogBufferSize - (fileSize % SD_SECTOR_SIZE);
+
+    lastLogSize = 0; // Reset counter - used for displaying active logging icon
+
+    bufferOverruns = 0; // Reset counter
+
+    // Reset the log file write statistics
+    memset(sdWriteSizes, 0, sizeof(sdWriteSizes));
+    memset(sdWriteTimes, 0, sizeof(sdWriteTimes));
+    sdWriteMaxMillis = 0;
+
+    // Start a new series of compressed blocks
+    if (sdLogCompress)
+        logCompressInit(sdLogCompress);
+    sdLogCompressBytes = 0;
+    sdLogCompressMicros = 0;
+    sdLogCompressMaxMicros = 0;
+
+    // Start the seek index at the end of the log file
+    sdLogMessageStart = true;
+    sdLogIndexOpen();
+
+    startCurrentLogTime_minutes = millis() / 1000L / 60; // Mark now as start of logging
+
+    // If it hasn't been done before, mark the initial start of logging for total run time
+    if (startLogTime_minutes == 0)
+        startLogTime_minutes = millis() / 1000L / 60;
+
+    // Add NMEA txt message with restart reason
+    char rstReason[30];
+    switch (esp_reset_reason())
+    {
+    case ESP_RST_UNKNOWN:
+        strcpy(rstReason, "ESP_RST_UNKNOWN");
+        break;
+    case ESP_RST_POWERON:
+        strcpy(rstReason, "ESP_RST_POWERON");
+        break;
+    case ESP_RST_SW:
+        strcpy(rstReason, "ESP_RST_SW");
+        break;
+    case ESP_RST_PANIC:
+        strcpy(rstReason, "ESP_RST_PANIC");
+        break;
+    case ESP_RST_INT_WDT:
+        strcpy(rstReason, "ESP_RST_INT_WDT");
+        break;
+    case ESP_RST_TASK_WDT:
+        strcpy(rstReason, "ESP_RST_TASK_WDT");
+        break;
+    case ESP_RST_WDT:
+        strcpy(rstReason, "ESP_RST_WDT");
+        break;
+    case ESP_RST_DEEPSLEEP:
+        strcpy(rstReason, "ESP_RST_DEEPSLEEP");
+        break;
+    case ESP_RST_BROWNOUT:
+        strcpy(rstReason, "ESP_RST_BROWNOUT");
+        break;
+    case ESP_RST_SDIO:
+        strcpy(rstReason, "ESP_RST_SDIO");
+        break;
+    default:
+        strcpy(rstReason, "Unknown");
+    }
+
+    // Mark top of log with system information
+    char nmeaMessage[82]; // Max NMEA sentence length is 82
+    createNMEASentence(CUSTOM_NMEA_TYPE_RESET_REASON, nmeaMessage, sizeof(nmeaMessage),
+                       rstReason); // textID, buffer, sizeOfBuffer, text
+    sdLogPrintln(nmeaMessage);
+
+    // Record system firmware versions and info to log
+
+    // SparkFun RTK Express v1.10-Feb 11 2022
+    char firmwareVersion[30]; // v1.3 December 31 2021
+    firmwareVersion[0] = 'v';
+    getFirmwareVersion(&firmwareVersion[1], sizeof(firmwareVersion) -1, true);
+    createNMEASentence(CUSTOM_NMEA_TYPE_SYSTEM_VERSION, nmeaMessage, sizeof(nmeaMessage),
+                       firmwareVersion); // textID, buffer, sizeOfBuffer, text
+    sdLogPrintln(nmeaMessage);
+
+    // ZED-F9P firmware: HPG 1.30
+    createNMEASentence(CUSTOM_NMEA_TYPE_ZED_VERSION, nmeaMessage, sizeof(nmeaMessage),
+                       zedFirmwareVersion); // textID, buffer, sizeOfBuffer, text
+    sdLogPrintln(nmeaMessage);
+
+    // ZED-F9 unique chip ID
+    createNMEASentence(CUSTOM_NMEA_TYPE_ZED_UNIQUE_ID, nmeaMessage, sizeof(nmeaMessage),
+                       zedUniqueId); // textID, buffer, sizeOfBuffer, text
+    sdLogPrintln(nmeaMessage);
+
+    // Device BT MAC. See issue: https://github.com/sparkfun/SparkFun_RTK_Firmware/issues/346
+    char macAddress[5];
+    snprintf(macAddress, sizeof(macAddress), "%02X%02X", btMACAddress[4], btMACAddress[5]);
+    createNMEASentence(CUSTOM_NMEA_TYPE_DEVICE_BT_ID, nmeaMessage, sizeof(nmeaMessage),
+                       macAddress); // textID, buffer, sizeOfBuffer, text
+    sdLogPrintln(nmeaMessage);
+
+    // Record today's time/date into log. This is in case a log is restarted. See issue 440:
+    // https://github.com/sparkfun/SparkFun_RTK_Firmware/issues/440
+    char currentDate[sizeof("230101,120101")];
+    snprintf(currentDate, sizeof(currentDate), "%02d%02d%02d,%02d%02d%02d", rtc.getYear() - 2000,
+             rtc.getMonth() + 1, rtc.getDay(), // ESP32Time returns month:0-11
+             rtc.getHour(true), rtc.getMinute(),
+             rtc.getSecond() // ESP32Time getHour(true) returns hour:0-23
+    );
+    createNMEASentence(CUSTOM_NMEA_TYPE_CURRENT_DATE, nmeaMessage, sizeof(nmeaMessage),
+                       currentDate); // textID, buffer, sizeOfBuffer, text
+    sdLogPrintln(nmeaMessage);
+}
+
+// Finish writing the log file and close it.  The caller must hold the
+// sdCardSemaphore.
+void sdLogClose()
+{
+    // Record the number of NMEA/RTCM/UBX messages that were filtered out
+    char parserStats[50];
+
+    snprintf(parserStats, sizeof(parserStats), "%d,%d,%d,", failedParserMessages_NMEA,
+             failedParserMessages_RTCM, failedParserMessages_UBX);
+
+    char nmeaMessage[82]; // Max NMEA sentence length is 82
+    createNMEASentence(CUSTOM_NMEA_TYPE_PARSER_STATS, nmeaMessage, sizeof(nmeaMessage),
+                       parserStats); // textID, buffer, sizeOfBuffer, text
+    sdLogPrintln(nmeaMessage);
+    sdLogFlush();
+
+    // Release the unused pre-allocated clusters
+    if (ubxFile->truncate() && (fileSize < sdLogPreallocated))
+        sdFreeSpaceAdjust(sdLogPreallocated, fileSize);
+    sdLogPreallocated = 0;
+    ubxFile->sync();
+    sdLogIndexClose();
+
+    // Reset stats in case a new log is created
+    failedParserMessages_NMEA = 0;
+    failedParserMessages_RTCM = 0;
+    failedParserMessages_UBX = 0;
+
+    // Close down file system
+    ubxFile->close();
+    sdDirectoryUpdate(logFileName, fileSize);
+}
+
+// Request the next log file from the SD card consumer, which creates the file
+// between its log writes so that the main loop does not wait for the
+// microSD card.  Returns true when the switch is requested or pending and
+// false when the log file must be closed instead.
+bool sdLogPrepareNext()
+{
+    // The switch only replaces the file, the compression and staging
+    // buffers must match the next log file
+    if ((sdLogCompress != nullptr) != settings.enableLogCompression)
+        return false;
+
+    sdLogCreateNextRequest = true;
+    return true;
+}
+
+// Create and pre-allocate the next log file, then request the switch to the
+// next log file at an epoch boundary.  Called by the SD card consumer, the
+// caller must hold the sdCardSemaphore.
+void sdLogCreateNext()
+{
+    FileSdFatMMC *file;
+    char fileName[sizeof(logFileName)];
+
+    sdLogCreateNextRequest = false;
+    if (sdNextLogFile || ((systemTime_minutes - startCurrentLogTime_minutes) < settings.maxLogLength_minutes))
+        return;
+
+    // Don't reuse the current log file name, updateLogs requests the file
+    // again during the next loop
+    sdLogFileName(fileName, sizeof(fileName));
+    if (strcmp(fileName, logFileName) == 0)
+        return;
+
+    file = new FileSdFatMMC;
+    if ((!file) || (sdLogOpen(file, fileName, &sdNextLogPreallocated) == false))
+    {
+        if (file)
+            delete file;
+        sdLogCreateNextFailed = true;
+        return;
+    }
+    strcpy(sdNextLogFileName, fileName);
+    sdNextLogFile = file;
+    logRotateRequest(&sdLogRotate);
+
+    if (settings.enablePrintLogFileStatus && (!inMainMenu))
+        systemPrintf("Next log file name: %s\r\n", sdNextLogFileName);
+}
+
+// Switch to the next log file, called by the SD card consumer before writing
+// the first message of an epoch.  The caller must hold the sdCardSemaphore.
+void sdLogSwitch()
+{
+    FileSdFatMMC *file;
+
+    if (!sdNextLogFile)
+        return;
+
+    // Finish the current log file
+    sdLogClose();
+    file = ubxFile;
+
+    // Start the next log file, sdNextLogFile is cleared last since
+    // updateLogs checks it to determine if the switch is pending
+    ubxFile = sdNextLogFile;
+    sdLogPreallocated = sdNextLogPreallocated;
+    sdNextLogPreallocated = 0;
+    strcpy(logFileName, sdNextLogFileName);
+    sdLogStart();
+    sdNextLogFile = nullptr;
+    delete file;
+
+    systemPrintf("Log file name: %s\r\n", logFileName);
+}
+
+// Remove the unused next log file.  The caller must hold the sdCardSemaphore.
+void sdLogCancelNext()
+{
+    sdLogCreateNextRequest = false;
+    logRotateInit(&sdLogRotate);
+    if (!sdNextLogFile)
+        return;
+
+    // Release the pre-allocated clusters and remove the empty file
+    if (sdNextLogFile->truncate())
+        sdFreeSpaceAdjust(sdNextLogPreallocated, 0);
+    sdNextLogPreallocated = 0;
+    sdNextLogFile->close();
+    delete sdNextLogFile;
+    sdNextLogFile = nullptr;
+    if (USE_SPI_MICROSD)
+        sd->remove(sdNextLogFileName);
+#ifdef COMPILE_SD_MMC
+    else
+        SD_MMC.remove(sdNextLogFileName);
+#endif // COMPILE_SD_MMC
+    sdDirectoryRemove(sdNextLogFileName);
+}
+
 // Finds last log
 // Returns true if successful
 // lastLogName will contain the name of the last log file on return - ** but without the preceding slash **
@@ -721,6 +1180,10 @@ bool findLastLog(char *lastLogNamePrt, size_t lastLogNameSize)
 {
     bool foundAFile = false;
 
+    // Use the directory index when available, avoids scanning the directory
+    if ((online.microSD == true) && sdDirectoryValid())
+        return sdDirectoryLastLog(lastLogNamePrt, lastLogNameSize);
+
     if (online.microSD == true)
     {
         // Attempt to access file system. This avoids collisions with file writing in F9PSerialReadTask()
@@ -734,7 +1197,7 @@ bool findLastLog(char *lastLogNamePrt, size_t lastLogNameSize)
             {
                 SdFile tempFile;
                 SdFile dir;
-                const char *LOG_EXTENSION = "ubx";
+                const char *LOG_EXTENSION = sdLogExtension();
                 const char *LOG_PREFIX = platformFilePrefix;
                 char fname[100]; // Handle long file names
 
@@ -765,7 +1228,7 @@ bool findLastLog(char *lastLogNamePrt, size_t lastLogNameSize)
             {
                 File tempFile;
                 File dir;
-                const char *LOG_EXTENSION = "ubx";
+                const char *LOG_EXTENSION = sdLogExtension();
                 const char *LOG_PREFIX = platformFilePrefix;
                 char fname[100]; // Handle long file names
 
@@ -936,6 +1399,79 @@ void checkMessageRates()
         for (int x = 0; x < MAX_UBX_MSG_RTCM; x++)
             settings.ubxMessageRatesBase[x] = ubxMessages[firstRTCMRecord + x].msgDefaultRate;
     }
+
+    if (settings.ubxMessagePriorities[0] == 254)
+    {
+        // Reset priorities to defaults
+        // The satellite and error reports are dropped first, the raw
+        // measurements needed for PPP post processing are kept
+        for (int x = 0; x < MAX_UBX_MSG; x++)
+        {
+            const char *name = ubxMessages[x].msgTextName;
+
+            if ((strcmp(name, "UBX_NMEA_GSV") == 0) || (strcmp(name, "UBX_NMEA_GST") == 0))
+                settings.ubxMessagePriorities[x] = RING_BUFFER_PRIORITY_LOW;
+            else if ((strcmp(name, "UBX_RXM_RAWX") == 0) || (strcmp(name, "UBX_RXM_SFRBX") == 0))
+                settings.ubxMessagePriorities[x] = RING_BUFFER_PRIORITY_CRITICAL;
+            else if (ubxMessages[x].msgClass == UBX_RTCM_MSB)
+                settings.ubxMessagePriorities[x] = RING_BUFFER_PRIORITY_HIGH;
+            else
+                settings.ubxMessagePriorities[x] = RING_BUFFER_PRIORITY_NORMAL;
+        }
+    }
+}
+
+// Verify the message priority tables
+void messagePriorityVerifyTables()
+{
+    if (messagePriorityNameEntries != RING_BUFFER_PRIORITY_CLASSES)
+        reportFatalError("Fix messagePriorityName to match RING_BUFFER_PRIORITY");
+    if (messageFilterNameEntries != MESSAGE_FILTER_OUTPUTS)
+        reportFatalError("Fix messageFilterName to match MESSAGE_FILTER_OUTPUTS");
+}
+
+// Locate the message received from the GNSS in ubxMessages, returns the
+// message number or -1 if the message is not in the table
+int getMessageNumber(PARSE_STATE *parse, uint8_t type)
+{
+    for (int x = 0; x < MAX_UBX_MSG; x++)
+    {
+        const char *name = ubxMessages[x].msgTextName;
+
+        switch (type)
+        {
+        case SENTENCE_TYPE_NMEA:
+            // Skip the talker ID: GNGSV --> GSV
+            if ((ubxMessages[x].msgClass == UBX_CLASS_NMEA) && (strncmp(name, "UBX_NMEA_", 9) == 0) &&
+                (strcmp(&name[9], (const char *)&parse->nmeaMessageName[2]) == 0))
+                return x;
+            break;
+
+        case SENTENCE_TYPE_RTCM:
+            if ((ubxMessages[x].msgClass == UBX_RTCM_MSB) && (atoi(&name[9]) == parse->message))
+                return x;
+            break;
+
+        case SENTENCE_TYPE_UBX:
+            if ((ubxMessages[x].msgClass == (parse->message >> 8)) && (ubxMessages[x].msgID == (parse->message & 0xff)))
+                return x;
+            break;
+        }
+    }
+    return -1;
+}
+
+// Build a single line description of the messages dropped from the ring
+// buffer, commas are not used to allow the string to be passed to the web page
+void messagePriorityDrops(char *buffer, size_t bufferLength)
+{
+    int offset = 0;
+
+    buffer[0] = 0;
+    for (int priority = 0; (priority < RING_BUFFER_PRIORITY_CLASSES) && (offset < (int)bufferLength); priority++)
+        offset += snprintf(&buffer[offset], bufferLength - offset, "%s%s: %d messages %d bytes",
+                           priority ? "; " : "", messagePriorityName[priority],
+                           gnssRingBuffer.droppedMessages[priority], gnssRingBuffer.droppedBytes[priority]);
 }
 
 // Determine logging type
@@ -1130,7 +1666,7 @@ void updateLogTest()
         {
             markSemaphore(FUNCTION_LOGTEST);
 
-            ubxFile->println(nmeaMessage);
+            sdLogPrintln(nmeaMessage);
 
             xSemaphoreGive(sdCardSemaphore);
         }
@@ -1462,25 +1462,25 @@ void updateLBand()
                 systemPrintf("Time to first L-Band fix: %ds\r\n", lbandTimeToFix / 1000);
         }
 
-        if ((millis() - rtcmLastPacketReceived) / 1000 > settings.rtcmTimeoutBeforeUsingLBand_s)
+        if (correctionsFallback())
         {
-            // If we have not received RTCM in a certain amount of time,
-            // and if communication was disabled because RTCM was being received at some point,
-            // re-enable L-Band communcation
+            // If no other correction source is selected, and if communication was disabled
+            // because another source was selected at some point, re-enable L-Band communcation.
+            // The correction arbiter waits rtcmTimeoutBeforeUsingLBand_s after losing a source.
             if (lBandCommunicationEnabled == false)
             {
                 if (settings.debugLBand == true)
-                    systemPrintln("Enabling L-Band communication due to RTCM timeout");
+                    systemPrintln("Enabling L-Band communication, no other correction source");
                 lBandCommunicationEnabled = zedEnableLBandCommunication();
             }
         }
         else
         {
-            // If we *have* recently received RTCM then disable corrections from then NEO-D9S L-Band receiver
+            // If another correction source is selected then disable corrections from then NEO-D9S L-Band receiver
             if (lBandCommunicationEnabled == true)
             {
                 if (settings.debugLBand == true)
-                    systemPrintln("Disabling L-Band communication due to RTCM reception");
+                    systemPrintln("Disabling L-Band communication, another correction source is selected");
                 lBandCommunicationEnabled = !zedDisableLBandCommunication(); // zedDisableLBandCommunication() returns
                                                                              // true if we successfully disabled
             }
@@ -96,7 +96,8 @@ void menuPortsSurveyor()
                                 response &= theGNSS.addCfgValset(UBLOX_CFG_UART2OUTPROT_RTCM3X, 1);
                             response &= theGNSS.addCfgValset(UBLOX_CFG_UART2INPROT_UBX, settings.enableUART2UBXIn);
                             response &= theGNSS.addCfgValset(UBLOX_CFG_UART2INPROT_NMEA, 0);
-                            response &= theGNSS.addCfgValset(UBLOX_CFG_UART2INPROT_RTCM3X, 1);
+                            // Other correction sources take priority over the radio
+                            response &= theGNSS.addCfgValset(UBLOX_CFG_UART2INPROT_RTCM3X, correctionsFallback());
                             if (commandSupported(UBLOX_CFG_UART2INPROT_SPARTN) == true)
                                 response &= theGNSS.addCfgValset(UBLOX_CFG_UART2INPROT_SPARTN, 0);
 
@@ -322,7 +323,8 @@ void menuPortsMultiplexed()
                                 response &= theGNSS.addCfgValset(UBLOX_CFG_UART2OUTPROT_RTCM3X, 1);
                             response &= theGNSS.addCfgValset(UBLOX_CFG_UART2INPROT_UBX, settings.enableUART2UBXIn);
                             response &= theGNSS.addCfgValset(UBLOX_CFG_UART2INPROT_NMEA, 0);
-                            response &= theGNSS.addCfgValset(UBLOX_CFG_UART2INPROT_RTCM3X, 1);
+                            // Other correction sources take priority over the radio
+                            response &= theGNSS.addCfgValset(UBLOX_CFG_UART2INPROT_RTCM3X, correctionsFallback());
                             if (commandSupported(UBLOX_CFG_UART2INPROT_SPARTN) == true)
                                 response &= theGNSS.addCfgValset(UBLOX_CFG_UART2INPROT_SPARTN, 0);
                             response &= theGNSS.sendCfgValset();
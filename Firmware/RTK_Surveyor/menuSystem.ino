@@ -135,10 +135,19 @@ void menuSystem()
         // Display NTRIP Client status and uptime
         ntripClientPrintStatus();
 
+        // Display the correction source selection
+        correctionsPrintStatus();
+
         // Display NTRIP Server status and uptime
         for (int serverIndex = 0; serverIndex < NTRIP_SERVER_MAX; serverIndex++)
             ntripServerPrintStatus(serverIndex);
 
+        // Display NTRIP Caster status
+        ntripCasterPrintStatus();
+
+        // Display PVT Server client status
+        pvtServerPrintStatus();
+
         systemPrintf("Filtered by parser: %d NMEA / %d RTCM / %d UBX\r\n", failedParserMessages_NMEA,
                      failedParserMessages_RTCM, failedParserMessages_UBX);
 
@@ -539,6 +548,10 @@ void menuDebugNetwork()
         systemPrint("28) Debug WiFi Config: ");
         systemPrintf("%s\r\n", settings.debugWiFiConfig ? "Enabled" : "Disabled");
 
+        // NTRIP Caster
+        systemPrint("29) Debug NTRIP caster: ");
+        systemPrintf("%s\r\n", settings.debugNtripCaster ? "Enabled" : "Disabled");
+
         systemPrintln("r) Force system reset");
 
         systemPrintln("x) Exit");
@@ -573,6 +586,8 @@ void menuDebugNetwork()
             settings.debugPvtUdpServer ^= 1;
         else if (incoming == 28)
             settings.debugWiFiConfig ^= 1;
+        else if (incoming == 29)
+            settings.debugNtripCaster ^= 1;
 
         // Menu exit control
         else if (incoming == 'r')
@@ -613,8 +628,9 @@ void menuDebugSoftware()
         systemPrint("11) Print ring buffer overruns: ");
         systemPrintf("%s\r\n", settings.enablePrintBufferOverrun ? "Enabled" : "Disabled");
 
-        systemPrint("12) RTCM message checking: ");
-        systemPrintf("%s\r\n", settings.enableRtcmMessageChecking ? "Enabled" : "Disabled");
+        systemPrint("12) Print each checked RTCM message: ");
+        systemPrintf("%s", settings.enableRtcmMessageChecking ? "Enabled" : "Disabled");
+        systemPrintf(" (%d bad CRC messages, %d framing errors)\r\n", rtcmCrcErrors, rtcmFramingErrors);
 
         // Rover
         systemPrint("20) Print Rover accuracy messages: ");
@@ -841,6 +857,26 @@ void menuOperation()
         systemPrint("55) GNSS Read Task Priority: ");
         systemPrintln(settings.gnssReadTaskPriority);
 
+        systemPrint("56) BT Write Task Core: ");
+        systemPrintln(settings.btWriteTaskCore);
+        systemPrint("57) BT Write Task Priority: ");
+        systemPrintln(settings.btWriteTaskPriority);
+
+        systemPrint("58) SD Write Task Core: ");
+        systemPrintln(settings.sdWriteTaskCore);
+        systemPrint("59) SD Write Task Priority: ");
+        systemPrintln(settings.sdWriteTaskPriority);
+
+        systemPrint("60) SD Write Buffer Size: ");
+        systemPrintln(settings.sdWriteBufferSize);
+        systemPrint("61) SD Log File Pre-allocation (MB): ");
+        systemPrintln(settings.sdPreallocateMB);
+
+        systemPrint("62) NTRIP Client Read Task Core: ");
+        systemPrintln(settings.ntripClientReadTaskCore);
+        systemPrint("63) NTRIP Client Read Task Priority: ");
+        systemPrintln(settings.ntripClientReadTaskPriority);
+
         systemPrintln("x) Exit");
 
         byte incoming = getCharacterNumber();
@@ -1181,6 +1217,132 @@ void menuOperation()
                 }
             }
         }
+        else if (incoming == 56)
+        {
+            systemPrint("Enter BT Write Task Core (0 or 1): ");
+            int btWriteTaskCore = getNumber(); // Returns EXIT, TIMEOUT, or long
+            if ((btWriteTaskCore != INPUT_RESPONSE_GETNUMBER_EXIT) &&
+                (btWriteTaskCore != INPUT_RESPONSE_GETNUMBER_TIMEOUT))
+            {
+                if (btWriteTaskCore < 0 || btWriteTaskCore > 1)
+                    systemPrintln("Error: Core out of range");
+                else
+                {
+                    settings.btWriteTaskCore = btWriteTaskCore; // Recorded to NVM and file
+                }
+            }
+        }
+        else if (incoming == 57)
+        {
+            systemPrint("Enter BT Write Task Priority (0 to 3): ");
+            int btWriteTaskPriority = getNumber(); // Returns EXIT, TIMEOUT, or long
+            if ((btWriteTaskPriority != INPUT_RESPONSE_GETNUMBER_EXIT) &&
+                (btWriteTaskPriority != INPUT_RESPONSE_GETNUMBER_TIMEOUT))
+            {
+                if (btWriteTaskPriority < 0 || btWriteTaskPriority > 3)
+                    systemPrintln("Error: Task priority out of range");
+                else
+                {
+                    settings.btWriteTaskPriority = btWriteTaskPriority; // Recorded to NVM and file
+                }
+            }
+        }
+        else if (incoming == 58)
+        {
+            systemPrint("Enter SD Write Task Core (0 or 1): ");
+            int sdWriteTaskCore = getNumber(); // Returns EXIT, TIMEOUT, or long
+            if ((sdWriteTaskCore != INPUT_RESPONSE_GETNUMBER_EXIT) &&
+                (sdWriteTaskCore != INPUT_RESPONSE_GETNUMBER_TIMEOUT))
+            {
+                if (sdWriteTaskCore < 0 || sdWriteTaskCore > 1)
+                    systemPrintln("Error: Core out of range");
+                else
+                {
+                    settings.sdWriteTaskCore = sdWriteTaskCore; // Recorded to NVM and file
+                }
+            }
+        }
+        else if (incoming == 59)
+        {
+            systemPrint("Enter SD Write Task Priority (0 to 3): ");
+            int sdWriteTaskPriority = getNumber(); // Returns EXIT, TIMEOUT, or long
+            if ((sdWriteTaskPriority != INPUT_RESPONSE_GETNUMBER_EXIT) &&
+                (sdWriteTaskPriority != INPUT_RESPONSE_GETNUMBER_TIMEOUT))
+            {
+                if (sdWriteTaskPriority < 0 || sdWriteTaskPriority > 3)
+                    systemPrintln("Error: Task priority out of range");
+                else
+                {
+                    settings.sdWriteTaskPriority = sdWriteTaskPriority; // Recorded to NVM and file
+                }
+            }
+        }
+        else if (incoming == 60)
+        {
+            systemPrint("Enter SD Write Buffer Size (512 to 32768, multiple of 512): ");
+            int sdWriteBufferSize = getNumber(); // Returns EXIT, TIMEOUT, or long
+            if ((sdWriteBufferSize != INPUT_RESPONSE_GETNUMBER_EXIT) &&
+                (sdWriteBufferSize != INPUT_RESPONSE_GETNUMBER_TIMEOUT))
+            {
+                if (sdWriteBufferSize < SD_SECTOR_SIZE || sdWriteBufferSize > 32768 ||
+                    (sdWriteBufferSize % SD_SECTOR_SIZE))
+                    systemPrintln("Error: Buffer size out of range");
+                else
+                {
+                    settings.sdWriteBufferSize = sdWriteBufferSize; // Recorded to NVM and file
+                    systemPrintln("The new buffer size is used when the next log file is opened");
+                }
+            }
+        }
+        else if (incoming == 61)
+        {
+            systemPrintln("A power loss while a pre-allocated log file is open leaves the unused space");
+            systemPrintln("as lost clusters on the microSD card until the card is checked");
+            systemPrint("Enter SD Log File Pre-allocation in MB (0 to 4000, 0 = disabled): ");
+            int sdPreallocateMB = getNumber(); // Returns EXIT, TIMEOUT, or long
+            if ((sdPreallocateMB != INPUT_RESPONSE_GETNUMBER_EXIT) &&
+                (sdPreallocateMB != INPUT_RESPONSE_GETNUMBER_TIMEOUT))
+            {
+                if (sdPreallocateMB < 0 || sdPreallocateMB > 4000)
+                    systemPrintln("Error: Pre-allocation out of range");
+                else
+                {
+                    settings.sdPreallocateMB = sdPreallocateMB; // Recorded to NVM and file
+                }
+            }
+        }
+        else if (incoming == 62)
+        {
+            systemPrint("Enter NTRIP Client Read Task Core (0 or 1): ");
+            int ntripClientReadTaskCore = getNumber(); // Returns EXIT, TIMEOUT, or long
+            if ((ntripClientReadTaskCore != INPUT_RESPONSE_GETNUMBER_EXIT) &&
+                (ntripClientReadTaskCore != INPUT_RESPONSE_GETNUMBER_TIMEOUT))
+            {
+                if (ntripClientReadTaskCore < 0 || ntripClientReadTaskCore > 1)
+                    systemPrintln("Error: Core out of range");
+                else
+                {
+                    settings.ntripClientReadTaskCore = ntripClientReadTaskCore; // Recorded to NVM and file
+                    systemPrintln("The new core is used when the NTRIP Client restarts");
+                }
+            }
+        }
+        else if (incoming == 63)
+        {
+            systemPrint("Enter NTRIP Client Read Task Priority (0 to 3): ");
+            int ntripClientReadTaskPriority = getNumber(); // Returns EXIT, TIMEOUT, or long
+            if ((ntripClientReadTaskPriority != INPUT_RESPONSE_GETNUMBER_EXIT) &&
+                (ntripClientReadTaskPriority != INPUT_RESPONSE_GETNUMBER_TIMEOUT))
+            {
+                if (ntripClientReadTaskPriority < 0 || ntripClientReadTaskPriority > 3)
+                    systemPrintln("Error: Task priority out of range");
+                else
+                {
+                    settings.ntripClientReadTaskPriority = ntripClientReadTaskPriority; // Recorded to NVM and file
+                    systemPrintln("The new priority is used when the NTRIP Client restarts");
+                }
+            }
+        }
 
         // Menu exit control
         else if (incoming == 'x')
@@ -1232,9 +1394,12 @@ void menuPeriodicPrint()
         systemPrint("9) ZED TX data: ");
         systemPrintf("%s\r\n", PERIODIC_SETTING(PD_ZED_DATA_TX) ? "Enabled" : "Disabled");
 
+        systemPrint("10) ZED RX rate: ");
+        systemPrintf("%s\r\n", PERIODIC_SETTING(PD_ZED_DATA_RX_RATE) ? "Enabled" : "Disabled");
+
         systemPrintln("-----  Software  -----");
 
-        systemPrintf("20) Periodic print: %d (0x%08x)\r\n", settings.periodicDisplay, settings.periodicDisplay);
+        systemPrintf("20) Periodic print: %llu (0x%016llx)\r\n", settings.periodicDisplay, settings.periodicDisplay);
 
         systemPrintf("21) Interval (seconds): %d\r\n", settings.periodicDisplayInterval / 1000);
 
@@ -1253,6 +1418,9 @@ void menuPeriodicPrint()
         systemPrint("26) RTK state: ");
         systemPrintf("%s\r\n", settings.enablePrintState ? "Enabled" : "Disabled");
 
+        systemPrint("27) Correction source selection: ");
+        systemPrintf("%s\r\n", PERIODIC_SETTING(PD_CORRECTIONS_STATE) ? "Enabled" : "Disabled");
+
         systemPrintln("------  Clients  -----");
         systemPrint("40) NTP server data: ");
         systemPrintf("%s\r\n", PERIODIC_SETTING(PD_NTP_SERVER_DATA) ? "Enabled" : "Disabled");
@@ -1309,6 +1477,9 @@ void menuPeriodicPrint()
         systemPrint("74) sdSizeCheckTask state: ");
         systemPrintf("%s\r\n", PERIODIC_SETTING(PD_TASK_SD_SIZE_CHECK) ? "Enabled" : "Disabled");
 
+        systemPrint("75) ntripClientReadTask state: ");
+        systemPrintf("%s\r\n", PERIODIC_SETTING(PD_TASK_NTRIP_CLIENT_READ) ? "Enabled" : "Disabled");
+
         systemPrintln("x) Exit");
 
         byte incoming = getCharacterNumber();
@@ -1331,6 +1502,8 @@ void menuPeriodicPrint()
             PERIODIC_TOGGLE(PD_ZED_DATA_RX);
         else if (incoming == 9)
             PERIODIC_TOGGLE(PD_ZED_DATA_TX);
+        else if (incoming == 10)
+            PERIODIC_TOGGLE(PD_ZED_DATA_RX_RATE);
 
         else if (incoming == 20)
         {
@@ -1354,6 +1527,8 @@ void menuPeriodicPrint()
             settings.enablePrintPosition ^= 1;
         else if (incoming == 26)
             settings.enablePrintState ^= 1;
+        else if (incoming == 27)
+            PERIODIC_TOGGLE(PD_CORRECTIONS_STATE);
 
         else if (incoming == 40)
             PERIODIC_TOGGLE(PD_NTP_SERVER_DATA);
@@ -1392,6 +1567,8 @@ void menuPeriodicPrint()
             PERIODIC_TOGGLE(PD_TASK_HANDLE_GNSS_DATA);
         else if (incoming == 74)
             PERIODIC_TOGGLE(PD_TASK_SD_SIZE_CHECK);
+        else if (incoming == 75)
+            PERIODIC_TOGGLE(PD_TASK_NTRIP_CLIENT_READ);
 
         // Menu exit control
         else if (incoming == 'x')
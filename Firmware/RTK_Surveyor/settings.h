@@ -135,6 +135,75 @@ const int platformPrefixTableEntries = sizeof(platformPrefixTable) / sizeof(plat
 #define USE_MMC_MICROSD (productVariant == REFERENCE_STATION)
 #define USE_SPI_MICROSD (!USE_MMC_MICROSD)
 
+// The log file is written in multiples of the SD card sector size
+#define SD_SECTOR_SIZE 512
+#define SD_WRITE_HISTOGRAM_BUCKETS 16 // Log file write histograms: 0, 1, 2 - 3, 4 - 7, ...
+
+// Entry in the microSD card root directory index
+typedef struct _SD_DIRECTORY_ENTRY
+{
+    uint32_t nameOffset; // Offset of the file name in SD_DIRECTORY names
+    uint32_t size;       // Size of the file in bytes
+} SD_DIRECTORY_ENTRY;
+
+// microSD card root directory index, see SdDirectory.ino
+typedef struct _SD_DIRECTORY
+{
+    SD_DIRECTORY_ENTRY *entries; // Entries sorted by file name
+    int *sizeOrder;              // Entry indexes sorted by file size
+    int entryCount;              // Number of entries in use
+    int entryMax;                // Number of entries allocated
+    char *names;                 // Zero terminated file names
+    uint32_t namesLength;        // Number of bytes used in names
+    uint32_t namesMax;           // Number of bytes allocated for names
+    uint32_t namesUnused;        // Bytes in names belonging to removed entries
+    uint64_t totalBytes;         // Total size of the files
+    bool valid;                  // Set when the index matches the root directory
+} SD_DIRECTORY;
+
+class FileSdFatMMC;
+
+// Web file manager download, see FileDownload.ino.  The download task fills
+// readBuffer while the web server empties sendBuffer, the buffers are swapped
+// under the fileDownloadMutex.  The head and tail are byte counts from the
+// start of the download.
+typedef struct _FILE_DOWNLOAD
+{
+    FileSdFatMMC *file;   // File being downloaded
+    uint8_t *buffers;     // Allocation holding both buffers
+    uint8_t *readBuffer;  // Buffer filled by the download task
+    uint8_t *sendBuffer;  // Buffer emptied by the web server
+    uint32_t readBytes;   // Bytes in readBuffer, zero when the download task may fill it
+    uint32_t sendBytes;   // Bytes in sendBuffer
+    uint32_t sendOffset;  // Offset of the next byte to send from sendBuffer
+    uint32_t head;        // Number of bytes read from the file, written by the download task
+    uint32_t tail;        // Number of bytes sent to the browser, written by the web server
+    uint32_t offset;      // Offset in the file of the first byte to send
+    uint32_t length;      // Number of bytes to send
+    uint32_t startMillis; // Time the download started
+    bool inUse;           // Set while the download is assigned to a request
+    bool readError;       // Set when the microSD card read fails
+    bool releasePending;  // Download task closes the file when its read completes
+} FILE_DOWNLOAD;
+
+// Sort orders for the file list pages
+enum SdDirectorySort
+{
+    SD_DIRECTORY_SORT_NAME = 0, // Sort by file name, log files are in date order
+    SD_DIRECTORY_SORT_SIZE,     // Sort by file size
+};
+
+// Selects a page of files from the microSD card root directory index
+typedef struct _SD_DIRECTORY_QUERY
+{
+    int offset;            // Number of matching files to skip
+    int count;             // Maximum number of files in the page
+    uint8_t sort;          // Sort order, see SdDirectorySort
+    bool descending;       // Set to reverse the sort order
+    const char *extension; // File extension without the period, NULL or empty matches all files
+    const char *date;      // Log file date YYMMDD or a prefix such as YYMM, NULL or empty matches all files
+} SD_DIRECTORY_QUERY;
+
 // Macro to show if the the RTK variant has Ethernet
 #ifdef COMPILE_ETHERNET
 #define HAS_ETHERNET (productVariant == REFERENCE_STATION)
@@ -239,6 +308,7 @@ enum NetworkStates
 enum NetworkUsers
 {
     NETWORK_USER_NTP_SERVER = 0,      // NTP server
+    NETWORK_USER_NTRIP_CASTER,        // NTRIP caster
     NETWORK_USER_NTRIP_CLIENT,        // NTRIP client
     NETWORK_USER_OTA_FIRMWARE_UPDATE, // Over-The-Air firmware updates
     NETWORK_USER_PVT_CLIENT,          // PVT client
@@ -267,6 +337,15 @@ typedef struct _NETWORK_DATA
     uint32_t timerStart;       // Starting millis for the timer
 } NETWORK_DATA;
 
+// Define the handling of the PVT server clients that fall behind
+enum PvtServerSlowClientPolicy
+{
+    PVT_SERVER_SLOW_CLIENT_SKIP = 0,   // Skip ahead to the newest epoch
+    PVT_SERVER_SLOW_CLIENT_DISCONNECT, // Disconnect the client
+    // Add new policies above this line
+    PVT_SERVER_SLOW_CLIENT_MAX
+};
+
 // Even though WiFi and ESP-Now operate on the same radio, we treat
 // then as different states so that we can leave the radio on if
 // either WiFi or ESP-Now are active
@@ -282,6 +361,8 @@ volatile byte wifiState = WIFI_STATE_OFF;
 #include "NetworkClient.h" // Built-in - Supports both WiFiClient and EthernetClient
 #include "NetworkServer.h" // Built-in - Supports both WiFiServer and EthernetServer
 #include "NetworkUDP.h"    //Built-in - Supports both WiFiUdp and EthernetUdp
+#include "NtripHttp.h"     // HTTP layer for the NTRIP client, server and caster
+#include "NtripCaster.h"   // Embedded NTRIP caster
 
 // NTRIP Server data
 typedef struct _NTRIP_SERVER_DATA
@@ -308,9 +389,19 @@ typedef struct _NTRIP_SERVER_DATA
     uint32_t startTime;
     int connectionAttemptsTotal; // Count the number of connection attempts absolutely
 
-    // Additional count / times for ntripServerProcessRTCM
+    // Additional count / times for ntripServerSendRTCM
     uint32_t zedBytesSent ;
     uint32_t previousMilliseconds;
+    uint32_t writes;           // Number of writes to the NTRIP caster since the last display
+    uint32_t writeStartMillis; // Start of the write rate measurement
+    uint32_t filteredMessages; // RTCM messages removed by ntripServer_RtcmFilter
+
+    // NTRIP 2 and reconnection support
+    uint8_t version;           // NTRIP version used by the connection, 2 sends chunked data
+    IPAddress casterIp;        // Caster address from the last connection, skips the DNS lookup
+    char casterIpHost[50];     // Caster host name for casterIp
+    uint32_t connectTime;      // Milliseconds to connect and receive the authorization response
+    int fastReconnects;        // Reconnects made without delay
 } NTRIP_SERVER_DATA;
 
 typedef enum
@@ -323,20 +414,6 @@ typedef enum
 } ESPNOWState;
 volatile ESPNOWState espnowState = ESPNOW_OFF;
 
-typedef enum
-{
-    RTCM_TRANSPORT_STATE_WAIT_FOR_PREAMBLE_D3 = 0,
-    RTCM_TRANSPORT_STATE_READ_LENGTH_1,
-    RTCM_TRANSPORT_STATE_READ_LENGTH_2,
-    RTCM_TRANSPORT_STATE_READ_MESSAGE_1,
-    RTCM_TRANSPORT_STATE_READ_MESSAGE_2,
-    RTCM_TRANSPORT_STATE_READ_DATA,
-    RTCM_TRANSPORT_STATE_READ_CRC_1,
-    RTCM_TRANSPORT_STATE_READ_CRC_2,
-    RTCM_TRANSPORT_STATE_READ_CRC_3,
-    RTCM_TRANSPORT_STATE_CHECK_CRC
-} RtcmTransportState;
-
 typedef enum
 {
     RADIO_EXTERNAL = 0,
@@ -379,7 +456,12 @@ typedef struct WiFiNetwork
 
 #define MAX_WIFI_NETWORKS 4
 
-typedef uint16_t RING_BUFFER_OFFSET;
+#include "RingBuffer.h" // Single producer, multiple consumer ring buffer
+#include "LogCompress.h" // Compressed log file format
+#include "LogIndex.h"    // Log file seek index
+#include "LogRotate.h"   // Log file switch at an epoch boundary
+#include "RtcmStats.h"   // RTCM message statistics for the NTRIP client
+#include "CorrectionArbiter.h" // Correction source selection
 
 typedef enum
 {
@@ -458,6 +540,7 @@ typedef enum
     FUNCTION_LOG_CLOSURE,
     FUNCTION_PRINT_FILE_LIST,
     FUNCTION_NTPEVENT,
+    FUNCTION_FILEMANAGER_DOWNLOAD,
 
 } SemaphoreFunction;
 
@@ -507,7 +590,7 @@ typedef enum
 #define UBX_ID_NOT_AVAILABLE 0xFF
 
 // Define the periodic display values
-typedef uint32_t PeriodicDisplay_t;
+typedef uint64_t PeriodicDisplay_t;
 
 enum PeriodDisplayValues
 {
@@ -557,10 +640,16 @@ enum PeriodDisplayValues
     PD_ZED_DATA_TX, // 30
 
     PD_OTA_CLIENT_STATE, // 31
+
+    PD_ZED_DATA_RX_RATE, // 32
+
+    PD_TASK_NTRIP_CLIENT_READ, // 33
+
+    PD_CORRECTIONS_STATE, // 34
     // Add new values before this line
 };
 
-#define PERIODIC_MASK(x) (1 << x)
+#define PERIODIC_MASK(x) (((PeriodicDisplay_t)1) << x)
 #define PERIODIC_DISPLAY(x) (periodicDisplay & PERIODIC_MASK(x))
 #define PERIODIC_CLEAR(x) periodicDisplay &= ~PERIODIC_MASK(x)
 #define PERIODIC_SETTING(x) (settings.periodicDisplay & PERIODIC_MASK(x))
@@ -584,6 +673,12 @@ typedef struct
     const uint16_t f9rFirmwareVersionSupported;
 } ubxMsg;
 
+// Ring buffer consumers that filter the GNSS messages, bits in ubxMessageFilters
+#define MESSAGE_FILTER_BLUETOOTH (1 << 0)
+#define MESSAGE_FILTER_SD_CARD (1 << 1)
+#define MESSAGE_FILTER_NETWORK (1 << 2) // PVT client, PVT server and PVT UDP server
+#define MESSAGE_FILTER_OUTPUTS 3
+
 // Static array containing all the compatible messages
 const ubxMsg ubxMessages[] = {
     // NMEA
@@ -957,6 +1052,8 @@ typedef struct
     uint16_t spiFrequency = 16;                           // By default, use 16MHz SPI
     bool enableLogging = true;                            // If an SD card is present, log default sentences
     bool enableARPLogging = false;      // Log the Antenna Reference Position from RTCM 1005/1006 - if available
+    bool enableLogCompression = false;  // Write compressed .ubz log files, see LogCompress.ino
+    bool enableLogIndex = true;         // Write the .idx seek index beside each log file, see LogIndex.ino
     uint16_t ARPLoggingInterval_s = 10; // Log the ARP every 10 seconds - if available
     uint16_t sppRxQueueSize = 512 * 4;
     uint16_t sppTxQueueSize = 32;
@@ -975,6 +1072,9 @@ typedef struct
     bool enableUART2UBXIn = false;                             // UBX Protocol In on UART2
 
     uint8_t ubxMessageRates[MAX_UBX_MSG] = {254}; // Mark first record with key so defaults will be applied.
+    uint8_t ubxMessagePriorities[MAX_UBX_MSG] = {254}; // Ring buffer priority class, key applies the defaults
+    bool enableRingBufferReserves = true; // Reserve ring buffer space for the higher priority messages
+    uint8_t ubxMessageFilters[MAX_UBX_MSG] = {0}; // Outputs not receiving the message, MESSAGE_FILTER_* bits
 
     // Constellations monitored/used for fix
     ubxConstellation ubxConstellations[MAX_CONSTELLATIONS] = {
@@ -1036,7 +1136,7 @@ typedef struct
     RadioType_e radioType = RADIO_EXTERNAL;
     uint8_t espnowPeers[5][6] = {0}; // Max of 5 peers. Contains the MAC addresses (6 bytes) of paired units
     uint8_t espnowPeerCount = 0;
-    bool enableRtcmMessageChecking = false;
+    bool enableRtcmMessageChecking = false; // Display each RTCM message instead of the NTRIP server writes
     BluetoothRadioType_e bluetoothRadioType = BLUETOOTH_RADIO_SPP;
     bool runLogTest = false;           // When set to true, device will create a series of test logs
     bool espnowBroadcast = true;       // When true, overrides peers and sends all data via broadcast
@@ -1080,6 +1180,14 @@ typedef struct
     uint8_t btReadTaskCore = 1;             // Core where task should run, 0=core, 1=Arduino
     uint8_t gnssReadTaskCore = 1;           // Core where task should run, 0=core, 1=Arduino
     uint8_t handleGnssDataTaskCore = 1;     // Core where task should run, 0=core, 1=Arduino
+    uint8_t btWriteTaskPriority = 1; // Read from the circular buffer and write to BT SPP
+    uint8_t btWriteTaskCore = 1;     // Core where task should run, 0=core, 1=Arduino
+    uint8_t sdWriteTaskPriority = 1; // Read from the circular buffer and write to the SD card
+    uint8_t sdWriteTaskCore = 1;     // Core where task should run, 0=core, 1=Arduino
+    uint16_t sdWriteBufferSize = 8192; // Log file staging buffer, a multiple of 512 bytes from 512 to 32768
+    uint16_t sdPreallocateMB = 32;     // Contiguous space allocated when a log file is created, 0 = disabled
+    uint8_t ntripClientReadTaskPriority = 2; // Read from the NTRIP caster and write to GNSS. 3 being the highest
+    uint8_t ntripClientReadTaskCore = 1;     // Core where task should run, 0=core, 1=Arduino
     uint8_t gnssUartInterruptsCore =
         1; // Core where hardware is started and interrupts are assigned to, 0=core, 1=Arduino
     uint8_t bluetoothInterruptsCore =
@@ -1145,6 +1253,7 @@ typedef struct
     char ntripClient_MountPoint[50] = "bldr_SparkFun1";
     char ntripClient_MountPointPW[50] = "";
     bool ntripClient_TransmitGGA = true;
+    uint8_t ntripClient_NtripVersion = 2; // 1: ICY response, 2: HTTP/1.1 with Ntrip-GGA and chunked data
 
     // NTRIP Server
     bool debugNtripServerRtcm = false;
@@ -1181,6 +1290,24 @@ typedef struct
         "WR5wRo4H",
         "",
     };
+    char ntripServer_RtcmFilter[NTRIP_SERVER_MAX][50] = // RTCM messages not sent to the caster, ex: 1230,1074-1077
+    {
+        "",
+        "",
+    };
+    uint8_t ntripServer_NtripVersion[NTRIP_SERVER_MAX] = // 1: SOURCE with mount point PW, 2: POST with chunked data
+    {
+        1,
+        1,
+    };
+
+    // NTRIP Caster
+    bool debugNtripCaster = false;
+    bool enableNtripCaster = false;
+    uint16_t ntripCaster_Port = 2101;
+    char ntripCaster_MountPoint[50] = "bldr_SparkFun1";
+    char ntripCaster_User[50] = ""; // Rovers need no credentials when empty
+    char ntripCaster_UserPW[50] = "";
 
     // TCP Client
     bool debugPvtClient = false;
@@ -1192,6 +1319,9 @@ typedef struct
     bool debugPvtServer = false;
     bool enablePvtServer = false;
     uint16_t pvtServerPort = 2948; // PVT server port, 2948 is GPS Daemon: http://tcp-udp-ports.com/port-2948.htm
+    uint8_t pvtServerMaxClients = 4; // 1 - PVT_SERVER_MAX_CLIENTS, used after a restart
+    uint16_t pvtServerHighWater = 4096; // Bytes waiting for a client before it is behind
+    uint8_t pvtServerSlowClientPolicy = PVT_SERVER_SLOW_CLIENT_SKIP; // Handling of the clients that fall behind
     bool displayServerIP = true; // Also used by UDP Server
 
     // UDP Server
@@ -1203,6 +1333,13 @@ typedef struct
     uint8_t rtcmTimeoutBeforeUsingLBand_s =
         10; // If 10s have passed without RTCM, enable PMP corrections over L-Band if available
 
+    // Correction source selection
+    uint8_t correctionsSourcePriority[CORRECTION_SOURCE_MAX] = {0, 1, 2}; // Lower values are preferred
+    uint16_t correctionsSourceTimeout_ms = 3000; // Complete epoch age when a source becomes stale
+    uint16_t correctionsSwitchHoldoff_ms = 5000; // Time a preferred source is eligible before switching
+    uint16_t correctionsMaxLatency_ms = 5000;    // Largest average source latency, 0 = no limit
+    bool debugCorrections = false;
+
     // Automatic Firmware Update
     bool debugFirmwareUpdate = false;
     bool enableAutoFirmwareUpdate = false;
@@ -1233,6 +1370,7 @@ struct struct_online
     bool rtc = false;
     bool battery = false;
     bool accelerometer = false;
+    bool ntripCaster = false;
     bool ntripClient = false;
     bool ntripServer[NTRIP_SERVER_MAX] = {false, false};
     bool lband = false;
@@ -463,15 +463,10 @@ void printTimeStamp()
     }
 }
 
-// Parse the RTCM transport data
-// Called by processRTCM in Base.ino - defines whether the data is passed to the NTRIP server
-bool checkRtcmMessage(uint8_t data)
+// Verify a complete RTCM message
+// Called by rtcmFrameAddByte in Base.ino - defines whether the message is passed to the NTRIP servers
+bool checkRtcmMessage(const uint8_t *message, uint16_t length)
 {
-    static uint16_t bytesRemaining;
-    static uint16_t length;
-    static uint16_t message;
-    static bool sendMessage = false;
-
     //    RTCM Standard 10403.2 - Chapter 4, Transport Layer
     //
     //    |<------------- 3 bytes ------------>|<----- length ----->|<- 3 bytes ->|
@@ -485,95 +480,70 @@ bool checkRtcmMessage(uint8_t data)
     //    |<------------------------ CRC -------------------------->|
     //
 
-    switch (rtcmParsingState)
+    // Compute the CRC over the message, the CRC bytes included, the result is
+    // zero when the message is valid
+    uint32_t crc = crc24qSpan(0, message, length);
+    uint16_t messageNumber = (length > 4) ? (message[3] << 4) | (message[4] >> 4) : 0;
+
+    // Display the RTCM message header, replacing the NTRIP server write display
+    if (settings.debugNtripServerRtcm && settings.enableRtcmMessageChecking && (!inMainMenu))
     {
-    // Read the upper two bits of the length
-    case RTCM_TRANSPORT_STATE_READ_LENGTH_1:
-        // Verify the length byte - check the 6 MS bits are all zero
-        if (!(data & (~3)))
-        {
-            length = data << 8;
-            rtcmParsingState = RTCM_TRANSPORT_STATE_READ_LENGTH_2;
-            break;
-        }
+        printTimeStamp();
+        systemPrintf("    Tx RTCM %d, %2d bytes%s\r\n", messageNumber, length, crc ? ", bad CRC" : "");
+    }
 
-        // Wait for the preamble byte
-        rtcmParsingState = RTCM_TRANSPORT_STATE_WAIT_FOR_PREAMBLE_D3;
+    // Discard the message when the CRC is bad
+    if (crc)
+    {
+        rtcmCrcErrors++;
+        return false;
+    }
+    return true;
+}
 
-    // Fall through
-    //      |
-    //      |
-    //      V
+// Determine if the RTCM message number is in the filter list
+// The filter is a list of message numbers and ranges, ex: 1230,1074-1077
+bool rtcmMessageFiltered(const char *filter, uint16_t messageNumber)
+{
+    char *end;
+    long first;
+    long last;
 
-    // Wait for the preamble byte (0xd3)
-    case RTCM_TRANSPORT_STATE_WAIT_FOR_PREAMBLE_D3:
-        sendMessage = false;
-        if (data == 0xd3)
+    while (*filter)
+    {
+        // Get the first message number of the range
+        first = strtol(filter, &end, 10);
+        if (end == filter)
         {
-            rtcmParsingState = RTCM_TRANSPORT_STATE_READ_LENGTH_1;
-            sendMessage = true;
+            // Skip the separator
+            filter++;
+            continue;
         }
-        break;
-
-    // Read the lower 8 bits of the length
-    case RTCM_TRANSPORT_STATE_READ_LENGTH_2:
-        length |= data;
-        bytesRemaining = length;
-        rtcmParsingState = RTCM_TRANSPORT_STATE_READ_MESSAGE_1;
-        break;
-
-    // Read the upper 8 bits of the message number
-    case RTCM_TRANSPORT_STATE_READ_MESSAGE_1:
-        message = data << 4;
-        bytesRemaining -= 1;
-        rtcmParsingState = RTCM_TRANSPORT_STATE_READ_MESSAGE_2;
-        break;
-
-    // Read the lower 4 bits of the message number
-    case RTCM_TRANSPORT_STATE_READ_MESSAGE_2:
-        message |= data >> 4;
-        bytesRemaining -= 1;
-        rtcmParsingState = RTCM_TRANSPORT_STATE_READ_DATA;
-        break;
-
-    // Read the rest of the message
-    case RTCM_TRANSPORT_STATE_READ_DATA:
-        bytesRemaining -= 1;
-        if (bytesRemaining <= 0)
-            rtcmParsingState = RTCM_TRANSPORT_STATE_READ_CRC_1;
-        break;
-
-    // Read the upper 8 bits of the CRC
-    case RTCM_TRANSPORT_STATE_READ_CRC_1:
-        rtcmParsingState = RTCM_TRANSPORT_STATE_READ_CRC_2;
-        break;
-
-    // Read the middle 8 bits of the CRC
-    case RTCM_TRANSPORT_STATE_READ_CRC_2:
-        rtcmParsingState = RTCM_TRANSPORT_STATE_READ_CRC_3;
-        break;
-
-    // Read the lower 8 bits of the CRC
-    case RTCM_TRANSPORT_STATE_READ_CRC_3:
-        rtcmParsingState = RTCM_TRANSPORT_STATE_CHECK_CRC;
-        break;
-    }
-
-    // Check the CRC. Note: this doesn't actually check the CRC!
-    if (rtcmParsingState == RTCM_TRANSPORT_STATE_CHECK_CRC)
-    {
-        rtcmParsingState = RTCM_TRANSPORT_STATE_WAIT_FOR_PREAMBLE_D3;
 
-        // Display the RTCM message header
-        if (settings.debugNtripServerRtcm && (!inMainMenu))
+        // Get the last message number of the range
+        last = first;
+        if (*end == '-')
         {
-            printTimeStamp();
-            systemPrintf("    Tx RTCM %d, %2d bytes\r\n", message, 3 + length + 3);
+            filter = end + 1;
+            last = strtol(filter, &end, 10);
+            if (end == filter)
+                last = first;
         }
+        filter = end;
+
+        if ((messageNumber >= first) && (messageNumber <= last))
+            return true;
     }
+    return false;
+}
 
-    // Let the upper layer know if this message should be sent
-    return sendMessage;
+// Return the length of the RTCM message at the beginning of the data, data
+// not starting with the preamble is returned one byte at a time
+uint16_t rtcmMessageLength(const uint8_t *data, uint16_t length)
+{
+    if ((length < 3) || (data[0] != 0xd3))
+        return 1;
+    return 3 + (((data[1] & 3) << 8) | data[2]) + 3;
 }
 
 const double WGS84_A = 6378137;           // https://geographiclib.sourceforge.io/html/Constants_8hpp_source.html
@@ -723,9 +693,17 @@ void dumpBuffer(uint8_t *buffer, uint16_t length)
 
 // Make size of files human readable
 void stringHumanReadableSize(String &returnText, uint64_t bytes)
+{
+    char readableSize[50];
+
+    formatHumanReadableSize(readableSize, sizeof(readableSize), bytes);
+    returnText = String(readableSize);
+}
+
+// Make size of files human readable, the text is placed in the caller's buffer
+void formatHumanReadableSize(char *readableSize, size_t readableSizeLength, uint64_t bytes)
 {
     char suffix[5] = {'\0'};
-    char readableSize[50] = {'\0'};
     float cardSize = 0.0;
 
     if (bytes < 1024)
@@ -747,15 +725,13 @@ void stringHumanReadableSize(String &returnText, uint64_t bytes)
         cardSize = bytes / 1024.0 / 1024.0 / 1024.0; // GB
 
     if (strcmp(suffix, "GB") == 0)
-        snprintf(readableSize, sizeof(readableSize), "%0.1f %s", cardSize, suffix); // Print decimal portion
+        snprintf(readableSize, readableSizeLength, "%0.1f %s", cardSize, suffix); // Print decimal portion
     else if (strcmp(suffix, "MB") == 0)
-        snprintf(readableSize, sizeof(readableSize), "%0.1f %s", cardSize, suffix); // Print decimal portion
+        snprintf(readableSize, readableSizeLength, "%0.1f %s", cardSize, suffix); // Print decimal portion
     else if (strcmp(suffix, "KB") == 0)
-        snprintf(readableSize, sizeof(readableSize), "%0.1f %s", cardSize, suffix); // Print decimal portion
+        snprintf(readableSize, readableSizeLength, "%0.1f %s", cardSize, suffix); // Print decimal portion
     else
-        snprintf(readableSize, sizeof(readableSize), "%.0f %s", cardSize, suffix); // Don't print decimal portion
-
-    returnText = String(readableSize);
+        snprintf(readableSize, readableSizeLength, "%.0f %s", cardSize, suffix); // Don't print decimal portion
 }
 
 // Print the NMEA checksum error
@@ -847,12 +823,13 @@ void verifyTables()
 
     // Verify the consistency of the internal tables
     ethernetVerifyTables();
+    messagePriorityVerifyTables();
     networkVerifyTables();
     ntpValidateTables();
+    ntripCasterValidateTables();
     ntripClientValidateTables();
     ntripServerValidateTables();
     otaVerifyTables();
     pvtClientValidateTables();
     pvtServerValidateTables();
-    tasksValidateTables();
 }
@@ -0,0 +1,736 @@
+// Correction_Arbiter_Simulator.c
+//
+// Replay correction streams from several sources through the firmware
+// message parser and correction arbiter, inject gaps and verify the
+// switchover times.
+//
+// Each source replays the same base station stream with its own latency,
+// jitter and gaps.  The station ID is rewritten in every message and the
+// station position in the 1005 and 1006 messages so that each source looks
+// like a different base.  The stream is split at random points before being
+// passed to the parser.  A model of the GNSS receives the messages selected
+// by the arbiter and verifies that each epoch is complete, comes from a
+// single source and follows the station position of the same base.  The selection changes are compared with the expected switchover
+// windows for the configured timeout and holdoff times.
+//
+// The base station stream is either synthetic or read from a recorded RTCM
+// file.  The recorded messages are grouped into epochs and replayed in a
+// loop, the epoch times are rewritten and the CRC is recomputed so that all
+// of the sources follow the simulated GPS time.
+//
+//    Correction_Arbiter_Simulator [seed [recording.rtcm]]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PARSE_NMEA_MESSAGES
+#define PARSE_RTCM_MESSAGES
+#define PARSE_UBLOX_MESSAGES
+
+#include "../RTK_Surveyor/GpsMessageParser.h"
+#include "../RTK_Surveyor/RtcmStats.h"
+#include "../RTK_Surveyor/CorrectionArbiter.h"
+
+#define LEAP_SECONDS        18
+#define MAX_EPOCH_FRAMES    32
+#define MAX_EPOCH_BYTES     (16 * 1024)
+#define MAX_EPOCHS          64
+#define MAX_EVENTS          32
+#define MAX_GAPS            4
+#define MS_PER_HOUR         (60 * 60 * 1000)
+#define START_TOW           (RTCM_STATS_MS_PER_WEEK - (300 * 1000)) // Cross the week boundary
+#define STATION_ID          100     // Station ID of the first source
+#define STATION_X           0x12345678 // ECEF X of the first source, low 32 bits
+#define UPDATE_MSEC         100     // correctionsUpdate call interval
+
+//----------------------------------------
+// Firmware stubs
+//----------------------------------------
+
+struct
+{
+    bool enablePrintBadMessages;
+} settings;
+
+bool inMainMenu;
+uint16_t failedParserMessages_NMEA;
+uint16_t failedParserMessages_RTCM;
+uint16_t failedParserMessages_UBX;
+
+int AsciiToNibble(int data)
+{
+    // Convert the value to lower case
+    data |= 0x20;
+    if ((data >= 'a') && (data <= 'f'))
+        return data - 'a' + 10;
+    if ((data >= '0') && (data <= '9'))
+        return data - '0';
+    return -1;
+}
+
+void printNmeaChecksumError(PARSE_STATE *parse) {}
+void printRtcmChecksumError(PARSE_STATE *parse) {}
+void printRtcmMaxLength(PARSE_STATE *parse) {}
+void printUbloxChecksumError(PARSE_STATE *parse) {}
+void printUbloxInvalidData(PARSE_STATE *parse) {}
+
+GPS_PARSE_TABLE
+
+#include "../RTK_Surveyor/GpsMessageParser.ino"
+#include "../RTK_Surveyor/Parse_NMEA.ino"
+#include "../RTK_Surveyor/Parse_RTCM.ino"
+#include "../RTK_Surveyor/Parse_UBLOX.ino"
+#include "../RTK_Surveyor/RtcmStats.ino"
+#include "../RTK_Surveyor/CorrectionArbiter.ino"
+
+//----------------------------------------
+// Types
+//----------------------------------------
+
+// Messages sent by the base station for one epoch
+typedef struct _EPOCH
+{
+    uint8_t data[MAX_EPOCH_BYTES];
+    int length;
+    int frames;
+    int offset[MAX_EPOCH_FRAMES];   // Start of each message in data
+    int lastObservation;            // Index of the last observation message
+} EPOCH;
+
+// Time range in seconds without data from the source
+typedef struct _GAP
+{
+    int start;
+    int end;
+} GAP;
+
+typedef struct _SOURCE_CONFIG
+{
+    int latencyMsec;                // Delay from the epoch time to the arrival
+    int jitterMsec;                 // Random additional delay
+    int incompleteUntil;            // Drop the last observation message until this time in seconds
+    GAP gap[MAX_GAPS];              // Time ranges without data
+} SOURCE_CONFIG;
+
+// Expected selection change
+typedef struct _EXPECTED
+{
+    uint8_t source;
+    uint32_t startMsec;             // Earliest time for the change
+    uint32_t endMsec;               // Latest time for the change
+} EXPECTED;
+
+typedef struct _SCENARIO
+{
+    const char * name;
+    int seconds;
+    uint32_t maxLatencyMsec;
+    SOURCE_CONFIG source[CORRECTION_SOURCE_MAX];
+    EXPECTED expected[8];
+    int expectedChanges;
+    uint32_t fallbackStartMsec;     // Earliest time for the final fallback, zero when not expected
+    uint32_t fallbackEndMsec;
+} SCENARIO;
+
+// Model of the GNSS receiving the corrections
+typedef struct _GNSS
+{
+    bool epochOpen;                 // More observation messages follow
+    bool epochValid;                // epochMsec is valid
+    uint8_t source;                 // Source of the current epoch
+    uint32_t epochMsec;             // Time of day of the current epoch
+    uint32_t lastEpochMsec;         // Arrival time of the last complete epoch
+    uint32_t longestOutage;         // Longest time between complete epochs
+    int changes;
+    uint8_t changeSource[MAX_EVENTS];
+    uint32_t changeMsec[MAX_EVENTS];
+    uint32_t changeOutage[MAX_EVENTS]; // Time since the previous complete epoch
+    bool stationValid;              // stationId and stationX are valid
+    uint16_t stationId;             // Station ID of the last 1005 or 1006
+    uint32_t stationX;              // ECEF X of the last 1005 or 1006, low 32 bits
+    int wrongStation;               // Observations from a base other than the station position
+    int mixedEpochs;                // Epochs containing messages from two sources
+    int partialEpochs;              // Epochs missing observation messages
+    int olderEpochs;                // Epochs older than the previous epoch
+} GNSS;
+
+//----------------------------------------
+// Locals
+//----------------------------------------
+
+const uint16_t observationMessages[] = {1074, 1084, 1094, 1124};
+
+CORRECTION_ARBITER arbiter;
+EPOCH epochs[MAX_EPOCHS];
+int epochCount;
+int errors;
+GNSS gnss;
+uint8_t parseSource;                // Source of the data passed to the parser
+uint32_t simulationMsec;            // millis() value
+
+//----------------------------------------
+// Support routines
+//----------------------------------------
+
+// Display the test result
+void check (bool passed, const char * test)
+{
+    if (!passed)
+    {
+        printf ("FAIL: %s\n", test);
+        errors += 1;
+    }
+}
+
+// Set a bit field in the RTCM payload
+void setBits (uint8_t * payload, int start, int width, uint32_t value)
+{
+    int bit;
+
+    for (bit = start + width - 1; bit >= start; bit--)
+    {
+        if (value & 1)
+            payload[bit >> 3] |= 0x80 >> (bit & 7);
+        else
+            payload[bit >> 3] &= ~(0x80 >> (bit & 7));
+        value >>= 1;
+    }
+}
+
+// Set the CRC of the RTCM message
+void setCrc (uint8_t * frame, int length)
+{
+    uint32_t crc;
+
+    crc = crc24qSpan (0, frame, length - 3);
+    frame[length - 3] = crc >> 16;
+    frame[length - 2] = crc >> 8;
+    frame[length - 1] = crc;
+}
+
+// Write the epoch time into the RTCM message and update the CRC
+void stampMessage (uint8_t * frame, int length, uint32_t gpsTow)
+{
+    uint32_t msec;
+    uint16_t number;
+    uint8_t * payload;
+
+    // Skip the messages without an epoch time
+    number = rtcmStatsMessageNumber (frame, length);
+    payload = &frame[3];
+    if (!(((number >= 1001) && (number <= 1004)) || ((number >= 1009) && (number <= 1012))
+          || ((number >= 1071) && (number <= 1137) && ((number % 10) >= 1) && ((number % 10) <= 7))))
+        return;
+    if ((number >= 1009) && (number <= 1012))
+    {
+        msec = (gpsTow + RTCM_STATS_MS_PER_WEEK - (LEAP_SECONDS * 1000) + 3 * MS_PER_HOUR) % RTCM_STATS_MS_PER_DAY;
+        setBits (payload, 24, 27, msec);
+    }
+    else if ((number >= 1081) && (number <= 1087))
+    {
+        msec = (gpsTow + RTCM_STATS_MS_PER_WEEK - (LEAP_SECONDS * 1000) + 3 * MS_PER_HOUR) % RTCM_STATS_MS_PER_WEEK;
+        setBits (payload, 24, 3, msec / RTCM_STATS_MS_PER_DAY);
+        setBits (payload, 27, 27, msec % RTCM_STATS_MS_PER_DAY);
+    }
+    else if ((number >= 1121) && (number <= 1127))
+        setBits (payload, 24, 30, (gpsTow + RTCM_STATS_MS_PER_WEEK - 14000) % RTCM_STATS_MS_PER_WEEK);
+    else
+        setBits (payload, 24, 30, gpsTow);
+    setCrc (frame, length);
+}
+
+// Determine if the message starts with the reference station ID
+bool hasStationId (uint16_t number)
+{
+    return ((number >= 1001) && (number <= 1012)) || (number == 1033)
+           || ((number >= 1071) && (number <= 1137)) || (number == 1230);
+}
+
+// Give the message the station ID of the source, the 1005 and 1006 messages
+// also get the station position of the source
+void stampStation (uint8_t * frame, int length, uint8_t source)
+{
+    uint16_t number;
+    uint8_t * payload;
+
+    number = rtcmStatsMessageNumber (frame, length);
+    if (!hasStationId (number))
+        return;
+    payload = &frame[3];
+    setBits (payload, 12, 12, STATION_ID + source);
+    if ((number == 1005) || (number == 1006))
+    {
+        setBits (payload, 34, 6, 0);
+        setBits (payload, 40, 32, STATION_X + source);
+    }
+    setCrc (frame, length);
+}
+
+// Add an RTCM message to the epoch
+void addFrame (EPOCH * epoch, const uint8_t * frame, int length)
+{
+    if ((epoch->frames >= MAX_EPOCH_FRAMES) || ((epoch->length + length) > MAX_EPOCH_BYTES))
+        return;
+    epoch->offset[epoch->frames] = epoch->length;
+    memcpy (&epoch->data[epoch->length], frame, length);
+    epoch->length += length;
+    epoch->frames += 1;
+}
+
+// Build a synthetic RTCM message
+int buildMessage (uint8_t * frame, uint16_t number, int payloadLength, bool more)
+{
+    int index;
+    uint8_t * payload;
+
+    payload = &frame[3];
+    for (index = 0; index < payloadLength; index++)
+        payload[index] = rand ();
+    setBits (payload, 0, 12, number);
+    setBits (payload, 12, 12, 1234);
+    if ((number >= 1009) && (number <= 1012))
+        setBits (payload, 24 + 27, 1, more);
+    else
+        setBits (payload, 24 + 30, 1, more);
+    frame[0] = 0xd3;
+    frame[1] = payloadLength >> 8;
+    frame[2] = payloadLength & 0xff;
+    setCrc (frame, payloadLength + 6);
+    return payloadLength + 6;
+}
+
+// Build a synthetic base station stream: 1005, 1033 and 1230 every 10 epochs
+// followed by the MSM4 messages for GPS, GLONASS, Galileo and BeiDou
+void buildEpochs (void)
+{
+    EPOCH * epoch;
+    uint8_t frame[1100];
+    int index;
+    int length;
+
+    epochCount = 10;
+    for (index = 0; index < epochCount; index++)
+    {
+        epoch = &epochs[index];
+        if (index == 0)
+        {
+            addFrame (epoch, frame, buildMessage (frame, 1005, 19, false));
+            addFrame (epoch, frame, buildMessage (frame, 1033, 40, false));
+            addFrame (epoch, frame, buildMessage (frame, 1230, 8, false));
+        }
+        for (length = 0; length < 4; length++)
+            addFrame (epoch, frame, buildMessage (frame, observationMessages[length], 20 + (rand () % 300), length < 3));
+        epoch->lastObservation = epoch->frames - 1;
+    }
+}
+
+//----------------------------------------
+// Recorded stream
+//----------------------------------------
+
+// Group the recorded messages into epochs, the messages without an epoch time
+// are added to the following epoch
+void recordedMessage (PARSE_STATE * parse, uint8_t type)
+{
+    static uint32_t currentEpoch;
+    static bool epochOpen;
+    uint32_t epochMsec;
+
+    if ((type != SENTENCE_TYPE_RTCM) || (epochCount >= MAX_EPOCHS))
+        return;
+    if (rtcmStatsEpoch (parse->buffer, parse->length, LEAP_SECONDS, &epochMsec))
+    {
+        epochMsec %= RTCM_STATS_MS_PER_DAY;
+        if (epochOpen && (epochMsec != currentEpoch) && (epochCount < (MAX_EPOCHS - 1)))
+            epochCount += 1;
+        epochOpen = true;
+        currentEpoch = epochMsec;
+        addFrame (&epochs[epochCount], parse->buffer, parse->length);
+        epochs[epochCount].lastObservation = epochs[epochCount].frames - 1;
+    }
+    else
+    {
+        if (epochOpen)
+        {
+            epochOpen = false;
+            epochCount += 1;
+        }
+        if (epochCount < MAX_EPOCHS)
+            addFrame (&epochs[epochCount], parse->buffer, parse->length);
+    }
+}
+
+bool readRecording (const char * fileName)
+{
+    uint8_t data[4096];
+    FILE * file;
+    int frame;
+    int index;
+    int length;
+    uint16_t number;
+    PARSE_STATE parse;
+    static uint8_t parseBuffer[PARSE_BUFFER_LENGTH];
+    bool station;
+
+    file = fopen (fileName, "rb");
+    if (!file)
+    {
+        perror (fileName);
+        return false;
+    }
+    memset (&parse, 0, sizeof(parse));
+    parse.state = gpsMessageParserFirstByte;
+    parse.eomCallback = recordedMessage;
+    parse.parserName = "Recording";
+    parse.buffer = parseBuffer;
+    while ((epochCount < MAX_EPOCHS) && ((length = fread (data, 1, sizeof(data), file)) > 0))
+        gpsMessageParserProcessBuffer (&parse, data, length);
+    fclose (file);
+
+    // The last epoch may be partial and is not replayed, the station
+    // position is required
+    station = false;
+    for (index = 0; index < epochCount; index++)
+        for (frame = 0; frame < epochs[index].frames; frame++)
+        {
+            number = rtcmStatsMessageNumber (&epochs[index].data[epochs[index].offset[frame]],
+                                             RTCM_STATS_HEADER_BYTES + 2 + RTCM_STATS_CRC_BYTES);
+            station |= (number == 1005) || (number == 1006);
+        }
+    printf ("%s: %d epochs\n", fileName, epochCount);
+    if ((!epochCount) || (!station))
+    {
+        printf ("ERROR - The recording must contain observation messages and a 1005 or 1006 message\n");
+        return false;
+    }
+    return true;
+}
+
+//----------------------------------------
+// GNSS model
+//----------------------------------------
+
+// Verify the messages passed to the GNSS
+void gnssMessage (const uint8_t * message, int length)
+{
+    uint32_t epochMsec;
+    uint16_t number;
+    uint16_t stationId;
+
+    // Save the station position
+    number = rtcmStatsMessageNumber (message, length);
+    if ((number == 1005) || (number == 1006))
+    {
+        gnss.stationValid = true;
+        gnss.stationId = rtcmStatsBits (&message[3], 12, 12);
+        gnss.stationX = rtcmStatsBits (&message[3], 40, 32);
+    }
+
+    if (!rtcmStatsEpoch (message, length, LEAP_SECONDS, &epochMsec))
+        return;
+    epochMsec %= RTCM_STATS_MS_PER_DAY;
+
+    // The observations must come from the base at the station position
+    stationId = rtcmStatsBits (&message[3], 12, 12);
+    if ((!gnss.stationValid) || (stationId != gnss.stationId)
+        || (gnss.stationX != (STATION_X + stationId - STATION_ID)))
+        gnss.wrongStation += 1;
+
+    // Start of a new epoch
+    if ((!gnss.epochValid) || (epochMsec != gnss.epochMsec))
+    {
+        if (gnss.epochOpen)
+            gnss.partialEpochs += 1;
+        if (gnss.epochValid && (!correctionArbiterNewer (epochMsec, gnss.epochMsec)))
+            gnss.olderEpochs += 1;
+
+        // Record the source changes
+        if (((!gnss.epochValid) || (gnss.source != parseSource)) && (gnss.changes < MAX_EVENTS))
+        {
+            gnss.changeSource[gnss.changes] = parseSource;
+            gnss.changeMsec[gnss.changes] = simulationMsec;
+            gnss.changeOutage[gnss.changes] = gnss.epochValid ? simulationMsec - gnss.lastEpochMsec : 0;
+            gnss.changes += 1;
+        }
+        gnss.epochValid = true;
+        gnss.epochMsec = epochMsec;
+        gnss.source = parseSource;
+    }
+    else if (gnss.source != parseSource)
+        gnss.mixedEpochs += 1;
+
+    // End of the epoch
+    gnss.epochOpen = rtcmStatsMoreMessages (message, length);
+    if (!gnss.epochOpen)
+    {
+        if (gnss.lastEpochMsec && ((simulationMsec - gnss.lastEpochMsec) > gnss.longestOutage))
+            gnss.longestOutage = simulationMsec - gnss.lastEpochMsec;
+        gnss.lastEpochMsec = simulationMsec;
+    }
+}
+
+// Pass the selected messages to the GNSS, called by the parser
+void sourceMessage (PARSE_STATE * parse, uint8_t type)
+{
+    int32_t gpsTow;
+    const uint8_t * station;
+    uint16_t stationLength;
+
+    if (type != SENTENCE_TYPE_RTCM)
+        return;
+    gpsTow = (START_TOW + simulationMsec) % RTCM_STATS_MS_PER_WEEK;
+    if (correctionArbiterRtcm (&arbiter, parseSource, parse->buffer, parse->length, simulationMsec, gpsTow,
+                               LEAP_SECONDS))
+    {
+        while ((station = correctionArbiterStation (&arbiter, &stationLength)))
+            gnssMessage (station, stationLength);
+        gnssMessage (parse->buffer, parse->length);
+    }
+}
+
+//----------------------------------------
+// Simulation
+//----------------------------------------
+
+// Determine if the source is in a gap
+bool inGap (const SOURCE_CONFIG * config, int epoch)
+{
+    int index;
+
+    for (index = 0; index < MAX_GAPS; index++)
+        if ((epoch >= config->gap[index].start) && (epoch < config->gap[index].end))
+            return true;
+    return false;
+}
+
+// Deliver one epoch from the source, split at random points
+void deliverEpoch (PARSE_STATE * parse, uint8_t source, const SOURCE_CONFIG * config, int epochNumber)
+{
+    static uint8_t data[MAX_EPOCH_BYTES];
+    const EPOCH * epoch;
+    int end;
+    int frame;
+    int length;
+    int offset;
+    int piece;
+
+    // Rewrite the epoch times, drop the last observation message when
+    // simulating an incomplete stream
+    epoch = &epochs[epochNumber % epochCount];
+    length = 0;
+    for (frame = 0; frame < epoch->frames; frame++)
+    {
+        if ((frame == epoch->lastObservation) && (epochNumber < config->incompleteUntil))
+            continue;
+        end = (frame + 1 < epoch->frames) ? epoch->offset[frame + 1] : epoch->length;
+        memcpy (&data[length], &epoch->data[epoch->offset[frame]], end - epoch->offset[frame]);
+        stampMessage (&data[length], end - epoch->offset[frame],
+                      (START_TOW + (uint32_t)epochNumber * 1000) % RTCM_STATS_MS_PER_WEEK);
+        stampStation (&data[length], end - epoch->offset[frame], source);
+        length += end - epoch->offset[frame];
+    }
+
+    // Pass the data to the parser
+    for (offset = 0; offset < length; offset += piece)
+    {
+        piece = 1 + (rand () % 600);
+        if (piece > (length - offset))
+            piece = length - offset;
+        gpsMessageParserProcessBuffer (parse, &data[offset], piece);
+    }
+}
+
+// Run the scenario and verify the selection changes
+void runScenario (const SCENARIO * scenario)
+{
+    uint32_t arrival[CORRECTION_SOURCE_MAX];
+    uint32_t endMsec;
+    int expected;
+    bool fallback;
+    uint32_t fallbackMsec;
+    int index;
+    char name[128];
+    int next[CORRECTION_SOURCE_MAX];
+    PARSE_STATE parse[CORRECTION_SOURCE_MAX];
+    static uint8_t parseBuffer[CORRECTION_SOURCE_MAX][PARSE_BUFFER_LENGTH];
+    const SOURCE_CONFIG * config;
+    uint8_t source;
+
+    printf ("%s\n", scenario->name);
+    memset (&gnss, 0, sizeof(gnss));
+    correctionArbiterInit (&arbiter);
+    arbiter.timeoutMsec = 3000;
+    arbiter.holdoffMsec = 5000;
+    arbiter.maxLatencyMsec = scenario->maxLatencyMsec;
+    arbiter.fallbackMsec = 10000;
+    for (source = 0; source < CORRECTION_SOURCE_MAX; source++)
+    {
+        memset (&parse[source], 0, sizeof(parse[source]));
+        parse[source].state = gpsMessageParserFirstByte;
+        parse[source].eomCallback = sourceMessage;
+        parse[source].parserName = correctionArbiterSourceName (source);
+        parse[source].buffer = parseBuffer[source];
+        correctionArbiterAvailable (&arbiter, source, true);
+        next[source] = 0;
+        arrival[source] = scenario->source[source].latencyMsec;
+    }
+
+    // Step the simulated time one millisecond at a time
+    fallback = arbiter.fallback;
+    fallbackMsec = 0;
+    endMsec = scenario->seconds * 1000;
+    for (simulationMsec = 0; simulationMsec < endMsec; simulationMsec++)
+    {
+        for (source = 0; source < CORRECTION_SOURCE_MAX; source++)
+        {
+            config = &scenario->source[source];
+            while (arrival[source] <= simulationMsec)
+            {
+                if (!inGap (config, next[source]))
+                {
+                    parseSource = source;
+                    deliverEpoch (&parse[source], source, config, next[source]);
+                }
+                next[source] += 1;
+                arrival[source] = next[source] * 1000 + config->latencyMsec
+                                + (config->jitterMsec ? rand () % config->jitterMsec : 0);
+            }
+        }
+        if ((simulationMsec % UPDATE_MSEC) == 0)
+        {
+            correctionArbiterUpdate (&arbiter, simulationMsec);
+            if (arbiter.fallback && (!fallback))
+                fallbackMsec = simulationMsec;
+            fallback = arbiter.fallback;
+        }
+    }
+
+    // Display the selection changes
+    for (index = 0; index < gnss.changes; index++)
+        printf ("    %7.3f s: %-12s outage %5.3f s\n", gnss.changeMsec[index] / 1000.,
+                correctionArbiterSourceName (gnss.changeSource[index]), gnss.changeOutage[index] / 1000.);
+    if (fallbackMsec)
+        printf ("    %7.3f s: Radio and L-Band fallback enabled\n", fallbackMsec / 1000.);
+    for (source = 0; source < CORRECTION_SOURCE_MAX; source++)
+        printf ("    %-12s %5u messages, %5u pushed, %5u discarded, %4u complete, %4u incomplete epochs, latency %d ms\n",
+                correctionArbiterSourceName (source), arbiter.source[source].messages, arbiter.source[source].pushed,
+                arbiter.source[source].discarded, arbiter.source[source].epochsComplete,
+                arbiter.source[source].epochsIncomplete, arbiter.source[source].latencyMsec);
+
+    // Verify the GNSS data
+    check (gnss.mixedEpochs == 0, "Epochs from a single source");
+    check (gnss.partialEpochs == 0, "Complete epochs");
+    check (gnss.olderEpochs == 0, "Epochs in time order");
+    check (gnss.wrongStation == 0, "Observations match the station position");
+
+    // Verify the switchover times
+    check (gnss.changes == scenario->expectedChanges, "Number of source changes");
+    for (expected = 0; (expected < scenario->expectedChanges) && (expected < gnss.changes); expected++)
+    {
+        snprintf (name, sizeof(name), "Change %d to %s at %u ms, expected %u - %u ms", expected + 1,
+                  correctionArbiterSourceName (gnss.changeSource[expected]), gnss.changeMsec[expected],
+                  scenario->expected[expected].startMsec, scenario->expected[expected].endMsec);
+        check ((gnss.changeSource[expected] == scenario->expected[expected].source)
+               && (gnss.changeMsec[expected] >= scenario->expected[expected].startMsec)
+               && (gnss.changeMsec[expected] <= scenario->expected[expected].endMsec), name);
+    }
+    if (scenario->fallbackStartMsec)
+    {
+        snprintf (name, sizeof(name), "Fallback at %u ms, expected %u - %u ms", fallbackMsec,
+                  scenario->fallbackStartMsec, scenario->fallbackEndMsec);
+        check ((fallbackMsec >= scenario->fallbackStartMsec) && (fallbackMsec <= scenario->fallbackEndMsec), name);
+    }
+    else
+        check (!fallbackMsec, "No fallback");
+}
+
+//----------------------------------------
+// Scenarios
+//----------------------------------------
+
+// NTRIP client preferred, Bluetooth backup and an ESP-NOW link that only
+// delivers complete epochs after 200 seconds.  Switchover takes the timeout
+// plus the time to the start of the next epoch of the backup, switching back
+// takes the holdoff time.
+const SCENARIO failover =
+{
+    "Failover",
+    620,
+    1000,
+    {
+        {150,  50,   0, {{100, 130}, {300, 301}, {500, 530}, {560, 620}}},  // NTRIP client
+        {400, 100,   0, {{400, 450}, {500, 530}, {560, 620}}},              // Bluetooth
+        { 60,  20, 200, {{560, 620}}},                                      // ESP-NOW
+    },
+    {
+        {CORRECTION_SOURCE_NTRIP_CLIENT,      0,   2500},
+        {CORRECTION_SOURCE_BLUETOOTH,    102000, 104000},
+        {CORRECTION_SOURCE_NTRIP_CLIENT, 135000, 137500},
+        {CORRECTION_SOURCE_ESPNOW,       502000, 504000},
+        {CORRECTION_SOURCE_NTRIP_CLIENT, 535000, 537500},
+    },
+    5,
+    572000,
+    574000
+};
+
+// The Bluetooth latency exceeds the limit, the NTRIP client fails over to
+// ESP-NOW instead
+const SCENARIO latency =
+{
+    "Latency limit",
+    200,
+    300,
+    {
+        {150,  50,   0, {{100, 130}}}, // NTRIP client
+        {400, 100,   0, {{0, 0}}},     // Bluetooth
+        { 60,  20,   0, {{0, 0}}},     // ESP-NOW
+    },
+    {
+        {CORRECTION_SOURCE_NTRIP_CLIENT,      0,   2500},
+        {CORRECTION_SOURCE_ESPNOW,       102000, 104000},
+        {CORRECTION_SOURCE_NTRIP_CLIENT, 135000, 137500},
+    },
+    3,
+    0,
+    0
+};
+
+//----------------------------------------
+// Application
+//----------------------------------------
+
+int main (int argc, char ** argv)
+{
+    int index;
+    unsigned int seed;
+
+    seed = (argc > 1) ? strtoul (argv[1], NULL, 0) : 1;
+    srand (seed);
+    printf ("Seed: %u\n", seed);
+
+    // Get the base station stream
+    for (index = 0; index < MAX_EPOCHS; index++)
+        epochs[index].lastObservation = -1;
+    if (argc > 2)
+    {
+        if (!readRecording (argv[2]))
+            return 1;
+    }
+    else
+        buildEpochs ();
+
+    runScenario (&failover);
+    runScenario (&latency);
+
+    if (errors)
+    {
+        printf ("ERROR - %d failures\n", errors);
+        return 1;
+    }
+    printf ("All tests passed\n");
+    return 0;
+}
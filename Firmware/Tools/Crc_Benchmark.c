@@ -0,0 +1,249 @@
+// Crc_Benchmark.c
+//
+// Verify that the span based CRC-24Q and u-blox Fletcher routines in
+// ../RTK_Surveyor/crc24q.h produce the same results as the byte at a time
+// calculations, then measure the throughput of each.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../RTK_Surveyor/crc24q.h"
+
+#define BENCHMARK_BUFFER_SIZE   65536
+#define MIN_RUN_SECONDS         1.0
+#define RANDOM_SPANS            100000
+#define RANDOM_SPAN_LENGTH      4096
+
+uint8_t data[BENCHMARK_BUFFER_SIZE];
+
+//----------------------------------------
+// Reference routines
+//----------------------------------------
+
+// Compute the CRC-24Q one byte at a time, as done by COMPUTE_CRC24Q
+uint32_t crc24qBytes(uint32_t crc, const uint8_t * data, int length)
+{
+    while (length-- > 0)
+        crc = (crc << 8) ^ crc24q[*data++ ^ ((crc >> 16) & 0xff)];
+    return crc & 0xffffff;
+}
+
+// Compute the Fletcher checksum one byte at a time, as done by ubloxPayload
+void ubloxFletcherBytes(uint8_t * ck_a, uint8_t * ck_b, const uint8_t * data, int length)
+{
+    while (length-- > 0) {
+        *ck_a += *data++;
+        *ck_b += *ck_a;
+    }
+}
+
+//----------------------------------------
+// Equivalence tests
+//----------------------------------------
+
+// Verify the CRC-24Q span routine
+int verifyCrc24q (void)
+{
+    uint32_t crc;
+    int errors;
+    int index;
+    int length;
+    int offset;
+    int position;
+    int value;
+
+    errors = 0;
+
+    // Every 24-bit starting CRC with an 8 byte block
+    for (index = 0; index < 8; index++)
+        data[index] = (uint8_t)rand();
+    for (crc = 0; crc < 0x1000000; crc++) {
+        if (crc24qSpan(crc, data, 8) != crc24qBytes(crc, data, 8)) {
+            if (errors++ < 10)
+                printf ("ERROR - CRC-24Q mismatch, starting CRC 0x%06x\n", crc);
+        }
+    }
+
+    // Every byte value in every slice position
+    for (position = 0; position < 8; position++) {
+        for (value = 0; value < 256; value++) {
+            memset (data, 0, 8);
+            data[position] = value;
+            crc = rand() & 0xffffff;
+            if (crc24qSpan(crc, data, 8) != crc24qBytes(crc, data, 8)) {
+                if (errors++ < 10)
+                    printf ("ERROR - CRC-24Q mismatch, byte 0x%02x at position %d\n", value, position);
+            }
+        }
+    }
+
+    // Random spans of random lengths and alignments
+    for (index = 0; index < BENCHMARK_BUFFER_SIZE; index++)
+        data[index] = (uint8_t)rand();
+    for (index = 0; index < RANDOM_SPANS; index++) {
+        length = rand() % RANDOM_SPAN_LENGTH;
+        offset = rand() % (BENCHMARK_BUFFER_SIZE - length);
+        crc = rand() & 0xffffff;
+        if (crc24qSpan(crc, &data[offset], length) != crc24qBytes(crc, &data[offset], length)) {
+            if (errors++ < 10)
+                printf ("ERROR - CRC-24Q mismatch, offset %d, length %d\n", offset, length);
+        }
+    }
+    return errors;
+}
+
+// Verify the Fletcher span routine
+int verifyFletcher (void)
+{
+    uint8_t a1;
+    uint8_t a2;
+    uint8_t b1;
+    uint8_t b2;
+    int errors;
+    int index;
+    int length;
+    int offset;
+    int start;
+
+    errors = 0;
+
+    // Every starting checksum with spans up to 16 bytes
+    for (index = 0; index < BENCHMARK_BUFFER_SIZE; index++)
+        data[index] = (uint8_t)rand();
+    for (start = 0; start < 0x10000; start++) {
+        for (length = 0; length <= 16; length++) {
+            a1 = a2 = start >> 8;
+            b1 = b2 = start;
+            ubloxFletcherSpan(&a1, &b1, &data[start], length);
+            ubloxFletcherBytes(&a2, &b2, &data[start], length);
+            if ((a1 != a2) || (b1 != b2)) {
+                if (errors++ < 10)
+                    printf ("ERROR - Fletcher mismatch, start 0x%04x, length %d\n", start, length);
+            }
+        }
+    }
+
+    // All 0xff data up to the maximum u-blox payload length
+    memset (data, 0xff, sizeof(data));
+    a1 = a2 = 0xff;
+    b1 = b2 = 0xff;
+    ubloxFletcherSpan(&a1, &b1, data, 0xffff);
+    ubloxFletcherBytes(&a2, &b2, data, 0xffff);
+    if ((a1 != a2) || (b1 != b2))
+        if (errors++ < 10)
+            printf ("ERROR - Fletcher mismatch, 0xffff bytes of 0xff\n");
+
+    // Random spans of random lengths and alignments
+    for (index = 0; index < BENCHMARK_BUFFER_SIZE; index++)
+        data[index] = (uint8_t)rand();
+    for (index = 0; index < RANDOM_SPANS; index++) {
+        length = rand() % RANDOM_SPAN_LENGTH;
+        offset = rand() % (BENCHMARK_BUFFER_SIZE - length);
+        a1 = a2 = rand();
+        b1 = b2 = rand();
+        ubloxFletcherSpan(&a1, &b1, &data[offset], length);
+        ubloxFletcherBytes(&a2, &b2, &data[offset], length);
+        if ((a1 != a2) || (b1 != b2)) {
+            if (errors++ < 10)
+                printf ("ERROR - Fletcher mismatch, offset %d, length %d\n", offset, length);
+        }
+    }
+    return errors;
+}
+
+//----------------------------------------
+// Benchmarks
+//----------------------------------------
+
+double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1000000000.);
+}
+
+// Prevent the compiler from discarding the results
+volatile uint32_t sink;
+
+double benchmarkCrc24q (const char * name, uint32_t (* crcRoutine)(uint32_t crc, const uint8_t * data, int length))
+{
+    uint32_t crc;
+    double elapsed;
+    int passes;
+    double rate;
+    double start;
+
+    crc = 0;
+    passes = 0;
+    start = now ();
+    do {
+        crc = crcRoutine(crc, data, sizeof(data));
+        passes += 1;
+        elapsed = now () - start;
+    } while (elapsed < MIN_RUN_SECONDS);
+    sink = crc;
+
+    rate = (double)sizeof(data) * passes / elapsed;
+    printf ("%-24s %8.2f MB/s\n", name, rate / (1024. * 1024.));
+    return rate;
+}
+
+double benchmarkFletcher (const char * name, void (* fletcherRoutine)(uint8_t * ck_a, uint8_t * ck_b, const uint8_t * data, int length))
+{
+    uint8_t ck_a;
+    uint8_t ck_b;
+    double elapsed;
+    int passes;
+    double rate;
+    double start;
+
+    ck_a = 0;
+    ck_b = 0;
+    passes = 0;
+    start = now ();
+    do {
+        fletcherRoutine(&ck_a, &ck_b, data, sizeof(data));
+        passes += 1;
+        elapsed = now () - start;
+    } while (elapsed < MIN_RUN_SECONDS);
+    sink = (ck_a << 8) | ck_b;
+
+    rate = (double)sizeof(data) * passes / elapsed;
+    printf ("%-24s %8.2f MB/s\n", name, rate / (1024. * 1024.));
+    return rate;
+}
+
+int
+main (
+    int argc,
+    char ** argv
+    )
+{
+    double bytes;
+    int errors;
+    double span;
+
+    srand (time (NULL));
+
+    // Verify the span routines
+    errors = verifyCrc24q ();
+    printf ("CRC-24Q equivalence: %s\n", errors ? "FAILED" : "Passed");
+    errors += verifyFletcher ();
+    printf ("Fletcher equivalence: %s\n", errors ? "FAILED" : "Passed");
+    if (errors)
+        return -1;
+
+    // Measure the throughput
+    bytes = benchmarkCrc24q ("CRC-24Q byte", crc24qBytes);
+    span = benchmarkCrc24q ("CRC-24Q slice-by-8", crc24qSpan);
+    printf ("CRC-24Q speedup: %.2fx\n", span / bytes);
+    bytes = benchmarkFletcher ("Fletcher byte", ubloxFletcherBytes);
+    span = benchmarkFletcher ("Fletcher 4 byte", ubloxFletcherSpan);
+    printf ("Fletcher speedup: %.2fx\n", span / bytes);
+    return 0;
+}
@@ -0,0 +1,278 @@
+// Log_Decompress.c
+//
+// Convert a compressed log file (.ubz) written by the RTK firmware back into
+// the raw NMEA, UBX and RTCM data (.ubx).  The compression routines are
+// included directly from the RTK_Surveyor directory so that the decoder is
+// the same code used by the firmware.
+//
+// Damaged blocks and the partial block at the end of a truncated file are
+// skipped, the data in the remaining blocks is recovered.
+//
+// Usage:
+//
+//    Log_Decompress  <input.ubz>  [output.ubx]
+//    Log_Decompress  -c  <input.ubx>  [output.ubz]
+//
+// The -c option compresses a raw log file, which displays the compression
+// ratio and the time to compress each block for existing log files.
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../RTK_Surveyor/LogCompress.h"
+#include "../RTK_Surveyor/LogCompress.ino"
+
+//----------------------------------------
+// Support routines
+//----------------------------------------
+
+// Read the file into memory
+uint8_t *
+get_file (
+    const char * filename,
+    off_t * length
+    )
+{
+    int file;
+    uint8_t * file_data;
+    off_t file_size;
+
+    file_data = NULL;
+    do {
+        file = open (filename, O_RDONLY);
+        if (file < 0) {
+            perror ("ERROR - Failed to open the file");
+            break;
+        }
+
+        // Determine the file length
+        file_size = lseek (file, 0, SEEK_END);
+
+        // Get the file buffer
+        file_data = malloc (file_size ? file_size : 1);
+        if (!file_data) {
+            fprintf (stderr, "ERROR - Failed to allocate file buffer!\n");
+            break;
+        }
+
+        // Read the file into memory
+        lseek (file, 0, SEEK_SET);
+        if (read (file, file_data, file_size) != file_size) {
+            fprintf (stderr, "ERROR - Failed to read the file into memory!\n");
+            free (file_data);
+            file_data = NULL;
+            break;
+        }
+
+        // Return the file length
+        *length = file_size;
+    } while (0);
+
+    // Close the file
+    if (file >= 0)
+        close (file);
+    return file_data;
+}
+
+// Write the buffer to a file
+int
+put_file (
+    const char * filename,
+    const uint8_t * data,
+    int64_t length
+    )
+{
+    FILE * file;
+
+    file = fopen (filename, "wb");
+    if (!file) {
+        perror ("ERROR - Failed to create the output file");
+        return -1;
+    }
+    if (fwrite (data, 1, length, file) != (size_t)length) {
+        perror ("ERROR - Failed to write the output file");
+        fclose (file);
+        return -1;
+    }
+    fclose (file);
+    return 0;
+}
+
+// Build the output file name by replacing the extension
+void
+output_name (
+    char * output,
+    size_t output_length,
+    const char * input,
+    const char * extension
+    )
+{
+    const char * dot;
+    int length;
+
+    dot = strrchr (input, '.');
+    length = dot ? (int)(dot - input) : (int)strlen (input);
+    snprintf (output, output_length, "%.*s.%s", length, input, extension);
+}
+
+//----------------------------------------
+// Compress and decompress
+//----------------------------------------
+
+// Compress a raw log file
+int
+compress_file (
+    const char * input_name,
+    const char * output_name
+    )
+{
+    double block_time;
+    int32_t bytes;
+    uint8_t * data;
+    off_t length;
+    double max_time;
+    off_t offset;
+    uint8_t * output;
+    int64_t output_length;
+    struct timespec start;
+    static LOG_COMPRESS state;
+    struct timespec stop;
+    double total_time;
+
+    data = get_file (input_name, &length);
+    if (!data)
+        return -1;
+
+    // Worst case output size
+    output = malloc ((length / LOG_COMPRESS_BLOCK_BYTES + 1) * LOG_COMPRESS_OUTPUT_BYTES(LOG_COMPRESS_BLOCK_BYTES));
+    if (!output) {
+        fprintf (stderr, "ERROR - Failed to allocate the output buffer!\n");
+        free (data);
+        return -2;
+    }
+
+    // Compress the blocks
+    logCompressInit (&state);
+    max_time = 0;
+    total_time = 0;
+    output_length = 0;
+    for (offset = 0; offset < length; offset += bytes) {
+        bytes = ((length - offset) < LOG_COMPRESS_BLOCK_BYTES) ? (int32_t)(length - offset) : LOG_COMPRESS_BLOCK_BYTES;
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        output_length += logCompressBlock (&state, &data[offset], bytes, &output[output_length]);
+        clock_gettime (CLOCK_MONOTONIC, &stop);
+        block_time = (stop.tv_sec - start.tv_sec) * 1000000. + (stop.tv_nsec - start.tv_nsec) / 1000.;
+        total_time += block_time;
+        if (max_time < block_time)
+            max_time = block_time;
+    }
+
+    // Display the results
+    printf ("%s: %lld bytes\n", input_name, (long long)length);
+    printf ("%s: %lld bytes\n", output_name, (long long)output_length);
+    printf ("    %u blocks, %u stored uncompressed\n", state.blocks, state.storedBlocks);
+    if (output_length)
+        printf ("    Compression ratio: %.2f : 1\n", (double)length / (double)output_length);
+    if (state.blocks)
+        printf ("    Compression time: %.1f uSec/block average, %.1f uSec/block maximum\n",
+                total_time / state.blocks, max_time);
+
+    bytes = put_file (output_name, output, output_length);
+    free (output);
+    free (data);
+    return bytes;
+}
+
+// Decompress a compressed log file
+int
+decompress_file (
+    const char * input_name,
+    const char * output_name
+    )
+{
+    uint8_t * data;
+    off_t length;
+    uint8_t * output;
+    int64_t output_length;
+    int status;
+    LOG_DECOMPRESS_STATS stats;
+
+    data = get_file (input_name, &length);
+    if (!data)
+        return -1;
+    if (!logIsCompressed (data, length)) {
+        fprintf (stderr, "ERROR - %s is not a compressed log file!\n", input_name);
+        free (data);
+        return -2;
+    }
+
+    // Allocate the output buffer
+    output_length = logDecompress (data, length, NULL, 0, &stats);
+    output = malloc (output_length ? output_length : 1);
+    if (!output) {
+        fprintf (stderr, "ERROR - Failed to allocate the output buffer!\n");
+        free (data);
+        return -3;
+    }
+
+    // Decompress the file
+    output_length = logDecompress (data, length, output, output_length, &stats);
+    printf ("%s: %lld bytes\n", input_name, (long long)length);
+    printf ("%s: %lld bytes\n", output_name, (long long)output_length);
+    printf ("    %u blocks\n", stats.blocks);
+    if (length)
+        printf ("    Compression ratio: %.2f : 1\n", (double)output_length / (double)length);
+    if (stats.badBlocks)
+        printf ("    %u damaged blocks skipped\n", stats.badBlocks);
+    if (stats.sequenceGaps)
+        printf ("    %u blocks missing\n", stats.sequenceGaps);
+    if (stats.skippedBytes)
+        printf ("    %llu bytes skipped\n", (unsigned long long)stats.skippedBytes);
+
+    status = put_file (output_name, output, output_length);
+    free (output);
+    free (data);
+    return status;
+}
+
+//----------------------------------------
+// Application
+//----------------------------------------
+
+int
+main (
+    int argc,
+    char ** argv
+    )
+{
+    bool compress;
+    const char * input;
+    char output[4096];
+
+    compress = (argc > 1) && (strcmp (argv[1], "-c") == 0);
+    if ((argc < (2 + compress)) || (argc > (3 + compress))) {
+        fprintf (stderr, "%s  <input.%s>  [output.ubx]\n", argv[0], LOG_COMPRESS_EXTENSION);
+        fprintf (stderr, "%s  -c  <input.ubx>  [output.%s]\n", argv[0], LOG_COMPRESS_EXTENSION);
+        return -1;
+    }
+
+    input = argv[1 + compress];
+    if (argc == (3 + compress))
+        snprintf (output, sizeof(output), "%s", argv[2 + compress]);
+    else
+        output_name (output, sizeof(output), input, compress ? LOG_COMPRESS_EXTENSION : "ubx");
+    if (strcmp (input, output) == 0) {
+        fprintf (stderr, "ERROR - The output file must be different from the input file!\n");
+        return -2;
+    }
+
+    if (compress)
+        return compress_file (input, output);
+    return decompress_file (input, output);
+}
@@ -0,0 +1,607 @@
+// Log_Extract.c
+//
+// Extract a time range from a log file written by the RTK firmware using the
+// seek index (.idx) written beside the log file.  The epoch records in the
+// index are in time order, so a binary search of the index file locates the
+// start and end of the time range and only that portion of the log file is
+// read.  Compressed log files (.ubz) are decompressed starting at the block
+// containing the first epoch.  The index routines are included directly from
+// the RTK_Surveyor directory so that the index format is the same code used
+// by the firmware.
+//
+// Usage:
+//
+//    Log_Extract  <log file>  <start seconds>  <end seconds>  [output.ubx]
+//    Log_Extract  -i  <log file>
+//    Log_Extract  -s  <log file>
+//
+// The start and end times are GPS time of week in seconds, the end time is
+// exclusive.  A time range that crosses the end of the week uses an end
+// time larger than 604800.
+//
+// The -i option builds the index file for an existing log file, such as a
+// log file written by older firmware.  The -s option displays the time range
+// and the message counts recorded in the index file.
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../RTK_Surveyor/LogCompress.h"
+#include "../RTK_Surveyor/LogCompress.ino"
+#include "../RTK_Surveyor/LogIndex.h"
+#include "../RTK_Surveyor/LogIndex.ino"
+
+//----------------------------------------
+// Locals
+//----------------------------------------
+
+static uint32_t records_read;
+
+//----------------------------------------
+// Support routines
+//----------------------------------------
+
+// Build the index file name by replacing the extension
+void
+index_name (
+    char * output,
+    size_t output_length,
+    const char * input
+    )
+{
+    const char * dot;
+    int length;
+
+    dot = strrchr (input, '.');
+    length = dot ? (int)(dot - input) : (int)strlen (input);
+    snprintf (output, output_length, "%.*s.%s", length, input, LOG_INDEX_EXTENSION);
+}
+
+// Read a record from the index file
+bool
+read_record (
+    FILE * file,
+    uint32_t record_number,
+    LOG_INDEX_RECORD * record
+    )
+{
+    if (fseek (file, (long)record_number * sizeof(*record), SEEK_SET))
+        return false;
+    records_read += 1;
+    return (fread (record, sizeof(*record), 1, file) == 1);
+}
+
+// Locate the first epoch record at or after record_number and before limit,
+// returns true when an epoch record is found
+bool
+find_epoch (
+    FILE * file,
+    uint32_t record_number,
+    uint32_t limit,
+    LOG_INDEX_RECORD * record,
+    uint32_t * epoch_record
+    )
+{
+    // At most LOG_INDEX_MAX_TYPES + 2 records separate the epoch records
+    for (; record_number < limit; record_number++) {
+        if (!read_record (file, record_number, record))
+            break;
+        if (record->type == LOG_INDEX_RECORD_EPOCH) {
+            *epoch_record = record_number;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Locate the first epoch at or after the time, returns false when all of the
+// epochs are earlier
+bool
+search_index (
+    FILE * file,
+    uint32_t records,
+    uint32_t tow_ms,
+    LOG_INDEX_RECORD * record
+    )
+{
+    uint32_t epoch_record;
+    uint32_t high;
+    uint32_t low;
+    uint32_t middle;
+
+    // Binary search of the epoch records, the records between middle and the
+    // next epoch record are not epoch records
+    low = 0;
+    high = records;
+    while (low < high) {
+        middle = low + ((high - low) >> 1);
+        if (!find_epoch (file, middle, high, record, &epoch_record))
+            high = middle;
+        else if (record->towMs < tow_ms)
+            low = epoch_record + 1;
+        else
+            high = middle;
+    }
+    return find_epoch (file, low, records, record, &epoch_record);
+}
+
+//----------------------------------------
+// Build the index
+//----------------------------------------
+
+// Determine the length of the message starting at data, returns zero when
+// the data does not start a message
+int32_t
+message_length (
+    const uint8_t * data,
+    int64_t length
+    )
+{
+    int32_t bytes;
+
+    // UBX: B5 62 class id length payload ck_a ck_b
+    if ((length >= 6) && (data[0] == 0xb5) && (data[1] == 0x62)) {
+        bytes = 6 + (data[4] | (data[5] << 8)) + 2;
+        return (bytes <= length) ? bytes : 0;
+    }
+
+    // RTCM: D3 length payload crc
+    if ((length >= 3) && (data[0] == 0xd3) && (!(data[1] & 0xfc))) {
+        bytes = 3 + (((data[1] & 3) << 8) | data[2]) + 3;
+        return (bytes <= length) ? bytes : 0;
+    }
+
+    // NMEA: $ ... \n
+    if (data[0] == '$') {
+        for (bytes = 1; (bytes < length) && (bytes < 100); bytes++)
+            if (data[bytes] == '\n')
+                return bytes + 1;
+    }
+    return 0;
+}
+
+// Build the index file for a log file
+int
+build_index (
+    const char * log_name
+    )
+{
+    uint8_t block[LOG_BLOCK_HEADER_BYTES + LOG_COMPRESS_BLOCK_BYTES];
+    int32_t block_bytes;
+    uint32_t block_count;
+    uint32_t * block_data;
+    uint32_t * block_offsets;
+    int32_t bytes;
+    bool compressed;
+    uint8_t * data;
+    int64_t data_length;
+    int64_t data_size;
+    int64_t file_length;
+    FILE * index_file;
+    char index_file_name[4096];
+    FILE * log_file;
+    uint32_t high;
+    static LOG_INDEX index;
+    int32_t length;
+    uint32_t low;
+    uint32_t middle;
+    uint8_t * new_data;
+    int64_t offset;
+    int status;
+
+    block_data = NULL;
+    block_offsets = NULL;
+    data = NULL;
+    index_file = NULL;
+    log_file = NULL;
+    status = -1;
+    do {
+        log_file = fopen (log_name, "rb");
+        if (!log_file) {
+            perror ("ERROR - Failed to open the log file");
+            break;
+        }
+        fseek (log_file, 0, SEEK_END);
+        file_length = ftell (log_file);
+        fseek (log_file, 0, SEEK_SET);
+        data_size = file_length ? file_length : 1;
+        data = malloc (data_size);
+        if (!data) {
+            fprintf (stderr, "ERROR - Failed to allocate the data buffer!\n");
+            break;
+        }
+        compressed = (fread (block, 1, 4, log_file) == 4) && (memcmp (block, LOG_BLOCK_MAGIC, 4) == 0);
+        fseek (log_file, 0, SEEK_SET);
+
+        // Read the log file, remembering where each block starts in the
+        // file and in the data
+        block_count = 0;
+        data_length = 0;
+        if (!compressed) {
+            data_length = fread (data, 1, file_length, log_file);
+        } else {
+            block_offsets = malloc ((file_length / LOG_BLOCK_HEADER_BYTES + 1) * sizeof(*block_offsets));
+            block_data = malloc ((file_length / LOG_BLOCK_HEADER_BYTES + 1) * sizeof(*block_data));
+            if ((!block_offsets) || (!block_data)) {
+                fprintf (stderr, "ERROR - Failed to allocate the block tables!\n");
+                break;
+            }
+            offset = 0;
+            while (offset < file_length) {
+                // Grow the data buffer when necessary
+                if ((data_length + LOG_COMPRESS_BLOCK_BYTES) > data_size) {
+                    data_size = (data_size * 2) + LOG_COMPRESS_BLOCK_BYTES;
+                    new_data = realloc (data, data_size);
+                    if (!new_data) {
+                        fprintf (stderr, "ERROR - Failed to allocate the data buffer!\n");
+                        break;
+                    }
+                    data = new_data;
+                }
+                fseek (log_file, offset, SEEK_SET);
+                length = fread (block, 1, sizeof(block), log_file);
+                bytes = logDecompressBlock (block, length, &data[data_length], LOG_COMPRESS_BLOCK_BYTES, &block_bytes);
+
+                // Skip damaged data
+                if (bytes < 0) {
+                    offset += 1;
+                    continue;
+                }
+                block_offsets[block_count] = (uint32_t)offset;
+                block_data[block_count++] = (uint32_t)data_length;
+                data_length += bytes;
+                offset += block_bytes;
+            }
+            if (offset < file_length)
+                break;
+        }
+
+        // Create the index file
+        index_name (index_file_name, sizeof(index_file_name), log_name);
+        index_file = fopen (index_file_name, "wb");
+        if (!index_file) {
+            perror ("ERROR - Failed to create the index file");
+            break;
+        }
+
+        // Add the messages to the index
+        logIndexInit (&index, LOG_INDEX_DEFAULT_LEAP_SECONDS, 0, compressed ? LOG_INDEX_FLAG_COMPRESSED : 0);
+        for (offset = 0; offset < data_length; offset += bytes) {
+            bytes = message_length (&data[offset], data_length - offset);
+            if (!bytes) {
+                bytes = 1;
+                continue;
+            }
+
+            // Locate the block containing the message
+            if (!compressed) {
+                if (logIndexMessage (&index, &data[offset], bytes, (uint32_t)offset, 0)) {
+                    fwrite (index.records, sizeof(index.records[0]), index.recordCount, index_file);
+                    index.recordCount = 0;
+                }
+                continue;
+            }
+            low = 0;
+            high = block_count;
+            while ((high - low) > 1) {
+                middle = (low + high) >> 1;
+                if (block_data[middle] <= offset)
+                    low = middle;
+                else
+                    high = middle;
+            }
+            if (logIndexMessage (&index, &data[offset], bytes, block_offsets[low],
+                                 (uint16_t)(offset - block_data[low]))) {
+                fwrite (index.records, sizeof(index.records[0]), index.recordCount, index_file);
+                index.recordCount = 0;
+            }
+        }
+        logIndexFinish (&index);
+        fwrite (index.records, sizeof(index.records[0]), index.recordCount, index_file);
+
+        printf ("%s: %lld bytes%s\n", log_name, (long long)file_length, compressed ? ", compressed" : "");
+        printf ("%s: %u epochs\n", index_file_name, index.epochs);
+        if (!index.epochs)
+            printf ("    No time found in the log file\n");
+        status = 0;
+    } while (0);
+
+    if (index_file)
+        fclose (index_file);
+    if (log_file)
+        fclose (log_file);
+    free (block_data);
+    free (block_offsets);
+    free (data);
+    return status;
+}
+
+//----------------------------------------
+// Display the index
+//----------------------------------------
+
+// Display the message type
+void
+display_type (
+    const LOG_INDEX_RECORD * record
+    )
+{
+    switch (record->protocol) {
+    default:
+        printf ("Other     ");
+        break;
+
+    case LOG_INDEX_PROTOCOL_NMEA:
+        printf ("NMEA %c%c%c  ", 'A' + ((record->id >> 10) & 0x1f), 'A' + ((record->id >> 5) & 0x1f),
+                'A' + (record->id & 0x1f));
+        break;
+
+    case LOG_INDEX_PROTOCOL_RTCM:
+        printf ("RTCM %-4d ", record->id);
+        break;
+
+    case LOG_INDEX_PROTOCOL_UBX:
+        printf ("UBX %02x.%02x ", record->id >> 8, record->id & 0xff);
+        break;
+    }
+}
+
+// Display the contents of the index file
+int
+display_index (
+    const char * log_name
+    )
+{
+    uint32_t epochs;
+    FILE * file;
+    char file_name[4096];
+    LOG_INDEX_RECORD first;
+    LOG_INDEX_RECORD last;
+    LOG_INDEX_RECORD record;
+    uint32_t records;
+
+    index_name (file_name, sizeof(file_name), log_name);
+    file = fopen (file_name, "rb");
+    if (!file) {
+        perror ("ERROR - Failed to open the index file");
+        return -1;
+    }
+
+    epochs = 0;
+    records = 0;
+    memset (&first, 0, sizeof(first));
+    memset (&last, 0, sizeof(last));
+    while (fread (&record, sizeof(record), 1, file) == 1) {
+        records += 1;
+        switch (record.type) {
+        case LOG_INDEX_RECORD_HEADER:
+            printf ("Header: version %d, leap seconds %d, %s\n", record.protocol, record.id,
+                    (record.count & LOG_INDEX_FLAG_COMPRESSED) ? "compressed" : "not compressed");
+            break;
+
+        case LOG_INDEX_RECORD_EPOCH:
+            if (!epochs)
+                first = record;
+            last = record;
+            epochs += 1;
+            break;
+
+        case LOG_INDEX_RECORD_COUNT:
+            printf ("    %10.3f  0x%08x  ", record.towMs / 1000., record.offset);
+            display_type (&record);
+            printf (" %u\n", record.count);
+            break;
+        }
+    }
+    fclose (file);
+
+    printf ("%s: %u records, %u epochs\n", file_name, records, epochs);
+    if (epochs)
+        printf ("    %.3f - %.3f seconds of week, offsets 0x%08x - 0x%08x\n", first.towMs / 1000.,
+                last.towMs / 1000., first.offset, last.offset);
+    return 0;
+}
+
+//----------------------------------------
+// Extract a time range
+//----------------------------------------
+
+// Copy the data between the offsets to the output file
+int
+copy_data (
+    FILE * log_file,
+    FILE * output_file,
+    LOG_INDEX_RECORD * start,
+    LOG_INDEX_RECORD * end,
+    bool compressed,
+    int64_t * bytes_written
+    )
+{
+    uint8_t block[LOG_BLOCK_HEADER_BYTES + LOG_COMPRESS_BLOCK_BYTES];
+    int32_t block_bytes;
+    int32_t bytes;
+    uint8_t data[LOG_COMPRESS_BLOCK_BYTES];
+    int32_t first;
+    int32_t last;
+    int32_t length;
+    int64_t offset;
+
+    *bytes_written = 0;
+    offset = start->offset;
+    first = start->id;
+    while ((!end) || (offset <= end->offset)) {
+        fseek (log_file, offset, SEEK_SET);
+        length = fread (block, 1, sizeof(block), log_file);
+        if (length <= 0)
+            break;
+
+        // Copy the raw data
+        if (!compressed) {
+            if (end && ((offset + length) > end->offset))
+                length = end->offset - offset;
+            if (!length)
+                break;
+            fwrite (block, 1, length, output_file);
+            *bytes_written += length;
+            offset += length;
+            continue;
+        }
+
+        // Decompress the block, skip damaged data
+        bytes = logDecompressBlock (block, length, data, sizeof(data), &block_bytes);
+        if (bytes < 0) {
+            offset += 1;
+            continue;
+        }
+
+        // Write the data from the block
+        last = bytes;
+        if (end && (offset == end->offset))
+            last = end->id;
+        if (last > first) {
+            fwrite (&data[first], 1, last - first, output_file);
+            *bytes_written += last - first;
+        }
+        first = 0;
+        offset += block_bytes;
+    }
+    return 0;
+}
+
+// Extract the time range from the log file
+int
+extract (
+    const char * log_name,
+    double start_seconds,
+    double end_seconds,
+    const char * output_name
+    )
+{
+    int64_t bytes_written;
+    bool compressed;
+    LOG_INDEX_RECORD end;
+    bool end_found;
+    uint32_t end_ms;
+    FILE * index_file;
+    char index_file_name[4096];
+    LOG_INDEX_RECORD header;
+    FILE * log_file;
+    FILE * output_file;
+    uint32_t records;
+    LOG_INDEX_RECORD start;
+    uint32_t start_ms;
+    int status;
+
+    index_file = NULL;
+    log_file = NULL;
+    output_file = NULL;
+    status = -1;
+    do {
+        // Open the index file
+        index_name (index_file_name, sizeof(index_file_name), log_name);
+        index_file = fopen (index_file_name, "rb");
+        if (!index_file) {
+            perror ("ERROR - Failed to open the index file, use -i to build the index");
+            break;
+        }
+        if ((!read_record (index_file, 0, &header)) || (header.type != LOG_INDEX_RECORD_HEADER)
+            || (header.offset != LOG_INDEX_MAGIC)) {
+            fprintf (stderr, "ERROR - %s is not a log index file!\n", index_file_name);
+            break;
+        }
+        compressed = header.count & LOG_INDEX_FLAG_COMPRESSED;
+        fseek (index_file, 0, SEEK_END);
+        records = ftell (index_file) / sizeof(LOG_INDEX_RECORD);
+
+        // Locate the epochs
+        start_ms = (uint32_t)(start_seconds * 1000. + 0.5);
+        end_ms = (uint32_t)(end_seconds * 1000. + 0.5);
+        records_read = 0;
+        if (!search_index (index_file, records, start_ms, &start)) {
+            fprintf (stderr, "ERROR - The log file ends before %.3f seconds!\n", start_seconds);
+            break;
+        }
+        end_found = search_index (index_file, records, end_ms, &end);
+        if (start.towMs >= end_ms) {
+            fprintf (stderr, "ERROR - No epochs between %.3f and %.3f seconds!\n", start_seconds, end_seconds);
+            break;
+        }
+
+        // Copy the data to the output file
+        log_file = fopen (log_name, "rb");
+        if (!log_file) {
+            perror ("ERROR - Failed to open the log file");
+            break;
+        }
+        output_file = fopen (output_name, "wb");
+        if (!output_file) {
+            perror ("ERROR - Failed to create the output file");
+            break;
+        }
+        status = copy_data (log_file, output_file, &start, end_found ? &end : NULL, compressed, &bytes_written);
+
+        printf ("%s: %u records, %u read by the search\n", index_file_name, records, records_read);
+        printf ("%s: epochs %.3f - %.3f seconds, offset 0x%08x - ", log_name, start.towMs / 1000.,
+                end_found ? end.towMs / 1000. : -1., start.offset);
+        if (end_found)
+            printf ("0x%08x\n", end.offset);
+        else
+            printf ("end of file\n");
+        printf ("%s: %lld bytes\n", output_name, (long long)bytes_written);
+    } while (0);
+
+    if (output_file)
+        fclose (output_file);
+    if (log_file)
+        fclose (log_file);
+    if (index_file)
+        fclose (index_file);
+    return status;
+}
+
+//----------------------------------------
+// Application
+//----------------------------------------
+
+int
+main (
+    int argc,
+    char ** argv
+    )
+{
+    double end_seconds;
+    char output[4096];
+    double start_seconds;
+
+    if ((argc == 3) && (strcmp (argv[1], "-i") == 0))
+        return build_index (argv[2]);
+    if ((argc == 3) && (strcmp (argv[1], "-s") == 0))
+        return display_index (argv[2]);
+    if ((argc < 4) || (argc > 5) || (argv[1][0] == '-')) {
+        fprintf (stderr, "%s  <log file>  <start seconds>  <end seconds>  [output.ubx]\n", argv[0]);
+        fprintf (stderr, "%s  -i  <log file>\n", argv[0]);
+        fprintf (stderr, "%s  -s  <log file>\n", argv[0]);
+        return -1;
+    }
+
+    start_seconds = strtod (argv[2], NULL);
+    end_seconds = strtod (argv[3], NULL);
+    if ((start_seconds < 0) || (end_seconds <= start_seconds)) {
+        fprintf (stderr, "ERROR - The end time must follow the start time!\n");
+        return -2;
+    }
+    if (argc == 5)
+        snprintf (output, sizeof(output), "%s", argv[4]);
+    else
+        snprintf (output, sizeof(output), "%s_%.0f_%.0f.ubx", argv[1], start_seconds, end_seconds);
+    if (strcmp (argv[1], output) == 0) {
+        fprintf (stderr, "ERROR - The output file must be different from the log file!\n");
+        return -3;
+    }
+    return extract (argv[1], start_seconds, end_seconds, output);
+}
@@ -0,0 +1,618 @@
+// Log_Parser.c
+//
+// Parse a log file in parallel using the firmware GNSS message parser.  The
+// firmware parser routines are included directly from the RTK_Surveyor
+// directory so that the tools find the same messages as the device.
+//
+// The firmware parser only reports the message data, the file offset of the
+// message is determined by matching the message data against the log file
+// data following the previous message.  Usually the match is found at the
+// end of the previous message, bytes between messages are skipped.
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Log_Parser.h"
+#include "../RTK_Surveyor/LogCompress.h"
+
+//----------------------------------------
+// Firmware stubs
+//----------------------------------------
+
+struct
+{
+    bool enablePrintBadMessages;
+} settings = {true};
+
+bool inMainMenu;
+_Thread_local uint16_t failedParserMessages_NMEA;
+_Thread_local uint16_t failedParserMessages_RTCM;
+_Thread_local uint16_t failedParserMessages_UBX;
+
+int AsciiToNibble(int data)
+{
+    // Convert the value to lower case
+    data |= 0x20;
+    if ((data >= 'a') && (data <= 'f'))
+        return data - 'a' + 10;
+    if ((data >= '0') && (data <= '9'))
+        return data - '0';
+    return -1;
+}
+
+static void log_parser_report (PARSE_STATE * parse, uint8_t type, bool error);
+
+void printNmeaChecksumError(PARSE_STATE *parse) { log_parser_report (parse, SENTENCE_TYPE_NMEA, true); }
+void printRtcmChecksumError(PARSE_STATE *parse) { log_parser_report (parse, SENTENCE_TYPE_RTCM, true); }
+void printRtcmMaxLength(PARSE_STATE *parse) {}
+void printUbloxChecksumError(PARSE_STATE *parse) { log_parser_report (parse, SENTENCE_TYPE_UBX, true); }
+void printUbloxInvalidData(PARSE_STATE *parse) {}
+
+GPS_PARSE_TABLE
+
+#include "../RTK_Surveyor/GpsMessageParser.ino"
+#include "../RTK_Surveyor/Parse_NMEA.ino"
+#include "../RTK_Surveyor/Parse_RTCM.ino"
+#include "../RTK_Surveyor/Parse_UBLOX.ino"
+#include "../RTK_Surveyor/LogCompress.ino"
+
+//----------------------------------------
+// Message location
+//----------------------------------------
+
+// Determine the length of the complete and valid message starting at data,
+// returns zero when the data does not start a valid message
+int32_t
+log_valid_message (
+    const uint8_t * data,
+    uint64_t length
+    )
+{
+    int32_t bytes;
+    uint8_t ck_a;
+    uint8_t ck_b;
+    int checksum;
+    int index;
+
+    if (!length)
+        return 0;
+
+    // UBX: B5 62 class id length payload ck_a ck_b
+    if (data[0] == 0xb5) {
+        if ((length < 8) || (data[1] != 0x62))
+            return 0;
+        bytes = 6 + (data[4] | (data[5] << 8)) + 2;
+        if ((bytes > PARSE_BUFFER_LENGTH) || ((uint64_t)bytes > length))
+            return 0;
+        ck_a = 0;
+        ck_b = 0;
+        ubloxFletcherSpan (&ck_a, &ck_b, &data[2], bytes - 4);
+        return ((data[bytes - 2] == ck_a) && (data[bytes - 1] == ck_b)) ? bytes : 0;
+    }
+
+    // RTCM: D3 length payload crc, the CRC over the entire message is zero
+    if (data[0] == 0xd3) {
+        if ((length < 6) || (data[1] & 0xfc))
+            return 0;
+        bytes = 3 + (((data[1] & 3) << 8) | data[2]) + 3;
+        if ((uint64_t)bytes > length)
+            return 0;
+        return crc24qSpan (0, data, bytes) ? 0 : bytes;
+    }
+
+    // NMEA: $ name , data * checksum CR LF
+    if (data[0] == '$') {
+        checksum = 0;
+        for (index = 1; (index < 100) && ((uint64_t)index < length); index++) {
+            if (data[index] == '*')
+                break;
+            if ((data[index] < ' ') || (data[index] >= 0x7f))
+                return 0;
+            checksum ^= data[index];
+        }
+        if (((uint64_t)(index + 3) >= length) || (data[index] != '*'))
+            return 0;
+        if ((AsciiToNibble (data[index + 1]) < 0) || (AsciiToNibble (data[index + 2]) < 0))
+            return 0;
+        if (((AsciiToNibble (data[index + 1]) << 4) | AsciiToNibble (data[index + 2])) != checksum)
+            return 0;
+        if ((data[index + 3] != '\r') && (data[index + 3] != '\n'))
+            return 0;
+        bytes = index + 4;
+        if (((uint64_t)bytes < length) && (data[bytes] == '\n'))
+            bytes += 1;
+        return bytes;
+    }
+    return 0;
+}
+
+// Locate the first valid message between offset and limit
+static uint64_t
+find_message (
+    const LOG_FILE * log,
+    uint64_t offset,
+    uint64_t limit
+    )
+{
+    const uint8_t * data;
+
+    while (offset < limit) {
+        data = gpsMessageParserFindPreamble (&log->data[offset], &log->data[limit]);
+        offset = data - log->data;
+        if (offset >= limit)
+            break;
+        if (log_valid_message (data, log->length - offset))
+            return offset;
+        offset += 1;
+    }
+    return limit;
+}
+
+// Locate the message in the log file data following the previous message
+static uint64_t
+message_offset (
+    LOG_CHUNK * chunk,
+    const uint8_t * message,
+    uint16_t length
+    )
+{
+    const uint8_t * data;
+    const uint8_t * data_end;
+
+    if (length && ((chunk->scan + length) <= chunk->span_end)) {
+        data = &chunk->log->data[chunk->scan];
+        data_end = &chunk->log->data[chunk->span_end - length + 1];
+        while (data < data_end) {
+            data = memchr (data, message[0], data_end - data);
+            if (!data)
+                break;
+            if (!memcmp (data, message, length))
+                return data - chunk->log->data;
+            data += 1;
+        }
+    }
+
+    // Message wrapped in the parse buffer, use the end of the previous message
+    return chunk->scan;
+}
+
+//----------------------------------------
+// Parser callbacks
+//----------------------------------------
+
+// Report a valid message or a message with a bad checksum
+static void
+log_parser_report (
+    PARSE_STATE * parse,
+    uint8_t type,
+    bool error
+    )
+{
+    LOG_CHUNK * chunk;
+    uint64_t offset;
+
+    // The parse state is the first member of the chunk
+    chunk = (LOG_CHUNK *)parse;
+    offset = message_offset (chunk, parse->buffer, parse->length);
+
+    // Messages starting after the end of the chunk belong to the next chunk
+    if (offset >= chunk->end) {
+        chunk->done = true;
+        return;
+    }
+
+    // Record the data skipped since the previous message
+    if (chunk->first == chunk->end)
+        chunk->first = offset;
+    else if ((offset > chunk->scan)
+        && log_range_add (&chunk->bad_data, chunk->scan, offset - chunk->scan, SENTENCE_TYPE_NONE))
+        chunk->out_of_memory = true;
+
+    // Account for the message
+    if (error) {
+        chunk->errors[type] += 1;
+        if (log_range_add (&chunk->bad_data, offset, parse->length, type))
+            chunk->out_of_memory = true;
+        if (chunk->callbacks->error)
+            chunk->callbacks->error (chunk, parse->buffer, parse->length, type, offset);
+    } else {
+        chunk->messages[type] += 1;
+        chunk->bytes += parse->length;
+        chunk->callbacks->message (chunk, parse->buffer, parse->length, type, offset);
+    }
+    chunk->scan = offset + parse->length;
+
+    // The message crossing the end of the chunk completes the chunk
+    if (chunk->past_end)
+        chunk->done = true;
+}
+
+static void
+log_parser_message (
+    PARSE_STATE * parse,
+    uint8_t type
+    )
+{
+    log_parser_report (parse, type, false);
+}
+
+//----------------------------------------
+// Chunk parsing
+//----------------------------------------
+
+static const uint8_t end_of_file = 0;
+
+// Parse the messages starting between chunk->start and chunk->end
+static void *
+parse_chunk (
+    void * arg
+    )
+{
+    int bytes;
+    LOG_CHUNK * chunk;
+    const LOG_FILE * log;
+    uint64_t offset;
+
+    chunk = arg;
+    log = chunk->log;
+
+    // Initialize the parser
+    memset (&chunk->parse, 0, sizeof(chunk->parse));
+    chunk->parse.state = gpsMessageParserFirstByte;
+    chunk->parse.eomCallback = log_parser_message;
+    chunk->parse.buffer = chunk->buffer;
+    chunk->parse.parserName = "Log";
+    memset (chunk->messages, 0, sizeof(chunk->messages));
+    memset (chunk->errors, 0, sizeof(chunk->errors));
+    chunk->bytes = 0;
+    chunk->bad_data.count = 0;
+    chunk->first = chunk->end;
+    chunk->scan = chunk->start;
+    chunk->past_end = false;
+    chunk->done = false;
+    chunk->out_of_memory = false;
+
+    // Parse the chunk data
+    for (offset = chunk->start; offset < chunk->end; offset += bytes) {
+        bytes = LOG_PARSER_SPAN_BYTES;
+        if ((uint64_t)bytes > (chunk->end - offset))
+            bytes = chunk->end - offset;
+        chunk->span_end = offset + bytes;
+        gpsMessageParserProcessBuffer (&chunk->parse, &log->data[offset], bytes);
+    }
+
+    // Finish the message crossing the end of the chunk
+    chunk->past_end = true;
+    while ((!chunk->done) && (chunk->parse.state != gpsMessageParserFirstByte)
+        && (offset < log->length)) {
+        chunk->span_end = offset + 1;
+        gpsMessageParserProcessBuffer (&chunk->parse, &log->data[offset++], 1);
+    }
+
+    // The NMEA parser completes the sentence upon receiving the byte following
+    // the line termination, pass a byte for the sentence ending the file
+    if ((!chunk->done) && (chunk->parse.state == nmeaLineTermination)) {
+        chunk->span_end = log->length;
+        gpsMessageParserProcessBuffer (&chunk->parse, &end_of_file, 1);
+    }
+    return NULL;
+}
+
+// Allocate the chunk structures
+LOG_CHUNK *
+log_chunks_alloc (
+    int count
+    )
+{
+    LOG_CHUNK * chunks;
+    int index;
+
+    chunks = calloc (count, sizeof(*chunks));
+    if (!chunks)
+        fprintf (stderr, "ERROR - Failed to allocate the chunk structures!\n");
+    else
+        for (index = 0; index < count; index++)
+            chunks[index].number = index;
+    return chunks;
+}
+
+// Release the chunk structures
+void
+log_chunks_free (
+    LOG_CHUNK * chunks,
+    int count
+    )
+{
+    int index;
+
+    if (chunks)
+        for (index = 0; index < count; index++)
+            free (chunks[index].bad_data.entries);
+    free (chunks);
+}
+
+// Parse the log file in count chunks, one thread per chunk, returns zero
+// upon success
+int
+log_parse (
+    const LOG_FILE * log,
+    LOG_CHUNK * chunks,
+    int count,
+    const LOG_PARSER_CALLBACKS * callbacks
+    )
+{
+    LOG_CHUNK * chunk;
+    int index;
+    uint64_t previous_end;
+    int status;
+    pthread_t threads[LOG_PARSER_MAX_THREADS];
+
+    if ((count < 1) || (count > LOG_PARSER_MAX_THREADS)) {
+        fprintf (stderr, "ERROR - Invalid chunk count %d!\n", count);
+        return -1;
+    }
+
+    // Start each chunk at a valid message following the chunk boundary
+    for (index = 0; index < count; index++) {
+        chunk = &chunks[index];
+        chunk->log = log;
+        chunk->callbacks = callbacks;
+        chunk->boundary = log->length * index / count;
+        chunk->start = 0;
+        if (index)
+            chunk->start = find_message (log, chunk->boundary, log->length * (index + 1) / count);
+        if (index)
+            chunks[index - 1].end = chunk->start;
+    }
+    chunks[count - 1].end = log->length;
+
+    // Parse the chunks in parallel
+    for (index = 1; index < count; index++) {
+        status = pthread_create (&threads[index], NULL, parse_chunk, &chunks[index]);
+        if (status) {
+            fprintf (stderr, "ERROR - Failed to create parser thread, %s\n", strerror (status));
+            while (--index > 0)
+                pthread_join (threads[index], NULL);
+            return -2;
+        }
+    }
+    parse_chunk (&chunks[0]);
+    for (index = 1; index < count; index++)
+        pthread_join (threads[index], NULL);
+
+    // Parse the chunk again when the previous chunk finished a message past
+    // the start of this chunk, the chunk started inside of that message
+    previous_end = 0;
+    for (index = 0; index < count; index++) {
+        chunk = &chunks[index];
+        if (chunk->start < previous_end) {
+            if (callbacks->reset)
+                callbacks->reset (chunk);
+            chunk->start = (previous_end < chunk->end) ? previous_end : chunk->end;
+            parse_chunk (chunk);
+        }
+        if (chunk->scan > previous_end)
+            previous_end = chunk->scan;
+        if (chunk->out_of_memory) {
+            fprintf (stderr, "ERROR - Failed to allocate the bad data list!\n");
+            return -3;
+        }
+    }
+    return 0;
+}
+
+// Build the list of data in the log file that is not a valid message, in
+// file order, returns zero upon success
+int
+log_bad_data (
+    const LOG_FILE * log,
+    const LOG_CHUNK * chunks,
+    int count,
+    LOG_RANGE_LIST * list
+    )
+{
+    const LOG_CHUNK * chunk;
+    int entry;
+    int index;
+    uint64_t previous_end;
+    const LOG_RANGE * range;
+
+    list->count = 0;
+    previous_end = 0;
+    for (index = 0; index < count; index++) {
+        chunk = &chunks[index];
+        if (chunk->first >= chunk->end)
+            continue;
+
+        // Add the data between the chunks
+        if ((chunk->first > previous_end)
+            && log_range_add (list, previous_end, chunk->first - previous_end, SENTENCE_TYPE_NONE))
+            return -1;
+
+        // Add the data within the chunk
+        for (entry = 0; entry < chunk->bad_data.count; entry++) {
+            range = &chunk->bad_data.entries[entry];
+            if (log_range_add (list, range->offset, range->length, range->type))
+                return -1;
+        }
+        previous_end = chunk->scan;
+    }
+
+    // Add the data following the last message
+    if ((log->length > previous_end)
+        && log_range_add (list, previous_end, log->length - previous_end, SENTENCE_TYPE_NONE))
+        return -1;
+    return 0;
+}
+
+//----------------------------------------
+// Log file support
+//----------------------------------------
+
+// Release the log file data
+void
+log_file_close (
+    LOG_FILE * log
+    )
+{
+    if (log->map)
+        munmap (log->map, log->map_length);
+    else if (log->compressed)
+        free ((void *)log->data);
+    memset (log, 0, sizeof(*log));
+}
+
+// Map the log file into memory, compressed log files are decompressed,
+// returns zero upon success
+int
+log_file_open (
+    LOG_FILE * log,
+    const char * file_name
+    )
+{
+    int file;
+    struct stat file_stat;
+    void * map;
+    uint8_t * output;
+    int64_t output_length;
+    LOG_DECOMPRESS_STATS stats;
+    int status;
+
+    memset (log, 0, sizeof(*log));
+    map = NULL;
+    status = -1;
+    do {
+        file = open (file_name, O_RDONLY);
+        if (file < 0) {
+            perror ("ERROR - Failed to open the file");
+            break;
+        }
+        if (fstat (file, &file_stat)) {
+            perror ("ERROR - Failed to get the file size");
+            break;
+        }
+
+        // Map the file into memory
+        log->data = (const uint8_t *)"";
+        if (file_stat.st_size) {
+            map = mmap (NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+            if (map == MAP_FAILED) {
+                perror ("ERROR - Failed to map the file");
+                break;
+            }
+            madvise (map, file_stat.st_size, MADV_SEQUENTIAL);
+            log->data = map;
+            log->length = file_stat.st_size;
+            log->map = map;
+            log->map_length = file_stat.st_size;
+        }
+        status = 0;
+
+        // Replace the compressed log file data with the uncompressed data
+        if (!logIsCompressed (log->data, log->length))
+            break;
+        status = -2;
+        output_length = logDecompress (log->data, log->length, NULL, 0, &stats);
+        output = malloc (output_length ? output_length : 1);
+        if (!output) {
+            fprintf (stderr, "ERROR - Failed to allocate decompression buffer!\n");
+            break;
+        }
+        output_length = logDecompress (log->data, log->length, output, output_length, &stats);
+        if (stats.badBlocks || stats.sequenceGaps)
+            fprintf (stderr, "WARNING - %u damaged blocks, %u missing blocks in the compressed log file\n",
+                     stats.badBlocks, stats.sequenceGaps);
+        munmap (map, log->map_length);
+        log->data = output;
+        log->length = output_length;
+        log->map = NULL;
+        log->map_length = 0;
+        log->compressed = true;
+        status = 0;
+    } while (0);
+
+    // Done with the file descriptor, the mapping remains valid
+    if (file >= 0)
+        close (file);
+    if (status)
+        log_file_close (log);
+    return status;
+}
+
+//----------------------------------------
+// Support routines
+//----------------------------------------
+
+// Add a range to the list, adjacent ranges of skipped data are combined,
+// returns zero upon success
+int
+log_range_add (
+    LOG_RANGE_LIST * list,
+    uint64_t offset,
+    uint64_t length,
+    uint8_t type
+    )
+{
+    LOG_RANGE * entries;
+    LOG_RANGE * last;
+    int max_count;
+
+    // Extend the previous range of skipped data
+    if (list->count && (type == SENTENCE_TYPE_NONE)) {
+        last = &list->entries[list->count - 1];
+        if ((last->type == SENTENCE_TYPE_NONE) && ((last->offset + last->length) == offset)) {
+            last->length += length;
+            return 0;
+        }
+    }
+
+    // Grow the list
+    if (list->count >= list->max_count) {
+        max_count = list->max_count ? list->max_count * 2 : 64;
+        entries = realloc (list->entries, max_count * sizeof(*entries));
+        if (!entries)
+            return -1;
+        list->entries = entries;
+        list->max_count = max_count;
+    }
+    list->entries[list->count].offset = offset;
+    list->entries[list->count].length = length;
+    list->entries[list->count].type = type;
+    list->count += 1;
+    return 0;
+}
+
+// Determine the number of parser threads, value overrides the processor count
+int
+log_parser_threads (
+    const char * value
+    )
+{
+    long threads;
+
+    threads = value ? strtol (value, NULL, 0) : sysconf (_SC_NPROCESSORS_ONLN);
+    if (threads < 1)
+        threads = 1;
+    if (threads > LOG_PARSER_MAX_THREADS)
+        threads = LOG_PARSER_MAX_THREADS;
+    return threads;
+}
+
+// Get the current time in seconds
+double
+log_parser_time (
+    void
+    )
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1000000000.);
+}
@@ -0,0 +1,116 @@
+// Log_Parser.h
+//
+// Shared log file parsing support for the programs in the Tools directory.
+// The log file is mapped into memory, compressed log files (.ubz) are
+// decompressed into memory.  The file is then split into chunks which are
+// parsed in parallel by the firmware GNSS message parser.  Each chunk starts
+// at the first complete and valid message following the chunk boundary and
+// the parser for a chunk continues past the end of the chunk to finish the
+// message crossing the boundary, so each message is reported exactly once.
+//
+// The callbacks are called from the parsing threads and must only update the
+// chunk->context data.  The caller merges the chunk results in chunk order
+// after log_parse returns.  The data skipped between the messages and the
+// messages with bad checksums are recorded by each chunk and merged by
+// log_bad_data.
+
+#ifndef __LOG_PARSER_H__
+#define __LOG_PARSER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PARSE_NMEA_MESSAGES
+#define PARSE_RTCM_MESSAGES
+#define PARSE_UBLOX_MESSAGES
+
+#include "../RTK_Surveyor/GpsMessageParser.h"
+
+//----------------------------------------
+// Constants
+//----------------------------------------
+
+#define LOG_PARSER_MAX_THREADS  64
+#define LOG_PARSER_SPAN_BYTES   (64 * 1024)     // Bytes passed to the parser at once
+
+//----------------------------------------
+// Types
+//----------------------------------------
+
+typedef struct _LOG_FILE {
+    const uint8_t * data;   // Log file data
+    uint64_t length;        // Bytes of log file data
+    void * map;             // Address of the file mapping, NULL when data is allocated
+    uint64_t map_length;    // Length of the file mapping
+    bool compressed;        // Data was decompressed from a .ubz file
+} LOG_FILE;
+
+// Range of log file data that is not a valid message
+typedef struct _LOG_RANGE {
+    uint64_t offset;        // File offset of the data
+    uint64_t length;        // Bytes of data
+    uint8_t type;           // Message type for bad checksums, otherwise SENTENCE_TYPE_NONE
+} LOG_RANGE;
+
+typedef struct _LOG_RANGE_LIST {
+    LOG_RANGE * entries;
+    int count;
+    int max_count;
+} LOG_RANGE_LIST;
+
+typedef struct _LOG_CHUNK LOG_CHUNK;
+
+// Called for each valid message and for each message with a bad checksum
+typedef void (* LOG_MESSAGE_CALLBACK) (LOG_CHUNK * chunk,
+                                       const uint8_t * message,
+                                       uint16_t length,
+                                       uint8_t type,
+                                       uint64_t offset);
+
+// Called to discard the results of a chunk before it is parsed again
+typedef void (* LOG_RESET_CALLBACK) (LOG_CHUNK * chunk);
+
+typedef struct _LOG_PARSER_CALLBACKS {
+    LOG_MESSAGE_CALLBACK message;   // Valid message
+    LOG_MESSAGE_CALLBACK error;     // Bad checksum, optional
+    LOG_RESET_CALLBACK reset;       // Discard chunk results, optional
+} LOG_PARSER_CALLBACKS;
+
+struct _LOG_CHUNK {
+    PARSE_STATE parse;      // Must be first, the parser callbacks receive &chunk->parse
+    uint8_t buffer[PARSE_BUFFER_LENGTH];
+    const LOG_FILE * log;
+    const LOG_PARSER_CALLBACKS * callbacks;
+    void * context;         // Caller's results for this chunk
+    int number;             // Chunk number
+    uint64_t boundary;      // File offset of the chunk boundary
+    uint64_t start;         // Offset of the first message following the boundary
+    uint64_t end;           // Messages starting at or after end belong to the next chunk
+    uint64_t span_end;      // End of the data passed to the parser
+    uint64_t first;         // Offset of the first message in the chunk
+    uint64_t scan;          // Offset following the last message in the chunk
+    uint64_t messages[SENTENCE_TYPE_UBX + 1]; // Valid messages by type
+    uint64_t errors[SENTENCE_TYPE_UBX + 1];   // Bad checksums by type
+    uint64_t bytes;         // Bytes in valid messages
+    LOG_RANGE_LIST bad_data; // Skipped data and bad checksums within the chunk
+    bool past_end;          // Parser is finishing the message crossing the end
+    bool done;              // Parsing of the chunk is complete
+    bool out_of_memory;     // Failed to extend the bad_data list
+};
+
+//----------------------------------------
+// Log parser routines
+//----------------------------------------
+
+int log_bad_data (const LOG_FILE * log, const LOG_CHUNK * chunks, int count, LOG_RANGE_LIST * list);
+LOG_CHUNK * log_chunks_alloc (int count);
+void log_chunks_free (LOG_CHUNK * chunks, int count);
+void log_file_close (LOG_FILE * log);
+int log_file_open (LOG_FILE * log, const char * file_name);
+int log_parse (const LOG_FILE * log, LOG_CHUNK * chunks, int count, const LOG_PARSER_CALLBACKS * callbacks);
+int log_parser_threads (const char * value);
+double log_parser_time (void);
+int log_range_add (LOG_RANGE_LIST * list, uint64_t offset, uint64_t length, uint8_t type);
+int32_t log_valid_message (const uint8_t * data, uint64_t length);
+
+#endif  // __LOG_PARSER_H__
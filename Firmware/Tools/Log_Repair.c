@@ -0,0 +1,468 @@
+// Log_Repair.c
+//
+// Scan a log file for damaged data and write a repaired copy containing only
+// the valid NMEA, RTCM and UBX messages.  A power failure during a write
+// leaves a partial message in the log file and may leave a zero filled tail
+// in the last cluster.  When the firmware restarts logging in the same file
+// the new data follows the damaged data.
+//
+// The log file is mapped into memory and parsed in parallel by Log_Parser.c
+// using the firmware GNSS message parser, so a message is kept only when the
+// device would have accepted it.  Each range of removed data is reported by
+// file offset as one of:
+//
+//    bad checksum:   Complete NMEA, RTCM or UBX message with a bad checksum
+//    partial frame:  Message preamble that is not followed by a valid message
+//    zero fill:      Run of zero bytes
+//    invalid data:   Other data between the messages
+//
+// The restart messages ($GNTXT,01,01,00) written by the firmware when logging
+// starts are also reported along with the reset reason.  Compressed log files
+// (.ubz) are decompressed and the repaired copy is not compressed.
+//
+// Usage:
+//
+//    Log_Repair  [-n]  [-t threads]  <log file>  [repaired file]
+//
+// The repaired file name defaults to the log file name with _repaired.ubx
+// replacing the extension.  The -n option only reports the damaged data.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Log_Parser.h"
+
+#define RESTART_MESSAGE     "$GNTXT,01,01,00,"
+#define ZERO_FILL_MINIMUM   16      // Shorter runs of zeros are reported as part of other data
+
+//----------------------------------------
+// Types
+//----------------------------------------
+
+enum
+{
+    DAMAGE_BAD_CHECKSUM = 0,
+    DAMAGE_PARTIAL_FRAME,
+    DAMAGE_ZERO_FILL,
+    DAMAGE_INVALID_DATA,
+    // Insert new values above this line
+    DAMAGE_MAX
+};
+
+const char * const damage_names[] =
+{
+    "bad checksum",
+    "partial frame",
+    "zero fill",
+    "invalid data",
+};
+
+// Restart messages found in a chunk
+typedef struct _RESTART_LIST {
+    LOG_RANGE_LIST messages;
+} RESTART_LIST;
+
+//----------------------------------------
+// Locals
+//----------------------------------------
+
+static uint64_t damage_bytes[DAMAGE_MAX];
+static uint64_t damage_count[DAMAGE_MAX];
+static const char * const message_types[] = {"Data", "NMEA", "RTCM", "UBX"};
+
+//----------------------------------------
+// Chunk callbacks
+//----------------------------------------
+
+// Record the location of the restart messages
+void
+process_message (
+    LOG_CHUNK * chunk,
+    const uint8_t * message,
+    uint16_t length,
+    uint8_t type,
+    uint64_t offset
+    )
+{
+    RESTART_LIST * list;
+
+    if ((type != SENTENCE_TYPE_NMEA)
+        || (length <= strlen (RESTART_MESSAGE))
+        || memcmp (message, RESTART_MESSAGE, strlen (RESTART_MESSAGE)))
+        return;
+    list = chunk->context;
+    if (log_range_add (&list->messages, offset, length, SENTENCE_TYPE_NMEA))
+        chunk->out_of_memory = true;
+}
+
+// Discard the chunk results
+void
+reset_results (
+    LOG_CHUNK * chunk
+    )
+{
+    ((RESTART_LIST *)chunk->context)->messages.count = 0;
+}
+
+const LOG_PARSER_CALLBACKS callbacks = {
+    process_message,
+    NULL,
+    reset_results
+};
+
+//----------------------------------------
+// Report routines
+//----------------------------------------
+
+// Describe the message starting at data
+void
+describe_message (
+    char * buffer,
+    size_t buffer_length,
+    const uint8_t * data,
+    uint64_t length
+    )
+{
+    int index;
+
+    buffer[0] = 0;
+    switch (data[0]) {
+    case '$':
+        for (index = 1; (index < 16) && ((uint64_t)index < length); index++)
+            if ((data[index] < 'A') || (data[index] > 'Z'))
+                break;
+        snprintf (buffer, buffer_length, "NMEA%s%.*s", (index > 1) ? " " : "", index - 1, &data[1]);
+        break;
+
+    case 0xd3:
+        if (length >= 5)
+            snprintf (buffer, buffer_length, "RTCM %d", (data[3] << 4) | (data[4] >> 4));
+        else
+            snprintf (buffer, buffer_length, "RTCM");
+        break;
+
+    case 0xb5:
+        if ((length >= 4) && (data[1] == 0x62))
+            snprintf (buffer, buffer_length, "UBX %d.%d", data[2], data[3]);
+        else
+            snprintf (buffer, buffer_length, "UBX");
+        break;
+    }
+}
+
+// Report a range of damaged data
+void
+report_damage (
+    const LOG_FILE * log,
+    uint64_t offset,
+    uint64_t length,
+    int damage
+    )
+{
+    char description[32];
+    const uint8_t * data;
+
+    data = &log->data[offset];
+    damage_count[damage] += 1;
+    damage_bytes[damage] += length;
+    description[0] = 0;
+    if ((damage == DAMAGE_BAD_CHECKSUM) || (damage == DAMAGE_PARTIAL_FRAME))
+        describe_message (description, sizeof(description), data, length);
+    printf ("0x%08llx: %8llu bytes, %s%s%s%s\n", (unsigned long long)offset,
+            (unsigned long long)length, description, description[0] ? " " : "",
+            damage_names[damage],
+            ((damage != DAMAGE_ZERO_FILL) && ((offset + length) == log->length))
+                ? " at end of file" : "");
+}
+
+// Classify and report the data skipped between the messages
+void
+report_skipped_data (
+    const LOG_FILE * log,
+    const LOG_RANGE * range
+    )
+{
+    const uint8_t * data;
+    uint64_t length;
+    uint64_t zeros;
+
+    // Locate the zero fill at the end of the range
+    data = &log->data[range->offset];
+    zeros = 0;
+    while ((zeros < range->length) && (!data[range->length - zeros - 1]))
+        zeros += 1;
+    if (zeros < ZERO_FILL_MINIMUM)
+        zeros = 0;
+
+    // Report the data preceding the zero fill
+    length = range->length - zeros;
+    if (length)
+        report_damage (log, range->offset, length,
+                       gpsMessageParserFindPreamble (data, &data[1]) == data
+                           ? DAMAGE_PARTIAL_FRAME : DAMAGE_INVALID_DATA);
+
+    // Report the zero fill
+    if (zeros)
+        report_damage (log, range->offset + length, zeros, DAMAGE_ZERO_FILL);
+}
+
+// Report the restart messages and the damaged data in file order
+void
+report (
+    const LOG_FILE * log,
+    const LOG_CHUNK * chunks,
+    int count,
+    const LOG_RANGE_LIST * bad_data
+    )
+{
+    int bad_index;
+    int chunk;
+    int length;
+    const RESTART_LIST * list;
+    const LOG_RANGE * range;
+    const LOG_RANGE * restart;
+    int restart_index;
+
+    bad_index = 0;
+    chunk = 0;
+    restart_index = 0;
+    while (1) {
+        // Locate the next restart message
+        restart = NULL;
+        while ((!restart) && (chunk < count)) {
+            list = chunks[chunk].context;
+            if (restart_index < list->messages.count)
+                restart = &list->messages.entries[restart_index++];
+            else {
+                chunk += 1;
+                restart_index = 0;
+            }
+        }
+
+        // Report the damaged data preceding the restart message
+        while ((bad_index < bad_data->count)
+            && ((!restart) || (bad_data->entries[bad_index].offset < restart->offset))) {
+            range = &bad_data->entries[bad_index++];
+            if (range->type == SENTENCE_TYPE_NONE)
+                report_skipped_data (log, range);
+            else
+                report_damage (log, range->offset, range->length, DAMAGE_BAD_CHECKSUM);
+        }
+        if (!restart)
+            break;
+
+        // Report the restart message without the checksum and line termination
+        length = restart->length;
+        while ((length > 0) && (log->data[restart->offset + length - 1] != '*'))
+            length -= 1;
+        length -= strlen (RESTART_MESSAGE) + 1;
+        printf ("0x%08llx: Logging restart, reset reason: %.*s\n",
+                (unsigned long long)restart->offset, (length > 0) ? length : 0,
+                &log->data[restart->offset + strlen (RESTART_MESSAGE)]);
+    }
+}
+
+//----------------------------------------
+// Repair routines
+//----------------------------------------
+
+// Build the repaired file name by replacing the extension
+void
+repaired_name (
+    char * output,
+    size_t output_length,
+    const char * input
+    )
+{
+    const char * dot;
+    int length;
+
+    dot = strrchr (input, '.');
+    if (dot && strchr (dot, '/'))
+        dot = NULL;
+    length = dot ? (int)(dot - input) : (int)strlen (input);
+    snprintf (output, output_length, "%.*s_repaired.ubx", length, input);
+}
+
+// Write the log file data without the damaged data, returns the number of
+// bytes written or -1 upon failure
+int64_t
+write_repaired_file (
+    const char * file_name,
+    const LOG_FILE * log,
+    const LOG_RANGE_LIST * bad_data
+    )
+{
+    FILE * file;
+    int index;
+    uint64_t length;
+    uint64_t offset;
+    int64_t written;
+
+    file = fopen (file_name, "wb");
+    if (!file) {
+        perror ("ERROR - Failed to create the repaired file");
+        return -1;
+    }
+
+    // Write the valid data between the damaged data ranges
+    offset = 0;
+    written = 0;
+    for (index = 0; index <= bad_data->count; index++) {
+        length = ((index < bad_data->count) ? bad_data->entries[index].offset : log->length) - offset;
+        if (length && (fwrite (&log->data[offset], 1, length, file) != length)) {
+            written = -1;
+            break;
+        }
+        written += length;
+        if (index < bad_data->count)
+            offset = bad_data->entries[index].offset + bad_data->entries[index].length;
+    }
+    if (fclose (file))
+        written = -1;
+    if (written < 0)
+        fprintf (stderr, "ERROR - Failed to write %s!\n", file_name);
+    return written;
+}
+
+//----------------------------------------
+// Main program
+//----------------------------------------
+
+int
+main (
+    int argc,
+    char ** argv
+    )
+{
+    int arg;
+    LOG_RANGE_LIST bad_data;
+    LOG_CHUNK * chunks;
+    int damage;
+    uint64_t damaged_bytes;
+    uint64_t errors[SENTENCE_TYPE_UBX + 1];
+    const char * file_name;
+    int index;
+    LOG_FILE log;
+    uint64_t messages[SENTENCE_TYPE_UBX + 1];
+    char output_name[1024];
+    bool report_only;
+    RESTART_LIST * restarts;
+    double start;
+    int status;
+    int threads;
+    int type;
+    uint64_t valid_bytes;
+    int64_t written;
+
+    // Get the options
+    report_only = false;
+    threads = log_parser_threads (NULL);
+    for (arg = 1; arg < argc; arg++) {
+        if (!strcmp (argv[arg], "-n"))
+            report_only = true;
+        else if ((!strcmp (argv[arg], "-t")) && (arg < (argc - 1)))
+            threads = log_parser_threads (argv[++arg]);
+        else
+            break;
+    }
+
+    // Display the help text
+    if ((arg >= argc) || ((argc - arg) > 2)) {
+        fprintf (stderr, "%s   [-n]   [-t threads]   log_file   [repaired_file]\n", argv[0]);
+        return -1;
+    }
+    file_name = argv[arg];
+    if ((argc - arg) == 2)
+        snprintf (output_name, sizeof(output_name), "%s", argv[arg + 1]);
+    else
+        repaired_name (output_name, sizeof(output_name), file_name);
+
+    // Map the log file into memory
+    if (log_file_open (&log, file_name))
+        return -2;
+
+    status = -3;
+    memset (&bad_data, 0, sizeof(bad_data));
+    restarts = calloc (threads, sizeof(*restarts));
+    chunks = log_chunks_alloc (threads);
+    do {
+        if ((!chunks) || (!restarts)) {
+            fprintf (stderr, "ERROR - Failed to allocate the chunk results!\n");
+            break;
+        }
+        for (index = 0; index < threads; index++)
+            chunks[index].context = &restarts[index];
+
+        // Scan the log file
+        start = log_parser_time ();
+        if (log_parse (&log, chunks, threads, &callbacks))
+            break;
+        if (log_bad_data (&log, chunks, threads, &bad_data)) {
+            fprintf (stderr, "ERROR - Failed to allocate the bad data list!\n");
+            break;
+        }
+
+        // Total the messages
+        valid_bytes = 0;
+        memset (errors, 0, sizeof(errors));
+        memset (messages, 0, sizeof(messages));
+        for (index = 0; index < threads; index++) {
+            valid_bytes += chunks[index].bytes;
+            for (type = 0; type <= SENTENCE_TYPE_UBX; type++) {
+                errors[type] += chunks[index].errors[type];
+                messages[type] += chunks[index].messages[type];
+            }
+        }
+
+        // Display the damaged data
+        report (&log, chunks, threads, &bad_data);
+        printf ("%s: %llu bytes, %d threads, %.2f MB/s\n", file_name, (unsigned long long)log.length,
+                threads, log.length / (1024. * 1024.) / (log_parser_time () - start));
+        printf ("    Valid: %llu NMEA, %llu RTCM, %llu UBX, %llu bytes\n",
+                (unsigned long long)messages[SENTENCE_TYPE_NMEA],
+                (unsigned long long)messages[SENTENCE_TYPE_RTCM],
+                (unsigned long long)messages[SENTENCE_TYPE_UBX],
+                (unsigned long long)valid_bytes);
+        damaged_bytes = 0;
+        for (damage = 0; damage < DAMAGE_MAX; damage++) {
+            damaged_bytes += damage_bytes[damage];
+            if (damage_count[damage])
+                printf ("    %s: %llu ranges, %llu bytes\n", damage_names[damage],
+                        (unsigned long long)damage_count[damage],
+                        (unsigned long long)damage_bytes[damage]);
+        }
+        for (type = SENTENCE_TYPE_NMEA; type <= SENTENCE_TYPE_UBX; type++)
+            if (errors[type])
+                printf ("    %s bad checksums: %llu\n", message_types[type], (unsigned long long)errors[type]);
+
+        // Write the repaired file
+        status = 0;
+        if (report_only)
+            break;
+        if (!damaged_bytes) {
+            printf ("No damaged data found, %s not written\n", output_name);
+            break;
+        }
+        written = write_repaired_file (output_name, &log, &bad_data);
+        if (written < 0) {
+            status = -4;
+            break;
+        }
+        printf ("%s: %lld bytes written, %llu bytes removed\n", output_name, (long long)written,
+                (unsigned long long)damaged_bytes);
+    } while (0);
+
+    // Done with the log file
+    if (restarts)
+        for (index = 0; index < threads; index++)
+            free (restarts[index].messages.entries);
+    free (restarts);
+    free (bad_data.entries);
+    log_chunks_free (chunks, threads);
+    log_file_close (&log);
+    return status;
+}
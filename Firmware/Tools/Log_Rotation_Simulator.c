@@ -0,0 +1,587 @@
+// Log_Rotation_Simulator.c
+//
+// Exercise the log file rotation with the firmware ring buffer and the
+// firmware epoch boundary selection.
+//
+// The producer thread writes 20 Hz navigation epochs into the ring buffer in
+// real time.  Each epoch contains NMEA GGA, GST and RMC sentences, UBX
+// NAV-PVT, NAV-HPPOSLLH and RXM-RAWX messages, RTCM 1005 once a second and
+// ends with UBX NAV-EOE.  The SD card consumer thread writes the messages to
+// in-memory log files and switches to the next log file when logRotateMessage
+// selects an epoch boundary.  The loop thread creates the next log file every
+// few seconds while holding the SD card lock, as updateLogs does, and the
+// consumer periodically stalls as the microSD card does.
+//
+// At the end of the run the log files are verified:
+//
+//    * The ring buffer dropped or discarded no data
+//    * The log files, less their headers, contain every message in order
+//    * Each log file starts with the first message of an epoch
+//
+// The -l option uses the previous rotation which closes the log file and
+// creates the next log file while the consumer discards the data, the lost
+// data is reported.  The -n option omits NAV-EOE so the epoch boundary is
+// found by the change in the time.
+//
+// Usage:
+//
+//    Log_Rotation_Simulator  [-l]  [-n]
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../RTK_Surveyor/crc24q.h"
+#include "../RTK_Surveyor/RingBuffer.h"
+#include "../RTK_Surveyor/RingBuffer.ino"
+#include "../RTK_Surveyor/LogIndex.h"
+#include "../RTK_Surveyor/LogIndex.ino"
+#include "../RTK_Surveyor/LogRotate.h"
+#include "../RTK_Surveyor/LogRotate.ino"
+
+#define RING_BUFFER_SIZE    16384
+#define SPILL_SIZE          3000        // Matches PARSE_BUFFER_LENGTH
+#define OFFSET_ENTRIES      ((RING_BUFFER_SIZE >> 1) / 32)
+#define SD_CARD_FILTER      2           // Matches MESSAGE_FILTER_SD_CARD
+
+#define RUN_SECONDS         12
+#define ROTATE_SECONDS      2           // Time between log file rotations
+#define EPOCH_RATE          20          // Navigation epochs per second
+#define RAWX_SATELLITES     32          // Measurements in each RXM-RAWX message
+
+#define PREPARE_MSEC        200         // Create and pre-allocate the next log file
+#define CLOSE_MSEC          40          // Truncate, sync and close the log file
+#define STALL_MSEC          100         // microSD card write latency
+#define STALL_INTERVAL_MSEC 1000        // Time between write stalls
+
+#define HEADER              "$GNTXT,01,01,00,HEADER*00\r\n"
+#define MAX_FILES           64
+#define MAX_MESSAGE         (8 + 16 + (RAWX_SATELLITES * 32))
+
+//----------------------------------------
+// Types
+//----------------------------------------
+
+typedef struct _BUFFER
+{
+    uint8_t * data;
+    uint64_t length;
+    uint64_t maxLength;
+} BUFFER;
+
+typedef struct _LOG_FILE
+{
+    BUFFER buffer;
+    uint64_t headerLength;          // Bytes written by sdLogStart
+} LOG_FILE;
+
+//----------------------------------------
+// Locals
+//----------------------------------------
+
+RING_BUFFER ring;
+RING_BUFFER_CONSUMER sdConsumer;
+pthread_mutex_t sdCardSemaphore = PTHREAD_MUTEX_INITIALIZER;
+volatile bool running;
+volatile bool producing;
+bool legacy;
+bool noEndOfEpoch;
+
+// Producer data
+BUFFER reference;                   // All of the committed messages
+uint64_t * epochOffsets;            // Offset in reference of the first message of each epoch
+uint64_t epochCount;
+uint64_t discardedBytes;
+
+// SD card consumer data
+LOG_FILE files[MAX_FILES];
+volatile int fileCount;
+volatile bool nextFileReady;
+volatile bool logging;
+bool messageStart;
+LOG_ROTATE logRotate;
+uint64_t maxUsed;
+
+double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1000000000.);
+}
+
+void sleepMicroseconds (int microseconds)
+{
+    struct timespec ts;
+
+    ts.tv_sec = microseconds / 1000000;
+    ts.tv_nsec = (microseconds % 1000000) * 1000;
+    nanosleep (&ts, NULL);
+}
+
+void append (BUFFER * buffer, const uint8_t * data, uint64_t length)
+{
+    uint64_t maxLength;
+
+    if ((buffer->length + length) > buffer->maxLength) {
+        maxLength = buffer->maxLength ? buffer->maxLength * 2 : 65536;
+        while (maxLength < (buffer->length + length))
+            maxLength *= 2;
+        buffer->data = realloc (buffer->data, maxLength);
+        if (!buffer->data) {
+            fprintf (stderr, "ERROR - Failed to allocate buffer!\n");
+            exit (-1);
+        }
+        buffer->maxLength = maxLength;
+    }
+    memcpy (&buffer->data[buffer->length], data, length);
+    buffer->length += length;
+}
+
+//----------------------------------------
+// Message generation
+//----------------------------------------
+
+// Build a UBX message, returns the message length
+int ubxMessage (uint8_t * data, uint8_t class, uint8_t id, const uint8_t * payload, int payloadLength)
+{
+    uint8_t ckA;
+    uint8_t ckB;
+    int index;
+
+    data[0] = 0xb5;
+    data[1] = 0x62;
+    data[2] = class;
+    data[3] = id;
+    data[4] = payloadLength;
+    data[5] = payloadLength >> 8;
+    memcpy (&data[6], payload, payloadLength);
+    ckA = 0;
+    ckB = 0;
+    for (index = 2; index < (6 + payloadLength); index++) {
+        ckA += data[index];
+        ckB += ckA;
+    }
+    data[6 + payloadLength] = ckA;
+    data[7 + payloadLength] = ckB;
+    return 8 + payloadLength;
+}
+
+// Build a UBX NAV message starting with iTOW, returns the message length
+int ubxNavMessage (uint8_t * data, uint8_t id, int towOffset, uint32_t towMs, int payloadLength)
+{
+    uint8_t payload[MAX_MESSAGE];
+    int index;
+
+    for (index = 0; index < payloadLength; index++)
+        payload[index] = rand ();
+    if (towOffset)
+        payload[0] = 0; // Version
+    payload[towOffset] = towMs;
+    payload[towOffset + 1] = towMs >> 8;
+    payload[towOffset + 2] = towMs >> 16;
+    payload[towOffset + 3] = towMs >> 24;
+    return ubxMessage (data, 0x01, id, payload, payloadLength);
+}
+
+// Build an RXM-RAWX message, returns the message length
+int ubxRawxMessage (uint8_t * data, uint32_t towMs)
+{
+    uint8_t payload[MAX_MESSAGE];
+    int index;
+    double rcvTow;
+
+    for (index = 0; index < (16 + (RAWX_SATELLITES * 32)); index++)
+        payload[index] = rand ();
+    rcvTow = towMs / 1000.;
+    memcpy (payload, &rcvTow, sizeof (rcvTow));
+    payload[11] = RAWX_SATELLITES;
+    return ubxMessage (data, 0x02, 0x15, payload, 16 + (RAWX_SATELLITES * 32));
+}
+
+// Build an NMEA sentence with the time of day, returns the sentence length
+int nmeaSentence (uint8_t * data, const char * name, uint32_t towMs, const char * fields)
+{
+    uint8_t checksum;
+    uint32_t dayMs;
+    int index;
+    int length;
+
+    // The time of week converted to the time of day, leap seconds ignored
+    dayMs = towMs % (24 * 60 * 60 * 1000);
+    length = sprintf ((char *)data, "$GN%s,%02u%02u%02u.%02u,%s", name, dayMs / 3600000,
+                      (dayMs / 60000) % 60, (dayMs / 1000) % 60, (dayMs % 1000) / 10, fields);
+    checksum = 0;
+    for (index = 1; index < length; index++)
+        checksum ^= data[index];
+    length += sprintf ((char *)&data[length], "*%02X\r\n", checksum);
+    return length;
+}
+
+// Build an RTCM 1005 message, returns the message length
+int rtcm1005Message (uint8_t * data)
+{
+    uint32_t crc;
+    int index;
+
+    data[0] = 0xd3;
+    data[1] = 0;
+    data[2] = 19;
+    data[3] = 1005 >> 4;
+    data[4] = (1005 & 0xf) << 4;
+    for (index = 5; index < (3 + 19); index++)
+        data[index] = rand ();
+    crc = crc24qSpan (0, data, 3 + 19);
+    data[22] = crc >> 16;
+    data[23] = crc >> 8;
+    data[24] = crc;
+    return 25;
+}
+
+//----------------------------------------
+// Producer, models gnssReadTask
+//----------------------------------------
+
+void produce (const uint8_t * message, int length)
+{
+    uint8_t * data;
+    int offset;
+    uint32_t head;
+
+    // Discard the oldest data when the ring buffer is full
+    if (length > ringBufferAvailable (&ring, NULL))
+        discardedBytes += ringBufferDiscard (&ring, length, NULL);
+
+    // Copy the message to the head of the ring buffer, the spill area holds
+    // the part past the end of the ring buffer
+    head = ring.head;
+    data = &ring.data[head];
+    for (offset = 0; offset < length; offset++)
+        data[offset] = message[offset];
+    if (!ringBufferAccept (&ring, length, RING_BUFFER_PRIORITY_NORMAL))
+        return;
+    ringBufferCommit (&ring, length, RING_BUFFER_PRIORITY_NORMAL, 0);
+    append (&reference, message, length);
+}
+
+void * producerThread (void * arg)
+{
+    uint64_t epoch;
+    uint8_t message[MAX_MESSAGE];
+    double start;
+    uint32_t towMs;
+
+    start = now ();
+    towMs = 345600000; // Thursday 00:00
+    for (epoch = 0; running; epoch++) {
+        // Wait for the next epoch
+        while (now () < (start + ((double)epoch / EPOCH_RATE)))
+            sleepMicroseconds (500);
+
+        // Remember the start of the epoch
+        epochOffsets[epochCount++] = reference.length;
+
+        // Output the epoch
+        produce (message, nmeaSentence (message, "GGA", towMs,
+                 "4003.12345678,N,10511.12345678,W,4,32,0.5,1600.123,M,-21.456,M,1.0,0000"));
+        produce (message, ubxNavMessage (message, 0x07, 0, towMs, 92));  // PVT
+        produce (message, ubxNavMessage (message, 0x14, 4, towMs, 36));  // HPPOSLLH
+        produce (message, ubxRawxMessage (message, towMs));
+        produce (message, nmeaSentence (message, "GST", towMs, "0.5,0.010,0.008,45.0,0.009,0.009,0.015"));
+        produce (message, nmeaSentence (message, "RMC", towMs,
+                 "A,4003.12345678,N,10511.12345678,W,0.012,,010125,,,R,V"));
+        if ((epoch % EPOCH_RATE) == 0)
+            produce (message, rtcm1005Message (message));
+        if (!noEndOfEpoch)
+            produce (message, ubxNavMessage (message, 0x61, 0, towMs, 4));  // EOE
+
+        towMs += 1000 / EPOCH_RATE;
+    }
+    producing = false;
+    return NULL;
+}
+
+//----------------------------------------
+// SD card consumer, models sdConsumerSend
+//----------------------------------------
+
+// Start writing the log file, models sdLogStart
+void sdLogStart (void)
+{
+    LOG_FILE * file;
+
+    file = &files[fileCount];
+    append (&file->buffer, (const uint8_t *)HEADER, strlen (HEADER));
+    file->headerLength = file->buffer.length;
+    fileCount += 1;
+}
+
+// Switch to the next log file, models sdLogSwitch
+void sdLogSwitch (void)
+{
+    if (!nextFileReady)
+        return;
+    sleepMicroseconds (CLOSE_MSEC * 1000);
+    sdLogStart ();
+    nextFileReady = false;
+}
+
+bool sdConsumerConnected (P_RING_BUFFER_CONSUMER consumer)
+{
+    return logging;
+}
+
+int32_t sdConsumerSend (P_RING_BUFFER_CONSUMER consumer, const uint8_t * data, int32_t length)
+{
+    static double nextStall;
+    bool messageBoundary;
+    uint64_t used;
+
+    pthread_mutex_lock (&sdCardSemaphore);
+
+    // Discard the data if the log file was closed
+    if (!logging) {
+        pthread_mutex_unlock (&sdCardSemaphore);
+        return length;
+    }
+
+    // Switch to the next log file before the first message of an epoch
+    messageBoundary = consumer->messageEnd;
+    if (messageStart && logRotateMessage (&logRotate, data, length))
+        sdLogSwitch ();
+    messageStart = messageBoundary;
+
+    // Write the data to the log file
+    append (&files[fileCount - 1].buffer, data, length);
+
+    // Simulate the microSD card write latency
+    if (now () >= nextStall) {
+        if (nextStall)
+            sleepMicroseconds (STALL_MSEC * 1000);
+        nextStall = now () + (STALL_INTERVAL_MSEC / 1000.);
+    }
+    used = ringBufferUsed (&ring, consumer);
+    if (maxUsed < used)
+        maxUsed = used;
+
+    pthread_mutex_unlock (&sdCardSemaphore);
+    return length;
+}
+
+void * consumerThread (void * arg)
+{
+    while (producing || ringBufferUsed (&ring, &sdConsumer)) {
+        if (!ringBufferService (&ring, &sdConsumer))
+            sleepMicroseconds (1000);
+    }
+    return NULL;
+}
+
+//----------------------------------------
+// Loop, models updateLogs
+//----------------------------------------
+
+void * loopThread (void * arg)
+{
+    double rotateTime;
+
+    rotateTime = now () + ROTATE_SECONDS;
+    while (running) {
+        sleepMicroseconds (10 * 1000);
+        if ((now () < rotateTime) || nextFileReady || (fileCount >= (MAX_FILES - 1)))
+            continue;
+        rotateTime += ROTATE_SECONDS;
+
+        if (legacy) {
+            // Close the log file, the data is discarded until the next loop
+            // creates the next log file
+            pthread_mutex_lock (&sdCardSemaphore);
+            logging = false;
+            sleepMicroseconds (CLOSE_MSEC * 1000);
+            pthread_mutex_unlock (&sdCardSemaphore);
+            sleepMicroseconds (10 * 1000);
+            pthread_mutex_lock (&sdCardSemaphore);
+            sleepMicroseconds (PREPARE_MSEC * 1000);
+            sdLogStart ();
+            messageStart = true;
+            logRotateInit (&logRotate);
+            logging = true;
+            pthread_mutex_unlock (&sdCardSemaphore);
+            continue;
+        }
+
+        // Create and pre-allocate the next log file, models sdLogPrepareNext
+        pthread_mutex_lock (&sdCardSemaphore);
+        sleepMicroseconds (PREPARE_MSEC * 1000);
+        nextFileReady = true;
+        logRotateRequest (&logRotate);
+        pthread_mutex_unlock (&sdCardSemaphore);
+    }
+    return NULL;
+}
+
+//----------------------------------------
+// Verification
+//----------------------------------------
+
+// Determine if the offset is the start of an epoch
+bool epochStart (uint64_t offset)
+{
+    uint64_t high;
+    uint64_t low;
+    uint64_t middle;
+
+    low = 0;
+    high = epochCount;
+    while (low < high) {
+        middle = (low + high) / 2;
+        if (epochOffsets[middle] == offset)
+            return true;
+        if (epochOffsets[middle] < offset)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return false;
+}
+
+int
+main (
+    int argc,
+    char ** argv
+    )
+{
+    int arg;
+    uint8_t * data;
+    uint64_t errors;
+    uint8_t * filterArray;
+    int index;
+    uint64_t length;
+    uint64_t lostBytes;
+    pthread_t loop;
+    uint64_t offset;
+    RING_BUFFER_OFFSET * offsetArray;
+    uint8_t * priorityArray;
+    pthread_t producer;
+    pthread_t consumer;
+
+    // Get the options
+    for (arg = 1; arg < argc; arg++) {
+        if (!strcmp (argv[arg], "-l"))
+            legacy = true;
+        else if (!strcmp (argv[arg], "-n"))
+            noEndOfEpoch = true;
+        else {
+            fprintf (stderr, "%s   [-l]   [-n]\n", argv[0]);
+            fprintf (stderr, "    -l    Close the log file and then create the next log file\n");
+            fprintf (stderr, "    -n    Don't output the NAV-EOE message\n");
+            return -1;
+        }
+    }
+
+    // Allocate the ring buffer, leave room for a message past the end
+    data = malloc (RING_BUFFER_SIZE + SPILL_SIZE);
+    offsetArray = malloc (OFFSET_ENTRIES * sizeof (*offsetArray));
+    priorityArray = malloc (OFFSET_ENTRIES);
+    filterArray = malloc (OFFSET_ENTRIES);
+    epochOffsets = malloc (((RUN_SECONDS + 1) * EPOCH_RATE) * sizeof (*epochOffsets));
+    if ((!data) || (!offsetArray) || (!priorityArray) || (!filterArray) || (!epochOffsets)) {
+        fprintf (stderr, "ERROR - Failed to allocate the ring buffer!\n");
+        return -2;
+    }
+    ringBufferInit (&ring, data, RING_BUFFER_SIZE, offsetArray, priorityArray,
+                    filterArray, OFFSET_ENTRIES, RING_BUFFER_SIZE >> 2);
+
+    // Register the SD card consumer
+    sdConsumer.name = "SD Card";
+    sdConsumer.connected = sdConsumerConnected;
+    sdConsumer.send = sdConsumerSend;
+    sdConsumer.filter = SD_CARD_FILTER;
+    if (!ringBufferRegister (&ring, &sdConsumer)) {
+        fprintf (stderr, "ERROR - Failed to register the SD card consumer\n");
+        return -3;
+    }
+
+    // Open the first log file, models beginLogging
+    logRotateInit (&logRotate);
+    sdLogStart ();
+    messageStart = true;
+    logging = true;
+
+    // Run the simulation
+    printf ("Simulating %d seconds of %d Hz epochs, rotating the log file every %d seconds%s\n",
+            RUN_SECONDS, EPOCH_RATE, ROTATE_SECONDS, legacy ? " by closing the log file" : "");
+    running = true;
+    producing = true;
+    pthread_create (&producer, NULL, producerThread, NULL);
+    pthread_create (&consumer, NULL, consumerThread, NULL);
+    pthread_create (&loop, NULL, loopThread, NULL);
+    sleepMicroseconds (RUN_SECONDS * 1000000);
+    running = false;
+    pthread_join (producer, NULL);
+    pthread_join (loop, NULL);
+    pthread_join (consumer, NULL);
+
+    // Display the results
+    printf ("Producer: %llu epochs, %llu bytes, %llu bytes/second\n", (unsigned long long)epochCount,
+            (unsigned long long)reference.length, (unsigned long long)(reference.length / RUN_SECONDS));
+    printf ("Ring buffer: %d bytes, %llu bytes maximum use\n", RING_BUFFER_SIZE, (unsigned long long)maxUsed);
+    printf ("%-6s %12s %12s %12s\n", "File", "Bytes", "Offset", "Epoch Start");
+    errors = 0;
+    offset = 0;
+    lostBytes = 0;
+    for (index = 0; index < fileCount; index++) {
+        LOG_FILE * file = &files[index];
+        bool start;
+
+        // Locate the log file data in the producer data
+        length = file->buffer.length - file->headerLength;
+        while (((offset + length) <= reference.length)
+               && memcmp (&file->buffer.data[file->headerLength], &reference.data[offset], length)) {
+            if (!legacy)
+                break;
+            offset += 1;
+            lostBytes += 1;
+        }
+        start = epochStart (offset);
+        printf ("%-6d %12llu %12llu %12s\n", index, (unsigned long long)length, (unsigned long long)offset,
+                start ? "Yes" : "No");
+        if (((offset + length) > reference.length)
+            || memcmp (&file->buffer.data[file->headerLength], &reference.data[offset], length)) {
+            fprintf (stderr, "ERROR - File %d data does not match the messages at offset %llu\n",
+                     index, (unsigned long long)offset);
+            errors += 1;
+            break;
+        }
+        if ((!legacy) && (!start)) {
+            fprintf (stderr, "ERROR - File %d does not start with the first message of an epoch\n", index);
+            errors += 1;
+        }
+        offset += length;
+    }
+    lostBytes += reference.length - offset;
+    printf ("Rotations: %d, epochs detected: %u, discarded: %llu bytes, dropped: %u messages, lost: %llu bytes\n",
+            fileCount - 1, logRotate.epochs, (unsigned long long)discardedBytes,
+            ring.droppedMessages[RING_BUFFER_PRIORITY_NORMAL], (unsigned long long)lostBytes);
+
+    // Verify that no data was lost
+    if ((!legacy) && (discardedBytes || ring.droppedMessages[RING_BUFFER_PRIORITY_NORMAL] || lostBytes)) {
+        fprintf (stderr, "ERROR - Data lost during the log file rotation\n");
+        errors += 1;
+    }
+    if (fileCount < ((RUN_SECONDS / ROTATE_SECONDS) - 1)) {
+        fprintf (stderr, "ERROR - Only %d log files were written\n", fileCount);
+        errors += 1;
+    }
+    if (errors) {
+        fprintf (stderr, "ERROR - %llu errors detected!\n", (unsigned long long)errors);
+        return -4;
+    }
+    return 0;
+}
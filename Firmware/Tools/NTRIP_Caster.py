@@ -0,0 +1,284 @@
+# NTRIP caster used to test the NTRIP client and NTRIP server on the RTK
+# device against both versions of the protocol.
+#
+#   * NTRIP 1: ICY 200 OK responses and SOURCE requests
+#   * NTRIP 2: HTTP/1.1 responses with Transfer-Encoding: chunked in both
+#     directions, Ntrip-GGA request headers
+#
+# The data received from an NTRIP server on the mount point is relayed to the
+# NTRIP clients.  Without an NTRIP server, synthetic RTCM 1005 messages are
+# sent once a second.  GGA sentences received from the clients are displayed.
+#
+# Use --drop to close the connections periodically and display how quickly
+# the device reconnects:
+#
+#   python NTRIP_Caster.py --port 2101 --mount bldr_SparkFun1 --user rover --password secret --drop 30
+
+import argparse
+import base64
+import socket
+import struct
+import threading
+import time
+
+lock = threading.Lock()
+clients = []                # Sockets and NTRIP versions of the streaming clients
+disconnectTimes = {}        # Time of the last dropped connection by address
+serverActive = False        # NTRIP server is connected to the mount point
+
+#----------------------------------------
+# RTCM
+#----------------------------------------
+
+def crc24q(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte << 16
+        for _ in range(8):
+            crc <<= 1
+            if crc & 0x1000000:
+                crc ^= 0x1864CFB
+    return crc & 0xFFFFFF
+
+# Build an RTCM 1005 message: station ARP for 40.09N, 105.18W
+def rtcm1005():
+    x, y, z = -1283604.0, -4726447.0, 4080150.0
+    bits = 0
+    value = 0
+    for width, field in ((12, 1005), (12, 0), (6, 0), (1, 1), (1, 1), (1, 1), (1, 0),
+                         (38, int(x * 10000)), (1, 0), (1, 0),
+                         (38, int(y * 10000)), (2, 0),
+                         (38, int(z * 10000))):
+        value = (value << width) | (field & ((1 << width) - 1))
+        bits += width
+    payload = value.to_bytes(bits // 8, "big")
+    frame = bytes([0xD3, len(payload) >> 8, len(payload) & 0xFF]) + payload
+    return frame + struct.pack(">I", crc24q(frame))[1:]
+
+#----------------------------------------
+# HTTP
+#----------------------------------------
+
+def chunk(data, version):
+    if version == 2:
+        return "{:X}\r\n".format(len(data)).encode() + data + b"\r\n"
+    return data
+
+# Remove the chunk framing, returns the data and the remaining bytes
+def dechunk(buffer):
+    data = b""
+    while True:
+        end = buffer.find(b"\r\n")
+        if end < 0:
+            return data, buffer, False
+        length = int(buffer[:end].split(b";")[0], 16)
+        if length == 0:
+            return data, b"", True
+        if len(buffer) < end + 2 + length + 2:
+            return data, buffer, False
+        data += buffer[end + 2:end + 2 + length]
+        buffer = buffer[end + 2 + length + 2:]
+
+def readHeader(conn):
+    header = b""
+    while b"\r\n\r\n" not in header and b"\n\n" not in header:
+        data = conn.recv(1024)
+        if not data:
+            return None, b""
+        header += data
+    end = header.find(b"\r\n\r\n")
+    end = end + 4 if end >= 0 else header.find(b"\n\n") + 2
+    return header[:end].decode(errors="replace"), header[end:]
+
+def headerValue(lines, name):
+    for line in lines[1:]:
+        if line.lower().startswith(name.lower() + ":"):
+            return line[len(name) + 1:].strip()
+    return None
+
+def authorized(lines, args):
+    if not args.user:
+        return True
+    value = headerValue(lines, "Authorization")
+    expected = base64.b64encode("{}:{}".format(args.user, args.password).encode()).decode()
+    return value is not None and value.split()[-1] == expected
+
+def logConnection(addr, text):
+    now = time.time()
+    with lock:
+        dropped = disconnectTimes.pop(addr[0], None)
+    if dropped:
+        text += ", reconnected in {:.3f} seconds".format(now - dropped)
+    print("{} {}: {}".format(time.strftime("%H:%M:%S"), addr[0], text))
+
+#----------------------------------------
+# Connections
+#----------------------------------------
+
+def serveClient(conn, addr, lines, body, args):
+    version = 2 if "ntrip/2" in (headerValue(lines, "Ntrip-Version") or "").lower() else 1
+    gga = headerValue(lines, "Ntrip-GGA")
+    if gga:
+        print("    Ntrip-GGA: {}".format(gga))
+    if version == 2:
+        conn.sendall(b"HTTP/1.1 200 OK\r\nNtrip-Version: Ntrip/2.0\r\nServer: NTRIP Caster.py\r\n"
+                     b"Content-Type: gnss/data\r\nTransfer-Encoding: chunked\r\n\r\n")
+    else:
+        conn.sendall(b"ICY 200 OK\r\n\r\n")
+    logConnection(addr, "NTRIP {} client streaming {}".format(version, args.mount))
+    with lock:
+        clients.append((conn, version))
+
+    # Display the GGA sentences from the client
+    conn.settimeout(1)
+    data = body
+    while True:
+        for line in data.split(b"\n"):
+            if b"GGA" in line:
+                print("    GGA: {}".format(line.strip().decode(errors="replace")))
+        try:
+            data = conn.recv(1024)
+            if not data:
+                break
+        except socket.timeout:
+            data = b""
+        except OSError:
+            break
+    with lock:
+        if (conn, version) in clients:
+            clients.remove((conn, version))
+
+def serveServer(conn, addr, version, body):
+    global serverActive
+    if version == 2:
+        conn.sendall(b"HTTP/1.1 200 OK\r\nNtrip-Version: Ntrip/2.0\r\nServer: NTRIP Caster.py\r\n\r\n")
+    else:
+        conn.sendall(b"ICY 200 OK\r\n\r\n")
+    logConnection(addr, "NTRIP {} server".format(version))
+    serverActive = True
+    buffer = body
+    total = 0
+    while True:
+        if version == 2:
+            data, buffer, done = dechunk(buffer)
+        else:
+            data, buffer, done = buffer, b"", False
+        if data:
+            total += len(data)
+            broadcast(data)
+        if done:
+            break
+        try:
+            received = conn.recv(4096)
+        except OSError:
+            break
+        if not received:
+            break
+        buffer += received
+    serverActive = False
+    print("    NTRIP server disconnected after {} bytes".format(total))
+
+def serveConnection(conn, addr, args):
+    try:
+        header, body = readHeader(conn)
+        if header is None:
+            conn.close()
+            return
+        lines = header.splitlines()
+        request = lines[0].split()
+        method = request[0].upper() if request else ""
+
+        # NTRIP 1 server
+        if method == "SOURCE" and len(request) >= 3:
+            if args.password and request[1] != args.password:
+                conn.sendall(b"ERROR - Bad Password\r\n")
+            elif request[2].lstrip("/") != args.mount:
+                conn.sendall(b"ERROR - Bad Mountpoint\r\n")
+            else:
+                serveServer(conn, addr, 1, body)
+        elif method in ("GET", "POST") and len(request) >= 2:
+            version = 2 if "ntrip/2" in (headerValue(lines, "Ntrip-Version") or "").lower() else 1
+            mount = request[1].lstrip("/")
+            if not authorized(lines, args):
+                conn.sendall("HTTP/1.{} 401 Unauthorized\r\nWWW-Authenticate: Basic realm=\"NTRIP\"\r\n"
+                             "Connection: close\r\n\r\n".format(version - 1).encode())
+                logConnection(addr, "401 Unauthorized")
+            elif mount != args.mount:
+                conn.sendall(b"HTTP/1.1 404 Not Found\r\nConnection: close\r\n\r\n")
+                logConnection(addr, "404 Not Found: {}".format(mount))
+            elif method == "POST":
+                serveServer(conn, addr, version, body)
+            else:
+                serveClient(conn, addr, lines, body, args)
+        else:
+            conn.sendall(b"HTTP/1.0 400 Bad Request\r\n\r\n")
+    except (OSError, ValueError) as error:
+        print("    {}: {}".format(addr[0], error))
+    finally:
+        conn.close()
+
+def broadcast(data):
+    with lock:
+        for conn, version in list(clients):
+            try:
+                conn.sendall(chunk(data, version))
+            except OSError:
+                clients.remove((conn, version))
+
+# Close the connections to measure the reconnect time
+def dropConnections():
+    with lock:
+        for conn, version in clients:
+            disconnectTimes[conn.getpeername()[0]] = time.time()
+            conn.shutdown(socket.SHUT_RDWR)
+        clients.clear()
+    print("{} Dropped the client connections".format(time.strftime("%H:%M:%S")))
+
+#----------------------------------------
+# Application
+#----------------------------------------
+
+parser = argparse.ArgumentParser(description="NTRIP 1 and NTRIP 2 test caster")
+parser.add_argument("--host", default="0.0.0.0", help="Address to listen on")
+parser.add_argument("--port", type=int, default=2101, help="Caster port")
+parser.add_argument("--mount", default="bldr_SparkFun1", help="Mount point name")
+parser.add_argument("--user", default="", help="User name, empty to skip authorization")
+parser.add_argument("--password", default="", help="User password or NTRIP 1 SOURCE password")
+parser.add_argument("--drop", type=int, default=0, help="Drop the client connections every N seconds")
+args = parser.parse_args()
+
+print("Listening on {}:{}, mount point {}".format(args.host, args.port, args.mount))
+
+s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+s.bind((args.host, args.port))
+s.listen()
+s.settimeout(0.1)
+
+message = rtcm1005()
+nextMessage = time.time()
+nextDrop = time.time() + args.drop
+
+try:
+    while True:
+        try:
+            conn, addr = s.accept()
+            threading.Thread(target=serveConnection, args=(conn, addr, args), daemon=True).start()
+        except socket.timeout:
+            pass
+
+        # Send synthetic RTCM when no NTRIP server is connected
+        if time.time() >= nextMessage:
+            nextMessage += 1
+            if not serverActive:
+                broadcast(message)
+
+        if args.drop and (time.time() >= nextDrop):
+            nextDrop += args.drop
+            dropConnections()
+
+except KeyboardInterrupt:
+    pass
+
+finally:
+    s.close()
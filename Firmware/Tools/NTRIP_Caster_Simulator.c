@@ -0,0 +1,689 @@
+// NTRIP_Caster_Simulator.c
+//
+// Exercise the embedded NTRIP caster with rovers connected over the loopback
+// network.  The network layer is replaced by nonblocking POSIX sockets.
+//
+// The base produces an epoch of numbered RTCM messages protected by their
+// CRC-24Q every 100 milliseconds.  Each rover runs in its own process and
+// verifies the data it receives:
+//
+//    * NTRIP 1 and NTRIP 2 (chunked) rovers receive every message in order
+//    * A slow rover only loses whole message groups, never part of a message
+//    * Sourcetable requests for NTRIP 1 and NTRIP 2 return the mount point
+//    * A bad password is rejected with 401
+//    * An unknown NTRIP 2 mount point is rejected with 404
+//
+// The caster socket send buffers are reduced to approximate the small lwIP
+// and W5500 windows on the device.  At the end of the run the number of RTCM
+// buffers still allocated must be zero.
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../RTK_Surveyor/crc24q.h"
+#include "../RTK_Surveyor/NtripCaster.h"
+#include "../RTK_Surveyor/NtripCaster.ino"
+#include "../RTK_Surveyor/NtripHttp.ino"
+
+#define RUN_SECONDS         8.0
+#define EPOCH_MICROSECONDS  100000
+#define DRAIN_SECONDS       5.0
+#define SOCKET_BUFFER_SIZE  4096
+
+#define MOUNT_POINT         "bldr_SparkFun1"
+#define USER                "rover"
+#define PASSWORD            "secret"
+#define CREDENTIALS         "cm92ZXI6c2VjcmV0"  // base64 of rover:secret
+
+#define RTCM_HEADER_LENGTH  3
+#define RTCM_CRC_LENGTH     3
+#define MAX_RTCM_MESSAGE    (RTCM_HEADER_LENGTH + 1023 + RTCM_CRC_LENGTH)
+#define MAX_EPOCH           4096
+
+//----------------------------------------
+// Rovers
+//----------------------------------------
+
+enum ROVER_TYPE
+{
+    ROVER_STREAM = 0,       // Receive every message
+    ROVER_SLOW,             // Read slowly, message groups may be dropped
+    ROVER_SOURCE_TABLE,     // Request the sourcetable
+    ROVER_BAD_PASSWORD,     // Expect 401
+    ROVER_BAD_MOUNT_POINT,  // Expect 404
+};
+
+typedef struct _ROVER
+{
+    const char *name;
+    int type;               // ROVER_TYPE value
+    int version;            // NTRIP version 1 or 2
+} ROVER;
+
+ROVER rovers[] =
+{
+    {"NTRIP 1", ROVER_STREAM, 1},
+    {"NTRIP 1", ROVER_STREAM, 1},
+    {"NTRIP 1", ROVER_STREAM, 1},
+    {"NTRIP 1", ROVER_STREAM, 1},
+    {"NTRIP 2", ROVER_STREAM, 2},
+    {"NTRIP 2", ROVER_STREAM, 2},
+    {"NTRIP 2", ROVER_STREAM, 2},
+    {"NTRIP 2", ROVER_STREAM, 2},
+    {"Slow 1", ROVER_SLOW, 1},
+    {"Slow 2", ROVER_SLOW, 2},
+    {"Sourcetable 1", ROVER_SOURCE_TABLE, 1},
+    {"Sourcetable 2", ROVER_SOURCE_TABLE, 2},
+    {"Password 1", ROVER_BAD_PASSWORD, 1},
+    {"Password 2", ROVER_BAD_PASSWORD, 2},
+    {"Mount point 2", ROVER_BAD_MOUNT_POINT, 2},
+};
+#define ROVER_COUNT         (sizeof(rovers) / sizeof(rovers[0]))
+
+// Results written by the rover processes into shared memory
+typedef struct _RESULT
+{
+    bool responseOk;
+    bool done;
+    uint64_t bytes;
+    uint64_t messages;
+    uint64_t crcErrors;
+    uint64_t framingErrors;
+    uint64_t chunkErrors;
+    uint64_t gaps;
+    uint64_t orderErrors;
+    int64_t firstSequence;
+    int64_t lastSequence;
+} RESULT;
+
+RESULT * results;
+
+//----------------------------------------
+// Support routines
+//----------------------------------------
+
+double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1000000000.);
+}
+
+uint32_t nowMsec (void)
+{
+    return (uint32_t)(now () * 1000.);
+}
+
+void sleepMicroseconds (int microseconds)
+{
+    struct timespec ts;
+
+    ts.tv_sec = microseconds / 1000000;
+    ts.tv_nsec = (microseconds % 1000000) * 1000;
+    nanosleep (&ts, NULL);
+}
+
+// Build an RTCM message carrying the sequence number, returns the length
+int rtcmMessage (uint8_t * buffer, int messageNumber, uint32_t sequence, int payloadLength)
+{
+    uint32_t crc;
+    int index;
+
+    buffer[0] = 0xd3;
+    buffer[1] = (payloadLength >> 8) & 3;
+    buffer[2] = payloadLength & 0xff;
+    buffer[3] = messageNumber >> 4;
+    buffer[4] = (messageNumber & 0xf) << 4;
+    buffer[5] = sequence >> 24;
+    buffer[6] = sequence >> 16;
+    buffer[7] = sequence >> 8;
+    buffer[8] = sequence;
+    for (index = 6; index < payloadLength; index++)
+        buffer[RTCM_HEADER_LENGTH + index] = (uint8_t)(sequence * 31 + index);
+    crc = crc24qSpan (0, buffer, RTCM_HEADER_LENGTH + payloadLength);
+    buffer[RTCM_HEADER_LENGTH + payloadLength] = crc >> 16;
+    buffer[RTCM_HEADER_LENGTH + payloadLength + 1] = crc >> 8;
+    buffer[RTCM_HEADER_LENGTH + payloadLength + 2] = crc;
+    return RTCM_HEADER_LENGTH + payloadLength + RTCM_CRC_LENGTH;
+}
+
+//----------------------------------------
+// Rover processes
+//----------------------------------------
+
+typedef struct _ROVER_STATE
+{
+    RESULT * result;
+    int version;
+
+    // HTTP chunk decoding
+    int chunkState;
+    uint32_t chunkRemaining;
+    int chunkDigits;
+
+    // RTCM parsing
+    uint8_t message[MAX_RTCM_MESSAGE];
+    int messageLength;
+} ROVER_STATE;
+
+enum CHUNK_STATE
+{
+    CHUNK_SIZE = 0,
+    CHUNK_SIZE_LF,
+    CHUNK_DATA,
+    CHUNK_DATA_CR,
+    CHUNK_DATA_LF,
+};
+
+// Verify the RTCM message stream
+void roverRtcm (ROVER_STATE * rover, uint8_t data)
+{
+    uint32_t crc;
+    int length;
+    RESULT * result;
+    int64_t sequence;
+
+    result = rover->result;
+    if ((rover->messageLength == 0) && (data != 0xd3))
+    {
+        result->framingErrors += 1;
+        return;
+    }
+    rover->message[rover->messageLength++] = data;
+    if (rover->messageLength < RTCM_HEADER_LENGTH)
+        return;
+    length = (((rover->message[1] & 3) << 8) | rover->message[2]) + RTCM_HEADER_LENGTH + RTCM_CRC_LENGTH;
+    if (rover->messageLength < length)
+        return;
+    rover->messageLength = 0;
+
+    // Verify the CRC
+    crc = crc24qSpan (0, rover->message, length - RTCM_CRC_LENGTH);
+    if ((rover->message[length - 3] != (uint8_t)(crc >> 16))
+        || (rover->message[length - 2] != (uint8_t)(crc >> 8))
+        || (rover->message[length - 1] != (uint8_t)crc))
+    {
+        result->crcErrors += 1;
+        return;
+    }
+
+    // Verify the message order
+    sequence = ((uint32_t)rover->message[5] << 24) | (rover->message[6] << 16)
+             | (rover->message[7] << 8) | rover->message[8];
+    result->messages += 1;
+    if (result->firstSequence < 0)
+        result->firstSequence = sequence;
+    else if (sequence <= result->lastSequence)
+        result->orderErrors += 1;
+    else if (sequence != (result->lastSequence + 1))
+        result->gaps += 1;
+    result->lastSequence = sequence;
+}
+
+// Remove the NTRIP 2 chunk framing
+void roverData (ROVER_STATE * rover, const uint8_t * data, int length)
+{
+    int digit;
+    int index;
+
+    for (index = 0; index < length; index++)
+    {
+        rover->result->bytes += 1;
+        if (rover->version == 1)
+        {
+            roverRtcm (rover, data[index]);
+            continue;
+        }
+        switch (rover->chunkState)
+        {
+        case CHUNK_SIZE:
+            if (data[index] == '\r')
+            {
+                if ((!rover->chunkDigits) || (!rover->chunkRemaining))
+                    rover->result->chunkErrors += 1;
+                rover->chunkState = CHUNK_SIZE_LF;
+                break;
+            }
+            digit = (data[index] >= 'a') ? data[index] - 'a' + 10
+                  : (data[index] >= 'A') ? data[index] - 'A' + 10
+                  : data[index] - '0';
+            if ((digit < 0) || (digit > 15))
+                rover->result->chunkErrors += 1;
+            rover->chunkRemaining = (rover->chunkRemaining << 4) | (digit & 0xf);
+            rover->chunkDigits += 1;
+            break;
+
+        case CHUNK_SIZE_LF:
+            if (data[index] != '\n')
+                rover->result->chunkErrors += 1;
+            rover->chunkState = CHUNK_DATA;
+            break;
+
+        case CHUNK_DATA:
+            roverRtcm (rover, data[index]);
+            rover->chunkRemaining -= 1;
+            if (!rover->chunkRemaining)
+                rover->chunkState = CHUNK_DATA_CR;
+            break;
+
+        case CHUNK_DATA_CR:
+            if (data[index] != '\r')
+                rover->result->chunkErrors += 1;
+            rover->chunkState = CHUNK_DATA_LF;
+            break;
+
+        case CHUNK_DATA_LF:
+            if (data[index] != '\n')
+                rover->result->chunkErrors += 1;
+            rover->chunkState = CHUNK_SIZE;
+            rover->chunkDigits = 0;
+            rover->chunkRemaining = 0;
+            break;
+        }
+    }
+}
+
+// Connect to the caster, send the request and verify the data received
+void roverProcess (int index, int port)
+{
+    struct sockaddr_in address;
+    char buffer[8192];
+    int bufferSize;
+    int bytesRead;
+    char expected[64];
+    int headerLength;
+    int length;
+    char * end;
+    ROVER * rover;
+    ROVER_STATE state;
+    const char * mountPoint;
+    const char * password;
+    char request[512];
+    char response[2048];
+    int responseLength;
+    int s;
+
+    rover = &rovers[index];
+    memset (&state, 0, sizeof(state));
+    state.result = &results[index];
+    state.version = rover->version;
+    state.result->firstSequence = -1;
+    state.result->lastSequence = -1;
+
+    // Connect to the caster
+    s = socket (AF_INET, SOCK_STREAM, 0);
+    if (rover->type == ROVER_SLOW)
+    {
+        bufferSize = SOCKET_BUFFER_SIZE;
+        setsockopt (s, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+    }
+    memset (&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    address.sin_port = htons (port);
+    if (connect (s, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        perror ("ERROR - Rover connect failed");
+        exit (1);
+    }
+
+    // Build the request
+    mountPoint = MOUNT_POINT;
+    if (rover->type == ROVER_SOURCE_TABLE)
+        mountPoint = "";
+    else if (rover->type == ROVER_BAD_MOUNT_POINT)
+        mountPoint = "unknown";
+    password = (rover->type == ROVER_BAD_PASSWORD) ? "cm92ZXI6d3Jvbmc=" : CREDENTIALS;
+    if (rover->version == 1)
+        length = snprintf (request, sizeof(request),
+                           "GET /%s HTTP/1.0\r\n"
+                           "User-Agent: NTRIP NTRIP_Caster_Simulator\r\n"
+                           "Authorization: Basic %s\r\n"
+                           "\r\n",
+                           mountPoint, password);
+    else
+        length = snprintf (request, sizeof(request),
+                           "GET /%s HTTP/1.1\r\n"
+                           "Host: localhost\r\n"
+                           "Ntrip-Version: Ntrip/2.0\r\n"
+                           "User-Agent: NTRIP NTRIP_Caster_Simulator\r\n"
+                           "Authorization: Basic %s\r\n"
+                           "Connection: close\r\n"
+                           "\r\n",
+                           mountPoint, password);
+    if (write (s, request, length) != length)
+    {
+        perror ("ERROR - Rover request failed");
+        exit (1);
+    }
+
+    // Read the response header
+    responseLength = 0;
+    headerLength = 0;
+    while (!headerLength)
+    {
+        bytesRead = read (s, &response[responseLength], sizeof(response) - 1 - responseLength);
+        if (bytesRead <= 0)
+            break;
+        responseLength += bytesRead;
+        response[responseLength] = 0;
+        end = strstr (response, "\r\n\r\n");
+        if (end)
+            headerLength = end + 4 - response;
+        if (responseLength >= (int)(sizeof(response) - 1))
+            break;
+    }
+
+    // Verify the response
+    switch (rover->type)
+    {
+    case ROVER_STREAM:
+    case ROVER_SLOW:
+        state.result->responseOk = (rover->version == 1)
+                                 ? (strncmp (response, "ICY 200 OK\r\n", 12) == 0)
+                                 : ((strncmp (response, "HTTP/1.1 200 OK\r\n", 17) == 0)
+                                    && strstr (response, "Transfer-Encoding: chunked\r\n"));
+        break;
+
+    case ROVER_SOURCE_TABLE:
+        // Read the rest of the sourcetable
+        while ((bytesRead = read (s, &response[responseLength], sizeof(response) - 1 - responseLength)) > 0)
+        {
+            responseLength += bytesRead;
+            response[responseLength] = 0;
+        }
+        snprintf (expected, sizeof(expected), "STR;%s;", MOUNT_POINT);
+        state.result->responseOk = ((rover->version == 1)
+                                    ? (strncmp (response, "SOURCETABLE 200 OK\r\n", 20) == 0)
+                                    : ((strncmp (response, "HTTP/1.1 200 OK\r\n", 17) == 0)
+                                       && strstr (response, "Content-Type: gnss/sourcetable\r\n")))
+                                 && strstr (response, expected)
+                                 && strstr (response, "ENDSOURCETABLE\r\n");
+        break;
+
+    case ROVER_BAD_PASSWORD:
+        state.result->responseOk = (strstr (response, " 401 ") != NULL);
+        break;
+
+    case ROVER_BAD_MOUNT_POINT:
+        state.result->responseOk = (strncmp (response, "HTTP/1.1 404 ", 13) == 0);
+        break;
+    }
+
+    // Receive the RTCM data until the caster closes the connection
+    if ((rover->type == ROVER_STREAM) || (rover->type == ROVER_SLOW))
+    {
+        roverData (&state, (uint8_t *)&response[headerLength], responseLength - headerLength);
+        length = (rover->type == ROVER_SLOW) ? 256 : sizeof(buffer);
+        while ((bytesRead = read (s, buffer, length)) > 0)
+        {
+            roverData (&state, (uint8_t *)buffer, bytesRead);
+            if (rover->type == ROVER_SLOW)
+                sleepMicroseconds (25000);
+        }
+        if (state.messageLength)
+            state.result->framingErrors += 1;
+    }
+    close (s);
+    state.result->done = true;
+    exit (0);
+}
+
+//----------------------------------------
+// Caster network layer
+//----------------------------------------
+
+int32_t casterRead (P_NTRIP_CASTER_CLIENT client, uint8_t * buffer, int32_t length)
+{
+    ssize_t bytesRead;
+
+    bytesRead = recv ((int)(intptr_t)client->context, buffer, length, MSG_DONTWAIT);
+    if (bytesRead > 0)
+        return bytesRead;
+    if ((bytesRead < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+        return 0;
+    return -1;
+}
+
+int32_t casterWrite (P_NTRIP_CASTER_CLIENT client, const uint8_t * data, int32_t length)
+{
+    ssize_t bytesWritten;
+
+    bytesWritten = send ((int)(intptr_t)client->context, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (bytesWritten >= 0)
+        return bytesWritten;
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+        return 0;
+    return -1;
+}
+
+void casterClose (P_NTRIP_CASTER_CLIENT client)
+{
+    close ((int)(intptr_t)client->context);
+}
+
+// Accept the new rover connections
+void casterAccept (NTRIP_CASTER * caster, int listenSocket)
+{
+    int bufferSize;
+    P_NTRIP_CASTER_CLIENT client;
+    int s;
+
+    while ((s = accept (listenSocket, NULL, NULL)) >= 0)
+    {
+        bufferSize = SOCKET_BUFFER_SIZE;
+        setsockopt (s, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+        client = ntripCasterFreeClient (caster);
+        if (!client)
+        {
+            send (s, NTRIP_CASTER_FULL_RESPONSE, strlen(NTRIP_CASTER_FULL_RESPONSE), MSG_NOSIGNAL);
+            close (s);
+            continue;
+        }
+        ntripCasterConnect (caster, client, (void *)(intptr_t)s, nowMsec ());
+    }
+}
+
+//----------------------------------------
+// Application
+//----------------------------------------
+
+int main (int argc, char ** argv)
+{
+    struct sockaddr_in address;
+    socklen_t addressLength;
+    NTRIP_CASTER caster;
+    NTRIP_CASTER_CLIENT clients[NTRIP_CASTER_MAX_CLIENTS];
+    uint64_t dropped;
+    uint8_t epoch[MAX_EPOCH];
+    int epochLength;
+    double endTime;
+    int errors;
+    int index;
+    bool idle;
+    int listenSocket;
+    static const int messageNumbers[] = {1005, 1074, 1084, 1094, 1124, 1230};
+    int messageCount;
+    double nextEpoch;
+    int option;
+    pid_t pid;
+    int port;
+    RESULT * result;
+    ROVER * rover;
+    uint32_t sequence;
+    int status;
+    int streamRovers;
+
+    // Initialize the caster
+    if (!ntripCasterInit (&caster, clients, NTRIP_CASTER_MAX_CLIENTS, MOUNT_POINT, USER, PASSWORD,
+                          "SparkFun", 40.09, -105.18, casterRead, casterWrite, casterClose))
+    {
+        fprintf (stderr, "ERROR - ntripCasterInit failed\n");
+        return 1;
+    }
+
+    // Shared memory for the rover results
+    results = (RESULT *)mmap (NULL, ROVER_COUNT * sizeof(RESULT), PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (results == MAP_FAILED)
+    {
+        perror ("ERROR - mmap failed");
+        return 1;
+    }
+    memset (results, 0, ROVER_COUNT * sizeof(RESULT));
+
+    // Listen on a loopback port selected by the system
+    listenSocket = socket (AF_INET, SOCK_STREAM, 0);
+    option = 1;
+    setsockopt (listenSocket, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
+    memset (&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    address.sin_port = 0;
+    addressLength = sizeof(address);
+    if ((bind (listenSocket, (struct sockaddr *)&address, sizeof(address)) < 0)
+        || (listen (listenSocket, 64) < 0)
+        || (getsockname (listenSocket, (struct sockaddr *)&address, &addressLength) < 0))
+    {
+        perror ("ERROR - Failed to create the listen socket");
+        return 1;
+    }
+    fcntl (listenSocket, F_SETFL, fcntl (listenSocket, F_GETFL) | O_NONBLOCK);
+    port = ntohs (address.sin_port);
+
+    // Start the rovers
+    streamRovers = 0;
+    for (index = 0; index < (int)ROVER_COUNT; index++)
+    {
+        if ((rovers[index].type == ROVER_STREAM) || (rovers[index].type == ROVER_SLOW))
+            streamRovers += 1;
+        pid = fork ();
+        if (pid < 0)
+        {
+            perror ("ERROR - fork failed");
+            return 1;
+        }
+        if (pid == 0)
+        {
+            close (listenSocket);
+            roverProcess (index, port);
+        }
+    }
+
+    // Wait for the streaming rovers to connect
+    endTime = now () + 5.;
+    while ((ntripCasterStreamingClients (&caster) < streamRovers) && (now () < endTime))
+    {
+        casterAccept (&caster, listenSocket);
+        ntripCasterService (&caster, nowMsec ());
+        sleepMicroseconds (1000);
+    }
+    if (ntripCasterStreamingClients (&caster) < streamRovers)
+        fprintf (stderr, "ERROR - Only %d of %d rovers are streaming\n",
+                 ntripCasterStreamingClients (&caster), streamRovers);
+
+    // Produce the RTCM data
+    sequence = 0;
+    nextEpoch = now ();
+    endTime = nextEpoch + RUN_SECONDS;
+    while (now () < endTime)
+    {
+        casterAccept (&caster, listenSocket);
+        if (now () >= nextEpoch)
+        {
+            nextEpoch += EPOCH_MICROSECONDS / 1000000.;
+            epochLength = 0;
+            messageCount = sizeof(messageNumbers) / sizeof(messageNumbers[0]);
+            for (index = 0; index < messageCount; index++)
+                epochLength += rtcmMessage (&epoch[epochLength], messageNumbers[index], sequence++,
+                                            (messageNumbers[index] == 1005) ? 19 : 100 + (rand () % 400));
+            ntripCasterBroadcast (&caster, epoch, epochLength);
+        }
+        ntripCasterService (&caster, nowMsec ());
+        sleepMicroseconds (500);
+    }
+
+    // Drain the queues, then close the connections
+    endTime = now () + DRAIN_SECONDS;
+    do
+    {
+        ntripCasterService (&caster, nowMsec ());
+        idle = true;
+        for (index = 0; index < NTRIP_CASTER_MAX_CLIENTS; index++)
+            if ((clients[index].state == NTRIP_CASTER_CLIENT_STREAMING)
+                && ((clients[index].queueHead != clients[index].queueTail)
+                    || (clients[index].responseOffset < clients[index].responseLength)))
+                idle = false;
+        sleepMicroseconds (500);
+    } while ((!idle) && (now () < endTime));
+    dropped = 0;
+    for (index = 0; index < NTRIP_CASTER_MAX_CLIENTS; index++)
+        dropped += clients[index].messagesDropped;
+    ntripCasterCloseAll (&caster);
+    close (listenSocket);
+
+    // Wait for the rovers to finish
+    while (wait (&status) > 0)
+        ;
+
+    // Display the results
+    errors = 0;
+    printf ("%-14s  %8s  %10s  %4s  %6s  %5s  %5s  %s\n",
+            "Rover", "Messages", "Bytes", "Gaps", "Errors", "First", "Last", "Status");
+    for (index = 0; index < (int)ROVER_COUNT; index++)
+    {
+        rover = &rovers[index];
+        result = &results[index];
+        status = result->done && result->responseOk
+              && (!result->crcErrors) && (!result->framingErrors)
+              && (!result->chunkErrors) && (!result->orderErrors);
+        if (rover->type == ROVER_STREAM)
+            status = status && (!result->gaps) && (result->firstSequence == 0)
+                   && (result->lastSequence == (int64_t)sequence - 1)
+                   && (result->messages == sequence);
+        if (rover->type == ROVER_SLOW)
+            status = status && result->messages
+                   && (result->lastSequence == (int64_t)sequence - 1);
+        if (!status)
+            errors += 1;
+        printf ("%-14s  %8llu  %10llu  %4llu  %6llu  %5lld  %5lld  %s\n",
+                rover->name,
+                (unsigned long long)result->messages,
+                (unsigned long long)result->bytes,
+                (unsigned long long)result->gaps,
+                (unsigned long long)(result->crcErrors + result->framingErrors
+                                     + result->chunkErrors + result->orderErrors),
+                (long long)result->firstSequence,
+                (long long)result->lastSequence,
+                status ? "Pass" : "FAIL");
+    }
+    printf ("\n");
+    printf ("%u RTCM messages in %u buffers broadcast\n", sequence, caster.messagesBroadcast);
+    printf ("%u connections, %u rejected\n", caster.connections, caster.rejected);
+    printf ("%llu buffers dropped for slow rovers\n", (unsigned long long)dropped);
+    printf ("%u buffers still allocated, %u allocation failures\n",
+            caster.messagesAllocated, caster.allocationFailures);
+    if (caster.messagesAllocated || caster.allocationFailures)
+        errors += 1;
+    if (errors)
+    {
+        printf ("ERROR - %d failures\n", errors);
+        return 1;
+    }
+    printf ("All tests passed\n");
+    return 0;
+}
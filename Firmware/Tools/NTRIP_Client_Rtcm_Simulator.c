@@ -0,0 +1,409 @@
+// NTRIP_Client_Rtcm_Simulator.c
+//
+// Exercise the NTRIP client receive path: HTTP chunk removal, RTCM framing
+// with CRC validation and the per message type statistics.
+//
+//    * The epoch time is extracted from the GPS, GLONASS, Galileo and BeiDou
+//      observation messages and converted to GPS time, including the week
+//      and day rollovers
+//    * A simulated base station sends one epoch of messages each second,
+//      each epoch arrives with a random latency.  The stream is chunked,
+//      split at random points and some messages are corrupted.  Only the
+//      messages with a valid CRC are delivered and the latency statistics
+//      match the simulated latencies.
+//
+// The run is deterministic for a given seed: NTRIP_Client_Rtcm_Simulator [seed]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PARSE_NMEA_MESSAGES
+#define PARSE_RTCM_MESSAGES
+#define PARSE_UBLOX_MESSAGES
+
+#include "../RTK_Surveyor/GpsMessageParser.h"
+#include "../RTK_Surveyor/NtripHttp.h"
+#include "../RTK_Surveyor/RtcmStats.h"
+
+#define EPOCHS              600
+#define LEAP_SECONDS        18
+#define MAX_STREAM          (64 * 1024)
+#define MS_PER_HOUR         (60 * 60 * 1000)
+
+//----------------------------------------
+// Firmware stubs
+//----------------------------------------
+
+struct
+{
+    bool enablePrintBadMessages;
+} settings;
+
+bool inMainMenu;
+uint16_t failedParserMessages_NMEA;
+uint16_t failedParserMessages_RTCM;
+uint16_t failedParserMessages_UBX;
+
+int AsciiToNibble(int data)
+{
+    // Convert the value to lower case
+    data |= 0x20;
+    if ((data >= 'a') && (data <= 'f'))
+        return data - 'a' + 10;
+    if ((data >= '0') && (data <= '9'))
+        return data - '0';
+    return -1;
+}
+
+void printNmeaChecksumError(PARSE_STATE *parse) {}
+void printRtcmChecksumError(PARSE_STATE *parse) {}
+void printRtcmMaxLength(PARSE_STATE *parse) {}
+void printUbloxChecksumError(PARSE_STATE *parse) {}
+void printUbloxInvalidData(PARSE_STATE *parse) {}
+
+GPS_PARSE_TABLE
+
+#include "../RTK_Surveyor/GpsMessageParser.ino"
+#include "../RTK_Surveyor/Parse_NMEA.ino"
+#include "../RTK_Surveyor/Parse_RTCM.ino"
+#include "../RTK_Surveyor/Parse_UBLOX.ino"
+#include "../RTK_Surveyor/NtripHttp.ino"
+#include "../RTK_Surveyor/RtcmStats.ino"
+
+//----------------------------------------
+// Locals
+//----------------------------------------
+
+typedef struct _MESSAGE_TYPE
+{
+    uint16_t message;
+    uint8_t system;     // Time system of the epoch field
+} MESSAGE_TYPE;
+
+enum
+{
+    TIME_NONE = 0,
+    TIME_GPS,
+    TIME_GLONASS,       // Day of week and time of day
+    TIME_GLONASS_DAY,   // Time of day only
+    TIME_BEIDOU,
+};
+
+const MESSAGE_TYPE messageTypes[] =
+{
+    {1004, TIME_GPS},
+    {1005, TIME_NONE},
+    {1012, TIME_GLONASS_DAY},
+    {1074, TIME_GPS},
+    {1084, TIME_GLONASS},
+    {1094, TIME_GPS},
+    {1124, TIME_BEIDOU},
+    {1230, TIME_NONE},
+};
+
+#define MESSAGE_TYPES       (sizeof(messageTypes) / sizeof(messageTypes[0]))
+
+int errors;
+uint32_t currentMsec;           // millis() value when the message arrives
+uint32_t currentTow;            // GPS time when the message arrives
+int currentLatency;             // Simulated latency of the epoch
+uint32_t badLatencies;          // Messages with a latency not matching the simulation
+uint32_t delivered;             // Messages passed to the end of message callback
+RTCM_STATS stats;
+
+//----------------------------------------
+// Support routines
+//----------------------------------------
+
+// Display the test result
+void check (bool passed, const char * test)
+{
+    if (!passed)
+    {
+        printf ("FAIL: %s\n", test);
+        errors += 1;
+    }
+}
+
+// Set a bit field in the RTCM payload
+void setBits (uint8_t * payload, int start, int width, uint32_t value)
+{
+    int bit;
+
+    for (bit = start + width - 1; bit >= start; bit--)
+    {
+        if (value & 1)
+            payload[bit >> 3] |= 0x80 >> (bit & 7);
+        else
+            payload[bit >> 3] &= ~(0x80 >> (bit & 7));
+        value >>= 1;
+    }
+}
+
+// Build an RTCM message with the epoch time in the header, returns the length
+int buildMessage (uint8_t * buffer, const MESSAGE_TYPE * type, uint32_t gpsTow, int payloadLength)
+{
+    uint32_t crc;
+    uint32_t msec;
+    uint8_t * payload;
+    int index;
+
+    // Fill the payload
+    payload = &buffer[3];
+    for (index = 0; index < payloadLength; index++)
+        payload[index] = rand ();
+    setBits (payload, 0, 12, type->message);
+    setBits (payload, 12, 12, 1234);
+
+    // Set the epoch time
+    switch (type->system)
+    {
+    case TIME_GPS:
+        setBits (payload, 24, 30, gpsTow);
+        break;
+
+    case TIME_GLONASS:
+        msec = (gpsTow + RTCM_STATS_MS_PER_WEEK - (LEAP_SECONDS * 1000) + 3 * MS_PER_HOUR) % RTCM_STATS_MS_PER_WEEK;
+        setBits (payload, 24, 3, msec / RTCM_STATS_MS_PER_DAY);
+        setBits (payload, 27, 27, msec % RTCM_STATS_MS_PER_DAY);
+        break;
+
+    case TIME_GLONASS_DAY:
+        msec = (gpsTow + RTCM_STATS_MS_PER_WEEK - (LEAP_SECONDS * 1000) + 3 * MS_PER_HOUR) % RTCM_STATS_MS_PER_DAY;
+        setBits (payload, 24, 27, msec);
+        break;
+
+    case TIME_BEIDOU:
+        setBits (payload, 24, 30, (gpsTow + RTCM_STATS_MS_PER_WEEK - 14000) % RTCM_STATS_MS_PER_WEEK);
+        break;
+    }
+
+    // Add the framing
+    buffer[0] = 0xd3;
+    buffer[1] = payloadLength >> 8;
+    buffer[2] = payloadLength & 0xff;
+    crc = crc24qSpan (0, buffer, payloadLength + 3);
+    buffer[payloadLength + 3] = crc >> 16;
+    buffer[payloadLength + 4] = crc >> 8;
+    buffer[payloadLength + 5] = crc;
+    return payloadLength + 6;
+}
+
+// Account for the message, called by the parser
+void rtcmMessage (PARSE_STATE * parse, uint8_t type)
+{
+    if (type != SENTENCE_TYPE_RTCM)
+        return;
+    RTCM_STATS_MESSAGE * entry;
+    uint32_t epoch;
+
+    delivered += 1;
+    entry = rtcmStatsUpdate (&stats, parse->buffer, parse->length, currentMsec, currentTow, LEAP_SECONDS);
+    if (rtcmStatsEpoch (parse->buffer, parse->length, LEAP_SECONDS, &epoch)
+        && ((!entry) || (entry->latencyMsec != currentLatency)))
+        badLatencies += 1;
+}
+
+//----------------------------------------
+// Epoch conversion
+//----------------------------------------
+
+void testEpochs (void)
+{
+    static const uint32_t tows[] = {0, 1000, 86399999, 86400000, 345600123, 604799999};
+    uint32_t epoch;
+    uint8_t message[64];
+    char name[128];
+    uint32_t period;
+    int tow;
+    int type;
+
+    for (tow = 0; tow < (int)(sizeof(tows) / sizeof(tows[0])); tow++)
+        for (type = 0; type < (int)MESSAGE_TYPES; type++)
+        {
+            buildMessage (message, &messageTypes[type], tows[tow], 20);
+            epoch = 0;
+            period = rtcmStatsEpoch (message, 26, LEAP_SECONDS, &epoch);
+            snprintf (name, sizeof(name), "RTCM %d epoch at TOW %u", messageTypes[type].message, tows[tow]);
+            switch (messageTypes[type].system)
+            {
+            case TIME_NONE:
+                check (period == 0, name);
+                break;
+            case TIME_GLONASS_DAY:
+                check ((period == RTCM_STATS_MS_PER_DAY) && (epoch == (tows[tow] % RTCM_STATS_MS_PER_DAY)), name);
+                break;
+            default:
+                check ((period == RTCM_STATS_MS_PER_WEEK) && (epoch == tows[tow]), name);
+                break;
+            }
+        }
+
+    // Latency across the week and day boundaries
+    check (rtcmStatsLatency (150, RTCM_STATS_MS_PER_WEEK - 100, RTCM_STATS_MS_PER_WEEK) == 250, "Week rollover latency");
+    check (rtcmStatsLatency (RTCM_STATS_MS_PER_DAY + 150, RTCM_STATS_MS_PER_DAY - 100, RTCM_STATS_MS_PER_DAY) == 250,
+           "Day rollover latency");
+    check (rtcmStatsLatency (1000, 1020, RTCM_STATS_MS_PER_WEEK) == -20, "Negative latency");
+
+    // Short messages
+    check (rtcmStatsEpoch (message, 9, LEAP_SECONDS, &epoch) == 0, "Short message epoch");
+    check (rtcmStatsMessageNumber (message, 7) == 0, "Short message number");
+}
+
+//----------------------------------------
+// Correction stream
+//----------------------------------------
+
+void testStream (void)
+{
+    static uint8_t chunked[MAX_STREAM];
+    int chunkedLength;
+    NTRIP_HTTP_CHUNK chunk;
+    int corrupted;
+    uint32_t epochTow;
+    int epoch;
+    int index;
+    int latency;
+    int latencyMax;
+    int latencyMin;
+    int64_t latencyTotal;
+    uint8_t message[1100];
+    int messageLength;
+    int messages;
+    char name[128];
+    int offset;
+    PARSE_STATE parse;
+    static uint8_t parseBuffer[PARSE_BUFFER_LENGTH];
+    uint8_t piece[2048];
+    int pieceLength;
+    static uint8_t stream[MAX_STREAM];
+    int streamLength;
+    int type;
+    RTCM_STATS_MESSAGE * entry;
+
+    memset (&parse, 0, sizeof(parse));
+    parse.state = gpsMessageParserFirstByte;
+    parse.eomCallback = rtcmMessage;
+    parse.parserName = "Test";
+    parse.buffer = parseBuffer;
+    ntripHttpDechunkInit (&chunk);
+    rtcmStatsInit (&stats, 0);
+    corrupted = 0;
+    messages = 0;
+    latencyMin = 0x7fffffff;
+    latencyMax = -0x7fffffff;
+    latencyTotal = 0;
+
+    // Start shortly before the end of the week
+    epochTow = RTCM_STATS_MS_PER_WEEK - (EPOCHS / 2) * 1000;
+    for (epoch = 0; epoch < EPOCHS; epoch++)
+    {
+        // Build the epoch, corrupting some of the messages
+        streamLength = 0;
+        for (type = 0; type < (int)MESSAGE_TYPES; type++)
+        {
+            messageLength = buildMessage (message, &messageTypes[type], epochTow, 8 + (rand () % 1000));
+            if ((rand () % 50) == 0)
+            {
+                message[3 + (rand () % (messageLength - 6))] ^= 1 << (rand () & 7);
+                corrupted += 1;
+            }
+            memcpy (&stream[streamLength], message, messageLength);
+            streamLength += messageLength;
+            messages += 1;
+        }
+
+        // Chunk the epoch as an NTRIP 2 caster would
+        chunkedLength = 0;
+        for (offset = 0; offset < streamLength; offset += pieceLength)
+        {
+            pieceLength = 1 + (rand () % 1500);
+            if (pieceLength > (streamLength - offset))
+                pieceLength = streamLength - offset;
+            chunkedLength += ntripHttpChunk (&chunked[chunkedLength], sizeof(chunked) - chunkedLength,
+                                             &stream[offset], pieceLength);
+        }
+
+        // Deliver the epoch after the network latency
+        latency = 20 + (rand () % 480);
+        if (latency < latencyMin)
+            latencyMin = latency;
+        if (latency > latencyMax)
+            latencyMax = latency;
+        latencyTotal += latency;
+        currentLatency = latency;
+        currentMsec = epoch * 1000 + latency;
+        currentTow = (epochTow + latency) % RTCM_STATS_MS_PER_WEEK;
+        for (offset = 0; offset < chunkedLength; offset += pieceLength)
+        {
+            pieceLength = 1 + (rand () % sizeof(piece));
+            if (pieceLength > (chunkedLength - offset))
+                pieceLength = chunkedLength - offset;
+            memcpy (piece, &chunked[offset], pieceLength);
+            gpsMessageParserProcessBuffer (&parse, piece, ntripHttpDechunk (&chunk, piece, pieceLength));
+        }
+        epochTow = (epochTow + 1000) % RTCM_STATS_MS_PER_WEEK;
+    }
+
+    // Verify the message counts
+    check (chunk.state == NTRIP_HTTP_CHUNK_DATA_CR || chunk.state == NTRIP_HTTP_CHUNK_SIZE, "Chunk state");
+    check (parse.invalidRtcmCrcs == (uint32_t)corrupted, "Bad CRC count");
+    check (delivered == (uint32_t)(messages - corrupted), "Messages delivered");
+    check ((stats.messages == delivered) && (stats.types == MESSAGE_TYPES), "Message statistics");
+    check (badLatencies == 0, "Message latency");
+
+    // Verify the latency statistics
+    for (index = 0; index < stats.types; index++)
+    {
+        entry = &stats.type[index];
+        for (type = 0; type < (int)MESSAGE_TYPES; type++)
+            if (messageTypes[type].message == entry->message)
+                break;
+        snprintf (name, sizeof(name), "RTCM %d latency", entry->message);
+        if (messageTypes[type].system == TIME_NONE)
+            check (entry->latencyCount == 0, name);
+        else
+            check ((entry->latencyCount == entry->count) && (entry->latencyMinMsec >= latencyMin)
+                   && (entry->latencyMaxMsec <= latencyMax) && (entry->intervalMsec > 0)
+                   && (entry->intervalMsec < 4000),
+                   name);
+    }
+    printf ("%d messages, %d corrupted, latency %d to %d ms, average %d ms\n", messages, corrupted, latencyMin,
+            latencyMax, (int)(latencyTotal / EPOCHS));
+    for (index = 0; index < stats.types; index++)
+    {
+        entry = &stats.type[index];
+        printf ("    RTCM %d: %5u messages, %8u bytes", entry->message, entry->count, entry->bytes);
+        if (entry->latencyCount)
+            printf (", latency %d to %d ms, average %d ms", entry->latencyMinMsec, entry->latencyMaxMsec,
+                    (int)(entry->latencyTotalMsec / entry->latencyCount));
+        printf ("\n");
+    }
+}
+
+//----------------------------------------
+// Application
+//----------------------------------------
+
+int main (int argc, char ** argv)
+{
+    unsigned int seed;
+
+    seed = (argc > 1) ? strtoul (argv[1], NULL, 0) : 1;
+    srand (seed);
+    printf ("Seed: %u\n", seed);
+
+    testEpochs ();
+    testStream ();
+
+    if (errors)
+    {
+        printf ("ERROR - %d failures\n", errors);
+        return 1;
+    }
+    printf ("All tests passed\n");
+    return 0;
+}
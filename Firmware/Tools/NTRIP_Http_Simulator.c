@@ -0,0 +1,512 @@
+// NTRIP_Http_Simulator.c
+//
+// Exercise the NTRIP HTTP layer used by the NTRIP client, NTRIP server and
+// embedded NTRIP caster.
+//
+//    * NTRIP 1 and NTRIP 2 client and server requests contain the expected
+//      header lines and fail cleanly when the buffer is too small
+//    * Response headers are parsed one byte at a time, the data following
+//      the header is not consumed
+//    * Chunked data split at random points is decoded in place, including
+//      chunk extensions and trailers, and invalid framing is detected
+//    * NTRIP 1 and NTRIP 2 client requests are accepted by the embedded
+//      caster and the RTCM data it broadcasts is received unchanged
+//
+// The network is replaced by memory buffers so the run is deterministic for
+// a given seed: NTRIP_Http_Simulator [seed]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../RTK_Surveyor/NtripHttp.h"
+#include "../RTK_Surveyor/NtripHttp.ino"
+#include "../RTK_Surveyor/NtripCaster.h"
+#include "../RTK_Surveyor/NtripCaster.ino"
+
+#define CHUNK_ITERATIONS    200
+#define MAX_STREAM          (256 * 1024)
+#define MAX_MESSAGE         1100
+
+#define HOST                "caster.example.com"
+#define PORT                2101
+#define MOUNT_POINT         "bldr_SparkFun1"
+#define AGENT               "SparkFun_RTK_Simulator_v99.99"
+#define USER                "rover"
+#define PASSWORD            "secret"
+#define CREDENTIALS         "cm92ZXI6c2VjcmV0"  // base64 of rover:secret
+#define GGA                 "$GPGGA,172814.0,3723.46587704,N,12202.26957864,W,2,6,1.2,18.893,M,-25.669,M,2.0,0031*4F\r\n"
+
+int errors;
+
+//----------------------------------------
+// Support routines
+//----------------------------------------
+
+// Display the test result
+void check (bool passed, const char * test)
+{
+    if (!passed)
+    {
+        printf ("FAIL: %s\n", test);
+        errors += 1;
+    }
+}
+
+// Determine if the text contains the line
+bool hasLine (const char * text, const char * line)
+{
+    const char * found;
+
+    found = strstr (text, line);
+    return found && ((found == text) || (found[-2] == '\r'));
+}
+
+//----------------------------------------
+// Requests
+//----------------------------------------
+
+void testRequests (void)
+{
+    char buffer[NTRIP_HTTP_REQUEST_SIZE];
+    int length;
+    NTRIP_HTTP_REQUEST request;
+
+    memset (&request, 0, sizeof(request));
+    request.host = HOST;
+    request.port = PORT;
+    request.mountPoint = MOUNT_POINT;
+    request.agent = AGENT;
+    request.user = USER;
+    request.password = PASSWORD;
+    request.mountPointPassword = "WR5wRo4H";
+    request.gga = GGA;
+
+    // NTRIP 2 client
+    request.version = 2;
+    length = ntripHttpClientRequest (&request, buffer, sizeof(buffer));
+    check (length == (int)strlen (buffer), "Client 2 length");
+    check (strncmp (buffer, "GET /" MOUNT_POINT " HTTP/1.1\r\n", strlen ("GET /" MOUNT_POINT " HTTP/1.1\r\n")) == 0, "Client 2 request line");
+    check (hasLine (buffer, "Host: " HOST ":2101\r\n"), "Client 2 Host");
+    check (hasLine (buffer, "Ntrip-Version: Ntrip/2.0\r\n"), "Client 2 Ntrip-Version");
+    check (hasLine (buffer, "User-Agent: NTRIP " AGENT "\r\n"), "Client 2 User-Agent");
+    check (hasLine (buffer, "Authorization: Basic " CREDENTIALS "\r\n"), "Client 2 Authorization");
+    check (hasLine (buffer, "Ntrip-GGA: $GPGGA,172814.0,"), "Client 2 Ntrip-GGA");
+    check (strstr (buffer, "*4F\r\nConnection: keep-alive\r\n\r\n") != NULL, "Client 2 Ntrip-GGA end");
+    check ((length > 4) && (strcmp (&buffer[length - 4], "\r\n\r\n") == 0), "Client 2 end of header");
+
+    // NTRIP 2 client without a position or credentials
+    request.gga = NULL;
+    request.user = "";
+    length = ntripHttpClientRequest (&request, buffer, sizeof(buffer));
+    check (length && (!strstr (buffer, "Ntrip-GGA")) && (!strstr (buffer, "Authorization")),
+           "Client 2 optional headers");
+    request.gga = GGA;
+    request.user = USER;
+
+    // NTRIP 1 client
+    request.version = 1;
+    length = ntripHttpClientRequest (&request, buffer, sizeof(buffer));
+    check (strcmp (buffer, "GET /" MOUNT_POINT " HTTP/1.0\r\n"
+                           "User-Agent: NTRIP " AGENT "\r\n"
+                           "Authorization: Basic " CREDENTIALS "\r\n"
+                           "\r\n") == 0, "Client 1 request");
+    check (length == (int)strlen (buffer), "Client 1 length");
+
+    // NTRIP 2 server
+    request.version = 2;
+    length = ntripHttpServerRequest (&request, buffer, sizeof(buffer));
+    check (strncmp (buffer, "POST /" MOUNT_POINT " HTTP/1.1\r\n", strlen ("POST /" MOUNT_POINT " HTTP/1.1\r\n")) == 0, "Server 2 request line");
+    check (hasLine (buffer, "Ntrip-Version: Ntrip/2.0\r\n"), "Server 2 Ntrip-Version");
+    check (hasLine (buffer, "Authorization: Basic " CREDENTIALS "\r\n"), "Server 2 Authorization");
+    check (hasLine (buffer, "Transfer-Encoding: chunked\r\n"), "Server 2 Transfer-Encoding");
+    check (hasLine (buffer, "Content-Type: gnss/data\r\n"), "Server 2 Content-Type");
+    check ((length > 4) && (strcmp (&buffer[length - 4], "\r\n\r\n") == 0), "Server 2 end of header");
+
+    // NTRIP 1 server
+    request.version = 1;
+    length = ntripHttpServerRequest (&request, buffer, sizeof(buffer));
+    check (strcmp (buffer, "SOURCE WR5wRo4H /" MOUNT_POINT "\r\n"
+                           "Source-Agent: NTRIP " AGENT "\r\n"
+                           "\r\n") == 0, "Server 1 request");
+
+    // Buffer too small
+    request.version = 2;
+    check (ntripHttpClientRequest (&request, buffer, 100) == 0, "Client 2 overflow");
+    check (ntripHttpServerRequest (&request, buffer, 100) == 0, "Server 2 overflow");
+}
+
+//----------------------------------------
+// Responses
+//----------------------------------------
+
+typedef struct _RESPONSE_TEST
+{
+    const char * name;
+    const char * response;
+    int status;
+    int version;
+    bool chunked;
+    bool keepAlive;
+    bool sourceTable;
+    int contentLength;
+} RESPONSE_TEST;
+
+const RESPONSE_TEST responseTests[] =
+{
+    {"ICY", "ICY 200 OK\r\n", 200, 1, false, true, false, -1},
+    {"HTTP/1.1 chunked",
+     "HTTP/1.1 200 OK\r\n"
+     "Ntrip-Version: Ntrip/2.0\r\n"
+     "Server: NTRIP Caster\r\n"
+     "Content-Type: gnss/data\r\n"
+     "Transfer-Encoding: chunked\r\n"
+     "\r\n", 200, 2, true, true, false, -1},
+    {"HTTP/1.1 close",
+     "HTTP/1.1 200 OK\r\n"
+     "ntrip-version: Ntrip/2.0\r\n"
+     "connection: close\r\n"
+     "\r\n", 200, 2, false, false, false, -1},
+    {"HTTP/1.0 401", "HTTP/1.0 401 Unauthorized\r\n\r\n", 401, 1, false, false, false, -1},
+    {"HTTP/1.1 404 LF only", "HTTP/1.1 404 Not Found\nNtrip-Version: Ntrip/2.0\n\n", 404, 2, false, true, false, -1},
+    {"SOURCETABLE",
+     "SOURCETABLE 200 OK\r\n"
+     "Content-Type: text/plain\r\n"
+     "Content-Length: 87\r\n"
+     "\r\n", 200, 1, false, false, true, 87},
+    {"gnss/sourcetable",
+     "HTTP/1.1 200 OK\r\n"
+     "Ntrip-Version: Ntrip/2.0\r\n"
+     "Content-Type: gnss/sourcetable\r\n"
+     "Content-Length: 1234\r\n"
+     "Connection: close\r\n"
+     "\r\n", 200, 2, false, false, true, 1234},
+};
+
+#define RESPONSE_TESTS      (sizeof(responseTests) / sizeof(responseTests[0]))
+
+void testResponses (void)
+{
+    static const char data[] = "\xd3\x00\x13RTCM data";
+    bool done;
+    int index;
+    size_t offset;
+    char name[128];
+    NTRIP_HTTP_RESPONSE response;
+    char stream[2048];
+    const RESPONSE_TEST * test;
+
+    for (index = 0; index < (int)RESPONSE_TESTS; index++)
+    {
+        test = &responseTests[index];
+
+        // Parse the header one byte at a time and stop at the end of the header
+        snprintf (stream, sizeof(stream), "%s%s", test->response, data);
+        ntripHttpResponseInit (&response);
+        done = false;
+        for (offset = 0; offset < strlen (stream); offset++)
+            if ((done = ntripHttpResponseParse (&response, stream[offset])))
+                break;
+        offset += 1;
+        snprintf (name, sizeof(name), "%s header end", test->name);
+        check (done && (offset == strlen (test->response)), name);
+        snprintf (name, sizeof(name), "%s status", test->name);
+        check (response.status == test->status, name);
+        snprintf (name, sizeof(name), "%s version", test->name);
+        check (response.version == test->version, name);
+        snprintf (name, sizeof(name), "%s chunked", test->name);
+        check (response.chunked == test->chunked, name);
+        snprintf (name, sizeof(name), "%s keep-alive", test->name);
+        check (response.keepAlive == test->keepAlive, name);
+        snprintf (name, sizeof(name), "%s sourcetable", test->name);
+        check (response.sourceTable == test->sourceTable, name);
+        snprintf (name, sizeof(name), "%s Content-Length", test->name);
+        check (response.contentLength == test->contentLength, name);
+        snprintf (name, sizeof(name), "%s text", test->name);
+        check (strncmp (response.text, test->response, strcspn (test->response, "\r\n")) == 0, name);
+    }
+
+    // A header larger than the text buffer still ends at the empty line
+    offset = snprintf (stream, sizeof(stream), "HTTP/1.1 200 OK\r\n");
+    for (index = 0; index < 20; index++)
+        offset += snprintf (&stream[offset], sizeof(stream) - offset, "X-Padding-%02d: %040d\r\n", index, index);
+    snprintf (&stream[offset], sizeof(stream) - offset, "\r\n%s", data);
+    ntripHttpResponseInit (&response);
+    done = false;
+    for (offset = 0; offset < strlen (stream); offset++)
+        if ((done = ntripHttpResponseParse (&response, stream[offset])))
+            break;
+    check (done && (strcmp (&stream[offset + 1], data) == 0), "Long header end");
+    check ((response.status == 200) && (response.length < sizeof(response.text)), "Long header status");
+}
+
+//----------------------------------------
+// Chunked transfer encoding
+//----------------------------------------
+
+// Decode the stream in random pieces, returns the number of data bytes
+int32_t dechunkStream (NTRIP_HTTP_CHUNK * chunk, uint8_t * stream, int32_t length, uint8_t * output)
+{
+    int32_t bytes;
+    int32_t offset;
+    int32_t outputLength;
+    uint8_t piece[2048];
+    int32_t pieceLength;
+
+    ntripHttpDechunkInit (chunk);
+    outputLength = 0;
+    for (offset = 0; offset < length; offset += pieceLength)
+    {
+        pieceLength = 1 + (rand () % ((rand () & 1) ? 8 : sizeof(piece)));
+        if (pieceLength > (length - offset))
+            pieceLength = length - offset;
+        memcpy (piece, &stream[offset], pieceLength);
+        bytes = ntripHttpDechunk (chunk, piece, pieceLength);
+        memcpy (&output[outputLength], piece, bytes);
+        outputLength += bytes;
+    }
+    return outputLength;
+}
+
+void testChunks (void)
+{
+    static uint8_t data[MAX_STREAM];
+    int32_t dataLength;
+    int iteration;
+    int length;
+    uint8_t message[MAX_MESSAGE];
+    int messageLength;
+    int messages;
+    NTRIP_HTTP_CHUNK chunk;
+    int index;
+    static uint8_t output[MAX_STREAM];
+    int32_t outputLength;
+    static uint8_t stream[MAX_STREAM];
+    int32_t streamLength;
+
+    // Random messages with random chunk boundaries
+    for (iteration = 0; iteration < CHUNK_ITERATIONS; iteration++)
+    {
+        dataLength = 0;
+        streamLength = 0;
+        messages = 1 + (rand () % 100);
+        for (index = 0; index < messages; index++)
+        {
+            messageLength = 1 + (rand () % MAX_MESSAGE);
+            for (length = 0; length < messageLength; length++)
+                message[length] = rand ();
+            memcpy (&data[dataLength], message, messageLength);
+            dataLength += messageLength;
+
+            // Use lower case hex and a chunk extension for some chunks
+            if (rand () % 8)
+                length = ntripHttpChunk (&stream[streamLength], MAX_STREAM - streamLength, message, messageLength);
+            else
+            {
+                length = sprintf ((char *)&stream[streamLength], "%x;name=value\r\n", messageLength);
+                memcpy (&stream[streamLength + length], message, messageLength);
+                length += messageLength;
+                stream[streamLength + length++] = '\r';
+                stream[streamLength + length++] = '\n';
+            }
+            streamLength += length;
+        }
+        if (iteration & 1)
+            streamLength += sprintf ((char *)&stream[streamLength], NTRIP_HTTP_LAST_CHUNK);
+        else
+            streamLength += sprintf ((char *)&stream[streamLength], "0\r\nX-Trailer: 1\r\n\r\n");
+
+        // Data following the stream is ignored
+        streamLength += sprintf ((char *)&stream[streamLength], "HTTP/1.1 200 OK\r\n");
+        outputLength = dechunkStream (&chunk, stream, streamLength, output);
+        if ((outputLength != dataLength) || memcmp (output, data, dataLength)
+            || (chunk.state != NTRIP_HTTP_CHUNK_END) || (chunk.chunks != (uint32_t)messages))
+        {
+            check (false, "Chunk round trip");
+            break;
+        }
+    }
+
+    // The chunk buffer is too small
+    check (ntripHttpChunk (stream, 9, message, 5) == 0, "Chunk overflow");
+    check (ntripHttpChunk (stream, 9, message, 4) == 9, "Chunk fits");
+
+    // Invalid framing
+    ntripHttpDechunkInit (&chunk);
+    strcpy ((char *)stream, "zz\r\n");
+    ntripHttpDechunk (&chunk, stream, strlen ((char *)stream));
+    check (chunk.state == NTRIP_HTTP_CHUNK_ERROR, "Invalid chunk length");
+
+    ntripHttpDechunkInit (&chunk);
+    strcpy ((char *)stream, "5\r\nabcdeX\r\n");
+    outputLength = ntripHttpDechunk (&chunk, stream, strlen ((char *)stream));
+    check ((chunk.state == NTRIP_HTTP_CHUNK_ERROR) && (outputLength == 5)
+           && (memcmp (stream, "abcde", 5) == 0), "Missing chunk CR LF");
+
+    ntripHttpDechunkInit (&chunk);
+    strcpy ((char *)stream, "\r\n");
+    ntripHttpDechunk (&chunk, stream, strlen ((char *)stream));
+    check (chunk.state == NTRIP_HTTP_CHUNK_ERROR, "Missing chunk length");
+
+    ntripHttpDechunkInit (&chunk);
+    strcpy ((char *)stream, "123456789\r\n");
+    ntripHttpDechunk (&chunk, stream, strlen ((char *)stream));
+    check (chunk.state == NTRIP_HTTP_CHUNK_ERROR, "Chunk too long");
+}
+
+//----------------------------------------
+// Embedded caster
+//----------------------------------------
+
+// Memory connection between the client and the caster
+typedef struct _CONNECTION
+{
+    uint8_t request[NTRIP_HTTP_REQUEST_SIZE];
+    int32_t requestLength;
+    int32_t requestOffset;
+    uint8_t response[MAX_STREAM];
+    int32_t responseLength;
+    bool closed;
+} CONNECTION;
+
+int32_t connectionRead (P_NTRIP_CASTER_CLIENT client, uint8_t * buffer, int32_t length)
+{
+    CONNECTION * connection = (CONNECTION *)client->context;
+
+    if (length > (connection->requestLength - connection->requestOffset))
+        length = connection->requestLength - connection->requestOffset;
+    memcpy (buffer, &connection->request[connection->requestOffset], length);
+    connection->requestOffset += length;
+    return length;
+}
+
+int32_t connectionWrite (P_NTRIP_CASTER_CLIENT client, const uint8_t * data, int32_t length)
+{
+    CONNECTION * connection = (CONNECTION *)client->context;
+
+    if (length > (int32_t)(sizeof(connection->response) - connection->responseLength))
+        length = sizeof(connection->response) - connection->responseLength;
+    memcpy (&connection->response[connection->responseLength], data, length);
+    connection->responseLength += length;
+    return length;
+}
+
+void connectionClose (P_NTRIP_CASTER_CLIENT client)
+{
+    CONNECTION * connection = (CONNECTION *)client->context;
+
+    connection->closed = true;
+}
+
+void testCaster (int version, const char * mountPoint, const char * user, int expectedStatus)
+{
+    NTRIP_CASTER caster;
+    NTRIP_HTTP_CHUNK chunk;
+    NTRIP_CASTER_CLIENT clients[1];
+    static CONNECTION connection;
+    static uint8_t data[MAX_STREAM];
+    int32_t dataLength;
+    int index;
+    uint8_t message[MAX_MESSAGE];
+    int messageLength;
+    char name[128];
+    int32_t offset;
+    static uint8_t output[MAX_STREAM];
+    int32_t outputLength;
+    NTRIP_HTTP_REQUEST request;
+    NTRIP_HTTP_RESPONSE response;
+    uint32_t msec;
+
+    snprintf (name, sizeof(name), "Caster NTRIP %d %s %s", version, mountPoint, user);
+    memset (&connection, 0, sizeof(connection));
+    if (!ntripCasterInit (&caster, clients, 1, MOUNT_POINT, USER, PASSWORD, "SparkFun", 40.09, -105.18,
+                          connectionRead, connectionWrite, connectionClose))
+    {
+        check (false, "ntripCasterInit");
+        return;
+    }
+
+    // Send the client request
+    memset (&request, 0, sizeof(request));
+    request.version = version;
+    request.host = "127.0.0.1";
+    request.port = PORT;
+    request.mountPoint = mountPoint;
+    request.agent = AGENT;
+    request.user = user;
+    request.password = PASSWORD;
+    request.gga = GGA;
+    connection.requestLength = ntripHttpClientRequest (&request, (char *)connection.request,
+                                                       sizeof(connection.request));
+    msec = 0;
+    ntripCasterConnect (&caster, ntripCasterFreeClient (&caster), &connection, msec);
+    ntripCasterService (&caster, msec);
+
+    // Broadcast the data
+    dataLength = 0;
+    for (index = 0; index < 10; index++)
+    {
+        messageLength = 1 + (rand () % MAX_MESSAGE);
+        for (offset = 0; offset < messageLength; offset++)
+            message[offset] = rand ();
+        memcpy (&data[dataLength], message, messageLength);
+        dataLength += messageLength;
+        ntripCasterBroadcast (&caster, message, messageLength);
+        ntripCasterService (&caster, msec += 100);
+    }
+
+    // Parse the response header
+    ntripHttpResponseInit (&response);
+    for (offset = 0; offset < connection.responseLength; )
+        if (ntripHttpResponseParse (&response, connection.response[offset++]))
+            break;
+    check (response.complete && (response.status == expectedStatus), name);
+    if (response.status == 200)
+    {
+        // Remove the chunk framing
+        outputLength = connection.responseLength - offset;
+        memcpy (output, &connection.response[offset], outputLength);
+        if (response.chunked)
+        {
+            ntripHttpDechunkInit (&chunk);
+            outputLength = ntripHttpDechunk (&chunk, output, outputLength);
+        }
+        else
+            outputLength = ntripHttpSkipLineEnds (&response, output, outputLength);
+        check ((response.version == version) && (response.chunked == (version == 2))
+               && (outputLength == dataLength) && (memcmp (output, data, dataLength) == 0), name);
+    }
+    ntripCasterCloseAll (&caster);
+    check (caster.messagesAllocated == 0, "Caster buffers released");
+}
+
+//----------------------------------------
+// Application
+//----------------------------------------
+
+int main (int argc, char ** argv)
+{
+    unsigned int seed;
+
+    seed = (argc > 1) ? strtoul (argv[1], NULL, 0) : 1;
+    srand (seed);
+    printf ("Seed: %u\n", seed);
+
+    testRequests ();
+    testResponses ();
+    testChunks ();
+    testCaster (1, MOUNT_POINT, USER, 200);
+    testCaster (2, MOUNT_POINT, USER, 200);
+    testCaster (2, MOUNT_POINT, "", 401);
+    testCaster (2, "unknown", USER, 404);
+
+    if (errors)
+    {
+        printf ("ERROR - %d failures\n", errors);
+        return 1;
+    }
+    printf ("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,254 @@
+// Parser_Benchmark.c
+//
+// Measure the GNSS message parser throughput on a recorded log file.
+//
+// Two passes are made over the file:
+//
+//    Byte:   Each byte is passed to parse.state as done by gnssReadTask
+//            prior to gpsMessageParserProcessBuffer
+//
+//    Buffer: The data is passed to gpsMessageParserProcessBuffer in the same
+//            500 byte chunks read from UART1 by gnssReadTask
+//
+// The message counts from both passes must match.
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PARSE_NMEA_MESSAGES
+#define PARSE_RTCM_MESSAGES
+#define PARSE_UBLOX_MESSAGES
+
+#include "../RTK_Surveyor/GpsMessageParser.h"
+
+#define CHUNK_SIZE          500     // Matches the gnssReadTask UART read size
+#define MIN_RUN_SECONDS     1.0
+
+//----------------------------------------
+// Firmware stubs
+//----------------------------------------
+
+struct
+{
+    bool enablePrintBadMessages;
+} settings;
+
+bool inMainMenu;
+uint16_t failedParserMessages_NMEA;
+uint16_t failedParserMessages_RTCM;
+uint16_t failedParserMessages_UBX;
+
+int AsciiToNibble(int data)
+{
+    // Convert the value to lower case
+    data |= 0x20;
+    if ((data >= 'a') && (data <= 'f'))
+        return data - 'a' + 10;
+    if ((data >= '0') && (data <= '9'))
+        return data - '0';
+    return -1;
+}
+
+void printNmeaChecksumError(PARSE_STATE *parse) {}
+void printRtcmChecksumError(PARSE_STATE *parse) {}
+void printRtcmMaxLength(PARSE_STATE *parse) {}
+void printUbloxChecksumError(PARSE_STATE *parse) {}
+void printUbloxInvalidData(PARSE_STATE *parse) {}
+
+GPS_PARSE_TABLE
+
+#include "../RTK_Surveyor/GpsMessageParser.ino"
+#include "../RTK_Surveyor/Parse_NMEA.ino"
+#include "../RTK_Surveyor/Parse_RTCM.ino"
+#include "../RTK_Surveyor/Parse_UBLOX.ino"
+
+//----------------------------------------
+// Benchmark
+//----------------------------------------
+
+typedef struct _MESSAGE_COUNTS
+{
+    uint64_t messages[SENTENCE_TYPE_UBX + 1];
+    uint64_t bytes;
+} MESSAGE_COUNTS;
+
+MESSAGE_COUNTS counts;
+
+// Account for the message
+void countMessage(PARSE_STATE * parse, uint8_t type)
+{
+    counts.messages[type] += 1;
+    counts.bytes += parse->length;
+}
+
+double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1000000000.);
+}
+
+// Pass each byte to the parse state routine
+void parseBytes (PARSE_STATE * parse, const uint8_t * data, off_t length)
+{
+    const uint8_t * data_end;
+
+    data_end = &data[length];
+    while (data < data_end) {
+        // Save the data byte
+        parse->buffer[parse->length++] = *data;
+        parse->length %= PARSE_BUFFER_LENGTH;
+
+        // Compute the CRC value for the message
+        if (parse->computeCrc)
+            parse->crc = COMPUTE_CRC24Q(parse, *data);
+
+        // Update the parser state based on the incoming byte
+        parse->state(parse, *data++);
+    }
+}
+
+// Pass the data to the parser in UART sized chunks
+void parseChunks (PARSE_STATE * parse, const uint8_t * data, off_t length)
+{
+    off_t offset;
+    int bytes;
+
+    for (offset = 0; offset < length; offset += bytes) {
+        bytes = CHUNK_SIZE;
+        if (bytes > (length - offset))
+            bytes = length - offset;
+        gpsMessageParserProcessBuffer (parse, &data[offset], bytes);
+    }
+}
+
+// Run the parser repeatedly over the data and return bytes per second
+double benchmark (const char * name,
+                  void (* parseRoutine)(PARSE_STATE * parse, const uint8_t * data, off_t length),
+                  const uint8_t * data,
+                  off_t length,
+                  MESSAGE_COUNTS * result)
+{
+    double elapsed;
+    int passes;
+    static PARSE_STATE parse;
+    static uint8_t parse_buffer[PARSE_BUFFER_LENGTH];
+    double rate;
+    double start;
+
+    passes = 0;
+    start = now ();
+    do {
+        memset (&parse, 0, sizeof(parse));
+        parse.state = gpsMessageParserFirstByte;
+        parse.eomCallback = countMessage;
+        parse.buffer = parse_buffer;
+        parse.parserName = name;
+        memset (&counts, 0, sizeof(counts));
+        parseRoutine (&parse, data, length);
+        passes += 1;
+        elapsed = now () - start;
+    } while (elapsed < MIN_RUN_SECONDS);
+
+    rate = (double)length * passes / elapsed;
+    *result = counts;
+    printf ("%-8s %8.2f MB/s, %d passes, %llu NMEA, %llu RTCM, %llu UBX, %llu bytes\n",
+            name, rate / (1024. * 1024.), passes,
+            (unsigned long long)counts.messages[SENTENCE_TYPE_NMEA],
+            (unsigned long long)counts.messages[SENTENCE_TYPE_RTCM],
+            (unsigned long long)counts.messages[SENTENCE_TYPE_UBX],
+            (unsigned long long)counts.bytes);
+    return rate;
+}
+
+uint8_t *
+get_file (
+    const char * filename,
+    off_t * length
+    )
+{
+    int file;
+    uint8_t * file_data;
+    off_t file_size;
+
+    file_data = NULL;
+    do {
+        file = open (filename, O_RDONLY);
+        if (file < 0) {
+            perror ("ERROR - Failed to open the file");
+            break;
+        }
+
+        // Determine the file length
+        file_size = lseek (file, 0, SEEK_END);
+
+        // Get the file buffer
+        file_data = malloc (file_size);
+        if (!file_data) {
+            fprintf (stderr, "ERROR - Failed to allocate file buffer!\n");
+            break;
+        }
+
+        // Read the file into memory
+        lseek (file, 0, SEEK_SET);
+        if (read (file, file_data, file_size) != file_size) {
+            fprintf (stderr, "ERROR - Failed to read the file into memory!\n");
+            free (file_data);
+            file_data = NULL;
+            break;
+        }
+
+        // Return the file length
+        *length = file_size;
+    } while (0);
+
+    // Close the file
+    if (file >= 0)
+        close (file);
+    return file_data;
+}
+
+int
+main (
+    int argc,
+    char ** argv
+    )
+{
+    MESSAGE_COUNTS buffer_counts;
+    double buffer_rate;
+    MESSAGE_COUNTS byte_counts;
+    double byte_rate;
+    uint8_t * data;
+    off_t length;
+
+    // Display the help text
+    if (argc != 2) {
+        fprintf (stderr, "%s   log_file\n", argv[0]);
+        return -1;
+    }
+
+    // Read the log file
+    data = get_file (argv[1], &length);
+    if (!data)
+        return -2;
+    printf ("%s: %lld bytes\n", argv[1], (long long)length);
+
+    // Measure the parser throughput
+    byte_rate = benchmark ("Byte", parseBytes, data, length, &byte_counts);
+    buffer_rate = benchmark ("Buffer", parseChunks, data, length, &buffer_counts);
+    printf ("Speedup: %.2fx\n", buffer_rate / byte_rate);
+
+    // Verify that both parsers found the same messages
+    if (memcmp (&byte_counts, &buffer_counts, sizeof(byte_counts))) {
+        fprintf (stderr, "ERROR - Message counts do not match!\n");
+        return -3;
+    }
+    return 0;
+}
@@ -0,0 +1,432 @@
+// Ring_Buffer_Simulator.c
+//
+// Exercise the firmware ring buffer with a producer thread and several
+// consumer threads running at different speeds.
+//
+// The producer writes numbered messages protected by a CRC-24Q into the ring
+// buffer, discarding the oldest messages when the ring buffer is full.  Each
+// consumer parses the data it receives and verifies:
+//
+//    * The messages are received in order without duplicates
+//    * A consumer that keeps up with the producer does not lose messages
+//    * A corrupted message (partial message from a trimmed tail) is always
+//      followed by a gap in the message numbers
+//
+// A quarter of the messages are marked as filtered by the Filtered consumer,
+// the filter flag is the high bit of the length.  The Filtered consumer
+// verifies that none of the marked messages are received.
+//
+// Each message is assigned a random priority class, the producer drops the
+// lower priority messages as the ring buffer fills.  The message numbers are
+// only assigned to the committed messages.
+//
+// Every EPOCH_MESSAGES message is marked as the start of an epoch.  The
+// Behind consumer has a high water mark and skips ahead to the newest epoch
+// when it falls behind.  It verifies that each gap ends at an epoch start,
+// that no partial message is received and that the Fast consumer is not
+// affected.
+//
+// Each consumer runs in its own thread as done by the per-consumer
+// handleGnssDataTask in the firmware.  The maximum and 99th percentile send
+// times are displayed for each consumer to show that a slow consumer does not
+// delay the other consumers.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../RTK_Surveyor/crc24q.h"
+#include "../RTK_Surveyor/RingBuffer.h"
+#include "../RTK_Surveyor/RingBuffer.ino"
+
+#define RING_BUFFER_SIZE    32768
+#define SPILL_SIZE          3000        // Matches PARSE_BUFFER_LENGTH
+#define OFFSET_ENTRIES      ((RING_BUFFER_SIZE >> 1) / 32)
+#define RUN_SECONDS         3.0
+#define PRODUCER_RATE       (1024. * 1024.) // Bytes per second
+
+#define HEADER_LENGTH       8           // Preamble (2), length (2), sequence (4)
+#define FILTER_FLAG         0x80        // High bit of the length
+#define CRC_LENGTH          3
+#define MIN_MESSAGE         (HEADER_LENGTH + CRC_LENGTH + 8)
+#define MAX_MESSAGE         600
+#define EPOCH_MESSAGES      8
+
+//----------------------------------------
+// Consumers
+//----------------------------------------
+
+typedef struct _CONSUMER
+{
+    RING_BUFFER_CONSUMER ringConsumer;
+    int maxBytes;                   // Maximum bytes accepted per send call
+    int delayMicroseconds;          // Delay after each send call
+    int stallMilliseconds;          // Periodic stall time
+    int disconnectMilliseconds;     // Periodic disconnect time
+    bool mustKeepUp;                // True if no messages may be lost
+    int highWater;                  // Bytes waiting before skipping to the newest epoch
+
+    // Verification
+    uint8_t stream[2 * MAX_MESSAGE];
+    int streamLength;
+    uint64_t bytes;
+    uint64_t messages;
+    uint64_t missing;
+    uint64_t corrupt;
+    uint64_t errors;
+    int64_t lastSequence;
+    bool corruptPending;
+} CONSUMER;
+
+CONSUMER consumers[] =
+{
+    {.ringConsumer = {.name = "Fast"}, .maxBytes = MAX_MESSAGE * 4, .mustKeepUp = true},
+    {.ringConsumer = {.name = "Partial"}, .maxBytes = 100, .delayMicroseconds = 20},
+    {.ringConsumer = {.name = "Slow"}, .maxBytes = 512, .delayMicroseconds = 2500},
+    {.ringConsumer = {.name = "Stalling"}, .maxBytes = MAX_MESSAGE * 4, .stallMilliseconds = 50},
+    {.ringConsumer = {.name = "Disconnects"}, .maxBytes = MAX_MESSAGE * 4, .disconnectMilliseconds = 100},
+    {.ringConsumer = {.name = "Filtered", .filter = 1}, .maxBytes = MAX_MESSAGE * 4},
+    {.ringConsumer = {.name = "Behind"}, .maxBytes = 512, .delayMicroseconds = 2500,
+     .highWater = RING_BUFFER_SIZE / 8},
+};
+#define CONSUMER_COUNT      (sizeof(consumers) / sizeof(consumers[0]))
+
+RING_BUFFER ring;
+volatile bool running;
+uint64_t discards;
+uint64_t discardedBytes;
+uint64_t producedMessages;
+
+double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1000000000.);
+}
+
+void sleepMicroseconds (int microseconds)
+{
+    struct timespec ts;
+
+    ts.tv_sec = microseconds / 1000000;
+    ts.tv_nsec = (microseconds % 1000000) * 1000;
+    nanosleep (&ts, NULL);
+}
+
+// Parse the messages received by the consumer
+void verify (CONSUMER * consumer)
+{
+    uint32_t crc;
+    int length;
+    int offset;
+    int64_t sequence;
+    uint8_t * stream;
+
+    stream = consumer->stream;
+    offset = 0;
+    while ((consumer->streamLength - offset) >= MIN_MESSAGE) {
+        // Locate the preamble
+        if ((stream[offset] != 0xa5) || (stream[offset + 1] != 0x5a)) {
+            offset += 1;
+            continue;
+        }
+
+        // Validate the length
+        length = stream[offset + 2] | ((stream[offset + 3] & ~FILTER_FLAG) << 8);
+        if ((length < MIN_MESSAGE) || (length > MAX_MESSAGE)) {
+            offset += 1;
+            continue;
+        }
+        if ((consumer->streamLength - offset) < length)
+            break;
+
+        // Validate the CRC
+        crc = crc24qSpan (0, &stream[offset], length - CRC_LENGTH);
+        if (crc != (uint32_t)((stream[offset + length - 3] << 16)
+                              | (stream[offset + length - 2] << 8)
+                              | stream[offset + length - 1])) {
+            consumer->corrupt += 1;
+            consumer->corruptPending = true;
+            offset += 1;
+            continue;
+        }
+
+        // Verify the message filter
+        if (consumer->ringConsumer.filter && (stream[offset + 3] & FILTER_FLAG)) {
+            fprintf (stderr, "ERROR - %s: received filtered message\n", consumer->ringConsumer.name);
+            consumer->errors += 1;
+        }
+
+        // Verify the message order
+        sequence = stream[offset + 4] | (stream[offset + 5] << 8)
+                 | (stream[offset + 6] << 16) | ((int64_t)stream[offset + 7] << 24);
+        if (sequence <= consumer->lastSequence) {
+            fprintf (stderr, "ERROR - %s: message %lld after %lld\n",
+                     consumer->ringConsumer.name, (long long)sequence,
+                     (long long)consumer->lastSequence);
+            consumer->errors += 1;
+        } else if (sequence == (consumer->lastSequence + 1)) {
+            // A partial message is only sent when the tail was trimmed
+            if (consumer->corruptPending && (consumer->lastSequence >= 0)) {
+                fprintf (stderr, "ERROR - %s: corrupt message before %lld without a discard\n",
+                         consumer->ringConsumer.name, (long long)sequence);
+                consumer->errors += 1;
+            }
+        } else if (consumer->lastSequence >= 0) {
+            consumer->missing += sequence - consumer->lastSequence - 1;
+
+            // Skipping ahead resumes at the start of an epoch
+            if (consumer->highWater && (sequence % EPOCH_MESSAGES)) {
+                fprintf (stderr, "ERROR - %s: skipped to %lld, not an epoch start\n",
+                         consumer->ringConsumer.name, (long long)sequence);
+                consumer->errors += 1;
+            }
+        }
+        consumer->corruptPending = false;
+        consumer->lastSequence = sequence;
+        consumer->messages += 1;
+        offset += length;
+    }
+
+    // Save the remaining data
+    consumer->streamLength -= offset;
+    memmove (stream, &stream[offset], consumer->streamLength);
+}
+
+bool consumerConnected (P_RING_BUFFER_CONSUMER ringConsumer)
+{
+    CONSUMER * consumer;
+    long milliseconds;
+
+    consumer = &consumers[ringConsumer->index];
+    if (!consumer->disconnectMilliseconds)
+        return true;
+
+    // Alternate between connected and disconnected
+    milliseconds = (long)(now () * 1000.);
+    return ((milliseconds / consumer->disconnectMilliseconds) & 1) == 0;
+}
+
+int32_t consumerSend (P_RING_BUFFER_CONSUMER ringConsumer, const uint8_t * data, int32_t length)
+{
+    CONSUMER * consumer;
+    int32_t bytes;
+    int32_t offset;
+
+    consumer = &consumers[ringConsumer->index];
+    if (length > consumer->maxBytes)
+        length = consumer->maxBytes;
+    consumer->bytes += length;
+
+    // Pass the data to the verifier
+    for (offset = 0; offset < length; offset += bytes) {
+        bytes = sizeof (consumer->stream) - consumer->streamLength;
+        if (bytes > (length - offset))
+            bytes = length - offset;
+        memcpy (&consumer->stream[consumer->streamLength], &data[offset], bytes);
+        consumer->streamLength += bytes;
+        verify (consumer);
+    }
+    return length;
+}
+
+void * consumerThread (void * arg)
+{
+    int32_t bytesSent;
+    CONSUMER * consumer;
+    double nextStall;
+    double start;
+
+    consumer = arg;
+    nextStall = now () + 0.1;
+    while (running) {
+        start = now ();
+        bytesSent = ringBufferService (&ring, &consumer->ringConsumer);
+        if (bytesSent)
+            ringBufferSendTime (&consumer->ringConsumer, (uint32_t)((now () - start) * 1000.));
+        else
+            sched_yield ();
+        if (consumer->delayMicroseconds)
+            sleepMicroseconds (consumer->delayMicroseconds);
+
+        // Periodically stop reading data
+        if (consumer->stallMilliseconds && (now () >= nextStall)) {
+            sleepMicroseconds (consumer->stallMilliseconds * 1000);
+            nextStall = now () + 0.1;
+        }
+    }
+    return NULL;
+}
+
+//----------------------------------------
+// Producer
+//----------------------------------------
+
+void * producerThread (void * arg)
+{
+    uint32_t crc;
+    uint8_t * data;
+    int32_t discarded;
+    uint32_t head;
+    int index;
+    uint8_t filter;
+    int length;
+    uint8_t priority;
+    double rateStart;
+    uint64_t rateBytes;
+    uint32_t sequence;
+
+    rateStart = now ();
+    rateBytes = 0;
+    sequence = 0;
+    while (running) {
+        length = MIN_MESSAGE + (rand () % (MAX_MESSAGE - MIN_MESSAGE + 1));
+        priority = rand () % RING_BUFFER_PRIORITY_CLASSES;
+        filter = ((rand () & 3) == 0) ? 1 : 0;
+
+        // Limit the data rate
+        rateBytes += length;
+        while ((rateBytes / (now () - rateStart)) > PRODUCER_RATE)
+            sleepMicroseconds (100);
+
+        // Discard the oldest data when the ring buffer is full
+        if (length > ringBufferAvailable (&ring, NULL)) {
+            discarded = ringBufferDiscard (&ring, length, NULL);
+            discards += 1;
+            discardedBytes += discarded;
+        }
+
+        // Build the message at the head of the ring buffer
+        head = ring.head;
+        data = &ring.data[head];
+        data[0] = 0xa5;
+        data[1] = 0x5a;
+        data[2] = length;
+        data[3] = (length >> 8) | (filter ? FILTER_FLAG : 0);
+        data[4] = sequence;
+        data[5] = sequence >> 8;
+        data[6] = sequence >> 16;
+        data[7] = sequence >> 24;
+        for (index = HEADER_LENGTH; index < (length - CRC_LENGTH); index++)
+            data[index] = rand ();
+        crc = crc24qSpan (0, data, length - CRC_LENGTH);
+        data[length - 3] = crc >> 16;
+        data[length - 2] = crc >> 8;
+        data[length - 1] = crc;
+
+        // Drop the lower priority messages as the ring buffer fills
+        if (!ringBufferAccept (&ring, length, priority))
+            continue;
+        if ((sequence % EPOCH_MESSAGES) == 0)
+            ringBufferEpoch (&ring);
+        ringBufferCommit (&ring, length, priority, filter);
+        producedMessages += 1;
+        sequence += 1;
+    }
+    return NULL;
+}
+
+int
+main (
+    int argc,
+    char ** argv
+    )
+{
+    RING_BUFFER_OFFSET * offsetArray;
+    uint8_t * data;
+    uint64_t errors;
+    unsigned int index;
+    uint8_t * filterArray;
+    uint8_t * priorityArray;
+    pthread_t producer;
+    pthread_t threads[CONSUMER_COUNT];
+
+    // Allocate the ring buffer, leave room for a message past the end
+    data = malloc (RING_BUFFER_SIZE + SPILL_SIZE);
+    offsetArray = malloc (OFFSET_ENTRIES * sizeof (*offsetArray));
+    priorityArray = malloc (OFFSET_ENTRIES);
+    filterArray = malloc (OFFSET_ENTRIES);
+    if ((!data) || (!offsetArray) || (!priorityArray) || (!filterArray)) {
+        fprintf (stderr, "ERROR - Failed to allocate the ring buffer!\n");
+        return -1;
+    }
+    ringBufferInit (&ring, data, RING_BUFFER_SIZE, offsetArray, priorityArray,
+                    filterArray, OFFSET_ENTRIES, RING_BUFFER_SIZE >> 2);
+    ringBufferReserves (&ring, true);
+
+    // Register the consumers
+    for (index = 0; index < CONSUMER_COUNT; index++) {
+        consumers[index].ringConsumer.connected = consumerConnected;
+        consumers[index].ringConsumer.send = consumerSend;
+        consumers[index].ringConsumer.index = index;
+        consumers[index].ringConsumer.highWater = consumers[index].highWater;
+        consumers[index].lastSequence = -1;
+        if (!ringBufferRegister (&ring, &consumers[index].ringConsumer)) {
+            fprintf (stderr, "ERROR - Failed to register consumer %s\n",
+                     consumers[index].ringConsumer.name);
+            return -2;
+        }
+    }
+
+    // Run the simulation
+    running = true;
+    for (index = 0; index < CONSUMER_COUNT; index++)
+        pthread_create (&threads[index], NULL, consumerThread, &consumers[index]);
+    pthread_create (&producer, NULL, producerThread, NULL);
+    sleepMicroseconds (RUN_SECONDS * 1000000);
+    running = false;
+    pthread_join (producer, NULL);
+    for (index = 0; index < CONSUMER_COUNT; index++)
+        pthread_join (threads[index], NULL);
+
+    // Display the results
+    printf ("Producer: %llu messages, %llu discards, %llu bytes discarded\n",
+            (unsigned long long)producedMessages, (unsigned long long)discards,
+            (unsigned long long)discardedBytes);
+    printf ("%-12s %12s %10s %10s %8s %6s %6s %6s %6s %8s\n", "Consumer", "Bytes", "Messages", "Missing", "Corrupt",
+            "Errors", "Max ms", "p99 ms", "Skips", "Max lag");
+    errors = 0;
+    for (index = 0; index < CONSUMER_COUNT; index++) {
+        CONSUMER * consumer = &consumers[index];
+
+        printf ("%-12s %12llu %10llu %10llu %8llu %6llu %6u %6u %6u %8d\n", consumer->ringConsumer.name,
+                (unsigned long long)consumer->bytes, (unsigned long long)consumer->messages,
+                (unsigned long long)consumer->missing, (unsigned long long)consumer->corrupt,
+                (unsigned long long)consumer->errors, consumer->ringConsumer.maxMillis,
+                ringBufferSendTimePercentile (&consumer->ringConsumer, 99),
+                consumer->ringConsumer.skips, consumer->ringConsumer.maxUsed);
+        errors += consumer->errors;
+        if (consumer->mustKeepUp && (consumer->missing || consumer->corrupt)) {
+            fprintf (stderr, "ERROR - %s lost data\n", consumer->ringConsumer.name);
+            errors += 1;
+        }
+        if (consumer->highWater && (consumer->corrupt || (!consumer->ringConsumer.skips))) {
+            fprintf (stderr, "ERROR - %s did not skip ahead cleanly\n", consumer->ringConsumer.name);
+            errors += 1;
+        }
+    }
+
+    // Display the dropped messages, the lower priority classes must be
+    // dropped first
+    printf ("%-12s %10s %12s\n", "Priority", "Dropped", "Bytes");
+    for (index = 0; index < RING_BUFFER_PRIORITY_CLASSES; index++) {
+        printf ("%-12d %10u %12u\n", index, ring.droppedMessages[index], ring.droppedBytes[index]);
+        if (index && (ring.droppedMessages[index] > ring.droppedMessages[index - 1])) {
+            fprintf (stderr, "ERROR - Priority %d dropped more messages than priority %d\n",
+                     index, index - 1);
+            errors += 1;
+        }
+    }
+    if (errors) {
+        fprintf (stderr, "ERROR - %llu errors detected!\n", (unsigned long long)errors);
+        return -3;
+    }
+    return 0;
+}